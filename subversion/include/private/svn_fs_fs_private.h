@@ -353,6 +353,25 @@ svn_fs_fs__load_index(svn_fs_t *fs,
                       apr_array_header_t *entries,
                       apr_pool_t *scratch_pool);
 
+/* Rewrite the pack file in FS containing REVISION, re-encoding all delta
+ * representations that don't use the compression configured by the
+ * "pack-compression" option in fsfs.conf yet.  Update the indexes
+ * accordingly.  Item order and all logical addresses remain unchanged.
+ * If REVISION is SVN_INVALID_REVNUM, process all pack files in FS.
+ * If not NULL, call CANCEL_FUNC with CANCEL_BATON from time to time.
+ * Use SCRATCH_POOL for temporary allocations.
+ *
+ * Processes that accessed the pack file before may keep outdated data in
+ * their caches.  Thus, like svn_fs_fs__load_index, this should only be
+ * used while the repository is not being served.
+ */
+svn_error_t *
+svn_fs_fs__repack(svn_fs_t *fs,
+                  svn_revnum_t revision,
+                  svn_cancel_func_t cancel_func,
+                  void *cancel_baton,
+                  apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -211,6 +211,143 @@ svn_fs__get_deleted_node(svn_fs_root_t **node_root,
                          apr_pool_t *result_pool,
                          apr_pool_t *scratch_pool);
 
+/** Set @a *revisions to all revisions between @a start and @a end,
+ * inclusively, that may have changed @a path in @a fs, in descending
+ * order.  This includes changes below @a path as well as replacements
+ * and deletions of its parents.  The list may contain additional
+ * revisions but will never miss a relevant one.
+ *
+ * If @a fs has no path index, set @a *revisions to @c NULL.
+ * Allocate the result in @a result_pool and use @a scratch_pool for
+ * temporaries.
+ */
+svn_error_t *
+svn_fs__get_path_revisions(apr_array_header_t **revisions,
+                           svn_fs_t *fs,
+                           const char *path,
+                           svn_revnum_t start,
+                           svn_revnum_t end,
+                           apr_pool_t *result_pool,
+                           apr_pool_t *scratch_pool);
+
+/** Build the path index of @a fs from scratch, replacing any existing
+ * one.  Once it exists, commits will keep the index up to date.
+ * Commits will only be blocked while the revisions added since the start
+ * of this function get indexed.
+ *
+ * Call @a notify_func with @a notify_baton after each revision has been
+ * processed.  Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_fs__build_path_index(svn_fs_t *fs,
+                         svn_fs_progress_notify_func_t notify_func,
+                         void *notify_baton,
+                         svn_cancel_func_t cancel_func,
+                         void *cancel_baton,
+                         apr_pool_t *scratch_pool);
+
+/** Value used by svn_fs__get_revision_date() for revisions without a
+ * valid svn:date.
+ */
+#define SVN_FS__NO_DATE APR_INT64_MIN
+
+/** Opaque handle of an open date index. */
+typedef struct svn_fs__date_index_t svn_fs__date_index_t;
+
+/** Open the date index of @a fs for reading and return it in @a *index.
+ * If there is no date index, set @a *index to NULL.  The index will be
+ * closed when @a result_pool gets cleaned up.
+ *
+ * Use @a scratch_pool for temporaries.
+ */
+svn_error_t *
+svn_fs__open_date_index(svn_fs__date_index_t **index,
+                        svn_fs_t *fs,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool);
+
+/** Set @a *date to the svn:date of @a revision as recorded in @a index.
+ * Set it to #SVN_FS__NO_DATE if the revision has no valid svn:date or is
+ * not covered by the index, which may lag behind the youngest revisions.
+ * Only the record for @a revision gets read.
+ *
+ * Use @a scratch_pool for temporaries.
+ */
+svn_error_t *
+svn_fs__get_revision_date(apr_time_t *date,
+                          svn_fs__date_index_t *index,
+                          svn_revnum_t revision,
+                          apr_pool_t *scratch_pool);
+
+/** Build the date index of @a fs from scratch, replacing any existing
+ * one.  Once it exists, commits and svn:date changes will keep the index
+ * up to date.  Since svn:date may change at any time, commits and revprop
+ * changes will be blocked until this function returns.
+ *
+ * Call @a notify_func with @a notify_baton after each revision has been
+ * processed.  Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_fs__build_date_index(svn_fs_t *fs,
+                         svn_fs_progress_notify_func_t notify_func,
+                         void *notify_baton,
+                         svn_cancel_func_t cancel_func,
+                         void *cancel_baton,
+                         apr_pool_t *scratch_pool);
+
+/** Wait until the youngest revision of @a fs is younger than @a revision
+ * or until @a timeout has passed, whichever comes first.  Set
+ * @a *youngest_p to the youngest revision found.  A negative @a timeout
+ * means to wait indefinitely.
+ *
+ * This polls svn_fs_youngest_rev() with increasing intervals, which is
+ * cheap for backends that don't need to access the disk for it, e.g.
+ * FSFS with its youngest map enabled.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_fs__wait_for_youngest(svn_revnum_t *youngest_p,
+                          svn_fs_t *fs,
+                          svn_revnum_t revision,
+                          apr_interval_time_t timeout,
+                          svn_cancel_func_t cancel_func,
+                          void *cancel_baton,
+                          apr_pool_t *scratch_pool);
+
+/** If the backend stores the contents of the file @a path under @a root
+ * as a plain fulltext file, set @a *fulltext to that file opened for
+ * reading.  Otherwise, set @a *fulltext to NULL and let the caller fall
+ * back to svn_fs_file_contents().
+ *
+ * This allows servers to deliver large files without copying them through
+ * user space, e.g. using apr_socket_sendfile().  The file must not be
+ * modified.  Allocate @a *fulltext in @a pool.
+ */
+svn_error_t *
+svn_fs__open_fulltext_file(apr_file_t **fulltext,
+                           svn_fs_root_t *root,
+                           const char *path,
+                           apr_pool_t *pool);
+
+/** Like svn_fs_paths_changed3() but set @a *iterator to report only the
+ * changes in @a root at or below @a path.
+ *
+ * Backends that keep their changed-paths lists sorted by path can do this
+ * without looking at the other changes, which makes a difference for large
+ * revisions where only a small sub-tree is of interest.  Otherwise, the
+ * changes get filtered on the fly.
+ *
+ * Allocate @a *iterator in @a result_pool and use @a scratch_pool for
+ * temporary allocations.
+ */
+svn_error_t *
+svn_fs__paths_changed_under(svn_fs_path_change_iterator_t **iterator,
+                            svn_fs_root_t *root,
+                            const char *path,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool);
+
 
 /** @} */
 
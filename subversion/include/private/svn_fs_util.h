@@ -244,6 +244,172 @@ svn_fs__prop_lists_equal(apr_hash_t *a,
                          apr_hash_t *b,
                          apr_pool_t *pool);
 
+/* The optional path index of a filesystem maps paths to the revisions
+   that changed them or anything below them.  It is stored in the FS_PATH
+   directory but independent from the backend's own data. */
+
+/* Set *YOUNGEST to the youngest revision covered by the path index in
+   FS_PATH or to SVN_INVALID_REVNUM if there is no path index.
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs__path_index_youngest(svn_revnum_t *youngest,
+                            const char *fs_path,
+                            apr_pool_t *scratch_pool);
+
+/* Add REVISION with the paths that it changed (the keys of CHANGED_PATHS)
+   to the path index in FS_PATH.  This is a no-op if there is no path index
+   or it does not cover the revision before REVISION.  The caller must hold
+   the FS write lock.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs__path_index_append(const char *fs_path,
+                          svn_revnum_t revision,
+                          apr_hash_t *changed_paths,
+                          apr_pool_t *scratch_pool);
+
+/* Set *REVISIONS to all revisions between START and END, inclusively,
+   that may have changed PATH, according to the path index in FS_PATH.
+   This includes changes to PATH itself or anything below it as well as
+   replacements and deletions of its parents.  The result may contain
+   additional revisions but never misses any.  Revisions not covered by
+   the index yet will always be included.
+
+   The elements of *REVISIONS are svn_revnum_t, in descending order.  If
+   there is no path index, set *REVISIONS to NULL.  Allocate the result in
+   RESULT_POOL and use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs__path_index_read(apr_array_header_t **revisions,
+                        const char *fs_path,
+                        const char *path,
+                        svn_revnum_t start,
+                        svn_revnum_t end,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool);
+
+/* Replace the path index in DST_FS_PATH, if any, with a copy of the one
+   in SRC_FS_PATH covering at most the revisions up to YOUNGEST.  Remove
+   the destination index if the source has none.  The caller must hold
+   the write lock of the destination.  Use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *
+svn_fs__path_index_copy(const char *src_fs_path,
+                        const char *dst_fs_path,
+                        svn_revnum_t youngest,
+                        apr_pool_t *scratch_pool);
+
+/* Opaque state of a path index being built. */
+typedef struct svn_fs__path_index_builder_t svn_fs__path_index_builder_t;
+
+/* Start building a new path index for FS_PATH in a temporary location
+   and return the builder state in *BUILDER.  Allocate *BUILDER in
+   RESULT_POOL and use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs__path_index_builder_create(svn_fs__path_index_builder_t **builder,
+                                  const char *fs_path,
+                                  apr_pool_t *result_pool,
+                                  apr_pool_t *scratch_pool);
+
+/* Add REVISION with the paths that it changed (the keys of CHANGED_PATHS)
+   to BUILDER.  Revisions must be added in order, starting at 0.
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs__path_index_builder_add(svn_fs__path_index_builder_t *builder,
+                               svn_revnum_t revision,
+                               apr_hash_t *changed_paths,
+                               apr_pool_t *scratch_pool);
+
+/* Atomically replace the current path index, if any, with the one in
+   BUILDER.  The caller must hold the FS write lock and must have added
+   all revisions up to HEAD.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs__path_index_builder_finish(svn_fs__path_index_builder_t *builder,
+                                  apr_pool_t *scratch_pool);
+
+/* The date index of a filesystem stores the svn:date values of all
+   revisions in a compact array.  It is stored in the FS_PATH directory
+   but independent from the backend's own data. */
+
+/* Add the svn:date value DATE of REVISION to the date index in FS_PATH.
+   DATE may be NULL.  Revision 0 starts a new index.  For all other
+   revisions, this is a no-op if there is no date index or it does not
+   cover the revision before REVISION.  The caller must hold the FS write
+   lock.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs__date_index_append(const char *fs_path,
+                          svn_revnum_t revision,
+                          const svn_string_t *date,
+                          apr_pool_t *scratch_pool);
+
+/* Update the date index in FS_PATH after the svn:date of REVISION has
+   been changed to DATE, which may be NULL.  This is a no-op if the index
+   does not cover REVISION.  The caller must hold the FS write lock.
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs__date_index_set(const char *fs_path,
+                       svn_revnum_t revision,
+                       const svn_string_t *date,
+                       apr_pool_t *scratch_pool);
+
+/* Opaque date index reader.  The typedef lives in svn_fs_private.h. */
+struct svn_fs__date_index_t;
+
+/* Open the date index in FS_PATH for reading and return it in *INDEX.
+   Set *INDEX to NULL if there is no date index.  The index will be closed
+   when RESULT_POOL gets cleaned up.  Use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *
+svn_fs__date_index_open(struct svn_fs__date_index_t **index,
+                        const char *fs_path,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool);
+
+/* Set *DATE to the svn:date of REVISION as recorded in INDEX.  Set it to
+   SVN_FS__NO_DATE if the revision has no valid svn:date or if INDEX did
+   not cover REVISION when it was opened.  This reads only the record of
+   REVISION.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs__date_index_get(apr_time_t *date,
+                       struct svn_fs__date_index_t *index,
+                       svn_revnum_t revision,
+                       apr_pool_t *scratch_pool);
+
+/* Copy the date index from SRC_FS_PATH to DST_FS_PATH, dropping all
+   revisions after YOUNGEST.  If the source has no date index, remove
+   the one in DST_FS_PATH, if any.  The caller must hold the write lock
+   of the destination.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs__date_index_copy(const char *src_fs_path,
+                        const char *dst_fs_path,
+                        svn_revnum_t youngest,
+                        apr_pool_t *scratch_pool);
+
+/* Opaque state of a date index being built. */
+typedef struct svn_fs__date_index_builder_t svn_fs__date_index_builder_t;
+
+/* Start building a new date index for FS_PATH in a temporary location
+   and return the builder state in *BUILDER.  Allocate *BUILDER in
+   RESULT_POOL and use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs__date_index_builder_create(svn_fs__date_index_builder_t **builder,
+                                  const char *fs_path,
+                                  apr_pool_t *result_pool,
+                                  apr_pool_t *scratch_pool);
+
+/* Add the svn:date value DATE, which may be NULL, of REVISION to BUILDER.
+   Revisions must be added in order, starting at 0.
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs__date_index_builder_add(svn_fs__date_index_builder_t *builder,
+                               svn_revnum_t revision,
+                               const svn_string_t *date,
+                               apr_pool_t *scratch_pool);
+
+/* Replace the current date index, if any, with the one in BUILDER.
+   The caller must hold the FS write lock and must have added all
+   revisions up to HEAD.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs__date_index_builder_finish(svn_fs__date_index_builder_t *builder,
+                                  apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
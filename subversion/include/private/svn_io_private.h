@@ -85,6 +85,75 @@ svn_io__file_lock_autocreate(const char *lock_file,
                              apr_pool_t *pool);
 
 
+/** A single positioned read to be executed as part of a batch by
+ * svn_io__file_read_batch().
+ */
+typedef struct svn_io__read_request_t
+{
+  /** Offset within the file at which to start reading. */
+  apr_off_t offset;
+
+  /** Number of bytes to read. */
+  apr_size_t size;
+
+  /** Buffer receiving the data.  Must provide at least @a size bytes. */
+  char *buffer;
+
+  /** Set by svn_io__file_read_batch() to the number of bytes actually
+   * read.  This will be less than @a size only if the request extends
+   * beyond the end of the file. */
+  apr_size_t bytes_read;
+} svn_io__read_request_t;
+
+/** Execute the @a count read @a requests against @a file and return only
+ * after all of them completed.  Reading at or beyond EOF is not an error;
+ * check the @a bytes_read member of each request instead.
+ *
+ * Where available (Linux with liburing), all requests will be submitted
+ * to the kernel at once and be served concurrently.  Otherwise, they will
+ * be executed one by one.  In either case, the current position and the
+ * buffer contents of @a file will not change.  @a file must not have any
+ * unflushed write data buffered.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_io__file_read_batch(apr_file_t *file,
+                        svn_io__read_request_t *requests,
+                        int count,
+                        apr_pool_t *scratch_pool);
+
+/** Hint to the OS that the @a length bytes of @a file starting at
+ * @a offset will be read soon.  This does not wait for any data to be
+ * read; the OS fetches the range into its file cache in the background.
+ *
+ * Return TRUE if the hint covering the whole range has been passed on to
+ * the OS and FALSE if the platform does not support read-ahead advice or
+ * it failed.  Errors are not reported as this is an optimization only.
+ * The current position and the buffer contents of @a file will not change.
+ */
+svn_boolean_t
+svn_io__file_prefetch(apr_file_t *file,
+                      apr_off_t offset,
+                      apr_off_t length);
+
+/** Return TRUE, if svn_io__file_read_batch() is able to process requests
+ * concurrently on this platform.
+ */
+svn_boolean_t
+svn_io__async_read_available(void);
+
+
+/** Write all @a nvec buffers in @a vec to @a file, in order, using a
+ * single gathering write where that is cheaper than copying the data
+ * into the file buffer.  Use @a pool for temporary allocations.
+ */
+svn_error_t *
+svn_io__file_writev_full(apr_file_t *file,
+                         const struct iovec *vec,
+                         int nvec,
+                         apr_pool_t *pool);
+
 /** Return the underlying file, if any, associated with the stream, or
  * NULL if not available.  Accessing the file bypasses the stream.
  */
@@ -235,6 +235,17 @@ svn_packed__get_uint(svn_packed__int_stream_t *stream);
 apr_int64_t
 svn_packed__get_int(svn_packed__int_stream_t *stream);
 
+/* Read the next COUNT numbers from STREAM into VALUES, in the same order
+ * as COUNT calls to svn_packed__get_uint would return them, and return
+ * the number of values actually read.  Values beyond the end of the
+ * stream will be set to 0.  This is much faster than reading the values
+ * one at a time, in particular for streams with sub-streams.
+ */
+apr_size_t
+svn_packed__get_uints(svn_packed__int_stream_t *stream,
+                      apr_uint64_t *values,
+                      apr_size_t count);
+
 /* Return the next byte sequence from STREAM and set *LEN to the length
  * of that sequence.  Sets *LEN to 0 when reading beyond the end of the
  * stream.
@@ -146,6 +146,16 @@ svn_ra_svn__set_shim_callbacks(svn_ra_svn_conn_t *conn,
 apr_pool_t *
 svn_ra_svn__get_pool(svn_ra_svn_conn_t *conn);
 
+/**
+ * Make reads from @a conn fail once they had to wait for more than
+ * @a interval for data to arrive.  Negative values, the default, let
+ * reads block indefinitely.  Only connections using a socket support
+ * this; for others, this is a no-op.
+ */
+void
+svn_ra_svn__set_read_timeout(svn_ra_svn_conn_t *conn,
+                             apr_interval_time_t interval);
+
 /**
  * @defgroup ra_svn_deprecated ra_svn low-level functions
  * @{
@@ -169,6 +179,20 @@ svn_ra_svn__write_string(svn_ra_svn_conn_t *conn,
                          apr_pool_t *pool,
                          const svn_string_t *str);
 
+/** Write @a len bytes starting at @a offset in @a file as a string over
+ * the net.
+ *
+ * Any buffered data will be flushed first.  The contents will then be
+ * sent directly from @a file, using sendfile() where available.  The file
+ * pointer of @a file is undefined afterwards.
+ */
+svn_error_t *
+svn_ra_svn__write_file_string(svn_ra_svn_conn_t *conn,
+                              apr_pool_t *pool,
+                              apr_file_t *file,
+                              apr_off_t offset,
+                              apr_size_t len);
+
 /** Write a cstring over the net.
  *
  * Writes will be buffered until the next read or flush.
@@ -365,6 +389,28 @@ svn_ra_svn__has_command(svn_boolean_t *has_command,
                         svn_ra_svn_conn_t *conn,
                         apr_pool_t *pool);
 
+/** Callback invoked by svn_ra_svn__handle_command() after each known
+ * command @a cmdname has been handled.  @a duration is the time spent in
+ * the command handler, @a bytes_in and @a bytes_out the amount of data
+ * received and sent for the command, including the command itself.
+ * @a failed is set if the handler returned an error.  @a baton is the
+ * one passed to svn_ra_svn__set_command_observer().
+ */
+typedef void (*svn_ra_svn__command_observer_t)(void *baton,
+                                               const char *cmdname,
+                                               apr_interval_time_t duration,
+                                               apr_uint64_t bytes_in,
+                                               apr_uint64_t bytes_out,
+                                               svn_boolean_t failed);
+
+/** Make @a conn report every command it handles to @a observer with
+ * @a baton.  Pass @c NULL for @a observer to disable the reports.
+ */
+void
+svn_ra_svn__set_command_observer(svn_ra_svn_conn_t *conn,
+                                 svn_ra_svn__command_observer_t observer,
+                                 void *baton);
+
 /** Accept a single command from @a conn and handle them according
  * to @a cmd_hash.  Command handlers will be passed @a conn, @a pool,
  * the parameters of the command, and @a baton.  @a *terminate will be
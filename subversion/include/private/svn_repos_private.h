@@ -349,6 +349,31 @@ svn_repos__dump_node_record(svn_stream_t *dump_stream,
                             svn_boolean_t content_length_always,
                             apr_pool_t *scratch_pool);
 
+/**
+ * Declare that this process is a long-running, multi-threaded server,
+ * such that post-operation hooks may run in the background after the
+ * operation has completed.  Only then will the hooks-queue configuration
+ * of a repository take effect.  All other processes, e.g. forked server
+ * children or command line tools, run those hooks synchronously because
+ * background hooks might get killed when the process exits.
+ *
+ * This is a no-op if APR does not support threads.
+ */
+void
+svn_repos__hook_queue_allow_background(void);
+
+/**
+ * Wait until the background queue of post-operation hooks of REPOS has
+ * run all hooks queued so far by this process.  Return immediately if
+ * REPOS does not use a hook queue or hooks cannot run in the background.
+ * This is mainly useful for testing.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_repos__hook_queue_wait(svn_repos_t *repos,
+                           apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -104,6 +104,23 @@ svn_spillbuf__create_extended(apr_size_t blocksize,
                               const char* dirpath,
                               apr_pool_t *result_pool);
 
+/* Create a spill buffer that spills into memory-mapped storage, growing
+   in large extents, instead of a classic spill file.  Where available,
+   that storage is an anonymous memory file, so no temp directory access
+   is required.  Spilled content returned by svn_spillbuf__read() and
+   svn_spillbuf__process() points directly into the mapping, avoiding
+   a copy.
+
+   Storage is being re-used as soon as the content in it has been read,
+   so it only grows with the amount of unread content.
+   svn_spillbuf__get_filename() may return NULL for these buffers, even
+   while spilling.  Falls back to svn_spillbuf__create() behavior on
+   platforms without memory mapping support.  */
+svn_spillbuf_t *
+svn_spillbuf__create_mapped(apr_size_t blocksize,
+                            apr_size_t maxsize,
+                            apr_pool_t *result_pool);
+
 /* Determine how much content is stored in the spill buffer.  */
 svn_filesize_t
 svn_spillbuf__get_size(const svn_spillbuf_t *buf);
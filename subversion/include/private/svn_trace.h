@@ -0,0 +1,167 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ *
+ * @file svn_trace.h
+ * @brief Lightweight counters and timer spans for hot code paths.
+ */
+
+#ifndef SVN_TRACE_H
+#define SVN_TRACE_H
+
+#include <apr_time.h>
+
+#include "svn_types.h"
+#include "svn_io.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * @defgroup svn_trace Tracing and counters
+ * @{
+ *
+ * Probes are named, statically allocated points in the code.  They are
+ * always compiled in but disabled by default, in which case every probe
+ * costs a single function call returning FALSE.  Once enabled, counts
+ * and accumulated durations are collected per thread, without locking,
+ * and the most recent spans are kept in a per-thread ring buffer.
+ *
+ * Use #SVN_TRACE__PROBE to define a probe at file scope and then either
+ * #SVN_TRACE__COUNT to add to its counter or #SVN_TRACE__SPAN_START and
+ * #SVN_TRACE__SPAN_END to time a section of code.  svn_trace__write()
+ * aggregates the data of all threads.
+ */
+
+/** A named probe.  Define instances with #SVN_TRACE__PROBE only.
+ */
+typedef struct svn_trace__probe_t
+{
+  /** Name of the probe, e.g. "fsfs.read_delta_window".  Names are being
+   * written to JSON as they are and must not require escaping. */
+  const char *name;
+
+  /** Slot assigned to this probe upon first use.  0 while unassigned. */
+  volatile apr_uint32_t id;
+} svn_trace__probe_t;
+
+/** Define a static probe variable @a var with the string literal @a name.
+ */
+#define SVN_TRACE__PROBE(var, name) \
+  static svn_trace__probe_t var = { name, 0 }
+
+/** Add @a amount to the counter of @a probe, if tracing is enabled.
+ */
+#define SVN_TRACE__COUNT(probe, amount)                \
+  do {                                                 \
+    if (svn_trace__enabled())                          \
+      svn_trace__count(&(probe), (amount));            \
+  } while (0)
+
+/** Return the start time for a span, or 0 if tracing is disabled.
+ * Pass the result to #SVN_TRACE__SPAN_END.
+ */
+#define SVN_TRACE__SPAN_START() \
+  (svn_trace__enabled() ? apr_time_now() : 0)
+
+/** Record a span for @a probe that started at @a start, unless @a start
+ * is 0, i.e. tracing was disabled when the span began.
+ */
+#define SVN_TRACE__SPAN_END(probe, start)              \
+  do {                                                 \
+    if (start)                                         \
+      svn_trace__span(&(probe), (start));              \
+  } while (0)
+
+/** Output formats supported by svn_trace__write(). */
+typedef enum svn_trace__format_t
+{
+  /** A single JSON object with totals per probe. */
+  svn_trace__format_json,
+
+  /** Chrome trace event format, i.e. the recorded spans plus the counter
+   * totals.  Can be loaded into chrome://tracing and similar tools. */
+  svn_trace__format_chrome,
+
+  /** Prometheus text exposition format with the totals per probe, to be
+   * served by a metrics endpoint. */
+  svn_trace__format_prometheus
+} svn_trace__format_t;
+
+/** Return TRUE if tracing is currently enabled.
+ */
+svn_boolean_t
+svn_trace__enabled(void);
+
+/** Enable tracing if @a enable is TRUE, disable it otherwise.  Data
+ * collected so far will be kept.
+ */
+svn_error_t *
+svn_trace__enable(svn_boolean_t enable);
+
+/** Reset all counters and discard all recorded spans.
+ *
+ * Threads clear their own data the next time they record something, so
+ * resets never corrupt counters.  Data recorded concurrently with a reset
+ * may be lost, though, and output written by svn_trace__write() while
+ * other threads record data is approximate.
+ */
+svn_error_t *
+svn_trace__reset(void);
+
+/** Add @a amount to the counter of @a probe in the current thread.
+ * Use #SVN_TRACE__COUNT instead of calling this directly.
+ */
+void
+svn_trace__count(svn_trace__probe_t *probe,
+                 apr_uint64_t amount);
+
+/** Count a call to @a probe in the current thread and add the time
+ * elapsed since @a start to its duration.  Also, record the span for
+ * trace output.  Use #SVN_TRACE__SPAN_END instead of calling this
+ * directly.
+ */
+void
+svn_trace__span(svn_trace__probe_t *probe,
+                apr_time_t start);
+
+/** Parse @a name ("json", "chrome" or "prometheus") into *@a format.
+ */
+svn_error_t *
+svn_trace__parse_format(svn_trace__format_t *format,
+                        const char *name);
+
+/** Write the data collected from all threads to @a stream in the given
+ * @a format.  Use @a scratch_pool for temporary allocations.
+ */
+svn_error_t *
+svn_trace__write(svn_stream_t *stream,
+                 svn_trace__format_t format,
+                 apr_pool_t *scratch_pool);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_TRACE_H */
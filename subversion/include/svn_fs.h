@@ -2844,6 +2844,45 @@ svn_fs_revision_proplist2(apr_hash_t **table_p,
                           apr_pool_t *result_pool,
                           apr_pool_t *scratch_pool);
 
+/** The type of a callback function receiving the property list
+ * @a proplist of @a revision, as used by svn_fs_revision_proplists().
+ * @a proplist and its contents are only valid during the call.
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.11.
+ */
+typedef svn_error_t *
+(*svn_fs_revision_proplist_receiver_t)(void *baton,
+                                       svn_revnum_t revision,
+                                       apr_hash_t *proplist,
+                                       apr_pool_t *scratch_pool);
+
+/** Call @a receiver with @a receiver_baton for the entire property list
+ * of every revision from @a start to @a end in filesystem @a fs, in that
+ * order.  @a start may be larger than @a end.
+ *
+ * This is equivalent to calling svn_fs_revision_proplist2() for each
+ * revision but back-ends may fetch the data much more efficiently, e.g.
+ * by reading each packed revprop shard only once.
+ *
+ * If @a refresh is set, this call acts as a read barrier once before
+ * accessing the first revision.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @see svn_fs_refresh_revision_props
+ *
+ * @since New in 1.11.
+ */
+svn_error_t *
+svn_fs_revision_proplists(svn_fs_t *fs,
+                          svn_revnum_t start,
+                          svn_revnum_t end,
+                          svn_boolean_t refresh,
+                          svn_fs_revision_proplist_receiver_t receiver,
+                          void *receiver_baton,
+                          apr_pool_t *scratch_pool);
+
 /** Like svn_fs_revision_proplist2 but using @a pool for @a scratch_pool as
  * well as @a result_pool and setting @a refresh to #TRUE.
  *
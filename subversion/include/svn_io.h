@@ -881,6 +881,16 @@ typedef svn_error_t *(*svn_write_fn_t)(void *baton,
                                        const char *data,
                                        apr_size_t *len);
 
+/** Gathering write handler function for a generic stream.  It must write
+ * all @a nvec buffers in @a vec, in order, or return an error.
+ * @see svn_stream_t and svn_stream_writev().
+ *
+ * @since New in 1.11.
+ */
+typedef svn_error_t *(*svn_stream_writev_fn_t)(void *baton,
+                                               const struct iovec *vec,
+                                               int nvec);
+
 /** Close handler function for a generic stream.  @see svn_stream_t. */
 typedef svn_error_t *(*svn_close_fn_t)(void *baton);
 
@@ -974,6 +984,16 @@ void
 svn_stream_set_write(svn_stream_t *stream,
                      svn_write_fn_t write_fn);
 
+/** Set @a stream's gathering write function to @a writev_fn.  If no
+ * such function is set, svn_stream_writev() falls back to calling the
+ * stream's write function once per buffer.
+ *
+ * @since New in 1.11.
+ */
+void
+svn_stream_set_writev(svn_stream_t *stream,
+                      svn_stream_writev_fn_t writev_fn);
+
 /** Set @a stream's close function to @a close_fn */
 void
 svn_stream_set_close(svn_stream_t *stream,
@@ -1363,6 +1383,22 @@ svn_stream_write(svn_stream_t *stream,
                  const char *data,
                  apr_size_t *len);
 
+/** Write the @a nvec buffers in @a vec, in order, to @a stream as if
+ * svn_stream_write() had been called for each of them.  Streams that
+ * support gathering writes will hand all data to the underlying
+ * file or socket at once, without first copying it into a single
+ * buffer.
+ *
+ * Like svn_stream_write(), this either writes all data or returns an
+ * error.
+ *
+ * @since New in 1.11.
+ */
+svn_error_t *
+svn_stream_writev(svn_stream_t *stream,
+                  const struct iovec *vec,
+                  int nvec);
+
 /** Close a generic stream. @see svn_stream_t. */
 svn_error_t *
 svn_stream_close(svn_stream_t *stream);
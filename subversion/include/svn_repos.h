@@ -250,7 +250,13 @@ typedef enum svn_repos_notify_action_t
   svn_repos_notify_pack_noop,
 
   /** The revision properties got set. @since New in 1.10. */
-  svn_repos_notify_load_revprop_set
+  svn_repos_notify_load_revprop_set,
+
+  /** A revision got added to the path index. @since New in 1.11. */
+  svn_repos_notify_path_index_rev,
+
+  /** A revision got added to the date index. @since New in 1.11. */
+  svn_repos_notify_date_index_rev
 } svn_repos_notify_action_t;
 
 /** The type of warning occurring.
@@ -319,7 +325,9 @@ typedef struct svn_repos_notify_t
 
   /** For #svn_repos_notify_dump_rev_end and #svn_repos_notify_verify_rev_end,
    * the revision which just completed.
-   * For #svn_fs_upgrade_format_bumped, the new format version. */
+   * For #svn_fs_upgrade_format_bumped, the new format version.
+   * For #svn_repos_notify_path_index_rev and
+   * #svn_repos_notify_date_index_rev, the revision just indexed. */
   svn_revnum_t revision;
 
   /** For #svn_repos_notify_warning, the warning message. */
@@ -756,6 +764,57 @@ svn_repos_fs_pack(svn_repos_t *repos,
                   void *cancel_baton,
                   apr_pool_t *pool);
 
+/**
+ * Build the path index of @a repos from scratch, replacing any existing
+ * one.  The path index lets svn_repos_get_logs5() and
+ * svn_repos_deleted_rev() skip revisions that did not touch the paths in
+ * question.  Once the index exists, commits and hotcopies keep it up to
+ * date.  Only FSFS and FSX repositories support a path index.
+ *
+ * Commits will only be blocked while the revisions committed in the
+ * meantime get indexed at the end.
+ *
+ * If @a notify_func is not @c NULL, call it with @a notify_baton and
+ * action #svn_repos_notify_path_index_rev for each revision indexed.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.11.
+ */
+svn_error_t *
+svn_repos_build_path_index(svn_repos_t *repos,
+                           svn_repos_notify_func_t notify_func,
+                           void *notify_baton,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *scratch_pool);
+
+/**
+ * Build the date index of @a repos from scratch, replacing any existing
+ * one.  The date index lets svn_repos_dated_revision() find revisions
+ * without reading any revision properties.  New FSFS and FSX repositories
+ * always have a date index; commits and changes to #SVN_PROP_REVISION_DATE
+ * keep it up to date.  Only FSFS and FSX repositories support a date
+ * index.
+ *
+ * Commits and revision property changes will be blocked while the index
+ * gets built.
+ *
+ * If @a notify_func is not @c NULL, call it with @a notify_baton and
+ * action #svn_repos_notify_date_index_rev for each revision indexed.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.11.
+ */
+svn_error_t *
+svn_repos_build_date_index(svn_repos_t *repos,
+                           svn_repos_notify_func_t notify_func,
+                           void *notify_baton,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *scratch_pool);
+
 /**
  * Run database recovery procedures on the repository at @a path,
  * returning the database to a consistent state.  Use @a pool for all
@@ -1904,6 +1963,34 @@ svn_repos_trace_node_locations(svn_fs_t *fs,
                                void *authz_read_baton,
                                apr_pool_t *pool);
 
+/**
+ * Call @a receiver with @a receiver_baton for the property list of every
+ * revision from @a start to @a end in the filesystem opened in @a repos,
+ * in that order.  @a start may be larger than @a end.
+ *
+ * The property lists get filtered using @a authz_read_func and
+ * @a authz_read_baton just as svn_repos_fs_revision_proplist() does.
+ * Revprop changes made while this function runs may not be visible.
+ *
+ * This is much faster than calling svn_repos_fs_revision_proplist() for
+ * each revision, in particular for packed repositories.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @see svn_fs_revision_proplists
+ *
+ * @since New in 1.11.
+ */
+svn_error_t *
+svn_repos_fs_revision_proplists(svn_repos_t *repos,
+                                svn_revnum_t start,
+                                svn_revnum_t end,
+                                svn_repos_authz_func_t authz_read_func,
+                                void *authz_read_baton,
+                                svn_fs_revision_proplist_receiver_t receiver,
+                                void *receiver_baton,
+                                apr_pool_t *scratch_pool);
+
 
 /**
  * Call @a receiver and @a receiver_baton to report successive
@@ -97,6 +97,7 @@ send_simple_insertion_window(svn_txdelta_window_t *window,
   apr_size_t header_len;
   apr_size_t ip_len, i;
   apr_size_t len = window->new_data->len;
+  struct iovec vec[2];
 
   /* there is only one target copy op. It must span the whole window */
   assert(window->ops[0].action_code == svn_txdelta_new);
@@ -142,10 +143,12 @@ send_simple_insertion_window(svn_txdelta_window_t *window,
 
   header_len = header_current - headers + ip_len;
 
-  /* Write out the window.  */
-  SVN_ERR(svn_stream_write(eb->output, (const char *)headers, &header_len));
-  if (len)
-    SVN_ERR(svn_stream_write(eb->output, window->new_data->data, &len));
+  /* Write out the window in one go.  */
+  vec[0].iov_base = headers;
+  vec[0].iov_len = header_len;
+  vec[1].iov_base = (void *)window->new_data->data;
+  vec[1].iov_len = len;
+  SVN_ERR(svn_stream_writev(eb->output, vec, len ? 2 : 1));
 
   return SVN_NO_ERROR;
 }
@@ -255,22 +258,24 @@ window_handler(svn_txdelta_window_t *window, void *baton)
   svn_stringbuf_t *instructions;
   svn_stringbuf_t *header;
   const svn_string_t *newdata;
+  struct iovec vec[4];
+  int nvec = 0;
 
   /* use specialized code if there is no source */
   if (window && !window->src_ops && window->num_ops == 1 && !eb->version)
     return svn_error_trace(send_simple_insertion_window(window, eb));
 
-  /* Make sure we write the header.  */
-  if (!eb->header_done)
-    {
-      len = SVNDIFF_HEADER_SIZE;
-      SVN_ERR(svn_stream_write(eb->output, get_svndiff_header(eb->version),
-                               &len));
-      eb->header_done = TRUE;
-    }
-
   if (window == NULL)
     {
+      /* Make sure we write the header.  */
+      if (!eb->header_done)
+        {
+          len = SVNDIFF_HEADER_SIZE;
+          SVN_ERR(svn_stream_write(eb->output,
+                                   get_svndiff_header(eb->version), &len));
+          eb->header_done = TRUE;
+        }
+
       /* We're done; clean up. */
       SVN_ERR(svn_stream_close(eb->output));
 
@@ -285,20 +290,35 @@ window_handler(svn_txdelta_window_t *window, void *baton)
                         eb->version, eb->compression_level,
                         eb->scratch_pool));
 
-  /* Write out the window.  */
-  len = header->len;
-  SVN_ERR(svn_stream_write(eb->output, header->data, &len));
+  /* Write out the window, preceded by the stream header if necessary.
+     Hand all parts to the stream at once instead of concatenating them. */
+  if (!eb->header_done)
+    {
+      vec[nvec].iov_base = (void *)get_svndiff_header(eb->version);
+      vec[nvec].iov_len = SVNDIFF_HEADER_SIZE;
+      ++nvec;
+    }
+
+  vec[nvec].iov_base = header->data;
+  vec[nvec].iov_len = header->len;
+  ++nvec;
+
   if (instructions->len > 0)
     {
-      len = instructions->len;
-      SVN_ERR(svn_stream_write(eb->output, instructions->data, &len));
+      vec[nvec].iov_base = instructions->data;
+      vec[nvec].iov_len = instructions->len;
+      ++nvec;
     }
   if (newdata->len > 0)
     {
-      len = newdata->len;
-      SVN_ERR(svn_stream_write(eb->output, newdata->data, &len));
+      vec[nvec].iov_base = (void *)newdata->data;
+      vec[nvec].iov_len = newdata->len;
+      ++nvec;
     }
 
+  SVN_ERR(svn_stream_writev(eb->output, vec, nvec));
+  eb->header_done = TRUE;
+
   return SVN_NO_ERROR;
 }
 
@@ -33,6 +33,8 @@
 #include "svn_pools.h"
 #include "svn_checksum.h"
 
+#include "private/svn_trace.h"
+
 #include "delta.h"
 
 
@@ -651,10 +653,14 @@ patterning_copy(char *target, const char *source, apr_size_t len)
   return target;
 }
 
-void
-svn_txdelta_apply_instructions(svn_txdelta_window_t *window,
-                               const char *sbuf, char *tbuf,
-                               apr_size_t *tlen)
+/* Trace probe for svn_txdelta_apply_instructions. */
+SVN_TRACE__PROBE(apply_instructions_probe, "delta.apply_instructions");
+
+/* Implement svn_txdelta_apply_instructions. */
+static void
+apply_instructions(svn_txdelta_window_t *window,
+                   const char *sbuf, char *tbuf,
+                   apr_size_t *tlen)
 {
   const svn_txdelta_op_t *op;
   apr_size_t tpos = 0;
@@ -714,6 +720,16 @@ svn_txdelta_apply_instructions(svn_txdelta_window_t *window,
   *tlen = tpos;
 }
 
+void
+svn_txdelta_apply_instructions(svn_txdelta_window_t *window,
+                               const char *sbuf, char *tbuf,
+                               apr_size_t *tlen)
+{
+  apr_time_t trace_start = SVN_TRACE__SPAN_START();
+  apply_instructions(window, sbuf, tbuf, tlen);
+  SVN_TRACE__SPAN_END(apply_instructions_probe, trace_start);
+}
+
 /* Apply WINDOW to the streams given by APPL.  */
 static svn_error_t *
 apply_window(svn_txdelta_window_t *window, void *baton)
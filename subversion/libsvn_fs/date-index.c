@@ -0,0 +1,138 @@
+/*
+ * date-index.c:  building and querying the date index of a filesystem
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include <apr_pools.h>
+
+#include "svn_types.h"
+#include "svn_error.h"
+#include "svn_pools.h"
+#include "svn_props.h"
+#include "svn_fs.h"
+
+#include "svn_private_config.h"
+
+#include "fs-loader.h"
+
+#include "private/svn_fs_private.h"
+#include "private/svn_fs_util.h"
+
+/* Baton used while building the date index. */
+typedef struct build_baton_t
+{
+  svn_fs_t *fs;
+
+  svn_fs_progress_notify_func_t notify_func;
+  void *notify_baton;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} build_baton_t;
+
+/* Implements svn_fs_freeze_func_t.  Index the svn:date of all revisions
+ * and replace the old index with the new one. */
+static svn_error_t *
+build_index(void *baton,
+            apr_pool_t *pool)
+{
+  build_baton_t *b = baton;
+  svn_fs__date_index_builder_t *builder;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_revnum_t youngest, revision;
+
+  SVN_ERR(svn_fs__date_index_builder_create(&builder, b->fs->path, pool,
+                                            pool));
+
+  SVN_ERR(svn_fs_refresh_revision_props(b->fs, pool));
+  SVN_ERR(svn_fs_youngest_rev(&youngest, b->fs, pool));
+  for (revision = 0; revision <= youngest; ++revision)
+    {
+      svn_string_t *date;
+
+      svn_pool_clear(iterpool);
+      if (b->cancel_func)
+        SVN_ERR(b->cancel_func(b->cancel_baton));
+
+      SVN_ERR(svn_fs_revision_prop2(&date, b->fs, revision,
+                                    SVN_PROP_REVISION_DATE, FALSE,
+                                    iterpool, iterpool));
+      SVN_ERR(svn_fs__date_index_builder_add(builder, revision, date,
+                                             iterpool));
+
+      if (b->notify_func)
+        b->notify_func(revision, b->notify_baton, iterpool);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_fs__date_index_builder_finish(builder, pool));
+}
+
+svn_error_t *
+svn_fs__open_date_index(svn_fs__date_index_t **index,
+                        svn_fs_t *fs,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(svn_fs__date_index_open(index, fs->path,
+                                                 result_pool,
+                                                 scratch_pool));
+}
+
+svn_error_t *
+svn_fs__get_revision_date(apr_time_t *date,
+                          svn_fs__date_index_t *index,
+                          svn_revnum_t revision,
+                          apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(svn_fs__date_index_get(date, index, revision,
+                                                scratch_pool));
+}
+
+svn_error_t *
+svn_fs__build_date_index(svn_fs_t *fs,
+                         svn_fs_progress_notify_func_t notify_func,
+                         void *notify_baton,
+                         svn_cancel_func_t cancel_func,
+                         void *cancel_baton,
+                         apr_pool_t *scratch_pool)
+{
+  build_baton_t baton;
+  const char *fs_type;
+
+  /* Only FSFS and FSX update the date index. */
+  SVN_ERR(svn_fs_type(&fs_type, fs->path, scratch_pool));
+  if (strcmp(fs_type, SVN_FS_TYPE_BDB) == 0)
+    return svn_error_createf(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                             _("Date index not supported for '%s' "
+                               "filesystems"), fs_type);
+
+  baton.fs = fs;
+  baton.notify_func = notify_func;
+  baton.notify_baton = notify_baton;
+  baton.cancel_func = cancel_func;
+  baton.cancel_baton = cancel_baton;
+
+  return svn_error_trace(svn_fs_freeze(fs, build_index, &baton,
+                                       scratch_pool));
+}
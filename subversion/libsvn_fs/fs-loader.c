@@ -28,6 +28,7 @@
 #include <apr_hash.h>
 #include <apr_uuid.h>
 #include <apr_strings.h>
+#include <apr_time.h>
 
 #include "svn_private_config.h"
 #include "svn_hash.h"
@@ -1216,6 +1217,69 @@ svn_fs_paths_changed3(svn_fs_path_change_iterator_t **iterator,
   return SVN_NO_ERROR;
 }
 
+/* Iterator data for svn_fs__paths_changed_under in case the FS backend
+   does not support sub-tree filtering. */
+typedef struct filter_iterator_data_t
+{
+  /* Iterator over all changes. */
+  svn_fs_path_change_iterator_t *all_changes;
+
+  /* Only report changes at or below this canonical fspath. */
+  const char *prefix;
+} filter_iterator_data_t;
+
+static svn_error_t *
+filter_iterator_get(svn_fs_path_change3_t **change,
+                    svn_fs_path_change_iterator_t *iterator)
+{
+  filter_iterator_data_t *data = iterator->fsap_data;
+
+  do
+    SVN_ERR(svn_fs_path_change_get(change, data->all_changes));
+  while (*change
+         && !svn_fspath__skip_ancestor(data->prefix, (*change)->path.data));
+
+  return SVN_NO_ERROR;
+}
+
+static changes_iterator_vtable_t filter_iterator_vtable =
+{
+  filter_iterator_get
+};
+
+svn_error_t *
+svn_fs__paths_changed_under(svn_fs_path_change_iterator_t **iterator,
+                            svn_fs_root_t *root,
+                            const char *path,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool)
+{
+  const char *prefix = svn_fs__canonicalize_abspath(path, scratch_pool);
+
+  if (root->vtable->report_changes_under)
+    {
+      SVN_ERR(root->vtable->report_changes_under(iterator, root, prefix,
+                                                 result_pool, scratch_pool));
+    }
+  else
+    {
+      svn_fs_path_change_iterator_t *result;
+      filter_iterator_data_t *data = apr_pcalloc(result_pool, sizeof(*data));
+
+      SVN_ERR(svn_fs_paths_changed3(&data->all_changes, root, result_pool,
+                                    scratch_pool));
+      data->prefix = apr_pstrdup(result_pool, prefix);
+
+      result = apr_pcalloc(result_pool, sizeof(*result));
+      result->fsap_data = data;
+      result->vtable = &filter_iterator_vtable;
+
+      *iterator = result;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_check_path(svn_node_kind_t *kind_p, svn_fs_root_t *root,
                   const char *path, apr_pool_t *pool)
@@ -1543,6 +1607,23 @@ svn_fs_file_contents(svn_stream_t **contents, svn_fs_root_t *root,
                                                      pool));
 }
 
+svn_error_t *
+svn_fs__open_fulltext_file(apr_file_t **fulltext,
+                           svn_fs_root_t *root,
+                           const char *path,
+                           apr_pool_t *pool)
+{
+  /* Most backends don't store fulltexts as separate files. */
+  if (root->vtable->open_fulltext_file == NULL)
+    {
+      *fulltext = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(root->vtable->open_fulltext_file(fulltext, root,
+                                                          path, pool));
+}
+
 svn_error_t *
 svn_fs_try_process_file_contents(svn_boolean_t *success,
                                  svn_fs_root_t *root,
@@ -1640,6 +1721,49 @@ svn_fs_youngest_rev(svn_revnum_t *youngest_p, svn_fs_t *fs, apr_pool_t *pool)
   return svn_error_trace(fs->vtable->youngest_rev(youngest_p, fs, pool));
 }
 
+/* Bounds of the polling interval used by svn_fs__wait_for_youngest. */
+#define MIN_POLL_INTERVAL  (1000)
+#define MAX_POLL_INTERVAL  (100 * 1000)
+
+svn_error_t *
+svn_fs__wait_for_youngest(svn_revnum_t *youngest_p,
+                          svn_fs_t *fs,
+                          svn_revnum_t revision,
+                          apr_interval_time_t timeout,
+                          svn_cancel_func_t cancel_func,
+                          void *cancel_baton,
+                          apr_pool_t *scratch_pool)
+{
+  apr_time_t deadline = apr_time_now() + timeout;
+  apr_interval_time_t interval = MIN_POLL_INTERVAL;
+
+  while (TRUE)
+    {
+      apr_time_t now;
+
+      SVN_ERR(svn_fs_youngest_rev(youngest_p, fs, scratch_pool));
+      if (*youngest_p > revision)
+        break;
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      now = apr_time_now();
+      if (timeout >= 0)
+        {
+          if (now >= deadline)
+            break;
+          if (interval > deadline - now)
+            interval = deadline - now;
+        }
+
+      apr_sleep(interval);
+      interval = MIN(2 * interval, MAX_POLL_INTERVAL);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_info_format(int *fs_format,
                    svn_version_t **supports_version,
@@ -1705,6 +1829,46 @@ svn_fs_revision_proplist2(apr_hash_t **table_p,
                                                        scratch_pool));
 }
 
+svn_error_t *
+svn_fs_revision_proplists(svn_fs_t *fs,
+                          svn_revnum_t start,
+                          svn_revnum_t end,
+                          svn_boolean_t refresh,
+                          svn_fs_revision_proplist_receiver_t receiver,
+                          void *receiver_baton,
+                          apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool;
+  svn_revnum_t step = start <= end ? 1 : -1;
+  svn_revnum_t rev;
+
+  if (fs->vtable->revision_proplists)
+    return svn_error_trace(fs->vtable->revision_proplists(fs, start, end,
+                                                          refresh, receiver,
+                                                          receiver_baton,
+                                                          scratch_pool));
+
+  if (refresh)
+    SVN_ERR(svn_fs_refresh_revision_props(fs, scratch_pool));
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (rev = start; ; rev += step)
+    {
+      apr_hash_t *proplist;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(fs->vtable->revision_proplist(&proplist, fs, rev, FALSE,
+                                            iterpool, iterpool));
+      SVN_ERR(receiver(receiver_baton, rev, proplist, iterpool));
+
+      if (rev == end)
+        break;
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_change_rev_prop2(svn_fs_t *fs, svn_revnum_t rev, const char *name,
                         const svn_string_t *const *old_value_p,
@@ -207,6 +207,16 @@ typedef struct fs_vtable_t
                                     svn_boolean_t refresh,
                                     apr_pool_t *result_pool, 
                                     apr_pool_t *scratch_pool);
+  /* Optional.  svn_fs_revision_proplists falls back to revision_proplist
+     if this is NULL. */
+  svn_error_t *(*revision_proplists)(svn_fs_t *fs,
+                                     svn_revnum_t start,
+                                     svn_revnum_t end,
+                                     svn_boolean_t refresh,
+                                     svn_fs_revision_proplist_receiver_t
+                                       receiver,
+                                     void *receiver_baton,
+                                     apr_pool_t *scratch_pool);
   svn_error_t *(*change_rev_prop)(svn_fs_t *fs, svn_revnum_t rev,
                                   const char *name,
                                   const svn_string_t *const *old_value_p,
@@ -427,6 +437,19 @@ typedef struct root_vtable_t
                                 svn_fs_mergeinfo_receiver_t receiver,
                                 void *baton,
                                 apr_pool_t *scratch_pool);
+
+  /* Optional.  May be NULL. */
+  svn_error_t *(*open_fulltext_file)(apr_file_t **fulltext,
+                                     svn_fs_root_t *root,
+                                     const char *path,
+                                     apr_pool_t *pool);
+
+  /* Optional.  May be NULL.  PATH is a canonical fspath. */
+  svn_error_t *(*report_changes_under)(svn_fs_path_change_iterator_t **iterator,
+                                       svn_fs_root_t *root,
+                                       const char *path,
+                                       apr_pool_t *result_pool,
+                                       apr_pool_t *scratch_pool);
 } root_vtable_t;
 
 
@@ -0,0 +1,182 @@
+/*
+ * path-index.c:  building and querying the path index of a filesystem
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include <apr_pools.h>
+#include <apr_strings.h>
+
+#include "svn_types.h"
+#include "svn_error.h"
+#include "svn_hash.h"
+#include "svn_pools.h"
+#include "svn_fs.h"
+
+#include "svn_private_config.h"
+
+#include "fs-loader.h"
+
+#include "private/svn_fs_private.h"
+#include "private/svn_fs_util.h"
+
+/* Baton used while building the path index. */
+typedef struct build_baton_t
+{
+  svn_fs_t *fs;
+  svn_fs__path_index_builder_t *builder;
+
+  /* Next revision to add to BUILDER. */
+  svn_revnum_t next;
+
+  svn_fs_progress_notify_func_t notify_func;
+  void *notify_baton;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} build_baton_t;
+
+/* Set *CHANGED_PATHS to a hash containing the paths changed in REVISION
+ * of FS as keys.  Allocate the result in RESULT_POOL and use SCRATCH_POOL
+ * for temporaries. */
+static svn_error_t *
+get_changed_paths(apr_hash_t **changed_paths,
+                  svn_fs_t *fs,
+                  svn_revnum_t revision,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  svn_fs_root_t *root;
+  svn_fs_path_change_iterator_t *iterator;
+  svn_fs_path_change3_t *change;
+  apr_hash_t *result = apr_hash_make(result_pool);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, revision, scratch_pool));
+  SVN_ERR(svn_fs_paths_changed3(&iterator, root, scratch_pool,
+                                scratch_pool));
+
+  SVN_ERR(svn_fs_path_change_get(&change, iterator));
+  while (change)
+    {
+      svn_hash_sets(result, apr_pstrmemdup(result_pool, change->path.data,
+                                           change->path.len), "");
+      SVN_ERR(svn_fs_path_change_get(&change, iterator));
+    }
+
+  *changed_paths = result;
+  return SVN_NO_ERROR;
+}
+
+/* Add all revisions from BATON->NEXT up to and including YOUNGEST to
+ * BATON->BUILDER.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+add_revisions(build_baton_t *baton,
+              svn_revnum_t youngest,
+              apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  for (; baton->next <= youngest; ++baton->next)
+    {
+      apr_hash_t *changed_paths;
+
+      svn_pool_clear(iterpool);
+      if (baton->cancel_func)
+        SVN_ERR(baton->cancel_func(baton->cancel_baton));
+
+      SVN_ERR(get_changed_paths(&changed_paths, baton->fs, baton->next,
+                                iterpool, iterpool));
+      SVN_ERR(svn_fs__path_index_builder_add(baton->builder, baton->next,
+                                             changed_paths, iterpool));
+
+      if (baton->notify_func)
+        baton->notify_func(baton->next, baton->notify_baton, iterpool);
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_fs_freeze_func_t.  Add the revisions committed since
+ * we started and replace the old index with the new one. */
+static svn_error_t *
+finish_build(void *baton,
+             apr_pool_t *pool)
+{
+  build_baton_t *b = baton;
+  svn_revnum_t youngest;
+
+  SVN_ERR(svn_fs_youngest_rev(&youngest, b->fs, pool));
+  SVN_ERR(add_revisions(b, youngest, pool));
+
+  return svn_error_trace(svn_fs__path_index_builder_finish(b->builder,
+                                                           pool));
+}
+
+svn_error_t *
+svn_fs__get_path_revisions(apr_array_header_t **revisions,
+                           svn_fs_t *fs,
+                           const char *path,
+                           svn_revnum_t start,
+                           svn_revnum_t end,
+                           apr_pool_t *result_pool,
+                           apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(svn_fs__path_index_read(revisions, fs->path, path,
+                                                 start, end, result_pool,
+                                                 scratch_pool));
+}
+
+svn_error_t *
+svn_fs__build_path_index(svn_fs_t *fs,
+                         svn_fs_progress_notify_func_t notify_func,
+                         void *notify_baton,
+                         svn_cancel_func_t cancel_func,
+                         void *cancel_baton,
+                         apr_pool_t *scratch_pool)
+{
+  build_baton_t baton;
+  const char *fs_type;
+  svn_revnum_t youngest;
+
+  /* Only FSFS and FSX update the path index upon commit. */
+  SVN_ERR(svn_fs_type(&fs_type, fs->path, scratch_pool));
+  if (strcmp(fs_type, SVN_FS_TYPE_BDB) == 0)
+    return svn_error_createf(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                             _("Path index not supported for '%s' "
+                               "filesystems"), fs_type);
+
+  baton.fs = fs;
+  baton.next = 0;
+  baton.notify_func = notify_func;
+  baton.notify_baton = notify_baton;
+  baton.cancel_func = cancel_func;
+  baton.cancel_baton = cancel_baton;
+  SVN_ERR(svn_fs__path_index_builder_create(&baton.builder, fs->path,
+                                            scratch_pool, scratch_pool));
+
+  /* Index the bulk of the history without blocking commits. */
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs, scratch_pool));
+  SVN_ERR(add_revisions(&baton, youngest, scratch_pool));
+
+  return svn_error_trace(svn_fs_freeze(fs, finish_build, &baton,
+                                       scratch_pool));
+}
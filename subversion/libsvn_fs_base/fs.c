@@ -555,6 +555,7 @@ static fs_vtable_t fs_vtable = {
   base_bdb_refresh_revision,
   svn_fs_base__revision_prop,
   svn_fs_base__revision_proplist,
+  NULL /* revision_proplists */,
   svn_fs_base__change_rev_prop,
   svn_fs_base__set_uuid,
   svn_fs_base__revision_root,
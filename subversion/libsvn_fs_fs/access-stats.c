@@ -0,0 +1,291 @@
+/* access-stats.c --- sampled item access statistics for pack
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "svn_dirent_uri.h"
+#include "svn_pools.h"
+#include "svn_string.h"
+
+#include "access-stats.h"
+#include "util.h"
+#include "../libsvn_fs/fs-loader.h"
+
+#include "svn_private_config.h"
+
+/* Number of samples buffered per FS object before they get written. */
+#define SAMPLE_BUFFER_SIZE 64
+
+/* Per FS object sampling state. */
+struct svn_fs_fs__access_stats_t
+{
+  /* Number of item accesses seen so far. */
+  apr_uint64_t access_count;
+
+  /* Buffered samples; the first SAMPLE_COUNT are valid. */
+  svn_fs_fs__id_part_t samples[SAMPLE_BUFFER_SIZE];
+  int sample_count;
+};
+
+/* Implements apr_pool_cleanup_t.  Write the remaining samples of the
+   svn_fs_t at DATA before its pool goes away. */
+static apr_status_t
+flush_on_cleanup(void *data)
+{
+  svn_fs_t *fs = data;
+  apr_pool_t *scratch_pool = svn_pool_create(NULL);
+
+  svn_error_clear(svn_fs_fs__access_stats_flush(fs, scratch_pool));
+  svn_pool_destroy(scratch_pool);
+
+  return APR_SUCCESS;
+}
+
+void
+svn_fs_fs__access_stats_record(svn_fs_t *fs,
+                               svn_revnum_t revision,
+                               apr_uint64_t item_index,
+                               apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  struct svn_fs_fs__access_stats_t *stats = ffd->access_stats;
+  svn_fs_fs__id_part_t *sample;
+
+  if (   ffd->access_sample_rate <= 0
+      || ffd->max_files_per_dir == 0
+      || !SVN_IS_VALID_REVNUM(revision))
+    return;
+
+  if (!stats)
+    {
+      stats = apr_pcalloc(fs->pool, sizeof(*stats));
+      ffd->access_stats = stats;
+
+      /* Run before any other cleanup of FS->POOL. */
+      apr_pool_pre_cleanup_register(fs->pool, fs, flush_on_cleanup);
+    }
+
+  if (++stats->access_count % ffd->access_sample_rate)
+    return;
+
+  /* Packed shards don't benefit from statistics anymore. */
+  if (svn_fs_fs__is_packed_rev(fs, revision))
+    return;
+
+  sample = &stats->samples[stats->sample_count++];
+  sample->revision = revision;
+  sample->number = item_index;
+
+  if (stats->sample_count == SAMPLE_BUFFER_SIZE)
+    svn_error_clear(svn_fs_fs__access_stats_flush(fs, scratch_pool));
+}
+
+/* Implements the qsort comparison function, ordering svn_fs_fs__id_part_t
+   by revision. */
+static int
+compare_samples(const void *lhs,
+                const void *rhs)
+{
+  const svn_fs_fs__id_part_t *lhs_sample = lhs;
+  const svn_fs_fs__id_part_t *rhs_sample = rhs;
+
+  if (lhs_sample->revision == rhs_sample->revision)
+    return 0;
+
+  return lhs_sample->revision < rhs_sample->revision ? -1 : 1;
+}
+
+/* Append DATA to the statistics file in SHARD_DIR.  Use SCRATCH_POOL for
+   temporary allocations. */
+static svn_error_t *
+append_samples(const char *shard_dir,
+               const svn_stringbuf_t *data,
+               apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+
+  /* The shard may have been packed since we took the sample. */
+  svn_error_t *err = svn_io_file_open(&file,
+                                      svn_dirent_join(shard_dir,
+                                                      PATH_ACCESS_STATS,
+                                                      scratch_pool),
+                                      APR_WRITE | APR_CREATE | APR_APPEND,
+                                      APR_OS_DEFAULT, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  /* Being a single write, this won't interleave with other writers. */
+  SVN_ERR(svn_io_file_write_full(file, data->data, data->len, NULL,
+                                 scratch_pool));
+
+  return svn_error_trace(svn_io_file_close(file, scratch_pool));
+}
+
+svn_error_t *
+svn_fs_fs__access_stats_flush(svn_fs_t *fs,
+                              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  struct svn_fs_fs__access_stats_t *stats = ffd->access_stats;
+  svn_stringbuf_t *data;
+  apr_pool_t *iterpool;
+  int count, first, i;
+
+  if (!stats || !stats->sample_count)
+    return SVN_NO_ERROR;
+
+  /* Drop the samples even if we fail to write them. */
+  count = stats->sample_count;
+  stats->sample_count = 0;
+
+  qsort(stats->samples, count, sizeof(stats->samples[0]), compare_samples);
+
+  data = svn_stringbuf_create_empty(scratch_pool);
+  iterpool = svn_pool_create(scratch_pool);
+  for (first = 0; first < count; first = i)
+    {
+      svn_revnum_t shard
+        = stats->samples[first].revision / ffd->max_files_per_dir;
+
+      svn_pool_clear(iterpool);
+      svn_stringbuf_setempty(data);
+
+      for (i = first; i < count; ++i)
+        {
+          const svn_fs_fs__id_part_t *sample = &stats->samples[i];
+          if (sample->revision / ffd->max_files_per_dir != shard)
+            break;
+
+          svn_stringbuf_appendcstr(data,
+                                   apr_psprintf(iterpool,
+                                                "%ld %" APR_UINT64_T_FMT "\n",
+                                                sample->revision,
+                                                sample->number));
+        }
+
+      SVN_ERR(append_samples(svn_fs_fs__path_rev_shard(fs,
+                                                       stats->samples[first]
+                                                                  .revision,
+                                                       iterpool),
+                             data, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__access_stats_read(apr_hash_t **counts,
+                             const char *shard_dir,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *content;
+  char *line, *end;
+  svn_error_t *err;
+
+  *counts = apr_hash_make(result_pool);
+
+  err = svn_stringbuf_from_file2(&content,
+                                 svn_dirent_join(shard_dir,
+                                                 PATH_ACCESS_STATS,
+                                                 scratch_pool),
+                                 scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  end = content->data + content->len;
+  for (line = content->data; line < end; )
+    {
+      char *eol = memchr(line, '\n', end - line);
+      char *space;
+      apr_uint64_t revision, item_index;
+      svn_fs_fs__id_part_t key;
+      int *count;
+
+      /* Ignore incomplete records, e.g. from a concurrent writer. */
+      if (!eol)
+        break;
+
+      *eol = '\0';
+      space = strchr(line, ' ');
+      if (space)
+        {
+          *space = '\0';
+          err = svn_cstring_strtoui64(&revision, line, 0, APR_INT32_MAX, 10);
+          if (!err)
+            err = svn_cstring_strtoui64(&item_index, space + 1, 0,
+                                        APR_UINT64_MAX, 10);
+
+          if (err)
+            {
+              svn_error_clear(err);
+            }
+          else
+            {
+              memset(&key, 0, sizeof(key));
+              key.revision = (svn_revnum_t)revision;
+              key.number = item_index;
+
+              count = apr_hash_get(*counts, &key, sizeof(key));
+              if (!count)
+                {
+                  count = apr_pcalloc(result_pool, sizeof(*count));
+                  apr_hash_set(*counts,
+                               apr_pmemdup(result_pool, &key, sizeof(key)),
+                               sizeof(key), count);
+                }
+
+              ++*count;
+            }
+        }
+
+      line = eol + 1;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+int
+svn_fs_fs__access_stats_count(apr_hash_t *counts,
+                              svn_revnum_t revision,
+                              apr_uint64_t item_index)
+{
+  svn_fs_fs__id_part_t key;
+  int *count;
+
+  memset(&key, 0, sizeof(key));
+  key.revision = revision;
+  key.number = item_index;
+
+  count = apr_hash_get(counts, &key, sizeof(key));
+  return count ? *count : 0;
+}
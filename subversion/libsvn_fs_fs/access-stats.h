@@ -0,0 +1,81 @@
+/* access-stats.h : sampled item access statistics for pack
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS_FS_ACCESS_STATS_H
+#define SVN_LIBSVN_FS_FS_ACCESS_STATS_H
+
+#include "svn_error.h"
+
+#include "fs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* If enabled in fsfs.conf, every Nth item read from a non-packed revision
+ * gets recorded.  The samples are buffered per FS object and appended to
+ * a PATH_ACCESS_STATS file in the respective shard directory, one
+ * "<revision> <item index>\n" line per sample.  Once the shard is being
+ * packed, these statistics allow us to place frequently read items next
+ * to each other.  The file goes away together with the non-packed shard.
+ *
+ * The statistics are purely advisory.  Failure to write them is not an
+ * error and malformed lines will be ignored when reading them.
+ */
+
+/* Record an access to item ITEM_INDEX in REVISION of FS, if FS samples
+   item accesses and this access has been selected.  Use SCRATCH_POOL
+   for temporary allocations. */
+void
+svn_fs_fs__access_stats_record(svn_fs_t *fs,
+                               svn_revnum_t revision,
+                               apr_uint64_t item_index,
+                               apr_pool_t *scratch_pool);
+
+/* Append all samples that have been buffered for FS to the respective
+   statistics files.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__access_stats_flush(svn_fs_t *fs,
+                              apr_pool_t *scratch_pool);
+
+/* Read the access statistics for the non-packed shard in SHARD_DIR and
+   return them in *COUNTS, mapping svn_fs_fs__id_part_t to int.  If there
+   are no statistics, return an empty hash.  Allocate the result in
+   RESULT_POOL and use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__access_stats_read(apr_hash_t **counts,
+                             const char *shard_dir,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool);
+
+/* Return the number of sampled accesses to item ITEM_INDEX in REVISION
+   according to COUNTS as returned by svn_fs_fs__access_stats_read. */
+int
+svn_fs_fs__access_stats_count(apr_hash_t *counts,
+                              svn_revnum_t revision,
+                              apr_uint64_t item_index);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_FS_FS_ACCESS_STATS_H */
@@ -32,11 +32,14 @@
 #include "private/svn_sorts_private.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_temp_serializer.h"
+#include "private/svn_trace.h"
 
+#include "access-stats.h"
 #include "fs_fs.h"
 #include "id.h"
 #include "index.h"
 #include "low_level.h"
+#include "noderev-log.h"
 #include "pack.h"
 #include "util.h"
 #include "temp_serializer.h"
@@ -46,6 +49,14 @@
 
 #include "svn_private_config.h"
 
+/* Trace probes timing noderev lookups (cached or not), block reads and
+   the parsing of delta windows read from disk, plus a counter for the
+   delta windows served from cache. */
+SVN_TRACE__PROBE(get_node_revision_probe, "fsfs.get_node_revision");
+SVN_TRACE__PROBE(block_read_probe, "fsfs.block_read");
+SVN_TRACE__PROBE(read_window_probe, "fsfs.read_delta_window");
+SVN_TRACE__PROBE(cached_window_probe, "fsfs.cached_delta_window");
+
 /* forward-declare. See implementation for the docstring */
 static svn_error_t *
 block_read(void **result,
@@ -68,6 +79,8 @@ block_read(void **result,
  * Use SCRATCH_POOL for temporary allocations.
  *
  * For pre-format7 repos, the display will be restricted.
+ *
+ * Independently of that, feed the access statistics for pack.
  */
 static svn_error_t *
 dbg_log_access(svn_fs_t *fs,
@@ -77,6 +90,8 @@ dbg_log_access(svn_fs_t *fs,
                apr_uint32_t item_type,
                apr_pool_t *scratch_pool)
 {
+  svn_fs_fs__access_stats_record(fs, revision, item_index, scratch_pool);
+
   /* no-op if this macro is not defined */
 #ifdef SVN_FS_FS__LOG_ACCESS
   fs_fs_data_t *ffd = fs->fsap_data;
@@ -417,9 +432,22 @@ get_node_revision_body(node_revision_t **noderev_p,
   if (svn_fs_fs__id_is_txn(id))
     {
       apr_file_t *file;
+      svn_fs_fs__noderev_log_t *log;
 
       /* This is a transaction node-rev.  Its storage logic is very
          different from that of rev / pack files. */
+      SVN_ERR(svn_fs_fs__noderev_log_get(&log, fs, svn_fs_fs__id_txn_id(id),
+                                         scratch_pool));
+      if (log)
+        {
+          SVN_ERR(svn_fs_fs__noderev_log_read(noderev_p, log, id,
+                                              result_pool, scratch_pool));
+          if (*noderev_p == NULL)
+            return svn_error_trace(err_dangling_id(fs, id));
+
+          return SVN_NO_ERROR;
+        }
+
       err = svn_io_file_open(&file,
                              svn_fs_fs__path_txn_node_rev(fs, id,
                              scratch_pool),
@@ -512,9 +540,12 @@ svn_fs_fs__get_node_revision(node_revision_t **noderev_p,
                              apr_pool_t *scratch_pool)
 {
   const svn_fs_fs__id_part_t *rev_item = svn_fs_fs__id_rev_item(id);
+  apr_time_t trace_start = SVN_TRACE__SPAN_START();
 
   svn_error_t *err = get_node_revision_body(noderev_p, fs, id,
                                             result_pool, scratch_pool);
+  SVN_TRACE__SPAN_END(get_node_revision_probe, trace_start);
+
   if (err && err->apr_err == SVN_ERR_FS_CORRUPT)
     {
       svn_string_t *id_string = svn_fs_fs__id_unparse(id, scratch_pool);
@@ -744,6 +775,9 @@ typedef struct rep_state_t
   int ver;          /* If a delta, what svndiff version?
                        -1 for unknown delta version. */
   int chunk_index;  /* number of the window to read */
+                    /* TRUE if HEADER_SIZE and SIZE describe the rep as
+                       stored in a pack file. */
+  svn_boolean_t is_packed;
 } rep_state_t;
 
 /* Simple wrapper around svn_io_file_get_offset to simplify callers. */
@@ -826,6 +860,62 @@ auto_read_diff_version(rep_state_t *rs, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Packing may re-encode delta representations (see pack-compression in
+ * fsfs.conf), i.e. their headers and windows may differ from what they
+ * were before.  Return the revision number to use in rep header and window
+ * cache keys for representations in REVISION, keeping the data read from
+ * pack files (IS_PACKED) and from non-packed rev files apart. */
+static apr_int64_t
+get_rep_key_revision(svn_revnum_t revision,
+                     svn_boolean_t is_packed)
+{
+  if (SVN_IS_VALID_REVNUM(revision) && is_packed)
+    return -2 - (apr_int64_t)revision;
+
+  return revision;
+}
+
+/* Open RS->SFILE, if that hasn't been done yet, and make sure that the
+ * header info in RS matches the file actually opened.  Our idea of the
+ * min-unpacked-rev may have been outdated when we took the rep header from
+ * the cache.  The revision may have been packed and its rep re-encoded
+ * since.  In that case, continue from the start of the rep in the pack
+ * file.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+auto_open_rep_file(rep_state_t *rs,
+                   apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__rep_header_t *rh;
+  apr_off_t offset;
+
+  SVN_ERR(auto_open_shared_file(rs->sfile));
+  if (   rs->is_packed
+      || !rs->sfile->rfile->is_packed
+      || !SVN_IS_VALID_REVNUM(rs->revision))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_fs__item_offset(&offset, rs->sfile->fs, rs->sfile->rfile,
+                                 rs->revision, NULL, rs->item_index,
+                                 scratch_pool));
+  SVN_ERR(rs_aligned_seek(rs, NULL, offset, scratch_pool));
+  SVN_ERR(svn_fs_fs__read_rep_header(&rh, rs->sfile->rfile->stream,
+                                     scratch_pool, scratch_pool));
+
+  /* Non-packed revisions never contain RDELTA headers, so SIZE is still
+   * the nominal size of the rep. */
+  rs->header_size = rh->header_size;
+  if (rh->data_size)
+    rs->size = rh->data_size;
+
+  rs->start = -1;
+  rs->current = 0;
+  rs->ver = -1;
+  rs->chunk_index = 0;
+  rs->is_packed = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
 /* See create_rep_state, which wraps this and adds another error. */
 static svn_error_t *
 create_rep_state_body(rep_state_t **rep_state,
@@ -859,7 +949,9 @@ create_rep_state_body(rep_state_t **rep_state,
           == (rep->revision / ffd->max_files_per_dir));
 
   pair_cache_key_t key;
-  key.revision = rep->revision;
+  rs->is_packed = SVN_IS_VALID_REVNUM(rep->revision)
+               && svn_fs_fs__is_packed_rev(fs, rep->revision);
+  key.revision = get_rep_key_revision(rep->revision, rs->is_packed);
   key.second = rep->item_index;
 
   /* continue constructing RS and RA */
@@ -943,6 +1035,11 @@ create_rep_state_body(rep_state_t **rep_state,
                                          result_pool, scratch_pool));
       SVN_ERR(get_file_offset(&rs->start, rs, result_pool));
 
+      /* Opening the file may have told us that the revision got packed
+       * in the meantime.  Key the header by the file it came from. */
+      rs->is_packed = rs->sfile->rfile->is_packed;
+      key.revision = get_rep_key_revision(rep->revision, rs->is_packed);
+
       /* populate the cache if appropriate */
       if (! svn_fs_fs__id_txn_used(&rep->txn_id))
         {
@@ -961,6 +1058,9 @@ create_rep_state_body(rep_state_t **rep_state,
                          SVN_FS_FS__ITEM_TYPE_ANY_REP, scratch_pool));
 
   rs->header_size = rh->header_size;
+  if (rh->data_size)
+    rs->size = rh->data_size;
+
   *rep_state = rs;
   *rep_header = rh;
 
@@ -1235,7 +1335,7 @@ static window_cache_key_t *
 get_window_key(window_cache_key_t *key, rep_state_t *rs)
 {
   assert(rs->revision <= APR_UINT32_MAX);
-  key->revision = (apr_uint32_t)rs->revision;
+  key->revision = get_rep_key_revision(rs->revision, rs->is_packed);
   key->item_index = rs->item_index;
   key->chunk_index = rs->chunk_index;
 
@@ -1553,6 +1653,7 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   apr_off_t start_offset;
   apr_off_t end_offset;
   apr_pool_t *iterpool;
+  apr_time_t trace_start;
 
   SVN_ERR_ASSERT(rs->chunk_index <= this_chunk);
 
@@ -1563,10 +1664,13 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   SVN_ERR(get_cached_window(nwin, rs, this_chunk, &is_cached,
                             result_pool, scratch_pool));
   if (is_cached)
-    return SVN_NO_ERROR;
+    {
+      SVN_TRACE__COUNT(cached_window_probe, 1);
+      return SVN_NO_ERROR;
+    }
 
   /* someone has to actually read the data from file.  Open it */
-  SVN_ERR(auto_open_shared_file(rs->sfile));
+  SVN_ERR(auto_open_rep_file(rs, scratch_pool));
 
   /* invoke the 'block-read' feature for non-txn data.
      However, don't do that if we are in the middle of some representation,
@@ -1576,8 +1680,10 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
       && use_block_read(rs->sfile->fs)
       && rs->raw_window_cache)
     {
+      trace_start = SVN_TRACE__SPAN_START();
       SVN_ERR(block_read(NULL, rs->sfile->fs, rs->revision, rs->item_index,
                          rs->sfile->rfile, result_pool, scratch_pool));
+      SVN_TRACE__SPAN_END(block_read_probe, trace_start);
 
       /* reading the whole block probably also provided us with the
          desired txdelta window */
@@ -1616,8 +1722,10 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   svn_pool_destroy(iterpool);
 
   /* Actually read the next window. */
+  trace_start = SVN_TRACE__SPAN_START();
   SVN_ERR(svn_txdelta_read_svndiff_window(nwin, rs->sfile->rfile->stream,
                                           rs->ver, result_pool));
+  SVN_TRACE__SPAN_END(read_window_probe, trace_start);
   SVN_ERR(get_file_offset(&end_offset, rs, scratch_pool));
   rs->current = end_offset - rs->start;
   if (rs->current > rs->size)
@@ -2728,6 +2836,68 @@ get_txn_dir_info(svn_filesize_t *filesize,
   return SVN_NO_ERROR;
 }
 
+/* Read the expanded contents of the committed directory NODEREV in FS
+ * into *TEXT.  Sorted directories get indexed.  Allocate the result in POOL.
+ */
+static svn_error_t *
+read_dir_text(svn_stringbuf_t **text,
+              svn_fs_t *fs,
+              node_revision_t *noderev,
+              apr_pool_t *pool)
+{
+  svn_stream_t *contents;
+
+  /* Undeltify content before parsing it. Otherwise, we could only
+   * parse it byte-by-byte.
+   */
+  SVN_ERR(svn_fs_fs__get_contents(&contents, fs, noderev->data_rep,
+                                  FALSE, pool));
+  SVN_ERR(svn_stringbuf_from_stream(text, contents,
+                                    noderev->data_rep->expanded_size, pool));
+  SVN_ERR(svn_stream_close(contents));
+
+  /* Sorted directories store entry lengths on disk.  All in-memory copies,
+   * including the cached ones, use entry offsets instead. */
+  if (svn_fs_fs__is_sorted_dir((*text)->data, (*text)->len))
+    SVN_ERR_W(svn_fs_fs__index_sorted_dir((*text)->data, (*text)->len),
+              apr_psprintf(pool,
+                           _("Directory representation corrupt in '%s'"),
+                           svn_fs_fs__id_unparse(noderev->id, pool)->data));
+
+  return SVN_NO_ERROR;
+}
+
+/* Into *ENTRIES_P, parse all directory entries from the expanded contents
+ * TEXT of a committed directory representation, which may be in either
+ * hash dump or sorted format.  ID is provided for nicer error messages.
+ */
+static svn_error_t *
+parse_dir_text(apr_array_header_t **entries_p,
+               svn_stringbuf_t *text,
+               const svn_fs_id_t *id,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  svn_stream_t *contents;
+
+  if (svn_fs_fs__is_sorted_dir(text->data, text->len))
+    {
+      SVN_ERR_W(svn_fs_fs__read_sorted_dir(entries_p, text->data, text->len,
+                                           result_pool),
+                apr_psprintf(scratch_pool,
+                             _("Directory representation corrupt in '%s'"),
+                             svn_fs_fs__id_unparse(id, scratch_pool)->data));
+      return SVN_NO_ERROR;
+    }
+
+  /* de-serialize hash */
+  contents = svn_stream_from_stringbuf(text, scratch_pool);
+  SVN_ERR(read_dir_entries(entries_p, contents, FALSE, id,
+                           result_pool, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Fetch the contents of a directory into DIR.  Values are stored
    as filename to string mappings; further conversion is necessary to
    convert them into svn_fs_dirent_t values. */
@@ -2769,22 +2939,26 @@ get_dir_contents(svn_fs_fs__dir_data_t *dir,
     }
   else if (noderev->data_rep)
     {
-      /* Undeltify content before parsing it. Otherwise, we could only
-       * parse it byte-by-byte.
-       */
-      apr_size_t len = noderev->data_rep->expanded_size;
+      fs_fs_data_t *ffd = fs->fsap_data;
       svn_stringbuf_t *text;
+      svn_boolean_t found = FALSE;
 
-      /* The representation is immutable.  Read it normally. */
-      SVN_ERR(svn_fs_fs__get_contents(&contents, fs, noderev->data_rep,
-                                      FALSE, scratch_pool));
-      SVN_ERR(svn_stringbuf_from_stream(&text, contents, len, scratch_pool));
-      SVN_ERR(svn_stream_close(contents));
+      /* Sorted directories may be cached in their compact form. */
+      if (ffd->sorted_dir_cache)
+        {
+          pair_cache_key_t key = { 0 };
+          key.revision = noderev->data_rep->revision;
+          key.second = noderev->data_rep->item_index;
 
-      /* de-serialize hash */
-      contents = svn_stream_from_stringbuf(text, scratch_pool);
-      SVN_ERR(read_dir_entries(&dir->entries, contents, FALSE, noderev->id,
-                               result_pool, scratch_pool));
+          SVN_ERR(svn_cache__get((void **)&text, &found,
+                                 ffd->sorted_dir_cache, &key, scratch_pool));
+        }
+
+      if (!found)
+        SVN_ERR(read_dir_text(&text, fs, noderev, scratch_pool));
+
+      SVN_ERR(parse_dir_text(&dir->entries, text, noderev->id, result_pool,
+                             scratch_pool));
     }
   else
     {
@@ -2896,6 +3070,83 @@ svn_fs_fs__find_dir_entry(apr_array_header_t *entries,
   return result ? *result : NULL;
 }
 
+/* Implements svn_cache__partial_getter_func_t for the sorted directory
+ * cache.  BATON is the name of the entry to find.
+ */
+static svn_error_t *
+extract_sorted_dir_entry(void **out,
+                         const void *data,
+                         apr_size_t data_len,
+                         void *baton,
+                         apr_pool_t *pool)
+{
+  return svn_error_trace(svn_fs_fs__find_sorted_dir_entry(
+                           (svn_fs_dirent_t **)out, data, data_len,
+                           baton, pool));
+}
+
+/* Look up the entry NAME in the committed directory NODEREV in FS and
+ * return it in *DIRENT, if that directory is stored in the sorted format.
+ * Set *FOUND to TRUE in that case, even if there is no such entry.
+ *
+ * Otherwise, set *FOUND to FALSE and, if the expanded directory contents
+ * had to be read, return it in *TEXT such that callers don't need to read
+ * it again.  Set *TEXT to NULL if not.  Allocate *DIRENT in RESULT_POOL
+ * and *TEXT in SCRATCH_POOL.
+ */
+static svn_error_t *
+find_sorted_dir_entry(svn_boolean_t *found,
+                      svn_fs_dirent_t **dirent,
+                      svn_stringbuf_t **text,
+                      svn_fs_t *fs,
+                      node_revision_t *noderev,
+                      const char *name,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  pair_cache_key_t key = { 0 };
+
+  key.revision = noderev->data_rep->revision;
+  key.second = noderev->data_rep->item_index;
+  *text = NULL;
+
+  /* Bisect the compact form without deserializing it. */
+  if (ffd->sorted_dir_cache)
+    {
+      SVN_ERR(svn_cache__get_partial((void **)dirent, found,
+                                     ffd->sorted_dir_cache, &key,
+                                     extract_sorted_dir_entry,
+                                     (void *)name, result_pool));
+      if (*found)
+        return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(read_dir_text(text, fs, noderev, scratch_pool));
+  if (!svn_fs_fs__is_sorted_dir((*text)->data, (*text)->len))
+    {
+      *found = FALSE;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR_W(svn_fs_fs__find_sorted_dir_entry(dirent, (*text)->data,
+                                             (*text)->len, name,
+                                             result_pool),
+            apr_psprintf(scratch_pool,
+                         _("Directory representation corrupt in '%s'"),
+                         svn_fs_fs__id_unparse(noderev->id,
+                                               scratch_pool)->data));
+
+  /* The compact form is much smaller than the deserialized listing. */
+  if (ffd->sorted_dir_cache
+      && svn_cache__is_cachable(ffd->sorted_dir_cache, (*text)->len + 1))
+    SVN_ERR(svn_cache__set(ffd->sorted_dir_cache, &key, *text,
+                           scratch_pool));
+
+  *found = TRUE;
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__rep_contents_dir_entry(svn_fs_dirent_t **dirent,
                                   svn_fs_t *fs,
@@ -2932,13 +3183,36 @@ svn_fs_fs__rep_contents_dir_entry(svn_fs_dirent_t **dirent,
   /* fetch data from disk if we did not find it in the cache */
   if (! found || baton.out_of_date)
     {
+      fs_fs_data_t *ffd = fs->fsap_data;
       svn_fs_dirent_t *entry;
       svn_fs_dirent_t *entry_copy = NULL;
       svn_fs_fs__dir_data_t dir;
+      svn_stringbuf_t *text = NULL;
+
+      /* Committed directories in the sorted format don't need to be
+       * parsed as a whole. */
+      if (   ffd->format >= SVN_FS_FS__MIN_SORTED_DIR_FORMAT
+          && noderev->data_rep
+          && !svn_fs_fs__id_txn_used(&noderev->data_rep->txn_id))
+        {
+          SVN_ERR(find_sorted_dir_entry(&found, dirent, &text, fs, noderev,
+                                        name, result_pool, scratch_pool));
+          if (found)
+            return SVN_NO_ERROR;
+        }
 
       /* Read in the directory contents. */
-      SVN_ERR(get_dir_contents(&dir, fs, noderev, scratch_pool,
-                               scratch_pool));
+      if (text)
+        {
+          dir.txn_filesize = SVN_INVALID_FILESIZE;
+          SVN_ERR(parse_dir_text(&dir.entries, text, noderev->id,
+                                 scratch_pool, scratch_pool));
+        }
+      else
+        {
+          SVN_ERR(get_dir_contents(&dir, fs, noderev, scratch_pool,
+                                   scratch_pool));
+        }
 
       /* Update the cache, if we are to use one.
        *
@@ -3233,6 +3507,7 @@ init_rep_state(rep_state_t *rs,
   rs->raw_window_cache = ffd->raw_window_cache;
   rs->window_cache = ffd->txdelta_window_cache;
   rs->combined_cache = ffd->combined_window_cache;
+  rs->is_packed = file->is_packed;
 
   return SVN_NO_ERROR;
 }
@@ -3485,7 +3760,8 @@ block_read_contents(svn_fs_t *fs,
   pair_cache_key_t header_key = { 0 };
   svn_fs_fs__rep_header_t *rep_header;
 
-  header_key.revision = (apr_int32_t)entry->item.revision;
+  header_key.revision = get_rep_key_revision(entry->item.revision,
+                                             rev_file->is_packed);
   header_key.second = entry->item.number;
 
   SVN_ERR(read_rep_header(&rep_header, fs, rev_file->stream, &header_key,
@@ -3658,6 +3934,39 @@ block_read_noderev(node_revision_t **noderev_p,
   return SVN_NO_ERROR;
 }
 
+/* If read-ahead has been enabled for FS, advise the OS to fetch the block
+ * starting at BLOCK_START in REV_FILE together with the configured number
+ * of blocks following it in the background.  Don't read past the revision
+ * data and don't request the same range twice in a row.
+ */
+static void
+prefetch_blocks(svn_fs_t *fs,
+                svn_fs_fs__revision_file_t *rev_file,
+                apr_off_t block_start)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_off_t window = (1 + ffd->block_read_ahead) * ffd->block_size;
+  apr_off_t end = block_start + window;
+
+  if (ffd->block_read_ahead == 0)
+    return;
+
+  /* Still within the range covered by the previous read-ahead? */
+  if (   block_start < rev_file->prefetch_end
+      && block_start >= rev_file->prefetch_end - window)
+    return;
+
+  /* The indexes are being read through their own buffers. */
+  if (rev_file->l2p_offset >= 0)
+    end = MIN(end, rev_file->l2p_offset);
+
+  /* Only remember ranges that the OS actually accepted. */
+  if (   end > block_start
+      && svn_io__file_prefetch(rev_file->file, block_start,
+                               end - block_start))
+    rev_file->prefetch_end = end;
+}
+
 /* Read the whole (e.g. 64kB) block containing ITEM_INDEX of REVISION in FS
  * and put all data into cache.  If necessary and depending on heuristics,
  * neighboring blocks may also get read.  The data is being read from
@@ -3701,6 +4010,9 @@ block_read(void **result,
 
   offset = wanted_offset;
 
+  /* Let the OS fetch this block and the next few ones, if enabled. */
+  prefetch_blocks(fs, revision_file, offset - (offset % ffd->block_size));
+
   /* Heuristics:
    *
    * Read this block.  If the last item crosses the block boundary, read
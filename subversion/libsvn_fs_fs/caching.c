@@ -453,6 +453,21 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                        no_handler,
                        fs->pool, pool));
 
+  /* Compact form of directories stored in the sorted format.  Values are
+     svn_stringbuf_t.  Only used for single-entry lookups. */
+  SVN_ERR(create_cache(&(ffd->sorted_dir_cache),
+                       NULL,
+                       membuffer,
+                       0, 0, /* Do not use the inprocess cache */
+                       NULL, NULL,
+                       sizeof(pair_cache_key_t),
+                       apr_pstrcat(pool, prefix, "SDIR", SVN_VA_NULL),
+                       SVN_CACHE__MEMBUFFER_HIGH_PRIORITY,
+                       has_namespace,
+                       fs,
+                       no_handler,
+                       fs->pool, pool));
+
   /* 8 kBytes per entry (1000 revs / shared, one file offset per rev).
      Covering about 8 pack files gives us an "o.k." hit rate. */
   SVN_ERR(create_cache(&(ffd->packed_offset_cache),
@@ -119,10 +119,17 @@ fs_serialized_init(svn_fs_t *fs, apr_pool_t *common_pool, apr_pool_t *pool)
       SVN_ERR(svn_mutex__init(&ffsd->txn_current_lock,
                               SVN_FS_FS__USE_LOCK_MUTEX, common_pool));
 
+      /* ... and the rep-index. */
+      SVN_ERR(svn_mutex__init(&ffsd->rep_index_lock,
+                              SVN_FS_FS__USE_LOCK_MUTEX, common_pool));
+
       /* We also need a mutex for synchronizing access to the active
          transaction list and free transaction pointer. */
       SVN_ERR(svn_mutex__init(&ffsd->txn_list_lock, TRUE, common_pool));
 
+      /* The similarity index is purely in-process as well. */
+      SVN_ERR(svn_mutex__init(&ffsd->similarity_lock, TRUE, common_pool));
+
       key = apr_pstrdup(common_pool, key);
       status = apr_pool_userdata_set(ffsd, key, NULL, common_pool);
       if (status)
@@ -261,6 +268,7 @@ static fs_vtable_t fs_vtable = {
   fs_refresh_revprops,
   svn_fs_fs__revision_prop,
   svn_fs_fs__get_revision_proplist,
+  svn_fs_fs__get_revision_proplists,
   svn_fs_fs__change_rev_prop,
   fs_set_uuid,
   svn_fs_fs__revision_root,
@@ -64,6 +64,10 @@ extern "C" {
 #define PATH_TXN_CURRENT      "txn-current"      /* File with next txn key */
 #define PATH_TXN_CURRENT_LOCK "txn-current-lock" /* Lock for txn-current */
 #define PATH_LOCKS_DIR        "locks"            /* Directory of locks */
+#define PATH_REP_INDEX_DIR    "rep-index"        /* Rep-sharing hash index */
+#define PATH_REP_INDEX_LOCK   "rep-index-lock"   /* Lock for rep-index */
+#define PATH_YOUNGEST         "youngest"         /* Memory-mapped copy of
+                                                    the youngest revision */
 #define PATH_MIN_UNPACKED_REV "min-unpacked-rev" /* Oldest revision which
                                                     has not been packed. */
 #define PATH_REVPROP_GENERATION "revprop-generation"
@@ -76,6 +80,8 @@ extern "C" {
                                                     to-phys index */
 #define PATH_EXT_P2L_INDEX    ".p2l"             /* extension of the phys-
                                                     to-log index */
+#define PATH_ACCESS_STATS     "access-stats"     /* Sampled item accesses
+                                                    per non-packed shard */
 /* If you change this, look at tests/svn_test_fs.c(maybe_install_fsfs_conf) */
 #define PATH_CONFIG           "fsfs.conf"        /* Configuration */
 
@@ -92,6 +98,7 @@ extern "C" {
 #define PATH_TXN_ITEM_INDEX "itemidx"      /* File containing the current item
                                               index number */
 #define PATH_INDEX          "index"        /* name of index files w/o ext */
+#define PATH_NODE_REVS      "node-revs"    /* Log of all node-revisions */
 
 /* Names of files in legacy FS formats */
 #define PATH_REV           "rev"           /* Proto rev file */
@@ -102,12 +109,15 @@ extern "C" {
 #define CONFIG_OPTION_FAIL_STOP          "fail-stop"
 #define CONFIG_SECTION_REP_SHARING       "rep-sharing"
 #define CONFIG_OPTION_ENABLE_REP_SHARING "enable-rep-sharing"
+#define CONFIG_OPTION_ENABLE_REP_CACHE_INDEX "enable-rep-cache-index"
 #define CONFIG_SECTION_DELTIFICATION     "deltification"
 #define CONFIG_OPTION_ENABLE_DIR_DELTIFICATION   "enable-dir-deltification"
 #define CONFIG_OPTION_ENABLE_PROPS_DELTIFICATION "enable-props-deltification"
 #define CONFIG_OPTION_MAX_DELTIFICATION_WALK     "max-deltification-walk"
 #define CONFIG_OPTION_MAX_LINEAR_DELTIFICATION   "max-linear-deltification"
+#define CONFIG_OPTION_ENABLE_SIMILARITY_DELTIFICATION "enable-similarity-deltification"
 #define CONFIG_OPTION_COMPRESSION_LEVEL  "compression-level"
+#define CONFIG_OPTION_PACK_COMPRESSION   "pack-compression"
 #define CONFIG_SECTION_PACKED_REVPROPS   "packed-revprops"
 #define CONFIG_OPTION_REVPROP_PACK_SIZE  "revprop-pack-size"
 #define CONFIG_OPTION_COMPRESS_PACKED_REVPROPS  "compress-packed-revprops"
@@ -115,6 +125,12 @@ extern "C" {
 #define CONFIG_OPTION_BLOCK_SIZE         "block-size"
 #define CONFIG_OPTION_L2P_PAGE_SIZE      "l2p-page-size"
 #define CONFIG_OPTION_P2L_PAGE_SIZE      "p2l-page-size"
+#define CONFIG_OPTION_BLOCK_READ_AHEAD   "block-read-ahead"
+#define CONFIG_OPTION_ACCESS_SAMPLE_RATE "access-sample-rate"
+#define CONFIG_OPTION_MMAP_YOUNGEST      "mmap-youngest"
+#define CONFIG_OPTION_TXN_NODEREV_LOG    "txn-noderev-log"
+#define CONFIG_SECTION_LOCKS             "locks"
+#define CONFIG_OPTION_ENABLE_LOCK_INDEX  "enable-lock-index"
 #define CONFIG_SECTION_DEBUG             "debug"
 #define CONFIG_OPTION_PACK_AFTER_COMMIT  "pack-after-commit"
 #define CONFIG_OPTION_VERIFY_BEFORE_COMMIT "verify-before-commit"
@@ -127,7 +143,7 @@ extern "C" {
    Note: If you bump this, please update the switch statement in
          svn_fs_fs__create() as well.
  */
-#define SVN_FS_FS__FORMAT_NUMBER   8
+#define SVN_FS_FS__FORMAT_NUMBER   9
 
 /* The minimum format number that supports svndiff version 1.  */
 #define SVN_FS_FS__MIN_SVNDIFF1_FORMAT 2
@@ -200,6 +216,22 @@ extern "C" {
     database. */
 #define SVN_FS_FS__MIN_REP_CACHE_SCHEMA_V2_FORMAT 8
 
+/* The minimum format number that stores directories using the sorted
+   representation with an offset table instead of a hash dump. */
+#define SVN_FS_FS__MIN_SORTED_DIR_FORMAT 9
+
+/* The minimum format number that maintains the memory-mapped copy of
+   the youngest revision number in PATH_YOUNGEST. */
+#define SVN_FS_FS__MIN_YOUNGEST_MAP_FORMAT 9
+
+/* The minimum format number that may store the node-revisions of a
+   transaction in a single log file instead of one file per node. */
+#define SVN_FS_FS__MIN_NODEREV_LOG_FORMAT 9
+
+/* The minimum format number that allows pack to re-encode delta
+   representations, recording their actual size in "RDELTA" headers. */
+#define SVN_FS_FS__MIN_PACK_COMPRESSION_FORMAT 9
+
 /* On most operating systems apr implements file locks per process, not
    per file.  On Windows apr implements the locking as per file handle
    locks, so we don't have to add our own mutex for just in-process
@@ -275,6 +307,18 @@ typedef struct fs_fs_shared_data_t
      txn-current file. */
   svn_mutex__t *txn_current_lock;
 
+  /* A lock for intra-process synchronization when modifying the
+     rep-index.  Independent of the locks above. */
+  svn_mutex__t *rep_index_lock;
+
+  /* Index of recently committed file reps by content similarity, or NULL
+     if it has not been needed yet.  See similarity.h. */
+  struct svn_fs_fs__similarity_index_t *similarity_index;
+
+  /* A lock for intra-process synchronization when accessing the
+     SIMILARITY_INDEX.  Independent of the locks above. */
+  svn_mutex__t *similarity_lock;
+
   /* The common pool, under which this object is allocated, subpools
      of which are used to allocate the transaction objects. */
   apr_pool_t *common_pool;
@@ -343,6 +387,18 @@ typedef struct fs_fs_data_t
    * index page. */
   apr_int64_t p2l_page_size;
 
+  /* Number of blocks following the current one that block-read will ask
+   * the OS to read ahead in the background.  0 disables read-ahead. */
+  apr_int64_t block_read_ahead;
+
+  /* Record every Nth item access for pack to optimize the item placement.
+   * 0 disables the sampling. */
+  apr_int64_t access_sample_rate;
+
+  /* Sampling state or NULL if nothing has been sampled yet.
+   * See access-stats.h. */
+  struct svn_fs_fs__access_stats_t *access_stats;
+
   /* If set, parse and cache *all* data of each block that we read
    * (not just the one bit that we need, atm). */
   svn_boolean_t use_block_read;
@@ -350,6 +406,17 @@ typedef struct fs_fs_data_t
   /* The revision that was youngest, last time we checked. */
   svn_revnum_t youngest_rev_cache;
 
+  /* Whether readers shall use (and create) the memory-mapped youngest
+   * revision file instead of reading 'current'. */
+  svn_boolean_t mmap_youngest;
+
+  /* The mapped youngest revision word or NULL, if not mapped (yet).
+   * See youngest-map.h. */
+  volatile apr_uint32_t *youngest_map;
+
+  /* TRUE, once readers tried to map the youngest revision file. */
+  svn_boolean_t youngest_map_tried;
+
   /* Caches of immutable data.  (Note that these may be shared between
      multiple svn_fs_t's for the same filesystem.) */
 
@@ -376,6 +443,11 @@ typedef struct fs_fs_data_t
      names to (svn_fs_dirent_t *). */
   svn_cache__t *dir_cache;
 
+  /* A cache of the fulltexts of immutable directories stored in the
+     sorted format; maps from (revision, item index) to svn_stringbuf_t.
+     Single entries can be looked up without parsing the whole listing. */
+  svn_cache__t *sorted_dir_cache;
+
   /* Fulltext cache; currently only used with memcached.  Maps from
      rep key (revision/offset) to svn_stringbuf_t. */
   svn_cache__t *fulltext_cache;
@@ -465,6 +537,13 @@ typedef struct fs_fs_data_t
   /* Thread-safe boolean */
   svn_atomic_t rep_cache_db_opened;
 
+  /* The hash index used for rep caching instead of REP_CACHE_DB if
+     REP_CACHE_INDEX has been set. */
+  struct svn_fs_fs__rep_index_t *rep_index;
+
+  /* Thread-safe boolean */
+  svn_atomic_t rep_index_opened;
+
   /* The oldest revision not in a pack file.  It also applies to revprops
    * if revprop packing has been enabled by the FSFS format version. */
   svn_revnum_t min_unpacked_rev;
@@ -473,6 +552,25 @@ typedef struct fs_fs_data_t
    * and allowed by the configuration. */
   svn_boolean_t rep_sharing_allowed;
 
+  /* Whether to use the rep-index instead of the rep-cache.db. */
+  svn_boolean_t rep_cache_index;
+
+  /* Whether new transactions shall keep their node-revisions in
+   * a single log file. */
+  svn_boolean_t txn_noderev_log;
+
+  /* In-memory state of the node-revision logs of the transactions
+   * accessed through this FS object, keyed by transaction ID.
+   * See noderev-log.h.  Created on demand. */
+  apr_hash_t *noderev_logs;
+
+  /* Whether to keep locks in the lock index instead of digest files. */
+  svn_boolean_t lock_index_enabled;
+
+  /* The lock index, if LOCK_INDEX_ENABLED is set and the index has been
+   * found to exist.  See lock-index.h.  Opened on demand. */
+  struct svn_fs_fs__lock_index_t *lock_index;
+
   /* File size limit in bytes up to which multiple revprops shall be packed
    * into a single file. */
   apr_int64_t revprop_pack_size;
@@ -493,12 +591,26 @@ typedef struct fs_fs_data_t
    * deltification history after which skip deltas will be used. */
   apr_int64_t max_linear_deltification;
 
+  /* Whether to also try copy sources and reps of similar content as
+   * delta bases for file contents. */
+  svn_boolean_t similarity_deltification;
+
   /* Compression type to use with txdelta storage format in new revs. */
   compression_type_t delta_compression_type;
 
   /* Compression level (currently, only used with compression_type_zlib). */
   int delta_compression_level;
 
+  /* Whether pack shall re-encode delta representations using
+   * PACK_COMPRESSION_TYPE and PACK_COMPRESSION_LEVEL. */
+  svn_boolean_t pack_recompress;
+
+  /* Compression type to convert delta representations to during pack. */
+  compression_type_t pack_compression_type;
+
+  /* Compression level to use with PACK_COMPRESSION_TYPE. */
+  int pack_compression_level;
+
   /* Pack after every commit. */
   svn_boolean_t pack_after_commit;
 
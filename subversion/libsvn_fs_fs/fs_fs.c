@@ -42,11 +42,13 @@
 #include "transaction.h"
 #include "tree.h"
 #include "util.h"
+#include "youngest-map.h"
 
 #include "private/svn_fs_util.h"
 #include "private/svn_io_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_subr_private.h"
+#include "private/svn_trace.h"
 #include "../libsvn_fs/fs-loader.h"
 
 /* The default maximum number of files per directory to store in the
@@ -159,6 +161,10 @@ typedef struct with_lock_baton_t
   /* If true, set FS->HAS_WRITE_LOCK after we acquired the lock. */
   svn_boolean_t is_global_lock;
 
+  /* Trace timestamp taken before we started waiting for the write lock.
+     Only used if IS_GLOBAL_LOCK is set. */
+  apr_time_t wait_start;
+
   /* Function body to execute after we acquired the lock.
      This may be user-provided or a nested call to with_lock(). */
   svn_error_t *(*body)(void *baton,
@@ -182,6 +188,9 @@ typedef struct with_lock_baton_t
   svn_boolean_t is_outer_most_lock;
 } with_lock_baton_t;
 
+/* Trace probe for the time spent waiting for the FS write lock. */
+SVN_TRACE__PROBE(write_lock_wait_probe, "fsfs.write_lock_wait");
+
 /* Obtain a write lock on the file BATON->LOCK_PATH and call BATON->BODY
    with BATON->BATON.  If this is the outermost lock call, release all file
    locks after the body returned.  If BATON->IS_GLOBAL_LOCK is set, set the
@@ -199,17 +208,21 @@ with_some_lock_file(with_lock_baton_t *baton)
 
       if (baton->is_global_lock)
         {
+          SVN_TRACE__SPAN_END(write_lock_wait_probe, baton->wait_start);
+
           /* set the "got the lock" flag and register reset function */
           apr_pool_cleanup_register(pool,
                                     ffd,
                                     reset_lock_flag,
                                     apr_pool_cleanup_null);
           ffd->has_write_lock = TRUE;
+
+          err = svn_fs_fs__youngest_map_sync(fs, pool);
         }
 
       /* nobody else will modify the repo state
          => read HEAD & pack info once */
-      if (baton->is_inner_most_lock)
+      if (!err && baton->is_inner_most_lock)
         {
           if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
             err = svn_fs_fs__update_min_unpacked_rev(fs, pool);
@@ -236,6 +249,11 @@ with_lock(void *baton,
           apr_pool_t *pool)
 {
   with_lock_baton_t *lock_baton = baton;
+
+  /* Commits spend most of their lock wait time here. */
+  if (lock_baton->is_global_lock)
+    lock_baton->wait_start = SVN_TRACE__SPAN_START();
+
   SVN_MUTEX__WITH_LOCK(lock_baton->mutex, with_some_lock_file(lock_baton));
 
   return SVN_NO_ERROR;
@@ -246,7 +264,8 @@ typedef enum lock_id_t
 {
   write_lock,
   txn_lock,
-  pack_lock
+  pack_lock,
+  rep_index_lock
 } lock_id_t;
 
 /* Initialize BATON->MUTEX, BATON->LOCK_PATH and BATON->IS_GLOBAL_LOCK
@@ -280,6 +299,14 @@ init_lock_baton(with_lock_baton_t *baton,
                                                    baton->lock_pool);
       baton->is_global_lock = FALSE;
       break;
+
+    case rep_index_lock:
+      baton->mutex = ffsd->rep_index_lock;
+      baton->lock_path = svn_dirent_join(baton->fs->path,
+                                         PATH_REP_INDEX_LOCK,
+                                         baton->lock_pool);
+      baton->is_global_lock = FALSE;
+      break;
     }
 }
 
@@ -391,6 +418,18 @@ svn_fs_fs__with_txn_current_lock(svn_fs_t *fs,
                      pool));
 }
 
+svn_error_t *
+svn_fs_fs__with_rep_index_lock(svn_fs_t *fs,
+                               svn_error_t *(*body)(void *baton,
+                                                    apr_pool_t *pool),
+                               void *baton,
+                               apr_pool_t *pool)
+{
+  return svn_error_trace(
+           with_lock(create_lock_baton(fs, rep_index_lock, body, baton, pool),
+                     pool));
+}
+
 svn_error_t *
 svn_fs_fs__with_all_locks(svn_fs_t *fs,
                           svn_error_t *(*body)(void *baton,
@@ -760,6 +799,10 @@ read_config(fs_fs_data_t *ffd,
   else
     ffd->rep_sharing_allowed = FALSE;
 
+  SVN_ERR(svn_config_get_bool(config, &ffd->rep_cache_index,
+                              CONFIG_SECTION_REP_SHARING,
+                              CONFIG_OPTION_ENABLE_REP_CACHE_INDEX, FALSE));
+
   /* Initialize deltification settings in ffd. */
   if (ffd->format >= SVN_FS_FS__MIN_DELTIFICATION_FORMAT)
     {
@@ -779,6 +822,10 @@ read_config(fs_fs_data_t *ffd,
                                    CONFIG_SECTION_DELTIFICATION,
                                    CONFIG_OPTION_MAX_LINEAR_DELTIFICATION,
                                    SVN_FS_FS_MAX_LINEAR_DELTIFICATION));
+      SVN_ERR(svn_config_get_bool(config, &ffd->similarity_deltification,
+                                  CONFIG_SECTION_DELTIFICATION,
+                                  CONFIG_OPTION_ENABLE_SIMILARITY_DELTIFICATION,
+                                  FALSE));
     }
   else
     {
@@ -786,6 +833,7 @@ read_config(fs_fs_data_t *ffd,
       ffd->deltify_properties = FALSE;
       ffd->max_deltification_walk = SVN_FS_FS_MAX_DELTIFICATION_WALK;
       ffd->max_linear_deltification = SVN_FS_FS_MAX_LINEAR_DELTIFICATION;
+      ffd->similarity_deltification = FALSE;
     }
 
   /* Initialize revprop packing settings in ffd. */
@@ -824,6 +872,14 @@ read_config(fs_fs_data_t *ffd,
                                    CONFIG_SECTION_IO,
                                    CONFIG_OPTION_P2L_PAGE_SIZE,
                                    0x400));
+      SVN_ERR(svn_config_get_int64(config, &ffd->block_read_ahead,
+                                   CONFIG_SECTION_IO,
+                                   CONFIG_OPTION_BLOCK_READ_AHEAD,
+                                   0));
+      SVN_ERR(svn_config_get_int64(config, &ffd->access_sample_rate,
+                                   CONFIG_SECTION_IO,
+                                   CONFIG_OPTION_ACCESS_SAMPLE_RATE,
+                                   0));
 
       /* Don't accept unreasonable or illegal values.
        * Block size and P2L page size are in kbytes;
@@ -835,6 +891,16 @@ read_config(fs_fs_data_t *ffd,
       SVN_ERR(verify_block_size(ffd->l2p_page_size, sizeof(apr_off_t),
                                 CONFIG_OPTION_L2P_PAGE_SIZE, scratch_pool));
 
+      /* Read-ahead is in blocks.  Limit it to something sensible. */
+      if (ffd->block_read_ahead < 0 || ffd->block_read_ahead > 0x100)
+        return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                 _("%s is out of range for fsfs.conf "
+                                   "setting '%s'."),
+                                 apr_psprintf(scratch_pool,
+                                              "%" APR_INT64_T_FMT,
+                                              ffd->block_read_ahead),
+                                 CONFIG_OPTION_BLOCK_READ_AHEAD);
+
       /* convert kBytes to bytes */
       ffd->block_size *= 0x400;
       ffd->p2l_page_size *= 0x400;
@@ -846,8 +912,28 @@ read_config(fs_fs_data_t *ffd,
       ffd->block_size = 0x1000; /* Matches default APR file buffer size. */
       ffd->l2p_page_size = 0x2000;    /* Matches above default. */
       ffd->p2l_page_size = 0x100000;  /* Matches above default in bytes. */
+      ffd->block_read_ahead = 0;
+      ffd->access_sample_rate = 0;
     }
 
+  if (ffd->format >= SVN_FS_FS__MIN_YOUNGEST_MAP_FORMAT)
+    SVN_ERR(svn_config_get_bool(config, &ffd->mmap_youngest,
+                                CONFIG_SECTION_IO,
+                                CONFIG_OPTION_MMAP_YOUNGEST, FALSE));
+  else
+    ffd->mmap_youngest = FALSE;
+
+  if (ffd->format >= SVN_FS_FS__MIN_NODEREV_LOG_FORMAT)
+    SVN_ERR(svn_config_get_bool(config, &ffd->txn_noderev_log,
+                                CONFIG_SECTION_IO,
+                                CONFIG_OPTION_TXN_NODEREV_LOG, FALSE));
+  else
+    ffd->txn_noderev_log = FALSE;
+
+  SVN_ERR(svn_config_get_bool(config, &ffd->lock_index_enabled,
+                              CONFIG_SECTION_LOCKS,
+                              CONFIG_OPTION_ENABLE_LOCK_INDEX, FALSE));
+
   if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
     {
       SVN_ERR(svn_config_get_bool(config, &ffd->pack_after_commit,
@@ -925,6 +1011,25 @@ read_config(fs_fs_data_t *ffd,
       ffd->delta_compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
     }
 
+  /* Re-encoding deltas during pack is off unless configured explicitly. */
+  ffd->pack_recompress = FALSE;
+  if (   ffd->format >= SVN_FS_FS__MIN_PACK_COMPRESSION_FORMAT
+      && ffd->use_log_addressing)
+    {
+      const char *pack_compression_val;
+
+      svn_config_get(config, &pack_compression_val,
+                     CONFIG_SECTION_DELTIFICATION,
+                     CONFIG_OPTION_PACK_COMPRESSION, NULL);
+      if (pack_compression_val)
+        {
+          SVN_ERR(parse_compression_option(&ffd->pack_compression_type,
+                                           &ffd->pack_compression_level,
+                                           pack_compression_val));
+          ffd->pack_recompress = TRUE;
+        }
+    }
+
 #ifdef SVN_DEBUG
   SVN_ERR(svn_config_get_bool(config, &ffd->verify_before_commit,
                               CONFIG_SECTION_DEBUG,
@@ -993,6 +1098,14 @@ write_config(svn_fs_t *fs,
 "### 'svnadmin verify' will check the rep-cache regardless of this setting." NL
 "### rep-sharing is enabled by default."                                     NL
 "# " CONFIG_OPTION_ENABLE_REP_SHARING " = true"                              NL
+"###"                                                                        NL
+"### By default, the shared representations are tracked in an SQLite"        NL
+"### database (rep-cache.db).  For very large repositories, an append-only"  NL
+"### hash index (rep-index) with lower lookup and insertion costs can be"    NL
+"### used instead.  When enabled, it will be created automatically from"     NL
+"### an existing rep-cache.db.  Changes made while the index is enabled"     NL
+"### will not be reflected in rep-cache.db, so don't switch back and forth." NL
+"# " CONFIG_OPTION_ENABLE_REP_CACHE_INDEX " = false"                         NL
 ""                                                                           NL
 "[" CONFIG_SECTION_DELTIFICATION "]"                                         NL
 "### To conserve space, the filesystem stores data as differences against"   NL
@@ -1055,6 +1168,19 @@ write_config(svn_fs_t *fs,
 "### For 1.8, the default value is 16; earlier versions use 1."              NL
 "# " CONFIG_OPTION_MAX_LINEAR_DELTIFICATION " = 16"                          NL
 "###"                                                                        NL
+"### Normally, the delta base of a file is picked by its position in the"    NL
+"### node's history only.  Copies with modifications, files re-added under"  NL
+"### a different name and files sharing much content with others may then"   NL
+"### be stored inefficiently.  The following parameter makes the server try" NL
+"### further delta bases: the direct predecessor and recently committed"     NL
+"### files with similar contents or the same name.  The one producing the"   NL
+"### smallest delta for the first 100kB of the new contents gets used."      NL
+"### The limits on delta chain lengths still apply.  This increases commit"  NL
+"### times and memory usage somewhat.  Only files committed through the"     NL
+"### same server process are being considered."                              NL
+"### similarity-based deltification is disabled by default."                 NL
+"# " CONFIG_OPTION_ENABLE_SIMILARITY_DELTIFICATION " = false"                NL
+"###"                                                                        NL
 "### After deltification, we compress the data to minimize on-disk size."    NL
 "### This setting controls the compression algorithm, which will be used in" NL
 "### future revisions.  It can be used to either disable compression or to"  NL
@@ -1079,6 +1205,19 @@ write_config(svn_fs_t *fs,
 "### still be used (and it will result in zlib compression with the"         NL
 "### corresponding compression level)."                                      NL
 "###   " CONFIG_OPTION_COMPRESSION_LEVEL " = 0 ... 9 (default is 5)"         NL
+"###"                                                                        NL
+"### Older revisions may have been written using a compression that is"      NL
+"### expensive to decode, e.g. zlib at a high level.  When packing a shard," NL
+"### its delta representations may be re-encoded using another compression"  NL
+"### algorithm.  For instance, converting them to lz4 trades some disk"      NL
+"### space for much faster reads of historical data.  Representations that"  NL
+"### already use the selected algorithm will be copied unchanged.  Shards"   NL
+"### that have been packed before can be re-encoded using 'svnfsfs repack'." NL
+"### Re-encoding requires format 9 repositories with logical addressing."    NL
+"### The syntax is the same as for the '" CONFIG_OPTION_COMPRESSION "' option:" NL
+"###   " CONFIG_OPTION_PACK_COMPRESSION " = none | lz4 | zlib | zlib-1 ... zlib-9" NL
+"### By default, pack copies all representations unchanged."                 NL
+"# " CONFIG_OPTION_PACK_COMPRESSION " = lz4"                                 NL
 ""                                                                           NL
 "[" CONFIG_SECTION_PACKED_REVPROPS "]"                                       NL
 "### This parameter controls the size (in kBytes) of packed revprop files."  NL
@@ -1147,6 +1286,55 @@ write_config(svn_fs_t *fs,
 "### Must be a power of 2."                                                  NL
 "### p2l-page-size is given in kBytes and with a default of 1024 kBytes."    NL
 "# " CONFIG_OPTION_P2L_PAGE_SIZE " = 1024"                                   NL
+"###"                                                                        NL
+"### When block-read has to fetch a block from disk, it may also advise"     NL
+"### the OS to read the following blocks in the background.  The OS then"    NL
+"### issues these reads concurrently, which reduces cold-cache latency on"   NL
+"### storage that handles many parallel requests well, e.g. NVMe or RAID"    NL
+"### arrays.  Has no effect if block-read is not enabled or the platform"    NL
+"### does not support read-ahead advice.  Must be between 0 and 256."        NL
+"### block-read-ahead is given in blocks and defaults to 0 (disabled)."      NL
+"# " CONFIG_OPTION_BLOCK_READ_AHEAD " = 0"                                   NL
+"###"                                                                        NL
+"### 'svnadmin pack' places items that are likely to be read together next"  NL
+"### to each other.  If the following option is set to N > 0, every Nth"     NL
+"### item read from a non-packed shard gets recorded in a small statistics"  NL
+"### file within that shard.  Pack will then put the most frequently read"   NL
+"### items of the shard in front of all others, reducing the number of"      NL
+"### blocks that typical requests need to read.  Values around 100 keep"     NL
+"### the overhead negligible on busy servers.  Has no effect on shards"      NL
+"### that have already been packed."                                         NL
+"### access-sample-rate defaults to 0 (disabled)."                           NL
+"# " CONFIG_OPTION_ACCESS_SAMPLE_RATE " = 0"                                 NL
+"###"                                                                        NL
+"### Determining the youngest revision normally requires reading the"        NL
+"### 'current' file.  If enabled, a copy of the youngest revision number"    NL
+"### will be kept in a small memory-mapped file such that processes can"     NL
+"### determine it without any I/O.  This must not be enabled if the"         NL
+"### repository is being accessed from more than one machine, e.g. via"      NL
+"### NFS.  Only remove the 'youngest' file while the repository is not"      NL
+"### being used.  Requires format 9 or newer.  Disabled by default."         NL
+"# " CONFIG_OPTION_MMAP_YOUNGEST " = false"                                  NL
+"###"                                                                        NL
+"### Transactions normally store every modified node in a separate file."    NL
+"### Enabling this option makes new transactions append all node updates"    NL
+"### to a single log file instead, which reduces the number of files"        NL
+"### being created by large commits.  Requires format 9 or newer."           NL
+"### Disabled by default."                                                   NL
+"# " CONFIG_OPTION_TXN_NODEREV_LOG " = false"                                NL
+""                                                                           NL
+"[" CONFIG_SECTION_LOCKS "]"                                                 NL
+"###"                                                                        NL
+"### Locks are normally stored in one file per locked path plus one file"    NL
+"### per parent directory listing the locks below it.  With many thousands"  NL
+"### of locks, listing locks and checking them during commits gets slow."    NL
+"### If the following option is enabled, all locks are kept in a single"     NL
+"### index sorted by path instead.  Existing locks get imported when the"    NL
+"### index is first written to.  Locks created while the index is enabled"   NL
+"### will not be visible to processes that don't use it, so all servers"     NL
+"### and tools accessing the repository must use the same setting."          NL
+"### Disabled by default."                                                   NL
+"# " CONFIG_OPTION_ENABLE_LOCK_INDEX " = false"                              NL
 ""                                                                           NL
 "[" CONFIG_SECTION_DEBUG "]"                                                 NL
 "###"                                                                        NL
@@ -1436,7 +1624,20 @@ get_youngest(svn_revnum_t *youngest_p,
              svn_fs_t *fs,
              apr_pool_t *pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   apr_uint64_t dummy;
+
+  /* Map the youngest revision file upon first use only.  Writers will
+     map it while holding the write lock. */
+  if (ffd->mmap_youngest && !ffd->youngest_map_tried)
+    {
+      ffd->youngest_map_tried = TRUE;
+      svn_fs_fs__youngest_map_open(fs, TRUE, pool);
+    }
+
+  if (svn_fs_fs__youngest_map_get(youngest_p, fs))
+    return SVN_NO_ERROR;
+
   SVN_ERR(svn_fs_fs__read_current(youngest_p, &dummy, &dummy, fs, pool));
   return SVN_NO_ERROR;
 }
@@ -1805,6 +2006,9 @@ write_revision_zero(svn_fs_t *fs,
   svn_hash_sets(proplist, SVN_PROP_REVISION_DATE, &date);
   SVN_ERR(svn_fs_fs__set_revision_proplist(fs, 0, proplist, subpool));
 
+  /* Start the date index. */
+  SVN_ERR(svn_fs__date_index_append(fs->path, 0, &date, subpool));
+
   svn_pool_destroy(subpool);
   return SVN_NO_ERROR;
 }
@@ -1950,6 +2154,8 @@ svn_fs_fs__create(svn_fs_t *fs,
                   break;
           case 9: format = 7;
                   break;
+          case 10: format = 8;
+                  break;
 
           default:format = SVN_FS_FS__FORMAT_NUMBER;
         }
@@ -2258,8 +2464,13 @@ change_rev_prop_body(void *baton, apr_pool_t *pool)
     return SVN_NO_ERROR;
 
   svn_hash_sets(table, cb->name, cb->value);
+  SVN_ERR(svn_fs_fs__set_revision_proplist(cb->fs, cb->rev, table, pool));
 
-  return svn_fs_fs__set_revision_proplist(cb->fs, cb->rev, table, pool);
+  /* Keep the date index, if there is one, up to date. */
+  if (strcmp(cb->name, SVN_PROP_REVISION_DATE) == 0)
+    SVN_ERR(svn_fs__date_index_set(cb->fs->path, cb->rev, cb->value, pool));
+
+  return SVN_NO_ERROR;
 }
 
 svn_error_t *
@@ -2322,8 +2533,11 @@ svn_fs_fs__info_format(int *fs_format,
     case 8:
       (*supports_version)->minor = 10;
       break;
+    case 9:
+      (*supports_version)->minor = 11;
+      break;
 #ifdef SVN_DEBUG
-# if SVN_FS_FS__FORMAT_NUMBER != 8
+# if SVN_FS_FS__FORMAT_NUMBER != 9
 #  error "Need to add a 'case' statement here"
 # endif
 #endif
@@ -212,6 +212,15 @@ svn_fs_fs__with_txn_current_lock(svn_fs_t *fs,
                                  void *baton,
                                  apr_pool_t *pool);
 
+/* Run BODY (with BATON and POOL) while the rep-index of FS is locked.
+   This lock is independent of all other locks. */
+svn_error_t *
+svn_fs_fs__with_rep_index_lock(svn_fs_t *fs,
+                               svn_error_t *(*body)(void *baton,
+                                                    apr_pool_t *pool),
+                               void *baton,
+                               apr_pool_t *pool);
+
 /* Obtain all locks on the filesystem FS in a subpool of POOL, call BODY
    with BATON and that subpool, destroy the subpool (releasing the locks)
    and return what BODY returned.
@@ -22,6 +22,7 @@
 #include "svn_pools.h"
 #include "svn_path.h"
 #include "svn_dirent_uri.h"
+#include "private/svn_fs_util.h"
 
 #include "fs_fs.h"
 #include "hotcopy.h"
@@ -786,6 +787,27 @@ struct hotcopy_body_baton {
   void *cancel_baton;
 };
 
+/* Copy the rep-index of the source filesystem in the hotcopy_body_baton
+ * BATON, if it exists, to the destination.  Implements the BODY of
+ * svn_fs_fs__with_rep_index_lock(). */
+static svn_error_t *
+hotcopy_rep_index(void *baton, apr_pool_t *pool)
+{
+  struct hotcopy_body_baton *hbb = baton;
+  const char *src_subdir = svn_dirent_join(hbb->src_fs->path,
+                                           PATH_REP_INDEX_DIR, pool);
+  svn_node_kind_t kind;
+
+  SVN_ERR(svn_io_check_path(src_subdir, &kind, pool));
+  if (kind == svn_node_dir)
+    SVN_ERR(svn_io_copy_dir_recursively(src_subdir, hbb->dst_fs->path,
+                                        PATH_REP_INDEX_DIR, TRUE,
+                                        hbb->cancel_func, hbb->cancel_baton,
+                                        pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Perform a hotcopy, either normal or incremental.
  *
  * Normal hotcopy assumes that the destination exists as an empty
@@ -967,6 +989,14 @@ hotcopy_body(void *baton, apr_pool_t *pool)
                                             PATH_NODE_ORIGINS_DIR, TRUE,
                                             cancel_func, cancel_baton, pool));
 
+  /* The date index of the destination must match its revprops. */
+  SVN_ERR(svn_fs__date_index_copy(src_fs->path, dst_fs->path, src_youngest,
+                                  pool));
+
+  /* Commits to the destination will keep its path index up to date. */
+  SVN_ERR(svn_fs__path_index_copy(src_fs->path, dst_fs->path, src_youngest,
+                                  pool));
+
   /*
    * NB: Data copied below is only read by writers, not readers.
    *     Writers are still locked out at this point.
@@ -986,8 +1016,17 @@ hotcopy_body(void *baton, apr_pool_t *pool)
           /* The source might have r/o flags set on it - which would be
              carried over to the copy. */
           SVN_ERR(svn_io_set_file_read_write(dst_subdir, FALSE, pool));
-          SVN_ERR(svn_fs_fs__del_rep_reference(dst_fs, src_youngest, pool));
         }
+
+      /* Likewise for the rep-index.  Its files get rewritten in place,
+       * so replace it as a whole. */
+      dst_subdir = svn_dirent_join(dst_fs->path, PATH_REP_INDEX_DIR, pool);
+      SVN_ERR(svn_io_remove_dir2(dst_subdir, TRUE, cancel_func, cancel_baton,
+                                 pool));
+      SVN_ERR(svn_fs_fs__with_rep_index_lock(src_fs, hotcopy_rep_index, hbb,
+                                             pool));
+
+      SVN_ERR(svn_fs_fs__del_rep_reference(dst_fs, src_youngest, pool));
     }
 
   /* Copy the txn-current file. */
@@ -0,0 +1,1042 @@
+/* lock-index.c --- path-sorted lock index
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include <apr_mmap.h>
+
+#include "svn_hash.h"
+#include "svn_pools.h"
+#include "svn_dirent_uri.h"
+#include "svn_path.h"
+#include "svn_sorts.h"
+#include "svn_time.h"
+
+#include "private/svn_fspath.h"
+#include "private/svn_sorts_private.h"
+#include "private/svn_subr_private.h"
+
+#include "fs_fs.h"
+#include "lock-index.h"
+#include "util.h"
+#include "../libsvn_fs/fs-loader.h"
+
+#include "svn_private_config.h"
+
+/* Names of the index files within the locks directory.  Digest files
+ * live in sub-directories, so there is no conflict. */
+#define RUN_FILE_NAME              "index"
+#define LOG_FILE_NAME              "index.log"
+
+/* Run files start with a header of this size: the magic string followed
+ * by the generation and the number of locks, all numbers being 64 bit
+ * little endian.  The header is followed by a table of the 64 bit file
+ * offsets of all lock records, sorted by lock path. */
+#define RUN_MAGIC                  "SVNLKIX1"
+#define RUN_HEADER_SIZE            24
+#define OFFSET_SIZE                8
+
+/* Log files start with a header of this size: the magic string followed
+ * by the 64 bit generation of the run that the log applies to.  A log
+ * with any other generation must not be combined with the run.
+ *
+ * Log records consist of a single operation byte, the 32 bit length of
+ * the payload, the payload itself and a 32 bit FNV-1a checksum over all
+ * preceding bytes of the record.  The latter allows readers to detect
+ * partially written records.  Lock records contain a serialized lock,
+ * unlock records contain the NUL-terminated path. */
+#define LOG_MAGIC                  "SVNLKLG1"
+#define LOG_FILE_HEADER_SIZE       16
+#define LOG_OP_LOCK                'L'
+#define LOG_OP_UNLOCK              'U'
+#define LOG_HEADER_SIZE            5
+#define LOG_CHECKSUM_SIZE          4
+
+/* Merge the log into the run once it contains more than this many entries
+ * or more than 1/LOG_RATIO of the number of locks in the run. */
+#define MIN_LOG_RECORDS            256
+#define LOG_RATIO                  8
+
+/* Number of NUL-terminated fields in a serialized lock:
+ * path, token, owner, creation date, expiration date, flags, comment. */
+#define LOCK_FIELD_COUNT           7
+
+/* Flag characters used in the flags field of serialized locks. */
+#define FLAG_DAV_COMMENT           'd'
+#define FLAG_HAS_COMMENT           'c'
+
+/* A path entry in the log.  LOCK is NULL if the path has been unlocked. */
+typedef struct log_entry_t
+{
+  svn_lock_t *lock;
+} log_entry_t;
+
+struct svn_fs_fs__lock_index_t
+{
+  /* Locations of the index files. */
+  const char *run_path;
+  const char *log_path;
+
+  /* Holds the mapped run file as well as the log data read so far.
+   * Cleared whenever we need to re-read the index. */
+  apr_pool_t *data_pool;
+
+  /* If not set, the data below is invalid. */
+  svn_boolean_t loaded;
+
+  /* Generation of the run file that we mapped.  0 if there is none. */
+  apr_uint64_t generation;
+
+  /* The run file contents. */
+  const char *run;
+  apr_size_t run_size;
+
+  /* Number of locks in the run and the table of their record offsets. */
+  apr_uint64_t count;
+  const unsigned char *offsets;
+
+  /* Entries read from the log file, mapping the path to log_entry_t *.
+   * These take precedence over the locks in the run. */
+  apr_hash_t *log;
+
+  /* Number of bytes of valid log data, i.e. read into LOG, including the
+   * log file header.  0 if we did not find a log for our run yet. */
+  apr_off_t log_offset;
+
+  /* Size of the log file when we last read it.  This may exceed
+   * LOG_OFFSET if the last record has not been written completely. */
+  apr_off_t log_size;
+};
+
+/* A serialized lock to be written to a run file. */
+typedef struct run_entry_t
+{
+  const char *path;
+  const char *data;
+  apr_size_t len;
+} run_entry_t;
+
+
+/* Encoding utilities */
+
+static void
+encode_uint(unsigned char *p,
+            apr_uint64_t value,
+            int size)
+{
+  int i;
+  for (i = 0; i < size; ++i, value >>= 8)
+    p[i] = (unsigned char)(value & 0xff);
+}
+
+static apr_uint64_t
+decode_uint(const unsigned char *p,
+            int size)
+{
+  apr_uint64_t value = 0;
+  int i;
+  for (i = size - 1; i >= 0; --i)
+    value = (value << 8) | p[i];
+
+  return value;
+}
+
+/* Append STR including its terminating NUL to BUFFER. */
+static void
+append_field(svn_stringbuf_t *buffer,
+             const char *str)
+{
+  svn_stringbuf_appendbytes(buffer, str, strlen(str) + 1);
+}
+
+/* Append the serialized LOCK to BUFFER.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static void
+serialize_lock(svn_stringbuf_t *buffer,
+               const svn_lock_t *lock,
+               apr_pool_t *scratch_pool)
+{
+  char flags[3];
+  int flag_count = 0;
+
+  if (lock->is_dav_comment)
+    flags[flag_count++] = FLAG_DAV_COMMENT;
+  if (lock->comment)
+    flags[flag_count++] = FLAG_HAS_COMMENT;
+  flags[flag_count] = '\0';
+
+  append_field(buffer, lock->path);
+  append_field(buffer, lock->token);
+  append_field(buffer, lock->owner);
+  append_field(buffer, svn_time_to_cstring(lock->creation_date,
+                                           scratch_pool));
+  append_field(buffer, lock->expiration_date
+                         ? svn_time_to_cstring(lock->expiration_date,
+                                               scratch_pool)
+                         : "");
+  append_field(buffer, flags);
+  append_field(buffer, lock->comment ? lock->comment : "");
+}
+
+/* Return an SVN_ERR_FS_CORRUPT error for the index file at PATH. */
+static svn_error_t *
+corrupt_index(const char *path,
+              apr_pool_t *scratch_pool)
+{
+  return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                           _("Corrupt lock index file '%s'"),
+                           svn_dirent_local_style(path, scratch_pool));
+}
+
+/* Parse the serialized lock of LEN bytes at DATA, read from the index
+ * file at INDEX_PATH, and return it in *LOCK_P.  Allocate the result in
+ * RESULT_POOL. */
+static svn_error_t *
+parse_lock(svn_lock_t **lock_p,
+           const char *data,
+           apr_size_t len,
+           const char *index_path,
+           apr_pool_t *result_pool)
+{
+  const char *fields[LOCK_FIELD_COUNT];
+  const char *end = data + len;
+  svn_lock_t *lock;
+  int i;
+
+  for (i = 0; i < LOCK_FIELD_COUNT; ++i)
+    {
+      const char *nul = data < end ? memchr(data, '\0', end - data) : NULL;
+      if (!nul)
+        return svn_error_trace(corrupt_index(index_path, result_pool));
+
+      fields[i] = data;
+      data = nul + 1;
+    }
+
+  lock = svn_lock_create(result_pool);
+  lock->path = apr_pstrdup(result_pool, fields[0]);
+  lock->token = apr_pstrdup(result_pool, fields[1]);
+  lock->owner = apr_pstrdup(result_pool, fields[2]);
+  SVN_ERR(svn_time_from_cstring(&lock->creation_date, fields[3],
+                                result_pool));
+  if (*fields[4])
+    SVN_ERR(svn_time_from_cstring(&lock->expiration_date, fields[4],
+                                  result_pool));
+  lock->is_dav_comment = strchr(fields[5], FLAG_DAV_COMMENT) != NULL;
+  if (strchr(fields[5], FLAG_HAS_COMMENT))
+    lock->comment = apr_pstrdup(result_pool, fields[6]);
+
+  *lock_p = lock;
+  return SVN_NO_ERROR;
+}
+
+
+/* Run file access */
+
+/* Return the start of record IDX in the run of INDEX and its length in
+ * *LEN.  The record starts with the NUL-terminated lock path. */
+static const char *
+run_record(apr_size_t *len,
+           const svn_fs_fs__lock_index_t *index,
+           apr_uint64_t idx)
+{
+  apr_uint64_t start = decode_uint(index->offsets + idx * OFFSET_SIZE,
+                                   OFFSET_SIZE);
+  apr_uint64_t end = idx + 1 < index->count
+                   ? decode_uint(index->offsets + (idx + 1) * OFFSET_SIZE,
+                                 OFFSET_SIZE)
+                   : index->run_size;
+
+  *len = (apr_size_t)(end - start);
+  return index->run + start;
+}
+
+/* Return the index of the first lock in the run of INDEX whose path does
+ * not sort before PATH. */
+static apr_uint64_t
+lower_bound(const svn_fs_fs__lock_index_t *index,
+            const char *path)
+{
+  apr_uint64_t lower = 0;
+  apr_uint64_t upper = index->count;
+
+  while (lower < upper)
+    {
+      apr_uint64_t middle = lower + (upper - lower) / 2;
+      apr_size_t len;
+      const char *record = run_record(&len, index, middle);
+
+      if (svn_path_compare_paths(record, path) < 0)
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+
+  return lower;
+}
+
+/* Forget all cached data of INDEX and map its run file, if it exists.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+map_run(svn_fs_fs__lock_index_t *index,
+        apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  svn_filesize_t size;
+  const char *data = NULL;
+  apr_uint64_t i, previous;
+  svn_error_t *err;
+
+  svn_pool_clear(index->data_pool);
+  index->loaded = FALSE;
+  index->generation = 0;
+  index->run = NULL;
+  index->run_size = 0;
+  index->count = 0;
+  index->offsets = NULL;
+  index->log = apr_hash_make(index->data_pool);
+  index->log_offset = 0;
+  index->log_size = 0;
+
+  err = svn_io_file_open(&file, index->run_path, APR_READ | APR_BINARY,
+                         APR_OS_DEFAULT, index->data_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      /* No run, i.e. all locks are in the log. */
+      svn_error_clear(err);
+      index->loaded = TRUE;
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_io_file_size_get(&size, file, scratch_pool));
+  if (size < RUN_HEADER_SIZE || (svn_filesize_t)(apr_size_t)size != size)
+    return svn_error_trace(corrupt_index(index->run_path, scratch_pool));
+
+#if APR_HAS_MMAP
+  {
+    apr_mmap_t *mmap;
+    if (apr_mmap_create(&mmap, file, 0, (apr_size_t)size, APR_MMAP_READ,
+                        index->data_pool) == APR_SUCCESS)
+      data = mmap->mm;
+  }
+#endif
+
+  if (!data)
+    {
+      char *buffer = apr_palloc(index->data_pool, (apr_size_t)size);
+      SVN_ERR(svn_io_file_read_full2(file, buffer, (apr_size_t)size,
+                                     NULL, NULL, scratch_pool));
+      data = buffer;
+    }
+
+  /* Mappings remain valid after closing the file. */
+  SVN_ERR(svn_io_file_close(file, scratch_pool));
+
+  if (memcmp(data, RUN_MAGIC, 8) != 0)
+    return svn_error_trace(corrupt_index(index->run_path, scratch_pool));
+
+  index->run = data;
+  index->run_size = (apr_size_t)size;
+  index->generation = decode_uint((const unsigned char *)data + 8, 8);
+  index->count = decode_uint((const unsigned char *)data + 16, 8);
+  index->offsets = (const unsigned char *)data + RUN_HEADER_SIZE;
+
+  /* Verify the offset table, such that lookups will never access data
+   * outside the file and all record paths are NUL-terminated. */
+  if (index->count > (index->run_size - RUN_HEADER_SIZE) / OFFSET_SIZE)
+    return svn_error_trace(corrupt_index(index->run_path, scratch_pool));
+
+  previous = RUN_HEADER_SIZE + index->count * OFFSET_SIZE;
+  for (i = 0; i < index->count; ++i)
+    {
+      apr_uint64_t offset = decode_uint(index->offsets + i * OFFSET_SIZE,
+                                        OFFSET_SIZE);
+      if (offset < previous || offset >= index->run_size)
+        return svn_error_trace(corrupt_index(index->run_path, scratch_pool));
+      if (i > 0 && data[offset - 1] != '\0')
+        return svn_error_trace(corrupt_index(index->run_path, scratch_pool));
+
+      previous = offset + 1;
+    }
+
+  if (index->count && data[index->run_size - 1] != '\0')
+    return svn_error_trace(corrupt_index(index->run_path, scratch_pool));
+
+  index->loaded = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *GENERATION to the generation of the run file at PATH, 0 if there
+ * is no such file.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+read_generation(apr_uint64_t *generation,
+                const char *path,
+                apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  unsigned char header[RUN_HEADER_SIZE];
+  apr_size_t bytes_read;
+  svn_error_t *err;
+
+  err = svn_io_file_open(&file, path, APR_READ | APR_BINARY, APR_OS_DEFAULT,
+                         scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      *generation = 0;
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_io_file_read_full2(file, header, sizeof(header), &bytes_read,
+                                 NULL, scratch_pool));
+  SVN_ERR(svn_io_file_close(file, scratch_pool));
+  if (bytes_read != sizeof(header) || memcmp(header, RUN_MAGIC, 8) != 0)
+    return svn_error_trace(corrupt_index(path, scratch_pool));
+
+  *generation = decode_uint(header + 8, 8);
+  return SVN_NO_ERROR;
+}
+
+
+/* Log file access */
+
+/* Append a log record for operation OP with the LEN bytes of PAYLOAD to
+ * BUFFER. */
+static void
+append_log_record(svn_stringbuf_t *buffer,
+                  char op,
+                  const char *payload,
+                  apr_size_t len)
+{
+  apr_size_t start = buffer->len;
+  unsigned char header[LOG_HEADER_SIZE];
+  unsigned char checksum[LOG_CHECKSUM_SIZE];
+
+  header[0] = (unsigned char)op;
+  encode_uint(header + 1, len, 4);
+  svn_stringbuf_appendbytes(buffer, (const char *)header, sizeof(header));
+  svn_stringbuf_appendbytes(buffer, payload, len);
+
+  encode_uint(checksum, svn__fnv1a_32(buffer->data + start,
+                                      buffer->len - start),
+              LOG_CHECKSUM_SIZE);
+  svn_stringbuf_appendbytes(buffer, (const char *)checksum,
+                            sizeof(checksum));
+}
+
+/* Read any records appended to the log file of INDEX since we last read
+ * it and add them to INDEX->LOG.  Set *TRUNCATED if the file has been
+ * truncated or replaced in the meantime, i.e. the cached data is out of
+ * date.  A log that belongs to an older run has already been merged into
+ * our run and will be ignored.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+read_log(svn_boolean_t *truncated,
+         svn_fs_fs__lock_index_t *index,
+         apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  svn_filesize_t size;
+  apr_off_t offset;
+  apr_size_t to_read, pos;
+  char *buffer;
+  svn_error_t *err;
+
+  *truncated = FALSE;
+  err = svn_io_file_open(&file, index->log_path, APR_READ | APR_BINARY,
+                         APR_OS_DEFAULT, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      *truncated = index->log_offset > 0;
+      index->log_size = 0;
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_io_file_size_get(&size, file, scratch_pool));
+  if (size < index->log_offset)
+    {
+      *truncated = TRUE;
+      return svn_error_trace(svn_io_file_close(file, scratch_pool));
+    }
+
+  index->log_size = size;
+  if (size < LOG_FILE_HEADER_SIZE)
+    return svn_error_trace(svn_io_file_close(file, scratch_pool));
+
+  /* Which run does this log belong to? */
+  if (index->log_offset == 0 || index->log_offset == LOG_FILE_HEADER_SIZE)
+    {
+      unsigned char header[LOG_FILE_HEADER_SIZE];
+      apr_uint64_t generation;
+
+      SVN_ERR(svn_io_file_read_full2(file, header, sizeof(header), NULL,
+                                     NULL, scratch_pool));
+      if (memcmp(header, LOG_MAGIC, 8) != 0)
+        return svn_error_trace(corrupt_index(index->log_path,
+                                             scratch_pool));
+
+      generation = decode_uint(header + 8, 8);
+      if (generation > index->generation)
+        {
+          /* A newer run has been written since we mapped ours. */
+          *truncated = TRUE;
+          return svn_error_trace(svn_io_file_close(file, scratch_pool));
+        }
+
+      if (generation < index->generation)
+        {
+          /* Left over from before the run was written.  Writers are
+           * going to replace it. */
+          *truncated = index->log_offset > 0;
+          return svn_error_trace(svn_io_file_close(file, scratch_pool));
+        }
+
+      index->log_offset = LOG_FILE_HEADER_SIZE;
+    }
+
+  to_read = (apr_size_t)(size - index->log_offset);
+  if (to_read == 0)
+    return svn_error_trace(svn_io_file_close(file, scratch_pool));
+
+  buffer = apr_palloc(scratch_pool, to_read);
+  offset = index->log_offset;
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+  SVN_ERR(svn_io_file_read_full2(file, buffer, to_read, NULL, NULL,
+                                 scratch_pool));
+  SVN_ERR(svn_io_file_close(file, scratch_pool));
+
+  /* Stop at the first incomplete record.  Writers are going to replace it
+   * before appending new ones. */
+  for (pos = 0; pos + LOG_HEADER_SIZE + LOG_CHECKSUM_SIZE <= to_read; )
+    {
+      const unsigned char *record = (const unsigned char *)buffer + pos;
+      apr_uint64_t len = decode_uint(record + 1, 4);
+      apr_size_t record_size;
+      const char *payload = buffer + pos + LOG_HEADER_SIZE;
+      log_entry_t *entry;
+
+      if (len > to_read - pos - LOG_HEADER_SIZE - LOG_CHECKSUM_SIZE)
+        break;
+
+      record_size = LOG_HEADER_SIZE + (apr_size_t)len + LOG_CHECKSUM_SIZE;
+      if (   svn__fnv1a_32(record, record_size - LOG_CHECKSUM_SIZE)
+          != decode_uint(record + record_size - LOG_CHECKSUM_SIZE,
+                         LOG_CHECKSUM_SIZE))
+        break;
+
+      entry = apr_pcalloc(index->data_pool, sizeof(*entry));
+      if (record[0] == LOG_OP_LOCK)
+        {
+          SVN_ERR(parse_lock(&entry->lock, payload, (apr_size_t)len,
+                             index->log_path, index->data_pool));
+          svn_hash_sets(index->log, entry->lock->path, entry);
+        }
+      else if (record[0] == LOG_OP_UNLOCK && len && payload[len - 1] == '\0')
+        {
+          svn_hash_sets(index->log,
+                        apr_pstrdup(index->data_pool, payload), entry);
+        }
+      else
+        {
+          return svn_error_trace(corrupt_index(index->log_path,
+                                               scratch_pool));
+        }
+
+      pos += record_size;
+      index->log_offset += record_size;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Make sure that the cached data in INDEX is up to date.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+refresh_index(svn_fs_fs__lock_index_t *index,
+              apr_pool_t *scratch_pool)
+{
+  /* Logs are bound to the generation of their run, so we never apply the
+   * records of one run's log to another run.  Because writers replace the
+   * run before they start a new log, the run generation must not have
+   * changed after we read the log, otherwise we might miss the records
+   * merged into the new run. */
+  while (TRUE)
+    {
+      svn_boolean_t truncated;
+      apr_uint64_t generation;
+
+      if (!index->loaded)
+        SVN_ERR(map_run(index, scratch_pool));
+
+      SVN_ERR(read_log(&truncated, index, scratch_pool));
+      if (!truncated)
+        {
+          SVN_ERR(read_generation(&generation, index->run_path,
+                                  scratch_pool));
+          if (generation == index->generation)
+            return SVN_NO_ERROR;
+        }
+
+      index->loaded = FALSE;
+    }
+}
+
+
+/* Writing */
+
+/* Implements svn_sort__array's comparison function for arrays of
+ * run_entry_t. */
+static int
+compare_run_entries(const void *lhs,
+                    const void *rhs)
+{
+  const run_entry_t *a = lhs;
+  const run_entry_t *b = rhs;
+
+  return svn_path_compare_paths(a->path, b->path);
+}
+
+/* Write the run_entry_t elements of ENTRIES as a new run file with the
+ * given GENERATION to RUN_PATH in FS.  ENTRIES will be sorted by this
+ * function.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+write_run(const char *run_path,
+          apr_array_header_t *entries,
+          apr_uint64_t generation,
+          svn_fs_t *fs,
+          apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const char *tmp_path = apr_pstrcat(scratch_pool, run_path, ".tmp",
+                                     SVN_VA_NULL);
+  unsigned char header[RUN_HEADER_SIZE];
+  unsigned char *offsets;
+  apr_uint64_t offset;
+  apr_file_t *file;
+  int i;
+
+  svn_sort__array(entries, compare_run_entries);
+
+  memcpy(header, RUN_MAGIC, 8);
+  encode_uint(header + 8, generation, 8);
+  encode_uint(header + 16, entries->nelts, 8);
+
+  offsets = apr_palloc(scratch_pool, entries->nelts * OFFSET_SIZE + 1);
+  offset = RUN_HEADER_SIZE + (apr_uint64_t)entries->nelts * OFFSET_SIZE;
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      encode_uint(offsets + i * OFFSET_SIZE, offset, OFFSET_SIZE);
+      offset += APR_ARRAY_IDX(entries, i, run_entry_t).len;
+    }
+
+  SVN_ERR(svn_io_file_open(&file, tmp_path,
+                           APR_WRITE | APR_CREATE | APR_TRUNCATE
+                           | APR_BUFFERED | APR_BINARY,
+                           APR_OS_DEFAULT, scratch_pool));
+  SVN_ERR(svn_io_file_write_full(file, header, sizeof(header), NULL,
+                                 scratch_pool));
+  SVN_ERR(svn_io_file_write_full(file, offsets,
+                                 entries->nelts * OFFSET_SIZE, NULL,
+                                 scratch_pool));
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      const run_entry_t *entry = &APR_ARRAY_IDX(entries, i, run_entry_t);
+      SVN_ERR(svn_io_file_write_full(file, entry->data, entry->len, NULL,
+                                     scratch_pool));
+    }
+  SVN_ERR(svn_io_file_close(file, scratch_pool));
+
+  return svn_error_trace(svn_fs_fs__move_into_place(tmp_path, run_path,
+                           svn_fs_fs__path_current(fs, scratch_pool),
+                           ffd->flush_to_disk, scratch_pool));
+}
+
+/* Truncate the log file at LOG_PATH, if it exists.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+truncate_log(const char *log_path,
+             apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  svn_error_t *err;
+
+  err = svn_io_file_open(&file, log_path,
+                         APR_WRITE | APR_TRUNCATE | APR_BINARY,
+                         APR_OS_DEFAULT, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  return svn_error_trace(svn_io_file_close(file, scratch_pool));
+}
+
+/* Append the serialized form of LOCK to ENTRIES.  Allocate the data in
+ * RESULT_POOL. */
+static void
+add_run_entry(apr_array_header_t *entries,
+              const svn_lock_t *lock,
+              apr_pool_t *result_pool)
+{
+  svn_stringbuf_t *buffer = svn_stringbuf_create_empty(result_pool);
+  run_entry_t *entry = apr_array_push(entries);
+
+  serialize_lock(buffer, lock, result_pool);
+  entry->path = lock->path;
+  entry->data = buffer->data;
+  entry->len = buffer->len;
+}
+
+/* Merge the log of INDEX of FS into a new run.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+compact_index(svn_fs_fs__lock_index_t *index,
+              svn_fs_t *fs,
+              apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *entries
+    = apr_array_make(scratch_pool,
+                     (int)index->count + apr_hash_count(index->log),
+                     sizeof(run_entry_t));
+  apr_hash_index_t *hi;
+  apr_uint64_t i;
+
+  /* Locks in the run that have not been replaced or removed since. */
+  for (i = 0; i < index->count; ++i)
+    {
+      run_entry_t *entry;
+      apr_size_t len;
+      const char *record = run_record(&len, index, i);
+
+      if (svn_hash_gets(index->log, record))
+        continue;
+
+      entry = apr_array_push(entries);
+      entry->path = record;
+      entry->data = record;
+      entry->len = len;
+    }
+
+  /* Locks added since. */
+  for (hi = apr_hash_first(scratch_pool, index->log);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      log_entry_t *log_entry = apr_hash_this_val(hi);
+      if (log_entry->lock)
+        add_run_entry(entries, log_entry->lock, scratch_pool);
+    }
+
+  SVN_ERR(write_run(index->run_path, entries, index->generation + 1, fs,
+                    scratch_pool));
+
+  /* The old log no longer applies to the new run.  Readers ignore it
+   * anyway, so this is only cleanup.  See read_log(). */
+  index->loaded = FALSE;
+  SVN_ERR(truncate_log(index->log_path, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Library-private API's. */
+
+svn_error_t *
+svn_fs_fs__lock_index_exists(svn_boolean_t *exists,
+                             svn_fs_t *fs,
+                             apr_pool_t *pool)
+{
+  svn_node_kind_t kind;
+
+  SVN_ERR(svn_io_check_path(svn_dirent_join_many(pool, fs->path,
+                                                 PATH_LOCKS_DIR,
+                                                 RUN_FILE_NAME,
+                                                 SVN_VA_NULL),
+                            &kind, pool));
+
+  *exists = (kind == svn_node_file);
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__lock_index_create(svn_fs_t *fs,
+                             const apr_array_header_t *locks,
+                             apr_pool_t *scratch_pool)
+{
+  const char *dir = svn_dirent_join(fs->path, PATH_LOCKS_DIR, scratch_pool);
+  const char *run_path = svn_dirent_join(dir, RUN_FILE_NAME, scratch_pool);
+  apr_array_header_t *entries = apr_array_make(scratch_pool, locks->nelts,
+                                               sizeof(run_entry_t));
+  apr_uint64_t generation;
+  int i;
+
+  SVN_ERR(svn_fs_fs__ensure_dir_exists(dir, fs->path, scratch_pool));
+
+  for (i = 0; i < locks->nelts; ++i)
+    add_run_entry(entries, APR_ARRAY_IDX(locks, i, const svn_lock_t *),
+                  scratch_pool);
+
+  /* Bump the generation, such that readers will notice the new run. */
+  SVN_ERR(read_generation(&generation, run_path, scratch_pool));
+  SVN_ERR(write_run(run_path, entries, generation + 1, fs, scratch_pool));
+
+  return svn_error_trace(truncate_log(svn_dirent_join(dir, LOG_FILE_NAME,
+                                                      scratch_pool),
+                                      scratch_pool));
+}
+
+svn_error_t *
+svn_fs_fs__lock_index_open(svn_fs_fs__lock_index_t **index,
+                           svn_fs_t *fs,
+                           apr_pool_t *result_pool)
+{
+  svn_fs_fs__lock_index_t *result = apr_pcalloc(result_pool,
+                                                sizeof(*result));
+  const char *dir = svn_dirent_join(fs->path, PATH_LOCKS_DIR, result_pool);
+
+  result->run_path = svn_dirent_join(dir, RUN_FILE_NAME, result_pool);
+  result->log_path = svn_dirent_join(dir, LOG_FILE_NAME, result_pool);
+  result->data_pool = svn_pool_create(result_pool);
+
+  *index = result;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__lock_index_get(svn_lock_t **lock_p,
+                          svn_fs_fs__lock_index_t *index,
+                          const char *path,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  log_entry_t *entry;
+  apr_uint64_t idx;
+
+  SVN_ERR(refresh_index(index, scratch_pool));
+
+  /* Recent changes first. */
+  entry = svn_hash_gets(index->log, path);
+  if (entry)
+    {
+      *lock_p = entry->lock ? svn_lock_dup(entry->lock, result_pool) : NULL;
+      return SVN_NO_ERROR;
+    }
+
+  *lock_p = NULL;
+  idx = lower_bound(index, path);
+  if (idx < index->count)
+    {
+      apr_size_t len;
+      const char *record = run_record(&len, index, idx);
+
+      if (strcmp(record, path) == 0)
+        SVN_ERR(parse_lock(lock_p, record, len, index->run_path,
+                           result_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__lock_index_find(apr_array_header_t **locks_p,
+                           svn_fs_fs__lock_index_t *index,
+                           const char *path,
+                           apr_pool_t *result_pool,
+                           apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *locks = apr_array_make(result_pool, 16,
+                                             sizeof(svn_lock_t *));
+  apr_hash_index_t *hi;
+  apr_uint64_t idx;
+
+  SVN_ERR(refresh_index(index, scratch_pool));
+
+  /* All the locks at or below PATH form a contiguous range in the run. */
+  for (idx = lower_bound(index, path); idx < index->count; ++idx)
+    {
+      apr_size_t len;
+      const char *record = run_record(&len, index, idx);
+
+      if (!svn_fspath__skip_ancestor(path, record))
+        break;
+
+      /* Skip locks that have been replaced or removed since. */
+      if (!svn_hash_gets(index->log, record))
+        SVN_ERR(parse_lock(apr_array_push(locks), record, len,
+                           index->run_path, result_pool));
+    }
+
+  for (hi = apr_hash_first(scratch_pool, index->log);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      log_entry_t *entry = apr_hash_this_val(hi);
+      if (entry->lock && svn_fspath__skip_ancestor(path, entry->lock->path))
+        APR_ARRAY_PUSH(locks, svn_lock_t *)
+          = svn_lock_dup(entry->lock, result_pool);
+    }
+
+  *locks_p = locks;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__lock_index_any(svn_boolean_t *found,
+                          svn_fs_fs__lock_index_t *index,
+                          const char *path,
+                          apr_pool_t *scratch_pool)
+{
+  apr_hash_index_t *hi;
+  apr_uint64_t idx;
+
+  SVN_ERR(refresh_index(index, scratch_pool));
+
+  for (hi = apr_hash_first(scratch_pool, index->log);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      log_entry_t *entry = apr_hash_this_val(hi);
+      if (entry->lock && svn_fspath__skip_ancestor(path, entry->lock->path))
+        {
+          *found = TRUE;
+          return SVN_NO_ERROR;
+        }
+    }
+
+  /* Usually, the first lock in range will not have been removed. */
+  for (idx = lower_bound(index, path); idx < index->count; ++idx)
+    {
+      apr_size_t len;
+      const char *record = run_record(&len, index, idx);
+
+      if (!svn_fspath__skip_ancestor(path, record))
+        break;
+
+      if (!svn_hash_gets(index->log, record))
+        {
+          *found = TRUE;
+          return SVN_NO_ERROR;
+        }
+    }
+
+  *found = FALSE;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__lock_index_update(svn_fs_fs__lock_index_t *index,
+                             svn_fs_t *fs,
+                             const apr_array_header_t *locks,
+                             const apr_array_header_t *unlocks,
+                             apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *buffer = svn_stringbuf_create_empty(scratch_pool);
+  svn_stringbuf_t *lock_data = svn_stringbuf_create_empty(scratch_pool);
+  apr_file_t *file;
+  apr_off_t offset;
+  svn_error_t *err;
+  int i;
+
+  SVN_ERR(refresh_index(index, scratch_pool));
+
+  /* Serialize all operations into a single batch. */
+  for (i = 0; locks && i < locks->nelts; ++i)
+    {
+      const svn_lock_t *lock = APR_ARRAY_IDX(locks, i, const svn_lock_t *);
+
+      svn_stringbuf_setempty(lock_data);
+      serialize_lock(lock_data, lock, scratch_pool);
+      append_log_record(buffer, LOG_OP_LOCK, lock_data->data, lock_data->len);
+    }
+
+  for (i = 0; unlocks && i < unlocks->nelts; ++i)
+    {
+      const char *path = APR_ARRAY_IDX(unlocks, i, const char *);
+      append_log_record(buffer, LOG_OP_UNLOCK, path, strlen(path) + 1);
+    }
+
+  if (buffer->len == 0)
+    return SVN_NO_ERROR;
+
+  /* Start a new log for our run, if there is none, yet.  We hold the
+   * write lock, so any other log must belong to an older run. */
+  if (index->log_offset == 0)
+    {
+      svn_stringbuf_t *header
+        = svn_stringbuf_create_ensure(LOG_FILE_HEADER_SIZE + buffer->len,
+                                      scratch_pool);
+      unsigned char generation[8];
+
+      encode_uint(generation, index->generation, 8);
+      svn_stringbuf_appendbytes(header, LOG_MAGIC, 8);
+      svn_stringbuf_appendbytes(header, (const char *)generation, 8);
+      svn_stringbuf_appendstr(header, buffer);
+      buffer = header;
+    }
+
+  /* Replace any incomplete record left behind by an interrupted writer
+   * and any log of an older run. */
+  err = svn_io_file_open(&file, index->log_path,
+                         APR_WRITE | APR_CREATE | APR_BINARY,
+                         APR_OS_DEFAULT, scratch_pool);
+  if (!err && index->log_size != index->log_offset)
+    err = svn_io_file_trunc(file, index->log_offset, scratch_pool);
+  if (!err)
+    {
+      offset = index->log_offset;
+      err = svn_io_file_seek(file, APR_SET, &offset, scratch_pool);
+    }
+  if (!err)
+    err = svn_io_file_write_full(file, buffer->data, buffer->len, NULL,
+                                 scratch_pool);
+  if (!err)
+    err = svn_io_file_close(file, scratch_pool);
+
+#ifndef WIN32
+  if (!err && index->log_offset == 0)
+    err = svn_io_copy_perms(svn_fs_fs__path_current(fs, scratch_pool),
+                            index->log_path, scratch_pool);
+#endif
+
+  if (err)
+    {
+      /* Our cached view of the log is no longer reliable. */
+      index->loaded = FALSE;
+      return svn_error_trace(err);
+    }
+
+  /* Pick up our own changes. */
+  SVN_ERR(refresh_index(index, scratch_pool));
+
+  if (apr_hash_count(index->log) > MAX(MIN_LOG_RECORDS,
+                                       index->count / LOG_RATIO))
+    SVN_ERR(compact_index(index, fs, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
@@ -0,0 +1,123 @@
+/* lock-index.h : interface to the path-sorted lock index
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS_FS_LOCK_INDEX_H
+#define SVN_LIBSVN_FS_FS_LOCK_INDEX_H
+
+#include "svn_error.h"
+#include "svn_types.h"
+
+#include "fs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* The lock index is an alternative to the digest files in the locks
+ * directory.
+ *
+ * All locks are kept in a "run" file, sorted by path as per
+ * svn_path_compare_paths, such that all locks at or below any given path
+ * form a contiguous range.  The run starts with an offset table allowing
+ * for binary search.  Lock and unlock operations get appended to a log
+ * file.  Once the log grows too large relative to the run, both get
+ * merged into a new run file with an incremented generation number, and
+ * the log gets truncated.  The log header records the generation of the
+ * run it applies to, so readers never combine a run with a log that
+ * belongs to a different run.
+ *
+ * Both files live in the locks directory, so hotcopy picks them up.
+ * Readers don't take any locks.  Run files are only ever replaced
+ * atomically and are memory-mapped, if possible.  Writers must hold the
+ * FS write lock.
+ */
+
+/* Opaque in-memory state of the lock index, caching the mapped run file
+ * and the contents of the log file. */
+typedef struct svn_fs_fs__lock_index_t svn_fs_fs__lock_index_t;
+
+/* Set *EXISTS to TRUE iff the lock index of FS exists.
+   Use POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__lock_index_exists(svn_boolean_t *exists,
+                             svn_fs_t *fs,
+                             apr_pool_t *pool);
+
+/* Create a new lock index for FS containing the svn_lock_t * in LOCKS.
+   Any existing index will be replaced.  The caller must hold the FS write
+   lock.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__lock_index_create(svn_fs_t *fs,
+                             const apr_array_header_t *locks,
+                             apr_pool_t *scratch_pool);
+
+/* Open the existing lock index of FS and return it in *INDEX.  Allocate
+   the result in RESULT_POOL. */
+svn_error_t *
+svn_fs_fs__lock_index_open(svn_fs_fs__lock_index_t **index,
+                           svn_fs_t *fs,
+                           apr_pool_t *result_pool);
+
+/* Set *LOCK_P to the lock on PATH in INDEX or to NULL if there is none.
+   Expired locks are returned as well.  Allocate the result in RESULT_POOL
+   and use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__lock_index_get(svn_lock_t **lock_p,
+                          svn_fs_fs__lock_index_t *index,
+                          const char *path,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool);
+
+/* Set *LOCKS_P to all locks (svn_lock_t *) in INDEX on PATH or any path
+   below it, including expired ones.  Allocate the result in RESULT_POOL
+   and use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__lock_index_find(apr_array_header_t **locks_p,
+                           svn_fs_fs__lock_index_t *index,
+                           const char *path,
+                           apr_pool_t *result_pool,
+                           apr_pool_t *scratch_pool);
+
+/* Set *FOUND to TRUE if INDEX contains any lock on PATH or below it,
+   including expired ones.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__lock_index_any(svn_boolean_t *found,
+                          svn_fs_fs__lock_index_t *index,
+                          const char *path,
+                          apr_pool_t *scratch_pool);
+
+/* In INDEX of FS, add or replace all locks (svn_lock_t *) in LOCKS and
+   remove the locks on all paths (const char *) in UNLOCKS.  Either array
+   may be NULL.  The caller must hold the FS write lock.  Use SCRATCH_POOL
+   for temporary allocations. */
+svn_error_t *
+svn_fs_fs__lock_index_update(svn_fs_fs__lock_index_t *index,
+                             svn_fs_t *fs,
+                             const apr_array_header_t *locks,
+                             const apr_array_header_t *unlocks,
+                             apr_pool_t *scratch_pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_FS_FS_LOCK_INDEX_H */
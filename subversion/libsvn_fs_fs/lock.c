@@ -34,6 +34,7 @@
 #include <apr_file_info.h>
 
 #include "lock.h"
+#include "lock-index.h"
 #include "tree.h"
 #include "fs_fs.h"
 #include "util.h"
@@ -451,6 +452,34 @@ unlock_single(svn_fs_t *fs,
               svn_lock_t *lock,
               apr_pool_t *pool);
 
+/* Set *INDEX to the lock index of FS, if that has been enabled and
+   exists.  Otherwise, FS uses digest files and *INDEX will be NULL.
+   Use POOL for temporary allocations. */
+static svn_error_t *
+get_lock_index(svn_fs_fs__lock_index_t **index,
+               svn_fs_t *fs,
+               apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  *index = NULL;
+  if (!ffd->lock_index_enabled)
+    return SVN_NO_ERROR;
+
+  if (!ffd->lock_index)
+    {
+      svn_boolean_t exists;
+      SVN_ERR(svn_fs_fs__lock_index_exists(&exists, fs, pool));
+      if (!exists)
+        return SVN_NO_ERROR;
+
+      SVN_ERR(svn_fs_fs__lock_index_open(&ffd->lock_index, fs, fs->pool));
+    }
+
+  *index = ffd->lock_index;
+  return SVN_NO_ERROR;
+}
+
 /* Check if LOCK has been already expired. */
 static svn_boolean_t lock_expired(const svn_lock_t *lock)
 {
@@ -472,15 +501,24 @@ get_lock(svn_lock_t **lock_p,
          apr_pool_t *pool)
 {
   svn_lock_t *lock = NULL;
-  const char *digest_path;
-  svn_node_kind_t kind;
-
-  SVN_ERR(digest_path_from_path(&digest_path, fs->path, path, pool));
-  SVN_ERR(svn_io_check_path(digest_path, &kind, pool));
+  svn_fs_fs__lock_index_t *index;
 
   *lock_p = NULL;
-  if (kind != svn_node_none)
-    SVN_ERR(read_digest_file(NULL, &lock, fs->path, digest_path, pool));
+  SVN_ERR(get_lock_index(&index, fs, pool));
+  if (index)
+    {
+      SVN_ERR(svn_fs_fs__lock_index_get(&lock, index, path, pool, pool));
+    }
+  else
+    {
+      const char *digest_path;
+      svn_node_kind_t kind;
+
+      SVN_ERR(digest_path_from_path(&digest_path, fs->path, path, pool));
+      SVN_ERR(svn_io_check_path(digest_path, &kind, pool));
+      if (kind != svn_node_none)
+        SVN_ERR(read_digest_file(NULL, &lock, fs->path, digest_path, pool));
+    }
 
   if (! lock)
     return must_exist ? SVN_FS__ERR_NO_SUCH_LOCK(fs, path) : SVN_NO_ERROR;
@@ -595,6 +633,117 @@ walk_locks(svn_fs_t *fs,
 }
 
 
+/* Like walk_locks() but for FS using the lock INDEX and reporting all
+   locks on PATH and below. */
+static svn_error_t *
+walk_indexed_locks(svn_fs_t *fs,
+                   svn_fs_fs__lock_index_t *index,
+                   const char *path,
+                   svn_fs_get_locks_callback_t get_locks_func,
+                   void *get_locks_baton,
+                   svn_boolean_t have_write_lock,
+                   apr_pool_t *pool)
+{
+  apr_array_header_t *locks;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  /* Unlike digest files, the index gives us all locks in one go. */
+  SVN_ERR(svn_fs_fs__lock_index_find(&locks, index, path, pool, pool));
+  for (i = 0; i < locks->nelts; ++i)
+    {
+      svn_lock_t *lock = APR_ARRAY_IDX(locks, i, svn_lock_t *);
+      svn_pool_clear(iterpool);
+
+      if (lock_expired(lock))
+        {
+          /* Only remove the lock if we have the write lock.
+             Read operations shouldn't change the filesystem. */
+          if (have_write_lock)
+            SVN_ERR(unlock_single(fs, lock, iterpool));
+        }
+      else
+        {
+          SVN_ERR(get_locks_func(get_locks_baton, lock, iterpool));
+        }
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Call GET_LOCKS_FUNC/GET_LOCKS_BATON for all locks in and under PATH
+   in FS, using the lock index if FS has one.  HAVE_WRITE_LOCK is as for
+   walk_locks(). */
+static svn_error_t *
+walk_path_locks(svn_fs_t *fs,
+                const char *path,
+                svn_fs_get_locks_callback_t get_locks_func,
+                void *get_locks_baton,
+                svn_boolean_t have_write_lock,
+                apr_pool_t *pool)
+{
+  svn_fs_fs__lock_index_t *index;
+  const char *digest_path;
+
+  SVN_ERR(get_lock_index(&index, fs, pool));
+  if (index)
+    return svn_error_trace(walk_indexed_locks(fs, index, path,
+                                              get_locks_func,
+                                              get_locks_baton,
+                                              have_write_lock, pool));
+
+  SVN_ERR(digest_path_from_path(&digest_path, fs->path, path, pool));
+  return svn_error_trace(walk_locks(fs, digest_path, get_locks_func,
+                                    get_locks_baton, have_write_lock, pool));
+}
+
+/* Implements svn_fs_get_locks_callback_t, collecting copies of all locks
+   in the apr_array_header_t * BATON. */
+static svn_error_t *
+collect_locks_callback(void *baton,
+                       svn_lock_t *lock,
+                       apr_pool_t *pool)
+{
+  apr_array_header_t *locks = baton;
+  APR_ARRAY_PUSH(locks, svn_lock_t *)
+    = svn_lock_dup(lock, locks->pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *INDEX to the lock index of FS if that is enabled and to NULL
+   otherwise.  If the index is enabled but does not exist yet, create it
+   from the digest files.  The caller must hold the FS write lock.  Use
+   POOL for temporary allocations. */
+static svn_error_t *
+get_lock_index_for_writing(svn_fs_fs__lock_index_t **index,
+                           svn_fs_t *fs,
+                           apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  SVN_ERR(get_lock_index(index, fs, pool));
+  if (*index || !ffd->lock_index_enabled)
+    return SVN_NO_ERROR;
+
+  {
+    apr_array_header_t *locks = apr_array_make(pool, 16,
+                                               sizeof(svn_lock_t *));
+    const char *digest_path;
+
+    /* The root digest lists all locks in the repository.  Expired locks
+       will not be reported and simply don't get imported. */
+    SVN_ERR(digest_path_from_path(&digest_path, fs->path, "/", pool));
+    SVN_ERR(walk_locks(fs, digest_path, collect_locks_callback, locks,
+                       FALSE, pool));
+    SVN_ERR(svn_fs_fs__lock_index_create(fs, locks, pool));
+  }
+
+  return svn_error_trace(get_lock_index(index, fs, pool));
+}
+
+
 /* Utility function:  verify that a lock can be used.  Interesting
    errors returned from this function:
 
@@ -652,10 +801,8 @@ svn_fs_fs__allow_locked_operation(const char *path,
   if (recurse)
     {
       /* Discover all locks at or below the path. */
-      const char *digest_path;
-      SVN_ERR(digest_path_from_path(&digest_path, fs->path, path, pool));
-      SVN_ERR(walk_locks(fs, digest_path, get_locks_callback,
-                         fs, have_write_lock, pool));
+      SVN_ERR(walk_path_locks(fs, path, get_locks_callback,
+                              fs, have_write_lock, pool));
     }
   else
     {
@@ -668,6 +815,35 @@ svn_fs_fs__allow_locked_operation(const char *path,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__locks_exist(svn_boolean_t *exist,
+                       svn_fs_t *fs,
+                       const char *path,
+                       apr_pool_t *pool)
+{
+  svn_fs_fs__lock_index_t *index;
+
+  path = svn_fs__canonicalize_abspath(path, pool);
+  SVN_ERR(get_lock_index(&index, fs, pool));
+  if (index)
+    {
+      SVN_ERR(svn_fs_fs__lock_index_any(exist, index, path, pool));
+    }
+  else
+    {
+      /* There is a digest file for every locked path and every parent
+         of a locked path. */
+      const char *digest_path;
+      svn_node_kind_t kind;
+
+      SVN_ERR(digest_path_from_path(&digest_path, fs->path, path, pool));
+      SVN_ERR(svn_io_check_path(digest_path, &kind, pool));
+      *exist = (kind != svn_node_none);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Helper function called from the lock and unlock code.
    UPDATES is a map from "const char *" parent paths to "apr_array_header_t *"
    arrays of child paths.  For all of the parent paths of PATH this function
@@ -845,6 +1021,8 @@ lock_body(void *baton, apr_pool_t *pool)
   apr_hash_t *index_updates = apr_hash_make(pool);
   apr_hash_index_t *hi;
   apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_fs_fs__lock_index_t *lock_index;
+  apr_array_header_t *new_locks;
 
   /* Until we implement directory locks someday, we only allow locks
      on files. */
@@ -852,6 +1030,7 @@ lock_body(void *baton, apr_pool_t *pool)
      library dependencies, which are not portable. */
   SVN_ERR(lb->fs->vtable->youngest_rev(&youngest, lb->fs, pool));
   SVN_ERR(lb->fs->vtable->revision_root(&root, lb->fs, youngest, pool));
+  SVN_ERR(get_lock_index_for_writing(&lock_index, lb->fs, pool));
 
   for (i = 0; i < lb->targets->nelts; ++i)
     {
@@ -869,8 +1048,8 @@ lock_body(void *baton, apr_pool_t *pool)
                          youngest, iterpool));
 
       /* If no error occurred while pre-checking, schedule the index updates for
-         this path. */
-      if (!info.fs_err)
+         this path.  The lock index does not need any. */
+      if (!info.fs_err && !lock_index)
         schedule_index_update(index_updates, info.path, iterpool);
 
       APR_ARRAY_PUSH(lb->infos, struct lock_info_t) = info;
@@ -897,6 +1076,7 @@ lock_body(void *baton, apr_pool_t *pool)
                             iterpool));
     }
 
+  new_locks = apr_array_make(pool, lb->infos->nelts, sizeof(svn_lock_t *));
   for (i = 0; i < lb->infos->nelts; ++i)
     {
       struct lock_info_t *info = &APR_ARRAY_IDX(lb->infos, i,
@@ -925,8 +1105,28 @@ lock_body(void *baton, apr_pool_t *pool)
           info->lock->creation_date = apr_time_now();
           info->lock->expiration_date = lb->expiration_date;
 
-          info->fs_err = set_lock(lb->fs->path, info->lock, rev_0_path,
-                                  iterpool);
+          /* With the lock index, all locks get written in one batch. */
+          if (lock_index)
+            APR_ARRAY_PUSH(new_locks, svn_lock_t *) = info->lock;
+          else
+            info->fs_err = set_lock(lb->fs->path, info->lock, rev_0_path,
+                                    iterpool);
+        }
+    }
+
+  if (new_locks->nelts)
+    {
+      svn_error_t *err = svn_fs_fs__lock_index_update(lock_index, lb->fs,
+                                                      new_locks, NULL,
+                                                      iterpool);
+      if (err)
+        {
+          /* None of the locks has been created. */
+          for (i = 0; i < lb->infos->nelts; ++i)
+            APR_ARRAY_IDX(lb->infos, i, struct lock_info_t).lock = NULL;
+
+          svn_pool_destroy(iterpool);
+          return svn_error_trace(err);
         }
     }
 
@@ -997,9 +1197,12 @@ unlock_body(void *baton, apr_pool_t *pool)
   apr_hash_t *indices_updates = apr_hash_make(pool);
   apr_hash_index_t *hi;
   apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_fs_fs__lock_index_t *lock_index;
+  apr_array_header_t *unlocks;
 
   SVN_ERR(ub->fs->vtable->youngest_rev(&youngest, ub->fs, pool));
   SVN_ERR(ub->fs->vtable->revision_root(&root, ub->fs, youngest, pool));
+  SVN_ERR(get_lock_index_for_writing(&lock_index, ub->fs, pool));
 
   for (i = 0; i < ub->targets->nelts; ++i)
     {
@@ -1019,8 +1222,8 @@ unlock_body(void *baton, apr_pool_t *pool)
                              iterpool));
 
       /* If no error occurred while pre-checking, schedule the index updates for
-         this path. */
-      if (!info.fs_err)
+         this path.  The lock index does not need any. */
+      if (!info.fs_err && !lock_index)
         schedule_index_update(indices_updates, info.path, iterpool);
 
       APR_ARRAY_PUSH(ub->infos, struct unlock_info_t) = info;
@@ -1028,6 +1231,31 @@ unlock_body(void *baton, apr_pool_t *pool)
 
   rev_0_path = svn_fs_fs__path_rev_absolute(ub->fs, 0, pool);
 
+  /* With the lock index, all locks get removed in one batch. */
+  if (lock_index)
+    {
+      unlocks = apr_array_make(pool, ub->infos->nelts, sizeof(const char *));
+      for (i = 0; i < ub->infos->nelts; ++i)
+        {
+          struct unlock_info_t *info = &APR_ARRAY_IDX(ub->infos, i,
+                                                      struct unlock_info_t);
+          if (! info->fs_err)
+            APR_ARRAY_PUSH(unlocks, const char *) = info->path;
+        }
+
+      SVN_ERR(svn_fs_fs__lock_index_update(lock_index, ub->fs, NULL, unlocks,
+                                           iterpool));
+      for (i = 0; i < ub->infos->nelts; ++i)
+        {
+          struct unlock_info_t *info = &APR_ARRAY_IDX(ub->infos, i,
+                                                      struct unlock_info_t);
+          info->done = !info->fs_err;
+        }
+
+      svn_pool_destroy(iterpool);
+      return SVN_NO_ERROR;
+    }
+
   /* Unlike the lock_body(), we need to delete locks *before* we start to
      update indices. */
 
@@ -1348,7 +1576,6 @@ svn_fs_fs__get_locks(svn_fs_t *fs,
                      void *get_locks_baton,
                      apr_pool_t *pool)
 {
-  const char *digest_path;
   get_locks_filter_baton_t glfb;
 
   SVN_ERR(svn_fs__check_fs(fs, TRUE));
@@ -1359,9 +1586,8 @@ svn_fs_fs__get_locks(svn_fs_t *fs,
   glfb.get_locks_func = get_locks_func;
   glfb.get_locks_baton = get_locks_baton;
 
-  /* Get the top digest path in our tree of interest, and then walk it. */
-  SVN_ERR(digest_path_from_path(&digest_path, fs->path, path, pool));
-  SVN_ERR(walk_locks(fs, digest_path, get_locks_filter_func, &glfb,
-                     FALSE, pool));
+  /* Walk all locks in our tree of interest. */
+  SVN_ERR(walk_path_locks(fs, path, get_locks_filter_func, &glfb,
+                          FALSE, pool));
   return SVN_NO_ERROR;
 }
@@ -103,6 +103,16 @@ svn_error_t *svn_fs_fs__allow_locked_operation(const char *path,
                                                svn_boolean_t have_write_lock,
                                                apr_pool_t *pool);
 
+/* Set *EXIST to FALSE if there are no locks on PATH or below it in FS.
+   Otherwise, set it to TRUE.  Expired locks may count as existing.
+   This is much cheaper than svn_fs_fs__allow_locked_operation and allows
+   callers to skip lock verification altogether.  Use POOL for temporary
+   allocations. */
+svn_error_t *svn_fs_fs__locks_exist(svn_boolean_t *exist,
+                                    svn_fs_t *fs,
+                                    const char *path,
+                                    apr_pool_t *pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -61,6 +61,7 @@
 /* Kinds of representation. */
 #define REP_PLAIN          "PLAIN"
 #define REP_DELTA          "DELTA"
+#define REP_RDELTA         "RDELTA"
 
 /* An arbitrary maximum path length, so clients can't run us out of memory
  * by giving us arbitrarily large paths. */
@@ -1273,14 +1274,32 @@ svn_fs_fs__read_rep_header(svn_fs_fs__rep_header_t **header,
       return SVN_NO_ERROR;
     }
 
-  (*header)->type = svn_fs_fs__rep_delta;
-
-  /* We have hopefully a DELTA vs. a non-empty base revision. */
+  /* We have hopefully a DELTA vs. a non-empty base revision or
+   * a re-encoded DELTA. */
   last_str = buffer->data;
   str = svn_cstring_tokenize(" ", &last_str);
-  if (! str || (strcmp(str, REP_DELTA) != 0))
+  if (str && (strcmp(str, REP_RDELTA) == 0))
+    {
+      str = svn_cstring_tokenize(" ", &last_str);
+      if (! str)
+        goto error;
+      SVN_ERR(svn_cstring_atoi64(&val, str));
+      if (val <= 0)
+        goto error;
+      (*header)->data_size = (svn_filesize_t)val;
+
+      /* Without a base, this is a delta against the empty stream. */
+      if (*last_str == '\0')
+        {
+          (*header)->type = svn_fs_fs__rep_self_delta;
+          return SVN_NO_ERROR;
+        }
+    }
+  else if (! str || (strcmp(str, REP_DELTA) != 0))
     goto error;
 
+  (*header)->type = svn_fs_fs__rep_delta;
+
   SVN_ERR(parse_revnum(&(*header)->base_revision, (const char **)&last_str));
 
   str = svn_cstring_tokenize(" ", &last_str);
@@ -1309,6 +1328,23 @@ svn_fs_fs__write_rep_header(svn_fs_fs__rep_header_t *header,
 {
   const char *text;
 
+  /* Re-encoded deltas need to tell their actual data size. */
+  if (header->data_size)
+    {
+      if (header->type == svn_fs_fs__rep_self_delta)
+        text = apr_psprintf(scratch_pool, REP_RDELTA " %" SVN_FILESIZE_T_FMT
+                                          "\n",
+                            header->data_size);
+      else
+        text = apr_psprintf(scratch_pool, REP_RDELTA " %" SVN_FILESIZE_T_FMT
+                                          " %ld %" APR_OFF_T_FMT
+                                          " %" SVN_FILESIZE_T_FMT "\n",
+                            header->data_size, header->base_revision,
+                            header->base_item_index, header->base_length);
+
+      return svn_error_trace(svn_stream_puts(stream, text));
+    }
+
   switch (header->type)
     {
       case svn_fs_fs__rep_plain:
@@ -1328,3 +1364,298 @@ svn_fs_fs__write_rep_header(svn_fs_fs__rep_header_t *header,
 
   return svn_error_trace(svn_stream_puts(stream, text));
 }
+
+/* Sorted directory representations (format 9+) look like this:
+ *
+ *   "SDIR" <count> <length>*count <entry>*count
+ *
+ * COUNT and all LENGTHs are 32 bit unsigned little-endian numbers.
+ * Each LENGTH gives the size of the respective entry.  An entry consists
+ * of the entry name, a NUL, the kind ('f' or 'd'), the unparsed noderev
+ * ID and another NUL.  Entries are sorted by name.
+ *
+ * Storing lengths instead of absolute offsets keeps the table stable when
+ * entries get added or removed, which is what allows directory reps to be
+ * deltified efficiently.  After reading a rep from disk,
+ * svn_fs_fs__index_sorted_dir replaces the lengths with the offsets of the
+ * entries relative to the beginning of the representation, such that
+ * lookups can bisect the table.
+ *
+ * A hash dump always starts with either "K " or "END", so the magic
+ * prefix is sufficient to tell both directory formats apart.
+ */
+#define SORTED_DIR_MAGIC "SDIR"
+#define SORTED_DIR_MAGIC_LEN (sizeof(SORTED_DIR_MAGIC) - 1)
+#define SORTED_DIR_HEADER_LEN (SORTED_DIR_MAGIC_LEN + 4)
+
+/* Store VALUE as 32 bit little-endian number at P. */
+static void
+encode_uint32(char *p,
+              apr_uint32_t value)
+{
+  unsigned char *bytes = (unsigned char *)p;
+
+  bytes[0] = (unsigned char)(value & 0xff);
+  bytes[1] = (unsigned char)((value >> 8) & 0xff);
+  bytes[2] = (unsigned char)((value >> 16) & 0xff);
+  bytes[3] = (unsigned char)((value >> 24) & 0xff);
+}
+
+/* Append VALUE as 32 bit little-endian number to BUFFER. */
+static void
+append_uint32(svn_stringbuf_t *buffer,
+              apr_uint32_t value)
+{
+  char bytes[4];
+
+  encode_uint32(bytes, value);
+  svn_stringbuf_appendbytes(buffer, bytes, sizeof(bytes));
+}
+
+/* Return the 32 bit little-endian number stored at P. */
+static apr_uint32_t
+decode_uint32(const char *p)
+{
+  const unsigned char *bytes = (const unsigned char *)p;
+
+  return (apr_uint32_t)bytes[0]
+       | ((apr_uint32_t)bytes[1] << 8)
+       | ((apr_uint32_t)bytes[2] << 16)
+       | ((apr_uint32_t)bytes[3] << 24);
+}
+
+/* Return the error to use for malformed sorted directory reps. */
+static svn_error_t *
+sorted_dir_corrupt(void)
+{
+  return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                          _("Sorted directory representation corrupt"));
+}
+
+/* Verify the header of the sorted directory representation given by DATA
+ * and LEN and return the number of entries in *COUNT. */
+static svn_error_t *
+read_sorted_dir_header(apr_uint32_t *count,
+                       const char *data,
+                       apr_size_t len)
+{
+  /* The final NUL allows us to use C string functions on entry names. */
+  if (!svn_fs_fs__is_sorted_dir(data, len) || data[len - 1] != '\0')
+    return svn_error_trace(sorted_dir_corrupt());
+
+  *count = decode_uint32(data + SORTED_DIR_MAGIC_LEN);
+  if (*count > (len - SORTED_DIR_HEADER_LEN) / 4)
+    return svn_error_trace(sorted_dir_corrupt());
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the offset of entry number IDX in the indexed sorted directory
+ * representation given by DATA and LEN in *OFFSET. */
+static svn_error_t *
+get_sorted_dir_offset(apr_size_t *offset,
+                      const char *data,
+                      apr_size_t len,
+                      apr_uint32_t idx)
+{
+  *offset = decode_uint32(data + SORTED_DIR_HEADER_LEN + 4 * (apr_size_t)idx);
+  if (*offset < SORTED_DIR_HEADER_LEN || *offset >= len)
+    return svn_error_trace(sorted_dir_corrupt());
+
+  return SVN_NO_ERROR;
+}
+
+/* Parse the entry starting at OFFSET in the sorted directory
+ * representation given by DATA and LEN and return it in *DIRENT.
+ * Allocate the result in RESULT_POOL. */
+static svn_error_t *
+parse_sorted_dir_entry(svn_fs_dirent_t **dirent,
+                       const char *data,
+                       apr_size_t len,
+                       apr_size_t offset,
+                       apr_pool_t *result_pool)
+{
+  svn_fs_dirent_t *result;
+  const char *name = data + offset;
+  apr_size_t name_len = strlen(name);
+  const char *kind = name + name_len + 1;
+
+  /* We need the kind, a non-empty ID and its terminator. */
+  if (kind + 2 >= data + len)
+    return svn_error_trace(sorted_dir_corrupt());
+
+  result = apr_palloc(result_pool, sizeof(*result));
+  result->name = apr_pstrmemdup(result_pool, name, name_len);
+
+  if (*kind == 'f')
+    result->kind = svn_node_file;
+  else if (*kind == 'd')
+    result->kind = svn_node_dir;
+  else
+    return svn_error_trace(sorted_dir_corrupt());
+
+  SVN_ERR(svn_fs_fs__id_parse(&result->id, apr_pstrdup(result_pool, kind + 1),
+                              result_pool));
+
+  *dirent = result;
+  return SVN_NO_ERROR;
+}
+
+svn_boolean_t
+svn_fs_fs__is_sorted_dir(const char *data,
+                         apr_size_t len)
+{
+  return len >= SORTED_DIR_HEADER_LEN
+      && memcmp(data, SORTED_DIR_MAGIC, SORTED_DIR_MAGIC_LEN) == 0;
+}
+
+svn_error_t *
+svn_fs_fs__write_sorted_dir(svn_stream_t *stream,
+                            apr_array_header_t *entries,
+                            apr_pool_t *scratch_pool)
+{
+  svn_string_t **ids = apr_palloc(scratch_pool,
+                                  (entries->nelts + 1) * sizeof(*ids));
+  apr_uint64_t offset = SORTED_DIR_HEADER_LEN
+                      + 4 * (apr_uint64_t)entries->nelts;
+  svn_stringbuf_t *buffer = svn_stringbuf_create_ensure((apr_size_t)offset,
+                                                        scratch_pool);
+  apr_size_t length;
+  int i;
+
+  /* Header and length table. */
+  svn_stringbuf_appendbytes(buffer, SORTED_DIR_MAGIC, SORTED_DIR_MAGIC_LEN);
+  append_uint32(buffer, (apr_uint32_t)entries->nelts);
+
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      svn_fs_dirent_t *dirent = APR_ARRAY_IDX(entries, i, svn_fs_dirent_t *);
+
+      SVN_ERR_ASSERT(i == 0 || strcmp(APR_ARRAY_IDX(entries, i - 1,
+                                                    svn_fs_dirent_t *)->name,
+                                      dirent->name) < 0);
+
+      if (offset > APR_UINT32_MAX)
+        return svn_error_create(SVN_ERR_FS_GENERAL, NULL,
+                                _("Directory too large for the sorted "
+                                  "directory representation"));
+
+      ids[i] = svn_fs_fs__id_unparse(dirent->id, scratch_pool);
+      length = strlen(dirent->name) + 1 + 1 + ids[i]->len + 1;
+      append_uint32(buffer, (apr_uint32_t)length);
+      offset += length;
+    }
+
+  SVN_ERR(svn_stream_write(stream, buffer->data, &buffer->len));
+
+  /* The entries themselves. */
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      svn_fs_dirent_t *dirent = APR_ARRAY_IDX(entries, i, svn_fs_dirent_t *);
+
+      /* Both strings get written including their terminating NUL. */
+      svn_stringbuf_setempty(buffer);
+      svn_stringbuf_appendbytes(buffer, dirent->name,
+                                strlen(dirent->name) + 1);
+      svn_stringbuf_appendbyte(buffer,
+                               dirent->kind == svn_node_file ? 'f' : 'd');
+      svn_stringbuf_appendbytes(buffer, ids[i]->data, ids[i]->len + 1);
+      SVN_ERR(svn_stream_write(stream, buffer->data, &buffer->len));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__index_sorted_dir(char *data,
+                            apr_size_t len)
+{
+  apr_uint32_t count;
+  apr_uint32_t i;
+  apr_uint64_t offset;
+  char *table = data + SORTED_DIR_HEADER_LEN;
+
+  SVN_ERR(read_sorted_dir_header(&count, data, len));
+
+  offset = SORTED_DIR_HEADER_LEN + 4 * (apr_uint64_t)count;
+  for (i = 0; i < count; ++i, table += 4)
+    {
+      apr_uint32_t length = decode_uint32(table);
+      if (offset > APR_UINT32_MAX)
+        return svn_error_trace(sorted_dir_corrupt());
+
+      encode_uint32(table, (apr_uint32_t)offset);
+      offset += length;
+    }
+
+  /* The entries must cover the remainder of the rep exactly. */
+  if (offset != len)
+    return svn_error_trace(sorted_dir_corrupt());
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__read_sorted_dir(apr_array_header_t **entries_p,
+                           const char *data,
+                           apr_size_t len,
+                           apr_pool_t *result_pool)
+{
+  apr_array_header_t *entries;
+  apr_uint32_t count;
+  apr_uint32_t i;
+
+  SVN_ERR(read_sorted_dir_header(&count, data, len));
+
+  entries = apr_array_make(result_pool, count, sizeof(svn_fs_dirent_t *));
+  for (i = 0; i < count; ++i)
+    {
+      apr_size_t offset;
+      svn_fs_dirent_t *dirent;
+
+      SVN_ERR(get_sorted_dir_offset(&offset, data, len, i));
+      SVN_ERR(parse_sorted_dir_entry(&dirent, data, len, offset,
+                                     result_pool));
+      APR_ARRAY_PUSH(entries, svn_fs_dirent_t *) = dirent;
+    }
+
+  *entries_p = entries;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__find_sorted_dir_entry(svn_fs_dirent_t **dirent,
+                                 const char *data,
+                                 apr_size_t len,
+                                 const char *name,
+                                 apr_pool_t *result_pool)
+{
+  apr_uint32_t count;
+  apr_uint32_t lower = 0;
+  apr_uint32_t upper;
+
+  SVN_ERR(read_sorted_dir_header(&count, data, len));
+
+  /* Bisect the offset table.  Only the matching entry gets parsed. */
+  upper = count;
+  while (lower < upper)
+    {
+      apr_uint32_t middle = lower + (upper - lower) / 2;
+      apr_size_t offset;
+      int diff;
+
+      SVN_ERR(get_sorted_dir_offset(&offset, data, len, middle));
+      diff = strcmp(data + offset, name);
+      if (diff == 0)
+        return svn_error_trace(parse_sorted_dir_entry(dirent, data, len,
+                                                      offset, result_pool));
+
+      if (diff < 0)
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+
+  *dirent = NULL;
+  return SVN_NO_ERROR;
+}
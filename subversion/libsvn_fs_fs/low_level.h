@@ -37,6 +37,7 @@
  * - node revision
  * - representation (as in "text:" and "props:" lines)
  * - representation header ("PLAIN" and "DELTA" lines)
+ * - sorted directory representation (since format 9)
  */
 
 /* Given the last "few" bytes (should be at least 40) of revision REV in
@@ -212,6 +213,13 @@ typedef struct svn_fs_fs__rep_header_t
    * size of that base rep.  Should be 0 if there is no base rep. */
   svn_filesize_t base_length;
 
+  /* if this delta has been re-encoded after it had been written, e.g. with
+   * a different compression during pack, this is the actual length of its
+   * svndiff data.  The representation's SIZE remains the original one, as
+   * that is what node-revisions, the rep-cache and dependent deltas refer
+   * to.  0 for representations that have never been re-encoded. */
+  svn_filesize_t data_size;
+
   /* length of the textual representation of the header in the rep or pack
    * file, including EOL.  Only valid after reading it from disk.
    * Should be 0 otherwise. */
@@ -233,3 +241,45 @@ svn_error_t *
 svn_fs_fs__write_rep_header(svn_fs_fs__rep_header_t *header,
                             svn_stream_t *stream,
                             apr_pool_t *scratch_pool);
+
+/* Return TRUE, if the directory representation contents given by DATA
+ * and LEN uses the sorted format instead of the hash dump format. */
+svn_boolean_t
+svn_fs_fs__is_sorted_dir(const char *data,
+                         apr_size_t len);
+
+/* Write the directory given as array of svn_fs_dirent_t * in ENTRIES to
+ * STREAM, using the sorted directory representation.  ENTRIES must be
+ * sorted by name.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__write_sorted_dir(svn_stream_t *stream,
+                            apr_array_header_t *entries,
+                            apr_pool_t *scratch_pool);
+
+/* Replace the entry lengths in the sorted directory representation given
+ * by DATA and LEN, as read from disk, with the entry offsets that
+ * svn_fs_fs__read_sorted_dir and svn_fs_fs__find_sorted_dir_entry expect.
+ * DATA gets modified in place and must not be indexed twice. */
+svn_error_t *
+svn_fs_fs__index_sorted_dir(char *data,
+                            apr_size_t len);
+
+/* Parse the indexed sorted directory representation given by DATA and LEN
+ * and return all of its entries as an array of svn_fs_dirent_t * sorted by
+ * name in *ENTRIES_P.  Allocate the result in RESULT_POOL. */
+svn_error_t *
+svn_fs_fs__read_sorted_dir(apr_array_header_t **entries_p,
+                           const char *data,
+                           apr_size_t len,
+                           apr_pool_t *result_pool);
+
+/* Binary search the indexed sorted directory representation given by
+ * DATA and LEN for the entry called NAME and return it in *DIRENT.  Set *DIRENT
+ * to NULL, if there is no such entry.  Only that entry gets parsed.
+ * Allocate the result in RESULT_POOL. */
+svn_error_t *
+svn_fs_fs__find_sorted_dir_entry(svn_fs_dirent_t **dirent,
+                                 const char *data,
+                                 apr_size_t len,
+                                 const char *name,
+                                 apr_pool_t *result_pool);
@@ -0,0 +1,371 @@
+/* noderev-log.c --- node-revision store of a transaction in a single file
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "svn_hash.h"
+#include "svn_pools.h"
+#include "svn_dirent_uri.h"
+
+#include "fs_fs.h"
+#include "id.h"
+#include "low_level.h"
+#include "noderev-log.h"
+#include "util.h"
+#include "../libsvn_fs/fs-loader.h"
+
+#include "svn_private_config.h"
+
+struct svn_fs_fs__noderev_log_t
+{
+  /* Path of the log file.  NULL if the transaction does not use a log. */
+  const char *path;
+
+  /* Number of bytes at the start of the log file that have been parsed
+   * into NODEREVS. */
+  apr_off_t size;
+
+  /* Latest version of each node-revision, serialized as svn_stringbuf_t *
+   * and keyed by unparsed node-revision ID.  Newer versions overwrite the
+   * buffer of older ones, such that memory usage is bounded by the size of
+   * the latest versions.  Deleted node-revisions have empty buffers. */
+  apr_hash_t *noderevs;
+
+  /* Pool containing this structure and everything referenced by it.
+   * Lives as long as the transaction is known to FFD->NODEREV_LOGS. */
+  apr_pool_t *pool;
+};
+
+/* Add the complete records in the LEN bytes at DATA to LOG and return
+ * the number of bytes consumed in *CONSUMED.  Use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_error_t *
+parse_records(apr_size_t *consumed,
+              svn_fs_fs__noderev_log_t *log,
+              const char *data,
+              apr_size_t len,
+              apr_pool_t *scratch_pool)
+{
+  const char *current = data;
+  const char *end = data + len;
+
+  while (current < end)
+    {
+      const char *eol = memchr(current, '\n', end - current);
+      const char *space;
+      apr_size_t key_len;
+
+      /* Incomplete header line? */
+      if (eol == NULL)
+        break;
+
+      for (space = eol - 1; space > current && *space != ' '; --space)
+        ;
+      if (space == current)
+        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                                 _("Corrupt node-revision log '%s'"),
+                                 svn_dirent_local_style(log->path,
+                                                        scratch_pool));
+
+      key_len = space - current;
+      if (eol - space == 2 && space[1] == '-')
+        {
+          svn_stringbuf_t *value = apr_hash_get(log->noderevs, current,
+                                                key_len);
+          if (value)
+            svn_stringbuf_setempty(value);
+
+          current = eol + 1;
+        }
+      else
+        {
+          apr_uint64_t length;
+          svn_stringbuf_t *value;
+
+          SVN_ERR(svn_cstring_strtoui64(&length,
+                                        apr_pstrmemdup(scratch_pool,
+                                                       space + 1,
+                                                       eol - space - 1),
+                                        0, APR_SIZE_MAX, 10));
+
+          /* Incomplete node-revision? */
+          if (length > (apr_uint64_t)(end - eol - 1))
+            break;
+
+          /* Replacing an entry reuses its key and buffer. */
+          value = apr_hash_get(log->noderevs, current, key_len);
+          if (value)
+            {
+              svn_stringbuf_setempty(value);
+              svn_stringbuf_appendbytes(value, eol + 1, (apr_size_t)length);
+            }
+          else
+            {
+              value = svn_stringbuf_ncreate(eol + 1, (apr_size_t)length,
+                                            log->pool);
+              apr_hash_set(log->noderevs,
+                           apr_pstrmemdup(log->pool, current, key_len),
+                           key_len, value);
+            }
+
+          current = eol + 1 + length;
+        }
+    }
+
+  *consumed = current - data;
+  return SVN_NO_ERROR;
+}
+
+/* Read all records that have been appended to LOG since we last looked.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+catch_up(svn_fs_fs__noderev_log_t *log,
+         apr_pool_t *scratch_pool)
+{
+  apr_finfo_t finfo;
+  apr_file_t *file;
+  apr_off_t offset = log->size;
+  svn_stringbuf_t *buffer;
+  apr_size_t to_read;
+  apr_size_t consumed;
+
+  SVN_ERR(svn_io_stat(&finfo, log->path, APR_FINFO_SIZE, scratch_pool));
+  if (finfo.size == log->size)
+    return SVN_NO_ERROR;
+
+  if (finfo.size < log->size)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Node-revision log '%s' has been truncated"),
+                             svn_dirent_local_style(log->path,
+                                                    scratch_pool));
+
+  to_read = (apr_size_t)(finfo.size - log->size);
+  buffer = svn_stringbuf_create_ensure(to_read, scratch_pool);
+
+  SVN_ERR(svn_io_file_open(&file, log->path, APR_READ | APR_BUFFERED,
+                           APR_OS_DEFAULT, scratch_pool));
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+  SVN_ERR(svn_io_file_read_full2(file, buffer->data, to_read,
+                                 &buffer->len, NULL, scratch_pool));
+  SVN_ERR(svn_io_file_close(file, scratch_pool));
+  buffer->data[buffer->len] = '\0';
+
+  SVN_ERR(parse_records(&consumed, log, buffer->data, buffer->len,
+                        scratch_pool));
+  log->size += consumed;
+
+  return SVN_NO_ERROR;
+}
+
+/* Append RECORD to LOG.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+append_record(svn_fs_fs__noderev_log_t *log,
+              const svn_stringbuf_t *record,
+              apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  apr_off_t end;
+
+  SVN_ERR(svn_io_file_open(&file, log->path, APR_WRITE | APR_APPEND,
+                           APR_OS_DEFAULT, scratch_pool));
+  SVN_ERR(svn_io_file_write_full(file, record->data, record->len, NULL,
+                                 scratch_pool));
+  SVN_ERR(svn_io_file_get_offset(&end, file, scratch_pool));
+  SVN_ERR(svn_io_file_close(file, scratch_pool));
+
+  /* Unless somebody else appended to the log since we last read it,
+   * we can update our state without reading our own record back. */
+  if (end - (apr_off_t)record->len == log->size)
+    {
+      apr_size_t consumed;
+      SVN_ERR(parse_records(&consumed, log, record->data, record->len,
+                            scratch_pool));
+      log->size += consumed;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the path of the node-revision log of transaction TXN_ID in FS.
+ * Allocate the result in RESULT_POOL. */
+static const char *
+path_noderev_log(svn_fs_t *fs,
+                 const svn_fs_fs__id_part_t *txn_id,
+                 apr_pool_t *result_pool)
+{
+  return svn_dirent_join(svn_fs_fs__path_txn_dir(fs, txn_id, result_pool),
+                         PATH_NODE_REVS, result_pool);
+}
+
+svn_error_t *
+svn_fs_fs__noderev_log_create(svn_fs_t *fs,
+                              const svn_fs_fs__id_part_t *txn_id,
+                              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (   ffd->format < SVN_FS_FS__MIN_NODEREV_LOG_FORMAT
+      || !ffd->txn_noderev_log)
+    return SVN_NO_ERROR;
+
+  return svn_error_trace(svn_io_file_create_empty(
+                            path_noderev_log(fs, txn_id, scratch_pool),
+                            scratch_pool));
+}
+
+svn_error_t *
+svn_fs_fs__noderev_log_get(svn_fs_fs__noderev_log_t **log_p,
+                           svn_fs_t *fs,
+                           const svn_fs_fs__id_part_t *txn_id,
+                           apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const char *key;
+  svn_fs_fs__noderev_log_t *log;
+
+  *log_p = NULL;
+  if (ffd->format < SVN_FS_FS__MIN_NODEREV_LOG_FORMAT)
+    return SVN_NO_ERROR;
+
+  if (ffd->noderev_logs == NULL)
+    ffd->noderev_logs = apr_hash_make(fs->pool);
+
+  key = svn_fs_fs__id_txn_unparse(txn_id, scratch_pool);
+  log = svn_hash_gets(ffd->noderev_logs, key);
+  if (log == NULL)
+    {
+      /* The storage scheme is fixed when the transaction gets created,
+       * so checking once is enough.  Remember transactions without a log
+       * as well, using a separate pool such that forgetting the
+       * transaction releases all memory. */
+      const char *path = path_noderev_log(fs, txn_id, scratch_pool);
+      apr_pool_t *pool;
+      svn_node_kind_t kind;
+
+      SVN_ERR(svn_io_check_path(path, &kind, scratch_pool));
+
+      pool = svn_pool_create(fs->pool);
+      log = apr_pcalloc(pool, sizeof(*log));
+      log->pool = pool;
+      if (kind == svn_node_file)
+        {
+          log->path = apr_pstrdup(pool, path);
+          log->noderevs = apr_hash_make(pool);
+        }
+
+      svn_hash_sets(ffd->noderev_logs, apr_pstrdup(pool, key), log);
+    }
+
+  if (log->path)
+    *log_p = log;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__noderev_log_read(node_revision_t **noderev_p,
+                            svn_fs_fs__noderev_log_t *log,
+                            const svn_fs_id_t *id,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool)
+{
+  svn_string_t *id_str = svn_fs_fs__id_unparse(id, scratch_pool);
+  svn_stringbuf_t *value;
+
+  SVN_ERR(catch_up(log, scratch_pool));
+
+  value = apr_hash_get(log->noderevs, id_str->data, id_str->len);
+  if (value == NULL || value->len == 0)
+    {
+      *noderev_p = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  /* Parse a copy as VALUE may get overwritten while we use the result. */
+  return svn_error_trace(svn_fs_fs__read_noderev(noderev_p,
+                                                 svn_stream_from_stringbuf(
+                                                     svn_stringbuf_dup(
+                                                         value,
+                                                         scratch_pool),
+                                                     scratch_pool),
+                                                 result_pool,
+                                                 scratch_pool));
+}
+
+svn_error_t *
+svn_fs_fs__noderev_log_write(svn_fs_fs__noderev_log_t *log,
+                             svn_fs_t *fs,
+                             const svn_fs_id_t *id,
+                             node_revision_t *noderev,
+                             apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_stringbuf_t *serialized = svn_stringbuf_create_empty(scratch_pool);
+  svn_stringbuf_t *record;
+
+  SVN_ERR(svn_fs_fs__write_noderev(svn_stream_from_stringbuf(serialized,
+                                                             scratch_pool),
+                                   noderev, ffd->format,
+                                   svn_fs_fs__fs_supports_mergeinfo(fs),
+                                   scratch_pool));
+
+  record = svn_stringbuf_createf(scratch_pool, "%s %" APR_SIZE_T_FMT "\n",
+                                 svn_fs_fs__id_unparse(id,
+                                                       scratch_pool)->data,
+                                 serialized->len);
+  svn_stringbuf_appendstr(record, serialized);
+
+  return svn_error_trace(append_record(log, record, scratch_pool));
+}
+
+svn_error_t *
+svn_fs_fs__noderev_log_delete(svn_fs_fs__noderev_log_t *log,
+                              const svn_fs_id_t *id,
+                              apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *record
+    = svn_stringbuf_createf(scratch_pool, "%s -\n",
+                            svn_fs_fs__id_unparse(id, scratch_pool)->data);
+
+  return svn_error_trace(append_record(log, record, scratch_pool));
+}
+
+void
+svn_fs_fs__noderev_log_forget(svn_fs_t *fs,
+                              const svn_fs_fs__id_part_t *txn_id,
+                              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const char *key;
+  svn_fs_fs__noderev_log_t *log;
+
+  if (ffd->noderev_logs == NULL)
+    return;
+
+  key = svn_fs_fs__id_txn_unparse(txn_id, scratch_pool);
+  log = svn_hash_gets(ffd->noderev_logs, key);
+  if (log == NULL)
+    return;
+
+  svn_hash_sets(ffd->noderev_logs, key, NULL);
+  svn_pool_destroy(log->pool);
+}
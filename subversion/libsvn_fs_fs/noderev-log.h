@@ -0,0 +1,106 @@
+/* noderev-log.h : node-revision store of a transaction in a single file
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS_FS_NODEREV_LOG_H
+#define SVN_LIBSVN_FS_FS_NODEREV_LOG_H
+
+#include "svn_error.h"
+
+#include "fs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Traditionally, every mutable node-revision of a transaction lives in
+ * its own "node.<id>" file, turning large commits into thousands of small
+ * file creations.  Transactions that have a PATH_NODE_REVS file in their
+ * directory instead append every node-revision update to that single
+ * file and keep the latest version of each node-revision in memory.
+ *
+ * Records are "<id> <length>\n<serialized noderev>" for updates and
+ * "<id> -\n" for deletions.  The last record for any given ID wins.
+ * An incomplete record at the end of the file is ignored.
+ *
+ * The in-memory state is per FS object.  Since other processes may
+ * append to the same log, its size gets checked upon every access and
+ * new records will be read before answering any request.
+ */
+
+/* Opaque in-memory state of a transaction's node-revision log. */
+typedef struct svn_fs_fs__noderev_log_t svn_fs_fs__noderev_log_t;
+
+/* Create an empty node-revision log for the new transaction TXN_ID in FS,
+   if FS is configured to do so.  Use SCRATCH_POOL for temporaries. */
+svn_error_t *
+svn_fs_fs__noderev_log_create(svn_fs_t *fs,
+                              const svn_fs_fs__id_part_t *txn_id,
+                              apr_pool_t *scratch_pool);
+
+/* Set *LOG to the node-revision log of transaction TXN_ID in FS or to
+   NULL, if that transaction uses one file per node-revision.
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__noderev_log_get(svn_fs_fs__noderev_log_t **log,
+                           svn_fs_t *fs,
+                           const svn_fs_fs__id_part_t *txn_id,
+                           apr_pool_t *scratch_pool);
+
+/* Set *NODEREV_P to the latest version of the node-revision ID in LOG.
+   If there is no such node-revision, set it to NULL.  Allocate the result
+   in RESULT_POOL and use SCRATCH_POOL for temporaries. */
+svn_error_t *
+svn_fs_fs__noderev_log_read(node_revision_t **noderev_p,
+                            svn_fs_fs__noderev_log_t *log,
+                            const svn_fs_id_t *id,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool);
+
+/* Append NODEREV as the new version of node-revision ID to LOG.
+   FS is the filesystem LOG belongs to.  Use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *
+svn_fs_fs__noderev_log_write(svn_fs_fs__noderev_log_t *log,
+                             svn_fs_t *fs,
+                             const svn_fs_id_t *id,
+                             node_revision_t *noderev,
+                             apr_pool_t *scratch_pool);
+
+/* Record the deletion of node-revision ID in LOG.  Use SCRATCH_POOL for
+   temporary allocations. */
+svn_error_t *
+svn_fs_fs__noderev_log_delete(svn_fs_fs__noderev_log_t *log,
+                              const svn_fs_id_t *id,
+                              apr_pool_t *scratch_pool);
+
+/* Release the in-memory state kept for transaction TXN_ID in FS.
+   Use SCRATCH_POOL for temporary allocations. */
+void
+svn_fs_fs__noderev_log_forget(svn_fs_t *fs,
+                              const svn_fs_fs__id_part_t *txn_id,
+                              apr_pool_t *scratch_pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_FS_FS_NODEREV_LOG_H */
@@ -25,12 +25,15 @@
 #include "svn_pools.h"
 #include "svn_dirent_uri.h"
 #include "svn_sorts.h"
+#include "svn_delta.h"
+#include "private/svn_fs_fs_private.h"
 #include "private/svn_temp_serializer.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 #include "private/svn_io_private.h"
 
+#include "access-stats.h"
 #include "fs_fs.h"
 #include "pack.h"
 #include "util.h"
@@ -78,6 +81,9 @@
  *   with special treatment of "trunk" and "branches"
  * - same for file representations
  *
+ * If access statistics have been recorded for the shard, frequently read
+ * noderevs and representations come first within their section.
+ *
  * Step 4 copies the items from the temporary buckets into the final
  * pack file and writes the temporary index files.
  *
@@ -89,6 +95,12 @@
  */
 #define DEFAULT_MAX_MEM (64 * 1024 * 1024)
 
+/* Minimum number of sampled accesses to a noderev and its representation
+ * for them to be considered "hot".  Single samples are too likely to be
+ * one-off requests.
+ */
+#define HOT_ACCESS_COUNT 2
+
 /* Data structure describing a node change at PATH, REVISION.
  * We will sort these instances by PATH and NODE_ID such that we can combine
  * similar nodes in the same reps container and store containers in path
@@ -119,6 +131,9 @@ typedef struct path_order_t
 
   /* item ID of the representation containing the new data. May be (0, 0). */
   svn_fs_fs__id_part_t rep_id;
+
+  /* number of sampled accesses to the noderev and its representation */
+  int access_count;
 } path_order_t;
 
 /* Represents a reference from item FROM to item TO.  FROM may be a noderev
@@ -230,6 +245,14 @@ typedef struct pack_context_t
    * Will be filled in phase 2 and be cleared after each revision range.*/
   apr_file_t *reps_file;
 
+  /* temp file receiving re-encoded svndiff data before it gets copied to
+   * its final destination.  NULL if pack shall not re-encode deltas. */
+  apr_file_t *recode_file;
+
+  /* access statistics for the whole shard as returned by
+   * svn_fs_fs__access_stats_read.  Empty if none have been recorded. */
+  apr_hash_t *access_counts;
+
   /* pool used for temporary data structures that will be cleaned up when
    * the next range of revisions is being processed */
   apr_pool_t *info_pool;
@@ -333,6 +356,13 @@ initialize_pack_context(pack_context_t *context,
                                  sizeof(svn_fs_fs__p2l_entry_t *));
   SVN_ERR(svn_io_open_unique_file3(&context->reps_file, NULL, temp_dir,
                                    svn_io_file_del_on_close, pool, pool));
+  if (ffd->pack_recompress)
+    SVN_ERR(svn_io_open_unique_file3(&context->recode_file, NULL, temp_dir,
+                                     svn_io_file_del_on_close, pool, pool));
+
+  /* how the shard has been used so far */
+  SVN_ERR(svn_fs_fs__access_stats_read(&context->access_counts, shard_dir,
+                                       pool, pool));
 
   return SVN_NO_ERROR;
 }
@@ -472,6 +502,136 @@ copy_file_data(pack_context_t *context,
   return SVN_NO_ERROR;
 }
 
+/* Return the svndiff version to use for compression TYPE.
+ */
+static int
+get_svndiff_version(compression_type_t type)
+{
+  switch (type)
+    {
+      case compression_type_lz4:
+        return 2;
+
+      case compression_type_zlib:
+        return 1;
+
+      default:
+        return 0;
+    }
+}
+
+/* Copy the representation of ENTRY with the already parsed REP_HEADER
+ * from SOURCE_OFFSET in SOURCE to the current position in DEST.  If so
+ * configured, re-encode its delta windows using the pack compression of
+ * CONTEXT->FS and update the size and checksum in ENTRY accordingly.
+ * Use POOL for allocations.
+ */
+static svn_error_t *
+copy_rep_data(pack_context_t *context,
+              apr_file_t *dest,
+              apr_file_t *source,
+              apr_off_t source_offset,
+              svn_fs_fs__p2l_entry_t *entry,
+              svn_fs_fs__rep_header_t *rep_header,
+              apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = context->fs->fsap_data;
+  apr_off_t data_offset = source_offset + rep_header->header_size;
+  apr_off_t data_size = entry->size - rep_header->header_size
+                      - 7 /* ENDREP\n */;
+  int version = get_svndiff_version(ffd->pack_compression_type);
+  char signature[4];
+  svn_fs_fs__rep_header_t new_header;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *parser;
+  svn_stream_t *stream;
+  apr_off_t recoded_size;
+  apr_off_t recode_start = 0;
+  apr_off_t start_offset, end_offset;
+  apr_pool_t *iterpool;
+  char *buffer;
+
+  /* PLAIN reps, empty deltas and deltas already using the desired
+   * compression are simply copied. */
+  if (   !context->recode_file
+      || rep_header->type == svn_fs_fs__rep_plain
+      || data_size <= (apr_off_t)sizeof(signature))
+    {
+      SVN_ERR(svn_io_file_seek(source, APR_SET, &source_offset, pool));
+      return svn_error_trace(copy_file_data(context, dest, source,
+                                            entry->size, pool));
+    }
+
+  SVN_ERR(svn_io_file_seek(source, APR_SET, &data_offset, pool));
+  SVN_ERR(svn_io_file_read_full2(source, signature, sizeof(signature),
+                                 NULL, NULL, pool));
+  if (signature[3] == version)
+    {
+      SVN_ERR(svn_io_file_seek(source, APR_SET, &source_offset, pool));
+      return svn_error_trace(copy_file_data(context, dest, source,
+                                            entry->size, pool));
+    }
+
+  /* Parse the svndiff data window by window and re-encode it into the
+   * recode file.  We need to know its size before we can write the header
+   * to DEST. */
+  SVN_ERR(svn_io_file_trunc(context->recode_file, 0, pool));
+  svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                          svn_stream_from_aprfile2(context->recode_file,
+                                                   TRUE, pool),
+                          version, ffd->pack_compression_level, pool);
+  parser = svn_txdelta_parse_svndiff(handler, handler_baton, TRUE, pool);
+
+  SVN_ERR(svn_io_file_seek(source, APR_SET, &data_offset, pool));
+  buffer = apr_palloc(pool, ffd->block_size);
+  iterpool = svn_pool_create(pool);
+  while (data_size)
+    {
+      apr_size_t to_copy = (apr_size_t)(MIN(data_size, ffd->block_size));
+
+      svn_pool_clear(iterpool);
+      if (context->cancel_func)
+        SVN_ERR(context->cancel_func(context->cancel_baton));
+
+      SVN_ERR(svn_io_file_read_full2(source, buffer, to_copy, NULL, NULL,
+                                     iterpool));
+      SVN_ERR(svn_stream_write(parser, buffer, &to_copy));
+
+      data_size -= to_copy;
+    }
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_stream_close(parser));
+  SVN_ERR(svn_io_file_get_offset(&recoded_size, context->recode_file, pool));
+
+  /* Write the rep with its new header, calculating the item checksum. */
+  new_header = *rep_header;
+  new_header.data_size = recoded_size;
+
+  SVN_ERR(svn_io_file_get_offset(&start_offset, dest, pool));
+  stream = svn_checksum__wrap_write_stream_fnv1a_32x4(
+               &entry->fnv1_checksum,
+               svn_stream_from_aprfile2(dest, TRUE, pool),
+               pool);
+  SVN_ERR(svn_fs_fs__write_rep_header(&new_header, stream, pool));
+
+  SVN_ERR(svn_io_file_seek(context->recode_file, APR_SET, &recode_start,
+                           pool));
+  SVN_ERR(svn_stream_copy3(svn_stream_from_aprfile2(context->recode_file,
+                                                    TRUE, pool),
+                           svn_stream_disown(stream, pool),
+                           context->cancel_func, context->cancel_baton,
+                           pool));
+  SVN_ERR(svn_stream_puts(stream, "ENDREP\n"));
+  SVN_ERR(svn_stream_close(stream));
+
+  SVN_ERR(svn_io_file_get_offset(&end_offset, dest, pool));
+  entry->size = end_offset - start_offset;
+
+  return SVN_NO_ERROR;
+}
+
 /* Writes SIZE bytes, all 0, to DEST.  Uses POOL for allocations.
  */
 static svn_error_t *
@@ -618,9 +778,8 @@ copy_rep_to_temp(pack_context_t *context,
     }
 
   /* copy the whole rep (including header!) to our temp file */
-  SVN_ERR(svn_io_file_seek(rev_file, APR_SET, &source_offset, pool));
-  SVN_ERR(copy_file_data(context, context->reps_file, rev_file, entry->size,
-                         pool));
+  SVN_ERR(copy_rep_data(context, context->reps_file, rev_file, source_offset,
+                        entry, rep_header, pool));
 
   return SVN_NO_ERROR;
 }
@@ -763,6 +922,10 @@ copy_node_to_temp(pack_context_t *context,
       path_order->rep_id.revision = noderev->data_rep->revision;
       path_order->rep_id.number = noderev->data_rep->item_index;
       path_order->expanded_size = noderev->data_rep->expanded_size;
+      path_order->access_count
+        = svn_fs_fs__access_stats_count(context->access_counts,
+                                        path_order->rep_id.revision,
+                                        path_order->rep_id.number);
     }
 
   /* Sort path is the key used for ordering noderevs and associated reps.
@@ -773,6 +936,10 @@ copy_node_to_temp(pack_context_t *context,
   path_order->revision = svn_fs_fs__id_rev(noderev->id);
   path_order->predecessor_count = noderev->predecessor_count;
   path_order->noderev_id = *svn_fs_fs__id_rev_item(noderev->id);
+  path_order->access_count
+    += svn_fs_fs__access_stats_count(context->access_counts,
+                                     path_order->noderev_id.revision,
+                                     path_order->noderev_id.number);
   APR_ARRAY_PUSH(context->path_order, path_order_t *) = path_order;
 
   return SVN_NO_ERROR;
@@ -893,6 +1060,7 @@ sort_reps_range(pack_context_t *context,
 
   /* Re-order noderevs like this:
    *
+   * (0) Frequently accessed according to the statistics, in path order.
    * (1) Most likely to be referenced by future pack files, in path order.
    * (2) highest revision rep per path + dependency chain
    * (3) Remaining reps in path, rev order
@@ -901,6 +1069,17 @@ sort_reps_range(pack_context_t *context,
    */
   dest = first;
 
+  /* (0) What has actually been read often in the past will most likely
+   * be read often in the future.  Keeping those items together reduces
+   * the number of blocks that typical requests need to read.
+   */
+  for (i = first; i < last; ++i)
+    if (path_order[i]->access_count >= HOT_ACCESS_COUNT)
+      {
+        temp[dest++] = path_order[i];
+        path_order[i] = NULL;
+      }
+
   /* (1) There are two classes of representations that are likely to be
    * referenced from future shards.  These form a "hot zone" of mostly
    * relevant data, i.e. we try to include as many reps as possible that
@@ -917,7 +1096,13 @@ sort_reps_range(pack_context_t *context,
    */
   for (i = first; i < last; ++i)
     {
-      int round = roundness(path_order[i]->predecessor_count);
+      int round;
+
+      /* Already placed in (0)? */
+      if (!path_order[i])
+        continue;
+
+      round = roundness(path_order[i]->predecessor_count);
 
       /* Class 1:
        * Pretty round _and_ a significant stop in the node's delta chain.
@@ -2166,3 +2351,242 @@ svn_fs_fs__pack(svn_fs_t *fs,
 
   return svn_error_trace(err);
 }
+
+/* Baton for repack_body. */
+struct repack_baton
+{
+  svn_fs_t *fs;
+  svn_revnum_t revision;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+};
+
+/* Read all P2L index entries of the pack file REV_FILE in FS starting at
+ * SHARD_REV and return them as svn_fs_fs__p2l_entry_t * in *ENTRIES, in
+ * offset order.  Allocate the result in RESULT_POOL and use SCRATCH_POOL
+ * for temporary allocations.
+ */
+static svn_error_t *
+read_pack_entries(apr_array_header_t **entries,
+                  svn_fs_t *fs,
+                  svn_fs_fs__revision_file_t *rev_file,
+                  svn_revnum_t shard_rev,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_off_t offset = 0;
+
+  *entries = apr_array_make(result_pool, 16, sizeof(svn_fs_fs__p2l_entry_t *));
+  while (offset < rev_file->l2p_offset)
+    {
+      apr_array_header_t *page;
+      int i;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_fs__p2l_index_lookup(&page, fs, rev_file, shard_rev,
+                                          offset, ffd->p2l_page_size,
+                                          iterpool, iterpool));
+
+      for (i = 0; i < page->nelts; ++i)
+        {
+          svn_fs_fs__p2l_entry_t *entry
+            = &APR_ARRAY_IDX(page, i, svn_fs_fs__p2l_entry_t);
+
+          /* skip entries that we already got from the previous page */
+          if (offset > entry->offset || entry->offset >= rev_file->l2p_offset)
+            continue;
+
+          APR_ARRAY_PUSH(*entries, svn_fs_fs__p2l_entry_t *)
+            = apr_pmemdup(result_pool, entry, sizeof(*entry));
+          offset = entry->offset + entry->size;
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Re-encode the pack file of the shard starting at SHARD_REV in FS as
+ * described for svn_fs_fs__repack.  Call CANCEL_FUNC with CANCEL_BATON
+ * from time to time.  Use POOL for allocations.
+ */
+static svn_error_t *
+repack_shard(svn_fs_t *fs,
+             svn_revnum_t shard_rev,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  pack_context_t context = { 0 };
+  svn_fs_fs__revision_file_t *rev_file;
+  apr_array_header_t *entries;
+  apr_file_t *pack_file;
+  apr_file_t *proto_p2l_index;
+  const char *pack_file_path;
+  const char *temp_pack_file_path;
+  const char *proto_p2l_index_path;
+  const char *proto_l2p_index_path;
+  apr_pool_t *iterpool;
+  int i;
+
+  pack_file_path = svn_fs_fs__path_rev_packed(fs, shard_rev, PATH_PACKED,
+                                              pool);
+
+  context.fs = fs;
+  context.cancel_func = cancel_func;
+  context.cancel_baton = cancel_baton;
+  SVN_ERR(svn_io_open_unique_file3(&context.recode_file, NULL, NULL,
+                                   svn_io_file_del_on_close, pool, pool));
+
+  /* Copy all items to a new pack file in their current order, re-encoding
+   * the deltas as we go. */
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, shard_rev, pool,
+                                           pool));
+  SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
+  SVN_ERR(read_pack_entries(&entries, fs, rev_file, shard_rev, pool, pool));
+
+  SVN_ERR(svn_io_open_unique_file3(&pack_file, &temp_pack_file_path,
+                                   svn_dirent_dirname(pack_file_path, pool),
+                                   svn_io_file_del_on_pool_cleanup,
+                                   pool, pool));
+
+  iterpool = svn_pool_create(pool);
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      svn_fs_fs__p2l_entry_t *entry
+        = APR_ARRAY_IDX(entries, i, svn_fs_fs__p2l_entry_t *);
+      apr_off_t source_offset = entry->offset;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_io_file_get_offset(&entry->offset, pack_file, iterpool));
+      SVN_ERR(svn_io_file_seek(rev_file->file, APR_SET, &source_offset,
+                               iterpool));
+
+      if (   entry->type == SVN_FS_FS__ITEM_TYPE_FILE_REP
+          || entry->type == SVN_FS_FS__ITEM_TYPE_DIR_REP)
+        {
+          svn_fs_fs__rep_header_t *rep_header;
+
+          SVN_ERR(svn_fs_fs__read_rep_header(&rep_header, rev_file->stream,
+                                             iterpool, iterpool));
+          SVN_ERR(copy_rep_data(&context, pack_file, rev_file->file,
+                                source_offset, entry, rep_header,
+                                iterpool));
+        }
+      else
+        {
+          SVN_ERR(copy_file_data(&context, pack_file, rev_file->file,
+                                 entry->size, iterpool));
+        }
+    }
+  svn_pool_destroy(iterpool);
+  SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+
+  /* Write the new indexes.  The L2P index construction will reorder
+   * ENTRIES, so create the P2L proto index first. */
+  SVN_ERR(svn_io_open_unique_file3(NULL, &proto_p2l_index_path, NULL,
+                                   svn_io_file_del_on_pool_cleanup,
+                                   pool, pool));
+  SVN_ERR(svn_fs_fs__p2l_proto_index_open(&proto_p2l_index,
+                                          proto_p2l_index_path, pool));
+  for (i = 0; i < entries->nelts; ++i)
+    SVN_ERR(svn_fs_fs__p2l_proto_index_add_entry(
+                 proto_p2l_index,
+                 APR_ARRAY_IDX(entries, i, svn_fs_fs__p2l_entry_t *),
+                 pool));
+  SVN_ERR(svn_io_file_close(proto_p2l_index, pool));
+
+  SVN_ERR(svn_fs_fs__l2p_index_from_p2l_entries(&proto_l2p_index_path, fs,
+                                                entries, pool, pool));
+  SVN_ERR(svn_fs_fs__add_index_data(fs, pack_file, proto_l2p_index_path,
+                                    proto_p2l_index_path, shard_rev, pool));
+
+  if (ffd->flush_to_disk)
+    SVN_ERR(svn_io_file_flush_to_disk(pack_file, pool));
+  SVN_ERR(svn_io_file_close(pack_file, pool));
+
+  /* Atomically replace the old pack file. */
+  return svn_error_trace(svn_fs_fs__move_into_place(temp_pack_file_path,
+                                                    pack_file_path,
+                                                    pack_file_path,
+                                                    ffd->flush_to_disk,
+                                                    pool));
+}
+
+/* The work horse for svn_fs_fs__repack, called with the FS pack lock.
+   This implements the svn_fs_fs__with_pack_lock() 'body' callback
+   type.  BATON is a 'struct repack_baton *'. */
+static svn_error_t *
+repack_body(void *baton,
+            apr_pool_t *pool)
+{
+  struct repack_baton *rb = baton;
+  fs_fs_data_t *ffd = rb->fs->fsap_data;
+  apr_pool_t *iterpool;
+  svn_revnum_t shard_rev;
+
+  /* Another process might have packed more shards in the meantime. */
+  SVN_ERR(svn_fs_fs__update_min_unpacked_rev(rb->fs, pool));
+
+  if (SVN_IS_VALID_REVNUM(rb->revision))
+    {
+      if (!svn_fs_fs__is_packed_rev(rb->fs, rb->revision))
+        return svn_error_createf(SVN_ERR_INCORRECT_PARAMS, NULL,
+                                 _("Revision %ld is not packed"),
+                                 rb->revision);
+
+      shard_rev = svn_fs_fs__packed_base_rev(rb->fs, rb->revision);
+      return svn_error_trace(repack_shard(rb->fs, shard_rev,
+                                          rb->cancel_func, rb->cancel_baton,
+                                          pool));
+    }
+
+  iterpool = svn_pool_create(pool);
+  for (shard_rev = 0;
+       shard_rev < ffd->min_unpacked_rev;
+       shard_rev += ffd->max_files_per_dir)
+    {
+      svn_pool_clear(iterpool);
+
+      if (rb->cancel_func)
+        SVN_ERR(rb->cancel_func(rb->cancel_baton));
+
+      SVN_ERR(repack_shard(rb->fs, shard_rev, rb->cancel_func,
+                           rb->cancel_baton, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__repack(svn_fs_t *fs,
+                  svn_revnum_t revision,
+                  svn_cancel_func_t cancel_func,
+                  void *cancel_baton,
+                  apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  struct repack_baton rb = { 0 };
+
+  if (   ffd->format < SVN_FS_FS__MIN_PACK_COMPRESSION_FORMAT
+      || !svn_fs_fs__use_log_addressing(fs))
+    return svn_error_create(SVN_ERR_FS_UNSUPPORTED_FORMAT, NULL, NULL);
+
+  if (!ffd->pack_recompress)
+    return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                             _("Option '%s' has not been set in fsfs.conf"),
+                             CONFIG_OPTION_PACK_COMPRESSION);
+
+  rb.fs = fs;
+  rb.revision = revision;
+  rb.cancel_func = cancel_func;
+  rb.cancel_baton = cancel_baton;
+
+  return svn_error_trace(svn_fs_fs__with_pack_lock(fs, repack_body, &rb,
+                                                   scratch_pool));
+}
@@ -28,6 +28,7 @@
 #include "fs_fs.h"
 #include "fs.h"
 #include "rep-cache.h"
+#include "rep-index.h"
 #include "../libsvn_fs/fs-loader.h"
 
 #include "svn_path.h"
@@ -119,9 +120,11 @@ open_rep_cache(void *baton,
   return SVN_NO_ERROR;
 }
 
-svn_error_t *
-svn_fs_fs__open_rep_cache(svn_fs_t *fs,
-                          apr_pool_t *pool)
+/* Open and create, if needed, the rep cache database associated with FS,
+   independently of FS's rep-index setting.  Use POOL for temporaries. */
+static svn_error_t *
+open_rep_cache_db(svn_fs_t *fs,
+                  apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   svn_error_t *err = svn_atomic__init_once(&ffd->rep_cache_db_opened,
@@ -132,24 +135,11 @@ svn_fs_fs__open_rep_cache(svn_fs_t *fs,
                                  path_rep_cache_db(fs->path, pool), pool));
 }
 
-svn_error_t *
-svn_fs_fs__close_rep_cache(svn_fs_t *fs)
-{
-  fs_fs_data_t *ffd = fs->fsap_data;
-
-  if (ffd->rep_cache_db)
-    {
-      SVN_ERR(svn_sqlite__close(ffd->rep_cache_db));
-      ffd->rep_cache_db = NULL;
-      ffd->rep_cache_db_opened = 0;
-    }
-
-  return SVN_NO_ERROR;
-}
-
-svn_error_t *
-svn_fs_fs__exists_rep_cache(svn_boolean_t *exists,
-                            svn_fs_t *fs, apr_pool_t *pool)
+/* Set *EXISTS to TRUE iff the rep-cache DB file of FS exists. */
+static svn_error_t *
+exists_rep_cache_db(svn_boolean_t *exists,
+                    svn_fs_t *fs,
+                    apr_pool_t *pool)
 {
   svn_node_kind_t kind;
 
@@ -160,18 +150,19 @@ svn_fs_fs__exists_rep_cache(svn_boolean_t *exists,
   return SVN_NO_ERROR;
 }
 
-svn_error_t *
-svn_fs_fs__walk_rep_reference(svn_fs_t *fs,
-                              svn_revnum_t start,
-                              svn_revnum_t end,
-                              svn_error_t *(*walker)(representation_t *,
-                                                     void *,
-                                                     svn_fs_t *,
-                                                     apr_pool_t *),
-                              void *walker_baton,
-                              svn_cancel_func_t cancel_func,
-                              void *cancel_baton,
-                              apr_pool_t *pool)
+/* Implementation of svn_fs_fs__walk_rep_reference for the rep-cache DB. */
+static svn_error_t *
+walk_rep_cache_db(svn_fs_t *fs,
+                  svn_revnum_t start,
+                  svn_revnum_t end,
+                  svn_error_t *(*walker)(representation_t *,
+                                         void *,
+                                         svn_fs_t *,
+                                         apr_pool_t *),
+                  void *walker_baton,
+                  svn_cancel_func_t cancel_func,
+                  void *cancel_baton,
+                  apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   svn_sqlite__stmt_t *stmt;
@@ -180,11 +171,8 @@ svn_fs_fs__walk_rep_reference(svn_fs_t *fs,
 
   apr_pool_t *iterpool = svn_pool_create(pool);
 
-  /* Don't check ffd->rep_sharing_allowed. */
-  SVN_ERR_ASSERT(ffd->format >= SVN_FS_FS__MIN_REP_SHARING_FORMAT);
-
   if (! ffd->rep_cache_db)
-    SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
+    SVN_ERR(open_rep_cache_db(fs, pool));
 
   /* Check global invariants. */
   if (start == 0)
@@ -256,30 +244,176 @@ svn_fs_fs__walk_rep_reference(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Implements the WALKER callback of walk_rep_cache_db, adding REP to the
+   svn_fs_fs__rep_index_loader_t given as BATON. */
+static svn_error_t *
+migrate_walker(representation_t *rep,
+               void *baton,
+               svn_fs_t *fs,
+               apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(svn_fs_fs__rep_index_loader_add(baton, rep,
+                                                         scratch_pool));
+}
+
+/* Create the rep-index for the svn_fs_t given as BATON, unless it exists
+   already.  Import all entries from the rep-cache DB, if there is one.
+   Implements the BODY of svn_fs_fs__with_rep_index_lock(). */
+static svn_error_t *
+create_rep_index(void *baton,
+                 apr_pool_t *pool)
+{
+  svn_fs_t *fs = baton;
+  svn_fs_fs__rep_index_loader_t *loader;
+  svn_revnum_t youngest;
+  svn_boolean_t exists;
+
+  /* Some other process may have been faster. */
+  SVN_ERR(svn_fs_fs__rep_index_exists(&exists, fs, pool));
+  if (exists)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_fs__rep_index_loader_create(&loader, fs, pool, pool));
+
+  /* Our cached youngest revision may be arbitrarily old.  Read the
+     current one to import all entries committed until now. */
+  SVN_ERR(exists_rep_cache_db(&exists, fs, pool));
+  if (exists)
+    {
+      SVN_ERR(svn_fs_fs__youngest_rev(&youngest, fs, pool));
+      SVN_ERR(walk_rep_cache_db(fs, 0, youngest, migrate_walker, loader,
+                                NULL, NULL, pool));
+    }
+
+  return svn_error_trace(svn_fs_fs__rep_index_loader_finish(loader, pool));
+}
+
+/* Open and create, if needed, the rep-index associated with FS.
+   Implements svn_atomic__init_once().init_func.
+ */
+static svn_error_t *
+open_rep_index(void *baton,
+               apr_pool_t *pool)
+{
+  svn_fs_t *fs = baton;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_boolean_t exists;
+
+  SVN_ERR(svn_fs_fs__rep_index_exists(&exists, fs, pool));
+  if (!exists)
+    SVN_ERR(svn_fs_fs__with_rep_index_lock(fs, create_rep_index, fs, pool));
+
+  /* This is used as a flag that the index is available so don't
+     set it earlier. */
+  SVN_ERR(svn_fs_fs__rep_index_open(&ffd->rep_index, fs, fs->pool, pool));
+
+  return SVN_NO_ERROR;
+}
 
-/* This function's caller ignores most errors it returns.
-   If you extend this function, check the callsite to see if you have
-   to make it not-ignore additional error codes.  */
 svn_error_t *
-svn_fs_fs__get_rep_reference(representation_t **rep_p,
-                             svn_fs_t *fs,
-                             svn_checksum_t *checksum,
-                             apr_pool_t *pool)
+svn_fs_fs__open_rep_cache(svn_fs_t *fs,
+                          apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_error_t *err;
+
+  if (! ffd->rep_cache_index)
+    return svn_error_trace(open_rep_cache_db(fs, pool));
+
+  err = svn_atomic__init_once(&ffd->rep_index_opened, open_rep_index, fs,
+                              pool);
+  return svn_error_quick_wrapf(err,
+                               _("Couldn't open rep-index '%s'"),
+                               svn_dirent_local_style(
+                                 svn_dirent_join(fs->path,
+                                                 PATH_REP_INDEX_DIR, pool),
+                                 pool));
+}
+
+svn_error_t *
+svn_fs_fs__close_rep_cache(svn_fs_t *fs)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (ffd->rep_cache_db)
+    {
+      SVN_ERR(svn_sqlite__close(ffd->rep_cache_db));
+      ffd->rep_cache_db = NULL;
+      ffd->rep_cache_db_opened = 0;
+    }
+
+  if (ffd->rep_index)
+    {
+      svn_fs_fs__rep_index_close(ffd->rep_index);
+      ffd->rep_index = NULL;
+      ffd->rep_index_opened = 0;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__exists_rep_cache(svn_boolean_t *exists,
+                            svn_fs_t *fs, apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (ffd->rep_cache_index)
+    return svn_error_trace(svn_fs_fs__rep_index_exists(exists, fs, pool));
+
+  return svn_error_trace(exists_rep_cache_db(exists, fs, pool));
+}
+
+svn_error_t *
+svn_fs_fs__walk_rep_reference(svn_fs_t *fs,
+                              svn_revnum_t start,
+                              svn_revnum_t end,
+                              svn_error_t *(*walker)(representation_t *,
+                                                     void *,
+                                                     svn_fs_t *,
+                                                     apr_pool_t *),
+                              void *walker_baton,
+                              svn_cancel_func_t cancel_func,
+                              void *cancel_baton,
+                              apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  /* Don't check ffd->rep_sharing_allowed. */
+  SVN_ERR_ASSERT(ffd->format >= SVN_FS_FS__MIN_REP_SHARING_FORMAT);
+
+  if (! ffd->rep_cache_index)
+    return svn_error_trace(walk_rep_cache_db(fs, start, end,
+                                             walker, walker_baton,
+                                             cancel_func, cancel_baton,
+                                             pool));
+
+  if (! ffd->rep_index)
+    SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
+
+  return svn_error_trace(svn_fs_fs__rep_index_walk(ffd->rep_index, fs,
+                                                   start, end,
+                                                   walker, walker_baton,
+                                                   cancel_func, cancel_baton,
+                                                   pool));
+}
+
+
+/* Set *REP_P to the representation in the rep-cache DB of FS with fulltext
+   SHA1 CHECKSUM, or NULL if there is none.  Allocate *REP_P in POOL. */
+static svn_error_t *
+get_rep_from_db(representation_t **rep_p,
+                svn_fs_t *fs,
+                svn_checksum_t *checksum,
+                apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   svn_sqlite__stmt_t *stmt;
   svn_boolean_t have_row;
   representation_t *rep;
 
-  SVN_ERR_ASSERT(ffd->rep_sharing_allowed);
   if (! ffd->rep_cache_db)
-    SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
-
-  /* We only allow SHA1 checksums in this table. */
-  if (checksum->kind != svn_checksum_sha1)
-    return svn_error_create(SVN_ERR_BAD_CHECKSUM_KIND, NULL,
-                            _("Only SHA1 checksums can be used as keys in the "
-                              "rep_cache table.\n"));
+    SVN_ERR(open_rep_cache_db(fs, pool));
 
   SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db, STMT_GET_REP));
   SVN_ERR(svn_sqlite__bindf(stmt, "s",
@@ -302,6 +436,49 @@ svn_fs_fs__get_rep_reference(representation_t **rep_p,
 
   SVN_ERR(svn_sqlite__reset(stmt));
 
+  *rep_p = rep;
+  return SVN_NO_ERROR;
+}
+
+/* This function's caller ignores most errors it returns.
+   If you extend this function, check the callsite to see if you have
+   to make it not-ignore additional error codes.  */
+svn_error_t *
+svn_fs_fs__get_rep_reference(representation_t **rep_p,
+                             svn_fs_t *fs,
+                             svn_checksum_t *checksum,
+                             apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  representation_t *rep;
+
+  SVN_ERR_ASSERT(ffd->rep_sharing_allowed);
+
+  /* We only allow SHA1 checksums in this table. */
+  if (checksum->kind != svn_checksum_sha1)
+    return svn_error_create(SVN_ERR_BAD_CHECKSUM_KIND, NULL,
+                            _("Only SHA1 checksums can be used as keys in the "
+                              "rep_cache table.\n"));
+
+  if (ffd->rep_cache_index)
+    {
+      apr_array_header_t *digests
+        = apr_array_make(pool, 1, sizeof(const unsigned char *));
+      apr_array_header_t *reps;
+
+      if (! ffd->rep_index)
+        SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
+
+      APR_ARRAY_PUSH(digests, const unsigned char *) = checksum->digest;
+      SVN_ERR(svn_fs_fs__rep_index_lookup(&reps, ffd->rep_index, digests,
+                                          pool, pool));
+      rep = APR_ARRAY_IDX(reps, 0, representation_t *);
+    }
+  else
+    {
+      SVN_ERR(get_rep_from_db(&rep, fs, checksum, pool));
+    }
+
   if (rep)
     {
       svn_error_t *err;
@@ -321,10 +498,12 @@ svn_fs_fs__get_rep_reference(representation_t **rep_p,
   return SVN_NO_ERROR;
 }
 
-svn_error_t *
-svn_fs_fs__set_rep_reference(svn_fs_t *fs,
-                             representation_t *rep,
-                             apr_pool_t *pool)
+/* Add REP to the rep-cache DB of FS unless its checksum is already in
+   there.  Use POOL for temporary allocations. */
+static svn_error_t *
+set_rep_in_db(svn_fs_t *fs,
+              representation_t *rep,
+              apr_pool_t *pool)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   svn_sqlite__stmt_t *stmt;
@@ -333,15 +512,8 @@ svn_fs_fs__set_rep_reference(svn_fs_t *fs,
   checksum.kind = svn_checksum_sha1;
   checksum.digest = rep->sha1_digest;
 
-  SVN_ERR_ASSERT(ffd->rep_sharing_allowed);
   if (! ffd->rep_cache_db)
-    SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
-
-  /* We only allow SHA1 checksums in this table. */
-  if (! rep->has_sha1)
-    return svn_error_create(SVN_ERR_BAD_CHECKSUM_KIND, NULL,
-                            _("Only SHA1 checksums can be used as keys in the "
-                              "rep_cache table.\n"));
+    SVN_ERR(open_rep_cache_db(fs, pool));
 
   SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db, STMT_SET_REP));
   SVN_ERR(svn_sqlite__bindf(stmt, "siiii",
@@ -377,6 +549,135 @@ svn_fs_fs__set_rep_reference(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Baton for insert_into_rep_index. */
+typedef struct insert_baton_t
+{
+  svn_fs_t *fs;
+  const apr_array_header_t *reps;
+} insert_baton_t;
+
+/* Add the representations in the insert_baton_t given as BATON to the
+   rep-index.  Implements the BODY of svn_fs_fs__with_rep_index_lock(). */
+static svn_error_t *
+insert_into_rep_index(void *baton,
+                      apr_pool_t *pool)
+{
+  insert_baton_t *b = baton;
+  fs_fs_data_t *ffd = b->fs->fsap_data;
+
+  return svn_error_trace(svn_fs_fs__rep_index_insert(ffd->rep_index, b->fs,
+                                                     b->reps, pool));
+}
+
+svn_error_t *
+svn_fs_fs__set_rep_reference(svn_fs_t *fs,
+                             representation_t *rep,
+                             apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  SVN_ERR_ASSERT(ffd->rep_sharing_allowed);
+
+  /* We only allow SHA1 checksums in this table. */
+  if (! rep->has_sha1)
+    return svn_error_create(SVN_ERR_BAD_CHECKSUM_KIND, NULL,
+                            _("Only SHA1 checksums can be used as keys in the "
+                              "rep_cache table.\n"));
+
+  if (ffd->rep_cache_index)
+    {
+      apr_array_header_t *reps = apr_array_make(pool, 1,
+                                                sizeof(representation_t *));
+      APR_ARRAY_PUSH(reps, representation_t *) = rep;
+
+      return svn_error_trace(svn_fs_fs__set_rep_references(fs, reps, pool));
+    }
+
+  return svn_error_trace(set_rep_in_db(fs, rep, pool));
+}
+
+svn_error_t *
+svn_fs_fs__set_rep_references(svn_fs_t *fs,
+                              const apr_array_header_t *reps,
+                              apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_pool_t *iterpool;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  SVN_ERR_ASSERT(ffd->rep_sharing_allowed);
+  if (reps->nelts == 0)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
+  if (ffd->rep_cache_index)
+    {
+      insert_baton_t baton;
+      baton.fs = fs;
+      baton.reps = reps;
+
+      /* All entries get written in one go, one append per shard. */
+      SVN_ERR(svn_fs_fs__with_rep_index_lock(fs, insert_into_rep_index,
+                                             &baton, pool));
+      return SVN_NO_ERROR;
+    }
+
+  /* We use an sqlite transaction to speed things up;
+   * see <http://www.sqlite.org/faq.html#q19>.
+   */
+  /* ### A commit that touches thousands of files will starve other
+         (reader/writer) commits for the duration of the below call.
+         Maybe write in batches? */
+  iterpool = svn_pool_create(pool);
+  SVN_ERR(svn_sqlite__begin_transaction(ffd->rep_cache_db));
+  for (i = 0; i < reps->nelts && !err; i++)
+    {
+      representation_t *rep = APR_ARRAY_IDX(reps, i, representation_t *);
+
+      svn_pool_clear(iterpool);
+      err = svn_fs_fs__set_rep_reference(fs, rep, iterpool);
+    }
+  svn_pool_destroy(iterpool);
+  err = svn_sqlite__finish_transaction(ffd->rep_cache_db, err);
+
+  if (svn_error_find_cause(err, SVN_ERR_SQLITE_ROLLBACK_FAILED))
+    {
+      /* Failed rollback means that our db connection is unusable, and
+         the only thing we can do is close it.  The connection will be
+         reopened during the next operation with rep-cache.db. */
+      return svn_error_trace(
+          svn_error_compose_create(err, svn_fs_fs__close_rep_cache(fs)));
+    }
+
+  return svn_error_trace(err);
+}
+
+/* Baton for delete_from_rep_index. */
+typedef struct delete_baton_t
+{
+  svn_fs_t *fs;
+  svn_revnum_t youngest;
+} delete_baton_t;
+
+/* Remove all entries younger than the revision given in the delete_baton_t
+   BATON from the rep-index.  Implements the BODY of
+   svn_fs_fs__with_rep_index_lock(). */
+static svn_error_t *
+delete_from_rep_index(void *baton,
+                      apr_pool_t *pool)
+{
+  delete_baton_t *b = baton;
+  svn_fs_fs__rep_index_t *index;
+
+  /* Don't trigger migration from rep-cache.db here. */
+  SVN_ERR(svn_fs_fs__rep_index_open(&index, b->fs, pool, pool));
+  SVN_ERR(svn_fs_fs__rep_index_delete_younger(index, b->fs, b->youngest,
+                                              pool));
+  svn_fs_fs__rep_index_close(index);
+
+  return SVN_NO_ERROR;
+}
 
 svn_error_t *
 svn_fs_fs__del_rep_reference(svn_fs_t *fs,
@@ -385,15 +686,34 @@ svn_fs_fs__del_rep_reference(svn_fs_t *fs,
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   svn_sqlite__stmt_t *stmt;
+  svn_boolean_t exists;
 
   SVN_ERR_ASSERT(ffd->format >= SVN_FS_FS__MIN_REP_SHARING_FORMAT);
-  if (! ffd->rep_cache_db)
-    SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
 
-  SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db,
-                                    STMT_DEL_REPS_YOUNGER_THAN_REV));
-  SVN_ERR(svn_sqlite__bindf(stmt, "r", youngest));
-  SVN_ERR(svn_sqlite__step_done(stmt));
+  /* Prune both stores such that neither will be inconsistent after
+     switching between them. */
+  SVN_ERR(svn_fs_fs__rep_index_exists(&exists, fs, pool));
+  if (exists)
+    {
+      delete_baton_t baton;
+      baton.fs = fs;
+      baton.youngest = youngest;
+
+      SVN_ERR(svn_fs_fs__with_rep_index_lock(fs, delete_from_rep_index,
+                                             &baton, pool));
+    }
+
+  SVN_ERR(exists_rep_cache_db(&exists, fs, pool));
+  if (exists)
+    {
+      if (! ffd->rep_cache_db)
+        SVN_ERR(open_rep_cache_db(fs, pool));
+
+      SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db,
+                                        STMT_DEL_REPS_YOUNGER_THAN_REV));
+      SVN_ERR(svn_sqlite__bindf(stmt, "r", youngest));
+      SVN_ERR(svn_sqlite__step_done(stmt));
+    }
 
   return SVN_NO_ERROR;
 }
@@ -409,7 +729,7 @@ lock_rep_cache(svn_fs_t *fs,
   fs_fs_data_t *ffd = fs->fsap_data;
 
   if (! ffd->rep_cache_db)
-    SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
+    SVN_ERR(open_rep_cache_db(fs, pool));
 
   SVN_ERR(svn_sqlite__exec_statements(ffd->rep_cache_db, STMT_LOCK_REP));
 
@@ -437,8 +757,13 @@ svn_fs_fs__with_rep_cache_lock(svn_fs_t *fs,
                                void *baton,
                                apr_pool_t *pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   svn_error_t *err;
 
+  if (ffd->rep_cache_index)
+    return svn_error_trace(svn_fs_fs__with_rep_index_lock(fs, body, baton,
+                                                          pool));
+
   SVN_ERR(lock_rep_cache(fs, pool));
   err = body(baton, pool);
   return svn_error_compose_create(err, unlock_rep_cache(fs, pool));
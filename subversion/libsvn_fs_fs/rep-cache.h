@@ -35,6 +35,8 @@ extern "C" {
 #define REP_CACHE_DB_NAME        "rep-cache.db"
 
 /* Open and create, if needed, the rep cache database associated with FS.
+   If FS has been configured to use the rep-index instead, open that one
+   and create it from the rep cache database, if necessary.
    Use POOL for temporary allocations. */
 svn_error_t *
 svn_fs_fs__open_rep_cache(svn_fs_t *fs,
@@ -44,7 +46,8 @@ svn_fs_fs__open_rep_cache(svn_fs_t *fs,
 svn_error_t *
 svn_fs_fs__close_rep_cache(svn_fs_t *fs);
 
-/* Set *EXISTS to TRUE iff the rep-cache DB file exists. */
+/* Set *EXISTS to TRUE iff the rep-cache DB file exists or, if FS has
+   been configured to use the rep-index, iff the rep-index exists. */
 svn_error_t *
 svn_fs_fs__exists_rep_cache(svn_boolean_t *exists,
                             svn_fs_t *fs, apr_pool_t *pool);
@@ -83,8 +86,17 @@ svn_fs_fs__set_rep_reference(svn_fs_t *fs,
                              representation_t *rep,
                              apr_pool_t *pool);
 
+/* Add all representations (representation_t *) in REPS to the rep cache
+   of FS in a single batch.  Entries whose checksum is already in the cache
+   will be ignored.  Use POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__set_rep_references(svn_fs_t *fs,
+                              const apr_array_header_t *reps,
+                              apr_pool_t *pool);
+
 /* Delete from the cache all reps corresponding to revisions younger
-   than YOUNGEST. */
+   than YOUNGEST.  This applies to both, the rep-cache database and the
+   rep-index, but does not create either of them. */
 svn_error_t *
 svn_fs_fs__del_rep_reference(svn_fs_t *fs,
                              svn_revnum_t youngest,
@@ -0,0 +1,1341 @@
+/* rep-index.c --- sharded hash index for rep-sharing
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include <apr_mmap.h>
+
+#include "svn_pools.h"
+#include "svn_dirent_uri.h"
+#include "svn_sorts.h"
+
+#include "private/svn_sorts_private.h"
+#include "private/svn_subr_private.h"
+
+#include "fs_fs.h"
+#include "id.h"
+#include "rep-index.h"
+#include "util.h"
+#include "../libsvn_fs/fs-loader.h"
+
+#include "svn_private_config.h"
+
+/* Entries get distributed over this many shards by the first byte of
+ * their SHA1 digest. */
+#define SHARD_COUNT 256
+
+/* Layout of a single index entry as stored in log and run files.
+ * All numbers are 64 bit little endian.  The FNV-1a checksum over all
+ * preceding bytes allows readers to detect partially written entries. */
+#define RECORD_REVISION_OFFSET     APR_SHA1_DIGESTSIZE
+#define RECORD_ITEM_INDEX_OFFSET   (RECORD_REVISION_OFFSET + 8)
+#define RECORD_SIZE_OFFSET         (RECORD_ITEM_INDEX_OFFSET + 8)
+#define RECORD_EXPANDED_OFFSET     (RECORD_SIZE_OFFSET + 8)
+#define RECORD_CHECKSUM_OFFSET     (RECORD_EXPANDED_OFFSET + 8)
+#define RECORD_SIZE                (RECORD_CHECKSUM_OFFSET + 4)
+
+/* Run files start with a header of this size: the magic string followed
+ * by the generation, the number of records and the size of the bloom
+ * filter in bytes. */
+#define RUN_MAGIC                  "SVNRIDX1"
+#define RUN_HEADER_SIZE            32
+
+/* Bloom filter parameters.  10 bits per entry and 7 probes give a false
+ * positive rate of about 1%. */
+#define BLOOM_BITS_PER_ENTRY       10
+#define BLOOM_PROBES               7
+
+/* Merge the log into the run once it contains more than this many entries
+ * or more than 1/LOG_RATIO of the number of entries in the run. */
+#define MIN_LOG_RECORDS            256
+#define LOG_RATIO                  128
+
+/* Amount of data that the loader buffers before writing it to disk. */
+#define LOADER_BUFFER_SIZE         (16 * 1024 * 1024)
+
+/* File attributes that identify a specific version of a run file. */
+#define RUN_FINFO_WANTED  (APR_FINFO_IDENT | APR_FINFO_MTIME | APR_FINFO_SIZE)
+
+/* Cached state of a single shard. */
+typedef struct shard_t
+{
+  /* Holds the mapped run file as well as the log data read so far.
+   * Cleared whenever we need to re-read the shard.  NULL until first use. */
+  apr_pool_t *pool;
+
+  /* If not set, the data below is invalid. */
+  svn_boolean_t loaded;
+
+  /* Generation of the run file that we mapped.  0 if there is none. */
+  apr_uint64_t generation;
+
+  /* Identity of the run file that we mapped, as far as the platform
+   * provides it.  RUN_VALID holds the APR_FINFO_* flags of the fields
+   * that are set.  Runs get replaced but never modified in place, so an
+   * unchanged identity means that we don't need to re-read the run. */
+  apr_int32_t run_valid;
+  apr_dev_t run_device;
+  apr_ino_t run_inode;
+  apr_time_t run_mtime;
+  apr_off_t run_size;
+
+  /* Bloom filter over all entries in RECORDS. */
+  const unsigned char *bloom;
+  apr_uint64_t bloom_bits;
+
+  /* RECORD_COUNT entries of RECORD_SIZE bytes each, sorted by SHA1. */
+  const unsigned char *records;
+  apr_uint64_t record_count;
+
+  /* Entries read from the log file, mapping the SHA1 digest to the
+   * record data. */
+  apr_hash_t *log;
+
+  /* Number of bytes of valid log data, i.e. read into LOG. */
+  apr_off_t log_offset;
+
+  /* Size of the log file when we last read it.  This may exceed
+   * LOG_OFFSET if the last record has not been written completely. */
+  apr_off_t log_size;
+} shard_t;
+
+struct svn_fs_fs__rep_index_t
+{
+  /* Directory containing the shard files. */
+  const char *path;
+
+  /* Parent pool of all shard pools. */
+  apr_pool_t *pool;
+
+  /* Per-shard state. */
+  shard_t shards[SHARD_COUNT];
+};
+
+struct svn_fs_fs__rep_index_loader_t
+{
+  /* The filesystem that we are building the index for. */
+  svn_fs_t *fs;
+
+  /* Directory being populated. */
+  const char *tmp_path;
+
+  /* Final location of the index. */
+  const char *path;
+
+  /* Entries not written to the shards' log files, yet.  NULL for shards
+   * that did not receive any data. */
+  svn_stringbuf_t *buffers[SHARD_COUNT];
+
+  /* Total number of bytes in BUFFERS. */
+  apr_size_t buffered;
+
+  /* Pool used for BUFFERS. */
+  apr_pool_t *pool;
+};
+
+
+/* Encoding utilities */
+
+static void
+encode_uint64(unsigned char *p,
+              apr_uint64_t value)
+{
+  int i;
+  for (i = 0; i < 8; ++i, value >>= 8)
+    p[i] = (unsigned char)(value & 0xff);
+}
+
+static apr_uint64_t
+decode_uint64(const unsigned char *p)
+{
+  apr_uint64_t value = 0;
+  int i;
+  for (i = 7; i >= 0; --i)
+    value = (value << 8) | p[i];
+
+  return value;
+}
+
+static apr_uint32_t
+record_checksum(const unsigned char *record)
+{
+  return svn__fnv1a_32(record, RECORD_CHECKSUM_OFFSET);
+}
+
+/* Serialize REP into the RECORD_SIZE bytes at RECORD. */
+static void
+encode_record(unsigned char *record,
+              const representation_t *rep)
+{
+  apr_uint32_t checksum;
+  int i;
+
+  memcpy(record, rep->sha1_digest, APR_SHA1_DIGESTSIZE);
+  encode_uint64(record + RECORD_REVISION_OFFSET,
+                (apr_uint64_t)(apr_int64_t)rep->revision);
+  encode_uint64(record + RECORD_ITEM_INDEX_OFFSET, rep->item_index);
+  encode_uint64(record + RECORD_SIZE_OFFSET, (apr_uint64_t)rep->size);
+  encode_uint64(record + RECORD_EXPANDED_OFFSET,
+                (apr_uint64_t)rep->expanded_size);
+
+  checksum = record_checksum(record);
+  for (i = 0; i < 4; ++i, checksum >>= 8)
+    record[RECORD_CHECKSUM_OFFSET + i] = (unsigned char)(checksum & 0xff);
+}
+
+/* Return TRUE if the checksum of RECORD matches its contents. */
+static svn_boolean_t
+record_is_valid(const unsigned char *record)
+{
+  const unsigned char *p = record + RECORD_CHECKSUM_OFFSET;
+  apr_uint32_t checksum = (apr_uint32_t)p[0]
+                        | ((apr_uint32_t)p[1] << 8)
+                        | ((apr_uint32_t)p[2] << 16)
+                        | ((apr_uint32_t)p[3] << 24);
+
+  return checksum == record_checksum(record);
+}
+
+/* Return the revision that RECORD refers to. */
+static svn_revnum_t
+record_revision(const unsigned char *record)
+{
+  return (svn_revnum_t)(apr_int64_t)decode_uint64(record
+                                                  + RECORD_REVISION_OFFSET);
+}
+
+/* Return the representation described by RECORD, allocated in
+ * RESULT_POOL. */
+static representation_t *
+parse_record(const unsigned char *record,
+             apr_pool_t *result_pool)
+{
+  representation_t *rep = apr_pcalloc(result_pool, sizeof(*rep));
+
+  svn_fs_fs__id_txn_reset(&rep->txn_id);
+  memcpy(rep->sha1_digest, record, sizeof(rep->sha1_digest));
+  rep->has_sha1 = TRUE;
+  rep->revision = record_revision(record);
+  rep->item_index = decode_uint64(record + RECORD_ITEM_INDEX_OFFSET);
+  rep->size = (svn_filesize_t)decode_uint64(record + RECORD_SIZE_OFFSET);
+  rep->expanded_size
+    = (svn_filesize_t)decode_uint64(record + RECORD_EXPANDED_OFFSET);
+
+  return rep;
+}
+
+/* Implements svn_sort__array's comparison function for arrays of
+ * records, i.e. const unsigned char *. */
+static int
+compare_records(const void *lhs,
+                const void *rhs)
+{
+  const unsigned char *lhs_record = *(const unsigned char * const *)lhs;
+  const unsigned char *rhs_record = *(const unsigned char * const *)rhs;
+
+  return memcmp(lhs_record, rhs_record, APR_SHA1_DIGESTSIZE);
+}
+
+
+/* Bloom filter */
+
+/* Return the number of bits to use for a bloom filter over COUNT entries.
+ * The result is a multiple of 64. */
+static apr_uint64_t
+bloom_bit_count(apr_uint64_t count)
+{
+  apr_uint64_t bits = count * BLOOM_BITS_PER_ENTRY;
+  return (bits + 63) / 64 * 64;
+}
+
+/* Call with the SHA1 DIGEST and set the BLOOM_PROBES bit positions
+ * in POSITIONS within a filter of BITS bits.  The shard number is taken
+ * from the first byte of DIGEST, so we use the rest only.  */
+static void
+bloom_positions(apr_uint64_t *positions,
+                const unsigned char *digest,
+                apr_uint64_t bits)
+{
+  apr_uint64_t h1 = decode_uint64(digest + 4);
+  apr_uint64_t h2 = decode_uint64(digest + 12) | 1;
+  int i;
+
+  for (i = 0; i < BLOOM_PROBES; ++i)
+    positions[i] = (h1 + i * h2) % bits;
+}
+
+static void
+bloom_add(unsigned char *bloom,
+          apr_uint64_t bits,
+          const unsigned char *digest)
+{
+  apr_uint64_t positions[BLOOM_PROBES];
+  int i;
+
+  bloom_positions(positions, digest, bits);
+  for (i = 0; i < BLOOM_PROBES; ++i)
+    bloom[positions[i] / 8] |= (unsigned char)(1 << (positions[i] % 8));
+}
+
+static svn_boolean_t
+bloom_may_contain(const unsigned char *bloom,
+                  apr_uint64_t bits,
+                  const unsigned char *digest)
+{
+  apr_uint64_t positions[BLOOM_PROBES];
+  int i;
+
+  if (bits == 0)
+    return FALSE;
+
+  bloom_positions(positions, digest, bits);
+  for (i = 0; i < BLOOM_PROBES; ++i)
+    if ((bloom[positions[i] / 8] & (1 << (positions[i] % 8))) == 0)
+      return FALSE;
+
+  return TRUE;
+}
+
+
+/* Shard access */
+
+/* Return the path of file SUFFIX of shard SHARD_NO in index directory
+ * DIR.  Allocate the result in RESULT_POOL. */
+static const char *
+shard_path(const char *dir,
+           int shard_no,
+           const char *suffix,
+           apr_pool_t *result_pool)
+{
+  return svn_dirent_join(dir,
+                         apr_psprintf(result_pool, "%02x%s", shard_no,
+                                      suffix),
+                         result_pool);
+}
+
+/* Return the 64 bit number formed by the SHA1 bytes following the shard
+ * byte in RECORD or DIGEST, respectively. */
+static apr_uint64_t
+key_prefix(const unsigned char *digest)
+{
+  apr_uint64_t value = 0;
+  int i;
+  for (i = 1; i < 9; ++i)
+    value = (value << 8) | digest[i];
+
+  return value;
+}
+
+/* Return the record for DIGEST in the run of SHARD or NULL, if there is
+ * none.  Since SHA1 values are evenly distributed, we use interpolation
+ * search falling back to bisection if that should not converge quickly. */
+static const unsigned char *
+find_in_run(const shard_t *shard,
+            const unsigned char *digest)
+{
+  apr_uint64_t lower = 0;
+  apr_uint64_t upper = shard->record_count;
+  apr_uint64_t key = key_prefix(digest);
+  int iterations = 0;
+
+  if (!bloom_may_contain(shard->bloom, shard->bloom_bits, digest))
+    return NULL;
+
+  while (lower < upper)
+    {
+      apr_uint64_t pos;
+      const unsigned char *record;
+      int diff;
+
+      if (upper - lower > 8 && ++iterations <= 8)
+        {
+          apr_uint64_t lower_key
+            = key_prefix(shard->records + lower * RECORD_SIZE);
+          apr_uint64_t upper_key
+            = key_prefix(shard->records + (upper - 1) * RECORD_SIZE);
+
+          if (key < lower_key || key > upper_key)
+            return NULL;
+
+          pos = lower_key == upper_key
+              ? lower + (upper - lower) / 2
+              : lower + (apr_uint64_t)(  (double)(key - lower_key)
+                                       / (double)(upper_key - lower_key)
+                                       * (double)(upper - lower - 1));
+        }
+      else
+        {
+          pos = lower + (upper - lower) / 2;
+        }
+
+      record = shard->records + pos * RECORD_SIZE;
+      diff = memcmp(digest, record, APR_SHA1_DIGESTSIZE);
+      if (diff == 0)
+        return record;
+
+      if (diff < 0)
+        upper = pos;
+      else
+        lower = pos + 1;
+    }
+
+  return NULL;
+}
+
+/* Return the record for DIGEST in SHARD or NULL, if there is none. */
+static const unsigned char *
+find_record(const shard_t *shard,
+            const unsigned char *digest)
+{
+  const unsigned char *record = apr_hash_get(shard->log, digest,
+                                             APR_SHA1_DIGESTSIZE);
+  if (record)
+    return record;
+
+  return find_in_run(shard, digest);
+}
+
+/* Return an SVN_ERR_FS_CORRUPT error for the run file at PATH. */
+static svn_error_t *
+corrupt_run(const char *path,
+            apr_pool_t *scratch_pool)
+{
+  return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                           _("Corrupt rep index file '%s'"),
+                           svn_dirent_local_style(path, scratch_pool));
+}
+
+/* Forget all cached data of SHARD and map the run file at PATH, if it
+ * exists.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+map_run(shard_t *shard,
+        const char *path,
+        apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  apr_off_t size;
+  apr_uint64_t bloom_size;
+  const unsigned char *data = NULL;
+  svn_error_t *err;
+
+  svn_pool_clear(shard->pool);
+  shard->loaded = FALSE;
+  shard->generation = 0;
+  shard->run_valid = 0;
+  shard->bloom = NULL;
+  shard->bloom_bits = 0;
+  shard->records = NULL;
+  shard->record_count = 0;
+  shard->log = apr_hash_make(shard->pool);
+  shard->log_offset = 0;
+  shard->log_size = 0;
+
+  err = svn_io_file_open(&file, path, APR_READ | APR_BINARY, APR_OS_DEFAULT,
+                         shard->pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      /* No run, i.e. all entries are in the log. */
+      svn_error_clear(err);
+      shard->loaded = TRUE;
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_io_file_size_get(&size, file, scratch_pool));
+  if (size < RUN_HEADER_SIZE || (apr_off_t)(apr_size_t)size != size)
+    return svn_error_trace(corrupt_run(path, scratch_pool));
+
+  /* Not all platforms can tell us the file identity.  We will then have
+   * to check the generation in the run header instead. */
+  {
+    apr_finfo_t finfo;
+    svn_error_t *info_err = svn_io_file_info_get(&finfo, RUN_FINFO_WANTED,
+                                                 file, scratch_pool);
+    if (info_err && APR_STATUS_IS_INCOMPLETE(info_err->apr_err))
+      svn_error_clear(info_err);
+    else if (info_err)
+      return svn_error_trace(info_err);
+    else
+      {
+        shard->run_valid = finfo.valid & RUN_FINFO_WANTED;
+        shard->run_device = finfo.device;
+        shard->run_inode = finfo.inode;
+        shard->run_mtime = finfo.mtime;
+        shard->run_size = finfo.size;
+      }
+  }
+
+#if APR_HAS_MMAP
+  {
+    apr_mmap_t *mmap;
+    if (apr_mmap_create(&mmap, file, 0, (apr_size_t)size, APR_MMAP_READ,
+                        shard->pool) == APR_SUCCESS)
+      data = mmap->mm;
+  }
+#endif
+
+  if (!data)
+    {
+      unsigned char *buffer = apr_palloc(shard->pool, (apr_size_t)size);
+      SVN_ERR(svn_io_file_read_full2(file, buffer, (apr_size_t)size,
+                                     NULL, NULL, scratch_pool));
+      data = buffer;
+    }
+
+  /* Mappings remain valid after closing the file. */
+  SVN_ERR(svn_io_file_close(file, scratch_pool));
+
+  if (memcmp(data, RUN_MAGIC, 8) != 0)
+    return svn_error_trace(corrupt_run(path, scratch_pool));
+
+  shard->generation = decode_uint64(data + 8);
+  shard->record_count = decode_uint64(data + 16);
+  bloom_size = decode_uint64(data + 24);
+  if (   shard->record_count > (apr_uint64_t)size / RECORD_SIZE
+      || bloom_size > (apr_uint64_t)size
+      ||   RUN_HEADER_SIZE + bloom_size + shard->record_count * RECORD_SIZE
+         != (apr_uint64_t)size)
+    return svn_error_trace(corrupt_run(path, scratch_pool));
+
+  shard->bloom = data + RUN_HEADER_SIZE;
+  shard->bloom_bits = bloom_size * 8;
+  shard->records = shard->bloom + bloom_size;
+  shard->loaded = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *GENERATION to the generation of the run file at PATH, 0 if there
+ * is no such file.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+read_generation(apr_uint64_t *generation,
+                const char *path,
+                apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  unsigned char header[RUN_HEADER_SIZE];
+  apr_size_t bytes_read;
+  svn_error_t *err;
+
+  err = svn_io_file_open(&file, path, APR_READ | APR_BINARY, APR_OS_DEFAULT,
+                         scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      *generation = 0;
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_io_file_read_full2(file, header, sizeof(header), &bytes_read,
+                                 NULL, scratch_pool));
+  SVN_ERR(svn_io_file_close(file, scratch_pool));
+  if (bytes_read != sizeof(header) || memcmp(header, RUN_MAGIC, 8) != 0)
+    return svn_error_trace(corrupt_run(path, scratch_pool));
+
+  *generation = decode_uint64(header + 8);
+  return SVN_NO_ERROR;
+}
+
+/* Set *CHANGED to FALSE if the run file at PATH is still the one that
+ * SHARD has mapped.  Compare the file identities if possible and fall back
+ * to reading the run's generation otherwise.  Use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_error_t *
+run_changed(svn_boolean_t *changed,
+            const shard_t *shard,
+            const char *path,
+            apr_pool_t *scratch_pool)
+{
+  apr_finfo_t finfo;
+  apr_uint64_t generation;
+  svn_error_t *err;
+
+  err = svn_io_stat(&finfo, path, RUN_FINFO_WANTED, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      *changed = shard->generation != 0;
+      return SVN_NO_ERROR;
+    }
+  else if (err && APR_STATUS_IS_INCOMPLETE(err->apr_err))
+    {
+      svn_error_clear(err);
+    }
+  else
+    {
+      SVN_ERR(err);
+      if (   shard->run_valid == RUN_FINFO_WANTED
+          && (finfo.valid & RUN_FINFO_WANTED) == RUN_FINFO_WANTED)
+        {
+          *changed = shard->generation == 0
+                  || finfo.device != shard->run_device
+                  || finfo.inode != shard->run_inode
+                  || finfo.mtime != shard->run_mtime
+                  || finfo.size != shard->run_size;
+          return SVN_NO_ERROR;
+        }
+    }
+
+  SVN_ERR(read_generation(&generation, path, scratch_pool));
+  *changed = generation != shard->generation;
+
+  return SVN_NO_ERROR;
+}
+
+/* Read any entries appended to the log file at PATH since we last read it
+ * and add them to SHARD.  Set *TRUNCATED if the file has been truncated in
+ * the meantime, i.e. the cached data is out of date.  Use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_error_t *
+read_log(svn_boolean_t *truncated,
+         shard_t *shard,
+         const char *path,
+         apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  apr_finfo_t finfo;
+  apr_off_t size;
+  apr_off_t offset;
+  apr_size_t to_read, i;
+  unsigned char *buffer;
+  svn_error_t *err;
+
+  /* Logs only ever get appended to or truncated together with replacing
+   * the run.  Unless there is an incomplete entry at the end that might
+   * have been overwritten since, don't open the file if its size did not
+   * change. */
+  *truncated = FALSE;
+  err = svn_io_stat(&finfo, path, APR_FINFO_SIZE, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      *truncated = shard->log_offset > 0;
+      shard->log_size = 0;
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  if (finfo.size == shard->log_size && shard->log_size == shard->log_offset)
+    return SVN_NO_ERROR;
+
+  err = svn_io_file_open(&file, path, APR_READ | APR_BINARY, APR_OS_DEFAULT,
+                         scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      *truncated = shard->log_offset > 0;
+      shard->log_size = 0;
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_io_file_size_get(&size, file, scratch_pool));
+  if (size < shard->log_offset)
+    {
+      *truncated = TRUE;
+      return svn_error_trace(svn_io_file_close(file, scratch_pool));
+    }
+
+  shard->log_size = size;
+  to_read = (apr_size_t)((size - shard->log_offset) / RECORD_SIZE
+                         * RECORD_SIZE);
+  if (to_read == 0)
+    return svn_error_trace(svn_io_file_close(file, scratch_pool));
+
+  /* The hash will point into this buffer. */
+  buffer = apr_palloc(shard->pool, to_read);
+  offset = shard->log_offset;
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+  SVN_ERR(svn_io_file_read_full2(file, buffer, to_read, NULL, NULL,
+                                 scratch_pool));
+  SVN_ERR(svn_io_file_close(file, scratch_pool));
+
+  /* Stop at the first incomplete entry.  Writers are going to replace it
+   * before appending new ones. */
+  for (i = 0; i < to_read; i += RECORD_SIZE)
+    {
+      const unsigned char *record = buffer + i;
+      if (!record_is_valid(record))
+        break;
+
+      apr_hash_set(shard->log, record, APR_SHA1_DIGESTSIZE, record);
+      shard->log_offset += RECORD_SIZE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Make sure that the cached data for shard SHARD_NO in INDEX is up to date.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+refresh_shard(svn_fs_fs__rep_index_t *index,
+              int shard_no,
+              apr_pool_t *scratch_pool)
+{
+  shard_t *shard = &index->shards[shard_no];
+  const char *run_path = shard_path(index->path, shard_no, "",
+                                    scratch_pool);
+  const char *log_path = shard_path(index->path, shard_no, ".log",
+                                    scratch_pool);
+
+  if (!shard->pool)
+    shard->pool = svn_pool_create(index->pool);
+
+  /* Writers first replace the run and then truncate the log.  So, if the
+   * run did not change after we read the log, the log contents belong to
+   * the run that we have mapped.  In the common case of nothing having
+   * changed, this takes two stat() calls and no file gets opened. */
+  while (TRUE)
+    {
+      svn_boolean_t truncated;
+      svn_boolean_t changed;
+
+      if (!shard->loaded)
+        SVN_ERR(map_run(shard, run_path, scratch_pool));
+
+      SVN_ERR(read_log(&truncated, shard, log_path, scratch_pool));
+      if (!truncated)
+        {
+          SVN_ERR(run_changed(&changed, shard, run_path, scratch_pool));
+          if (!changed)
+            return SVN_NO_ERROR;
+        }
+
+      shard->loaded = FALSE;
+    }
+}
+
+/* Write the records (const unsigned char *) in RECORDS as a new run file
+ * with the given GENERATION for shard SHARD_NO to index directory DIR of
+ * FS.  RECORDS will be sorted by this function and duplicates dropped.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+write_run(const char *dir,
+          int shard_no,
+          apr_array_header_t *records,
+          apr_uint64_t generation,
+          svn_fs_t *fs,
+          apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const char *tmp_path = shard_path(dir, shard_no, ".tmp", scratch_pool);
+  const char *run_path = shard_path(dir, shard_no, "", scratch_pool);
+  unsigned char header[RUN_HEADER_SIZE];
+  unsigned char *bloom;
+  apr_uint64_t bits;
+  apr_file_t *file;
+  int i, count;
+
+  /* Sort and remove duplicates. */
+  svn_sort__array(records, compare_records);
+  for (i = 0, count = 0; i < records->nelts; ++i)
+    {
+      const unsigned char *record
+        = APR_ARRAY_IDX(records, i, const unsigned char *);
+      if (   count == 0
+          || memcmp(record,
+                    APR_ARRAY_IDX(records, count - 1, const unsigned char *),
+                    APR_SHA1_DIGESTSIZE))
+        APR_ARRAY_IDX(records, count++, const unsigned char *) = record;
+    }
+  records->nelts = count;
+
+  bits = bloom_bit_count(count);
+  bloom = apr_pcalloc(scratch_pool, (apr_size_t)(bits / 8));
+  for (i = 0; i < count; ++i)
+    bloom_add(bloom, bits,
+              APR_ARRAY_IDX(records, i, const unsigned char *));
+
+  memcpy(header, RUN_MAGIC, 8);
+  encode_uint64(header + 8, generation);
+  encode_uint64(header + 16, count);
+  encode_uint64(header + 24, bits / 8);
+
+  SVN_ERR(svn_io_file_open(&file, tmp_path,
+                           APR_WRITE | APR_CREATE | APR_TRUNCATE
+                           | APR_BUFFERED | APR_BINARY,
+                           APR_OS_DEFAULT, scratch_pool));
+  SVN_ERR(svn_io_file_write_full(file, header, sizeof(header), NULL,
+                                 scratch_pool));
+  SVN_ERR(svn_io_file_write_full(file, bloom, (apr_size_t)(bits / 8), NULL,
+                                 scratch_pool));
+  for (i = 0; i < count; ++i)
+    SVN_ERR(svn_io_file_write_full(file,
+                                   APR_ARRAY_IDX(records, i,
+                                                 const unsigned char *),
+                                   RECORD_SIZE, NULL, scratch_pool));
+  SVN_ERR(svn_io_file_close(file, scratch_pool));
+
+  return svn_error_trace(svn_fs_fs__move_into_place(tmp_path, run_path,
+                           svn_fs_fs__path_current(fs, scratch_pool),
+                           ffd->flush_to_disk, scratch_pool));
+}
+
+/* Merge the log of shard SHARD_NO in INDEX of FS into a new run.  Drop all
+ * entries referring to revisions younger than YOUNGEST unless that is
+ * SVN_INVALID_REVNUM.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+compact_shard(svn_fs_fs__rep_index_t *index,
+              svn_fs_t *fs,
+              int shard_no,
+              svn_revnum_t youngest,
+              apr_pool_t *scratch_pool)
+{
+  shard_t *shard = &index->shards[shard_no];
+  apr_array_header_t *records
+    = apr_array_make(scratch_pool,
+                     (int)shard->record_count + apr_hash_count(shard->log),
+                     sizeof(const unsigned char *));
+  apr_hash_index_t *hi;
+  apr_uint64_t i;
+  apr_file_t *file;
+
+  for (i = 0; i < shard->record_count; ++i)
+    {
+      const unsigned char *record = shard->records + i * RECORD_SIZE;
+      if (!SVN_IS_VALID_REVNUM(youngest)
+          || record_revision(record) <= youngest)
+        APR_ARRAY_PUSH(records, const unsigned char *) = record;
+    }
+
+  for (hi = apr_hash_first(scratch_pool, shard->log);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      const unsigned char *record = apr_hash_this_val(hi);
+      if (!SVN_IS_VALID_REVNUM(youngest)
+          || record_revision(record) <= youngest)
+        APR_ARRAY_PUSH(records, const unsigned char *) = record;
+    }
+
+  SVN_ERR(write_run(index->path, shard_no, records, shard->generation + 1,
+                    fs, scratch_pool));
+
+  /* Only now that the new run is in place, we may drop the log.
+   * See refresh_shard(). */
+  shard->loaded = FALSE;
+  SVN_ERR(svn_io_file_open(&file,
+                           shard_path(index->path, shard_no, ".log",
+                                      scratch_pool),
+                           APR_WRITE | APR_CREATE | APR_TRUNCATE | APR_BINARY,
+                           APR_OS_DEFAULT, scratch_pool));
+  SVN_ERR(svn_io_file_close(file, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Append those of the representations in REPS that are not in shard
+ * SHARD_NO of INDEX of FS, yet, to the shard's log and compact the shard
+ * if necessary.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+insert_into_shard(svn_fs_fs__rep_index_t *index,
+                  svn_fs_t *fs,
+                  int shard_no,
+                  const apr_array_header_t *reps,
+                  apr_pool_t *scratch_pool)
+{
+  shard_t *shard = &index->shards[shard_no];
+  const char *log_path = shard_path(index->path, shard_no, ".log",
+                                    scratch_pool);
+  svn_stringbuf_t *buffer;
+  apr_file_t *file;
+  apr_off_t offset;
+  svn_error_t *err;
+  int i;
+
+  SVN_ERR(refresh_shard(index, shard_no, scratch_pool));
+
+  buffer = svn_stringbuf_create_ensure(reps->nelts * RECORD_SIZE,
+                                       scratch_pool);
+  for (i = 0; i < reps->nelts; ++i)
+    {
+      const representation_t *rep
+        = APR_ARRAY_IDX(reps, i, const representation_t *);
+      unsigned char *record;
+
+      /* Existing entries take precedence.  This includes duplicates
+       * within REPS. */
+      if (find_record(shard, rep->sha1_digest))
+        continue;
+
+      record = apr_palloc(shard->pool, RECORD_SIZE);
+      encode_record(record, rep);
+      apr_hash_set(shard->log, record, APR_SHA1_DIGESTSIZE, record);
+      svn_stringbuf_appendbytes(buffer, (const char *)record, RECORD_SIZE);
+    }
+
+  if (buffer->len == 0)
+    return SVN_NO_ERROR;
+
+  /* Replace any incomplete entry left behind by an interrupted writer. */
+  err = svn_io_file_open(&file, log_path,
+                         APR_WRITE | APR_CREATE | APR_BINARY,
+                         APR_OS_DEFAULT, scratch_pool);
+  if (!err && shard->log_size != shard->log_offset)
+    err = svn_io_file_trunc(file, shard->log_offset, scratch_pool);
+  if (!err)
+    {
+      offset = shard->log_offset;
+      err = svn_io_file_seek(file, APR_SET, &offset, scratch_pool);
+    }
+  if (!err)
+    err = svn_io_file_write_full(file, buffer->data, buffer->len, NULL,
+                                 scratch_pool);
+  if (!err)
+    err = svn_io_file_close(file, scratch_pool);
+
+#ifndef WIN32
+  if (!err && shard->log_offset == 0)
+    err = svn_io_copy_perms(svn_fs_fs__path_current(fs, scratch_pool),
+                            log_path, scratch_pool);
+#endif
+
+  if (err)
+    {
+      /* Our cached view of the log is no longer reliable. */
+      shard->loaded = FALSE;
+      return svn_error_trace(err);
+    }
+
+  shard->log_offset += buffer->len;
+  shard->log_size = shard->log_offset;
+
+  if (apr_hash_count(shard->log)
+      > MAX(MIN_LOG_RECORDS, shard->record_count / LOG_RATIO))
+    SVN_ERR(compact_shard(index, fs, shard_no, SVN_INVALID_REVNUM,
+                          scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Library-private API's. */
+
+svn_error_t *
+svn_fs_fs__rep_index_exists(svn_boolean_t *exists,
+                            svn_fs_t *fs,
+                            apr_pool_t *pool)
+{
+  svn_node_kind_t kind;
+
+  SVN_ERR(svn_io_check_path(svn_dirent_join(fs->path, PATH_REP_INDEX_DIR,
+                                            pool),
+                            &kind, pool));
+
+  *exists = (kind == svn_node_dir);
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__rep_index_open(svn_fs_fs__rep_index_t **index,
+                          svn_fs_t *fs,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__rep_index_t *result;
+  svn_boolean_t exists;
+
+  SVN_ERR(svn_fs_fs__rep_index_exists(&exists, fs, scratch_pool));
+  if (!exists)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Rep index '%s' does not exist"),
+                             svn_dirent_local_style(
+                               svn_dirent_join(fs->path, PATH_REP_INDEX_DIR,
+                                               scratch_pool),
+                               scratch_pool));
+
+  /* Use a separate pool such that we can release the mappings early. */
+  result_pool = svn_pool_create(result_pool);
+  result = apr_pcalloc(result_pool, sizeof(*result));
+  result->path = svn_dirent_join(fs->path, PATH_REP_INDEX_DIR, result_pool);
+  result->pool = result_pool;
+  *index = result;
+
+  return SVN_NO_ERROR;
+}
+
+void
+svn_fs_fs__rep_index_close(svn_fs_fs__rep_index_t *index)
+{
+  svn_pool_destroy(index->pool);
+}
+
+svn_error_t *
+svn_fs_fs__rep_index_lookup(apr_array_header_t **reps_p,
+                            svn_fs_fs__rep_index_t *index,
+                            const apr_array_header_t *digests,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *reps = apr_array_make(result_pool, digests->nelts,
+                                            sizeof(representation_t *));
+  svn_boolean_t refreshed[SHARD_COUNT] = { FALSE };
+  int i;
+
+  for (i = 0; i < digests->nelts; ++i)
+    {
+      const unsigned char *digest
+        = APR_ARRAY_IDX(digests, i, const unsigned char *);
+      const unsigned char *record;
+      int shard_no = digest[0];
+
+      /* Visit the disk only once per shard and batch. */
+      if (!refreshed[shard_no])
+        {
+          SVN_ERR(refresh_shard(index, shard_no, scratch_pool));
+          refreshed[shard_no] = TRUE;
+        }
+
+      record = find_record(&index->shards[shard_no], digest);
+      APR_ARRAY_PUSH(reps, representation_t *)
+        = record ? parse_record(record, result_pool) : NULL;
+    }
+
+  *reps_p = reps;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__rep_index_insert(svn_fs_fs__rep_index_t *index,
+                            svn_fs_t *fs,
+                            const apr_array_header_t *reps,
+                            apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *by_shard[SHARD_COUNT] = { NULL };
+  apr_pool_t *iterpool;
+  int i;
+
+  for (i = 0; i < reps->nelts; ++i)
+    {
+      representation_t *rep = APR_ARRAY_IDX(reps, i, representation_t *);
+      int shard_no;
+
+      if (!rep->has_sha1)
+        continue;
+
+      shard_no = rep->sha1_digest[0];
+      if (!by_shard[shard_no])
+        by_shard[shard_no] = apr_array_make(scratch_pool, 4,
+                                            sizeof(representation_t *));
+
+      APR_ARRAY_PUSH(by_shard[shard_no], representation_t *) = rep;
+    }
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < SHARD_COUNT; ++i)
+    if (by_shard[i])
+      {
+        svn_pool_clear(iterpool);
+        SVN_ERR(insert_into_shard(index, fs, i, by_shard[i], iterpool));
+      }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__rep_index_delete_younger(svn_fs_fs__rep_index_t *index,
+                                    svn_fs_t *fs,
+                                    svn_revnum_t youngest,
+                                    apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  for (i = 0; i < SHARD_COUNT; ++i)
+    {
+      shard_t *shard = &index->shards[i];
+      svn_boolean_t found = FALSE;
+      apr_hash_index_t *hi;
+      apr_uint64_t k;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(refresh_shard(index, i, iterpool));
+
+      for (k = 0; k < shard->record_count && !found; ++k)
+        found = record_revision(shard->records + k * RECORD_SIZE) > youngest;
+
+      for (hi = apr_hash_first(iterpool, shard->log);
+           hi && !found;
+           hi = apr_hash_next(hi))
+        found = record_revision(apr_hash_this_val(hi)) > youngest;
+
+      if (found)
+        SVN_ERR(compact_shard(index, fs, i, youngest, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__rep_index_walk(svn_fs_fs__rep_index_t *index,
+                          svn_fs_t *fs,
+                          svn_revnum_t start,
+                          svn_revnum_t end,
+                          svn_error_t *(*walker)(representation_t *,
+                                                 void *,
+                                                 svn_fs_t *,
+                                                 apr_pool_t *),
+                          void *walker_baton,
+                          svn_cancel_func_t cancel_func,
+                          void *cancel_baton,
+                          apr_pool_t *scratch_pool)
+{
+  svn_revnum_t max_checked = -1;
+  apr_pool_t *shardpool = svn_pool_create(scratch_pool);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int iterations = 0;
+  int i, k;
+
+  for (i = 0; i < SHARD_COUNT; ++i)
+    {
+      shard_t *shard = &index->shards[i];
+      apr_array_header_t *records;
+      apr_hash_index_t *hi;
+      apr_uint64_t r;
+
+      svn_pool_clear(shardpool);
+      SVN_ERR(refresh_shard(index, i, shardpool));
+
+      /* Collect the shard's entries first as the walker might take a
+       * while and we want a consistent view. */
+      records = apr_array_make(shardpool,
+                               (int)shard->record_count
+                               + apr_hash_count(shard->log),
+                               sizeof(const unsigned char *));
+      for (r = 0; r < shard->record_count; ++r)
+        APR_ARRAY_PUSH(records, const unsigned char *)
+          = shard->records + r * RECORD_SIZE;
+      for (hi = apr_hash_first(shardpool, shard->log);
+           hi;
+           hi = apr_hash_next(hi))
+        APR_ARRAY_PUSH(records, const unsigned char *) = apr_hash_this_val(hi);
+
+      for (k = 0; k < records->nelts; ++k)
+        {
+          const unsigned char *record
+            = APR_ARRAY_IDX(records, k, const unsigned char *);
+          svn_revnum_t revision = record_revision(record);
+
+          /* Clear ITERPOOL occasionally. */
+          if (iterations++ % 16 == 0)
+            svn_pool_clear(iterpool);
+
+          /* Check global invariants. */
+          if (start == 0 && revision > max_checked)
+            {
+              SVN_ERR(svn_fs_fs__ensure_revision_exists(revision, fs,
+                                                        iterpool));
+              max_checked = revision;
+            }
+
+          if (revision < start || revision > end)
+            continue;
+
+          if (cancel_func)
+            SVN_ERR(cancel_func(cancel_baton));
+
+          SVN_ERR(walker(parse_record(record, iterpool), walker_baton, fs,
+                         iterpool));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  svn_pool_destroy(shardpool);
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Bulk loading. */
+
+/* Append all data buffered in LOADER to the respective log files.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+flush_loader(svn_fs_fs__rep_index_loader_t *loader,
+             apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  for (i = 0; i < SHARD_COUNT; ++i)
+    {
+      svn_stringbuf_t *buffer = loader->buffers[i];
+      apr_file_t *file;
+
+      if (!buffer || buffer->len == 0)
+        continue;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_io_file_open(&file,
+                               shard_path(loader->tmp_path, i, ".log",
+                                          iterpool),
+                               APR_WRITE | APR_CREATE | APR_APPEND
+                               | APR_BINARY,
+                               APR_OS_DEFAULT, iterpool));
+      SVN_ERR(svn_io_file_write_full(file, buffer->data, buffer->len, NULL,
+                                     iterpool));
+      SVN_ERR(svn_io_file_close(file, iterpool));
+
+      svn_stringbuf_setempty(buffer);
+    }
+
+  loader->buffered = 0;
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__rep_index_loader_create(svn_fs_fs__rep_index_loader_t **loader,
+                                   svn_fs_t *fs,
+                                   apr_pool_t *result_pool,
+                                   apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__rep_index_loader_t *result
+    = apr_pcalloc(result_pool, sizeof(*result));
+
+  result->fs = fs;
+  result->path = svn_dirent_join(fs->path, PATH_REP_INDEX_DIR, result_pool);
+  result->tmp_path = apr_pstrcat(result_pool, result->path, ".tmp",
+                                 SVN_VA_NULL);
+  result->pool = result_pool;
+
+  /* Remove leftovers from interrupted attempts. */
+  SVN_ERR(svn_io_remove_dir2(result->tmp_path, TRUE, NULL, NULL,
+                             scratch_pool));
+  SVN_ERR(svn_io_dir_make(result->tmp_path, APR_OS_DEFAULT, scratch_pool));
+  SVN_ERR(svn_io_copy_perms(fs->path, result->tmp_path, scratch_pool));
+
+  *loader = result;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__rep_index_loader_add(svn_fs_fs__rep_index_loader_t *loader,
+                                const representation_t *rep,
+                                apr_pool_t *scratch_pool)
+{
+  unsigned char record[RECORD_SIZE];
+  int shard_no = rep->sha1_digest[0];
+
+  SVN_ERR_ASSERT(rep->has_sha1);
+
+  if (!loader->buffers[shard_no])
+    loader->buffers[shard_no] = svn_stringbuf_create_empty(loader->pool);
+
+  encode_record(record, rep);
+  svn_stringbuf_appendbytes(loader->buffers[shard_no], (const char *)record,
+                            sizeof(record));
+
+  loader->buffered += sizeof(record);
+  if (loader->buffered >= LOADER_BUFFER_SIZE)
+    SVN_ERR(flush_loader(loader, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__rep_index_loader_finish(svn_fs_fs__rep_index_loader_t *loader,
+                                   apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = loader->fs->fsap_data;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_node_kind_t kind;
+
+  /* Use a time stamp as initial generation such that readers will never
+   * confuse the new runs with ones from a previous incarnation. */
+  apr_uint64_t generation = (apr_uint64_t)apr_time_now();
+  int i;
+
+  SVN_ERR(flush_loader(loader, scratch_pool));
+
+  /* Write a run for every shard, even empty ones, such that each shard of
+   * an existing index gets replaced below. */
+  for (i = 0; i < SHARD_COUNT; ++i)
+    {
+      const char *log_path;
+      svn_stringbuf_t *contents;
+      apr_array_header_t *records;
+      apr_size_t k;
+
+      svn_pool_clear(iterpool);
+      if (!loader->buffers[i])
+        {
+          records = apr_array_make(iterpool, 0, sizeof(const unsigned char *));
+          SVN_ERR(write_run(loader->tmp_path, i, records, generation,
+                            loader->fs, iterpool));
+          continue;
+        }
+
+      log_path = shard_path(loader->tmp_path, i, ".log", iterpool);
+      SVN_ERR(svn_stringbuf_from_file2(&contents, log_path, iterpool));
+
+      records = apr_array_make(iterpool, (int)(contents->len / RECORD_SIZE),
+                               sizeof(const unsigned char *));
+      for (k = 0; k + RECORD_SIZE <= contents->len; k += RECORD_SIZE)
+        APR_ARRAY_PUSH(records, const unsigned char *)
+          = (const unsigned char *)contents->data + k;
+
+      SVN_ERR(write_run(loader->tmp_path, i, records, generation,
+                        loader->fs, iterpool));
+      SVN_ERR(svn_io_remove_file2(log_path, FALSE, iterpool));
+    }
+
+  /* Without an index, moving the whole directory into place is atomic. */
+  SVN_ERR(svn_io_check_path(loader->path, &kind, scratch_pool));
+  if (kind == svn_node_none)
+    {
+      svn_pool_destroy(iterpool);
+      return svn_error_trace(svn_io_file_rename2(loader->tmp_path,
+                                                 loader->path,
+                                                 ffd->flush_to_disk,
+                                                 scratch_pool));
+    }
+
+  /* Otherwise, replace the existing index shard by shard, each of them
+   * atomically.  The old log belongs to the old run, so remove it first.
+   * Readers will then see the old run without its log for a moment,
+   * i.e. miss some entries, but never mix entries of both indexes.
+   * If we get interrupted, some shards will be new and some will be old
+   * but all of them remain consistent.  No writer can interfere as our
+   * caller holds the rep index lock. */
+  for (i = 0; i < SHARD_COUNT; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_io_remove_file2(shard_path(loader->path, i, ".log",
+                                             iterpool),
+                                  TRUE, iterpool));
+      SVN_ERR(svn_fs_fs__move_into_place(
+                shard_path(loader->tmp_path, i, "", iterpool),
+                shard_path(loader->path, i, "", iterpool),
+                svn_fs_fs__path_current(loader->fs, iterpool),
+                ffd->flush_to_disk, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_io_remove_dir2(loader->tmp_path, FALSE, NULL,
+                                            NULL, scratch_pool));
+}
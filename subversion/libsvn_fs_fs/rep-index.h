@@ -0,0 +1,159 @@
+/* rep-index.h : interface to the sharded hash index for rep-sharing
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS_FS_REP_INDEX_H
+#define SVN_LIBSVN_FS_FS_REP_INDEX_H
+
+#include "svn_error.h"
+
+#include "fs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* The rep index is an alternative to the SQLite based rep-cache.db.
+ *
+ * It maps the SHA1 of a fulltext to the representation_t that stores it.
+ * Entries get distributed over 256 shards by the first byte of their SHA1.
+ * Each shard consists of an append-only log file receiving new entries and
+ * a "run" file containing older entries sorted by SHA1, preceded by a bloom
+ * filter over these entries.  Once the log grows too large relative to the
+ * run, both get merged into a new run file with an incremented generation
+ * number, and the log gets truncated.
+ *
+ * Readers don't take any locks.  Run files are only ever replaced
+ * atomically and are memory-mapped, if possible.  Writers must hold the
+ * rep index lock (see svn_fs_fs__with_rep_index_lock).
+ */
+
+/* Opaque in-memory state of the rep index, caching mapped run files
+ * and the contents of the log files. */
+typedef struct svn_fs_fs__rep_index_t svn_fs_fs__rep_index_t;
+
+/* Opaque state of a bulk import into a new rep index. */
+typedef struct svn_fs_fs__rep_index_loader_t svn_fs_fs__rep_index_loader_t;
+
+/* Set *EXISTS to TRUE iff the rep index of FS exists.
+   Use POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__rep_index_exists(svn_boolean_t *exists,
+                            svn_fs_t *fs,
+                            apr_pool_t *pool);
+
+/* Open the existing rep index of FS and return it in *INDEX.  Allocate
+   the result in RESULT_POOL and use SCRATCH_POOL for temporaries. */
+svn_error_t *
+svn_fs_fs__rep_index_open(svn_fs_fs__rep_index_t **index,
+                          svn_fs_t *fs,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool);
+
+/* Release all resources held by INDEX. */
+void
+svn_fs_fs__rep_index_close(svn_fs_fs__rep_index_t *index);
+
+/* For each SHA1 digest (const unsigned char *) in DIGESTS, look up the
+   representation in INDEX and return the results in *REPS_P in the same
+   order as DIGESTS.  Elements are representation_t * and NULL for digests
+   not found.  Batches should contain many digests from the same shard.
+
+   Allocate the result in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ */
+svn_error_t *
+svn_fs_fs__rep_index_lookup(apr_array_header_t **reps_p,
+                            svn_fs_fs__rep_index_t *index,
+                            const apr_array_header_t *digests,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool);
+
+/* Add all representations (representation_t *) in REPS that have a SHA1
+   to INDEX, unless there already is an entry for that SHA1.  The caller
+   must hold the rep index lock of FS.  Use SCRATCH_POOL for temporaries.
+ */
+svn_error_t *
+svn_fs_fs__rep_index_insert(svn_fs_fs__rep_index_t *index,
+                            svn_fs_t *fs,
+                            const apr_array_header_t *reps,
+                            apr_pool_t *scratch_pool);
+
+/* Remove all entries from INDEX that refer to revisions younger than
+   YOUNGEST.  The caller must hold the rep index lock of FS.
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__rep_index_delete_younger(svn_fs_fs__rep_index_t *index,
+                                    svn_fs_t *fs,
+                                    svn_revnum_t youngest,
+                                    apr_pool_t *scratch_pool);
+
+/* Call WALKER with WALKER_BATON for all entries in INDEX that refer to
+   revisions START to END.  Entries will be visited in no particular order.
+   If START is 0, verify that no entry refers to a revision beyond HEAD.
+   Same semantics as svn_fs_fs__walk_rep_reference otherwise. */
+svn_error_t *
+svn_fs_fs__rep_index_walk(svn_fs_fs__rep_index_t *index,
+                          svn_fs_t *fs,
+                          svn_revnum_t start,
+                          svn_revnum_t end,
+                          svn_error_t *(*walker)(representation_t *rep,
+                                                 void *walker_baton,
+                                                 svn_fs_t *fs,
+                                                 apr_pool_t *scratch_pool),
+                          void *walker_baton,
+                          svn_cancel_func_t cancel_func,
+                          void *cancel_baton,
+                          apr_pool_t *scratch_pool);
+
+/* Begin building a new rep index for FS in a temporary location and
+   return the builder in *LOADER.  Any existing rep index will remain
+   untouched until svn_fs_fs__rep_index_loader_finish gets called.
+   The caller must hold the rep index lock of FS until then.
+
+   Allocate *LOADER in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ */
+svn_error_t *
+svn_fs_fs__rep_index_loader_create(svn_fs_fs__rep_index_loader_t **loader,
+                                   svn_fs_t *fs,
+                                   apr_pool_t *result_pool,
+                                   apr_pool_t *scratch_pool);
+
+/* Add REP to the index being built by LOADER.  REP must have a SHA1 and
+   its SHA1 must not have been added before.  Use SCRATCH_POOL for
+   temporary allocations. */
+svn_error_t *
+svn_fs_fs__rep_index_loader_add(svn_fs_fs__rep_index_loader_t *loader,
+                                const representation_t *rep,
+                                apr_pool_t *scratch_pool);
+
+/* Sort the data added to LOADER, replace the current rep index, if any,
+   with it.  Each shard gets replaced atomically, i.e. concurrent readers
+   may temporarily miss entries but never see inconsistent data.  Use
+   SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__rep_index_loader_finish(svn_fs_fs__rep_index_loader_t *loader,
+                                   apr_pool_t *scratch_pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_FS_FS_REP_INDEX_H */
@@ -49,6 +49,7 @@ init_revision_file(svn_fs_fs__revision_file_t *file,
   file->p2l_stream = NULL;
   file->l2p_stream = NULL;
   file->block_size = ffd->block_size;
+  file->prefetch_end = 0;
   file->l2p_offset = -1;
   file->l2p_checksum = NULL;
   file->p2l_offset = -1;
@@ -67,6 +67,10 @@ typedef struct svn_fs_fs__revision_file_t
    * use aligned seek() without having the FS handy. */
   apr_off_t block_size;
 
+  /* Offset within FILE up to which data has already been prefetched.
+   * 0 if nothing has been prefetched, yet. */
+  apr_off_t prefetch_end;
+
   /* Offset within FILE at which the rev data ends and the L2P index
    * data starts. Less than P2L_OFFSET. -1 if svn_fs_fs__auto_read_footer
    * has not been called, yet. */
@@ -603,6 +603,12 @@ parse_packed_revprops(svn_fs_t *fs,
  * *REVPROPS. Populate the revprop cache, if POPULATE_CACHE is set.
  * If you want to modify revprop contents / update REVPROPS, READ_ALL
  * must be set.  Otherwise, only the properties of REV are being provided.
+ *
+ * If SHARD_HINT is not NULL, it is the result of a previous call for a
+ * revision in the same shard as REV and its manifest will be used instead
+ * of reading the manifest file again.  Should that fail, e.g. due to
+ * concurrent writers, we fall back to re-reading it.
+ *
  * Allocate data in POOL.
  */
 static svn_error_t *
@@ -611,6 +617,7 @@ read_pack_revprop(packed_revprops_t **revprops,
                   svn_revnum_t rev,
                   svn_boolean_t read_all,
                   svn_boolean_t populate_cache,
+                  const packed_revprops_t *shard_hint,
                   apr_pool_t *pool)
 {
   apr_pool_t *iterpool = svn_pool_create(pool);
@@ -643,7 +650,21 @@ read_pack_revprop(packed_revprops_t **revprops,
       /* there might have been concurrent writes.
        * Re-read the manifest and the pack file.
        */
-      SVN_ERR(get_revprop_packname(fs, result, pool, iterpool));
+      if (i == 0 && shard_hint && same_shard(fs, rev, shard_hint->revision))
+        {
+          result->manifest_start = shard_hint->manifest_start;
+          result->manifest = shard_hint->manifest;
+          result->folder = shard_hint->folder;
+          result->filename
+            = APR_ARRAY_IDX(result->manifest,
+                            (int)(rev - result->manifest_start),
+                            const char *);
+        }
+      else
+        {
+          SVN_ERR(get_revprop_packname(fs, result, pool, iterpool));
+        }
+
       file_path  = svn_dirent_join(result->folder,
                                    result->filename,
                                    iterpool);
@@ -672,6 +693,45 @@ read_pack_revprop(packed_revprops_t **revprops,
   return SVN_NO_ERROR;
 }
 
+/* Return TRUE, if REVPROPS has been read with READ_ALL set and contains
+ * the revprops of REV. */
+static svn_boolean_t
+pack_contains(const packed_revprops_t *revprops,
+              svn_revnum_t rev)
+{
+  return revprops
+      && rev >= revprops->start_revision
+      && rev < revprops->start_revision + revprops->sizes->nelts;
+}
+
+/* Look up the revprops of REV in FS in the revprop cache and return them
+ * in *PROPLIST_P.  Set it to NULL, if they are not cached.  Allocate the
+ * result in RESULT_POOL and use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+get_cached_revprops(apr_hash_t **proplist_p,
+                    svn_fs_t *fs,
+                    svn_revnum_t rev,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_boolean_t is_cached;
+  pair_cache_key_t key;
+
+  SVN_ERR(prepare_revprop_cache(fs, scratch_pool));
+  key.revision = rev;
+  key.second = ffd->revprop_prefix;
+
+  SVN_ERR_W(svn_cache__get((void **) proplist_p, &is_cached,
+                           ffd->revprop_cache, &key, result_pool),
+            apr_psprintf(scratch_pool,
+                         "Failed to parse revprops for r%ld.", rev));
+  if (!is_cached)
+    *proplist_p = NULL;
+
+  return SVN_NO_ERROR;
+}
+
 /* Read the revprops for revision REV in FS and return them in *PROPERTIES_P.
  *
  * Allocations will be done in POOL.
@@ -704,22 +764,11 @@ svn_fs_fs__get_revision_proplist(apr_hash_t **proplist_p,
     }
   else
     {
-      /* Try cache lookup first. */
-      svn_boolean_t is_cached;
-      pair_cache_key_t key;
-
-      /* Auto-alloc prefix and construct the key. */
-      SVN_ERR(prepare_revprop_cache(fs, scratch_pool));
-      key.revision = rev;
-      key.second = ffd->revprop_prefix;
-
-      /* The only way that this might error out is due to parser error. */
-      SVN_ERR_W(svn_cache__get((void **) proplist_p, &is_cached,
-                               ffd->revprop_cache, &key, result_pool),
-                apr_psprintf(scratch_pool,
-                             "Failed to parse revprops for r%ld.",
-                             rev));
-      if (is_cached)
+      /* Try cache lookup first.
+       * The only way that this might error out is due to parser error. */
+      SVN_ERR(get_cached_revprops(proplist_p, fs, rev, result_pool,
+                                  scratch_pool));
+      if (*proplist_p)
         return SVN_NO_ERROR;
     }
 
@@ -748,7 +797,7 @@ svn_fs_fs__get_revision_proplist(apr_hash_t **proplist_p,
     {
       packed_revprops_t *revprops;
       SVN_ERR(read_pack_revprop(&revprops, fs, rev, FALSE, populate_cache,
-                                result_pool));
+                                NULL, result_pool));
       *proplist_p = revprops->properties;
     }
 
@@ -761,6 +810,91 @@ svn_fs_fs__get_revision_proplist(apr_hash_t **proplist_p,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__get_revision_proplists(svn_fs_t *fs,
+                                  svn_revnum_t start,
+                                  svn_revnum_t end,
+                                  svn_boolean_t refresh,
+                                  svn_fs_revision_proplist_receiver_t receiver,
+                                  void *receiver_baton,
+                                  apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_pool_t *shard_pool = svn_pool_create(scratch_pool);
+  packed_revprops_t *revprops = NULL;
+  svn_revnum_t step = start <= end ? 1 : -1;
+  svn_revnum_t rev;
+
+  SVN_ERR(svn_fs_fs__ensure_revision_exists(MAX(start, end), fs,
+                                            scratch_pool));
+
+  /* One sync barrier for the whole range. */
+  if (refresh)
+    svn_fs_fs__reset_revprop_cache(fs);
+
+  for (rev = start; ; rev += step)
+    {
+      apr_hash_t *proplist = NULL;
+
+      svn_pool_clear(iterpool);
+
+      /* Packed revprops get served from the pack file we read last.
+       * Once we leave it, try the cache before reading the next one.
+       * Each pack file will be read at most once and its manifest once
+       * per shard. */
+      if (   ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT
+          && svn_fs_fs__is_packed_revprop(fs, rev))
+        {
+          if (!pack_contains(revprops, rev))
+            {
+              SVN_ERR(get_cached_revprops(&proplist, fs, rev, iterpool,
+                                          iterpool));
+              if (!proplist)
+                {
+                  if (revprops && !same_shard(fs, rev, revprops->revision))
+                    {
+                      svn_pool_clear(shard_pool);
+                      revprops = NULL;
+                    }
+
+                  SVN_ERR(read_pack_revprop(&revprops, fs, rev, TRUE, TRUE,
+                                            revprops, shard_pool));
+                }
+            }
+
+          if (!proplist)
+            {
+              int idx = (int)(rev - revprops->start_revision);
+              svn_string_t serialized;
+
+              serialized.data = revprops->packed_revprops->data
+                              + APR_ARRAY_IDX(revprops->offsets, idx,
+                                              apr_size_t);
+              serialized.len = APR_ARRAY_IDX(revprops->sizes, idx,
+                                             apr_size_t);
+              SVN_ERR(parse_revprop(&proplist, fs, rev, &serialized,
+                                    iterpool, iterpool));
+            }
+        }
+      else
+        {
+          SVN_ERR(svn_fs_fs__get_revision_proplist(&proplist, fs, rev, FALSE,
+                                                   iterpool, iterpool));
+        }
+
+      SVN_ERR(receiver(receiver_baton, rev, proplist, iterpool));
+
+      if (rev == end)
+        break;
+    }
+
+  svn_pool_destroy(shard_pool);
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Serialize the revision property list PROPLIST of revision REV in
  * filesystem FS to a non-packed file.  Return the name of that temporary
  * file in *TMP_PATH and the file path that it must be moved to in
@@ -1036,7 +1170,7 @@ write_packed_revprop(const char **final_path,
   int changed_index;
 
   /* read contents of the current pack file */
-  SVN_ERR(read_pack_revprop(&revprops, fs, rev, TRUE, FALSE, pool));
+  SVN_ERR(read_pack_revprop(&revprops, fs, rev, TRUE, FALSE, NULL, pool));
 
   /* serialize the new revprops */
   serialized = svn_stringbuf_create_empty(pool);
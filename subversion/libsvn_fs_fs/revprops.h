@@ -76,6 +76,25 @@ svn_fs_fs__get_revision_proplist(apr_hash_t **proplist_p,
                                  apr_pool_t *result_pool,
                                  apr_pool_t *scratch_pool);
 
+/* Call RECEIVER with RECEIVER_BATON for the revprops of every revision
+ * from START to END in FS, in that order.  START may be larger than END.
+ * If REFRESH is set, clear the revprop cache once before accessing the
+ * data.
+ *
+ * Each revprop pack file gets read at most once and all revprops found
+ * in it will be put into the revprop cache.
+ *
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__get_revision_proplists(svn_fs_t *fs,
+                                  svn_revnum_t start,
+                                  svn_revnum_t end,
+                                  svn_boolean_t refresh,
+                                  svn_fs_revision_proplist_receiver_t receiver,
+                                  void *receiver_baton,
+                                  apr_pool_t *scratch_pool);
+
 /* Set the revision property list of revision REV in filesystem FS to
    PROPLIST.  Use POOL for temporary allocations. */
 svn_error_t *
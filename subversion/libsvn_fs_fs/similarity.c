@@ -0,0 +1,484 @@
+/* similarity.c --- finding delta bases by content similarity
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_pools.h"
+
+#include "fs_fs.h"
+#include "id.h"
+#include "similarity.h"
+
+#include "private/svn_subr_private.h"
+#include "../libsvn_fs/fs-loader.h"
+
+#include "svn_private_config.h"
+
+/* Texts shorter than this are not worth sketching. */
+#define MIN_SKETCH_LEN 256
+
+/* Length of the substrings being hashed. */
+#define SHINGLE_LEN 8
+
+/* Number of reps kept in the index.  Older entries get overwritten. */
+#define ENTRY_COUNT 0x2000
+
+/* Number of buckets per sketch value and for the base names.
+   Must be a power of two. */
+#define BUCKET_COUNT 0x4000
+
+/* Minimum number of matching sketch values for a rep to be considered
+   similar.  Two random texts will practically never share two values. */
+#define MIN_VOTES 2
+
+/* Maximum number of reps returned by svn_fs_fs__similarity_find. */
+#define MAX_CANDIDATES 4
+
+/* Seeds of the independent hash functions. */
+static const apr_uint64_t seeds[SVN_FS_FS__SKETCH_SIZE] =
+  {
+    APR_UINT64_C(0x0000000000000000), APR_UINT64_C(0x9e3779b97f4a7c15),
+    APR_UINT64_C(0xc2b2ae3d27d4eb4f), APR_UINT64_C(0x165667b19e3779f9),
+    APR_UINT64_C(0xd6e8feb86659fd93), APR_UINT64_C(0x27d4eb2f165667c5),
+    APR_UINT64_C(0x85ebca77c2b2ae63), APR_UINT64_C(0xff51afd7ed558ccd)
+  };
+
+/* An indexed or pending rep. */
+typedef struct entry_t
+{
+  /* Sketch of the rep contents. */
+  svn_fs_fs__sketch_t sketch;
+
+  /* Hash of the base name of the path the rep has been written to. */
+  apr_uint32_t name_hash;
+
+  /* The rep itself.  For pending entries, REVISION is still invalid. */
+  representation_t rep;
+} entry_t;
+
+/* Reps of a transaction that has not been committed yet. */
+typedef struct pending_t
+{
+  /* Array of entry_t. */
+  apr_array_header_t *entries;
+
+  /* Pool that PENDING_T has been allocated in. */
+  apr_pool_t *pool;
+} pending_t;
+
+struct svn_fs_fs__similarity_index_t
+{
+  /* Ring buffer of ENTRY_COUNT reps. */
+  entry_t *entries;
+
+  /* Number of reps added so far.  The next one goes to position
+     COUNT % ENTRY_COUNT. */
+  apr_uint64_t count;
+
+  /* For each sketch value, a direct-mapped table of 1 + the index of the
+     latest entry with the respective value or 0 for empty buckets.
+     Buckets may refer to entries that have been overwritten since, so
+     matches must be verified. */
+  apr_uint32_t *buckets[SVN_FS_FS__SKETCH_SIZE];
+
+  /* Same for the base name hashes. */
+  apr_uint32_t *names;
+
+  /* Maps transaction ID strings to pending_t. */
+  apr_hash_t *pending;
+
+  /* Total number of pending entries. */
+  int pending_count;
+
+  /* Pool for the pending_t objects. */
+  apr_pool_t *pool;
+};
+
+/* Return the hash of the SHINGLE_LEN bytes at DATA. */
+static APR_INLINE apr_uint64_t
+hash_shingle(const char *data)
+{
+  apr_uint64_t value;
+  memcpy(&value, data, sizeof(value));
+
+  value ^= value >> 33;
+  value *= APR_UINT64_C(0xff51afd7ed558ccd);
+  value ^= value >> 33;
+
+  return value;
+}
+
+/* Return the sketch value of shingle HASH for hash function SEED. */
+static APR_INLINE apr_uint32_t
+sketch_value(apr_uint64_t hash,
+             apr_uint64_t seed)
+{
+  hash = (hash ^ seed) * APR_UINT64_C(0x9e3779b97f4a7c15);
+  return (apr_uint32_t)(hash >> 32);
+}
+
+/* Return the hash of PATH's base name or 0 for NULL. */
+static apr_uint32_t
+hash_name(const char *path)
+{
+  const char *name;
+  apr_uint32_t hash;
+
+  if (!path)
+    return 0;
+
+  name = svn_relpath_basename(path, NULL);
+  hash = svn__fnv1a_32(name, strlen(name));
+
+  /* 0 means "no name". */
+  return hash ? hash : 1;
+}
+
+/* Return the bucket number for VALUE. */
+static APR_INLINE apr_size_t
+bucket(apr_uint32_t value)
+{
+  return (value ^ (value >> 16)) & (BUCKET_COUNT - 1);
+}
+
+svn_boolean_t
+svn_fs_fs__similarity_sketch(svn_fs_fs__sketch_t *sketch,
+                             const char *data,
+                             apr_size_t len)
+{
+  apr_size_t i;
+  int k;
+
+  if (len < MIN_SKETCH_LEN)
+    return FALSE;
+
+  for (k = 0; k < SVN_FS_FS__SKETCH_SIZE; ++k)
+    sketch->values[k] = APR_UINT32_MAX;
+
+  for (i = 0; i + SHINGLE_LEN <= len; ++i)
+    {
+      apr_uint64_t hash = hash_shingle(data + i);
+      for (k = 0; k < SVN_FS_FS__SKETCH_SIZE; ++k)
+        {
+          apr_uint32_t value = sketch_value(hash, seeds[k]);
+          if (value < sketch->values[k])
+            sketch->values[k] = value;
+        }
+    }
+
+  return TRUE;
+}
+
+/* Return the similarity index of FS, creating it if CREATE is set.
+   The caller must hold the similarity lock. */
+static svn_fs_fs__similarity_index_t *
+get_index(svn_fs_t *fs,
+          svn_boolean_t create)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  fs_fs_shared_data_t *ffsd = ffd->shared;
+  svn_fs_fs__similarity_index_t *index = ffsd->similarity_index;
+  int k;
+
+  if (index || !create)
+    return index;
+
+  index = apr_pcalloc(ffsd->common_pool, sizeof(*index));
+  index->entries = apr_pcalloc(ffsd->common_pool,
+                               ENTRY_COUNT * sizeof(*index->entries));
+  for (k = 0; k < SVN_FS_FS__SKETCH_SIZE; ++k)
+    index->buckets[k] = apr_pcalloc(ffsd->common_pool,
+                                    BUCKET_COUNT * sizeof(apr_uint32_t));
+  index->names = apr_pcalloc(ffsd->common_pool,
+                             BUCKET_COUNT * sizeof(apr_uint32_t));
+  index->pool = svn_pool_create(ffsd->common_pool);
+  index->pending = apr_hash_make(index->pool);
+
+  ffsd->similarity_index = index;
+  return index;
+}
+
+/* Baton type for find_body. */
+typedef struct find_baton_t
+{
+  apr_array_header_t *reps;
+  const svn_fs_fs__sketch_t *sketch;
+  apr_uint32_t name_hash;
+  apr_pool_t *result_pool;
+} find_baton_t;
+
+/* Append a copy of the rep in ENTRY to B->REPS unless it is already
+   contained in it. */
+static void
+add_rep(find_baton_t *b,
+        const entry_t *entry)
+{
+  int i;
+  for (i = 0; i < b->reps->nelts; ++i)
+    {
+      representation_t *rep = APR_ARRAY_IDX(b->reps, i, representation_t *);
+      if (   rep->revision == entry->rep.revision
+          && rep->item_index == entry->rep.item_index)
+        return;
+    }
+
+  APR_ARRAY_PUSH(b->reps, representation_t *)
+    = svn_fs_fs__rep_copy((representation_t *)&entry->rep, b->result_pool);
+}
+
+/* Implements svn_fs_fs__similarity_find under the similarity lock.
+   BATON is a find_baton_t. */
+static svn_error_t *
+find_body(svn_fs_t *fs,
+          find_baton_t *b)
+{
+  svn_fs_fs__similarity_index_t *index = get_index(fs, FALSE);
+  apr_uint32_t hits[SVN_FS_FS__SKETCH_SIZE];
+  int votes[SVN_FS_FS__SKETCH_SIZE];
+  int hit_count = 0;
+  int i, k;
+
+  if (!index)
+    return SVN_NO_ERROR;
+
+  /* Let every sketch value vote for the latest entry that shares it. */
+  for (k = 0; k < SVN_FS_FS__SKETCH_SIZE; ++k)
+    {
+      apr_uint32_t value = b->sketch->values[k];
+      apr_uint32_t hit = index->buckets[k][bucket(value)];
+
+      if (!hit || index->entries[hit - 1].sketch.values[k] != value)
+        continue;
+
+      for (i = 0; i < hit_count; ++i)
+        if (hits[i] == hit)
+          break;
+
+      if (i == hit_count)
+        {
+          hits[hit_count] = hit;
+          votes[hit_count] = 0;
+          ++hit_count;
+        }
+
+      ++votes[i];
+    }
+
+  /* Return the entries with most votes first. */
+  while (b->reps->nelts < MAX_CANDIDATES)
+    {
+      int best = -1;
+      for (i = 0; i < hit_count; ++i)
+        if (votes[i] >= MIN_VOTES && (best < 0 || votes[i] > votes[best]))
+          best = i;
+
+      if (best < 0)
+        break;
+
+      add_rep(b, &index->entries[hits[best] - 1]);
+      votes[best] = 0;
+    }
+
+  /* Finally, the latest rep with the same name. */
+  if (b->name_hash && b->reps->nelts < MAX_CANDIDATES)
+    {
+      apr_uint32_t hit = index->names[bucket(b->name_hash)];
+      if (hit && index->entries[hit - 1].name_hash == b->name_hash)
+        add_rep(b, &index->entries[hit - 1]);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__similarity_find(apr_array_header_t **reps,
+                           svn_fs_t *fs,
+                           const svn_fs_fs__sketch_t *sketch,
+                           const char *path,
+                           apr_pool_t *result_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  find_baton_t baton;
+
+  baton.reps = apr_array_make(result_pool, MAX_CANDIDATES,
+                              sizeof(representation_t *));
+  baton.sketch = sketch;
+  baton.name_hash = hash_name(path);
+  baton.result_pool = result_pool;
+
+  SVN_MUTEX__WITH_LOCK(ffd->shared->similarity_lock,
+                       find_body(fs, &baton));
+
+  *reps = baton.reps;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_fs_fs__similarity_add under the similarity lock. */
+static svn_error_t *
+add_body(svn_fs_t *fs,
+         const char *txn_key,
+         const entry_t *entry)
+{
+  svn_fs_fs__similarity_index_t *index = get_index(fs, TRUE);
+  pending_t *pending;
+
+  /* Transactions that get neither committed nor aborted by this process
+     would otherwise accumulate entries without bounds. */
+  if (index->pending_count >= ENTRY_COUNT)
+    return SVN_NO_ERROR;
+
+  pending = svn_hash_gets(index->pending, txn_key);
+  if (!pending)
+    {
+      apr_pool_t *pool = svn_pool_create(index->pool);
+      pending = apr_pcalloc(pool, sizeof(*pending));
+      pending->entries = apr_array_make(pool, 16, sizeof(entry_t));
+      pending->pool = pool;
+      svn_hash_sets(index->pending, apr_pstrdup(pool, txn_key), pending);
+    }
+
+  APR_ARRAY_PUSH(pending->entries, entry_t) = *entry;
+  ++index->pending_count;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__similarity_add(svn_fs_t *fs,
+                          const svn_fs_fs__id_part_t *txn_id,
+                          const representation_t *rep,
+                          const svn_fs_fs__sketch_t *sketch,
+                          const char *path,
+                          apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  entry_t entry;
+
+  entry.sketch = *sketch;
+  entry.name_hash = hash_name(path);
+  entry.rep = *rep;
+
+  SVN_MUTEX__WITH_LOCK(ffd->shared->similarity_lock,
+                       add_body(fs, svn_fs_fs__id_txn_unparse(txn_id,
+                                                              scratch_pool),
+                                &entry));
+
+  return SVN_NO_ERROR;
+}
+
+/* Remove the pending entries for TXN_KEY from INDEX and return them.
+   Return NULL if there are none. */
+static pending_t *
+take_pending(svn_fs_fs__similarity_index_t *index,
+             const char *txn_key)
+{
+  pending_t *pending = svn_hash_gets(index->pending, txn_key);
+  if (pending)
+    {
+      svn_hash_sets(index->pending, txn_key, NULL);
+      index->pending_count -= pending->entries->nelts;
+    }
+
+  return pending;
+}
+
+/* Implements svn_fs_fs__similarity_commit under the similarity lock. */
+static svn_error_t *
+commit_body(svn_fs_t *fs,
+            const char *txn_key,
+            svn_revnum_t revision)
+{
+  svn_fs_fs__similarity_index_t *index = get_index(fs, FALSE);
+  pending_t *pending;
+  int i, k;
+
+  if (!index)
+    return SVN_NO_ERROR;
+
+  pending = take_pending(index, txn_key);
+  if (!pending)
+    return SVN_NO_ERROR;
+
+  for (i = 0; i < pending->entries->nelts; ++i)
+    {
+      apr_uint32_t slot = (apr_uint32_t)(index->count++ % ENTRY_COUNT);
+      entry_t *entry = &index->entries[slot];
+
+      *entry = APR_ARRAY_IDX(pending->entries, i, entry_t);
+      entry->rep.revision = revision;
+      svn_fs_fs__id_txn_reset(&entry->rep.txn_id);
+
+      for (k = 0; k < SVN_FS_FS__SKETCH_SIZE; ++k)
+        index->buckets[k][bucket(entry->sketch.values[k])] = slot + 1;
+      if (entry->name_hash)
+        index->names[bucket(entry->name_hash)] = slot + 1;
+    }
+
+  svn_pool_destroy(pending->pool);
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__similarity_commit(svn_fs_t *fs,
+                             const svn_fs_fs__id_part_t *txn_id,
+                             svn_revnum_t revision,
+                             apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  SVN_MUTEX__WITH_LOCK(ffd->shared->similarity_lock,
+                       commit_body(fs, svn_fs_fs__id_txn_unparse(txn_id,
+                                                                 scratch_pool),
+                                   revision));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_fs_fs__similarity_forget under the similarity lock. */
+static svn_error_t *
+forget_body(svn_fs_t *fs,
+            const char *txn_key)
+{
+  svn_fs_fs__similarity_index_t *index = get_index(fs, FALSE);
+  pending_t *pending = index ? take_pending(index, txn_key) : NULL;
+
+  if (pending)
+    svn_pool_destroy(pending->pool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__similarity_forget(svn_fs_t *fs,
+                             const svn_fs_fs__id_part_t *txn_id,
+                             apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  SVN_MUTEX__WITH_LOCK(ffd->shared->similarity_lock,
+                       forget_body(fs, svn_fs_fs__id_txn_unparse(txn_id,
+                                                                 scratch_pool)));
+
+  return SVN_NO_ERROR;
+}
@@ -0,0 +1,109 @@
+/* similarity.h : finding delta bases by content similarity
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS_FS_SIMILARITY_H
+#define SVN_LIBSVN_FS_FS_SIMILARITY_H
+
+#include "svn_error.h"
+
+#include "fs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* With similarity-based deltification enabled, every new file rep gets
+ * a "sketch" of its first delta window: the minimum hash values of all
+ * 8-byte substrings under a few independent hash functions.  Two texts
+ * share about as many sketch values as they share substrings.
+ *
+ * Once a revision has been committed, the sketches of its file reps are
+ * added to a per-repository, in-process index of limited size that also
+ * remembers the base name of each rep's path.  Later commits look up
+ * reps with similar content or the same name and try them as additional
+ * delta base candidates.  The index is not persistent, i.e. it only
+ * covers what the current process has committed recently.
+ */
+
+/* Number of hash values in a sketch. */
+#define SVN_FS_FS__SKETCH_SIZE 8
+
+/* Content sketch of a representation. */
+typedef struct svn_fs_fs__sketch_t
+{
+  apr_uint32_t values[SVN_FS_FS__SKETCH_SIZE];
+} svn_fs_fs__sketch_t;
+
+/* Opaque similarity index. */
+typedef struct svn_fs_fs__similarity_index_t svn_fs_fs__similarity_index_t;
+
+/* Set *SKETCH to the sketch of the LEN bytes at DATA and return TRUE.
+   Return FALSE if there is too little data for a meaningful sketch. */
+svn_boolean_t
+svn_fs_fs__similarity_sketch(svn_fs_fs__sketch_t *sketch,
+                             const char *data,
+                             apr_size_t len);
+
+/* Set *REPS to an array of representation_t * of committed reps in FS
+   whose contents are similar to SKETCH or whose path has the same base
+   name as PATH, best matches first.  PATH may be NULL.  Allocate the
+   result in RESULT_POOL. */
+svn_error_t *
+svn_fs_fs__similarity_find(apr_array_header_t **reps,
+                           svn_fs_t *fs,
+                           const svn_fs_fs__sketch_t *sketch,
+                           const char *path,
+                           apr_pool_t *result_pool);
+
+/* Remember REP, with content SKETCH, written to PATH in transaction
+   TXN_ID of FS.  It will become available to svn_fs_fs__similarity_find
+   once the transaction has been committed.  Use SCRATCH_POOL for
+   temporary allocations. */
+svn_error_t *
+svn_fs_fs__similarity_add(svn_fs_t *fs,
+                          const svn_fs_fs__id_part_t *txn_id,
+                          const representation_t *rep,
+                          const svn_fs_fs__sketch_t *sketch,
+                          const char *path,
+                          apr_pool_t *scratch_pool);
+
+/* Add the reps remembered for transaction TXN_ID in FS to the index.
+   TXN_ID has just been committed as REVISION.  Use SCRATCH_POOL for
+   temporary allocations. */
+svn_error_t *
+svn_fs_fs__similarity_commit(svn_fs_t *fs,
+                             const svn_fs_fs__id_part_t *txn_id,
+                             svn_revnum_t revision,
+                             apr_pool_t *scratch_pool);
+
+/* Drop all reps remembered for transaction TXN_ID in FS.  Use
+   SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__similarity_forget(svn_fs_t *fs,
+                             const svn_fs_fs__id_part_t *txn_id,
+                             apr_pool_t *scratch_pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_FS_FS_SIMILARITY_H */
@@ -41,7 +41,9 @@
 #include "temp_serializer.h"
 #include "cached_data.h"
 #include "lock.h"
+#include "noderev-log.h"
 #include "rep-cache.h"
+#include "similarity.h"
 
 #include "private/svn_fs_util.h"
 #include "private/svn_fspath.h"
@@ -49,6 +51,7 @@
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 #include "../libsvn_fs/fs-loader.h"
+#include "../libsvn_delta/delta.h"  /* for SVN_DELTA_WINDOW_SIZE */
 
 #include "svn_private_config.h"
 
@@ -507,6 +510,7 @@ svn_fs_fs__put_node_revision(svn_fs_t *fs,
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   apr_file_t *noderev_file;
+  svn_fs_fs__noderev_log_t *log;
 
   noderev->is_fresh_txn_root = fresh_txn_root;
 
@@ -515,6 +519,12 @@ svn_fs_fs__put_node_revision(svn_fs_t *fs,
                              _("Attempted to write to non-transaction '%s'"),
                              svn_fs_fs__id_unparse(id, pool)->data);
 
+  SVN_ERR(svn_fs_fs__noderev_log_get(&log, fs, svn_fs_fs__id_txn_id(id),
+                                     pool));
+  if (log)
+    return svn_error_trace(svn_fs_fs__noderev_log_write(log, fs, id, noderev,
+                                                        pool));
+
   SVN_ERR(svn_io_file_open(&noderev_file,
                            svn_fs_fs__path_txn_node_rev(fs, id, pool),
                            APR_WRITE | APR_CREATE | APR_TRUNCATE
@@ -1143,6 +1153,9 @@ svn_fs_fs__create_txn(svn_fs_txn_t **txn_p,
   else
     SVN_ERR(create_txn_dir_pre_1_5(&txn->id, &ftd->txn_id, fs, rev, pool));
 
+  /* This must happen before the first node-revision gets written. */
+  SVN_ERR(svn_fs_fs__noderev_log_create(fs, &ftd->txn_id, pool));
+
   txn->fs = fs;
   txn->base_rev = rev;
 
@@ -1460,6 +1473,8 @@ svn_fs_fs__purge_txn(svn_fs_t *fs,
 
   /* Remove the shared transaction object associated with this transaction. */
   SVN_ERR(purge_shared_txn(fs, &txn_id, pool));
+  svn_fs_fs__noderev_log_forget(fs, &txn_id, pool);
+  SVN_ERR(svn_fs_fs__similarity_forget(fs, &txn_id, pool));
   /* Remove the directory associated with this transaction. */
   SVN_ERR(svn_io_remove_dir2(svn_fs_fs__path_txn_dir(fs, &txn_id, pool),
                              FALSE, NULL, NULL, pool));
@@ -1941,6 +1956,15 @@ struct rep_write_baton
   /* calculate a modified FNV-1a checksum of the on-disk representation */
   svn_checksum_ctx_t *fnv1a_checksum_ctx;
 
+  /* With similarity-based deltification, the first delta window worth of
+     contents gets collected here before the delta base is being chosen.
+     NULL once the DELTA_STREAM has been set up. */
+  svn_stringbuf_t *prefix;
+
+  /* Sketch of PREFIX, valid if HAS_SKETCH is set. */
+  svn_fs_fs__sketch_t sketch;
+  svn_boolean_t has_sketch;
+
   /* Local / scratch pool, available for temporary allocations. */
   apr_pool_t *scratch_pool;
 
@@ -1948,6 +1972,9 @@ struct rep_write_baton
   apr_pool_t *result_pool;
 };
 
+static svn_error_t *
+start_similar_delta(struct rep_write_baton *b);
+
 /* Handler for the write method of the representation writable stream.
    BATON is a rep_write_baton, DATA is the data to write, and *LEN is
    the length of this data. */
@@ -1962,6 +1989,24 @@ rep_write_contents(void *baton,
   SVN_ERR(svn_checksum_update(b->sha1_checksum_ctx, data, *len));
   b->rep_size += *len;
 
+  /* Still collecting data to choose the delta base from? */
+  if (b->prefix)
+    {
+      apr_size_t remaining = SVN_DELTA_WINDOW_SIZE - b->prefix->len;
+      apr_size_t to_copy = MIN(*len, remaining);
+
+      svn_stringbuf_appendbytes(b->prefix, data, to_copy);
+      if (b->prefix->len < SVN_DELTA_WINDOW_SIZE)
+        return SVN_NO_ERROR;
+
+      SVN_ERR(start_similar_delta(b));
+
+      remaining = *len - to_copy;
+      return remaining
+           ? svn_stream_write(b->delta_stream, data + to_copy, &remaining)
+           : SVN_NO_ERROR;
+    }
+
   /* If we are writing a delta, use that stream. */
   if (b->delta_stream)
     return svn_stream_write(b->delta_stream, data, len);
@@ -2005,6 +2050,54 @@ shards_spanned(int *spanned,
   return SVN_NO_ERROR;
 }
 
+/* Set *REP to NULL if the representation it points to is not a suitable
+   delta base in FS, e.g. because its own delta chain is too long already.
+   Perform temporary allocations in POOL. */
+static svn_error_t *
+check_delta_base(representation_t **rep,
+                 svn_fs_t *fs,
+                 apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (*rep)
+    {
+      int chain_length = 0;
+      int shard_count = 0;
+
+      /* Very short rep bases are simply not worth it as we are unlikely
+       * to re-coup the deltification space overhead of 20+ bytes. */
+      svn_filesize_t rep_size = (*rep)->expanded_size;
+      if (rep_size < 64)
+        {
+          *rep = NULL;
+          return SVN_NO_ERROR;
+        }
+
+      /* Check whether the length of the deltification chain is acceptable.
+       * Otherwise, shared reps may form a non-skipping delta chain in
+       * extreme cases. */
+      SVN_ERR(svn_fs_fs__rep_chain_length(&chain_length, &shard_count,
+                                          *rep, fs, pool));
+
+      /* Some reasonable limit, depending on how acceptable longer linear
+       * chains are in this repo.  Also, allow for some minimal chain. */
+      if (chain_length >= 2 * (int)ffd->max_linear_deltification + 2)
+        *rep = NULL;
+      else
+        /* To make it worth opening additional shards / pack files, we
+         * require that the reps have a certain minimal size.  To deltify
+         * against a rep in different shard, the lower limit is 512 bytes
+         * and doubles with every extra shard to visit along the delta
+         * chain. */
+        if (   shard_count > 1
+            && ((svn_filesize_t)128 << shard_count) >= rep_size)
+          *rep = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Given a node-revision NODEREV in filesystem FS, return the
    representation in *REP to use as the base for a text representation
    delta if PROPS is FALSE.  If PROPS has been set, a suitable props
@@ -2088,42 +2181,7 @@ choose_delta_base(representation_t **rep,
 
   /* if we encountered a shared rep, its parent chain may be different
    * from the node-rev parent chain. */
-  if (*rep)
-    {
-      int chain_length = 0;
-      int shard_count = 0;
-
-      /* Very short rep bases are simply not worth it as we are unlikely
-       * to re-coup the deltification space overhead of 20+ bytes. */
-      svn_filesize_t rep_size = (*rep)->expanded_size;
-      if (rep_size < 64)
-        {
-          *rep = NULL;
-          return SVN_NO_ERROR;
-        }
-
-      /* Check whether the length of the deltification chain is acceptable.
-       * Otherwise, shared reps may form a non-skipping delta chain in
-       * extreme cases. */
-      SVN_ERR(svn_fs_fs__rep_chain_length(&chain_length, &shard_count,
-                                          *rep, fs, pool));
-
-      /* Some reasonable limit, depending on how acceptable longer linear
-       * chains are in this repo.  Also, allow for some minimal chain. */
-      if (chain_length >= 2 * (int)ffd->max_linear_deltification + 2)
-        *rep = NULL;
-      else
-        /* To make it worth opening additional shards / pack files, we
-         * require that the reps have a certain minimal size.  To deltify
-         * against a rep in different shard, the lower limit is 512 bytes
-         * and doubles with every extra shard to visit along the delta
-         * chain. */
-        if (   shard_count > 1
-            && ((svn_filesize_t)128 << shard_count) >= rep_size)
-          *rep = NULL;
-    }
-
-  return SVN_NO_ERROR;
+  return svn_error_trace(check_delta_base(rep, fs, pool));
 }
 
 /* Something went wrong and the pool for the rep write is being
@@ -2188,6 +2246,235 @@ txdelta_to_svndiff(svn_txdelta_window_handler_t *handler,
                           ffd->delta_compression_level, pool);
 }
 
+/* Write the rep header for a delta against BASE_REP to B's rep stream
+   and set up B's delta stream accordingly. */
+static svn_error_t *
+start_delta(struct rep_write_baton *b,
+            representation_t *base_rep)
+{
+  svn_stream_t *source;
+  svn_txdelta_window_handler_t wh;
+  void *whb;
+  svn_fs_fs__rep_header_t header = { 0 };
+
+  SVN_ERR(svn_fs_fs__get_contents(&source, b->fs, base_rep, TRUE,
+                                  b->scratch_pool));
+
+  /* Write out the rep header. */
+  if (base_rep)
+    {
+      header.base_revision = base_rep->revision;
+      header.base_item_index = base_rep->item_index;
+      header.base_length = base_rep->size;
+      header.type = svn_fs_fs__rep_delta;
+    }
+  else
+    {
+      header.type = svn_fs_fs__rep_self_delta;
+    }
+  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
+                                      b->scratch_pool));
+
+  /* Now determine the offset of the actual svndiff data. */
+  SVN_ERR(svn_io_file_get_offset(&b->delta_start, b->file,
+                                 b->scratch_pool));
+
+  /* Prepare to write the svndiff data. */
+  txdelta_to_svndiff(&wh, &whb, b->rep_stream, b->fs, b->result_pool);
+
+  b->delta_stream = svn_txdelta_target_push(wh, whb, source,
+                                            b->scratch_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_write_fn_t, adding *LEN to the apr_size_t at BATON. */
+static svn_error_t *
+count_bytes(void *baton,
+            const char *data,
+            apr_size_t *len)
+{
+  apr_size_t *total = baton;
+  *total += *len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *SIZE to the size of the svndiff data that FS would store for
+   PREFIX when using BASE_REP as delta base.  Only the first PREFIX->LEN
+   bytes of BASE_REP are needed for that.  Use POOL for allocations. */
+static svn_error_t *
+trial_delta_size(apr_size_t *size,
+                 svn_fs_t *fs,
+                 representation_t *base_rep,
+                 svn_stringbuf_t *prefix,
+                 apr_pool_t *pool)
+{
+  svn_stream_t *source;
+  svn_stream_t *counter;
+  svn_stringbuf_t *base_prefix;
+  svn_txdelta_stream_t *delta;
+  svn_txdelta_window_handler_t wh;
+  void *whb;
+  apr_size_t len = prefix->len;
+
+  base_prefix = svn_stringbuf_create_ensure(len, pool);
+  SVN_ERR(svn_fs_fs__get_contents(&source, fs, base_rep, FALSE, pool));
+  SVN_ERR(svn_stream_read_full(source, base_prefix->data, &len));
+  SVN_ERR(svn_stream_close(source));
+  base_prefix->len = len;
+  base_prefix->data[len] = '\0';
+
+  *size = 0;
+  counter = svn_stream_create(size, pool);
+  svn_stream_set_write(counter, count_bytes);
+
+  txdelta_to_svndiff(&wh, &whb, counter, fs, pool);
+  svn_txdelta2(&delta, svn_stream_from_stringbuf(base_prefix, pool),
+               svn_stream_from_stringbuf(prefix, pool), FALSE, pool);
+
+  return svn_error_trace(svn_txdelta_send_txstream(delta, wh, whb, pool));
+}
+
+/* Append REP to the array of delta base CANDIDATES, unless it is already
+   in there or not suitable as delta base in FS.  NULL represents
+   self-deltas.  Use POOL for temporary allocations. */
+static svn_error_t *
+add_delta_base_candidate(apr_array_header_t *candidates,
+                         representation_t *rep,
+                         svn_fs_t *fs,
+                         apr_pool_t *pool)
+{
+  int i;
+
+  /* Reps within the current transaction can't be referenced as bases. */
+  if (rep && !SVN_IS_VALID_REVNUM(rep->revision))
+    return SVN_NO_ERROR;
+
+  for (i = 0; i < candidates->nelts; ++i)
+    {
+      representation_t *candidate
+        = APR_ARRAY_IDX(candidates, i, representation_t *);
+
+      if (rep == candidate)
+        return SVN_NO_ERROR;
+
+      if (   rep && candidate
+          && rep->revision == candidate->revision
+          && rep->item_index == candidate->item_index)
+        return SVN_NO_ERROR;
+    }
+
+  if (rep)
+    {
+      SVN_ERR(check_delta_base(&rep, fs, pool));
+      if (!rep)
+        return SVN_NO_ERROR;
+    }
+
+  APR_ARRAY_PUSH(candidates, representation_t *) = rep;
+  return SVN_NO_ERROR;
+}
+
+/* Return the delta base to use for the file contents written to B in
+   *REP.  Besides the base from choose_delta_base, try the immediate
+   predecessor and committed reps with similar contents or the same name.
+   Pick the one that produces the smallest delta for B->PREFIX.  As a side
+   effect, set B->SKETCH.  Use POOL for allocations. */
+static svn_error_t *
+choose_similar_delta_base(representation_t **rep,
+                          struct rep_write_baton *b,
+                          apr_pool_t *pool)
+{
+  svn_fs_t *fs = b->fs;
+  node_revision_t *noderev = b->noderev;
+  apr_array_header_t *candidates
+    = apr_array_make(pool, 8, sizeof(representation_t *));
+  representation_t *best;
+  apr_size_t best_size;
+  apr_pool_t *iterpool;
+  int i;
+
+  /* The default base always comes first and wins all ties. */
+  SVN_ERR(choose_delta_base(&best, fs, noderev, FALSE, pool));
+  APR_ARRAY_PUSH(candidates, representation_t *) = best;
+
+  /* The predecessor is the copy source for copied nodes.  Skip-deltas
+     may have taken us further back in history than that. */
+  if (noderev->predecessor_id)
+    {
+      node_revision_t *pred;
+      SVN_ERR(svn_fs_fs__get_node_revision(&pred, fs,
+                                           noderev->predecessor_id,
+                                           pool, pool));
+      if (pred->data_rep)
+        SVN_ERR(add_delta_base_candidate(candidates, pred->data_rep, fs,
+                                         pool));
+    }
+
+  b->has_sketch = svn_fs_fs__similarity_sketch(&b->sketch, b->prefix->data,
+                                               b->prefix->len);
+  if (b->has_sketch)
+    {
+      apr_array_header_t *similar;
+      SVN_ERR(svn_fs_fs__similarity_find(&similar, fs, &b->sketch,
+                                         noderev->created_path, pool));
+      for (i = 0; i < similar->nelts; ++i)
+        SVN_ERR(add_delta_base_candidate(candidates,
+                                         APR_ARRAY_IDX(similar, i,
+                                                       representation_t *),
+                                         fs, pool));
+    }
+
+  /* Nothing to choose from? */
+  if (candidates->nelts == 1)
+    {
+      *rep = best;
+      return SVN_NO_ERROR;
+    }
+
+  /* Against unrelated contents, a self-delta may win. */
+  SVN_ERR(add_delta_base_candidate(candidates, NULL, fs, pool));
+
+  iterpool = svn_pool_create(pool);
+  SVN_ERR(trial_delta_size(&best_size, fs, best, b->prefix, iterpool));
+  for (i = 1; i < candidates->nelts; ++i)
+    {
+      representation_t *candidate
+        = APR_ARRAY_IDX(candidates, i, representation_t *);
+      apr_size_t size;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(trial_delta_size(&size, fs, candidate, b->prefix, iterpool));
+      if (size < best_size)
+        {
+          best = candidate;
+          best_size = size;
+        }
+    }
+  svn_pool_destroy(iterpool);
+
+  *rep = best;
+  return SVN_NO_ERROR;
+}
+
+/* Choose the delta base for the contents collected in B->PREFIX, set up
+   the delta stream and feed the prefix into it. */
+static svn_error_t *
+start_similar_delta(struct rep_write_baton *b)
+{
+  representation_t *base_rep;
+  apr_size_t len = b->prefix->len;
+
+  SVN_ERR(choose_similar_delta_base(&base_rep, b, b->scratch_pool));
+  SVN_ERR(start_delta(b, base_rep));
+
+  SVN_ERR(svn_stream_write(b->delta_stream, b->prefix->data, &len));
+  b->prefix = NULL;
+
+  return SVN_NO_ERROR;
+}
+
 /* Get a rep_write_baton and store it in *WB_P for the representation
    indicated by NODEREV in filesystem FS.  Perform allocations in
    POOL.  Only appropriate for file contents, not for props or
@@ -2198,13 +2485,9 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
                     node_revision_t *noderev,
                     apr_pool_t *pool)
 {
+  fs_fs_data_t *ffd = fs->fsap_data;
   struct rep_write_baton *b;
   apr_file_t *file;
-  representation_t *base_rep;
-  svn_stream_t *source;
-  svn_txdelta_window_handler_t wh;
-  void *whb;
-  svn_fs_fs__rep_header_t header = { 0 };
 
   b = apr_pcalloc(pool, sizeof(*b));
 
@@ -2230,39 +2513,24 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
 
   SVN_ERR(svn_io_file_get_offset(&b->rep_offset, file, b->scratch_pool));
 
-  /* Get the base for this delta. */
-  SVN_ERR(choose_delta_base(&base_rep, fs, noderev, FALSE, b->scratch_pool));
-  SVN_ERR(svn_fs_fs__get_contents(&source, fs, base_rep, TRUE,
-                                  b->scratch_pool));
+  /* Cleanup in case something goes wrong. */
+  apr_pool_cleanup_register(b->scratch_pool, b, rep_write_cleanup,
+                            apr_pool_cleanup_null);
 
-  /* Write out the rep header. */
-  if (base_rep)
+  /* Get the base for this delta.  If we want to compare the contents
+     against multiple candidates, we must see some of them first. */
+  if (ffd->similarity_deltification && ffd->max_deltification_walk > 0)
     {
-      header.base_revision = base_rep->revision;
-      header.base_item_index = base_rep->item_index;
-      header.base_length = base_rep->size;
-      header.type = svn_fs_fs__rep_delta;
+      b->prefix = svn_stringbuf_create_ensure(SVN_DELTA_WINDOW_SIZE,
+                                              b->scratch_pool);
     }
   else
     {
-      header.type = svn_fs_fs__rep_self_delta;
+      representation_t *base_rep;
+      SVN_ERR(choose_delta_base(&base_rep, fs, noderev, FALSE,
+                                b->scratch_pool));
+      SVN_ERR(start_delta(b, base_rep));
     }
-  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
-                                      b->scratch_pool));
-
-  /* Now determine the offset of the actual svndiff data. */
-  SVN_ERR(svn_io_file_get_offset(&b->delta_start, file,
-                                 b->scratch_pool));
-
-  /* Cleanup in case something goes wrong. */
-  apr_pool_cleanup_register(b->scratch_pool, b, rep_write_cleanup,
-                            apr_pool_cleanup_null);
-
-  /* Prepare to write the svndiff data. */
-  txdelta_to_svndiff(&wh, &whb, b->rep_stream, fs, pool);
-
-  b->delta_stream = svn_txdelta_target_push(wh, whb, source,
-                                            b->scratch_pool);
 
   *wb_p = b;
 
@@ -2520,6 +2788,10 @@ rep_write_contents_close(void *baton)
 
   rep = apr_pcalloc(b->result_pool, sizeof(*rep));
 
+  /* Short contents may not have triggered the delta base selection. */
+  if (b->prefix)
+    SVN_ERR(start_similar_delta(b));
+
   /* Close our delta stream so the last bits of svndiff are written
      out. */
   if (b->delta_stream)
@@ -2593,6 +2865,12 @@ rep_write_contents_close(void *baton)
   if (!old_rep)
     SVN_ERR(store_sha1_rep_mapping(b->fs, b->noderev, b->scratch_pool));
 
+  /* Make new contents available as delta base for future commits. */
+  if (!old_rep && b->has_sketch)
+    SVN_ERR(svn_fs_fs__similarity_add(b->fs, &rep->txn_id, rep, &b->sketch,
+                                      b->noderev->created_path,
+                                      b->scratch_pool));
+
   SVN_ERR(unlock_proto_rev(b->fs, &rep->txn_id, b->lockcookie,
                            b->scratch_pool));
   svn_pool_destroy(b->scratch_pool);
@@ -2769,6 +3047,19 @@ write_directory_to_stream(svn_stream_t *stream,
   return SVN_NO_ERROR;
 }
 
+/* Implement collection_writer_t writing the svn_fs_dirent_t* array given
+   as BATON in the sorted directory format. */
+static svn_error_t *
+write_sorted_directory_to_stream(svn_stream_t *stream,
+                                 void *baton,
+                                 apr_pool_t *pool)
+{
+  apr_array_header_t *dir = baton;
+  SVN_ERR(svn_fs_fs__write_sorted_dir(stream, dir, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Write out the COLLECTION as a text representation to file FILE using
    WRITER.  In the process, record position, the total size of the dump and
    MD5 as well as SHA1 in REP.   Add the representation of type ITEM_TYPE to
@@ -3191,19 +3482,22 @@ write_final_rev(const svn_fs_id_t **new_id_p,
         {
           pair_cache_key_t *key;
           svn_fs_fs__dir_data_t dir_data;
+          collection_writer_t writer
+            = ffd->format >= SVN_FS_FS__MIN_SORTED_DIR_FORMAT
+            ? write_sorted_directory_to_stream
+            : write_directory_to_stream;
 
           /* Write out the contents of this directory as a text rep. */
           noderev->data_rep->revision = rev;
           if (ffd->deltify_directories)
             SVN_ERR(write_container_delta_rep(noderev->data_rep, file,
-                                              entries,
-                                              write_directory_to_stream,
+                                              entries, writer,
                                               fs, noderev, NULL, FALSE,
                                               SVN_FS_FS__ITEM_TYPE_DIR_REP,
                                               pool));
           else
             SVN_ERR(write_container_rep(noderev->data_rep, file, entries,
-                                        write_directory_to_stream, fs, NULL,
+                                        writer, fs, NULL,
                                         FALSE, SVN_FS_FS__ITEM_TYPE_DIR_REP,
                                         pool));
 
@@ -3532,8 +3826,15 @@ verify_locks(svn_fs_t *fs,
   apr_pool_t *iterpool;
   apr_array_header_t *changed_paths_sorted;
   svn_stringbuf_t *last_recursed = NULL;
+  svn_boolean_t locks_exist;
   int i;
 
+  /* Most repositories have no locks at all.  Don't bother sorting and
+     checking all the changed paths in that case. */
+  SVN_ERR(svn_fs_fs__locks_exist(&locks_exist, fs, "/", pool));
+  if (!locks_exist)
+    return SVN_NO_ERROR;
+
   /* Make an array of the changed paths, and sort them depth-first-ily.  */
   changed_paths_sorted = svn_sort__hash(changed_paths,
                                         svn_sort_compare_items_as_paths,
@@ -3594,9 +3895,11 @@ verify_locks(svn_fs_t *fs,
 
 /* Writes final revision properties to file PATH applying permissions
    from file PERMS_REFERENCE. This involves setting svn:date and
-   removing any temporary properties associated with the commit flags. */
+   removing any temporary properties associated with the commit flags.
+   Return the final svn:date value, if any, in *DATE_P. */
 static svn_error_t *
-write_final_revprop(const char *path,
+write_final_revprop(const svn_string_t **date_p,
+                    const char *path,
                     const char *perms_reference,
                     svn_fs_txn_t *txn,
                     svn_boolean_t flush_to_disk,
@@ -3629,6 +3932,10 @@ write_final_revprop(const char *path,
       svn_hash_sets(txnprops, SVN_PROP_REVISION_DATE, &date);
     }
 
+  *date_p = svn_hash_gets(txnprops, SVN_PROP_REVISION_DATE);
+  if (*date_p)
+    *date_p = svn_string_dup(*date_p, pool);
+
   /* Create new revprops file. Tell OS to truncate existing file,
      since  file may already exists from failed transaction. */
   SVN_ERR(svn_io_file_open(&revprop_file, path,
@@ -3744,6 +4051,7 @@ commit_body(void *baton, apr_pool_t *pool)
   fs_fs_data_t *ffd = cb->fs->fsap_data;
   const char *old_rev_filename, *rev_filename, *proto_filename;
   const char *revprop_filename;
+  const svn_string_t *date;
   const svn_fs_id_t *root_id, *new_root_id;
   apr_uint64_t start_node_id;
   apr_uint64_t start_copy_id;
@@ -3753,6 +4061,7 @@ commit_body(void *baton, apr_pool_t *pool)
   apr_off_t initial_offset, changed_path_offset;
   const svn_fs_fs__id_part_t *txn_id = svn_fs_fs__txn_get_id(cb->txn);
   apr_hash_t *changed_paths;
+  svn_error_t *err;
   apr_array_header_t *directory_ids = apr_array_make(pool, 4,
                                                      sizeof(pair_cache_key_t));
 
@@ -3903,7 +4212,7 @@ commit_body(void *baton, apr_pool_t *pool)
   /* Write final revprops file. */
   SVN_ERR_ASSERT(! svn_fs_fs__is_packed_revprop(cb->fs, new_rev));
   revprop_filename = svn_fs_fs__path_revprops(cb->fs, new_rev, pool);
-  SVN_ERR(write_final_revprop(revprop_filename, old_rev_filename,
+  SVN_ERR(write_final_revprop(&date, revprop_filename, old_rev_filename,
                               cb->txn, ffd->flush_to_disk, pool));
 
   /* Run paranoia checks. */
@@ -3916,6 +4225,10 @@ commit_body(void *baton, apr_pool_t *pool)
   SVN_ERR(write_final_current(cb->fs, txn_id, new_rev, start_node_id,
                               start_copy_id, pool));
 
+  /* The reps of this revision may now serve as delta bases. */
+  if (ffd->similarity_deltification)
+    SVN_ERR(svn_fs_fs__similarity_commit(cb->fs, txn_id, new_rev, pool));
+
   /* At this point the new revision is committed and globally visible
      so let the caller know it succeeded by giving it the new revision
      number, which fulfills svn_fs_commit_txn() contract.  Any errors
@@ -3929,28 +4242,30 @@ commit_body(void *baton, apr_pool_t *pool)
    * visible. */
   SVN_ERR(promote_cached_directories(cb->fs, directory_ids, pool));
 
-  /* Remove this transaction directory. */
-  SVN_ERR(svn_fs_fs__purge_txn(cb->fs, cb->txn->id, pool));
-
-  return SVN_NO_ERROR;
-}
-
-/* Add the representations in REPS_TO_CACHE (an array of representation_t *)
- * to the rep-cache database of FS. */
-static svn_error_t *
-write_reps_to_cache(svn_fs_t *fs,
-                    const apr_array_header_t *reps_to_cache,
-                    apr_pool_t *scratch_pool)
-{
-  int i;
-
-  for (i = 0; i < reps_to_cache->nelts; i++)
+  /* Keep the path index, if there is one, up to date.  Failing to do so
+     must not fail the commit.  The index will simply not cover this and
+     any later revision until it gets rebuilt. */
+  err = svn_fs__path_index_append(cb->fs->path, new_rev, changed_paths,
+                                  pool);
+  if (err)
     {
-      representation_t *rep = APR_ARRAY_IDX(reps_to_cache, i, representation_t *);
+      (cb->fs->warning)(cb->fs->warning_baton, err);
+      svn_error_clear(err);
+    }
 
-      SVN_ERR(svn_fs_fs__set_rep_reference(fs, rep, scratch_pool));
+  /* Keep the date index, if there is one, up to date.  The revision has
+     already been published, so a failure must not fail the commit.  The
+     index will then not cover this and later revisions until rebuilt. */
+  err = svn_fs__date_index_append(cb->fs->path, new_rev, date, pool);
+  if (err)
+    {
+      (cb->fs->warning)(cb->fs->warning_baton, err);
+      svn_error_clear(err);
     }
 
+  /* Remove this transaction directory. */
+  SVN_ERR(svn_fs_fs__purge_txn(cb->fs, cb->txn->id, pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -3987,33 +4302,8 @@ svn_fs_fs__commit(svn_revnum_t *new_rev_p,
 
   if (ffd->rep_sharing_allowed)
     {
-      svn_error_t *err;
-
-      SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
-
-      /* Write new entries to the rep-sharing database.
-       *
-       * We use an sqlite transaction to speed things up;
-       * see <http://www.sqlite.org/faq.html#q19>.
-       */
-      /* ### A commit that touches thousands of files will starve other
-             (reader/writer) commits for the duration of the below call.
-             Maybe write in batches? */
-      SVN_ERR(svn_sqlite__begin_transaction(ffd->rep_cache_db));
-      err = write_reps_to_cache(fs, cb.reps_to_cache, pool);
-      err = svn_sqlite__finish_transaction(ffd->rep_cache_db, err);
-
-      if (svn_error_find_cause(err, SVN_ERR_SQLITE_ROLLBACK_FAILED))
-        {
-          /* Failed rollback means that our db connection is unusable, and
-             the only thing we can do is close it.  The connection will be
-             reopened during the next operation with rep-cache.db. */
-          return svn_error_trace(
-              svn_error_compose_create(err,
-                                       svn_fs_fs__close_rep_cache(fs)));
-        }
-      else if (err)
-        return svn_error_trace(err);
+      /* Write new entries to the rep-sharing database. */
+      SVN_ERR(svn_fs_fs__set_rep_references(fs, cb.reps_to_cache, pool));
     }
 
   return SVN_NO_ERROR;
@@ -4124,6 +4414,7 @@ svn_fs_fs__delete_node_revision(svn_fs_t *fs,
                                 apr_pool_t *pool)
 {
   node_revision_t *noderev;
+  svn_fs_fs__noderev_log_t *log;
 
   SVN_ERR(svn_fs_fs__get_node_revision(&noderev, fs, id, pool, pool));
 
@@ -4149,6 +4440,11 @@ svn_fs_fs__delete_node_revision(svn_fs_t *fs,
         }
     }
 
+  SVN_ERR(svn_fs_fs__noderev_log_get(&log, fs, svn_fs_fs__id_txn_id(id),
+                                     pool));
+  if (log)
+    return svn_error_trace(svn_fs_fs__noderev_log_delete(log, id, pool));
+
   return svn_io_remove_file2(svn_fs_fs__path_txn_node_rev(fs, id, pool),
                              FALSE, pool);
 }
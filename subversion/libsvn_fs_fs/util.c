@@ -29,6 +29,7 @@
 #include "fs_fs.h"
 #include "pack.h"
 #include "util.h"
+#include "youngest-map.h"
 
 #include "../libsvn_fs/fs-loader.h"
 
@@ -518,11 +519,17 @@ svn_fs_fs__write_current(svn_fs_t *fs,
       buf = apr_psprintf(pool, "%ld %s %s\n", rev, node_id_str, copy_id_str);
     }
 
+  /* Readers must not see the old revision in the youngest map once
+     'current' has been updated. */
+  svn_fs_fs__youngest_map_invalidate(fs);
+
   name = svn_fs_fs__path_current(fs, pool);
   SVN_ERR(svn_io_write_atomic2(name, buf, strlen(buf),
                                name /* copy_perms_path */,
                                ffd->flush_to_disk, pool));
 
+  svn_fs_fs__youngest_map_publish(fs, rev);
+
   return SVN_NO_ERROR;
 }
 
@@ -339,6 +339,7 @@ svn_fs_fs__read_current(svn_revnum_t *rev,
 /* Atomically update the 'current' file to hold the specifed REV,
    NEXT_NODE_ID, and NEXT_COPY_ID.  (The two next-ID parameters are
    ignored and may be 0 if the FS format does not use them.)
+   Also update the youngest map, if that is being used.
    Perform temporary allocations in POOL. */
 svn_error_t *
 svn_fs_fs__write_current(svn_fs_t *fs,
@@ -0,0 +1,336 @@
+/* youngest-map.c --- memory-mapped copy of the youngest revision number
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_atomic.h>
+#include <apr_mmap.h>
+
+#include "svn_dirent_uri.h"
+
+#include "fs_fs.h"
+#include "util.h"
+#include "youngest-map.h"
+#include "../libsvn_fs/fs-loader.h"
+
+#include "svn_private_config.h"
+
+/* The file starts with this magic number, stored in native byte order.
+ * Files written on a platform with a different byte order will simply
+ * not be used. */
+#define YOUNGEST_MAGIC 0x53564e59
+
+/* Value of the revision word while it is not valid. */
+#define INVALID_REVISION 0xffffffff
+
+/* Size of the file: magic number plus revision word. */
+#define MAP_SIZE (2 * sizeof(apr_uint32_t))
+
+/* Create the youngest revision file of FS at PATH with an invalid
+ * revision, unless it already exists.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+create_map_file(svn_fs_t *fs,
+                const char *path,
+                apr_pool_t *scratch_pool)
+{
+  apr_uint32_t header[2];
+  apr_file_t *file;
+  svn_error_t *err;
+
+  header[0] = YOUNGEST_MAGIC;
+  header[1] = INVALID_REVISION;
+
+  /* Somebody else may be creating the file right now.  Readers will
+   * ignore the file until it has its full size. */
+  err = svn_io_file_open(&file, path,
+                         APR_WRITE | APR_CREATE | APR_EXCL | APR_BINARY,
+                         APR_OS_DEFAULT, scratch_pool);
+  if (err && APR_STATUS_IS_EEXIST(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_io_file_write_full(file, header, sizeof(header), NULL,
+                                 scratch_pool));
+  SVN_ERR(svn_io_file_close(file, scratch_pool));
+
+#ifndef WIN32
+  SVN_ERR(svn_io_copy_perms(svn_fs_fs__path_current(fs, scratch_pool),
+                            path, scratch_pool));
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* Map the youngest revision file of FS into memory for the lifetime of
+ * FS and return a pointer to its revision word in *MAP.  Set *MAP to
+ * NULL if the file is incomplete or has been written on a platform with
+ * a different byte order, i.e. if no process will use it.  If CREATE is
+ * set, create a missing file.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+map_file(volatile apr_uint32_t **map,
+         svn_fs_t *fs,
+         svn_boolean_t create,
+         apr_pool_t *scratch_pool)
+{
+  *map = NULL;
+
+#if APR_HAS_MMAP
+  {
+    const char *path = svn_dirent_join(fs->path, PATH_YOUNGEST,
+                                       scratch_pool);
+    apr_file_t *file;
+    apr_finfo_t finfo;
+    apr_mmap_t *mmap;
+    apr_status_t status;
+    apr_uint32_t *data;
+    svn_error_t *err;
+
+    err = svn_io_file_open(&file, path, APR_READ | APR_WRITE | APR_BINARY,
+                           APR_OS_DEFAULT, scratch_pool);
+    if (err && APR_STATUS_IS_ENOENT(err->apr_err) && create)
+      {
+        svn_error_clear(err);
+        SVN_ERR(create_map_file(fs, path, scratch_pool));
+        err = svn_io_file_open(&file, path,
+                               APR_READ | APR_WRITE | APR_BINARY,
+                               APR_OS_DEFAULT, scratch_pool);
+      }
+    SVN_ERR(err);
+
+    SVN_ERR(svn_io_file_info_get(&finfo, APR_FINFO_SIZE, file,
+                                 scratch_pool));
+    if (finfo.size < (apr_off_t)MAP_SIZE)
+      return svn_error_trace(svn_io_file_close(file, scratch_pool));
+
+    /* The mapping remains valid after closing the file. */
+    status = apr_mmap_create(&mmap, file, 0, MAP_SIZE,
+                             APR_MMAP_READ | APR_MMAP_WRITE, fs->pool);
+    SVN_ERR(svn_io_file_close(file, scratch_pool));
+    if (status != APR_SUCCESS)
+      return svn_error_wrap_apr(status, _("Can't mmap '%s'"),
+                                svn_dirent_local_style(path, scratch_pool));
+
+    data = mmap->mm;
+    if (data[0] != YOUNGEST_MAGIC)
+      {
+        apr_mmap_delete(mmap);
+        return SVN_NO_ERROR;
+      }
+
+    *map = data + 1;
+  }
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* Invalidate the revision word at MAP for FS if it is out of sync with
+ * 'current', e.g. after a system crash or after restoring 'current' from
+ * a backup.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+validate_map(volatile apr_uint32_t *map,
+             svn_fs_t *fs,
+             apr_pool_t *scratch_pool)
+{
+  apr_uint32_t before, after;
+  svn_revnum_t youngest;
+  apr_uint64_t dummy;
+
+  before = apr_atomic_read32(map);
+  if (before == INVALID_REVISION)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_fs__read_current(&youngest, &dummy, &dummy, fs,
+                                  scratch_pool));
+
+  /* Commits in progress will change the word while 'current' changes.
+   * If it remained stable and still disagrees with 'current', it is
+   * a left-over that writers will not correct on their own. */
+  after = apr_atomic_read32(map);
+  if (before == after && before != (apr_uint32_t)youngest)
+    apr_atomic_cas32(map, INVALID_REVISION, before);
+
+  return SVN_NO_ERROR;
+}
+
+/* Mark the revision word in the youngest revision file of FS as invalid
+ * using a plain file write.  This is for writers that cannot map the file
+ * while other processes may have mapped it.  Do nothing if the file does
+ * not exist or no process would use it.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+invalidate_map_file(svn_fs_t *fs,
+                    apr_pool_t *scratch_pool)
+{
+  const char *path = svn_dirent_join(fs->path, PATH_YOUNGEST, scratch_pool);
+  apr_uint32_t header[2];
+  apr_size_t len;
+  apr_file_t *file;
+  svn_error_t *err;
+
+  err = svn_io_file_open(&file, path, APR_READ | APR_WRITE | APR_BINARY,
+                         APR_OS_DEFAULT, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_io_file_read_full2(file, header, sizeof(header), &len, NULL,
+                                 scratch_pool));
+
+  /* Shared mappings and the file cache are the same memory, so readers
+   * see this write just like a store through the mapping. */
+  if (   len == sizeof(header)
+      && header[0] == YOUNGEST_MAGIC
+      && header[1] != INVALID_REVISION)
+    {
+      apr_off_t offset = sizeof(header[0]);
+
+      header[1] = INVALID_REVISION;
+      SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+      SVN_ERR(svn_io_file_write_full(file, &header[1], sizeof(header[1]),
+                                     NULL, scratch_pool));
+    }
+
+  return svn_error_trace(svn_io_file_close(file, scratch_pool));
+}
+
+void
+svn_fs_fs__youngest_map_open(svn_fs_t *fs,
+                             svn_boolean_t create,
+                             apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  volatile apr_uint32_t *map;
+  svn_error_t *err;
+
+  if (ffd->youngest_map
+      || ffd->format < SVN_FS_FS__MIN_YOUNGEST_MAP_FORMAT)
+    return;
+
+  err = map_file(&map, fs, create, scratch_pool);
+  if (!err && map)
+    err = validate_map(map, fs, scratch_pool);
+
+  if (err)
+    svn_error_clear(err);
+  else
+    ffd->youngest_map = map;
+}
+
+svn_boolean_t
+svn_fs_fs__youngest_map_get(svn_revnum_t *youngest_p,
+                            svn_fs_t *fs)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_uint32_t value;
+
+  if (!ffd->youngest_map)
+    return FALSE;
+
+  value = apr_atomic_read32(ffd->youngest_map);
+  if (value == INVALID_REVISION)
+    return FALSE;
+
+  *youngest_p = (svn_revnum_t)value;
+  return TRUE;
+}
+
+svn_error_t *
+svn_fs_fs__youngest_map_sync(svn_fs_t *fs,
+                             apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_revnum_t youngest;
+  apr_uint64_t dummy;
+
+  if (ffd->format < SVN_FS_FS__MIN_YOUNGEST_MAP_FORMAT)
+    return SVN_NO_ERROR;
+
+  /* Other processes may have created the file since we last looked.
+   * We must update it as soon as anybody relies on it. */
+  if (!ffd->youngest_map)
+    {
+      volatile apr_uint32_t *map;
+      svn_error_t *err = map_file(&map, fs, ffd->mmap_youngest,
+                                  scratch_pool);
+      if (!err && map)
+        err = validate_map(map, fs, scratch_pool);
+
+      /* Unlike readers, we must not ignore the file just because we
+       * can't map it: processes that did map it would keep reporting
+       * the old HEAD forever.  Invalidate it for good, then.  Only if
+       * even that fails, the commit must not proceed. */
+      if (err)
+        {
+          svn_error_t *err2 = invalidate_map_file(fs, scratch_pool);
+          if (err2)
+            return svn_error_compose_create(err2, err);
+
+          svn_error_clear(err);
+          return SVN_NO_ERROR;
+        }
+
+      ffd->youngest_map = map;
+    }
+
+  if (   !ffd->youngest_map
+      || apr_atomic_read32(ffd->youngest_map) != INVALID_REVISION)
+    return SVN_NO_ERROR;
+
+  /* Nobody can modify 'current' while we hold the write lock. */
+  SVN_ERR(svn_fs_fs__read_current(&youngest, &dummy, &dummy, fs,
+                                  scratch_pool));
+  svn_fs_fs__youngest_map_publish(fs, youngest);
+
+  return SVN_NO_ERROR;
+}
+
+void
+svn_fs_fs__youngest_map_invalidate(svn_fs_t *fs)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (ffd->youngest_map)
+    apr_atomic_set32(ffd->youngest_map, INVALID_REVISION);
+}
+
+void
+svn_fs_fs__youngest_map_publish(svn_fs_t *fs,
+                                svn_revnum_t revision)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (!ffd->youngest_map)
+    return;
+
+  /* Revisions that don't fit into the word are never published. */
+  if (revision >= 0 && (apr_uint64_t)revision < INVALID_REVISION)
+    apr_atomic_set32(ffd->youngest_map, (apr_uint32_t)revision);
+  else
+    apr_atomic_set32(ffd->youngest_map, INVALID_REVISION);
+}
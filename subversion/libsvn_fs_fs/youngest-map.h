@@ -0,0 +1,96 @@
+/* youngest-map.h : memory-mapped copy of the youngest revision number
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS_FS_YOUNGEST_MAP_H
+#define SVN_LIBSVN_FS_FS_YOUNGEST_MAP_H
+
+#include "svn_error.h"
+
+#include "fs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* The youngest map is a small file next to 'current' that gets mapped
+ * into the memory of every process using the repository.  It contains
+ * a magic number followed by a single 32 bit word holding the youngest
+ * revision, allowing readers to determine HEAD with a single atomic load
+ * instead of opening and parsing 'current'.
+ *
+ * 'current' remains authoritative.  Writers set the word to an "invalid"
+ * value before updating 'current' and publish the new revision only after
+ * 'current' has been replaced.  Thus, readers either see the correct
+ * value or fall back to reading 'current'.  A crash may leave the word
+ * invalid, in which case the next writer acquiring the write lock will
+ * publish the revision from 'current' again.  Stale values left behind
+ * by a system crash get detected when mapping the file.
+ *
+ * Since shared mappings are only coherent within a single host, this
+ * must not be enabled for repositories accessed from multiple machines,
+ * e.g. via NFS.  The file may only be removed while no process has the
+ * repository open.
+ */
+
+/* Map the youngest revision file of FS, if it exists.  If it does not
+   exist and CREATE is set, try to create it first.  Failure to map the
+   file is not an error; FS will simply continue to read 'current'.
+   Use SCRATCH_POOL for temporary allocations. */
+void
+svn_fs_fs__youngest_map_open(svn_fs_t *fs,
+                             svn_boolean_t create,
+                             apr_pool_t *scratch_pool);
+
+/* If the youngest revision file of FS has been mapped and contains a
+   valid revision, set *YOUNGEST_P to it and return TRUE.  Otherwise,
+   return FALSE. */
+svn_boolean_t
+svn_fs_fs__youngest_map_get(svn_revnum_t *youngest_p,
+                            svn_fs_t *fs);
+
+/* Make sure the mapped youngest revision of FS, if any, is valid.
+   This will map the file if necessary and create it if so configured.
+   If the existing file cannot be mapped, mark its revision as invalid
+   through a plain write instead, such that other processes fall back to
+   'current'.  Return an error if neither is possible.  The caller must
+   hold the write lock of FS.  Use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *
+svn_fs_fs__youngest_map_sync(svn_fs_t *fs,
+                             apr_pool_t *scratch_pool);
+
+/* Mark the mapped youngest revision of FS, if any, as invalid.
+   To be called before updating 'current' under the write lock. */
+void
+svn_fs_fs__youngest_map_invalidate(svn_fs_t *fs);
+
+/* Store REVISION as the mapped youngest revision of FS, if mapped.
+   To be called after updating 'current' under the write lock. */
+void
+svn_fs_fs__youngest_map_publish(svn_fs_t *fs,
+                                svn_revnum_t revision);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_FS_FS_YOUNGEST_MAP_H */
@@ -0,0 +1,399 @@
+/* date-index.c : index of the svn:date values of all revisions
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_pools.h>
+
+#include "svn_private_config.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_string.h"
+#include "svn_time.h"
+#include "svn_types.h"
+
+#include "private/svn_fs_private.h"
+#include "private/svn_fs_util.h"
+
+/* The date index is a single file containing one RECORD_SIZE record per
+ * revision, starting at revision 0.  Each record is the svn:date of the
+ * respective revision as 64 bit little-endian apr_time_t value, or
+ * SVN_FS__NO_DATE if the revision has no (valid) svn:date.
+ *
+ * Records are only appended for the revision directly following the last
+ * one covered.  Torn records at the end of the file are ignored by readers
+ * and get overwritten by the next append.  Changes to svn:date overwrite
+ * the respective record in place.
+ */
+#define DATE_INDEX_FILE           "date-index"
+#define DATE_INDEX_TMP_FILE       "date-index.tmp"
+
+/* Both, FSFS and FSX, keep their youngest revision in this file.  New index
+ * files get the same permissions. */
+#define FS_CURRENT                "current"
+
+/* Size of an on-disk record. */
+#define RECORD_SIZE               8
+
+/* Number of record bytes the builder will buffer before writing them. */
+#define BUILDER_BUFFER_SIZE       (0x100000)
+
+struct svn_fs__date_index_t
+{
+  /* The index file, opened for unbuffered reading. */
+  apr_file_t *file;
+
+  /* Number of complete records in FILE when it was opened. */
+  svn_revnum_t count;
+};
+
+struct svn_fs__date_index_builder_t
+{
+  /* Path of the final index file. */
+  const char *path;
+
+  /* Path of the file to copy the permissions from. */
+  const char *perms_path;
+
+  /* Path of the file in which the new index gets built. */
+  const char *tmp_path;
+
+  /* Open file handle of TMP_PATH. */
+  apr_file_t *file;
+
+  /* Records not written to TMP_PATH yet. */
+  svn_stringbuf_t *buffer;
+
+  /* Youngest revision added so far.  SVN_INVALID_REVNUM initially. */
+  svn_revnum_t youngest;
+};
+
+/* Append the record for svn:date value DATE, which may be NULL, to
+ * BUFFER.  Use SCRATCH_POOL for temporary allocations. */
+static void
+add_record(svn_stringbuf_t *buffer,
+           const svn_string_t *date,
+           apr_pool_t *scratch_pool)
+{
+  apr_time_t tm = SVN_FS__NO_DATE;
+  apr_uint64_t value;
+  unsigned char record[RECORD_SIZE];
+  int i;
+
+  if (date)
+    {
+      svn_error_t *err = svn_time_from_cstring(&tm, date->data,
+                                               scratch_pool);
+      if (err)
+        {
+          svn_error_clear(err);
+          tm = SVN_FS__NO_DATE;
+        }
+    }
+
+  value = (apr_uint64_t)tm;
+  for (i = 0; i < RECORD_SIZE; ++i)
+    record[i] = (unsigned char)(value >> (8 * i));
+
+  svn_stringbuf_appendbytes(buffer, (const char *)record, RECORD_SIZE);
+}
+
+/* Return the apr_time_t stored in the record at DATA. */
+static apr_time_t
+decode_record(const unsigned char *data)
+{
+  apr_uint64_t value = 0;
+  int i;
+
+  for (i = RECORD_SIZE - 1; i >= 0; --i)
+    value = (value << 8) | data[i];
+
+  return (apr_time_t)value;
+}
+
+/* Open the index file at PATH for writing and return it in *FILE.
+ * Set *COUNT to the number of complete records in it.  Set *FILE to NULL,
+ * if there is no such file.  Allocate *FILE in POOL. */
+static svn_error_t *
+open_for_writing(apr_file_t **file,
+                 svn_revnum_t *count,
+                 const char *path,
+                 apr_pool_t *pool)
+{
+  svn_filesize_t size;
+  svn_error_t *err = svn_io_file_open(file, path, APR_WRITE, APR_OS_DEFAULT,
+                                      pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      *file = NULL;
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_io_file_size_get(&size, *file, pool));
+  *count = (svn_revnum_t)(size / RECORD_SIZE);
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the record for DATE for REVISION to FILE.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+write_record(apr_file_t *file,
+             svn_revnum_t revision,
+             const svn_string_t *date,
+             apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *buffer = svn_stringbuf_create_ensure(RECORD_SIZE,
+                                                        scratch_pool);
+  apr_off_t offset = (apr_off_t)revision * RECORD_SIZE;
+
+  add_record(buffer, date, scratch_pool);
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+  SVN_ERR(svn_io_file_write_full(file, buffer->data, buffer->len, NULL,
+                                 scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs__date_index_append(const char *fs_path,
+                          svn_revnum_t revision,
+                          const svn_string_t *date,
+                          apr_pool_t *scratch_pool)
+{
+  const char *path = svn_dirent_join(fs_path, DATE_INDEX_FILE, scratch_pool);
+  apr_file_t *file;
+  svn_revnum_t count;
+
+  /* Revision 0 starts a new index. */
+  if (revision == 0)
+    {
+      SVN_ERR(svn_io_file_open(&file, path,
+                               APR_WRITE | APR_CREATE | APR_TRUNCATE,
+                               APR_OS_DEFAULT, scratch_pool));
+      count = 0;
+    }
+  else
+    {
+      SVN_ERR(open_for_writing(&file, &count, path, scratch_pool));
+      if (file == NULL)
+        return SVN_NO_ERROR;
+    }
+
+  /* Only extend an index that covers all previous revisions.  This also
+   * drops any torn record left behind by an interrupted write. */
+  if (count == revision)
+    {
+      SVN_ERR(svn_io_file_trunc(file, (apr_off_t)count * RECORD_SIZE,
+                                scratch_pool));
+      SVN_ERR(write_record(file, revision, date, scratch_pool));
+    }
+
+  return svn_error_trace(svn_io_file_close(file, scratch_pool));
+}
+
+svn_error_t *
+svn_fs__date_index_set(const char *fs_path,
+                       svn_revnum_t revision,
+                       const svn_string_t *date,
+                       apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  svn_revnum_t count;
+
+  SVN_ERR(open_for_writing(&file, &count,
+                           svn_dirent_join(fs_path, DATE_INDEX_FILE,
+                                           scratch_pool),
+                           scratch_pool));
+  if (file == NULL)
+    return SVN_NO_ERROR;
+
+  if (revision < count)
+    SVN_ERR(write_record(file, revision, date, scratch_pool));
+
+  return svn_error_trace(svn_io_file_close(file, scratch_pool));
+}
+
+svn_error_t *
+svn_fs__date_index_open(svn_fs__date_index_t **index,
+                        const char *fs_path,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool)
+{
+  svn_fs__date_index_t *result = apr_pcalloc(result_pool, sizeof(*result));
+  svn_filesize_t size;
+  svn_error_t *err;
+
+  /* Lookups read single records at random positions.  Buffering would
+   * only make us read more data than needed. */
+  err = svn_io_file_open(&result->file,
+                         svn_dirent_join(fs_path, DATE_INDEX_FILE,
+                                         scratch_pool),
+                         APR_READ, APR_OS_DEFAULT, result_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      *index = NULL;
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_io_file_size_get(&size, result->file, scratch_pool));
+  result->count = (svn_revnum_t)(size / RECORD_SIZE);
+
+  *index = result;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs__date_index_get(apr_time_t *date,
+                       svn_fs__date_index_t *index,
+                       svn_revnum_t revision,
+                       apr_pool_t *scratch_pool)
+{
+  unsigned char record[RECORD_SIZE];
+  apr_off_t offset = (apr_off_t)revision * RECORD_SIZE;
+
+  if (revision < 0 || revision >= index->count)
+    {
+      *date = SVN_FS__NO_DATE;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(svn_io_file_seek(index->file, APR_SET, &offset, scratch_pool));
+  SVN_ERR(svn_io_file_read_full2(index->file, record, sizeof(record), NULL,
+                                 NULL, scratch_pool));
+  *date = decode_record(record);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs__date_index_copy(const char *src_fs_path,
+                        const char *dst_fs_path,
+                        svn_revnum_t youngest,
+                        apr_pool_t *scratch_pool)
+{
+  const char *dst_path = svn_dirent_join(dst_fs_path, DATE_INDEX_FILE,
+                                         scratch_pool);
+  svn_stringbuf_t *content;
+  apr_size_t len;
+  svn_error_t *err;
+
+  err = svn_stringbuf_from_file2(&content,
+                                 svn_dirent_join(src_fs_path,
+                                                 DATE_INDEX_FILE,
+                                                 scratch_pool),
+                                 scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return svn_error_trace(svn_io_remove_file2(dst_path, TRUE,
+                                                 scratch_pool));
+    }
+  SVN_ERR(err);
+
+  /* Records for revisions beyond YOUNGEST would prevent the destination
+   * from appending its own commits. */
+  len = content->len - content->len % RECORD_SIZE;
+  if ((apr_uint64_t)len > (apr_uint64_t)(youngest + 1) * RECORD_SIZE)
+    len = (apr_size_t)(youngest + 1) * RECORD_SIZE;
+
+  return svn_error_trace(svn_io_write_atomic2(dst_path, content->data, len,
+                                              svn_dirent_join(dst_fs_path,
+                                                              FS_CURRENT,
+                                                              scratch_pool),
+                                              FALSE, scratch_pool));
+}
+
+svn_error_t *
+svn_fs__date_index_builder_create(svn_fs__date_index_builder_t **builder,
+                                  const char *fs_path,
+                                  apr_pool_t *result_pool,
+                                  apr_pool_t *scratch_pool)
+{
+  svn_fs__date_index_builder_t *result = apr_pcalloc(result_pool,
+                                                     sizeof(*result));
+  result->path = svn_dirent_join(fs_path, DATE_INDEX_FILE, result_pool);
+  result->tmp_path = svn_dirent_join(fs_path, DATE_INDEX_TMP_FILE,
+                                     result_pool);
+  result->perms_path = svn_dirent_join(fs_path, FS_CURRENT, result_pool);
+  result->buffer = svn_stringbuf_create_ensure(BUILDER_BUFFER_SIZE,
+                                               result_pool);
+  result->youngest = SVN_INVALID_REVNUM;
+
+  /* Start from scratch, removing any leftovers of earlier attempts. */
+  SVN_ERR(svn_io_file_open(&result->file, result->tmp_path,
+                           APR_WRITE | APR_CREATE | APR_TRUNCATE
+                           | APR_BUFFERED, APR_OS_DEFAULT, result_pool));
+
+  *builder = result;
+  return SVN_NO_ERROR;
+}
+
+/* Append the records buffered in BUILDER to its temporary file.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+flush_builder(svn_fs__date_index_builder_t *builder,
+              apr_pool_t *scratch_pool)
+{
+  SVN_ERR(svn_io_file_write_full(builder->file, builder->buffer->data,
+                                 builder->buffer->len, NULL, scratch_pool));
+  svn_stringbuf_setempty(builder->buffer);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs__date_index_builder_add(svn_fs__date_index_builder_t *builder,
+                               svn_revnum_t revision,
+                               const svn_string_t *date,
+                               apr_pool_t *scratch_pool)
+{
+  SVN_ERR_ASSERT(revision == builder->youngest + 1);
+
+  add_record(builder->buffer, date, scratch_pool);
+  builder->youngest = revision;
+
+  if (builder->buffer->len >= BUILDER_BUFFER_SIZE)
+    SVN_ERR(flush_builder(builder, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs__date_index_builder_finish(svn_fs__date_index_builder_t *builder,
+                                  apr_pool_t *scratch_pool)
+{
+  SVN_ERR_ASSERT(SVN_IS_VALID_REVNUM(builder->youngest));
+
+  SVN_ERR(flush_builder(builder, scratch_pool));
+  SVN_ERR(svn_io_file_close(builder->file, scratch_pool));
+  SVN_ERR(svn_io_copy_perms(builder->perms_path, builder->tmp_path,
+                            scratch_pool));
+
+  /* Replace the old index, if any. */
+  return svn_error_trace(svn_io_file_rename2(builder->tmp_path,
+                                             builder->path, FALSE,
+                                             scratch_pool));
+}
@@ -0,0 +1,941 @@
+/* path-index.c : index of the revisions that changed a given path
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <apr_pools.h>
+#include <apr_strings.h>
+
+#include "svn_private_config.h"
+#include "svn_hash.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
+#include "svn_string.h"
+#include "svn_types.h"
+
+#include "private/svn_fs_util.h"
+#include "private/svn_subr_private.h"
+
+/* The path index lives in its own sub-directory of the FS.  The "active"
+ * file in there contains the number of the sub-directory that holds the
+ * actual index:  PATH_INDEX_BUCKETS bucket files plus a "current" file
+ * that contains the youngest revision covered by the index.  Rebuilding
+ * the index creates a new numbered directory, replaces "active" atomically
+ * and then removes the old directory.  Readers that find "active" changed
+ * after they read the index start over.
+ *
+ * Every change to some PATH in revision REV adds an "exact" key for PATH
+ * plus a "subtree" key for PATH and each of its parents.  Keys get hashed
+ * to 64 bits and are stored together with REV as a 16 byte record in the
+ * bucket file selected by the upper bits of the hash.  Records are only
+ * ever appended, i.e. each bucket file is sorted by revision.
+ *
+ * The revisions that may have affected PATH are those with a subtree key
+ * for PATH plus those with an exact key for any of PATH's parents, e.g.
+ * because a parent got deleted or replaced.  Hash collisions may only
+ * add revisions to that list; they never hide a relevant revision.
+ *
+ * Records are written before "current" gets bumped.  Records for
+ * revisions younger than "current" are therefore ignored by readers and
+ * will be re-added later.  Torn records at the end of a bucket file are
+ * ignored as well and get overwritten by the next append.
+ */
+#define PATH_INDEX_DIR            "path-index"
+#define PATH_INDEX_ACTIVE         "active"
+#define PATH_INDEX_CURRENT        "current"
+
+/* Both, FSFS and FSX, keep their youngest revision in this file.  New index
+ * files get the same permissions. */
+#define FS_CURRENT                "current"
+
+/* Number of bucket files.  Must be a power of two. */
+#define PATH_INDEX_BUCKETS        64
+
+/* Size of an on-disk record:  64 bit key hash and 64 bit revision. */
+#define RECORD_SIZE               16
+
+/* Number of bytes to read from a bucket file at once. */
+#define READ_BLOCK_SIZE           (RECORD_SIZE * 0x1000)
+
+/* Number of record bytes the builder will buffer before writing them. */
+#define BUILDER_BUFFER_SIZE       (0x1000000)
+
+/* Key kind prefixes. */
+#define KEY_EXACT                 'E'
+#define KEY_SUBTREE               'S'
+
+struct svn_fs__path_index_builder_t
+{
+  /* The FS that the index is for. */
+  const char *fs_path;
+
+  /* Directory in which the new index gets built. */
+  const char *dir;
+
+  /* Number of DIR. */
+  apr_uint64_t generation;
+
+  /* Records not written to the bucket files yet. */
+  svn_stringbuf_t *buffers[PATH_INDEX_BUCKETS];
+
+  /* Total size of all BUFFERS. */
+  apr_size_t buffered;
+
+  /* Youngest revision added so far.  SVN_INVALID_REVNUM initially. */
+  svn_revnum_t youngest;
+
+  /* Pool to allocate the BUFFERS in. */
+  apr_pool_t *pool;
+};
+
+/* Return the 64 bit FNV-1a hash of the key of KIND for PATH of LEN chars.
+ */
+static apr_uint64_t
+hash_key(char kind,
+         const char *path,
+         apr_size_t len)
+{
+  const apr_uint64_t prime = APR_UINT64_C(0x100000001b3);
+  apr_uint64_t hash = APR_UINT64_C(0xcbf29ce484222325);
+  apr_size_t i;
+
+  hash = (hash ^ (unsigned char)kind) * prime;
+  for (i = 0; i < len; ++i)
+    hash = (hash ^ (unsigned char)path[i]) * prime;
+
+  return hash;
+}
+
+/* Return the number of the bucket file for a key with HASH. */
+static int
+bucket_of(apr_uint64_t hash)
+{
+  return (int)(hash >> 58) & (PATH_INDEX_BUCKETS - 1);
+}
+
+/* Return the path of BUCKET in index directory DIR. */
+static const char *
+bucket_path(const char *dir,
+            int bucket,
+            apr_pool_t *result_pool)
+{
+  return svn_dirent_join(dir, apr_psprintf(result_pool, "%02x", bucket),
+                         result_pool);
+}
+
+/* qsort-compatible comparison function for apr_uint64_t. */
+static int
+compare_hashes(const void *lhs,
+               const void *rhs)
+{
+  apr_uint64_t lhs_value = *(const apr_uint64_t *)lhs;
+  apr_uint64_t rhs_value = *(const apr_uint64_t *)rhs;
+
+  return lhs_value < rhs_value ? -1 : (lhs_value > rhs_value ? 1 : 0);
+}
+
+/* qsort-compatible comparison function sorting svn_revnum_t in
+ * descending order. */
+static int
+compare_revisions_descending(const void *lhs,
+                             const void *rhs)
+{
+  svn_revnum_t lhs_value = *(const svn_revnum_t *)lhs;
+  svn_revnum_t rhs_value = *(const svn_revnum_t *)rhs;
+
+  return lhs_value > rhs_value ? -1 : (lhs_value < rhs_value ? 1 : 0);
+}
+
+/* Sort the apr_uint64_t elements of HASHES and remove duplicates. */
+static void
+sort_unique_hashes(apr_array_header_t *hashes)
+{
+  int i, count;
+
+  if (hashes->nelts < 2)
+    return;
+
+  qsort(hashes->elts, hashes->nelts, hashes->elt_size, compare_hashes);
+  for (i = 1, count = 1; i < hashes->nelts; ++i)
+    if (APR_ARRAY_IDX(hashes, i, apr_uint64_t)
+        != APR_ARRAY_IDX(hashes, count - 1, apr_uint64_t))
+      APR_ARRAY_IDX(hashes, count++, apr_uint64_t)
+        = APR_ARRAY_IDX(hashes, i, apr_uint64_t);
+
+  hashes->nelts = count;
+}
+
+/* Return PATH in canonical form, allocated in RESULT_POOL if needed. */
+static const char *
+canonical_path(const char *path,
+               apr_pool_t *result_pool)
+{
+  return svn_fs__is_canonical_abspath(path)
+       ? path
+       : svn_fs__canonicalize_abspath(path, result_pool);
+}
+
+/* Return the length of the parent path of PATH of LEN chars. */
+static apr_size_t
+parent_len(const char *path,
+           apr_size_t len)
+{
+  while (len > 1 && path[len - 1] != '/')
+    --len;
+
+  return len > 1 ? len - 1 : 1;
+}
+
+/* Append to HASHES (apr_uint64_t) the hashes of all keys for a change
+ * of PATH.  Use SCRATCH_POOL for temporary allocations. */
+static void
+add_change_keys(apr_array_header_t *hashes,
+                const char *path,
+                apr_pool_t *scratch_pool)
+{
+  apr_size_t len;
+
+  path = canonical_path(path, scratch_pool);
+  len = strlen(path);
+
+  APR_ARRAY_PUSH(hashes, apr_uint64_t) = hash_key(KEY_EXACT, path, len);
+  while (TRUE)
+    {
+      APR_ARRAY_PUSH(hashes, apr_uint64_t)
+        = hash_key(KEY_SUBTREE, path, len);
+      if (len == 1)
+        break;
+
+      len = parent_len(path, len);
+    }
+}
+
+/* Return the sorted, unique hashes (apr_uint64_t) of all keys for the
+ * changed paths in CHANGED_PATHS.  Allocate the result in RESULT_POOL. */
+static apr_array_header_t *
+get_change_keys(apr_hash_t *changed_paths,
+                apr_pool_t *result_pool)
+{
+  apr_array_header_t *hashes
+    = apr_array_make(result_pool, 4 * apr_hash_count(changed_paths),
+                     sizeof(apr_uint64_t));
+  apr_hash_index_t *hi;
+
+  for (hi = apr_hash_first(result_pool, changed_paths);
+       hi;
+       hi = apr_hash_next(hi))
+    add_change_keys(hashes, apr_hash_this_key(hi), result_pool);
+
+  sort_unique_hashes(hashes);
+  return hashes;
+}
+
+/* Append the records for REVISION and all key HASHES (apr_uint64_t)
+ * to the respective BUFFERS.  Allocate new buffers in RESULT_POOL.
+ * Return the number of bytes added. */
+static apr_size_t
+add_records(svn_stringbuf_t **buffers,
+            svn_revnum_t revision,
+            const apr_array_header_t *hashes,
+            apr_pool_t *result_pool)
+{
+  int i, k;
+
+  for (i = 0; i < hashes->nelts; ++i)
+    {
+      apr_uint64_t hash = APR_ARRAY_IDX(hashes, i, apr_uint64_t);
+      apr_uint64_t value = (apr_uint64_t)revision;
+      unsigned char record[RECORD_SIZE];
+      int bucket = bucket_of(hash);
+
+      for (k = 0; k < 8; ++k)
+        {
+          record[k] = (unsigned char)(hash >> (8 * k));
+          record[k + 8] = (unsigned char)(value >> (8 * k));
+        }
+
+      if (buffers[bucket] == NULL)
+        buffers[bucket] = svn_stringbuf_create_ensure(RECORD_SIZE,
+                                                      result_pool);
+
+      svn_stringbuf_appendbytes(buffers[bucket], (const char *)record,
+                                RECORD_SIZE);
+    }
+
+  return hashes->nelts * RECORD_SIZE;
+}
+
+/* Return the 64 bit little-endian number at DATA. */
+static apr_uint64_t
+decode_uint64(const unsigned char *data)
+{
+  apr_uint64_t value = 0;
+  int i;
+
+  for (i = 7; i >= 0; --i)
+    value = (value << 8) | data[i];
+
+  return value;
+}
+
+/* Return the file that new index files in FS_PATH shall copy their
+ * permissions from.  Allocate the result in RESULT_POOL. */
+static const char *
+perms_reference(const char *fs_path,
+                apr_pool_t *result_pool)
+{
+  return svn_dirent_join(fs_path, FS_CURRENT, result_pool);
+}
+
+/* Set *DIR to the directory containing the active path index in FS_PATH
+ * and *GENERATION to its number.  If there is no such index, set *DIR to
+ * NULL and *GENERATION to 0.  Allocate *DIR in RESULT_POOL and use
+ * SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+read_active(const char **dir,
+            apr_uint64_t *generation,
+            const char *fs_path,
+            apr_pool_t *result_pool,
+            apr_pool_t *scratch_pool)
+{
+  const char *index_dir = svn_dirent_join(fs_path, PATH_INDEX_DIR,
+                                          scratch_pool);
+  svn_stringbuf_t *content;
+  svn_error_t *err;
+
+  err = svn_stringbuf_from_file2(&content,
+                                 svn_dirent_join(index_dir,
+                                                 PATH_INDEX_ACTIVE,
+                                                 scratch_pool),
+                                 scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      *dir = NULL;
+      *generation = 0;
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  svn_stringbuf_strip_whitespace(content);
+  err = svn_cstring_strtoui64(generation, content->data, 1, APR_UINT64_MAX,
+                              10);
+  if (err)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, err,
+                             _("Corrupt path index '%s'"),
+                             svn_dirent_local_style(index_dir,
+                                                    scratch_pool));
+
+  *dir = svn_dirent_join(index_dir, content->data, result_pool);
+  return SVN_NO_ERROR;
+}
+
+/* Create a new, empty index directory in FS_PATH that is going to replace
+ * the index number ACTIVE.  Return its path in *DIR and its number in
+ * *GENERATION.  Allocate *DIR in RESULT_POOL and use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_error_t *
+create_index_dir(const char **dir,
+                 apr_uint64_t *generation,
+                 const char *fs_path,
+                 apr_uint64_t active,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  const char *index_dir = svn_dirent_join(fs_path, PATH_INDEX_DIR,
+                                          scratch_pool);
+  svn_error_t *err;
+
+  err = svn_io_dir_make(index_dir, APR_OS_DEFAULT, scratch_pool);
+  if (err && !APR_STATUS_IS_EEXIST(err->apr_err))
+    return svn_error_trace(err);
+  if (err)
+    svn_error_clear(err);
+  else
+    SVN_ERR(svn_io_copy_perms(fs_path, index_dir, scratch_pool));
+
+  *generation = active + 1;
+  *dir = svn_dirent_join(index_dir,
+                         apr_psprintf(scratch_pool, "%" APR_UINT64_T_FMT,
+                                      *generation),
+                         result_pool);
+
+  /* Start from scratch, removing any leftovers of earlier attempts. */
+  SVN_ERR(svn_io_remove_dir2(*dir, TRUE, NULL, NULL, scratch_pool));
+  SVN_ERR(svn_io_dir_make(*dir, APR_OS_DEFAULT, scratch_pool));
+  SVN_ERR(svn_io_copy_perms(fs_path, *dir, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Make the index number GENERATION the active path index in FS_PATH.
+ * Then remove OLD_DIR, unless it is NULL.  The caller must hold the FS
+ * write lock.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+activate_index_dir(const char *fs_path,
+                   apr_uint64_t generation,
+                   const char *old_dir,
+                   apr_pool_t *scratch_pool)
+{
+  const char *content = apr_psprintf(scratch_pool, "%" APR_UINT64_T_FMT "\n",
+                                     generation);
+
+  /* The index can always be rebuilt.  So, don't flush to disk. */
+  SVN_ERR(svn_io_write_atomic2(svn_dirent_join_many(scratch_pool, fs_path,
+                                                    PATH_INDEX_DIR,
+                                                    PATH_INDEX_ACTIVE,
+                                                    SVN_VA_NULL),
+                               content, strlen(content),
+                               perms_reference(fs_path, scratch_pool),
+                               FALSE, scratch_pool));
+
+  /* Readers still using the old index will notice the switch and retry. */
+  if (old_dir)
+    SVN_ERR(svn_io_remove_dir2(old_dir, TRUE, NULL, NULL, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Append all non-empty BUFFERS to the respective bucket files in DIR and
+ * clear them.  New bucket files get the permissions of PERMS_PATH.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+write_buffers(const char *dir,
+              svn_stringbuf_t **buffers,
+              const char *perms_path,
+              apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int bucket;
+
+  for (bucket = 0; bucket < PATH_INDEX_BUCKETS; ++bucket)
+    {
+      apr_file_t *file;
+      apr_off_t offset;
+      svn_filesize_t size;
+      const char *path;
+
+      if (buffers[bucket] == NULL || buffers[bucket]->len == 0)
+        continue;
+
+      svn_pool_clear(iterpool);
+      path = bucket_path(dir, bucket, iterpool);
+      SVN_ERR(svn_io_file_open(&file, path,
+                               APR_WRITE | APR_CREATE | APR_BUFFERED,
+                               APR_OS_DEFAULT, iterpool));
+
+      /* Drop any torn record left behind by an interrupted write. */
+      SVN_ERR(svn_io_file_size_get(&size, file, iterpool));
+      if (size == 0)
+        SVN_ERR(svn_io_copy_perms(perms_path, path, iterpool));
+
+      offset = (apr_off_t)(size - size % RECORD_SIZE);
+      if (offset != size)
+        SVN_ERR(svn_io_file_trunc(file, offset, iterpool));
+
+      SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, iterpool));
+      SVN_ERR(svn_io_file_write_full(file, buffers[bucket]->data,
+                                     buffers[bucket]->len, NULL, iterpool));
+      SVN_ERR(svn_io_file_close(file, iterpool));
+
+      svn_stringbuf_setempty(buffers[bucket]);
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Set *YOUNGEST to the youngest revision covered by the index in DIR.
+ * Set it to SVN_INVALID_REVNUM if there is no such index.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+read_current(svn_revnum_t *youngest,
+             const char *dir,
+             apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *content;
+  svn_error_t *err;
+
+  err = svn_stringbuf_from_file2(&content,
+                                 svn_dirent_join(dir, PATH_INDEX_CURRENT,
+                                                 scratch_pool),
+                                 scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      *youngest = SVN_INVALID_REVNUM;
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  svn_stringbuf_strip_whitespace(content);
+  err = svn_revnum_parse(youngest, content->data, NULL);
+  if (err)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, err,
+                             _("Corrupt path index '%s'"),
+                             svn_dirent_local_style(dir, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Store YOUNGEST as the youngest revision covered by the index in DIR.
+ * Copy the permissions from PERMS_PATH.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+write_current(const char *dir,
+              svn_revnum_t youngest,
+              const char *perms_path,
+              apr_pool_t *scratch_pool)
+{
+  const char *content = apr_psprintf(scratch_pool, "%ld\n", youngest);
+
+  /* The index can always be rebuilt.  So, don't flush to disk. */
+  return svn_error_trace(svn_io_write_atomic2(
+                            svn_dirent_join(dir, PATH_INDEX_CURRENT,
+                                            scratch_pool),
+                            content, strlen(content), perms_path, FALSE,
+                            scratch_pool));
+}
+
+/* Append to REVISIONS all revisions in the range START to END from the
+ * records in BUCKET of the index in DIR that match any of the key HASHES
+ * (apr_uint64_t).  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+scan_bucket(apr_array_header_t *revisions,
+            const char *dir,
+            int bucket,
+            const apr_array_header_t *hashes,
+            svn_revnum_t start,
+            svn_revnum_t end,
+            apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  svn_filesize_t size;
+  apr_off_t offset;
+  unsigned char *buffer;
+  svn_error_t *err;
+
+  err = svn_io_file_open(&file, bucket_path(dir, bucket, scratch_pool),
+                         APR_READ, APR_OS_DEFAULT, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  /* Records are sorted by revision.  Read the file backwards, block by
+   * block, until we hit the first revision before START. */
+  SVN_ERR(svn_io_file_size_get(&size, file, scratch_pool));
+  offset = (apr_off_t)(size - size % RECORD_SIZE);
+  buffer = apr_palloc(scratch_pool, READ_BLOCK_SIZE);
+
+  while (offset > 0)
+    {
+      apr_size_t block_size = (apr_size_t)MIN(offset, READ_BLOCK_SIZE);
+      const unsigned char *record;
+
+      offset -= block_size;
+      SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+      SVN_ERR(svn_io_file_read_full2(file, buffer, block_size, NULL, NULL,
+                                     scratch_pool));
+
+      for (record = buffer + block_size - RECORD_SIZE;
+           record >= buffer;
+           record -= RECORD_SIZE)
+        {
+          svn_revnum_t revision
+            = (svn_revnum_t)decode_uint64(record + 8);
+          apr_uint64_t hash;
+          int i;
+
+          if (revision < start)
+            return svn_error_trace(svn_io_file_close(file, scratch_pool));
+          if (revision > end)
+            continue;
+
+          hash = decode_uint64(record);
+          for (i = 0; i < hashes->nelts; ++i)
+            if (APR_ARRAY_IDX(hashes, i, apr_uint64_t) == hash)
+              {
+                APR_ARRAY_PUSH(revisions, svn_revnum_t) = revision;
+                break;
+              }
+        }
+    }
+
+  return svn_error_trace(svn_io_file_close(file, scratch_pool));
+}
+
+/* Set *REVISIONS to all revisions between START and END, inclusively,
+ * that may have changed PATH according to the index in DIR.  Set it to
+ * NULL if DIR does not contain an index.  See svn_fs__path_index_read()
+ * for details.  Allocate the result in RESULT_POOL and use SCRATCH_POOL
+ * for temporary allocations. */
+static svn_error_t *
+read_revisions(apr_array_header_t **revisions,
+               const char *dir,
+               const char *path,
+               svn_revnum_t start,
+               svn_revnum_t end,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *hashes = apr_array_make(scratch_pool, 16,
+                                              sizeof(apr_uint64_t));
+  apr_array_header_t *result;
+  svn_boolean_t scanned[PATH_INDEX_BUCKETS] = { FALSE };
+  apr_pool_t *iterpool;
+  svn_revnum_t youngest, revision;
+  apr_size_t len;
+  int i, count;
+
+  SVN_ERR(read_current(&youngest, dir, scratch_pool));
+  if (!SVN_IS_VALID_REVNUM(youngest))
+    {
+      *revisions = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  /* Changes at or below PATH as well as replacements and deletions of
+   * any of its parents. */
+  path = canonical_path(path, scratch_pool);
+  len = strlen(path);
+  APR_ARRAY_PUSH(hashes, apr_uint64_t) = hash_key(KEY_SUBTREE, path, len);
+  while (len > 1)
+    {
+      len = parent_len(path, len);
+      APR_ARRAY_PUSH(hashes, apr_uint64_t) = hash_key(KEY_EXACT, path, len);
+    }
+
+  /* Revisions not covered by the index yet may have changed anything. */
+  result = apr_array_make(result_pool, 16, sizeof(svn_revnum_t));
+  for (revision = end; revision > youngest && revision >= start; --revision)
+    APR_ARRAY_PUSH(result, svn_revnum_t) = revision;
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < hashes->nelts; ++i)
+    {
+      int bucket = bucket_of(APR_ARRAY_IDX(hashes, i, apr_uint64_t));
+      if (scanned[bucket])
+        continue;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(scan_bucket(result, dir, bucket, hashes, start,
+                          MIN(end, youngest), iterpool));
+      scanned[bucket] = TRUE;
+    }
+  svn_pool_destroy(iterpool);
+
+  /* Sort and remove duplicates. */
+  if (result->nelts > 1)
+    {
+      qsort(result->elts, result->nelts, result->elt_size,
+            compare_revisions_descending);
+      for (i = 1, count = 1; i < result->nelts; ++i)
+        if (APR_ARRAY_IDX(result, i, svn_revnum_t)
+            != APR_ARRAY_IDX(result, count - 1, svn_revnum_t))
+          APR_ARRAY_IDX(result, count++, svn_revnum_t)
+            = APR_ARRAY_IDX(result, i, svn_revnum_t);
+
+      result->nelts = count;
+    }
+
+  *revisions = result;
+  return SVN_NO_ERROR;
+}
+
+/* Copy the records for revisions up to YOUNGEST from BUCKET of the index
+ * in SRC_DIR to DST_DIR.  Copy the permissions from PERMS_PATH.  Use
+ * SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+copy_bucket(const char *src_dir,
+            const char *dst_dir,
+            int bucket,
+            svn_revnum_t youngest,
+            const char *perms_path,
+            apr_pool_t *scratch_pool)
+{
+  const char *dst_path = bucket_path(dst_dir, bucket, scratch_pool);
+  svn_stringbuf_t *content;
+  apr_size_t len;
+  svn_error_t *err;
+
+  err = svn_stringbuf_from_file2(&content,
+                                 bucket_path(src_dir, bucket, scratch_pool),
+                                 scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  /* Records are sorted by revision, so any records beyond YOUNGEST are
+   * at the end.  Drop them together with any torn record. */
+  len = content->len - content->len % RECORD_SIZE;
+  while (len > 0
+         && decode_uint64((const unsigned char *)content->data + len
+                          - RECORD_SIZE + 8) > (apr_uint64_t)youngest)
+    len -= RECORD_SIZE;
+
+  if (len == 0)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_io_file_create_bytes(dst_path, content->data, len,
+                                   scratch_pool));
+  return svn_error_trace(svn_io_copy_perms(perms_path, dst_path,
+                                           scratch_pool));
+}
+
+svn_error_t *
+svn_fs__path_index_youngest(svn_revnum_t *youngest,
+                            const char *fs_path,
+                            apr_pool_t *scratch_pool)
+{
+  const char *dir;
+  apr_uint64_t generation;
+
+  SVN_ERR(read_active(&dir, &generation, fs_path, scratch_pool,
+                      scratch_pool));
+  if (dir == NULL)
+    {
+      *youngest = SVN_INVALID_REVNUM;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(read_current(youngest, dir, scratch_pool));
+}
+
+svn_error_t *
+svn_fs__path_index_append(const char *fs_path,
+                          svn_revnum_t revision,
+                          apr_hash_t *changed_paths,
+                          apr_pool_t *scratch_pool)
+{
+  const char *perms_path = perms_reference(fs_path, scratch_pool);
+  svn_stringbuf_t *buffers[PATH_INDEX_BUCKETS] = { NULL };
+  const char *dir;
+  apr_uint64_t generation;
+  svn_revnum_t youngest;
+
+  /* Only extend an existing index that covers all previous revisions.
+   * Everything else is left to svn_fs__path_index_builder_*(). */
+  SVN_ERR(read_active(&dir, &generation, fs_path, scratch_pool,
+                      scratch_pool));
+  if (dir == NULL)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(read_current(&youngest, dir, scratch_pool));
+  if (!SVN_IS_VALID_REVNUM(youngest) || youngest + 1 != revision)
+    return SVN_NO_ERROR;
+
+  add_records(buffers, revision, get_change_keys(changed_paths,
+                                                 scratch_pool),
+              scratch_pool);
+  SVN_ERR(write_buffers(dir, buffers, perms_path, scratch_pool));
+
+  return svn_error_trace(write_current(dir, revision, perms_path,
+                                       scratch_pool));
+}
+
+svn_error_t *
+svn_fs__path_index_read(apr_array_header_t **revisions,
+                        const char *fs_path,
+                        const char *path,
+                        svn_revnum_t start,
+                        svn_revnum_t end,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  const char *dir;
+  apr_uint64_t generation, active;
+
+  /* A rebuild may remove the index while we read it.  In that case,
+   * "active" will have changed and we try again with the new index. */
+  do
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(read_active(&dir, &generation, fs_path, iterpool, iterpool));
+      if (dir == NULL)
+        {
+          *revisions = NULL;
+          break;
+        }
+
+      SVN_ERR(read_revisions(revisions, dir, path, start, end, result_pool,
+                             iterpool));
+      SVN_ERR(read_active(&dir, &active, fs_path, iterpool, iterpool));
+    }
+  while (active != generation);
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs__path_index_copy(const char *src_fs_path,
+                        const char *dst_fs_path,
+                        svn_revnum_t youngest,
+                        apr_pool_t *scratch_pool)
+{
+  const char *perms_path = perms_reference(dst_fs_path, scratch_pool);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  const char *src_dir, *dst_dir, *old_dir;
+  apr_uint64_t src_generation, dst_generation, active;
+  svn_revnum_t src_youngest;
+  int bucket;
+
+  /* The source index may get rebuilt while we copy it.  In that case,
+   * "active" will have changed and we try again with the new index. */
+  while (TRUE)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(read_active(&src_dir, &src_generation, src_fs_path,
+                          iterpool, iterpool));
+      if (src_dir == NULL)
+        break;
+
+      SVN_ERR(read_current(&src_youngest, src_dir, iterpool));
+      if (!SVN_IS_VALID_REVNUM(src_youngest))
+        {
+          /* Unless it just got replaced, the source index is unusable. */
+          SVN_ERR(read_active(&src_dir, &active, src_fs_path, iterpool,
+                              iterpool));
+          if (active == src_generation)
+            break;
+
+          continue;
+        }
+
+      /* Commits to the destination will extend the index from there. */
+      src_youngest = MIN(src_youngest, youngest);
+
+      SVN_ERR(read_active(&old_dir, &active, dst_fs_path, iterpool,
+                          iterpool));
+      SVN_ERR(create_index_dir(&dst_dir, &dst_generation, dst_fs_path,
+                               active, iterpool, iterpool));
+      for (bucket = 0; bucket < PATH_INDEX_BUCKETS; ++bucket)
+        SVN_ERR(copy_bucket(src_dir, dst_dir, bucket, src_youngest,
+                            perms_path, iterpool));
+      SVN_ERR(write_current(dst_dir, src_youngest, perms_path, iterpool));
+
+      SVN_ERR(read_active(&src_dir, &active, src_fs_path, iterpool,
+                          iterpool));
+      if (active == src_generation)
+        {
+          SVN_ERR(activate_index_dir(dst_fs_path, dst_generation, old_dir,
+                                     iterpool));
+          svn_pool_destroy(iterpool);
+          return SVN_NO_ERROR;
+        }
+    }
+
+  /* There is no index to copy.  Don't keep an outdated one. */
+  svn_pool_destroy(iterpool);
+  return svn_error_trace(svn_io_remove_dir2(svn_dirent_join(dst_fs_path,
+                                                            PATH_INDEX_DIR,
+                                                            scratch_pool),
+                                            TRUE, NULL, NULL,
+                                            scratch_pool));
+}
+
+svn_error_t *
+svn_fs__path_index_builder_create(svn_fs__path_index_builder_t **builder,
+                                  const char *fs_path,
+                                  apr_pool_t *result_pool,
+                                  apr_pool_t *scratch_pool)
+{
+  svn_fs__path_index_builder_t *result = apr_pcalloc(result_pool,
+                                                     sizeof(*result));
+  const char *active_dir;
+  apr_uint64_t active;
+
+  result->fs_path = apr_pstrdup(result_pool, fs_path);
+  result->youngest = SVN_INVALID_REVNUM;
+  result->pool = result_pool;
+
+  /* Build the new index next to the active one. */
+  SVN_ERR(read_active(&active_dir, &active, fs_path, scratch_pool,
+                      scratch_pool));
+  SVN_ERR(create_index_dir(&result->dir, &result->generation, fs_path,
+                           active, result_pool, scratch_pool));
+
+  *builder = result;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs__path_index_builder_add(svn_fs__path_index_builder_t *builder,
+                               svn_revnum_t revision,
+                               apr_hash_t *changed_paths,
+                               apr_pool_t *scratch_pool)
+{
+  SVN_ERR_ASSERT(revision == builder->youngest + 1);
+
+  builder->buffered
+    += add_records(builder->buffers, revision,
+                   get_change_keys(changed_paths, scratch_pool),
+                   builder->pool);
+  builder->youngest = revision;
+
+  if (builder->buffered >= BUILDER_BUFFER_SIZE)
+    {
+      SVN_ERR(write_buffers(builder->dir, builder->buffers,
+                            perms_reference(builder->fs_path,
+                                            scratch_pool),
+                            scratch_pool));
+      builder->buffered = 0;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs__path_index_builder_finish(svn_fs__path_index_builder_t *builder,
+                                  apr_pool_t *scratch_pool)
+{
+  const char *perms_path = perms_reference(builder->fs_path, scratch_pool);
+  const char *old_dir;
+  apr_uint64_t active;
+
+  SVN_ERR_ASSERT(SVN_IS_VALID_REVNUM(builder->youngest));
+
+  SVN_ERR(write_buffers(builder->dir, builder->buffers, perms_path,
+                        scratch_pool));
+  builder->buffered = 0;
+  SVN_ERR(write_current(builder->dir, builder->youngest, perms_path,
+                        scratch_pool));
+
+  /* Replace the old index, if any. */
+  SVN_ERR(read_active(&old_dir, &active, builder->fs_path, scratch_pool,
+                      scratch_pool));
+  return svn_error_trace(activate_index_dir(builder->fs_path,
+                                            builder->generation,
+                                            active == builder->generation
+                                              ? NULL : old_dir,
+                                            scratch_pool));
+}
@@ -26,8 +26,10 @@
 
 #include "svn_hash.h"
 #include "svn_ctype.h"
+#include "svn_dirent_uri.h"
 #include "svn_sorts.h"
 
+#include "private/svn_fspath.h"
 #include "private/svn_io_private.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_string_private.h"
@@ -126,6 +128,8 @@ dbg__log_access(svn_fs_t *fs,
         description = "  (txdelta window)";
       else if (header->type == svn_fs_x__rep_self_delta)
         description = "  DELTA";
+      else if (header->type == svn_fs_x__rep_large)
+        description = "  LARGE";
       else
         description = apr_psprintf(scratch_pool,
                                    "  DELTA against %ld/%" APR_UINT64_T_FMT,
@@ -954,6 +958,10 @@ typedef struct rep_read_baton_t
   /* Pool used to store file handles and other data that is persistant
      for the entire stream read. */
   apr_pool_t *filehandle_pool;
+
+  /* If not NULL, the rep is stored out-of-line and this is its fulltext
+     file, allocated in FILEHANDLE_POOL. */
+  svn_stream_t *large_file;
 } rep_read_baton_t;
 
 /* Set window key in *KEY to address the window described by RS.
@@ -2046,7 +2054,7 @@ rep_read_contents(void *baton,
     }
 
   /* No fulltext cache to help us.  We must read from the window stream. */
-  if (!rb->rs_list)
+  if (!rb->rs_list && !rb->large_file)
     {
       /* Window stream not initialized, yet.  Do it now. */
       SVN_ERR(build_rep_list(&rb->rs_list, &rb->base_window,
@@ -2064,6 +2072,19 @@ rep_read_contents(void *baton,
    * already positioned at the end of the rep. */
   if (rb->off == rb->len)
     *len = 0;
+  else if (rb->large_file)
+    {
+      /* Out-of-line reps are plain files and never go through the caches.
+       * A truncated file must not go unnoticed. */
+      apr_size_t requested = (apr_size_t)MIN(*len, rb->len - rb->off);
+
+      *len = requested;
+      SVN_ERR(svn_stream_read_full(rb->large_file, buf, len));
+      if (*len < requested)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Out-of-line representation is "
+                                  "truncated"));
+    }
   else
     SVN_ERR(get_contents_from_windows(rb, buf, len));
 
@@ -2108,6 +2129,55 @@ rep_read_contents(void *baton,
   return SVN_NO_ERROR;
 }
 
+svn_boolean_t
+svn_fs_x__is_large_rep(const svn_fs_x__representation_t *rep)
+{
+  /* Even an empty self-delta occupies a few bytes in the rev file.
+   * Out-of-line reps consist of their header only. */
+  return rep && rep->has_sha1 && rep->size == 0 && rep->expanded_size > 0;
+}
+
+svn_error_t *
+svn_fs_x__open_large_file(apr_file_t **file,
+                          svn_fs_t *fs,
+                          const svn_fs_x__representation_t *rep,
+                          apr_pool_t *result_pool)
+{
+  const char *path;
+  svn_error_t *err;
+
+  *file = NULL;
+  if (!svn_fs_x__is_large_rep(rep))
+    return SVN_NO_ERROR;
+
+  path = svn_fs_x__path_large_file(fs, rep->sha1_digest, result_pool);
+  err = svn_io_file_open(file, path, APR_READ | APR_BINARY,
+                         APR_OS_DEFAULT, result_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, err,
+                             _("Out-of-line contents '%s' is missing"),
+                             svn_dirent_local_style(path, result_pool));
+
+  return svn_error_trace(err);
+}
+
+/* Make RB read the out-of-line fulltext of its rep in FS. */
+static svn_error_t *
+open_large_contents(rep_read_baton_t *rb,
+                    svn_fs_t *fs)
+{
+  apr_file_t *file;
+
+  SVN_ERR(svn_fs_x__open_large_file(&file, fs, &rb->rep,
+                                    rb->filehandle_pool));
+  rb->large_file = svn_stream_from_aprfile2(file, FALSE,
+                                            rb->filehandle_pool);
+  rb->fulltext_cache = NULL;
+  rb->fulltext_cache_key.revision = SVN_INVALID_REVNUM;
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_x__get_contents(svn_stream_t **contents_p,
                        svn_fs_t *fs,
@@ -2119,6 +2189,20 @@ svn_fs_x__get_contents(svn_stream_t **contents_p,
     {
       *contents_p = svn_stream_empty(result_pool);
     }
+  else if (svn_fs_x__is_large_rep(rep))
+    {
+      rep_read_baton_t *rb;
+      svn_fs_x__pair_cache_key_t fulltext_cache_key = { SVN_INVALID_REVNUM };
+
+      SVN_ERR(rep_read_get_baton(&rb, fs, rep, fulltext_cache_key,
+                                 result_pool));
+      SVN_ERR(open_large_contents(rb, fs));
+
+      *contents_p = svn_stream_create(rb, result_pool);
+      svn_stream_set_read2(*contents_p, NULL /* only full read support */,
+                           rep_read_contents);
+      svn_stream_set_close(*contents_p, rep_read_contents_close);
+    }
   else
     {
       svn_fs_x__data_t *ffd = fs->fsap_data;
@@ -2205,7 +2289,12 @@ svn_fs_x__get_contents_from_file(svn_stream_t **contents_p,
                           SVN_FS_X__ITEM_TYPE_ANY_REP, pool));
 
   /* Build the representation list (delta chain). */
-  if (rh->type == svn_fs_x__rep_self_delta)
+  if (rh->type == svn_fs_x__rep_large)
+    {
+      /* The data does not live in FILE at all. */
+      SVN_ERR(open_large_contents(rb, fs));
+    }
+  else if (rh->type == svn_fs_x__rep_self_delta)
     {
       rb->rs_list = apr_array_make(pool, 1, sizeof(rep_state_t *));
       APR_ARRAY_PUSH(rb->rs_list, rep_state_t *) = rs;
@@ -2290,6 +2379,7 @@ svn_fs_x__try_process_file_contents(svn_boolean_t *success,
       fulltext_cache_key.revision = svn_fs_x__get_revnum(rep->id.change_set);
       fulltext_cache_key.second = rep->id.number;
       if (   SVN_IS_VALID_REVNUM(fulltext_cache_key.revision)
+          && !svn_fs_x__is_large_rep(rep)
           && fulltext_size_is_cachable(ffd, rep->expanded_size))
         {
           cache_access_wrapper_baton_t wrapper_baton;
@@ -2378,8 +2468,9 @@ svn_fs_x__get_file_delta_stream(svn_txdelta_stream_t **stream_p,
 
   /* Try a shortcut: if the target is stored as a delta against the source,
      then just use that delta.  However, prefer using the fulltext cache
-     whenever that is available. */
-  if (target->data_rep && source)
+     whenever that is available.  Out-of-line reps are never deltas. */
+  if (   target->data_rep && source
+      && !svn_fs_x__is_large_rep(target->data_rep))
     {
       /* Read target's base rep if any. */
       SVN_ERR(create_rep_state(&rep_state, &rep_header, NULL,
@@ -2934,6 +3025,26 @@ svn_fs_x__create_changes_context(svn_fs_x__changes_context_t **context,
   return SVN_NO_ERROR;
 }
 
+/* Remove all entries from the svn_fs_x__change_t * array CHANGES that
+ * are not at or below PREFIX. */
+static void
+filter_changes(apr_array_header_t *changes,
+               const char *prefix)
+{
+  int i;
+  int count = 0;
+
+  for (i = 0; i < changes->nelts; ++i)
+    {
+      svn_fs_x__change_t *change
+        = APR_ARRAY_IDX(changes, i, svn_fs_x__change_t *);
+      if (svn_fspath__skip_ancestor(prefix, change->path.data))
+        APR_ARRAY_IDX(changes, count++, svn_fs_x__change_t *) = change;
+    }
+
+  changes->nelts = count;
+}
+
 svn_error_t *
 svn_fs_x__get_changes(apr_array_header_t **changes,
                       svn_fs_x__changes_context_t *context,
@@ -2942,6 +3053,8 @@ svn_fs_x__get_changes(apr_array_header_t **changes,
 {
   svn_boolean_t found;
   svn_fs_x__data_t *ffd = context->fs->fsap_data;
+  svn_boolean_t is_packed = svn_fs_x__is_packed_rev(context->fs,
+                                                    context->revision);
 
   svn_fs_x__id_t id;
   id.change_set = svn_fs_x__change_set_by_rev(context->revision);
@@ -2949,12 +3062,13 @@ svn_fs_x__get_changes(apr_array_header_t **changes,
 
   /* try cache lookup first */
 
-  if (svn_fs_x__is_packed_rev(context->fs, context->revision))
+  if (is_packed)
     {
       apr_off_t offset;
       svn_fs_x__pair_cache_key_t key;
       svn_fs_x__changes_get_list_baton_t baton;
       baton.start = (int)context->next;
+      baton.prefix = context->prefix;
       baton.eol = &context->eol;
 
       SVN_ERR(svn_fs_x__item_offset(&offset, &baton.sub_item, context->fs,
@@ -3003,6 +3117,11 @@ svn_fs_x__get_changes(apr_array_header_t **changes,
 
   context->next += (*changes)->nelts;
 
+  /* Containers select the changes at or below the PREFIX themselves.
+   * Non-packed lists are stored in plain blocks that we must filter. */
+  if (context->prefix && !is_packed)
+    filter_changes(*changes, context->prefix);
+
   SVN_ERR(dbg__log_access(context->fs, &id, *changes,
                           SVN_FS_X__ITEM_TYPE_CHANGES, scratch_pool));
 
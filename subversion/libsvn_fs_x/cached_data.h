@@ -67,6 +67,20 @@ svn_fs_x__rep_chain_length(int *chain_length,
                            svn_fs_t *fs,
                            apr_pool_t *scratch_pool);
 
+/* Return TRUE if the contents of REP is stored out-of-line in the large
+   file store instead of the revision file. */
+svn_boolean_t
+svn_fs_x__is_large_rep(const svn_fs_x__representation_t *rep);
+
+/* If REP in FS is stored out-of-line, set *FILE to its fulltext opened
+   for reading.  Otherwise, set *FILE to NULL.  Allocate *FILE in
+   RESULT_POOL. */
+svn_error_t *
+svn_fs_x__open_large_file(apr_file_t **file,
+                          svn_fs_t *fs,
+                          const svn_fs_x__representation_t *rep,
+                          apr_pool_t *result_pool);
+
 /* Set *CONTENTS_P to be a readable svn_stream_t that receives the text
    representation REP as seen in filesystem FS.  If CACHE_FULLTEXT is
    not set, bypass fulltext cache lookup for this rep and don't put the
@@ -433,6 +433,23 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
   /* 1st level DAG node cache */
   ffd->dag_node_cache = svn_fs_x__create_dag_cache(fs->pool);
 
+  /* 2nd level DAG cache: path@rev -> node ID, shared between sessions.
+     Tiny entries, so keep plenty of them in the inprocess fallback. */
+  SVN_ERR(create_cache(&(ffd->dag_path_cache),
+                       NULL,
+                       membuffer,
+                       1, 1024,
+                       svn_fs_x__serialize_id,
+                       svn_fs_x__deserialize_id,
+                       APR_HASH_KEY_STRING,
+                       apr_pstrcat(scratch_pool, prefix, "DAGPATH",
+                                   SVN_VA_NULL),
+                       SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                       has_namespace,
+                       fs,
+                       no_handler, FALSE,
+                       fs->pool, scratch_pool));
+
   /* Very rough estimate: 1K per directory. */
   SVN_ERR(create_cache(&(ffd->dir_cache),
                        NULL,
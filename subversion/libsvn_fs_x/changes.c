@@ -21,9 +21,13 @@
  */
 
 #include "svn_private_config.h"
+#include "svn_path.h"
+#include "svn_pools.h"
 #include "svn_sorts.h"
 
+#include "private/svn_fspath.h"
 #include "private/svn_packed_data.h"
+#include "private/svn_sorts_private.h"
 
 #include "changes.h"
 #include "string_table.h"
@@ -61,6 +65,14 @@
 #define CHANGE_KIND_DELETE  0x00040
 #define CHANGE_KIND_REPLACE 0x00060
 
+/* Number of integer sub-streams per change, i.e. the number of values
+ * that make up a single "row" when reading them. */
+#define CHANGE_FIELD_COUNT  4
+
+/* Number of offsets resp. changes to bulk-decode at once when reading
+ * the container. */
+#define READ_BATCH_SIZE     32
+
 /* Our internal representation of a change */
 typedef struct binary_change_t
 {
@@ -94,8 +106,114 @@ struct svn_fs_x__changes_t
   /* [Offsets[index] .. Offsets[index+1]) is the range in CHANGES that
    * forms the contents of change list INDEX. */
   apr_array_header_t *offsets;
+
+  /* Path directory.  [Offsets[index] .. Offsets[index+1]) in ORDER are the
+   * indexes of the changes of list INDEX within CHANGES, sorted by path as
+   * per svn_path_compare_paths.  Hence, all changes at or below any given
+   * path form a contiguous range that can be found by binary search.
+   * Array elements are ints. */
+  apr_array_header_t *order;
 };
 
+/* Type of the string table accessor functions.  We need to read paths
+ * from both, the normal and the cache serialized representation.
+ */
+typedef const char *(*string_table_get_t)(const string_table_t *table,
+                                          apr_size_t idx,
+                                          apr_size_t *length,
+                                          apr_pool_t *result_pool);
+
+/* Entry used when sorting the changes of a list by path. */
+typedef struct path_order_t
+{
+  const char *path;
+  int index;
+} path_order_t;
+
+/* Implements svn_sort__array's comparison function for path_order_t
+ * elements. */
+static int
+compare_path_order(const void *lhs,
+                   const void *rhs)
+{
+  const path_order_t *a = lhs;
+  const path_order_t *b = rhs;
+  int diff = svn_path_compare_paths(a->path, b->path);
+
+  /* Keep duplicates in their original order. */
+  return diff ? diff : (a->index < b->index ? -1 : a->index > b->index);
+}
+
+/* Sort the path_order_t elements of ENTRIES and append their INDEX values
+ * to ORDER.
+ */
+static void
+append_order(apr_array_header_t *order,
+             apr_array_header_t *entries)
+{
+  int i;
+
+  svn_sort__array(entries, compare_path_order);
+  for (i = 0; i < entries->nelts; ++i)
+    APR_ARRAY_PUSH(order, int) = APR_ARRAY_IDX(entries, i, path_order_t).index;
+}
+
+/* Within the range [*FIRST, *LAST) of the path directory ORDER of CHANGES,
+ * select the sub-range of changes at or below PREFIX.  PATHS is the string
+ * table of the container and GET the function to access it.  The probed
+ * paths are allocated in and released from a sub-pool of SCRATCH_POOL.
+ */
+static void
+select_subtree(int *first,
+               int *last,
+               const int *order,
+               const binary_change_t *changes,
+               const string_table_t *paths,
+               string_table_get_t get,
+               const char *prefix,
+               apr_pool_t *scratch_pool)
+{
+  int lower = *first;
+  int upper = *last;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  /* The first path that does not sort before PREFIX ... */
+  while (lower < upper)
+    {
+      int middle = lower + (upper - lower) / 2;
+      const char *path;
+
+      svn_pool_clear(iterpool);
+      path = get(paths, changes[order[middle]].path, NULL, iterpool);
+
+      if (svn_path_compare_paths(path, prefix) < 0)
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+
+  *first = lower;
+
+  /* ... starts the range of PREFIX and its sub-paths. */
+  upper = *last;
+  while (lower < upper)
+    {
+      int middle = lower + (upper - lower) / 2;
+      const char *path;
+
+      svn_pool_clear(iterpool);
+      path = get(paths, changes[order[middle]].path, NULL, iterpool);
+
+      if (svn_fspath__skip_ancestor(prefix, path))
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+
+  *last = lower;
+  svn_pool_destroy(iterpool);
+}
+
 /* Create and return a new container object, allocated in RESULT_POOL with
  * an initial capacity of INITIAL_COUNT changes.  The PATH and BUILDER
  * members must be initialized by the caller afterwards.
@@ -110,6 +228,8 @@ changes_create_body(apr_size_t initial_count,
                                     sizeof(binary_change_t));
   changes->offsets = apr_array_make(result_pool, 16, sizeof(int));
   APR_ARRAY_PUSH(changes->offsets, int) = 0;
+  changes->order = apr_array_make(result_pool, (int)initial_count,
+                                  sizeof(int));
 
   return changes;
 }
@@ -177,6 +297,8 @@ svn_fs_x__changes_append_list(apr_size_t *list_index,
                               apr_array_header_t *list)
 {
   int i;
+  apr_pool_t *scratch_pool;
+  apr_array_header_t *entries;
 
   /* CHANGES must be in 'builder' mode */
   SVN_ERR_ASSERT(changes->builder);
@@ -186,6 +308,19 @@ svn_fs_x__changes_append_list(apr_size_t *list_index,
   for (i = 0; i < list->nelts; ++i)
     SVN_ERR(append_change(changes, APR_ARRAY_IDX(list, i, svn_fs_x__change_t *)));
 
+  /* add the list to the path directory */
+  scratch_pool = svn_pool_create(changes->order->pool);
+  entries = apr_array_make(scratch_pool, list->nelts, sizeof(path_order_t));
+  for (i = 0; i < list->nelts; ++i)
+    {
+      path_order_t *entry = apr_array_push(entries);
+      entry->path = APR_ARRAY_IDX(list, i, svn_fs_x__change_t *)->path.data;
+      entry->index = changes->changes->nelts - list->nelts + i;
+    }
+
+  append_order(changes->order, entries);
+  svn_pool_destroy(scratch_pool);
+
   /* terminate the list by storing the next changes offset */
   APR_ARRAY_PUSH(changes->offsets, int) = changes->changes->nelts;
   *list_index = (apr_size_t)(changes->offsets->nelts - 2);
@@ -220,6 +355,7 @@ svn_fs_x__changes_get_list(apr_array_header_t **list,
   int first;
   int last;
   int i;
+  const int *order = NULL;
 
   /* CHANGES must be in 'finalized' mode */
   SVN_ERR_ASSERT(changes->builder == NULL);
@@ -238,6 +374,17 @@ svn_fs_x__changes_get_list(apr_array_header_t **list,
   list_first = APR_ARRAY_IDX(changes->offsets, (int)idx, int);
   list_last = APR_ARRAY_IDX(changes->offsets, (int)idx + 1, int);
 
+  /* Only changes at or below a certain path?  Then, we iterate over the
+   * respective range of the path directory instead. */
+  if (context->prefix)
+    {
+      order = (const int *)changes->order->elts;
+      select_subtree(&list_first, &list_last, order,
+                     (const binary_change_t *)changes->changes->elts,
+                     changes->paths, svn_fs_x__string_table_get,
+                     context->prefix, result_pool);
+    }
+
   /* Restrict it to the sub-range requested by the caller.
    * Clip the range to never exceed the list's content. */
   first = MIN(context->next + list_first, list_last);
@@ -252,7 +399,8 @@ svn_fs_x__changes_get_list(apr_array_header_t **list,
   for (i = first; i < last; ++i)
     {
       const binary_change_t *binary_change
-        = &APR_ARRAY_IDX(changes->changes, i, binary_change_t);
+        = &APR_ARRAY_IDX(changes->changes, order ? order[i] : i,
+                         binary_change_t);
 
       /* convert BINARY_CHANGE into a standard FSX svn_fs_x__change_t */
       svn_fs_x__change_t *change = apr_pcalloc(result_pool, sizeof(*change));
@@ -306,6 +454,8 @@ svn_fs_x__write_changes_container(svn_stream_t *stream,
     = svn_packed__create_int_stream(root, TRUE, FALSE);
   svn_packed__int_stream_t *changes_stream
     = svn_packed__create_int_stream(root, FALSE, FALSE);
+  svn_packed__int_stream_t *order_stream
+    = svn_packed__create_int_stream(root, FALSE, FALSE);
 
   /* structure the CHANGES_STREAM such we can extract much of the redundancy
    * from the binary_change_t structs */
@@ -332,6 +482,19 @@ svn_fs_x__write_changes_container(svn_stream_t *stream,
       svn_packed__add_uint(changes_stream, change->copyfrom_path);
     }
 
+  /* serialize the path directory, relative to the start of each list */
+  for (i = 0; i + 1 < changes->offsets->nelts; ++i)
+    {
+      int list_first = APR_ARRAY_IDX(changes->offsets, i, int);
+      int list_last = APR_ARRAY_IDX(changes->offsets, i + 1, int);
+      int k;
+
+      for (k = list_first; k < list_last; ++k)
+        svn_packed__add_uint(order_stream,
+                             APR_ARRAY_IDX(changes->order, k, int)
+                               - list_first);
+    }
+
   /* write to disk */
   SVN_ERR(svn_fs_x__write_string_table(stream, paths, scratch_pool));
   SVN_ERR(svn_packed__data_write(stream, root, scratch_pool));
@@ -353,6 +516,7 @@ svn_fs_x__read_changes_container(svn_fs_x__changes_t **changes_p,
   svn_packed__data_root_t *root;
   svn_packed__int_stream_t *offsets_stream;
   svn_packed__int_stream_t *changes_stream;
+  svn_packed__int_stream_t *order_stream;
 
   /* read from disk */
   SVN_ERR(svn_fs_x__read_string_table(&changes->paths, stream,
@@ -361,30 +525,105 @@ svn_fs_x__read_changes_container(svn_fs_x__changes_t **changes_p,
   SVN_ERR(svn_packed__data_read(&root, stream, result_pool, scratch_pool));
   offsets_stream = svn_packed__first_int_stream(root);
   changes_stream = svn_packed__next_int_stream(offsets_stream);
+  order_stream = svn_packed__next_int_stream(changes_stream);
 
   /* read offsets array */
   count = svn_packed__int_count(offsets_stream);
   changes->offsets = apr_array_make(result_pool, (int)count, sizeof(int));
-  for (i = 0; i < count; ++i)
-    APR_ARRAY_PUSH(changes->offsets, int)
-      = (int)svn_packed__get_uint(offsets_stream);
+  for (i = 0; i < count; i += READ_BATCH_SIZE)
+    {
+      apr_uint64_t values[READ_BATCH_SIZE];
+      apr_size_t batch = MIN(count - i, READ_BATCH_SIZE);
+      apr_size_t k;
+
+      svn_packed__get_uints(offsets_stream, values, batch);
+      for (k = 0; k < batch; ++k)
+        APR_ARRAY_PUSH(changes->offsets, int) = (int)values[k];
+    }
 
   /* read changes array */
   count
     = svn_packed__int_count(svn_packed__first_int_substream(changes_stream));
   changes->changes
     = apr_array_make(result_pool, (int)count, sizeof(binary_change_t));
-  for (i = 0; i < count; ++i)
+  for (i = 0; i < count; i += READ_BATCH_SIZE)
     {
-      binary_change_t change;
+      apr_uint64_t values[READ_BATCH_SIZE * CHANGE_FIELD_COUNT];
+      apr_size_t batch = MIN(count - i, READ_BATCH_SIZE);
+      apr_size_t k;
+
+      svn_packed__get_uints(changes_stream, values,
+                            batch * CHANGE_FIELD_COUNT);
+      for (k = 0; k < batch; ++k)
+        {
+          const apr_uint64_t *row = values + k * CHANGE_FIELD_COUNT;
+          binary_change_t change;
 
-      change.flags = (int)svn_packed__get_uint(changes_stream);
-      change.path = (apr_size_t)svn_packed__get_uint(changes_stream);
+          change.flags = (int)row[0];
+          change.path = (apr_size_t)row[1];
 
-      change.copyfrom_rev = (svn_revnum_t)svn_packed__get_int(changes_stream);
-      change.copyfrom_path = (apr_size_t)svn_packed__get_uint(changes_stream);
+          change.copyfrom_rev = (svn_revnum_t)(apr_int64_t)row[2];
+          change.copyfrom_path = (apr_size_t)row[3];
 
-      APR_ARRAY_PUSH(changes->changes, binary_change_t) = change;
+          APR_ARRAY_PUSH(changes->changes, binary_change_t) = change;
+        }
+    }
+
+  /* read the path directory.  Containers written by older code don't
+   * have one, so we must sort the lists ourselves. */
+  changes->order = apr_array_make(result_pool, (int)count, sizeof(int));
+  if (order_stream)
+    {
+      int list = 0;
+      for (i = 0; i < count; i += READ_BATCH_SIZE)
+        {
+          apr_uint64_t values[READ_BATCH_SIZE];
+          apr_size_t batch = MIN(count - i, READ_BATCH_SIZE);
+          apr_size_t k;
+
+          svn_packed__get_uints(order_stream, values, batch);
+          for (k = 0; k < batch; ++k)
+            {
+              /* Find the list that this entry belongs to. */
+              while ((int)(i + k)
+                     >= APR_ARRAY_IDX(changes->offsets, list + 1, int))
+                ++list;
+
+              APR_ARRAY_PUSH(changes->order, int)
+                = (int)values[k] + APR_ARRAY_IDX(changes->offsets, list, int);
+            }
+        }
+    }
+  else
+    {
+      apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+      int list;
+
+      for (list = 0; list + 1 < changes->offsets->nelts; ++list)
+        {
+          int list_first = APR_ARRAY_IDX(changes->offsets, list, int);
+          int list_last = APR_ARRAY_IDX(changes->offsets, list + 1, int);
+          apr_array_header_t *entries;
+          int k;
+
+          svn_pool_clear(iterpool);
+          entries = apr_array_make(iterpool, list_last - list_first,
+                                   sizeof(path_order_t));
+          for (k = list_first; k < list_last; ++k)
+            {
+              path_order_t *entry = apr_array_push(entries);
+              entry->path = svn_fs_x__string_table_get(
+                              changes->paths,
+                              APR_ARRAY_IDX(changes->changes, k,
+                                            binary_change_t).path,
+                              NULL, iterpool);
+              entry->index = k;
+            }
+
+          append_order(changes->order, entries);
+        }
+
+      svn_pool_destroy(iterpool);
     }
 
   *changes_p = changes;
@@ -406,6 +645,7 @@ svn_fs_x__serialize_changes_container(void **data,
   apr_size_t size
     = changes->changes->elt_size * changes->changes->nelts
     + changes->offsets->elt_size * changes->offsets->nelts
+    + changes->order->elt_size * changes->order->nelts
     + 10 * changes->changes->elt_size
     + 100;
 
@@ -417,6 +657,7 @@ svn_fs_x__serialize_changes_container(void **data,
   svn_fs_x__serialize_string_table(context, &changes->paths);
   svn_fs_x__serialize_apr_array(context, &changes->changes);
   svn_fs_x__serialize_apr_array(context, &changes->offsets);
+  svn_fs_x__serialize_apr_array(context, &changes->order);
 
   /* return the serialized result */
   serialized = svn_temp_serializer__get(context);
@@ -439,6 +680,7 @@ svn_fs_x__deserialize_changes_container(void **out,
   svn_fs_x__deserialize_string_table(changes, &changes->paths);
   svn_fs_x__deserialize_apr_array(changes, &changes->changes, result_pool);
   svn_fs_x__deserialize_apr_array(changes, &changes->offsets, result_pool);
+  svn_fs_x__deserialize_apr_array(changes, &changes->order, result_pool);
 
   /* done */
   *out = changes;
@@ -455,6 +697,7 @@ svn_fs_x__changes_get_list_func(void **out,
 {
   int first;
   int last;
+  int list_last;
   int i;
   apr_array_header_t *list;
 
@@ -478,6 +721,7 @@ svn_fs_x__changes_get_list_func(void **out,
   const binary_change_t *changes
     = svn_temp_deserializer__ptr(serialized_changes,
                               (const void *const *)&serialized_changes->elts);
+  const int *order = NULL;
 
   /* validate index */
   if (idx + 1 >= (apr_size_t)serialized_offsets->nelts)
@@ -490,18 +734,32 @@ svn_fs_x__changes_get_list_func(void **out,
   first = offsets[idx];
   last = offsets[idx+1];
 
+  /* Only changes at or below a certain path?  Then, we iterate over the
+   * respective range of the path directory instead. */
+  if (b->prefix)
+    {
+      const apr_array_header_t *serialized_order
+        = svn_temp_deserializer__ptr(container,
+                                     (const void *const *)&container->order);
+      order = svn_temp_deserializer__ptr(serialized_order,
+                              (const void *const *)&serialized_order->elts);
+      select_subtree(&first, &last, order, changes, paths,
+                     svn_fs_x__string_table_get_func, b->prefix, pool);
+    }
+
   /* Restrict range to the block requested by the BATON.
    * Tell the caller whether we reached the end of the list. */
+  list_last = last;
   first = MIN(first + b->start, last);
   last = MIN(first + SVN_FS_X__CHANGES_BLOCK_SIZE, last);
-  *b->eol = last == offsets[idx+1];
+  *b->eol = last == list_last;
 
   /* construct result */
   list = apr_array_make(pool, last - first, sizeof(svn_fs_x__change_t*));
 
   for (i = first; i < last; ++i)
     {
-      const binary_change_t *binary_change = &changes[i];
+      const binary_change_t *binary_change = &changes[order ? order[i] : i];
 
       /* convert BINARY_CHANGE into a standard FSX svn_fs_x__change_t */
       svn_fs_x__change_t *change = apr_pcalloc(pool, sizeof(*change));
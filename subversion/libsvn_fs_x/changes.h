@@ -34,6 +34,10 @@
  * of that redundancy and the run-time representation is also much smaller
  * than sum of the respective svn_fs_x__change_t* arrays.
  *
+ * For every change list, the container also stores a directory of its
+ * changes sorted by path.  That allows for retrieving only the changes
+ * at or below a given path without looking at all the others.
+ *
  * As with other containers, this one has two modes: 'construction', in
  * which you may add data to it, and 'getter' in which there is only r/o
  * access to the data.
@@ -72,8 +76,9 @@ svn_fs_x__changes_estimate_size(const svn_fs_x__changes_t *changes);
 /* Read changes containers. */
 
 /* From CHANGES, access the change list with the given IDX and extract the
- * next entries according to CONTEXT.  Allocate the result in RESULT_POOL
- * and return it in *LIST.
+ * next entries according to CONTEXT.  If CONTEXT has a path prefix set,
+ * only changes at or below that path will be returned, ordered by path.
+ * Allocate the result in RESULT_POOL and return it in *LIST.
  */
 svn_error_t *
 svn_fs_x__changes_get_list(apr_array_header_t **list,
@@ -127,6 +132,10 @@ typedef struct svn_fs_x__changes_get_list_baton_t
   /* Deliver data starting from this index within the changes list. */
   int start;
 
+  /* If not NULL, only deliver changes at or below this path.  START is
+     then relative to the first of those changes. */
+  const char *prefix;
+
   /* To be set by svn_fs_x__changes_get_list_func:
      Did we deliver the last change in that list? */
   svn_boolean_t *eol;
@@ -796,6 +796,23 @@ svn_fs_x__dag_get_contents(svn_stream_t **contents_p,
 }
 
 
+svn_error_t *
+svn_fs_x__dag_open_fulltext_file(apr_file_t **fulltext,
+                                 dag_node_t *file,
+                                 apr_pool_t *result_pool)
+{
+  /* Make sure our node is a file. */
+  if (file->node_revision->kind != svn_node_file)
+    return svn_error_createf
+      (SVN_ERR_FS_NOT_FILE, NULL,
+       "Attempted to get textual contents of a *non*-file node");
+
+  return svn_error_trace(svn_fs_x__open_large_file(fulltext, file->fs,
+                                          file->node_revision->data_rep,
+                                          result_pool));
+}
+
+
 svn_error_t *
 svn_fs_x__dag_get_file_delta_stream(svn_txdelta_stream_t **stream_p,
                                     dag_node_t *source,
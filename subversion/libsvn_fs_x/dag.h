@@ -362,6 +362,17 @@ svn_fs_x__dag_get_contents(svn_stream_t **contents,
                            dag_node_t *file,
                            apr_pool_t *result_pool);
 
+/* If the contents of FILE is stored out-of-line, set *FULLTEXT to that
+   file opened for reading.  Otherwise, set *FULLTEXT to NULL.
+   Allocate *FULLTEXT in RESULT_POOL.
+
+   If FILE is not a file, return SVN_ERR_FS_NOT_FILE.
+ */
+svn_error_t *
+svn_fs_x__dag_open_fulltext_file(apr_file_t **fulltext,
+                                 dag_node_t *file,
+                                 apr_pool_t *result_pool);
+
 /* Attempt to fetch the contents of NODE and pass it along with the BATON
    to the PROCESSOR.   Set *SUCCESS only of the data could be provided
    and the processor had been called.
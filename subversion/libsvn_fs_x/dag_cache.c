@@ -466,6 +466,81 @@ svn_fs_x__invalidate_dag_cache(svn_fs_root_t *root,
     }
 }
 
+/* 2nd level cache */
+
+/* Return the key for PATH in REVISION within the shared DAG path cache.
+   Allocate it in RESULT_POOL. */
+static const char *
+shared_cache_key(svn_revnum_t revision,
+                 const svn_string_t *path,
+                 apr_pool_t *result_pool)
+{
+  return svn_fs_x__combine_number_and_string(
+           revision,
+           apr_pstrmemdup(result_pool, path->data, path->len),
+           result_pool);
+}
+
+/* Look up the node for PATH in the committed revision ROOT using the DAG
+   path cache shared between all sessions.  If found, make it available in
+   the 1st level cache as well and return a reference to it in *NODE_P.
+   Otherwise, set *NODE_P to NULL.  Use SCRATCH_POOL for temporaries.
+
+   NOTE: *NODE_P will live within the DAG cache and we merely return a
+   reference to it.  Hence, it will invalid upon the next cache insertion.
+   Callers must create a copy if they want a non-temporary object.
+ */
+static svn_error_t *
+shared_cache_get(dag_node_t **node_p,
+                 svn_fs_root_t *root,
+                 const svn_string_t *path,
+                 apr_pool_t *scratch_pool)
+{
+  svn_fs_x__data_t *ffd = root->fs->fsap_data;
+  svn_fs_x__id_t *node_id;
+  svn_boolean_t found;
+  cache_entry_t *bucket;
+
+  SVN_ERR(svn_cache__get((void **)&node_id, &found, ffd->dag_path_cache,
+                         shared_cache_key(root->rev, path, scratch_pool),
+                         scratch_pool));
+  if (!found)
+    {
+      *node_p = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  auto_clear_dag_cache(ffd->dag_node_cache);
+  bucket = cache_lookup(ffd->dag_node_cache,
+                        svn_fs_x__change_set_by_rev(root->rev), path);
+  if (bucket->node == NULL)
+    SVN_ERR(svn_fs_x__dag_get_node(&bucket->node, root->fs, node_id,
+                                   ffd->dag_node_cache->pool,
+                                   scratch_pool));
+
+  *node_p = bucket->node;
+  return SVN_NO_ERROR;
+}
+
+/* Remember that PATH in the committed revision ROOT is NODE, for all
+   sessions to see.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+shared_cache_set(svn_fs_root_t *root,
+                 const svn_string_t *path,
+                 dag_node_t *node,
+                 apr_pool_t *scratch_pool)
+{
+  svn_fs_x__data_t *ffd = root->fs->fsap_data;
+
+  /* The serializer does not modify the ID. */
+  return svn_error_trace(svn_cache__set(
+           ffd->dag_path_cache,
+           shared_cache_key(root->rev, path, scratch_pool),
+           (svn_fs_x__id_t *)svn_fs_x__dag_get_id(node),
+           scratch_pool));
+}
+
+
 
 /* Traversing directory paths.  */
 
@@ -704,6 +779,18 @@ walk_dag_path(dag_node_t **node_p,
                                         change_set, FALSE, scratch_pool));
     }
 
+  /* Third attempt: Another session may have looked up the same path in
+     the same revision before.  Committed revisions never change, so we
+     can simply take its result. */
+  if (!root->is_txn_root)
+    {
+      SVN_ERR(shared_cache_get(node_p, root, path, scratch_pool));
+
+      /* Did the shortcut work? */
+      if (*node_p)
+          return SVN_NO_ERROR;
+    }
+
   /* Now there is something to iterate over. Thus, create the ITERPOOL. */
   iterpool = svn_pool_create(scratch_pool);
 
@@ -728,6 +815,10 @@ walk_dag_path(dag_node_t **node_p,
   svn_pool_destroy(iterpool);
   *node_p = here;
 
+  /* Let other sessions skip the directory walk. */
+  if (!root->is_txn_root)
+    SVN_ERR(shared_cache_set(root, path, here, scratch_pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -33,6 +33,7 @@
 #include "svn_version.h"
 #include "svn_pools.h"
 #include "batch_fsync.h"
+#include "job_queue.h"
 #include "fs.h"
 #include "fs_x.h"
 #include "pack.h"
@@ -292,6 +293,7 @@ static fs_vtable_t fs_vtable = {
   x_refresh_revprops,
   svn_fs_x__revision_prop,
   x_revision_proplist,
+  NULL /* revision_proplists */,
   svn_fs_x__change_rev_prop,
   x_set_uuid,
   svn_fs_x__revision_root,
@@ -666,6 +668,7 @@ svn_fs_x__init(const svn_version_t *loader_version,
   SVN_ERR(svn_ver_check_list2(x_version(), checklist, svn_ver_equal));
 
   SVN_ERR(svn_fs_x__batch_fsync_init(common_pool));
+  SVN_ERR(svn_fs_x__job_queue_init(common_pool));
 
   *vtable = &library_vtable;
   return SVN_NO_ERROR;
@@ -74,6 +74,8 @@ extern "C" {
                                                     to-phys index */
 #define PATH_EXT_P2L_INDEX    ".p2l"             /* extension of the phys-
                                                     to-log index */
+#define PATH_LARGE_FILES      "large"            /* Directory of out-of-line
+                                                    file contents */
 /* If you change this, look at tests/svn_test_fs.c(maybe_install_fsx_conf) */
 #define PATH_CONFIG           "fsx.conf"         /* Configuration */
 
@@ -111,6 +113,10 @@ extern "C" {
 #define CONFIG_OPTION_BLOCK_SIZE         "block-size"
 #define CONFIG_OPTION_L2P_PAGE_SIZE      "l2p-page-size"
 #define CONFIG_OPTION_P2L_PAGE_SIZE      "p2l-page-size"
+#define CONFIG_SECTION_LARGE_FILES       "large-files"
+#define CONFIG_OPTION_LARGE_FILE_THRESHOLD "threshold"
+#define CONFIG_SECTION_PACK              "pack"
+#define CONFIG_OPTION_PACK_THREADS       "threads"
 #define CONFIG_SECTION_DEBUG             "debug"
 #define CONFIG_OPTION_PACK_AFTER_COMMIT  "pack-after-commit"
 
@@ -290,6 +296,12 @@ typedef struct svn_fs_x__data_t
   /* Caches native dag_node_t* instances */
   svn_fs_x__dag_cache_t *dag_node_cache;
 
+  /* Node IDs found at a given path in a committed revision.  Maps from
+     the revision number combined with the normalized path to
+     svn_fs_x__id_t.  Shared between all svn_fs_t instances for the same
+     repository. */
+  svn_cache__t *dag_path_cache;
+
   /* A cache of the contents of immutable directories; maps from
      unparsed FS ID to a apr_hash_t * mapping (const char *) dirent
      names to (svn_fs_x__dirent_t *). */
@@ -397,6 +409,14 @@ typedef struct svn_fs_x__data_t
   /* Pack after every commit. */
   svn_boolean_t pack_after_commit;
 
+  /* File contents of at least this many bytes will be stored out-of-line
+   * in the large file store.  0 disables the feature. */
+  apr_int64_t large_file_threshold;
+
+  /* Maximum number of containers that pack may build and compress
+   * concurrently.  1 means "do everything in the calling thread". */
+  int pack_threads;
+
   /* Per-instance filesystem ID, which provides an additional level of
      uniqueness for filesystems that share the same UUID, but should
      still be distinguishable (e.g. backups produced by svn_fs_hotcopy()
@@ -554,6 +574,11 @@ typedef struct svn_fs_x__changes_context_t
   /* Has the end of the list been reached? */
   svn_boolean_t eol;
 
+  /* If not NULL, only report changes at or below this canonical fspath.
+     For packed revisions, NEXT then indexes the list of matching changes
+     only; otherwise, it still refers to the full list. */
+  const char *prefix;
+
 } svn_fs_x__changes_context_t;
 
 /*** Directory (only used at the cache interface) ***/
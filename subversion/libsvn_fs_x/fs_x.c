@@ -262,6 +262,7 @@ read_config(svn_fs_x__data_t *ffd,
 {
   svn_config_t *config;
   apr_int64_t compression_level;
+  apr_int64_t pack_threads;
 
   SVN_ERR(svn_config_read3(&config,
                            svn_dirent_join(fs_path, PATH_CONFIG, scratch_pool),
@@ -332,6 +333,24 @@ read_config(svn_fs_x__data_t *ffd,
   ffd->p2l_page_size *= 0x400;
   /* L2P pages are in entries - not in (k)Bytes */
 
+  /* Out-of-line storage of large files.  The threshold is in kBytes. */
+  SVN_ERR(svn_config_get_int64(config, &ffd->large_file_threshold,
+                               CONFIG_SECTION_LARGE_FILES,
+                               CONFIG_OPTION_LARGE_FILE_THRESHOLD,
+                               0));
+  if (   ffd->large_file_threshold <= 0
+      || ffd->large_file_threshold > SVN_MAX_OBJECT_SIZE / 0x400)
+    ffd->large_file_threshold = 0;
+  else
+    ffd->large_file_threshold *= 0x400;
+
+  /* Pack concurrency. */
+  SVN_ERR(svn_config_get_int64(config, &pack_threads,
+                               CONFIG_SECTION_PACK,
+                               CONFIG_OPTION_PACK_THREADS,
+                               4));
+  ffd->pack_threads = (int)MAX(1, MIN(pack_threads, 64));
+
   /* Debug options. */
   SVN_ERR(svn_config_get_bool(config, &ffd->pack_after_commit,
                               CONFIG_SECTION_DEBUG,
@@ -528,6 +547,29 @@ write_config(svn_fs_t *fs,
 "### Must be a power of 2."                                                  NL
 "### p2l-page-size is given in kBytes and with a default of 1024 kBytes."    NL
 "# " CONFIG_OPTION_P2L_PAGE_SIZE " = 1024"                                   NL
+""                                                                           NL
+"[" CONFIG_SECTION_LARGE_FILES "]"                                           NL
+"### Files may be stored out-of-line, i.e. as plain fulltext files in the"   NL
+"### 'large' folder of the repository instead of as (deltified) data in"     NL
+"### the revision files.  This is useful for large incompressible binaries"  NL
+"### that would otherwise dilute the pack files and thrash the caches."      NL
+"### Out-of-line files are shared by their SHA1 checksum, never used as"     NL
+"### delta bases and may be sent to clients by the server without copying"   NL
+"### them through user space.  This setting controls the minimum file size"  NL
+"### in kBytes for new file contents to be stored out-of-line.  Up to that"  NL
+"### many bytes of each file being committed will be buffered, most of them" NL
+"### in a temporary file."                                                   NL
+"### A value of 0 disables the feature, which is the default."               NL
+"# " CONFIG_OPTION_LARGE_FILE_THRESHOLD " = 0"                               NL
+""                                                                           NL
+"[" CONFIG_SECTION_PACK "]"                                                  NL
+"### Packing aggregates change lists and properties into containers."        NL
+"### These get built and compressed in the background while the pack file"   NL
+"### is being written.  This setting controls how many containers may be"    NL
+"### processed at the same time.  Higher values speed up packing on multi-"  NL
+"### core machines at the expense of some additional memory.  A value of 1"  NL
+"### disables concurrent processing.  The default is 4."                     NL
+"# " CONFIG_OPTION_PACK_THREADS " = 4"                                       NL
 ;
 #undef NL
   return svn_io_file_create(svn_dirent_join(fs->path, PATH_CONFIG,
@@ -957,6 +999,9 @@ write_revision_zero(svn_fs_t *fs,
                                               scratch_pool));
   SVN_ERR(svn_io_file_close(apr_file, scratch_pool));
 
+  /* Start the date index. */
+  SVN_ERR(svn_fs__date_index_append(fs->path, 0, &date, scratch_pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -1221,9 +1266,15 @@ change_rev_prop_body(void *baton,
     return SVN_NO_ERROR;
 
   svn_hash_sets(table, cb->name, cb->value);
+  SVN_ERR(svn_fs_x__set_revision_proplist(cb->fs, cb->rev, table,
+                                          scratch_pool));
+
+  /* Keep the date index, if there is one, up to date. */
+  if (strcmp(cb->name, SVN_PROP_REVISION_DATE) == 0)
+    SVN_ERR(svn_fs__date_index_set(cb->fs->path, cb->rev, cb->value,
+                                   scratch_pool));
 
-  return svn_fs_x__set_revision_proplist(cb->fs, cb->rev, table,
-                                         scratch_pool);
+  return SVN_NO_ERROR;
 }
 
 svn_error_t *
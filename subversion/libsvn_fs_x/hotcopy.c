@@ -22,6 +22,7 @@
 #include "svn_pools.h"
 #include "svn_path.h"
 #include "svn_dirent_uri.h"
+#include "private/svn_fs_util.h"
 
 #include "fs_x.h"
 #include "hotcopy.h"
@@ -624,6 +625,17 @@ hotcopy_body(void *baton,
   if (cancel_func)
     SVN_ERR(cancel_func(cancel_baton));
 
+  /* Out-of-line contents must be in place before any revision referring
+   * to it becomes visible in the destination.  Its files are immutable,
+   * so copying only what is missing in the destination suffices. */
+  src_subdir = svn_fs_x__path_large_files_dir(src_fs, scratch_pool);
+  SVN_ERR(svn_io_check_path(src_subdir, &kind, scratch_pool));
+  if (kind == svn_node_dir)
+    SVN_ERR(hotcopy_io_copy_dir_recursively(NULL, src_subdir, dst_fs->path,
+                                            PATH_LARGE_FILES, TRUE,
+                                            cancel_func, cancel_baton,
+                                            scratch_pool));
+
   /* Split the logic for new and old FS formats. The latter is much simpler
    * due to the absense of sharding and packing. However, it requires special
    * care when updating the 'current' file (which contains not just the
@@ -649,6 +661,14 @@ hotcopy_body(void *baton,
                                         cancel_func, cancel_baton,
                                         scratch_pool));
 
+  /* The date index of the destination must match its revprops. */
+  SVN_ERR(svn_fs__date_index_copy(src_fs->path, dst_fs->path, src_youngest,
+                                  scratch_pool));
+
+  /* Commits to the destination will keep its path index up to date. */
+  SVN_ERR(svn_fs__path_index_copy(src_fs->path, dst_fs->path, src_youngest,
+                                  scratch_pool));
+
   /*
    * NB: Data copied below is only read by writers, not readers.
    *     Writers are still locked out at this point.
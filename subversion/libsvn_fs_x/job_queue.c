@@ -0,0 +1,357 @@
+/* job_queue.c --- run CPU-bound jobs concurrently, collect results in order
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_thread_pool.h>
+#include <apr_thread_cond.h>
+
+#include "job_queue.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
+#include "svn_private_config.h"
+
+#include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
+
+/* Handy macro to check APR function results and turning them into
+ * svn_error_t upon failure. */
+#define WRAP_APR_ERR(x,msg)                     \
+  {                                             \
+    apr_status_t status_ = (x);                 \
+    if (status_)                                \
+      return svn_error_wrap_apr(status_, msg);  \
+  }
+
+/* A single entry in the queue.  It gets allocated in its own POOL.
+ */
+typedef struct job_t
+{
+  /* Function to call and its parameters. */
+  svn_fs_x__job_func_t func;
+  void *baton;
+  apr_pool_t *pool;
+
+  /* Return value of FUNC.  Only valid if DONE is set. */
+  svn_error_t *result;
+
+  /* Set after FUNC returned.  Protected by the queue's mutex. */
+  svn_boolean_t done;
+
+  /* The queue that this job belongs to. */
+  svn_fs_x__job_queue_t *queue;
+} job_t;
+
+/* The actual queue object. */
+struct svn_fs_x__job_queue_t
+{
+  /* Ring buffer of MAX_JOBS job_t *. */
+  job_t **jobs;
+  int max_jobs;
+
+  /* Index of the oldest job in JOBS and number of jobs in the queue. */
+  int first;
+  int count;
+
+  /* Synchronization between the worker threads and the consumer. */
+  svn_mutex__t *mutex;
+#if APR_HAS_THREADS
+  apr_thread_cond_t *cond;
+#endif
+};
+
+/* Data structures for concurrent job execution are only available if
+ * we have threading support.
+ */
+#if APR_HAS_THREADS
+
+/* Number of microseconds that an unused thread remains in the pool before
+ * being terminated.
+ */
+#define THREADPOOL_THREAD_IDLE_LIMIT 1000000
+
+/* Maximum number of threads in THREAD_POOL, i.e. number of jobs we can
+ * process concurrently throughout the process. */
+#define MAX_THREADS 16
+
+/* Thread pool to execute the jobs. */
+static apr_thread_pool_t *thread_pool = NULL;
+
+#endif
+
+/* Keep track on whether we already created the THREAD_POOL . */
+static svn_atomic_t thread_pool_initialized = FALSE;
+
+#if APR_HAS_THREADS
+
+/* Destructor function that implicitly cleans up any running threads
+   in the THREAD_POOL *once*.
+
+   Must be run as a pre-cleanup hook.
+ */
+static apr_status_t
+thread_pool_pre_cleanup(void *data)
+{
+  apr_thread_pool_t *tp = thread_pool;
+  if (!thread_pool)
+    return APR_SUCCESS;
+
+  thread_pool = NULL;
+  thread_pool_initialized = FALSE;
+
+  return apr_thread_pool_destroy(tp);
+}
+
+#endif
+
+/* Core implementation of svn_fs_x__job_queue_init. */
+static svn_error_t *
+create_thread_pool(void *baton,
+                   apr_pool_t *owning_pool)
+{
+#if APR_HAS_THREADS
+  /* The thread-pool must be allocated from a thread-safe pool.
+     GLOBAL_POOL may be single-threaded, though. */
+  apr_pool_t *pool = svn_pool_create(NULL);
+
+  WRAP_APR_ERR(apr_thread_pool_create(&thread_pool, 0, MAX_THREADS, pool),
+               _("Can't create job thread pool in FSX"));
+
+  /* See svn_fs_x__batch_fsync_init for why we need a pre-cleanup hook. */
+  apr_pool_pre_cleanup_register(pool, NULL, thread_pool_pre_cleanup);
+  apr_pool_pre_cleanup_register(owning_pool, NULL, thread_pool_pre_cleanup);
+
+  /* let idle threads linger for a while in case more jobs are coming in */
+  apr_thread_pool_idle_wait_set(thread_pool, THREADPOOL_THREAD_IDLE_LIMIT);
+
+  /* don't queue requests unless we reached the worker thread limit */
+  apr_thread_pool_threshold_set(thread_pool, 0);
+
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_x__job_queue_init(apr_pool_t *owning_pool)
+{
+  /* Protect against multiple calls. */
+  return svn_error_trace(svn_atomic__init_once(&thread_pool_initialized,
+                                               create_thread_pool,
+                                               NULL, owning_pool));
+}
+
+/* Wait until JOB in QUEUE has been processed. */
+static svn_error_t *
+wait_for_job(svn_fs_x__job_queue_t *queue,
+             job_t *job)
+{
+  svn_boolean_t done = FALSE;
+
+  /* This loop implicitly handles spurious wake-ups. */
+  do
+    {
+      SVN_ERR(svn_mutex__lock(queue->mutex));
+
+      if (job->done)
+        done = TRUE;
+#if APR_HAS_THREADS
+      else
+        WRAP_APR_ERR(apr_thread_cond_wait(queue->cond,
+                                          svn_mutex__get(queue->mutex)),
+                     _("Can't wait for condition variable"));
+#endif
+
+      SVN_ERR(svn_mutex__unlock(queue->mutex, SVN_NO_ERROR));
+    }
+  while (!done);
+
+  return SVN_NO_ERROR;
+}
+
+/* Destructor for svn_fs_x__job_queue_t.  Waits for all jobs still being
+ * processed and releases all their memory. */
+static apr_status_t
+job_queue_cleanup(void *data)
+{
+  svn_fs_x__job_queue_t *queue = data;
+
+  while (queue->count)
+    {
+      job_t *job = queue->jobs[queue->first];
+
+      svn_error_clear(wait_for_job(queue, job));
+      svn_error_clear(job->result);
+      svn_pool_destroy(job->pool);
+
+      queue->first = (queue->first + 1) % queue->max_jobs;
+      queue->count--;
+    }
+
+  return APR_SUCCESS;
+}
+
+svn_error_t *
+svn_fs_x__job_queue_create(svn_fs_x__job_queue_t **queue_p,
+                           int max_jobs,
+                           apr_pool_t *result_pool)
+{
+  svn_fs_x__job_queue_t *queue = apr_pcalloc(result_pool, sizeof(*queue));
+
+  queue->max_jobs = MAX(max_jobs, 1);
+  queue->jobs = apr_pcalloc(result_pool,
+                            queue->max_jobs * sizeof(*queue->jobs));
+
+  SVN_ERR(svn_mutex__init(&queue->mutex, TRUE, result_pool));
+#if APR_HAS_THREADS
+  WRAP_APR_ERR(apr_thread_cond_create(&queue->cond, result_pool),
+               _("Can't create condition variable"));
+#endif
+
+  /* Registered last, so this runs before the synchronization objects
+   * get destroyed. */
+  apr_pool_cleanup_register(result_pool, queue, job_queue_cleanup,
+                            apr_pool_cleanup_null);
+
+  *queue_p = queue;
+
+  return SVN_NO_ERROR;
+}
+
+apr_pool_t *
+svn_fs_x__job_queue_make_pool(svn_fs_x__job_queue_t *queue)
+{
+  /* To be used in a separate thread, the job's pool must be thread-safe.
+   * Allocating a sub-pool from the standard memory pool achieves exactly
+   * that. */
+  return svn_pool_create(NULL);
+}
+
+svn_boolean_t
+svn_fs_x__job_queue_is_full(svn_fs_x__job_queue_t *queue)
+{
+  return queue->count == queue->max_jobs;
+}
+
+svn_boolean_t
+svn_fs_x__job_queue_is_empty(svn_fs_x__job_queue_t *queue)
+{
+  return queue->count == 0;
+}
+
+#if APR_HAS_THREADS
+
+/* Thread-pool task:  Process the job_t instance given by DATA. */
+static void * APR_THREAD_FUNC
+job_task(apr_thread_t *tid,
+         void *data)
+{
+  job_t *job = data;
+  svn_fs_x__job_queue_t *queue = job->queue;
+  svn_error_t *result = job->func(job->baton, job->pool);
+
+  /* Publish the result under the mutex, so the consumer will see all
+   * the data that FUNC produced.  As soon as we release the mutex, JOB
+   * may be gone.  If locking fails, the consumer will probably deadlock
+   * anyway, thus there is no point in trying to report the problem. */
+  svn_error_clear(svn_mutex__lock(queue->mutex));
+  job->result = result;
+  job->done = TRUE;
+  apr_thread_cond_broadcast(queue->cond);
+  svn_error_clear(svn_mutex__unlock(queue->mutex, SVN_NO_ERROR));
+
+  return NULL;
+}
+
+#endif
+
+svn_error_t *
+svn_fs_x__job_queue_push(svn_fs_x__job_queue_t *queue,
+                         svn_fs_x__job_func_t func,
+                         void *baton,
+                         apr_pool_t *job_pool)
+{
+  job_t *job;
+  SVN_ERR_ASSERT(queue->count < queue->max_jobs);
+
+  job = apr_pcalloc(job_pool, sizeof(*job));
+  job->func = func;
+  job->baton = baton;
+  job->pool = job_pool;
+  job->result = SVN_NO_ERROR;
+  job->done = FALSE;
+  job->queue = queue;
+
+  queue->jobs[(queue->first + queue->count) % queue->max_jobs] = job;
+  queue->count++;
+
+#if APR_HAS_THREADS
+
+  /* Forgot to call _init() or cleaned up the owning pool too early?
+   */
+  SVN_ERR_ASSERT(thread_pool);
+
+  /* With a queue length of 1, there is nothing to run in parallel.
+   * Skip the thread-pool and synchronization overhead. */
+  if (queue->max_jobs > 1)
+    {
+      apr_status_t status = apr_thread_pool_push(thread_pool, job_task, job,
+                                                 0, queue);
+      if (status == APR_SUCCESS)
+        return SVN_NO_ERROR;
+
+      /* Fall back to processing the job right here. */
+    }
+
+#endif
+
+  job->result = func(baton, job_pool);
+  job->done = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_x__job_queue_pop(void **baton,
+                        apr_pool_t **job_pool,
+                        svn_fs_x__job_queue_t *queue)
+{
+  job_t *job;
+  SVN_ERR_ASSERT(queue->count > 0);
+
+  job = queue->jobs[queue->first];
+  SVN_ERR(wait_for_job(queue, job));
+
+  queue->first = (queue->first + 1) % queue->max_jobs;
+  queue->count--;
+
+  if (job->result)
+    {
+      svn_error_t *err = job->result;
+      svn_pool_destroy(job->pool);
+
+      return svn_error_trace(err);
+    }
+
+  *baton = job->baton;
+  *job_pool = job->pool;
+
+  return SVN_NO_ERROR;
+}
@@ -0,0 +1,112 @@
+/* job_queue.h --- run CPU-bound jobs concurrently, collect results in order
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS_X__JOB_QUEUE_H
+#define SVN_LIBSVN_FS_X__JOB_QUEUE_H
+
+#include "svn_error.h"
+
+/* Infrastructure for pipelining work between a single producer / consumer
+ * thread and a number of worker threads.
+ *
+ * The producer creates a job with its own pool, fills in all the data
+ * that the job needs and pushes it into the queue.  Some worker thread
+ * will then process it.  The consumer pops jobs strictly in the order they
+ * were pushed, waiting for them to complete if necessary.
+ *
+ * Jobs must not access any shared state, in particular no svn_fs_t, and
+ * should only allocate from the pool given to them.
+ *
+ * The number of jobs in the queue is limited, which bounds the amount of
+ * memory held by unfinished and unconsumed jobs.  Without threading
+ * support, jobs get processed immediately while being pushed.
+ */
+
+/* Opaque queue type.
+ */
+typedef struct svn_fs_x__job_queue_t svn_fs_x__job_queue_t;
+
+/* Callback type for the actual work to do for a job.  BATON is the job's
+ * data and POOL is the job's pool as passed to svn_fs_x__job_queue_push.
+ */
+typedef svn_error_t *(*svn_fs_x__job_func_t)(void *baton,
+                                             apr_pool_t *pool);
+
+/* Initialize the concurrent job execution infrastructure.  Clean it up
+ * when OWNING_POOL gets cleared.
+ *
+ * This function must be called before using any of the other functions in
+ * in this module.  It should only be called once.
+ */
+svn_error_t *
+svn_fs_x__job_queue_init(apr_pool_t *owning_pool);
+
+/* Set *QUEUE_P to a new queue, allocated in RESULT_POOL, that holds up to
+ * MAX_JOBS jobs at any time.  If MAX_JOBS is less than 2, all jobs will be
+ * run directly by svn_fs_x__job_queue_push.
+ *
+ * Clearing RESULT_POOL waits for all outstanding jobs and releases their
+ * pools.
+ */
+svn_error_t *
+svn_fs_x__job_queue_create(svn_fs_x__job_queue_t **queue_p,
+                           int max_jobs,
+                           apr_pool_t *result_pool);
+
+/* Return a new pool that may be used for a job in QUEUE.  Unless it gets
+ * handed over to svn_fs_x__job_queue_push, the caller must destroy it.
+ */
+apr_pool_t *
+svn_fs_x__job_queue_make_pool(svn_fs_x__job_queue_t *queue);
+
+/* Return TRUE, if there is no more room in QUEUE.  Then, the oldest job
+ * must be popped before the next one can be pushed. */
+svn_boolean_t
+svn_fs_x__job_queue_is_full(svn_fs_x__job_queue_t *queue);
+
+/* Return TRUE, if QUEUE contains no jobs. */
+svn_boolean_t
+svn_fs_x__job_queue_is_empty(svn_fs_x__job_queue_t *queue);
+
+/* Append a new job to QUEUE that shall call FUNC with BATON and JOB_POOL.
+ * JOB_POOL must have been created by svn_fs_x__job_queue_make_pool and
+ * QUEUE takes ownership of it.  QUEUE must not be full.
+ */
+svn_error_t *
+svn_fs_x__job_queue_push(svn_fs_x__job_queue_t *queue,
+                         svn_fs_x__job_func_t func,
+                         void *baton,
+                         apr_pool_t *job_pool);
+
+/* Wait for the oldest job in QUEUE to complete and remove it from QUEUE.
+ * Set *BATON and *JOB_POOL to the values given when it was pushed.
+ * The caller takes ownership of *JOB_POOL and must destroy it.
+ *
+ * If the job returned an error, destroy its pool and return that error.
+ * QUEUE must not be empty.
+ */
+svn_error_t *
+svn_fs_x__job_queue_pop(void **baton,
+                        apr_pool_t **job_pool,
+                        svn_fs_x__job_queue_t *queue);
+
+#endif
@@ -63,6 +63,7 @@
 
 /* Kinds of representation. */
 #define REP_DELTA          "DELTA"
+#define REP_LARGE          "LARGE"
 
 /* An arbitrary maximum path length, so clients can't run us out of memory
  * by giving us arbitrarily large paths. */
@@ -751,6 +752,13 @@ svn_fs_x__read_rep_header(svn_fs_x__rep_header_t **header,
       return SVN_NO_ERROR;
     }
 
+  if (strcmp(buffer->data, REP_LARGE) == 0)
+    {
+      /* The contents is stored out-of-line. */
+      (*header)->type = svn_fs_x__rep_large;
+      return SVN_NO_ERROR;
+    }
+
   (*header)->type = svn_fs_x__rep_delta;
 
   /* We have hopefully a DELTA vs. a non-empty base revision. */
@@ -793,6 +801,10 @@ svn_fs_x__write_rep_header(svn_fs_x__rep_header_t *header,
         text = REP_DELTA "\n";
         break;
 
+      case svn_fs_x__rep_large:
+        text = REP_LARGE "\n";
+        break;
+
       default:
         text = apr_psprintf(scratch_pool, REP_DELTA " %ld %" APR_OFF_T_FMT
                                           " %" SVN_FILESIZE_T_FMT "\n",
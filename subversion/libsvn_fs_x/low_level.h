@@ -125,7 +125,10 @@ typedef enum svn_fs_x__rep_type_t
   svn_fs_x__rep_delta,
 
   /* this is a representation in a star-delta container */
-  svn_fs_x__rep_container
+  svn_fs_x__rep_container,
+
+  /* the contents is stored as a plain file in the large file store */
+  svn_fs_x__rep_large
 } svn_fs_x__rep_type_t;
 
 /* This structure is used to hold the information stored in a representation
@@ -22,6 +22,8 @@
 
 #include "svn_private_config.h"
 
+#include "svn_sorts.h"
+
 #include "private/svn_dep_compat.h"
 #include "private/svn_packed_data.h"
 #include "private/svn_subr_private.h"
@@ -49,6 +51,15 @@
 /* the noderev has copy-root path and revision */
 #define NODEREV_HAS_CPATH    0x00040
 
+/* Number of integer sub-streams per representation resp. noderev, i.e.
+ * the number of values that make up a single "row" when reading them. */
+#define REP_FIELD_COUNT      5
+#define NODEREV_FIELD_COUNT 14
+
+/* Number of reps, ids or noderevs to bulk-decode at once when reading
+ * the container. */
+#define READ_BATCH_SIZE     16
+
 /* Our internal representation of a svn_fs_x__noderev_t.
  *
  * We will store path strings in a string container and reference them
@@ -598,16 +609,29 @@ read_reps(apr_array_header_t **reps_p,
     = apr_array_make(result_pool, (int)count,
                      sizeof(svn_fs_x__representation_t));
 
+  apr_uint64_t values[READ_BATCH_SIZE * REP_FIELD_COUNT];
+  const apr_uint64_t *row = values;
+
   for (i = 0; i < count; ++i)
     {
       svn_fs_x__representation_t rep;
 
-      rep.has_sha1 = (svn_boolean_t)svn_packed__get_uint(rep_stream);
+      /* bulk-decode the next couple of reps */
+      if (i % READ_BATCH_SIZE == 0)
+        {
+          svn_packed__get_uints(rep_stream, values,
+                                MIN(count - i, READ_BATCH_SIZE)
+                                  * REP_FIELD_COUNT);
+          row = values;
+        }
 
-      rep.id.change_set = (svn_revnum_t)svn_packed__get_uint(rep_stream);
-      rep.id.number = svn_packed__get_uint(rep_stream);
-      rep.size = svn_packed__get_uint(rep_stream);
-      rep.expanded_size = svn_packed__get_uint(rep_stream);
+      rep.has_sha1 = (svn_boolean_t)row[0];
+
+      rep.id.change_set = (svn_revnum_t)row[1];
+      rep.id.number = row[2];
+      rep.size = row[3];
+      rep.expanded_size = row[4];
+      row += REP_FIELD_COUNT;
 
       /* when extracting the checksums, beware of buffer under/overflows
          caused by disk data corruption. */
@@ -679,14 +703,22 @@ svn_fs_x__read_noderevs_container(svn_fs_x__noderevs_t **container,
     = svn_packed__int_count(svn_packed__first_int_substream(ids_stream));
   noderevs->ids
     = apr_array_make(result_pool, (int)count, sizeof(svn_fs_x__id_t));
-  for (i = 0; i < count; ++i)
+  for (i = 0; i < count; i += READ_BATCH_SIZE)
     {
-      svn_fs_x__id_t id;
+      apr_uint64_t values[READ_BATCH_SIZE * 2];
+      apr_size_t batch = MIN(count - i, READ_BATCH_SIZE);
+      apr_size_t k;
 
-      id.change_set = (svn_revnum_t)svn_packed__get_int(ids_stream);
-      id.number = svn_packed__get_uint(ids_stream);
+      svn_packed__get_uints(ids_stream, values, batch * 2);
+      for (k = 0; k < batch; ++k)
+        {
+          svn_fs_x__id_t id;
+
+          id.change_set = (svn_revnum_t)(apr_int64_t)values[2 * k];
+          id.number = values[2 * k + 1];
 
-      APR_ARRAY_PUSH(noderevs->ids, svn_fs_x__id_t) = id;
+          APR_ARRAY_PUSH(noderevs->ids, svn_fs_x__id_t) = id;
+        }
     }
 
   /* read rep arrays */
@@ -698,30 +730,40 @@ svn_fs_x__read_noderevs_container(svn_fs_x__noderevs_t **container,
     = svn_packed__int_count(svn_packed__first_int_substream(noderevs_stream));
   noderevs->noderevs
     = apr_array_make(result_pool, (int)count, sizeof(binary_noderev_t));
-  for (i = 0; i < count; ++i)
+  for (i = 0; i < count; i += READ_BATCH_SIZE)
     {
-      binary_noderev_t noderev;
+      apr_uint64_t values[READ_BATCH_SIZE * NODEREV_FIELD_COUNT];
+      apr_size_t batch = MIN(count - i, READ_BATCH_SIZE);
+      apr_size_t k;
 
-      noderev.flags = (apr_uint32_t)svn_packed__get_uint(noderevs_stream);
+      svn_packed__get_uints(noderevs_stream, values,
+                            batch * NODEREV_FIELD_COUNT);
+      for (k = 0; k < batch; ++k)
+        {
+          const apr_uint64_t *row = values + k * NODEREV_FIELD_COUNT;
+          binary_noderev_t noderev;
+
+          noderev.flags = (apr_uint32_t)row[0];
 
-      noderev.id = (int)svn_packed__get_uint(noderevs_stream);
-      noderev.node_id = (int)svn_packed__get_uint(noderevs_stream);
-      noderev.copy_id = (int)svn_packed__get_uint(noderevs_stream);
-      noderev.predecessor_id = (int)svn_packed__get_uint(noderevs_stream);
-      noderev.predecessor_count = (int)svn_packed__get_uint(noderevs_stream);
+          noderev.id = (int)row[1];
+          noderev.node_id = (int)row[2];
+          noderev.copy_id = (int)row[3];
+          noderev.predecessor_id = (int)row[4];
+          noderev.predecessor_count = (int)row[5];
 
-      noderev.copyfrom_path = (apr_size_t)svn_packed__get_uint(noderevs_stream);
-      noderev.copyfrom_rev = (svn_revnum_t)svn_packed__get_int(noderevs_stream);
-      noderev.copyroot_path = (apr_size_t)svn_packed__get_uint(noderevs_stream);
-      noderev.copyroot_rev = (svn_revnum_t)svn_packed__get_int(noderevs_stream);
+          noderev.copyfrom_path = (apr_size_t)row[6];
+          noderev.copyfrom_rev = (svn_revnum_t)(apr_int64_t)row[7];
+          noderev.copyroot_path = (apr_size_t)row[8];
+          noderev.copyroot_rev = (svn_revnum_t)(apr_int64_t)row[9];
 
-      noderev.prop_rep = (int)svn_packed__get_uint(noderevs_stream);
-      noderev.data_rep = (int)svn_packed__get_uint(noderevs_stream);
+          noderev.prop_rep = (int)row[10];
+          noderev.data_rep = (int)row[11];
 
-      noderev.created_path = (apr_size_t)svn_packed__get_uint(noderevs_stream);
-      noderev.mergeinfo_count = svn_packed__get_uint(noderevs_stream);
+          noderev.created_path = (apr_size_t)row[12];
+          noderev.mergeinfo_count = row[13];
 
-      APR_ARRAY_PUSH(noderevs->noderevs, binary_noderev_t) = noderev;
+          APR_ARRAY_PUSH(noderevs->noderevs, binary_noderev_t) = noderev;
+        }
     }
 
   *container = noderevs;
@@ -40,6 +40,7 @@
 #include "changes.h"
 #include "noderevs.h"
 #include "reps.h"
+#include "job_queue.h"
 
 #include "../libsvn_fs/fs-loader.h"
 
@@ -80,7 +81,12 @@
  * - same for file representations
  *
  * Step 4 copies the items from the temporary buckets into the final
- * pack file and writes the temporary index files.
+ * pack file and writes the temporary index files.  Building and
+ * compressing containers is CPU-intensive.  Therefore, containers get
+ * built in a pipeline:  The items are read sequentially, worker threads
+ * build and serialize the containers and the results get appended to the
+ * pack file in their original order.  The result does not depend on the
+ * number of workers.
  *
  * Finally, after the last range of revisions, create the final indexes.
  */
@@ -109,6 +115,9 @@ typedef struct path_order_t
   /* length of the expanded representation content */
   apr_int64_t expanded_size;
 
+  /* the representation content is stored out-of-line */
+  svn_boolean_t is_large;
+
   /* item ID of the noderev linked to the change. May be (0, 0). */
   svn_fs_x__id_t noderev_id;
 
@@ -228,6 +237,10 @@ typedef struct pack_context_t
   /* pool used for temporary data structures that will be cleaned up when
    * the next range of revisions is being processed */
   apr_pool_t *info_pool;
+
+  /* builds and serializes containers concurrently.  It is always empty
+   * between calls to write_containers. */
+  svn_fs_x__job_queue_t *jobs;
 } pack_context_t;
 
 /* Create and initialize a new pack context for packing shard SHARD_REV in
@@ -320,6 +333,9 @@ initialize_pack_context(pack_context_t *context,
   context->info_pool = svn_pool_create(pool);
   context->paths = svn_prefix_tree__create(context->info_pool);
 
+  SVN_ERR(svn_fs_x__job_queue_create(&context->jobs, ffd->pack_threads,
+                                     pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -726,6 +742,7 @@ copy_node_to_temp(pack_context_t *context,
 
       path_order->rep_id = reference->to;
       path_order->expanded_size = noderev->data_rep->expanded_size;
+      path_order->is_large = svn_fs_x__is_large_rep(noderev->data_rep);
     }
 
   /* Sort path is the key used for ordering noderevs and associated reps.
@@ -829,6 +846,17 @@ get_block_left(pack_context_t *context)
   return ffd->block_size - (context->pack_offset % ffd->block_size);
 }
 
+/* Return the maximum number of bytes "wasted" per block in CONTEXT's
+ * pack file to prevent items from crossing block boundaries.  Larger items
+ * will cross the block boundaries.
+ */
+static apr_off_t
+get_max_padding(pack_context_t *context)
+{
+  svn_fs_x__data_t *ffd = context->fs->fsap_data;
+  return MAX(ffd->block_size / 50, 512);
+}
+
 /* To prevent items from overlapping a block boundary, we will usually
  * put them into the next block and top up the old one with NUL bytes.
  * Pad CONTEXT's pack file to the end of the current block, if that padding
@@ -838,11 +866,7 @@ static svn_error_t *
 auto_pad_block(pack_context_t *context,
                apr_pool_t *scratch_pool)
 {
-  svn_fs_x__data_t *ffd = context->fs->fsap_data;
-
-  /* This is the maximum number of bytes "wasted" that way per block.
-   * Larger items will cross the block boundaries. */
-  const apr_off_t max_padding = MAX(ffd->block_size / 50, 512);
+  const apr_off_t max_padding = get_max_padding(context);
 
   /* Is wasted space small enough to align the current item to the next
    * block? */
@@ -988,7 +1012,7 @@ select_reps(pack_context_t *context,
 }
 
 /* Return TRUE, if all path_order_t * in SELECTED reference contents that is
- * not longer than LIMIT.
+ * not longer than LIMIT and not stored out-of-line.
  */
 static svn_boolean_t
 reps_fit_into_containers(apr_array_header_t *selected,
@@ -996,8 +1020,11 @@ reps_fit_into_containers(apr_array_header_t *selected,
 {
   int i;
   for (i = 0; i < selected->nelts; ++i)
-    if (APR_ARRAY_IDX(selected, i, path_order_t *)->expanded_size > limit)
-      return FALSE;
+    {
+      path_order_t *path_order = APR_ARRAY_IDX(selected, i, path_order_t *);
+      if (path_order->is_large || path_order->expanded_size > limit)
+        return FALSE;
+    }
 
   return TRUE;
 }
@@ -1164,38 +1191,267 @@ store_nodes(pack_context_t *context,
 }
 
 
-/* Finalize CONTAINER and write it to CONTEXT's pack file.
- * Append an P2L entry containing the given SUB_ITEMS to NEW_ENTRIES.
+/* Input and output of a job building a single container.  Instances get
+ * allocated in the job's pool.
+ */
+typedef struct container_job_t
+{
+  /* Either SVN_FS_X__ITEM_TYPE_CHANGES_CONT or
+   * SVN_FS_X__ITEM_TYPE_REPS_CONT. */
+  apr_uint32_t type;
+
+  /* The file system, only to be stored in the reps container builder. */
+  svn_fs_t *fs;
+
+  /* svn_string_t *, in container order.  Serialized change lists or
+   * representation fulltexts, depending on TYPE. */
+  apr_array_header_t *items;
+
+  /* svn_fs_x__id_t, the IDs of the elements in ITEMS. */
+  apr_array_header_t *sub_items;
+
+  /* The serialized container.  Set by build_container. */
+  svn_stringbuf_t *serialized;
+} container_job_t;
+
+/* Implements svn_fs_x__job_func_t.  Build the container described by the
+ * container_job_t BATON and serialize it.  Allocate everything in POOL.
+ *
+ * This is where the CPU-intensive work happens:  parsing, matching
+ * similar strings and compressing the result.  It does not access any
+ * shared data and may run in any thread.
+ */
+static svn_error_t *
+build_container(void *baton,
+                apr_pool_t *pool)
+{
+  container_job_t *job = baton;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_stream_t *stream;
+  apr_size_t list_index;
+  int i;
+
+  job->serialized = svn_stringbuf_create_empty(pool);
+  stream = svn_stream_from_stringbuf(job->serialized, pool);
+
+  if (job->type == SVN_FS_X__ITEM_TYPE_CHANGES_CONT)
+    {
+      svn_fs_x__changes_t *container
+        = svn_fs_x__changes_create(1000, pool);
+
+      for (i = 0; i < job->items->nelts; ++i)
+        {
+          apr_array_header_t *changes;
+          svn_string_t *list = APR_ARRAY_IDX(job->items, i, svn_string_t *);
+
+          svn_pool_clear(iterpool);
+          SVN_ERR(svn_fs_x__read_changes(&changes,
+                                         svn_stream_from_string(list,
+                                                                iterpool),
+                                         INT_MAX, pool, iterpool));
+          SVN_ERR(svn_fs_x__changes_append_list(&list_index, container,
+                                                changes));
+          SVN_ERR_ASSERT(list_index == (apr_size_t)i);
+        }
+
+      SVN_ERR(svn_fs_x__write_changes_container(stream, container,
+                                                 iterpool));
+    }
+  else
+    {
+      svn_fs_x__reps_builder_t *container
+        = svn_fs_x__reps_builder_create(job->fs, pool);
+
+      for (i = 0; i < job->items->nelts; ++i)
+        {
+          SVN_ERR(svn_fs_x__reps_add(&list_index, container,
+                                     APR_ARRAY_IDX(job->items, i,
+                                                   svn_string_t *)));
+          SVN_ERR_ASSERT(list_index == (apr_size_t)i);
+        }
+
+      SVN_ERR(svn_fs_x__write_reps_container(stream, container, iterpool));
+    }
+
+  SVN_ERR(svn_stream_close(stream));
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the item described by ENTRY of a bucket with container type TYPE
+ * from TEMP_FILE, which is also available as FILE.  Return its contents
+ * in *CONTENTS, i.e. the serialized change list or the representation's
+ * fulltext, respectively.  Allocate the result in RESULT_POOL and use
+ * SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+read_container_item(svn_string_t **contents,
+                    pack_context_t *context,
+                    apr_uint32_t type,
+                    apr_file_t *temp_file,
+                    svn_fs_x__revision_file_t *file,
+                    svn_fs_x__p2l_entry_t *entry,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *buffer;
+
+  SVN_ERR(svn_io_file_seek(temp_file, APR_SET, &entry->offset,
+                           scratch_pool));
+  if (type == SVN_FS_X__ITEM_TYPE_CHANGES_CONT)
+    {
+      /* The change list will be parsed by the worker. */
+      buffer = svn_stringbuf_create_ensure(entry->size, result_pool);
+      SVN_ERR(svn_io_file_read_full2(temp_file, buffer->data, entry->size,
+                                     &buffer->len, NULL, scratch_pool));
+      buffer->data[buffer->len] = '\0';
+    }
+  else
+    {
+      svn_fs_x__representation_t representation = { 0 };
+      svn_stream_t *stream;
+
+      representation.id = entry->items[0];
+      SVN_ERR(svn_fs_x__get_representation_length(&representation.size,
+                                             &representation.expanded_size,
+                                             context->fs, file,
+                                             entry, scratch_pool));
+      SVN_ERR(svn_fs_x__get_contents(&stream, context->fs, &representation,
+                                     FALSE, scratch_pool));
+      buffer = svn_stringbuf_create_ensure(representation.expanded_size,
+                                           result_pool);
+      buffer->len = representation.expanded_size;
+
+      /* The representation is immutable.  Read it normally. */
+      SVN_ERR(svn_stream_read_full(stream, buffer->data, &buffer->len));
+      SVN_ERR(svn_stream_close(stream));
+      buffer->data[buffer->len] = '\0';
+    }
+
+  *contents = svn_stringbuf__morph_into_string(buffer);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the estimated size that the item described by ENTRY will add to
+ * a container of type TYPE.
+ */
+static apr_off_t
+estimate_container_item(apr_uint32_t type,
+                        svn_fs_x__p2l_entry_t *entry)
+{
+  /* zip compression alone will significantly reduce the size of large
+   * change lists.  So, we will probably need even less than this estimate.
+   */
+  if (type == SVN_FS_X__ITEM_TYPE_CHANGES_CONT)
+    return (entry->size / 5) + 250;
+
+  /* Representations are deltified already. */
+  return entry->size;
+}
+
+/* Starting at index *NEXT and going down, read items given as
+ * svn_fs_x__p2l_entry_t * in ENTRIES from TEMP_FILE (also available as
+ * FILE) until their estimated container size exceeds CAPACITY.  At least
+ * one item will be read.  Set *NEXT to the index of the first item not
+ * read.
+ *
+ * Push a job building a container of type TYPE from these items to
+ * CONTEXT->JOBS.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+push_container_job(int *next,
+                   pack_context_t *context,
+                   apr_uint32_t type,
+                   apr_array_header_t *entries,
+                   apr_file_t *temp_file,
+                   svn_fs_x__revision_file_t *file,
+                   apr_off_t capacity,
+                   apr_pool_t *scratch_pool)
+{
+  apr_pool_t *job_pool = svn_fs_x__job_queue_make_pool(context->jobs);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  container_job_t *job = apr_pcalloc(job_pool, sizeof(*job));
+  apr_off_t estimated_size = 0;
+  int i;
+
+  job->type = type;
+  job->fs = context->fs;
+  job->items = apr_array_make(job_pool, 16, sizeof(svn_string_t *));
+  job->sub_items = apr_array_make(job_pool, 16, sizeof(svn_fs_x__id_t));
+
+  /* Read the items sequentially in strict container order. */
+  for (i = *next; i >= 0; --i)
+    {
+      svn_string_t *contents;
+      svn_error_t *err;
+      svn_fs_x__p2l_entry_t *entry
+        = APR_ARRAY_IDX(entries, i, svn_fs_x__p2l_entry_t *);
+      apr_off_t item_size = estimate_container_item(type, entry);
+
+      if (job->items->nelts && estimated_size + item_size > capacity)
+        break;
+
+      svn_pool_clear(iterpool);
+      err = read_container_item(&contents, context, type, temp_file, file,
+                                entry, job_pool, iterpool);
+      if (err)
+        {
+          svn_pool_destroy(job_pool);
+          return svn_error_trace(err);
+        }
+
+      assert(entry->item_count == 1);
+      APR_ARRAY_PUSH(job->items, svn_string_t *) = contents;
+      APR_ARRAY_PUSH(job->sub_items, svn_fs_x__id_t) = entry->items[0];
+      estimated_size += item_size;
+    }
+
+  svn_pool_destroy(iterpool);
+  *next = i;
+
+  return svn_error_trace(svn_fs_x__job_queue_push(context->jobs,
+                                                  build_container, job,
+                                                  job_pool));
+}
+
+/* Append the serialized container of the finished JOB to CONTEXT's pack
+ * file.  Append an P2L entry containing its sub-items to NEW_ENTRIES.
  * Use SCRATCH_POOL for temporary allocations.
  */
 static svn_error_t *
-write_reps_container(pack_context_t *context,
-                     svn_fs_x__reps_builder_t *container,
-                     apr_array_header_t *sub_items,
-                     apr_array_header_t *new_entries,
-                     apr_pool_t *scratch_pool)
+write_container(pack_context_t *context,
+                container_job_t *job,
+                apr_array_header_t *new_entries,
+                apr_pool_t *scratch_pool)
 {
+  svn_fs_x__data_t *ffd = context->fs->fsap_data;
   apr_off_t offset = 0;
+  apr_size_t len = job->serialized->len;
   svn_fs_x__p2l_entry_t container_entry;
+  svn_stream_t *pack_stream;
+
+  /* Keep containers that fit into a block from crossing its boundary. */
+  if (len > get_block_left(context) && len <= ffd->block_size)
+    SVN_ERR(auto_pad_block(context, scratch_pool));
 
-  svn_stream_t *pack_stream
+  pack_stream
     = svn_checksum__wrap_write_stream_fnv1a_32x4
                                 (&container_entry.fnv1_checksum,
                                  svn_stream_from_aprfile2(context->pack_file,
                                                           TRUE, scratch_pool),
                                  scratch_pool);
-
-  SVN_ERR(svn_fs_x__write_reps_container(pack_stream, container,
-                                         scratch_pool));
+  SVN_ERR(svn_stream_write(pack_stream, job->serialized->data, &len));
   SVN_ERR(svn_stream_close(pack_stream));
   SVN_ERR(svn_io_file_seek(context->pack_file, APR_CUR, &offset,
                            scratch_pool));
 
   container_entry.offset = context->pack_offset;
   container_entry.size = offset - container_entry.offset;
-  container_entry.type = SVN_FS_X__ITEM_TYPE_REPS_CONT;
-  container_entry.item_count = sub_items->nelts;
-  container_entry.items = (svn_fs_x__id_t *)sub_items->elts;
+  container_entry.type = job->type;
+  container_entry.item_count = job->sub_items->nelts;
+  container_entry.items = (svn_fs_x__id_t *)job->sub_items->elts;
 
   context->pack_offset = offset;
   APR_ARRAY_PUSH(new_entries, svn_fs_x__p2l_entry_t *)
@@ -1207,108 +1463,91 @@ write_reps_container(pack_context_t *context,
   return SVN_NO_ERROR;
 }
 
-/* Read the (property) representations identified by svn_fs_x__p2l_entry_t
- * elements in ENTRIES from TEMP_FILE, aggregate them and write them into
- * CONTEXT->PACK_FILE.  Use SCRATCH_POOL for temporary allocations.
+/* Read the change lists or representations, depending on container TYPE,
+ * identified by svn_fs_x__p2l_entry_t * elements in ENTRIES from
+ * TEMP_FILE, aggregate them into containers and write those into
+ * CONTEXT->PACK_FILE.  Append the P2L entries of the containers to
+ * NEW_ENTRIES.  Use SCRATCH_POOL for temporary allocations.
+ *
+ * This is a pipeline:  We read the items sequentially and partition them
+ * into block-sized containers based on their estimated sizes alone.
+ * Building and compressing each container happens in CONTEXT->JOBS,
+ * i.e. usually in parallel.  Finished containers then get written to the
+ * pack file in their original order.  The number of containers in flight
+ * is limited by the size of the job queue.
  */
 static svn_error_t *
-write_reps_containers(pack_context_t *context,
-                      apr_array_header_t *entries,
-                      apr_file_t *temp_file,
-                      apr_array_header_t *new_entries,
-                      apr_pool_t *scratch_pool)
+write_containers(pack_context_t *context,
+                 apr_uint32_t type,
+                 apr_array_header_t *entries,
+                 apr_file_t *temp_file,
+                 apr_array_header_t *new_entries,
+                 apr_pool_t *scratch_pool)
 {
+  svn_fs_x__data_t *ffd = context->fs->fsap_data;
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
-  apr_pool_t *container_pool = svn_pool_create(scratch_pool);
-  int i;
-
-  apr_ssize_t block_left = get_block_left(context);
-
-  svn_fs_x__reps_builder_t *container
-    = svn_fs_x__reps_builder_create(context->fs, container_pool);
-  apr_array_header_t *sub_items
-    = apr_array_make(scratch_pool, 64, sizeof(svn_fs_x__id_t));
   svn_fs_x__revision_file_t *file;
+  int next = entries->nelts - 1;
+
+  /* Let the first container fill the current block, unless it would be
+   * padded anyway.  All others will start at a block boundary. */
+  apr_off_t capacity = get_block_left(context);
+  if (capacity < get_max_padding(context))
+    capacity = ffd->block_size;
 
   SVN_ERR(svn_fs_x__rev_file_wrap_temp(&file, context->fs, temp_file,
                                        scratch_pool));
 
   /* copy all items in strict order */
-  for (i = entries->nelts-1; i >= 0; --i)
+  while (next >= 0 || !svn_fs_x__job_queue_is_empty(context->jobs))
     {
-      svn_fs_x__representation_t representation = { 0 };
-      svn_stringbuf_t *contents;
-      svn_stream_t *stream;
-      apr_size_t list_index;
-      svn_fs_x__p2l_entry_t *entry
-        = APR_ARRAY_IDX(entries, i, svn_fs_x__p2l_entry_t *);
-
-      if ((block_left < entry->size) && sub_items->nelts)
-        {
-          block_left = get_block_left(context)
-                     - svn_fs_x__reps_estimate_size(container);
-        }
+      svn_pool_clear(iterpool);
 
-      if ((block_left < entry->size) && sub_items->nelts)
+      if (next >= 0 && !svn_fs_x__job_queue_is_full(context->jobs))
         {
-          SVN_ERR(write_reps_container(context, container, sub_items,
-                                       new_entries, iterpool));
-
-          apr_array_clear(sub_items);
-          svn_pool_clear(container_pool);
-          container = svn_fs_x__reps_builder_create(context->fs,
-                                                    container_pool);
-          block_left = get_block_left(context);
+          SVN_ERR(push_container_job(&next, context, type, entries,
+                                     temp_file, file, capacity, iterpool));
+          capacity = ffd->block_size;
         }
-
-      /* still enough space in current block? */
-      if (block_left < entry->size)
+      else
         {
-          SVN_ERR(auto_pad_block(context, iterpool));
-          block_left = get_block_left(context);
+          container_job_t *job;
+          apr_pool_t *job_pool;
+          svn_error_t *err;
+
+          SVN_ERR(svn_fs_x__job_queue_pop((void **)&job, &job_pool,
+                                          context->jobs));
+          err = write_container(context, job, new_entries, iterpool);
+          svn_pool_destroy(job_pool);
+          SVN_ERR(err);
         }
 
-      assert(entry->item_count == 1);
-      representation.id = entry->items[0];
-
-      /* select the change list in the source file, parse it and add it to
-       * the container */
-      SVN_ERR(svn_io_file_seek(temp_file, APR_SET, &entry->offset,
-                               iterpool));
-      SVN_ERR(svn_fs_x__get_representation_length(&representation.size,
-                                             &representation.expanded_size,
-                                             context->fs, file,
-                                             entry, iterpool));
-      SVN_ERR(svn_fs_x__get_contents(&stream, context->fs, &representation,
-                                     FALSE, iterpool));
-      contents = svn_stringbuf_create_ensure(representation.expanded_size,
-                                             iterpool);
-      contents->len = representation.expanded_size;
-
-      /* The representation is immutable.  Read it normally. */
-      SVN_ERR(svn_stream_read_full(stream, contents->data, &contents->len));
-      SVN_ERR(svn_stream_close(stream));
-
-      SVN_ERR(svn_fs_x__reps_add(&list_index, container,
-                                 svn_stringbuf__morph_into_string(contents)));
-      SVN_ERR_ASSERT(list_index == sub_items->nelts);
-      block_left -= entry->size;
-
-      APR_ARRAY_PUSH(sub_items, svn_fs_x__id_t) = entry->items[0];
-
-      svn_pool_clear(iterpool);
+      if (context->cancel_func)
+        SVN_ERR(context->cancel_func(context->cancel_baton));
     }
 
-  if (sub_items->nelts)
-    SVN_ERR(write_reps_container(context, container, sub_items,
-                                 new_entries, iterpool));
-
   svn_pool_destroy(iterpool);
-  svn_pool_destroy(container_pool);
 
   return SVN_NO_ERROR;
 }
 
+/* Read the (property) representations identified by svn_fs_x__p2l_entry_t
+ * elements in ENTRIES from TEMP_FILE, aggregate them and write them into
+ * CONTEXT->PACK_FILE.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+write_reps_containers(pack_context_t *context,
+                      apr_array_header_t *entries,
+                      apr_file_t *temp_file,
+                      apr_array_header_t *new_entries,
+                      apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(write_containers(context,
+                                          SVN_FS_X__ITEM_TYPE_REPS_CONT,
+                                          entries, temp_file, new_entries,
+                                          scratch_pool));
+}
+
 /* Return TRUE if the estimated size of the NODES_IN_CONTAINER plus the
  * representations given as svn_fs_x__p2l_entry_t * in ENTRIES may exceed
  * the space left in the current block.
@@ -1480,50 +1719,6 @@ copy_reps_from_temp(pack_context_t *context,
   return SVN_NO_ERROR;
 }
 
-/* Finalize CONTAINER and write it to CONTEXT's pack file.
- * Append an P2L entry containing the given SUB_ITEMS to NEW_ENTRIES.
- * Use SCRATCH_POOL for temporary allocations.
- */
-static svn_error_t *
-write_changes_container(pack_context_t *context,
-                        svn_fs_x__changes_t *container,
-                        apr_array_header_t *sub_items,
-                        apr_array_header_t *new_entries,
-                        apr_pool_t *scratch_pool)
-{
-  apr_off_t offset = 0;
-  svn_fs_x__p2l_entry_t container_entry;
-
-  svn_stream_t *pack_stream
-    = svn_checksum__wrap_write_stream_fnv1a_32x4
-                                (&container_entry.fnv1_checksum,
-                                 svn_stream_from_aprfile2(context->pack_file,
-                                                          TRUE, scratch_pool),
-                                 scratch_pool);
-
-  SVN_ERR(svn_fs_x__write_changes_container(pack_stream,
-                                             container,
-                                             scratch_pool));
-  SVN_ERR(svn_stream_close(pack_stream));
-  SVN_ERR(svn_io_file_seek(context->pack_file, APR_CUR, &offset,
-                           scratch_pool));
-
-  container_entry.offset = context->pack_offset;
-  container_entry.size = offset - container_entry.offset;
-  container_entry.type = SVN_FS_X__ITEM_TYPE_CHANGES_CONT;
-  container_entry.item_count = sub_items->nelts;
-  container_entry.items = (svn_fs_x__id_t *)sub_items->elts;
-
-  context->pack_offset = offset;
-  APR_ARRAY_PUSH(new_entries, svn_fs_x__p2l_entry_t *)
-    = svn_fs_x__p2l_entry_dup(&container_entry, context->info_pool);
-
-  SVN_ERR(svn_fs_x__p2l_proto_index_add_entry
-            (context->proto_p2l_index, &container_entry, scratch_pool));
-
-  return SVN_NO_ERROR;
-}
-
 /* Read the change lists identified by svn_fs_x__p2l_entry_t * elements
  * in ENTRIES strictly in from TEMP_FILE, aggregate them and write them
  * into CONTEXT->PACK_FILE.  Use SCRATCH_POOL for temporary allocations.
@@ -1534,95 +1729,13 @@ write_changes_containers(pack_context_t *context,
                          apr_file_t *temp_file,
                          apr_pool_t *scratch_pool)
 {
-  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
-  apr_pool_t *container_pool = svn_pool_create(scratch_pool);
-  int i;
-
-  apr_ssize_t block_left = get_block_left(context);
-  apr_ssize_t estimated_addition = 0;
-
-  svn_fs_x__changes_t *container
-    = svn_fs_x__changes_create(1000, container_pool);
-  apr_array_header_t *sub_items
-    = apr_array_make(scratch_pool, 64, sizeof(svn_fs_x__id_t));
   apr_array_header_t *new_entries
     = apr_array_make(context->info_pool, 16, entries->elt_size);
-  svn_stream_t *temp_stream
-    = svn_stream_from_aprfile2(temp_file, TRUE, scratch_pool);
 
-  /* copy all items in strict order */
-  for (i = entries->nelts-1; i >= 0; --i)
-    {
-      apr_array_header_t *changes;
-      apr_size_t list_index;
-      svn_fs_x__p2l_entry_t *entry
-        = APR_ARRAY_IDX(entries, i, svn_fs_x__p2l_entry_t *);
-
-      /* zip compression alone will significantly reduce the size of large
-       * change lists. So, we will probably need even less than this estimate.
-       */
-      apr_ssize_t estimated_size = (entry->size / 5) + 250;
-
-      /* If necessary and enough data has been added to the container since
-       * the last test, try harder by actually serializing the container and
-       * determine current savings due to compression. */
-      if (block_left < estimated_size && estimated_addition > 2000)
-        {
-          svn_stringbuf_t *serialized
-            = svn_stringbuf_create_ensure(get_block_left(context), iterpool);
-          svn_stream_t *memory_stream
-            = svn_stream_from_stringbuf(serialized, iterpool);
-
-          SVN_ERR(svn_fs_x__write_changes_container(memory_stream,
-                                                     container, iterpool));
-          SVN_ERR(svn_stream_close(temp_stream));
-
-          block_left = get_block_left(context) - serialized->len;
-          estimated_addition = 0;
-        }
-
-      if ((block_left < estimated_size) && sub_items->nelts)
-        {
-          SVN_ERR(write_changes_container(context, container, sub_items,
-                                          new_entries, iterpool));
-
-          apr_array_clear(sub_items);
-          svn_pool_clear(container_pool);
-          container = svn_fs_x__changes_create(1000, container_pool);
-          block_left = get_block_left(context);
-          estimated_addition = 0;
-        }
-
-      /* still enough space in current block? */
-      if (block_left < estimated_size)
-        {
-          SVN_ERR(auto_pad_block(context, iterpool));
-          block_left = get_block_left(context);
-        }
-
-      /* select the change list in the source file, parse it and add it to
-       * the container */
-      SVN_ERR(svn_io_file_seek(temp_file, APR_SET, &entry->offset,
-                               iterpool));
-      SVN_ERR(svn_fs_x__read_changes(&changes, temp_stream, INT_MAX,
-                                     scratch_pool, iterpool));
-      SVN_ERR(svn_fs_x__changes_append_list(&list_index, container, changes));
-      SVN_ERR_ASSERT(list_index == sub_items->nelts);
-      block_left -= estimated_size;
-      estimated_addition += estimated_size;
-
-      APR_ARRAY_PUSH(sub_items, svn_fs_x__id_t) = entry->items[0];
-
-      svn_pool_clear(iterpool);
-    }
-
-  if (sub_items->nelts)
-    SVN_ERR(write_changes_container(context, container, sub_items,
-                                    new_entries, iterpool));
+  SVN_ERR(write_containers(context, SVN_FS_X__ITEM_TYPE_CHANGES_CONT,
+                           entries, temp_file, new_entries, scratch_pool));
 
   *entries = *new_entries;
-  svn_pool_destroy(iterpool);
-  svn_pool_destroy(container_pool);
 
   return SVN_NO_ERROR;
 }
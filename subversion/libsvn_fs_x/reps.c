@@ -53,6 +53,10 @@
 /* value of unused hash buckets */
 #define NO_OFFSET ((apr_uint32_t)(-1))
 
+/* Number of bases, instructions etc. to bulk-decode at once when reading
+ * a container. */
+#define READ_BATCH_SIZE 32
+
 /* Byte strings are described by a series of copy instructions that each
  * do one of the following
  *
@@ -805,13 +809,23 @@ svn_fs_x__read_reps_container(svn_fs_x__reps_t **container,
   bases = apr_palloc(result_pool, reps->base_count * sizeof(*bases));
   reps->bases = bases;
 
-  for (i = 0; i < reps->base_count; ++i)
+  for (i = 0; i < reps->base_count; i += READ_BATCH_SIZE)
     {
-      base_t *base = bases + i;
-      base->revision = (svn_revnum_t)svn_packed__get_int(bases_stream);
-      base->item_index = svn_packed__get_uint(bases_stream);
-      base->priority = (int)svn_packed__get_uint(bases_stream);
-      base->rep = (apr_uint32_t)svn_packed__get_uint(bases_stream);
+      apr_uint64_t values[READ_BATCH_SIZE * 4];
+      apr_size_t batch = MIN(reps->base_count - i, READ_BATCH_SIZE);
+      apr_size_t k;
+
+      svn_packed__get_uints(bases_stream, values, batch * 4);
+      for (k = 0; k < batch; ++k)
+        {
+          base_t *base = bases + i + k;
+          const apr_uint64_t *row = values + k * 4;
+
+          base->revision = (svn_revnum_t)(apr_int64_t)row[0];
+          base->item_index = row[1];
+          base->priority = (int)row[2];
+          base->rep = (apr_uint32_t)row[3];
+        }
     }
 
   /* de-serialize instructions */
@@ -823,13 +837,19 @@ svn_fs_x__read_reps_container(svn_fs_x__reps_t **container,
                  reps->instruction_count * sizeof(*instructions));
   reps->instructions = instructions;
 
-  for (i = 0; i < reps->instruction_count; ++i)
+  for (i = 0; i < reps->instruction_count; i += READ_BATCH_SIZE)
     {
-      instruction_t *instruction = instructions + i;
-      instruction->offset
-        = (apr_int32_t)svn_packed__get_int(instructions_stream);
-      instruction->count
-        = (apr_uint32_t)svn_packed__get_uint(instructions_stream);
+      apr_uint64_t values[READ_BATCH_SIZE * 2];
+      apr_size_t batch = MIN(reps->instruction_count - i, READ_BATCH_SIZE);
+      apr_size_t k;
+
+      svn_packed__get_uints(instructions_stream, values, batch * 2);
+      for (k = 0; k < batch; ++k)
+        {
+          instruction_t *instruction = instructions + i + k;
+          instruction->offset = (apr_int32_t)(apr_int64_t)values[2 * k];
+          instruction->count = (apr_uint32_t)values[2 * k + 1];
+        }
     }
 
   /* de-serialize reps */
@@ -839,9 +859,16 @@ svn_fs_x__read_reps_container(svn_fs_x__reps_t **container,
                  (reps->rep_count + 1) * sizeof(*first_instructions));
   reps->first_instructions = first_instructions;
 
-  for (i = 0; i < reps->rep_count; ++i)
-    first_instructions[i]
-      = (apr_uint32_t)svn_packed__get_uint(reps_stream);
+  for (i = 0; i < reps->rep_count; i += READ_BATCH_SIZE)
+    {
+      apr_uint64_t values[READ_BATCH_SIZE];
+      apr_size_t batch = MIN(reps->rep_count - i, READ_BATCH_SIZE);
+      apr_size_t k;
+
+      svn_packed__get_uints(reps_stream, values, batch);
+      for (k = 0; k < batch; ++k)
+        first_instructions[i + k] = (apr_uint32_t)values[k];
+    }
   first_instructions[reps->rep_count] = (apr_uint32_t)reps->instruction_count;
 
   /* other elements */
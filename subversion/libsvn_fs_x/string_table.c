@@ -25,6 +25,7 @@
 #include <apr_tables.h>
 
 #include "svn_string.h"
+#include "svn_pools.h"
 #include "svn_sorts.h"
 #include "private/svn_dep_compat.h"
 #include "private/svn_string_private.h"
@@ -43,37 +44,6 @@
 #define PADDING (sizeof(apr_uint64_t))
 
 
-typedef struct builder_string_t
-{
-  svn_string_t string;
-  int position;
-  apr_size_t depth;
-  struct builder_string_t *previous;
-  struct builder_string_t *next;
-  apr_size_t previous_match_len;
-  apr_size_t next_match_len;
-  struct builder_string_t *left;
-  struct builder_string_t *right;
-} builder_string_t;
-
-typedef struct builder_table_t
-{
-  apr_size_t max_data_size;
-  builder_string_t *top;
-  builder_string_t *first;
-  builder_string_t *last;
-  apr_array_header_t *short_strings;
-  apr_array_header_t *long_strings;
-  apr_hash_t *long_string_dict;
-  apr_size_t long_string_size;
-} builder_table_t;
-
-struct string_table_builder_t
-{
-  apr_pool_t *pool;
-  apr_array_header_t *tables;
-};
-
 typedef struct string_header_t
 {
   apr_uint16_t head_string;
@@ -101,172 +71,452 @@ struct string_table_t
 };
 
 
+/* The builder keeps the short strings of the current sub-table in a
+ * compressed trie (radix tree).  Every edge label holds a piece of string
+ * data that is not shared with any other string in that table.  Adding a
+ * string is therefore linear in its length and the total label size is
+ * exactly the amount of string data that the sub-table will need.
+ *
+ * A depth-first traversal of the trie enumerates the strings in "sorted"
+ * order and gives us the common prefix length of any two consecutive
+ * strings for free.  That is all we need to fill in the string headers.
+ *
+ * Once a sub-table is full, we convert it into its final string_sub_table_t
+ * representation right away and release the trie.  So, the builder never
+ * holds more than one uncompressed sub-table.
+ */
+typedef struct trie_node_t
+{
+  /* Part of the string data along the edge leading to this node.
+   * Not NUL-terminated.  Empty for the root node only. */
+  const char *label;
+  apr_size_t label_len;
+
+  /* Position of the string that ends at this node within the sub-table.
+   * -1, if this is merely a branching point. */
+  int position;
+
+  /* Children of this node.  Their labels all start with a different
+   * character. */
+  struct trie_node_t *first_child;
+  struct trie_node_t *next_sibling;
+} trie_node_t;
+
+typedef struct builder_table_t
+{
+  /* Contains all the table's data, gets cleared when the table is full. */
+  apr_pool_t *pool;
+
+  /* Remaining capacity for string data. */
+  apr_size_t max_data_size;
+
+  /* Memory allocated for this table (without pool overhead). */
+  apr_size_t memory_used;
+
+  trie_node_t *root;
+  int short_string_count;
+
+  apr_array_header_t *long_strings;
+  apr_hash_t *long_string_dict;
+  apr_size_t long_string_size;
+} builder_table_t;
+
+struct string_table_builder_t
+{
+  apr_pool_t *pool;
+
+  /* Maximum amount of memory that TABLE may use.  0 for "unlimited". */
+  apr_size_t memory_limit;
+
+  /* Completed sub-tables (string_sub_table_t), allocated in POOL. */
+  apr_array_header_t *sealed;
+
+  /* Estimated on-disk size of all sub-tables in SEALED. */
+  apr_size_t sealed_size;
+
+  /* The sub-table that we currently add strings to.  Its table number is
+   * the number of elements in SEALED. */
+  builder_table_t *table;
+};
+
+
 /* Accessing ID Pieces.  */
 
-static builder_table_t *
-add_table(string_table_builder_t *builder)
+/* Return the sub-table number that BUILDER currently adds strings to. */
+static apr_size_t
+table_number(const string_table_builder_t *builder)
 {
-  builder_table_t *table = apr_pcalloc(builder->pool, sizeof(*table));
-  table->max_data_size = MAX_DATA_SIZE - PADDING; /* ensure there remain a few
-                                                     unused bytes at the end */
-  table->short_strings = apr_array_make(builder->pool, 64,
-                                        sizeof(builder_string_t *));
-  table->long_strings = apr_array_make(builder->pool, 0,
-                                       sizeof(svn_string_t));
-  table->long_string_dict = svn_hash__make(builder->pool);
+  return (apr_size_t)builder->sealed->nelts;
+}
 
-  APR_ARRAY_PUSH(builder->tables, builder_table_t *) = table;
+/* Return the on-disk size estimate for a sub-table with DATA_SIZE bytes
+ * of short string data, SHORT_COUNT short strings and LONG_COUNT long
+ * strings with a total size of LONG_SIZE bytes.
+ */
+static apr_size_t
+estimate_table_size(apr_size_t data_size,
+                    apr_size_t short_count,
+                    apr_size_t long_count,
+                    apr_size_t long_size)
+{
+  /* total number of chars to store,
+   * 8 bytes per short string table entry
+   * 4 bytes per long string table entry
+   * some static overhead */
+  return data_size + long_size + short_count * 8 + long_count * 4 + 10;
+}
 
-  return table;
+/* Reset TABLE to an empty state, re-using its pool. */
+static void
+reset_table(builder_table_t *table)
+{
+  svn_pool_clear(table->pool);
+
+  table->max_data_size = MAX_DATA_SIZE - PADDING; /* ensure there remain a
+                                                     few unused bytes at
+                                                     the end */
+  table->root = apr_pcalloc(table->pool, sizeof(*table->root));
+  table->root->position = -1;
+  table->memory_used = sizeof(*table->root);
+  table->short_string_count = 0;
+
+  table->long_strings = apr_array_make(table->pool, 0, sizeof(svn_string_t));
+  table->long_string_dict = svn_hash__make(table->pool);
+  table->long_string_size = 0;
 }
 
 string_table_builder_t *
-svn_fs_x__string_table_builder_create(apr_pool_t *result_pool)
+svn_fs_x__string_table_builder_create2(apr_size_t memory_limit,
+                                       apr_pool_t *result_pool)
 {
   string_table_builder_t *result = apr_palloc(result_pool, sizeof(*result));
   result->pool = result_pool;
-  result->tables = apr_array_make(result_pool, 1, sizeof(builder_table_t *));
+  result->memory_limit = memory_limit;
+  result->sealed = apr_array_make(result_pool, 0,
+                                  sizeof(string_sub_table_t));
+  result->sealed_size = 0;
 
-  add_table(result);
+  result->table = apr_pcalloc(result_pool, sizeof(*result->table));
+  result->table->pool = svn_pool_create(result_pool);
+  reset_table(result->table);
 
   return result;
 }
 
-static void
-balance(builder_table_t *table,
-        builder_string_t **parent,
-        builder_string_t *node)
+string_table_builder_t *
+svn_fs_x__string_table_builder_create(apr_pool_t *result_pool)
+{
+  return svn_fs_x__string_table_builder_create2(0, result_pool);
+}
+
+/* Return the child of NODE whose label starts with C.  Set *LINK to the
+ * pointer that refers to that child.  Return NULL, if there is no such
+ * child.
+ */
+static trie_node_t *
+find_child(trie_node_t ***link,
+           trie_node_t *node,
+           char c)
 {
-  apr_size_t left_height = node->left ? node->left->depth + 1 : 0;
-  apr_size_t right_height = node->right ? node->right->depth + 1 : 0;
+  trie_node_t **current;
+  for (current = &node->first_child; *current;
+       current = &(*current)->next_sibling)
+    if ((*current)->label[0] == c)
+      {
+        *link = current;
+        return *current;
+      }
+
+  return NULL;
+}
+
+/* Return the length of the longest prefix of STRING with length LEN that
+ * is already stored in the trie below ROOT.  Set *POSITION to the position
+ * of STRING, if it has already been stored, or to -1 otherwise.
+ */
+static apr_size_t
+trie_match(int *position,
+           trie_node_t *root,
+           const char *string,
+           apr_size_t len)
+{
+  trie_node_t *node = root;
+  apr_size_t depth = 0;
 
-  if (left_height > right_height + 1)
+  *position = -1;
+  while (depth < len)
     {
-      builder_string_t *temp = node->left->right;
-      node->left->right = node;
-      *parent = node->left;
-      node->left = temp;
+      trie_node_t **link;
+      trie_node_t *child = find_child(&link, node, string[depth]);
+      apr_size_t match;
 
-      --left_height;
+      if (child == NULL)
+        return depth;
+
+      match = svn_cstring__match_length(child->label, string + depth,
+                                        MIN(child->label_len, len - depth));
+      depth += match;
+      if (match < child->label_len)
+        return depth;
+
+      node = child;
     }
-  else if (left_height + 1 < right_height)
+
+  *position = node->position;
+  return depth;
+}
+
+/* Add STRING with length LEN to the trie of TABLE and make it the string
+ * at POSITION.  STRING must not be part of the trie already.
+ */
+static void
+trie_insert(builder_table_t *table,
+            const char *string,
+            apr_size_t len,
+            int position)
+{
+  trie_node_t *node = table->root;
+  apr_size_t depth = 0;
+
+  while (depth < len)
     {
-      builder_string_t *temp = node->right->left;
-      *parent = node->right;
-      node->right->left = node;
-      node->right = temp;
+      trie_node_t **link;
+      trie_node_t *child = find_child(&link, node, string[depth]);
+      apr_size_t match;
+
+      /* No common prefix with any existing child -> add a new leaf. */
+      if (child == NULL)
+        {
+          child = apr_pcalloc(table->pool, sizeof(*child));
+          child->label_len = len - depth;
+          child->label = apr_pmemdup(table->pool, string + depth,
+                                     child->label_len);
+          child->position = position;
+          child->next_sibling = node->first_child;
+          node->first_child = child;
+
+          table->memory_used += sizeof(*child) + child->label_len;
+          return;
+        }
 
-      --right_height;
+      /* Split the edge to CHILD, if we only share part of its label. */
+      match = svn_cstring__match_length(child->label, string + depth,
+                                        MIN(child->label_len, len - depth));
+      if (match < child->label_len)
+        {
+          trie_node_t *branch = apr_pcalloc(table->pool, sizeof(*branch));
+          branch->label = child->label;
+          branch->label_len = match;
+          branch->position = -1;
+          branch->first_child = child;
+          branch->next_sibling = child->next_sibling;
+          *link = branch;
+
+          child->label += match;
+          child->label_len -= match;
+          child->next_sibling = NULL;
+          child = branch;
+
+          table->memory_used += sizeof(*branch);
+        }
+
+      node = child;
+      depth += match;
     }
 
-  node->depth = MAX(left_height, right_height);
+  node->position = position;
 }
 
-static apr_uint16_t
-match_length(const svn_string_t *lhs,
-             const svn_string_t *rhs)
+/* Entry on the depth-first traversal stack in create_table.  NODE still
+ * needs to be visited and its label starts at DEPTH.
+ */
+typedef struct frame_t
 {
-  apr_size_t len = MIN(lhs->len, rhs->len);
-  return (apr_uint16_t)svn_cstring__match_length(lhs->data, rhs->data, len);
-}
+  const trie_node_t *node;
+  apr_size_t depth;
+} frame_t;
 
-static apr_uint16_t
-insert_string(builder_table_t *table,
-              builder_string_t **parent,
-              builder_string_t *to_insert)
+/* Entry on the stack that create_table uses to find the HEAD_STRING for
+ * each string:  The string at POSITION shares MATCH_LEN chars with its
+ * predecessor.
+ */
+typedef struct head_t
 {
-  apr_uint16_t result;
-  builder_string_t *current = *parent;
-  int diff = strcmp(current->string.data, to_insert->string.data);
-  if (diff == 0)
-    {
-      apr_array_pop(table->short_strings);
-      return current->position;
-    }
+  apr_size_t match_len;
+  int position;
+} head_t;
 
-  if (diff < 0)
+/* Convert the strings in SOURCE into the string table representation
+ * TARGET, allocated in RESULT_POOL.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static void
+create_table(string_sub_table_t *target,
+             const builder_table_t *source,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  int i;
+  apr_hash_t *tails = svn_hash__make(scratch_pool);
+  svn_stringbuf_t *data
+    = svn_stringbuf_create_ensure(MAX_DATA_SIZE - source->max_data_size,
+                                  scratch_pool);
+  svn_stringbuf_t *path = svn_stringbuf_create_empty(scratch_pool);
+  apr_array_header_t *frames = apr_array_make(scratch_pool, 16,
+                                              sizeof(frame_t));
+  apr_array_header_t *heads = apr_array_make(scratch_pool, 16,
+                                             sizeof(head_t));
+  apr_size_t match_len = 0;
+  frame_t *frame;
+
+  /* pack sub-strings */
+  target->short_string_count = (apr_size_t)source->short_string_count;
+  target->short_strings = apr_palloc(result_pool,
+                                     sizeof(*target->short_strings) *
+                                           target->short_string_count);
+
+  frame = apr_array_push(frames);
+  frame->node = source->root;
+  frame->depth = 0;
+
+  /* Visit the strings in trie order.  MATCH_LEN is the length of the
+     prefix shared between the current string and its predecessor in that
+     order.  It is the minimum depth that we have been since visiting the
+     predecessor. */
+  while (frames->nelts)
     {
-      if (current->left == NULL)
-        {
-          current->left = to_insert;
+      const trie_node_t *node = APR_ARRAY_IDX(frames, frames->nelts - 1,
+                                              frame_t).node;
+      const trie_node_t *child;
 
-          to_insert->previous = current->previous;
-          to_insert->next = current;
+      path->len = APR_ARRAY_IDX(frames, frames->nelts - 1, frame_t).depth;
+      apr_array_pop(frames);
 
-          if (to_insert->previous == NULL)
+      match_len = MIN(match_len, path->len);
+      svn_stringbuf_appendbytes(path, node->label, node->label_len);
+
+      if (node->position >= 0)
+        {
+          string_header_t *entry = &target->short_strings[node->position];
+          const char *tail = path->data + match_len;
+          string_header_t *tail_match;
+          head_t *head;
+
+          /* Minimize the number of strings to visit when reconstructing
+             the string head.  So, skip all predecessors that don't
+             contribute to the first MATCH_LEN chars of our string.  The
+             nearest predecessor with a shorter match is the one. */
+          while (heads->nelts
+                 && APR_ARRAY_IDX(heads, heads->nelts - 1, head_t).match_len
+                      >= match_len)
+            apr_array_pop(heads);
+
+          entry->head_string = match_len
+                             ? (apr_uint16_t)APR_ARRAY_IDX(heads,
+                                                           heads->nelts - 1,
+                                                           head_t).position
+                             : 0;
+
+          head = apr_array_push(heads);
+          head->match_len = match_len;
+          head->position = node->position;
+
+          /* head & tail length are known */
+          entry->head_length = (apr_uint16_t)match_len;
+          entry->tail_length = (apr_uint16_t)(path->len - match_len);
+
+          /* try to reuse an existing tail segment */
+          tail_match = apr_hash_get(tails, tail, entry->tail_length);
+          if (tail_match)
             {
-              table->first = to_insert;
+              entry->tail_start = tail_match->tail_start;
             }
           else
             {
-              builder_string_t *previous = to_insert->previous;
-              to_insert->previous_match_len
-                = match_length(&previous->string, &to_insert->string);
-
-              previous->next = to_insert;
-              previous->next_match_len = to_insert->previous_match_len;
+              entry->tail_start = (apr_uint16_t)data->len;
+              svn_stringbuf_appendbytes(data, tail, entry->tail_length);
+              apr_hash_set(tails,
+                           apr_pmemdup(scratch_pool, tail,
+                                       entry->tail_length),
+                           entry->tail_length, entry);
             }
 
-          current->previous = to_insert;
-          to_insert->next_match_len
-            = match_length(&current->string, &to_insert->string);
-          current->previous_match_len = to_insert->next_match_len;
-
-          table->max_data_size -= to_insert->string.len;
-          if (to_insert->previous == NULL)
-            table->max_data_size += to_insert->next_match_len;
-          else
-            table->max_data_size += MIN(to_insert->previous_match_len,
-                                        to_insert->next_match_len);
+          match_len = path->len;
+        }
 
-          return to_insert->position;
+      for (child = node->first_child; child; child = child->next_sibling)
+        {
+          frame = apr_array_push(frames);
+          frame->node = child;
+          frame->depth = path->len;
         }
-      else
-        result = insert_string(table, &current->left, to_insert);
     }
-  else
+
+  /* pack long strings */
+  target->long_string_count = (apr_size_t)source->long_strings->nelts;
+  target->long_strings = apr_palloc(result_pool,
+                                    sizeof(*target->long_strings) *
+                                          target->long_string_count);
+  for (i = 0; i < source->long_strings->nelts; ++i)
     {
-      if (current->right == NULL)
-        {
-          current->right = to_insert;
+      svn_string_t *string = &target->long_strings[i];
+      *string = APR_ARRAY_IDX(source->long_strings, i, svn_string_t);
+      string->data = apr_pstrmemdup(result_pool, string->data, string->len);
+    }
 
-          to_insert->next = current->next;
-          to_insert->previous = current;
+  data->len += PADDING; /* add a few extra bytes at the end of the buffer
+                           that we want to keep valid for chunky access */
+  assert(data->len < data->blocksize);
+  memset(data->data + data->len - PADDING, 0, PADDING);
 
-          if (to_insert->next == NULL)
-            {
-              table->last = to_insert;
-            }
-          else
-            {
-              builder_string_t *next = to_insert->next;
-              to_insert->next_match_len
-                = match_length(&next->string, &to_insert->string);
+  target->data = apr_pmemdup(result_pool, data->data, data->len);
+  target->data_size = data->len;
+}
 
-              next->previous = to_insert;
-              next->previous_match_len = to_insert->next_match_len;
-            }
+/* Return the estimated on-disk size of TABLE. */
+static apr_size_t
+estimate_builder_table_size(const builder_table_t *table)
+{
+  return estimate_table_size(MAX_DATA_SIZE - table->max_data_size,
+                             (apr_size_t)table->short_string_count,
+                             (apr_size_t)table->long_strings->nelts,
+                             table->long_string_size);
+}
 
-          current->next = current->right;
-          to_insert->previous_match_len
-            = match_length(&current->string, &to_insert->string);
-          current->next_match_len = to_insert->previous_match_len;
+/* Convert the current sub-table of BUILDER into its final representation
+ * and start a new, empty one.
+ */
+static void
+seal_table(string_table_builder_t *builder)
+{
+  builder_table_t *table = builder->table;
+  apr_pool_t *scratch_pool = svn_pool_create(builder->pool);
 
-          table->max_data_size -= to_insert->string.len;
-          if (to_insert->next == NULL)
-            table->max_data_size += to_insert->previous_match_len;
-          else
-            table->max_data_size += MIN(to_insert->previous_match_len,
-                                        to_insert->next_match_len);
+  builder->sealed_size += estimate_builder_table_size(table);
+  create_table(apr_array_push(builder->sealed), table, builder->pool,
+               scratch_pool);
 
-          return to_insert->position;
-        }
-      else
-        result = insert_string(table, &current->right, to_insert);
-    }
+  svn_pool_destroy(scratch_pool);
+  reset_table(table);
+}
 
-  balance(table, parent, current);
-  return result;
+/* Return TRUE if TABLE does not contain any strings. */
+static svn_boolean_t
+table_is_empty(const builder_table_t *table)
+{
+  return table->short_string_count == 0 && table->long_strings->nelts == 0;
+}
+
+/* Return TRUE if the current sub-table of BUILDER cannot take another
+ * allocation of MEMORY_NEEDED bytes without exceeding the memory limit.
+ */
+static svn_boolean_t
+exceeds_memory_limit(const string_table_builder_t *builder,
+                     apr_size_t memory_needed)
+{
+  return builder->memory_limit
+      && !table_is_empty(builder->table)
+      && builder->table->memory_used + memory_needed > builder->memory_limit;
 }
 
 apr_size_t
@@ -275,68 +525,64 @@ svn_fs_x__string_table_builder_add(string_table_builder_t *builder,
                                    apr_size_t len)
 {
   apr_size_t result;
-  builder_table_t *table = APR_ARRAY_IDX(builder->tables,
-                                         builder->tables->nelts - 1,
-                                         builder_table_t *);
+  builder_table_t *table = builder->table;
   if (len == 0)
     len = strlen(string);
 
-  string = apr_pstrmemdup(builder->pool, string, len);
   if (len > MAX_SHORT_STRING_LEN)
     {
       void *idx_void;
       svn_string_t item;
-      item.data = string;
-      item.len = len;
 
       idx_void = apr_hash_get(table->long_string_dict, string, len);
       result = (apr_uintptr_t)idx_void;
       if (result)
         return result - 1
              + LONG_STRING_MASK
-             + (((apr_size_t)builder->tables->nelts - 1) << TABLE_SHIFT);
+             + (table_number(builder) << TABLE_SHIFT);
+
+      if (   table->long_strings->nelts == MAX_STRINGS_PER_TABLE
+          || exceeds_memory_limit(builder, len + sizeof(item)))
+        seal_table(builder);
 
-      if (table->long_strings->nelts == MAX_STRINGS_PER_TABLE)
-        table = add_table(builder);
+      item.data = apr_pstrmemdup(table->pool, string, len);
+      item.len = len;
 
       result = table->long_strings->nelts
              + LONG_STRING_MASK
-             + (((apr_size_t)builder->tables->nelts - 1) << TABLE_SHIFT);
+             + (table_number(builder) << TABLE_SHIFT);
       APR_ARRAY_PUSH(table->long_strings, svn_string_t) = item;
-      apr_hash_set(table->long_string_dict, string, len,
+      apr_hash_set(table->long_string_dict, item.data, len,
                    (void*)(apr_uintptr_t)table->long_strings->nelts);
 
       table->long_string_size += len;
+      table->memory_used += len + sizeof(item);
     }
   else
     {
-      builder_string_t *item = apr_pcalloc(builder->pool, sizeof(*item));
-      item->string.data = string;
-      item->string.len = len;
-      item->previous_match_len = 0;
-      item->next_match_len = 0;
-
-      if (   table->short_strings->nelts == MAX_STRINGS_PER_TABLE
-          || table->max_data_size < len)
-        table = add_table(builder);
-
-      item->position = table->short_strings->nelts;
-      APR_ARRAY_PUSH(table->short_strings, builder_string_t *) = item;
-
-      if (table->top == NULL)
+      int position;
+      apr_size_t new_data;
+
+      new_data = len - trie_match(&position, table->root, string, len);
+      if (position >= 0)
+        return position + (table_number(builder) << TABLE_SHIFT);
+
+      /* Adding STRING needs at most NEW_DATA bytes for the label and two
+         trie nodes. */
+      if (   table->short_string_count == MAX_STRINGS_PER_TABLE
+          || table->max_data_size < new_data
+          || exceeds_memory_limit(builder,
+                                  new_data + 2 * sizeof(trie_node_t)))
         {
-          table->max_data_size -= len;
-          table->top = item;
-          table->first = item;
-          table->last = item;
-
-          result = ((apr_size_t)builder->tables->nelts - 1) << TABLE_SHIFT;
-        }
-      else
-        {
-          result = insert_string(table, &table->top, item)
-                 + (((apr_size_t)builder->tables->nelts - 1) << TABLE_SHIFT);
+          seal_table(builder);
+          new_data = len;
         }
+
+      position = table->short_string_count++;
+      trie_insert(table, string, len, position);
+      table->max_data_size -= new_data;
+
+      result = position + (table_number(builder) << TABLE_SHIFT);
     }
 
   return result;
@@ -345,27 +591,8 @@ svn_fs_x__string_table_builder_add(string_table_builder_t *builder,
 apr_size_t
 svn_fs_x__string_table_builder_estimate_size(string_table_builder_t *builder)
 {
-  apr_size_t total = 0;
-  int i;
-
-  for (i = 0; i < builder->tables->nelts; ++i)
-    {
-      builder_table_t *table
-        = APR_ARRAY_IDX(builder->tables, i, builder_table_t*);
-
-      /* total number of chars to store,
-       * 8 bytes per short string table entry
-       * 4 bytes per long string table entry
-       * some static overhead */
-      apr_size_t table_size
-        = MAX_DATA_SIZE - table->max_data_size
-        + table->long_string_size
-        + table->short_strings->nelts * 8
-        + table->long_strings->nelts * 4
-        + 10;
-
-      total += table_size;
-    }
+  apr_size_t total = builder->sealed_size
+                   + estimate_builder_table_size(builder->table);
 
   /* ZIP compression should give us a 50% reduction.
    * add some static overhead */
@@ -373,84 +600,30 @@ svn_fs_x__string_table_builder_estimate_size(string_table_builder_t *builder)
 
 }
 
+/* Copy the string table representation SOURCE into TARGET, allocating
+ * all data in RESULT_POOL.
+ */
 static void
-create_table(string_sub_table_t *target,
-             builder_table_t *source,
-             apr_pool_t *result_pool,
-             apr_pool_t *scratch_pool)
+copy_table(string_sub_table_t *target,
+           const string_sub_table_t *source,
+           apr_pool_t *result_pool)
 {
-  int i = 0;
-  apr_hash_t *tails = svn_hash__make(scratch_pool);
-  svn_stringbuf_t *data
-    = svn_stringbuf_create_ensure(MAX_DATA_SIZE - source->max_data_size,
-                                  scratch_pool);
-
-  /* pack sub-strings */
-  target->short_string_count = (apr_size_t)source->short_strings->nelts;
-  target->short_strings = apr_palloc(result_pool,
-                                     sizeof(*target->short_strings) *
-                                           target->short_string_count);
-  for (i = 0; i < source->short_strings->nelts; ++i)
-    {
-      const builder_string_t *string
-        = APR_ARRAY_IDX(source->short_strings, i, const builder_string_t *);
-
-      string_header_t *entry = &target->short_strings[i];
-      const char *tail = string->string.data + string->previous_match_len;
-      string_header_t *tail_match;
-      apr_size_t head_length = string->previous_match_len;
-
-      /* Minimize the number of strings to visit when reconstructing the
-         string head.  So, skip all predecessors that don't contribute to
-         first HEAD_LENGTH chars of our string. */
-      if (head_length)
-        {
-          const builder_string_t *furthest_prev = string->previous;
-          while (furthest_prev->previous_match_len >= head_length)
-            furthest_prev = furthest_prev->previous;
-          entry->head_string = furthest_prev->position;
-        }
-      else
-        entry->head_string = 0;
-
-      /* head & tail length are known */
-      entry->head_length = (apr_uint16_t)head_length;
-      entry->tail_length
-        = (apr_uint16_t)(string->string.len - entry->head_length);
-
-      /* try to reuse an existing tail segment */
-      tail_match = apr_hash_get(tails, tail, entry->tail_length);
-      if (tail_match)
-        {
-          entry->tail_start = tail_match->tail_start;
-        }
-      else
-        {
-          entry->tail_start = (apr_uint16_t)data->len;
-          svn_stringbuf_appendbytes(data, tail, entry->tail_length);
-          apr_hash_set(tails, tail, entry->tail_length, entry);
-        }
-    }
-
-  /* pack long strings */
-  target->long_string_count = (apr_size_t)source->long_strings->nelts;
-  target->long_strings = apr_palloc(result_pool,
-                                    sizeof(*target->long_strings) *
-                                          target->long_string_count);
-  for (i = 0; i < source->long_strings->nelts; ++i)
-    {
-      svn_string_t *string = &target->long_strings[i];
-      *string = APR_ARRAY_IDX(source->long_strings, i, svn_string_t);
-      string->data = apr_pstrmemdup(result_pool, string->data, string->len);
-    }
-
-  data->len += PADDING; /* add a few extra bytes at the end of the buffer
-                           that we want to keep valid for chunky access */
-  assert(data->len < data->blocksize);
-  memset(data->data + data->len - PADDING, 0, PADDING);
+  apr_size_t i;
 
-  target->data = apr_pmemdup(result_pool, data->data, data->len);
-  target->data_size = data->len;
+  *target = *source;
+  target->data = apr_pmemdup(result_pool, source->data, source->data_size);
+  target->short_strings
+    = apr_pmemdup(result_pool, source->short_strings,
+                  sizeof(*source->short_strings)
+                    * source->short_string_count);
+  target->long_strings
+    = apr_pmemdup(result_pool, source->long_strings,
+                  sizeof(*source->long_strings) * source->long_string_count);
+
+  for (i = 0; i < target->long_string_count; ++i)
+    target->long_strings[i].data
+      = apr_pstrmemdup(result_pool, source->long_strings[i].data,
+                       source->long_strings[i].len);
 }
 
 string_table_t *
@@ -458,21 +631,26 @@ svn_fs_x__string_table_create(const string_table_builder_t *builder,
                               apr_pool_t *result_pool)
 {
   apr_size_t i;
+  apr_pool_t *scratch_pool = svn_pool_create(builder->pool);
 
   string_table_t *result = apr_pcalloc(result_pool, sizeof(*result));
-  result->size = (apr_size_t)builder->tables->nelts;
+  result->size = table_number(builder) + 1;
   result->sub_tables
     = apr_pcalloc(result_pool, result->size * sizeof(*result->sub_tables));
 
-  for (i = 0; i < result->size; ++i)
-    create_table(&result->sub_tables[i],
-                 APR_ARRAY_IDX(builder->tables, i, builder_table_t*),
-                 result_pool,
-                 builder->pool);
+  for (i = 0; i < table_number(builder); ++i)
+    copy_table(&result->sub_tables[i],
+               &APR_ARRAY_IDX(builder->sealed, i, string_sub_table_t),
+               result_pool);
+
+  create_table(&result->sub_tables[i], builder->table, result_pool,
+               scratch_pool);
+  svn_pool_destroy(scratch_pool);
 
   return result;
 }
 
+
 /* Masks used by table_copy_string.  copy_mask[I] is used if the target
    content to be preserved starts at byte I within the current chunk.
    This is used to work around alignment issues.
@@ -52,6 +52,16 @@ typedef struct string_table_t string_table_t;
 string_table_builder_t *
 svn_fs_x__string_table_builder_create(apr_pool_t *result_pool);
 
+/* Like svn_fs_x__string_table_builder_create but limit the memory that
+ * the builder uses for the sub-table currently being filled to roughly
+ * MEMORY_LIMIT bytes.  Completed sub-tables are always kept in their
+ * compact final form.  Smaller limits result in more sub-tables and less
+ * prefix sharing.  A MEMORY_LIMIT of 0 means "no limit".
+ */
+string_table_builder_t *
+svn_fs_x__string_table_builder_create2(apr_size_t memory_limit,
+                                       apr_pool_t *result_pool);
+
 /* Add an arbitrary NUL-terminated C-string STRING of the given length LEN
  * to BUILDER.  Return the index of that string in the future string table.
  * If LEN is 0, determine the length of the C-string internally.
@@ -248,6 +248,24 @@ svn_fs_x__reset_txn_filesize(void **data,
                              void *baton,
                              apr_pool_t *pool);
 
+/**
+ * Implements #svn_cache__serialize_func_t for a #svn_fs_x__id_t.
+ */
+svn_error_t *
+svn_fs_x__serialize_id(void **data,
+                       apr_size_t *data_len,
+                       void *in,
+                       apr_pool_t *pool);
+
+/**
+ * Implements #svn_cache__deserialize_func_t for a #svn_fs_x__id_t.
+ */
+svn_error_t *
+svn_fs_x__deserialize_id(void **out,
+                         void *data,
+                         apr_size_t data_len,
+                         apr_pool_t *result_pool);
+
 /**
  * Implements #svn_cache__serialize_func_t for a #svn_fs_x__rep_header_t.
  */
@@ -2013,6 +2013,17 @@ typedef struct rep_write_baton_t
   /* Receives the low-level checksum when closing REP_STREAM. */
   apr_uint32_t fnv1a_checksum;
 
+  /* If not NULL, we don't know yet whether the contents will be stored
+     out-of-line and collect it here until it reaches the threshold. */
+  svn_spillbuf_t *pending;
+
+  /* If not NULL, the contents gets stored out-of-line and this is the
+     temporary file in the large file store that receives it. */
+  apr_file_t *large_file;
+
+  /* Path of LARGE_FILE.  Reset once the file has been moved or removed. */
+  const char *large_path;
+
   /* Local pool, available for allocations that must remain valid as long
      as this baton is used but may be cleaned up immediately afterwards. */
   apr_pool_t *local_pool;
@@ -2021,6 +2032,66 @@ typedef struct rep_write_baton_t
   apr_pool_t *result_pool;
 } rep_write_baton_t;
 
+/* Amount of pending contents that rep_write_baton_t keeps in memory
+   before spilling it to disk. */
+#define LARGE_FILE_MEMORY_BUFFER 0x100000
+
+/* Forward declaration. */
+static svn_error_t *
+rep_write_start_delta(rep_write_baton_t *b);
+
+/* Pass all contents collected in B->PENDING on to TARGET and release
+   the buffer. */
+static svn_error_t *
+flush_pending(rep_write_baton_t *b,
+              svn_stream_t *target)
+{
+  svn_spillbuf_t *pending = b->pending;
+  apr_pool_t *iterpool = svn_pool_create(b->local_pool);
+
+  b->pending = NULL;
+  while (TRUE)
+    {
+      const char *data;
+      apr_size_t len;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_spillbuf__read(&data, &len, pending, iterpool));
+      if (data == NULL)
+        break;
+
+      SVN_ERR(svn_stream_write(target, data, &len));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* The contents written to B has reached the large file threshold.
+   Write the rep header for an out-of-line representation and direct
+   all contents into a new temporary file in the large file store. */
+static svn_error_t *
+rep_write_start_large(rep_write_baton_t *b)
+{
+  svn_fs_x__rep_header_t header = { 0 };
+  const char *dir = svn_fs_x__path_large_files_dir(b->fs, b->local_pool);
+
+  SVN_ERR(svn_io_make_dir_recursively(dir, b->local_pool));
+  SVN_ERR(svn_io_open_unique_file3(&b->large_file, &b->large_path, dir,
+                                   svn_io_file_del_none,
+                                   b->local_pool, b->local_pool));
+  SVN_ERR(flush_pending(b, svn_stream_from_aprfile2(b->large_file, TRUE,
+                                                    b->local_pool)));
+
+  header.type = svn_fs_x__rep_large;
+  SVN_ERR(svn_fs_x__write_rep_header(&header, b->rep_stream,
+                                     b->local_pool));
+  SVN_ERR(svn_io_file_get_offset(&b->delta_start, b->file, b->local_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Handler for the write method of the representation writable stream.
    BATON is a rep_write_baton_t, DATA is the data to write, and *LEN is
    the length of this data. */
@@ -2031,11 +2102,25 @@ rep_write_contents(void *baton,
 {
   rep_write_baton_t *b = baton;
 
+  svn_fs_x__data_t *ffd = b->fs->fsap_data;
+
   SVN_ERR(svn_checksum_update(b->md5_checksum_ctx, data, *len));
   SVN_ERR(svn_checksum_update(b->sha1_checksum_ctx, data, *len));
   b->rep_size += *len;
 
-  return svn_stream_write(b->delta_stream, data, len);
+  if (b->delta_stream)
+    return svn_stream_write(b->delta_stream, data, len);
+
+  if (b->large_file)
+    return svn_error_trace(svn_io_file_write_full(b->large_file, data, *len,
+                                                  NULL, b->local_pool));
+
+  /* We don't know yet how to store this rep. */
+  SVN_ERR(svn_spillbuf__write(b->pending, data, *len, b->local_pool));
+  if (b->rep_size >= ffd->large_file_threshold)
+    SVN_ERR(rep_write_start_large(b));
+
+  return SVN_NO_ERROR;
 }
 
 /* Set *SPANNED to the number of shards touched when walking WALK steps on
@@ -2156,6 +2241,10 @@ choose_delta_base(svn_fs_x__representation_t **rep,
   /* return a suitable base representation */
   *rep = props ? base->prop_rep : base->data_rep;
 
+  /* Out-of-line contents is never used as a delta base. */
+  if (!props && svn_fs_x__is_large_rep(*rep))
+    *rep = NULL;
+
   /* if we encountered a shared rep, its parent chain may be different
    * from the node-rev parent chain. */
   if (*rep)
@@ -2215,6 +2304,12 @@ rep_write_cleanup(void *data)
   err = svn_error_compose_create(err, svn_io_file_close(b->file,
                                                         b->local_pool));
 
+  /* Remove incomplete out-of-line contents. */
+  if (b->large_path)
+    err = svn_error_compose_create(err,
+                                   svn_io_remove_file2(b->large_path, TRUE,
+                                                       b->local_pool));
+
   /* Remove our lock regardless of any preceding errors so that the
      being_written flag is always removed and stays consistent with the
      file lock which will be removed no matter what since the pool is
@@ -2233,6 +2328,58 @@ rep_write_cleanup(void *data)
   return APR_SUCCESS;
 }
 
+/* Write the rep header of a delta representation for B->NODEREV into
+   B->FILE and set up B->DELTA_STREAM such that all contents written to
+   it will be deltified against the selected base. */
+static svn_error_t *
+rep_write_start_delta(rep_write_baton_t *b)
+{
+  svn_fs_x__data_t *ffd = b->fs->fsap_data;
+  svn_fs_x__representation_t *base_rep;
+  svn_stream_t *source;
+  svn_txdelta_window_handler_t wh;
+  void *whb;
+  int diff_version = 1;
+  svn_fs_x__rep_header_t header = { 0 };
+
+  /* Get the base for this delta. */
+  SVN_ERR(choose_delta_base(&base_rep, b->fs, b->noderev, FALSE,
+                            b->local_pool));
+  SVN_ERR(svn_fs_x__get_contents(&source, b->fs, base_rep, TRUE,
+                                 b->local_pool));
+
+  /* Write out the rep header. */
+  if (base_rep)
+    {
+      header.base_revision = svn_fs_x__get_revnum(base_rep->id.change_set);
+      header.base_item_index = base_rep->id.number;
+      header.base_length = base_rep->size;
+      header.type = svn_fs_x__rep_delta;
+    }
+  else
+    {
+      header.type = svn_fs_x__rep_self_delta;
+    }
+  SVN_ERR(svn_fs_x__write_rep_header(&header, b->rep_stream,
+                                     b->local_pool));
+
+  /* Now determine the offset of the actual svndiff data. */
+  SVN_ERR(svn_io_file_get_offset(&b->delta_start, b->file, b->local_pool));
+
+  /* Prepare to write the svndiff data. */
+  svn_txdelta_to_svndiff3(&wh,
+                          &whb,
+                          svn_stream_disown(b->rep_stream, b->result_pool),
+                          diff_version,
+                          ffd->delta_compression_level,
+                          b->result_pool);
+
+  b->delta_stream = svn_txdelta_target_push(wh, whb, source,
+                                            b->result_pool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Get a rep_write_baton_t, allocated from RESULT_POOL, and store it in
    WB_P for the representation indicated by NODEREV in filesystem FS.
    Only appropriate for file contents, not for props or directory contents.
@@ -2246,12 +2393,6 @@ rep_write_get_baton(rep_write_baton_t **wb_p,
   svn_fs_x__data_t *ffd = fs->fsap_data;
   rep_write_baton_t *b;
   apr_file_t *file;
-  svn_fs_x__representation_t *base_rep;
-  svn_stream_t *source;
-  svn_txdelta_window_handler_t wh;
-  void *whb;
-  int diff_version = 1;
-  svn_fs_x__rep_header_t header = { 0 };
   svn_fs_x__txn_id_t txn_id
     = svn_fs_x__get_txn_id(noderev->noderev_id.change_set);
 
@@ -2281,43 +2422,22 @@ rep_write_get_baton(rep_write_baton_t **wb_p,
 
   SVN_ERR(svn_io_file_get_offset(&b->rep_offset, file, b->local_pool));
 
-  /* Get the base for this delta. */
-  SVN_ERR(choose_delta_base(&base_rep, fs, noderev, FALSE, b->local_pool));
-  SVN_ERR(svn_fs_x__get_contents(&source, fs, base_rep, TRUE,
-                                 b->local_pool));
-
-  /* Write out the rep header. */
-  if (base_rep)
-    {
-      header.base_revision = svn_fs_x__get_revnum(base_rep->id.change_set);
-      header.base_item_index = base_rep->id.number;
-      header.base_length = base_rep->size;
-      header.type = svn_fs_x__rep_delta;
-    }
-  else
-    {
-      header.type = svn_fs_x__rep_self_delta;
-    }
-  SVN_ERR(svn_fs_x__write_rep_header(&header, b->rep_stream,
-                                     b->local_pool));
-
-  /* Now determine the offset of the actual svndiff data. */
-  SVN_ERR(svn_io_file_get_offset(&b->delta_start, file, b->local_pool));
-
   /* Cleanup in case something goes wrong. */
   apr_pool_cleanup_register(b->local_pool, b, rep_write_cleanup,
                             apr_pool_cleanup_null);
 
-  /* Prepare to write the svndiff data. */
-  svn_txdelta_to_svndiff3(&wh,
-                          &whb,
-                          svn_stream_disown(b->rep_stream, b->result_pool),
-                          diff_version,
-                          ffd->delta_compression_level,
-                          result_pool);
-
-  b->delta_stream = svn_txdelta_target_push(wh, whb, source,
-                                            b->result_pool);
+  /* With out-of-line storage enabled, we can only decide upon the format
+   * once we know whether the contents reaches the threshold. */
+  if (ffd->large_file_threshold)
+    b->pending = svn_spillbuf__create_extended(
+                   SVN__STREAM_CHUNK_SIZE,
+                   (apr_size_t)MIN(ffd->large_file_threshold,
+                                   LARGE_FILE_MEMORY_BUFFER),
+                   TRUE, FALSE,
+                   svn_fs_x__path_txn_dir(fs, txn_id, b->local_pool),
+                   b->local_pool);
+  else
+    SVN_ERR(rep_write_start_delta(b));
 
   *wb_p = b;
 
@@ -2475,8 +2595,10 @@ get_shared_rep(svn_fs_x__representation_t **old_rep,
 
   /* If we (very likely) found a matching representation, compare the actual
    * contents such that we can be sure that no rep-cache.db corruption or
-   * hash collision produced a false positive. */
-  if (*old_rep)
+   * hash collision produced a false positive.  Two out-of-line reps with
+   * the same SHA1 share the same, already verified file. */
+  if (   *old_rep
+      && !(svn_fs_x__is_large_rep(rep) && svn_fs_x__is_large_rep(*old_rep)))
     {
       apr_off_t old_position;
       svn_stream_t *contents;
@@ -2575,6 +2697,65 @@ digests_final(svn_fs_x__representation_t *rep,
   return SVN_NO_ERROR;
 }
 
+/* Move the out-of-line contents written to B into the large file store,
+   where it will be found by the SHA1 of REP.  If the store already has
+   a file for that SHA1, make sure it matches and keep the existing one. */
+static svn_error_t *
+install_large_file(rep_write_baton_t *b,
+                   svn_fs_x__representation_t *rep)
+{
+  svn_fs_x__data_t *ffd = b->fs->fsap_data;
+  const char *target = svn_fs_x__path_large_file(b->fs, rep->sha1_digest,
+                                                 b->local_pool);
+  const char *temp_path = b->large_path;
+  svn_node_kind_t kind;
+
+  if (ffd->flush_to_disk)
+    SVN_ERR(svn_io_file_flush_to_disk(b->large_file, b->local_pool));
+  SVN_ERR(svn_io_file_close(b->large_file, b->local_pool));
+  b->large_file = NULL;
+
+  SVN_ERR(svn_io_check_path(target, &kind, b->local_pool));
+  if (kind == svn_node_file)
+    {
+      svn_boolean_t same;
+
+      /* Shared contents.  Protect against SHA1 collisions. */
+      SVN_ERR(svn_io_files_contents_same_p(&same, temp_path, target,
+                                           b->local_pool));
+      if (!same)
+        {
+          svn_checksum_t checksum;
+          checksum.digest = rep->sha1_digest;
+          checksum.kind = svn_checksum_sha1;
+
+          return svn_error_createf(SVN_ERR_FS_AMBIGUOUS_CHECKSUM_REP, NULL,
+                                   _("Out-of-line contents '%s' matches "
+                                     "SHA1 %s but contents differ"),
+                                   svn_dirent_local_style(target,
+                                                          b->local_pool),
+                                   svn_checksum_to_cstring_display(
+                                                          &checksum,
+                                                          b->local_pool));
+        }
+
+      SVN_ERR(svn_io_remove_file2(temp_path, FALSE, b->local_pool));
+    }
+  else
+    {
+      SVN_ERR(svn_io_make_dir_recursively(svn_dirent_dirname(target,
+                                                             b->local_pool),
+                                          b->local_pool));
+      SVN_ERR(svn_io_file_rename2(temp_path, target, ffd->flush_to_disk,
+                                  b->local_pool));
+      SVN_ERR(svn_io_set_file_read_only(target, FALSE, b->local_pool));
+    }
+
+  b->large_path = NULL;
+
+  return SVN_NO_ERROR;
+}
+
 /* Close handler for the representation write stream.  BATON is a
    rep_write_baton_t.  Writes out a new node-rev that correctly
    references the representation we just finished writing. */
@@ -2589,9 +2770,17 @@ rep_write_contents_close(void *baton)
 
   rep = apr_pcalloc(b->result_pool, sizeof(*rep));
 
+  /* Contents below the large file threshold gets stored normally. */
+  if (b->pending)
+    {
+      SVN_ERR(rep_write_start_delta(b));
+      SVN_ERR(flush_pending(b, b->delta_stream));
+    }
+
   /* Close our delta stream so the last bits of svndiff are written
      out. */
-  SVN_ERR(svn_stream_close(b->delta_stream));
+  if (b->delta_stream)
+    SVN_ERR(svn_stream_close(b->delta_stream));
 
   /* Determine the length of the svndiff data. */
   SVN_ERR(svn_io_file_get_offset(&offset, b->file, b->local_pool));
@@ -2606,6 +2795,10 @@ rep_write_contents_close(void *baton)
   SVN_ERR(digests_final(rep, b->md5_checksum_ctx, b->sha1_checksum_ctx,
                         b->result_pool));
 
+  /* Out-of-line contents is addressed by its SHA1. */
+  if (b->large_file)
+    SVN_ERR(install_large_file(b, rep));
+
   /* Check and see if we already have a representation somewhere that's
      identical to the one we just wrote out. */
   SVN_ERR(get_shared_rep(&old_rep, b->fs, txn_id, rep, b->file, b->rep_offset,
@@ -2616,6 +2809,11 @@ rep_write_contents_close(void *baton)
       /* We need to erase from the protorev the data we just wrote. */
       SVN_ERR(svn_io_file_trunc(b->file, b->rep_offset, b->local_pool));
 
+      /* The old rep may store the same contents in the rev file, leaving
+         the out-of-line file that we just installed unused.  Keep it,
+         though: concurrent txns with the same contents may have adopted
+         it already.  Later large reps with that SHA1 will reuse it. */
+
       /* Use the old rep for this content. */
       b->noderev->data_rep = old_rep;
     }
@@ -3476,9 +3674,11 @@ verify_locks(svn_fs_t *fs,
    properties for REVISION into their final location. Return that location
    in *PATH and schedule the necessary fsync calls in BATCH.  This involves
    setting svn:date and removing any temporary properties associated with
-   the commit flags. */
+   the commit flags.  Return the final svn:date value, if any, in *DATE_P.
+   Allocate *PATH and *DATE_P in RESULT_POOL. */
 static svn_error_t *
 write_final_revprop(const char **path,
+                    const svn_string_t **date_p,
                     svn_fs_txn_t *txn,
                     svn_revnum_t revision,
                     svn_fs_x__batch_fsync_t *batch,
@@ -3512,6 +3712,10 @@ write_final_revprop(const char **path,
       svn_hash_sets(props, SVN_PROP_REVISION_DATE, &date);
     }
 
+  *date_p = svn_hash_gets(props, SVN_PROP_REVISION_DATE);
+  if (*date_p)
+    *date_p = svn_string_dup(*date_p, result_pool);
+
   /* Create a file at the final revprops location. */
   *path = svn_fs_x__path_revprops(txn->fs, revision, result_pool);
   SVN_ERR(svn_fs_x__batch_fsync_open_file(&file, batch, *path, scratch_pool));
@@ -3770,12 +3974,14 @@ commit_body(void *baton,
   svn_fs_x__data_t *ffd = cb->fs->fsap_data;
   const char *old_rev_filename, *rev_filename;
   const char *revprop_filename;
+  const svn_string_t *date;
   svn_fs_x__id_t root_id, new_root_id;
   svn_revnum_t old_rev, new_rev;
   apr_file_t *proto_file;
   apr_off_t initial_offset, changed_path_offset;
   svn_fs_x__txn_id_t txn_id = svn_fs_x__txn_get_id(cb->txn);
   apr_hash_t *changed_paths;
+  svn_error_t *err;
   svn_fs_x__batch_fsync_t *batch;
   apr_array_header_t *directory_ids
     = apr_array_make(scratch_pool, 4, sizeof(svn_fs_x__pair_cache_key_t));
@@ -3866,8 +4072,8 @@ commit_body(void *baton,
 
   /* Move the revprops file into place. */
   SVN_ERR_ASSERT(! svn_fs_x__is_packed_revprop(cb->fs, new_rev));
-  SVN_ERR(write_final_revprop(&revprop_filename, cb->txn, new_rev, batch,
-                              subpool, subpool));
+  SVN_ERR(write_final_revprop(&revprop_filename, &date, cb->txn, new_rev,
+                              batch, scratch_pool, subpool));
   SVN_ERR(svn_io_copy_perms(revprop_filename, old_rev_filename, subpool));
   svn_pool_clear(subpool);
 
@@ -3892,6 +4098,27 @@ commit_body(void *baton,
    * visible. */
   SVN_ERR(promote_cached_directories(cb->fs, directory_ids, subpool));
 
+  /* Keep the path index, if there is one, up to date.  Failing to do so
+     must not fail the commit.  The index will simply not cover this and
+     any later revision until it gets rebuilt. */
+  err = svn_fs__path_index_append(cb->fs->path, new_rev, changed_paths,
+                                  subpool);
+  if (err)
+    {
+      (cb->fs->warning)(cb->fs->warning_baton, err);
+      svn_error_clear(err);
+    }
+
+  /* Keep the date index, if there is one, up to date.  The revision has
+     already been published, so a failure must not fail the commit.  The
+     index will then not cover this and later revisions until rebuilt. */
+  err = svn_fs__date_index_append(cb->fs->path, new_rev, date, subpool);
+  if (err)
+    {
+      (cb->fs->warning)(cb->fs->warning_baton, err);
+      svn_error_clear(err);
+    }
+
   /* Remove this transaction directory. */
   SVN_ERR(svn_fs_x__purge_txn(cb->fs, cb->txn->id, subpool));
 
@@ -1845,6 +1845,23 @@ x_file_contents(svn_stream_t **contents,
   return SVN_NO_ERROR;
 }
 
+/* Set *FULLTEXT to the out-of-line contents of PATH under ROOT opened
+   for reading or to NULL if PATH is stored in the revision files.
+   Allocate *FULLTEXT in POOL. */
+static svn_error_t *
+x_open_fulltext_file(apr_file_t **fulltext,
+                     svn_fs_root_t *root,
+                     const char *path,
+                     apr_pool_t *pool)
+{
+  dag_node_t *node;
+
+  SVN_ERR(svn_fs_x__get_temp_dag_node(&node, root, path, pool));
+  SVN_ERR(svn_fs_x__dag_open_fulltext_file(fulltext, node, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* --- End machinery for svn_fs_file_contents() ---  */
 
 
@@ -2288,8 +2305,9 @@ x_revision_changes_iterator_get(svn_fs_path_change3_t **change,
   fs_revision_changes_iterator_data_t *data = iterator->fsap_data;
 
   /* If we exhausted our block of changes and did not reach the end of the
-     list, yet, fetch the next block.  Note that that block may be empty. */
-  if ((data->idx >= data->changes->nelts) && !data->context->eol)
+     list, yet, fetch the next block.  Note that that block may be empty,
+     e.g. if none of its changes is within the requested sub-tree. */
+  while ((data->idx >= data->changes->nelts) && !data->context->eol)
     {
       apr_pool_t *changes_pool = data->changes->pool;
 
@@ -2322,11 +2340,16 @@ static changes_iterator_vtable_t rev_changes_iterator_vtable =
   x_revision_changes_iterator_get
 };
 
+/* Set *ITERATOR to a new iterator over the changes in ROOT at or below
+   the canonical fspath PREFIX.  If PREFIX is NULL, report all changes.
+   Allocate the result in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ */
 static svn_error_t *
-x_report_changes(svn_fs_path_change_iterator_t **iterator,
-                 svn_fs_root_t *root,
-                 apr_pool_t *result_pool,
-                 apr_pool_t *scratch_pool)
+report_changes(svn_fs_path_change_iterator_t **iterator,
+               svn_fs_root_t *root,
+               const char *prefix,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
 {
   svn_fs_path_change_iterator_t *result = apr_pcalloc(result_pool,
                                                       sizeof(*result));
@@ -2337,6 +2360,21 @@ x_report_changes(svn_fs_path_change_iterator_t **iterator,
                                           svn_fs_x__root_txn_id(root),
                                           result_pool));
 
+      /* Transaction change lists are not sorted, so simply drop all the
+         changes outside the sub-tree. */
+      if (prefix)
+        {
+          apr_hash_index_t *hi;
+          for (hi = apr_hash_first(scratch_pool, changed_paths);
+               hi;
+               hi = apr_hash_next(hi))
+            {
+              const char *path = apr_hash_this_key(hi);
+              if (!svn_fspath__skip_ancestor(prefix, path))
+                svn_hash_sets(changed_paths, path, NULL);
+            }
+        }
+
       result->fsap_data = apr_hash_first(result_pool, changed_paths);
       result->vtable = &txn_changes_iterator_vtable;
     }
@@ -2359,6 +2397,7 @@ x_report_changes(svn_fs_path_change_iterator_t **iterator,
       SVN_ERR(svn_fs_x__create_changes_context(&data->context,
                                                root->fs, root->rev,
                                                result_pool, scratch_pool));
+      data->context->prefix = prefix;
       SVN_ERR(svn_fs_x__get_changes(&data->changes, data->context,
                                     changes_pool, scratch_pool));
 
@@ -2372,6 +2411,28 @@ x_report_changes(svn_fs_path_change_iterator_t **iterator,
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+x_report_changes(svn_fs_path_change_iterator_t **iterator,
+                 svn_fs_root_t *root,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(report_changes(iterator, root, NULL,
+                                        result_pool, scratch_pool));
+}
+
+static svn_error_t *
+x_report_changes_under(svn_fs_path_change_iterator_t **iterator,
+                       svn_fs_root_t *root,
+                       const char *path,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool)
+{
+  const char *prefix = apr_pstrdup(result_pool, path);
+  return svn_error_trace(report_changes(iterator, root, prefix,
+                                        result_pool, scratch_pool));
+}
+
 
 /* Our coolio opaque history object. */
 typedef struct fs_history_data_t
@@ -3229,6 +3290,8 @@ static root_vtable_t root_vtable = {
   x_get_file_delta_stream,
   x_merge,
   x_get_mergeinfo,
+  x_open_fulltext_file,
+  x_report_changes_under,
 };
 
 /* Construct a new root object in FS, allocated from RESULT_POOL.  */
@@ -373,6 +373,31 @@ svn_fs_x__path_min_unpacked_rev(svn_fs_t *fs,
   return svn_dirent_join(fs->path, PATH_MIN_UNPACKED_REV, result_pool);
 }
 
+const char *
+svn_fs_x__path_large_files_dir(svn_fs_t *fs,
+                               apr_pool_t *result_pool)
+{
+  return svn_dirent_join(fs->path, PATH_LARGE_FILES, result_pool);
+}
+
+const char *
+svn_fs_x__path_large_file(svn_fs_t *fs,
+                          const unsigned char *sha1,
+                          apr_pool_t *result_pool)
+{
+  svn_checksum_t checksum;
+  const char *name;
+  checksum.digest = sha1;
+  checksum.kind = svn_checksum_sha1;
+
+  /* Use the first two hex digits as sub-folder to keep directories small. */
+  name = svn_checksum_to_cstring(&checksum, result_pool);
+  return svn_dirent_join_many(result_pool,
+                              svn_fs_x__path_large_files_dir(fs, result_pool),
+                              apr_pstrndup(result_pool, name, 2), name,
+                              SVN_VA_NULL);
+}
+
 const char *
 svn_fs_x__path_txn_proto_revs(svn_fs_t *fs,
                               apr_pool_t *result_pool)
@@ -300,6 +300,21 @@ const char *
 svn_fs_x__path_min_unpacked_rev(svn_fs_t *fs,
                                 apr_pool_t *result_pool);
 
+/* Return the path of the large file store directory in FS, even if that
+ * folder may not exist in FS.  The result will be allocated in RESULT_POOL.
+ */
+const char *
+svn_fs_x__path_large_files_dir(svn_fs_t *fs,
+                               apr_pool_t *result_pool);
+
+/* Return the path of the out-of-line contents with the given SHA1 checksum
+ * in FS.  The result will be allocated in RESULT_POOL.
+ */
+const char *
+svn_fs_x__path_large_file(svn_fs_t *fs,
+                          const unsigned char *sha1,
+                          apr_pool_t *result_pool);
+
 /* Return the path of the file containing item_index counter for
  * the transaction identified by TXN_ID in FS.
  * The result will be allocated in RESULT_POOL.
@@ -2294,10 +2294,11 @@ update_delay_handler(serf_request_t *request,
             }
         }
 
-      /* Let's start using the spill infrastructure */
-      udb->spillbuf = svn_spillbuf__create(SPILLBUF_BLOCKSIZE,
-                                           SPILLBUF_MAXBUFFSIZE,
-                                           udb->report->pool);
+      /* Let's start using the spill infrastructure.  The spilled data
+         gets drained continuously, so mapped storage can be re-used. */
+      udb->spillbuf = svn_spillbuf__create_mapped(SPILLBUF_BLOCKSIZE,
+                                                  SPILLBUF_MAXBUFFSIZE,
+                                                  udb->report->pool);
     }
 
   /* Read everything we can to a spillbuffer */
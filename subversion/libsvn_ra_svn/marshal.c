@@ -49,6 +49,7 @@
 #include "private/svn_dep_compat.h"
 #include "private/svn_error_private.h"
 #include "private/svn_subr_private.h"
+#include "private/svn_trace.h"
 
 #define svn_iswhitespace(c) ((c) == ' ' || (c) == '\n')
 
@@ -210,8 +211,12 @@ svn_ra_svn_conn_t *svn_ra_svn_create_conn5(apr_socket_t *sock,
   conn->current_in = 0;
   conn->max_out = max_out;
   conn->current_out = 0;
+  conn->total_in = 0;
+  conn->total_out = 0;
   conn->block_handler = NULL;
   conn->block_baton = NULL;
+  conn->command_observer = NULL;
+  conn->command_observer_baton = NULL;
   conn->capabilities = apr_hash_make(result_pool);
   conn->compression_level = compression_level;
   conn->zero_copy_limit = zero_copy_limit;
@@ -289,6 +294,13 @@ svn_ra_svn__get_pool(svn_ra_svn_conn_t *conn)
   return conn->pool;
 }
 
+void
+svn_ra_svn__set_read_timeout(svn_ra_svn_conn_t *conn,
+                             apr_interval_time_t interval)
+{
+  svn_ra_svn__stream_read_timeout(conn->stream, interval);
+}
+
 svn_error_t *
 svn_ra_svn__set_shim_callbacks(svn_ra_svn_conn_t *conn,
                                svn_delta_shim_callbacks_t *shim_callbacks)
@@ -330,6 +342,15 @@ svn_ra_svn__set_block_handler(svn_ra_svn_conn_t *conn,
   svn_ra_svn__stream_timeout(conn->stream, get_timeout(conn));
 }
 
+void
+svn_ra_svn__set_command_observer(svn_ra_svn_conn_t *conn,
+                                 svn_ra_svn__command_observer_t observer,
+                                 void *baton)
+{
+  conn->command_observer = observer;
+  conn->command_observer_baton = baton;
+}
+
 svn_error_t *svn_ra_svn__data_available(svn_ra_svn_conn_t *conn,
                                        svn_boolean_t *data_available)
 {
@@ -346,6 +367,11 @@ svn_ra_svn__reset_command_io_counters(svn_ra_svn_conn_t *conn)
 
 /* --- WRITE BUFFER MANAGEMENT --- */
 
+/* Trace probes for network I/O and command processing. */
+SVN_TRACE__PROBE(bytes_in_probe, "ra_svn.bytes_in");
+SVN_TRACE__PROBE(bytes_out_probe, "ra_svn.bytes_out");
+SVN_TRACE__PROBE(handle_command_probe, "ra_svn.handle_command");
+
 /* Return an error object if CONN exceeded its send or receive limits. */
 static svn_error_t *
 check_io_limits(svn_ra_svn_conn_t *conn)
@@ -376,7 +402,9 @@ static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
    * This is to limit the server load in case users e.g. accidentally ran
    * an export on the root folder. */
   conn->current_out += len;
+  conn->total_out += len;
   SVN_ERR(check_io_limits(conn));
+  SVN_TRACE__COUNT(bytes_out_probe, len);
 
   while (data < end)
     {
@@ -427,12 +455,63 @@ static svn_error_t *writebuf_flush(svn_ra_svn_conn_t *conn, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Write data from the write buffer plus the LEN bytes at DATA out to the
+   socket in a single gathering write, i.e. without copying DATA into the
+   write buffer first. */
+static svn_error_t *writebuf_flush_with(svn_ra_svn_conn_t *conn,
+                                        apr_pool_t *pool,
+                                        const char *data, apr_size_t len)
+{
+  struct iovec vec[2];
+  apr_size_t total = conn->write_pos + len;
+  svn_ra_svn__session_baton_t *session = conn->session;
+
+  vec[0].iov_base = conn->write_buf;
+  vec[0].iov_len = conn->write_pos;
+  vec[1].iov_base = (void *)data;
+  vec[1].iov_len = len;
+
+  /* Clear conn->write_pos first in case the cancel handler does a read. */
+  conn->write_pos = 0;
+
+  conn->current_out += total;
+  conn->total_out += total;
+  SVN_ERR(check_io_limits(conn));
+  SVN_TRACE__COUNT(bytes_out_probe, total);
+
+  if (session && session->callbacks && session->callbacks->cancel_func)
+    SVN_ERR((session->callbacks->cancel_func)(session->callbacks_baton));
+
+  SVN_ERR(svn_ra_svn__stream_writev(conn->stream, vec, 2));
+
+  if (session)
+    {
+      const svn_ra_callbacks2_t *cb = session->callbacks;
+      session->bytes_written += total;
+
+      if (cb && cb->progress_func)
+        (cb->progress_func)(session->bytes_written + session->bytes_read,
+                            -1, cb->progress_baton, pool);
+    }
+
+  conn->written_since_error_check += total;
+  conn->may_check_for_error
+    = conn->written_since_error_check >= conn->error_check_interval;
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *writebuf_write(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
                                    const char *data, apr_size_t len)
 {
   /* data >= 8k is sent immediately */
   if (len >= sizeof(conn->write_buf) / 2)
     {
+      /* Partial writes and the block handler need the one-by-one
+         approach.  Otherwise, send the buffer contents along with DATA. */
+      if (conn->write_pos > 0 && conn->block_handler == NULL)
+        return writebuf_flush_with(conn, pool, data, len);
+
       if (conn->write_pos > 0)
         SVN_ERR(writebuf_flush(conn, pool));
 
@@ -509,6 +588,8 @@ static svn_error_t *readbuf_input(svn_ra_svn_conn_t *conn, char *data,
   if (*len == 0)
     return svn_error_create(SVN_ERR_RA_SVN_CONNECTION_CLOSED, NULL, NULL);
   conn->current_in += *len;
+  conn->total_in += *len;
+  SVN_TRACE__COUNT(bytes_in_probe, *len);
 
   if (session)
     {
@@ -762,6 +843,34 @@ svn_ra_svn__write_string(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_ra_svn__write_file_string(svn_ra_svn_conn_t *conn,
+                              apr_pool_t *pool,
+                              apr_file_t *file,
+                              apr_off_t offset,
+                              apr_size_t len)
+{
+  /* Send the length prefix ourselves, then let the stream move the file
+   * contents without copying them through the write buffer. */
+  SVN_ERR(write_number(conn, pool, len, ':'));
+  SVN_ERR(writebuf_flush(conn, pool));
+
+  conn->current_out += len;
+  conn->total_out += len;
+  SVN_ERR(check_io_limits(conn));
+  SVN_TRACE__COUNT(bytes_out_probe, len);
+
+  SVN_ERR(svn_ra_svn__stream_sendfile(conn->stream, file, offset, len,
+                                      pool));
+
+  conn->written_since_error_check += len;
+  conn->may_check_for_error
+    = conn->written_since_error_check >= conn->error_check_interval;
+
+  SVN_ERR(writebuf_writechar(conn, pool, ' '));
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_ra_svn__write_cstring(svn_ra_svn_conn_t *conn,
                           apr_pool_t *pool,
@@ -1915,6 +2024,8 @@ svn_ra_svn__handle_command(svn_boolean_t *terminate,
   svn_error_t *err, *write_err;
   svn_ra_svn__list_t *params;
   const svn_ra_svn__cmd_entry_t *command;
+  apr_uint64_t total_in = conn->total_in;
+  apr_uint64_t total_out = conn->total_out;
 
   *terminate = FALSE;
 
@@ -1937,6 +2048,9 @@ svn_ra_svn__handle_command(svn_boolean_t *terminate,
   command = svn_hash_gets(cmd_hash, cmdname);
   if (command)
     {
+      apr_time_t trace_start = SVN_TRACE__SPAN_START();
+      apr_time_t start = conn->command_observer ? apr_time_now() : 0;
+
       /* Call the standard command handler.
        * If that is not set, then this is a lecagy API call and we invoke
        * the legacy command handler. */
@@ -1952,6 +2066,8 @@ svn_ra_svn__handle_command(svn_boolean_t *terminate,
                                                baton);
         }
 
+      SVN_TRACE__SPAN_END(handle_command_probe, trace_start);
+
       /* The command implementation may have swallowed or wrapped the I/O
        * error not knowing that we may no longer be able to send data.
        *
@@ -1959,6 +2075,13 @@ svn_ra_svn__handle_command(svn_boolean_t *terminate,
        * processing quickly if we may have truncated data. */
       err = svn_error_compose_create(check_io_limits(conn), err);
 
+      if (conn->command_observer)
+        conn->command_observer(conn->command_observer_baton, cmdname,
+                               apr_time_now() - start,
+                               conn->total_in - total_in,
+                               conn->total_out - total_out,
+                               err != NULL);
+
       *terminate = command->terminate;
     }
   else
@@ -102,6 +102,11 @@ struct svn_ra_svn_conn_st {
   apr_uint64_t max_out;
   apr_uint64_t current_out;
 
+  /* Total I/O volume of this connection.  Unlike CURRENT_IN and
+     CURRENT_OUT, these never get reset. */
+  apr_uint64_t total_in;
+  apr_uint64_t total_out;
+
   /* repository info */
   const char *uuid;
   const char *repos_root;
@@ -110,6 +115,10 @@ struct svn_ra_svn_conn_st {
   ra_svn_block_handler_t block_handler;
   void *block_baton;
 
+  /* Optional per-command statistics target */
+  svn_ra_svn__command_observer_t command_observer;
+  void *command_observer_baton;
+
   /* server settings */
   apr_hash_t *capabilities;
   int compression_level;
@@ -222,6 +231,21 @@ svn_ra_svn__stream_t *svn_ra_svn__stream_create(svn_stream_t *in_stream,
 svn_error_t *svn_ra_svn__stream_write(svn_ra_svn__stream_t *stream,
                                       const char *data, apr_size_t *len);
 
+/* Write the NVEC buffers in VEC to STREAM, in order and completely. */
+svn_error_t *svn_ra_svn__stream_writev(svn_ra_svn__stream_t *stream,
+                                       const struct iovec *vec, int nvec);
+
+/* Write LEN bytes starting at OFFSET in FILE to STREAM.  Use the
+ * kernel's sendfile mechanism if STREAM writes directly to a socket and
+ * copy the data otherwise.  The file pointer of FILE is undefined
+ * afterwards.  Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *svn_ra_svn__stream_sendfile(svn_ra_svn__stream_t *stream,
+                                         apr_file_t *file,
+                                         apr_off_t offset,
+                                         apr_size_t len,
+                                         apr_pool_t *scratch_pool);
+
 /* Read *LEN bytes from STREAM into DATA, returning the number of bytes
  * read in *LEN.
  */
@@ -239,6 +263,12 @@ svn_error_t *svn_ra_svn__read_command_only(svn_ra_svn_conn_t *conn,
 void svn_ra_svn__stream_timeout(svn_ra_svn__stream_t *stream,
                                 apr_interval_time_t interval);
 
+/* Make reads from STREAM fail once they had to wait for longer than
+ * INTERVAL.  Negative values make reads block indefinitely, which is
+ * the default.  This is a no-op for streams not backed by a socket. */
+void svn_ra_svn__stream_read_timeout(svn_ra_svn__stream_t *stream,
+                                     apr_interval_time_t interval);
+
 /* Return whether or not there is data pending on STREAM. */
 svn_error_t *
 svn_ra_svn__stream_data_available(svn_ra_svn__stream_t *stream,
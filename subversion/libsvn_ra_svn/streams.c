@@ -31,23 +31,33 @@
 #include "svn_error.h"
 #include "svn_pools.h"
 #include "svn_io.h"
+#include "svn_sorts.h"
 #include "svn_private_config.h"
 
 #include "private/svn_io_private.h"
 
 #include "ra_svn.h"
 
+typedef struct sock_baton_t {
+  apr_socket_t *sock;
+  apr_pool_t *pool;
+
+  /* Timeout for reads.  Negative values block indefinitely. */
+  apr_interval_time_t read_timeout;
+} sock_baton_t;
+
 struct svn_ra_svn__stream_st {
   svn_stream_t *in_stream;
   svn_stream_t *out_stream;
   void *timeout_baton;
   ra_svn_timeout_fn_t timeout_fn;
-};
 
-typedef struct sock_baton_t {
+  /* The socket underlying OUT_STREAM, if we may write to it directly. */
   apr_socket_t *sock;
-  apr_pool_t *pool;
-} sock_baton_t;
+
+  /* Baton of the socket streams.  NULL for other streams. */
+  sock_baton_t *sock_baton;
+};
 
 
 /* Returns TRUE if PFD has pending data, FALSE otherwise. */
@@ -109,16 +119,19 @@ sock_read_cb(void *baton, char *buffer, apr_size_t *len)
   if (status)
     return svn_error_wrap_apr(status, _("Can't get socket timeout"));
 
-  /* Always block on read.
+  /* Always block on read, unless a read timeout has been set.
    * During pipelining, we set the timeout to 0 for some write
    * operations so that we can try them without blocking. If APR had
    * separate timeouts for read and write, we would only set the
    * write timeout, but it doesn't. So here, we revert back to blocking.
    */
-  apr_socket_timeout_set(b->sock, -1);
+  apr_socket_timeout_set(b->sock, b->read_timeout);
   status = apr_socket_recv(b->sock, buffer, len);
   apr_socket_timeout_set(b->sock, interval);
 
+  if (APR_STATUS_IS_TIMEUP(status))
+    return svn_error_wrap_apr(status, _("Timeout while reading from "
+                                        "connection"));
   if (status && !APR_STATUS_IS_EOF(status))
     return svn_error_wrap_apr(status, _("Can't read from connection"));
   return SVN_NO_ERROR;
@@ -135,6 +148,56 @@ sock_write_cb(void *baton, const char *buffer, apr_size_t *len)
   return SVN_NO_ERROR;
 }
 
+/* Maximum number of buffers to pass to a single apr_socket_sendv() call.
+   This is well below IOV_MAX on all relevant platforms. */
+#define SOCK_WRITEV_MAX 16
+
+/* Implements svn_stream_writev_fn_t */
+static svn_error_t *
+sock_writev_cb(void *baton, const struct iovec *vec, int nvec)
+{
+  sock_baton_t *b = baton;
+  struct iovec chunk[SOCK_WRITEV_MAX];
+  int first = 0;
+
+  while (first < nvec)
+    {
+      struct iovec *next = chunk;
+      int count = 0;
+
+      /* Copy the next batch of buffers such that partial sends can
+         simply update our local copy. */
+      for (; first < nvec && count < SOCK_WRITEV_MAX; ++first)
+        if (vec[first].iov_len)
+          chunk[count++] = vec[first];
+
+      while (count > 0)
+        {
+          apr_size_t len = 0;
+          apr_status_t status = apr_socket_sendv(b->sock, next, count, &len);
+          if (status)
+            return svn_error_wrap_apr(status,
+                                      _("Can't write to connection"));
+
+          /* Skip what has been sent. */
+          while (count > 0 && len >= next->iov_len)
+            {
+              len -= next->iov_len;
+              ++next;
+              --count;
+            }
+
+          if (count > 0)
+            {
+              next->iov_base = (char *)next->iov_base + len;
+              next->iov_len -= len;
+            }
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Implements ra_svn_timeout_fn_t */
 static void
 sock_timeout_cb(void *baton, apr_interval_time_t interval)
@@ -167,18 +230,25 @@ svn_ra_svn__stream_from_sock(apr_socket_t *sock,
 {
   sock_baton_t *b = apr_palloc(result_pool, sizeof(*b));
   svn_stream_t *sock_stream;
+  svn_ra_svn__stream_t *stream;
 
   b->sock = sock;
   b->pool = svn_pool_create(result_pool);
+  b->read_timeout = -1;
 
   sock_stream = svn_stream_create(b, result_pool);
 
   svn_stream_set_read2(sock_stream, sock_read_cb, NULL /* use default */);
   svn_stream_set_write(sock_stream, sock_write_cb);
+  svn_stream_set_writev(sock_stream, sock_writev_cb);
   svn_stream_set_data_available(sock_stream, sock_pending_cb);
 
-  return svn_ra_svn__stream_create(sock_stream, sock_stream,
-                                   b, sock_timeout_cb, result_pool);
+  stream = svn_ra_svn__stream_create(sock_stream, sock_stream,
+                                     b, sock_timeout_cb, result_pool);
+  stream->sock = sock;
+  stream->sock_baton = b;
+
+  return stream;
 }
 
 svn_ra_svn__stream_t *
@@ -193,6 +263,8 @@ svn_ra_svn__stream_create(svn_stream_t *in_stream,
   s->out_stream = out_stream;
   s->timeout_baton = timeout_baton;
   s->timeout_fn = timeout_cb;
+  s->sock = NULL;
+  s->sock_baton = NULL;
   return s;
 }
 
@@ -203,6 +275,75 @@ svn_ra_svn__stream_write(svn_ra_svn__stream_t *stream,
   return svn_error_trace(svn_stream_write(stream->out_stream, data, len));
 }
 
+svn_error_t *
+svn_ra_svn__stream_writev(svn_ra_svn__stream_t *stream,
+                          const struct iovec *vec, int nvec)
+{
+  return svn_error_trace(svn_stream_writev(stream->out_stream, vec, nvec));
+}
+
+svn_error_t *
+svn_ra_svn__stream_sendfile(svn_ra_svn__stream_t *stream,
+                            apr_file_t *file,
+                            apr_off_t offset,
+                            apr_size_t len,
+                            apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool;
+  char *buffer;
+
+#if APR_HAS_SENDFILE
+  if (stream->sock)
+    {
+      apr_interval_time_t interval;
+      apr_status_t status;
+
+      /* Like sock_write_cb, always block while sending. */
+      status = apr_socket_timeout_get(stream->sock, &interval);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't get socket timeout"));
+
+      apr_socket_timeout_set(stream->sock, -1);
+      while (len > 0 && status == APR_SUCCESS)
+        {
+          apr_size_t sent = len;
+
+          status = apr_socket_sendfile(stream->sock, file, NULL, &offset,
+                                       &sent, 0);
+          if (status == APR_SUCCESS && sent == 0)
+            status = APR_EOF;
+
+          offset += sent;
+          len -= sent;
+        }
+      apr_socket_timeout_set(stream->sock, interval);
+
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't write to connection"));
+
+      return SVN_NO_ERROR;
+    }
+#endif
+
+  /* Copy the data through a buffer. */
+  buffer = apr_palloc(scratch_pool, SVN__STREAM_CHUNK_SIZE);
+  iterpool = svn_pool_create(scratch_pool);
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, iterpool));
+  while (len > 0)
+    {
+      apr_size_t chunk = MIN(len, SVN__STREAM_CHUNK_SIZE);
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_io_file_read_full2(file, buffer, chunk, NULL, NULL,
+                                     iterpool));
+      SVN_ERR(svn_stream_write(stream->out_stream, buffer, &chunk));
+      len -= chunk;
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_ra_svn__stream_read(svn_ra_svn__stream_t *stream, char *data,
                         apr_size_t *len)
@@ -222,6 +363,14 @@ svn_ra_svn__stream_timeout(svn_ra_svn__stream_t *stream,
   stream->timeout_fn(stream->timeout_baton, interval);
 }
 
+void
+svn_ra_svn__stream_read_timeout(svn_ra_svn__stream_t *stream,
+                                apr_interval_time_t interval)
+{
+  if (stream->sock_baton)
+    stream->sock_baton->read_timeout = interval;
+}
+
 svn_error_t *
 svn_ra_svn__stream_data_available(svn_ra_svn__stream_t *stream,
                                   svn_boolean_t *data_available)
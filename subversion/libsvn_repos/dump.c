@@ -22,6 +22,7 @@
 
 
 #include <stdarg.h>
+#include <string.h>
 
 #include "svn_private_config.h"
 #include "svn_pools.h"
@@ -489,11 +490,19 @@ svn_repos__dumpfile_header_pushf(svn_repos__dumpfile_headers_t *headers,
   va_end(ap);
 }
 
-svn_error_t *
-svn_repos__dump_headers(svn_stream_t *stream,
-                        svn_repos__dumpfile_headers_t *headers,
-                        apr_pool_t *scratch_pool)
+/* Write HEADERS, the blank line that ends them and the optional BODY
+ * to STREAM in a single gathering write.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+write_headers_and_body(svn_stream_t *stream,
+                       svn_repos__dumpfile_headers_t *headers,
+                       const svn_stringbuf_t *body,
+                       apr_pool_t *scratch_pool)
 {
+  struct iovec *vec = apr_palloc(scratch_pool,
+                                 (4 * headers->nelts + 2) * sizeof(*vec));
+  int nvec = 0;
   int i;
 
   for (i = 0; i < headers->nelts; i++)
@@ -501,14 +510,36 @@ svn_repos__dump_headers(svn_stream_t *stream,
       svn_repos__dumpfile_header_entry_t *h
         = &APR_ARRAY_IDX(headers, i, svn_repos__dumpfile_header_entry_t);
 
-      SVN_ERR(svn_stream_printf(stream, scratch_pool,
-                                "%s: %s\n", h->key, h->val));
+      vec[nvec].iov_base = (void *)h->key;
+      vec[nvec++].iov_len = strlen(h->key);
+      vec[nvec].iov_base = (void *)": ";
+      vec[nvec++].iov_len = 2;
+      vec[nvec].iov_base = (void *)h->val;
+      vec[nvec++].iov_len = strlen(h->val);
+      vec[nvec].iov_base = (void *)"\n";
+      vec[nvec++].iov_len = 1;
     }
 
   /* End of headers */
-  SVN_ERR(svn_stream_puts(stream, "\n"));
+  vec[nvec].iov_base = (void *)"\n";
+  vec[nvec++].iov_len = 1;
 
-  return SVN_NO_ERROR;
+  if (body)
+    {
+      vec[nvec].iov_base = body->data;
+      vec[nvec++].iov_len = body->len;
+    }
+
+  return svn_error_trace(svn_stream_writev(stream, vec, nvec));
+}
+
+svn_error_t *
+svn_repos__dump_headers(svn_stream_t *stream,
+                        svn_repos__dumpfile_headers_t *headers,
+                        apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(write_headers_and_body(stream, headers, NULL,
+                                                scratch_pool));
 }
 
 svn_error_t *
@@ -521,6 +552,8 @@ svn_repos__dump_revision_record(svn_stream_t *dump_stream,
 {
   svn_stringbuf_t *propstring = NULL;
   apr_hash_t *headers;
+  struct iovec vec[3];
+  int nvec = 0;
 
   if (extra_headers)
     headers = apr_hash_copy(scratch_pool, extra_headers);
@@ -557,19 +590,18 @@ svn_repos__dump_revision_record(svn_stream_t *dump_stream,
 
   SVN_ERR(write_revision_headers(dump_stream, headers, scratch_pool));
 
-  /* End of headers */
-  SVN_ERR(svn_stream_puts(dump_stream, "\n"));
-
-  /* Property data. */
+  /* End of headers, property data and the end of the revision */
+  vec[nvec].iov_base = (void *)"\n";
+  vec[nvec++].iov_len = 1;
   if (propstring)
     {
-      SVN_ERR(svn_stream_write(dump_stream, propstring->data, &propstring->len));
+      vec[nvec].iov_base = propstring->data;
+      vec[nvec++].iov_len = propstring->len;
     }
+  vec[nvec].iov_base = (void *)"\n";
+  vec[nvec++].iov_len = 1;
 
-  /* put an end to revision */
-  SVN_ERR(svn_stream_puts(dump_stream, "\n"));
-
-  return SVN_NO_ERROR;
+  return svn_error_trace(svn_stream_writev(dump_stream, vec, nvec));
 }
 
 svn_error_t *
@@ -605,15 +637,9 @@ svn_repos__dump_node_record(svn_stream_t *dump_stream,
         "%" SVN_FILESIZE_T_FMT, content_length);
     }
 
-  /* write the headers */
-  SVN_ERR(svn_repos__dump_headers(dump_stream, headers, scratch_pool));
-
-  /* write the props */
-  if (props_str)
-    {
-      SVN_ERR(svn_stream_write(dump_stream, props_str->data, &props_str->len));
-    }
-  return SVN_NO_ERROR;
+  /* write the headers and the props */
+  return svn_error_trace(write_headers_and_body(dump_stream, headers,
+                                                props_str, scratch_pool));
 }
 
 /*----------------------------------------------------------------------*/
@@ -1922,28 +1948,22 @@ get_dump_editor(const svn_delta_editor_t **editor,
 
 /* Helper for svn_repos_dump_fs.
 
-   Write a revision record of REV in REPOS to writable STREAM, using POOL.
-   Dump revision properties as well if INCLUDE_REVPROPS has been set.
-   AUTHZ_FUNC and AUTHZ_BATON are passed directly to the repos layer.
+   Write a revision record of REV with revision properties PROPS to
+   writable STREAM, using POOL.  PROPS will not be modified.  Dump the
+   revision properties only if INCLUDE_REVPROPS has been set.
  */
 static svn_error_t *
 write_revision_record(svn_stream_t *stream,
-                      svn_repos_t *repos,
                       svn_revnum_t rev,
+                      apr_hash_t *props,
                       svn_boolean_t include_revprops,
-                      svn_repos_authz_func_t authz_func,
-                      void *authz_baton,
                       apr_pool_t *pool)
 {
-  apr_hash_t *props;
   apr_time_t timetemp;
   svn_string_t *datevalue;
 
   if (include_revprops)
     {
-      SVN_ERR(svn_repos_fs_revision_proplist(&props, repos, rev,
-                                             authz_func, authz_baton, pool));
-
       /* Run revision date properties through the time conversion to
         canonicalize them. */
       /* ### Remove this when it is no longer needed for sure. */
@@ -1953,6 +1973,7 @@ write_revision_record(svn_stream_t *stream,
           SVN_ERR(svn_time_from_cstring(&timetemp, datevalue->data, pool));
           datevalue = svn_string_create(svn_time_to_cstring(timetemp, pool),
                                         pool);
+          props = apr_hash_copy(pool, props);
           svn_hash_sets(props, SVN_PROP_REVISION_DATE, datevalue);
         }
     }
@@ -1991,6 +2012,121 @@ dump_filter_authz_func(svn_boolean_t *allowed,
 }
 
 
+/* Baton for dump_revision(). */
+typedef struct dump_revision_baton_t
+{
+  svn_fs_t *fs;
+  svn_stream_t *stream;
+
+  /* Parameters as passed to svn_repos_dump_fs4. */
+  svn_revnum_t start_rev;
+  svn_boolean_t incremental;
+  svn_boolean_t use_deltas;
+  svn_boolean_t include_revprops;
+  svn_boolean_t include_changes;
+
+  /* Set when we found references to revisions before START_REV. */
+  svn_boolean_t *found_old_reference;
+  svn_boolean_t *found_old_mergeinfo;
+
+  svn_repos_notify_func_t notify_func;
+  void *notify_baton;
+
+  /* Notification object to reuse for every revision. */
+  svn_repos_notify_t *notify;
+
+  svn_repos_authz_func_t authz_func;
+  dump_filter_baton_t *authz_baton;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} dump_revision_baton_t;
+
+/* Implements svn_fs_revision_proplist_receiver_t.
+
+   Dump REVISION with revision properties PROPS as described by BATON.
+   PROPS may be NULL, if BATON->INCLUDE_REVPROPS is not set. */
+static svn_error_t *
+dump_revision(void *baton,
+              svn_revnum_t revision,
+              apr_hash_t *props,
+              apr_pool_t *scratch_pool)
+{
+  dump_revision_baton_t *b = baton;
+  const svn_delta_editor_t *dump_editor;
+  void *dump_edit_baton;
+  svn_fs_root_t *to_root;
+  svn_boolean_t use_deltas_for_rev;
+
+  /* Check for cancellation. */
+  if (b->cancel_func)
+    SVN_ERR(b->cancel_func(b->cancel_baton));
+
+  /* Write the revision record. */
+  SVN_ERR(write_revision_record(b->stream, revision, props,
+                                b->include_revprops, scratch_pool));
+
+  /* When dumping revision 0, we just write out the revision record.
+     The parser might want to use its properties.
+     If we don't want revision changes at all, skip in any case. */
+  if (revision == 0 || !b->include_changes)
+    goto done;
+
+  /* Fetch the editor which dumps nodes to a file.  Regardless of
+     what we've been told, don't use deltas for the first rev of a
+     non-incremental dump. */
+  use_deltas_for_rev = b->use_deltas
+                    && (b->incremental || revision != b->start_rev);
+  SVN_ERR(get_dump_editor(&dump_editor, &dump_edit_baton, b->fs, revision,
+                          "", b->stream, b->found_old_reference,
+                          b->found_old_mergeinfo, NULL,
+                          b->notify_func, b->notify_baton,
+                          b->start_rev, use_deltas_for_rev, FALSE, FALSE,
+                          scratch_pool));
+
+  /* Drive the editor in one way or another. */
+  SVN_ERR(svn_fs_revision_root(&to_root, b->fs, revision, scratch_pool));
+
+  /* If this is the first revision of a non-incremental dump,
+     we're in for a full tree dump.  Otherwise, we want to simply
+     replay the revision.  */
+  if ((revision == b->start_rev) && (! b->incremental))
+    {
+      /* Compare against revision 0, so everything appears to be added. */
+      svn_fs_root_t *from_root;
+      SVN_ERR(svn_fs_revision_root(&from_root, b->fs, 0, scratch_pool));
+      SVN_ERR(svn_repos_dir_delta2(from_root, "", "",
+                                   to_root, "",
+                                   dump_editor, dump_edit_baton,
+                                   b->authz_func, b->authz_baton,
+                                   FALSE, /* don't send text-deltas */
+                                   svn_depth_infinity,
+                                   FALSE, /* don't send entry props */
+                                   FALSE, /* don't ignore ancestry */
+                                   scratch_pool));
+    }
+  else
+    {
+      /* The normal case: compare consecutive revs. */
+      SVN_ERR(svn_repos_replay2(to_root, "", SVN_INVALID_REVNUM, FALSE,
+                                dump_editor, dump_edit_baton,
+                                b->authz_func, b->authz_baton,
+                                scratch_pool));
+
+      /* While our editor close_edit implementation is a no-op, we still
+         do this for completeness. */
+      SVN_ERR(dump_editor->close_edit(dump_edit_baton, scratch_pool));
+    }
+
+ done:
+  if (b->notify_func)
+    {
+      b->notify->revision = revision;
+      b->notify_func(b->notify_baton, b->notify, scratch_pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 
 /* The main dumper. */
 svn_error_t *
@@ -2010,8 +2146,6 @@ svn_repos_dump_fs4(svn_repos_t *repos,
                    void *cancel_baton,
                    apr_pool_t *pool)
 {
-  const svn_delta_editor_t *dump_editor;
-  void *dump_edit_baton = NULL;
   svn_revnum_t rev;
   svn_fs_t *fs = svn_repos_fs(repos);
   apr_pool_t *iterpool = svn_pool_create(pool);
@@ -2020,9 +2154,10 @@ svn_repos_dump_fs4(svn_repos_t *repos,
   int version;
   svn_boolean_t found_old_reference = FALSE;
   svn_boolean_t found_old_mergeinfo = FALSE;
-  svn_repos_notify_t *notify;
+  svn_repos_notify_t *notify = NULL;
   svn_repos_authz_func_t authz_func;
   dump_filter_baton_t authz_baton = {0};
+  dump_revision_baton_t baton;
 
   /* Make sure we catch up on the latest revprop changes.  This is the only
    * time we will refresh the revprop data in this query. */
@@ -2088,76 +2223,37 @@ svn_repos_dump_fs4(svn_repos_t *repos,
                                      pool);
 
   /* Main loop:  we're going to dump revision REV.  */
-  for (rev = start_rev; rev <= end_rev; rev++)
+  baton.fs = fs;
+  baton.stream = stream;
+  baton.start_rev = start_rev;
+  baton.incremental = incremental;
+  baton.use_deltas = use_deltas;
+  baton.include_revprops = include_revprops;
+  baton.include_changes = include_changes;
+  baton.found_old_reference = &found_old_reference;
+  baton.found_old_mergeinfo = &found_old_mergeinfo;
+  baton.notify_func = notify_func;
+  baton.notify_baton = notify_baton;
+  baton.notify = notify;
+  baton.authz_func = authz_func;
+  baton.authz_baton = &authz_baton;
+  baton.cancel_func = cancel_func;
+  baton.cancel_baton = cancel_baton;
+
+  /* Fetch the revprops for the whole range in one go. */
+  if (include_revprops)
     {
-      svn_fs_root_t *to_root;
-      svn_boolean_t use_deltas_for_rev;
-
-      svn_pool_clear(iterpool);
-
-      /* Check for cancellation. */
-      if (cancel_func)
-        SVN_ERR(cancel_func(cancel_baton));
-
-      /* Write the revision record. */
-      SVN_ERR(write_revision_record(stream, repos, rev, include_revprops,
-                                    authz_func, &authz_baton, iterpool));
-
-      /* When dumping revision 0, we just write out the revision record.
-         The parser might want to use its properties.
-         If we don't want revision changes at all, skip in any case. */
-      if (rev == 0 || !include_changes)
-        goto loop_end;
-
-      /* Fetch the editor which dumps nodes to a file.  Regardless of
-         what we've been told, don't use deltas for the first rev of a
-         non-incremental dump. */
-      use_deltas_for_rev = use_deltas && (incremental || rev != start_rev);
-      SVN_ERR(get_dump_editor(&dump_editor, &dump_edit_baton, fs, rev,
-                              "", stream, &found_old_reference,
-                              &found_old_mergeinfo, NULL,
-                              notify_func, notify_baton,
-                              start_rev, use_deltas_for_rev, FALSE, FALSE,
-                              iterpool));
-
-      /* Drive the editor in one way or another. */
-      SVN_ERR(svn_fs_revision_root(&to_root, fs, rev, iterpool));
-
-      /* If this is the first revision of a non-incremental dump,
-         we're in for a full tree dump.  Otherwise, we want to simply
-         replay the revision.  */
-      if ((rev == start_rev) && (! incremental))
-        {
-          /* Compare against revision 0, so everything appears to be added. */
-          svn_fs_root_t *from_root;
-          SVN_ERR(svn_fs_revision_root(&from_root, fs, 0, iterpool));
-          SVN_ERR(svn_repos_dir_delta2(from_root, "", "",
-                                       to_root, "",
-                                       dump_editor, dump_edit_baton,
-                                       authz_func, &authz_baton,
-                                       FALSE, /* don't send text-deltas */
-                                       svn_depth_infinity,
-                                       FALSE, /* don't send entry props */
-                                       FALSE, /* don't ignore ancestry */
-                                       iterpool));
-        }
-      else
-        {
-          /* The normal case: compare consecutive revs. */
-          SVN_ERR(svn_repos_replay2(to_root, "", SVN_INVALID_REVNUM, FALSE,
-                                    dump_editor, dump_edit_baton,
-                                    authz_func, &authz_baton, iterpool));
-
-          /* While our editor close_edit implementation is a no-op, we still
-             do this for completeness. */
-          SVN_ERR(dump_editor->close_edit(dump_edit_baton, iterpool));
-        }
-
-    loop_end:
-      if (notify_func)
+      SVN_ERR(svn_repos_fs_revision_proplists(repos, start_rev, end_rev,
+                                              authz_func, &authz_baton,
+                                              dump_revision, &baton,
+                                              iterpool));
+    }
+  else
+    {
+      for (rev = start_rev; rev <= end_rev; rev++)
         {
-          notify->revision = rev;
-          notify_func(notify_baton, notify, iterpool);
+          svn_pool_clear(iterpool);
+          SVN_ERR(dump_revision(&baton, rev, NULL, iterpool));
         }
     }
 
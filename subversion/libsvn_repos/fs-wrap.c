@@ -36,6 +36,7 @@
 #include "svn_subst.h"
 #include "repos.h"
 #include "svn_private_config.h"
+#include "private/svn_fs_private.h"
 #include "private/svn_repos_private.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_utf_private.h"
@@ -497,20 +498,14 @@ svn_repos_fs_revision_prop(svn_string_t **value_p,
 
 
 
-svn_error_t *
-svn_repos_fs_revision_proplist(apr_hash_t **table_p,
-                               svn_repos_t *repos,
-                               svn_revnum_t rev,
-                               svn_repos_authz_func_t authz_read_func,
-                               void *authz_read_baton,
-                               apr_pool_t *pool)
+/* Set *TABLE_P to the subset of PROPLIST that may be seen with the
+   READABILITY of the revision.  Allocate the result in POOL. */
+static void
+filter_revprops(apr_hash_t **table_p,
+                apr_hash_t *proplist,
+                svn_repos_revision_access_level_t readability,
+                apr_pool_t *pool)
 {
-  svn_repos_revision_access_level_t readability;
-
-  SVN_ERR(svn_repos_check_revision_access(&readability, repos, rev,
-                                          authz_read_func, authz_read_baton,
-                                          pool));
-
   if (readability == svn_repos_revision_access_none)
     {
       /* Return an empty hash. */
@@ -518,33 +513,110 @@ svn_repos_fs_revision_proplist(apr_hash_t **table_p,
     }
   else if (readability == svn_repos_revision_access_partial)
     {
-      apr_hash_t *tmphash;
       svn_string_t *value;
 
-      /* Produce two property hashtables, both in POOL. */
-      SVN_ERR(svn_fs_revision_proplist2(&tmphash, repos->fs, rev, TRUE,
-                                        pool, pool));
       *table_p = apr_hash_make(pool);
 
       /* If they exist, we only copy svn:author and svn:date into the
          'real' hashtable being returned. */
-      value = svn_hash_gets(tmphash, SVN_PROP_REVISION_AUTHOR);
+      value = svn_hash_gets(proplist, SVN_PROP_REVISION_AUTHOR);
       if (value)
         svn_hash_sets(*table_p, SVN_PROP_REVISION_AUTHOR, value);
 
-      value = svn_hash_gets(tmphash, SVN_PROP_REVISION_DATE);
+      value = svn_hash_gets(proplist, SVN_PROP_REVISION_DATE);
       if (value)
         svn_hash_sets(*table_p, SVN_PROP_REVISION_DATE, value);
     }
   else /* wholly readable revision */
     {
-      SVN_ERR(svn_fs_revision_proplist2(table_p, repos->fs, rev, TRUE,
-                                        pool, pool));
+      *table_p = proplist;
+    }
+}
+
+svn_error_t *
+svn_repos_fs_revision_proplist(apr_hash_t **table_p,
+                               svn_repos_t *repos,
+                               svn_revnum_t rev,
+                               svn_repos_authz_func_t authz_read_func,
+                               void *authz_read_baton,
+                               apr_pool_t *pool)
+{
+  svn_repos_revision_access_level_t readability;
+  apr_hash_t *proplist;
+
+  SVN_ERR(svn_repos_check_revision_access(&readability, repos, rev,
+                                          authz_read_func, authz_read_baton,
+                                          pool));
+
+  if (readability == svn_repos_revision_access_none)
+    {
+      /* Return an empty hash. */
+      *table_p = apr_hash_make(pool);
+      return SVN_NO_ERROR;
     }
 
+  SVN_ERR(svn_fs_revision_proplist2(&proplist, repos->fs, rev, TRUE,
+                                    pool, pool));
+  filter_revprops(table_p, proplist, readability, pool);
+
   return SVN_NO_ERROR;
 }
 
+/* Baton for revision_proplists_receiver(). */
+struct revision_proplists_baton_t
+{
+  svn_repos_t *repos;
+  svn_repos_authz_func_t authz_read_func;
+  void *authz_read_baton;
+  svn_fs_revision_proplist_receiver_t receiver;
+  void *receiver_baton;
+};
+
+/* Implements svn_fs_revision_proplist_receiver_t.  Filter PROPLIST
+   according to the authz settings in BATON and pass it on. */
+static svn_error_t *
+revision_proplists_receiver(void *baton,
+                            svn_revnum_t revision,
+                            apr_hash_t *proplist,
+                            apr_pool_t *scratch_pool)
+{
+  struct revision_proplists_baton_t *b = baton;
+  svn_repos_revision_access_level_t readability;
+
+  SVN_ERR(svn_repos_check_revision_access(&readability, b->repos, revision,
+                                          b->authz_read_func,
+                                          b->authz_read_baton,
+                                          scratch_pool));
+  filter_revprops(&proplist, proplist, readability, scratch_pool);
+
+  return svn_error_trace(b->receiver(b->receiver_baton, revision, proplist,
+                                     scratch_pool));
+}
+
+svn_error_t *
+svn_repos_fs_revision_proplists(svn_repos_t *repos,
+                                svn_revnum_t start,
+                                svn_revnum_t end,
+                                svn_repos_authz_func_t authz_read_func,
+                                void *authz_read_baton,
+                                svn_fs_revision_proplist_receiver_t receiver,
+                                void *receiver_baton,
+                                apr_pool_t *scratch_pool)
+{
+  struct revision_proplists_baton_t baton;
+
+  baton.repos = repos;
+  baton.authz_read_func = authz_read_func;
+  baton.authz_read_baton = authz_read_baton;
+  baton.receiver = receiver;
+  baton.receiver_baton = receiver_baton;
+
+  return svn_error_trace(svn_fs_revision_proplists(repos->fs, start, end,
+                                                   TRUE,
+                                                   revision_proplists_receiver,
+                                                   &baton, scratch_pool));
+}
+
 struct lock_many_baton_t {
   svn_boolean_t need_lock;
   apr_array_header_t *paths;
@@ -1051,6 +1123,68 @@ svn_repos_fs_pack2(svn_repos_t *repos,
                      cancel_func, cancel_baton, pool);
 }
 
+struct index_notify_baton
+{
+  svn_repos_notify_func_t notify_func;
+  void *notify_baton;
+  svn_repos_notify_action_t action;
+};
+
+/* Implements svn_fs_progress_notify_func_t. */
+static void
+index_notify_func(svn_revnum_t revision,
+                  void *baton,
+                  apr_pool_t *pool)
+{
+  struct index_notify_baton *inb = baton;
+  svn_repos_notify_t *notify = svn_repos_notify_create(inb->action, pool);
+
+  notify->revision = revision;
+  inb->notify_func(inb->notify_baton, notify, pool);
+}
+
+svn_error_t *
+svn_repos_build_path_index(svn_repos_t *repos,
+                           svn_repos_notify_func_t notify_func,
+                           void *notify_baton,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *scratch_pool)
+{
+  struct index_notify_baton inb;
+
+  inb.notify_func = notify_func;
+  inb.notify_baton = notify_baton;
+  inb.action = svn_repos_notify_path_index_rev;
+
+  return svn_error_trace(svn_fs__build_path_index(
+                            repos->fs,
+                            notify_func ? index_notify_func : NULL,
+                            notify_func ? &inb : NULL,
+                            cancel_func, cancel_baton, scratch_pool));
+}
+
+svn_error_t *
+svn_repos_build_date_index(svn_repos_t *repos,
+                           svn_repos_notify_func_t notify_func,
+                           void *notify_baton,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *scratch_pool)
+{
+  struct index_notify_baton inb;
+
+  inb.notify_func = notify_func;
+  inb.notify_baton = notify_baton;
+  inb.action = svn_repos_notify_date_index_rev;
+
+  return svn_error_trace(svn_fs__build_date_index(
+                            repos->fs,
+                            notify_func ? index_notify_func : NULL,
+                            notify_func ? &inb : NULL,
+                            cancel_func, cancel_baton, scratch_pool));
+}
+
 svn_error_t *
 svn_repos_fs_get_inherited_props(apr_array_header_t **inherited_props_p,
                                  svn_fs_root_t *root,
@@ -0,0 +1,767 @@
+/* hook_queue.c : running post-operation hooks in the background
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include <apr_thread_pool.h>
+#include <apr_thread_cond.h>
+
+#include "svn_config.h"
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_repos.h"
+#include "svn_sorts.h"
+#include "svn_string.h"
+#include "repos.h"
+#include "svn_private_config.h"
+
+#include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
+#include "private/svn_repos_private.h"
+#include "private/svn_sorts_private.h"
+
+/* Options in the hooks-queue configuration file. */
+#define CONFIG_SECTION_QUEUE            "queue"
+#define CONFIG_OPTION_ENABLED           "enabled"
+#define CONFIG_OPTION_MAX_CONCURRENCY   "max-concurrency"
+
+/* Files in the spool directory besides the queue entries. */
+#define LOCK_FILE_NAME                  "lock"
+#define SEQUENCE_FILE_NAME              "sequence"
+
+/* Entries that could not be run successfully get this extension. */
+#define FAILED_EXT                      ".failed"
+
+/* Queue entries are named after their zero-padded sequence number, such
+ * that lexical order is queue order. */
+#define ENTRY_NAME_LEN                  20
+
+/* Keys used in the hash files describing a queued hook invocation. */
+#define NAME_KEY                        "name"
+#define CMD_KEY                         "cmd"
+#define ARG_KEY_PREFIX                  "arg:"
+#define ENV_KEY_PREFIX                  "env:"
+#define STDIN_KEY                       "stdin"
+
+/* Handy macro to check APR function results and turning them into
+ * svn_error_t upon failure. */
+#define WRAP_APR_ERR(x,msg)                     \
+  {                                             \
+    apr_status_t status_ = (x);                 \
+    if (status_)                                \
+      return svn_error_wrap_apr(status_, msg);  \
+  }
+
+/* The per-process state of the hook queue of a repository.  All queue
+ * objects live until the process terminates.
+ */
+struct svn_repos__hook_queue_t
+{
+  /* The spool directory and the files within it that coordinate
+   * multiple processes. */
+  const char *spool_dir;
+  const char *lock_path;
+  const char *sequence_path;
+
+  /* Maximum number of hooks that may run concurrently.  The latest
+   * configuration read by any svn_repos_t wins. */
+  int max_concurrency;
+
+  /* Protects all members below. */
+  svn_mutex__t *mutex;
+
+#if APR_HAS_THREADS
+  /* Signalled whenever the queue becomes idle. */
+  apr_thread_cond_t *idle;
+#endif
+
+  /* Names of the entries being run right now, mapped to "". */
+  apr_hash_t *running;
+
+  /* If not NULL, this process holds the spool lock, scoped to this
+   * pool.  Only the process holding the lock may run queued hooks. */
+  apr_pool_t *lock_pool;
+
+  /* Root pool that the queue and all its members are allocated in.
+   * Protected by MUTEX, i.e. independent of other queues. */
+  apr_pool_t *pool;
+};
+
+/* A single queue entry being run. */
+typedef struct hook_job_t
+{
+  svn_repos__hook_queue_t *queue;
+  const char *name;
+
+  /* Thread-safe root pool to use for this job.  Gets destroyed when the
+   * job has been completed. */
+  apr_pool_t *pool;
+} hook_job_t;
+
+/* Maximum number of threads running hooks, throughout the process. */
+#define MAX_THREADS 16
+
+/* Number of microseconds that an unused thread remains in the pool before
+ * being terminated.
+ */
+#define THREADPOOL_THREAD_IDLE_LIMIT 1000000
+
+/* Queues of all repositories used in this process, mapping the absolute
+ * spool directory path to the svn_repos__hook_queue_t.  Allocated in
+ * REGISTRY_POOL and protected by REGISTRY_MUTEX. */
+static apr_hash_t *registry = NULL;
+static svn_mutex__t *registry_mutex = NULL;
+static apr_pool_t *registry_pool = NULL;
+static svn_atomic_t registry_initialized = FALSE;
+
+/* Set by svn_repos__hook_queue_allow_background(). */
+static svn_atomic_t background_allowed = FALSE;
+
+#if APR_HAS_THREADS
+/* Threads running the hooks. */
+static apr_thread_pool_t *thread_pool = NULL;
+#endif
+
+/* Core implementation of init_registry(). */
+static svn_error_t *
+create_registry(void *baton,
+                apr_pool_t *scratch_pool)
+{
+  /* The registry outlives all repository objects and gets accessed from
+     multiple threads. */
+  registry_pool = svn_pool_create(NULL);
+  registry = apr_hash_make(registry_pool);
+  SVN_ERR(svn_mutex__init(&registry_mutex, TRUE, registry_pool));
+
+#if APR_HAS_THREADS
+  WRAP_APR_ERR(apr_thread_pool_create(&thread_pool, 0, MAX_THREADS,
+                                      registry_pool),
+               _("Can't create hook queue thread pool"));
+
+  /* let idle threads linger for a while in case more hooks are queued */
+  apr_thread_pool_idle_wait_set(thread_pool, THREADPOOL_THREAD_IDLE_LIMIT);
+
+  /* don't queue requests unless we reached the worker thread limit */
+  apr_thread_pool_threshold_set(thread_pool, 0);
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* Make sure the queue registry has been initialized. */
+static svn_error_t *
+init_registry(apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(svn_atomic__init_once(&registry_initialized,
+                                               create_registry, NULL,
+                                               scratch_pool));
+}
+
+
+/*** Spool directory access ***/
+
+/* Set *ENTRIES to the sorted names (const char *) of all queue entries in
+ * SPOOL_DIR.  Allocate the result in RESULT_POOL and use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_error_t *
+list_entries(apr_array_header_t **entries,
+             const char *spool_dir,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  apr_hash_t *dirents;
+  apr_hash_index_t *hi;
+  apr_array_header_t *result = apr_array_make(result_pool, 16,
+                                              sizeof(const char *));
+
+  SVN_ERR(svn_io_get_dirents3(&dirents, spool_dir, TRUE, scratch_pool,
+                              scratch_pool));
+
+  for (hi = apr_hash_first(scratch_pool, dirents);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+      apr_ssize_t len = apr_hash_this_key_len(hi);
+      const svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+
+      /* Skip temporaries, failed entries and the coordination files. */
+      if (   dirent->kind == svn_node_file
+          && len == ENTRY_NAME_LEN
+          && strspn(name, "0123456789") == ENTRY_NAME_LEN)
+        APR_ARRAY_PUSH(result, const char *) = apr_pstrdup(result_pool,
+                                                           name);
+    }
+
+  svn_sort__array(result, svn_sort_compare_paths);
+  *entries = result;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the next sequence number for QUEUE in *SEQUENCE.  The caller
+ * must hold the QUEUE's mutex.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+next_sequence(apr_uint64_t *sequence,
+              svn_repos__hook_queue_t *queue,
+              apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  char buffer[ENTRY_NAME_LEN + 1];
+  apr_size_t len = 0;
+  apr_off_t offset = 0;
+  const char *next;
+
+  /* Other processes may push to the same queue.  The file lock serializes
+     them while our mutex serializes the threads within this process. */
+  SVN_ERR(svn_io_file_open(&file, queue->sequence_path,
+                           APR_READ | APR_WRITE | APR_CREATE | APR_BINARY,
+                           APR_OS_DEFAULT, scratch_pool));
+  SVN_ERR(svn_io_lock_open_file(file, TRUE, FALSE, scratch_pool));
+  SVN_ERR(svn_io_file_read_full2(file, buffer, sizeof(buffer) - 1, &len,
+                                 NULL, scratch_pool));
+  buffer[len] = '\0';
+
+  *sequence = len ? apr_strtoi64(buffer, NULL, 10) : 0;
+  next = apr_psprintf(scratch_pool, "%" APR_UINT64_T_FMT, *sequence + 1);
+
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+  SVN_ERR(svn_io_file_trunc(file, 0, scratch_pool));
+  SVN_ERR(svn_io_file_write_full(file, next, strlen(next), NULL,
+                                 scratch_pool));
+  SVN_ERR(svn_io_unlock_open_file(file, scratch_pool));
+
+  return svn_error_trace(svn_io_file_close(file, scratch_pool));
+}
+
+/* Run the hook invocation described by the queue entry file at PATH.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_entry(const char *path,
+          apr_pool_t *scratch_pool)
+{
+  apr_hash_t *entry = apr_hash_make(scratch_pool);
+  apr_hash_t *env = NULL;
+  apr_array_header_t *args = apr_array_make(scratch_pool, 8,
+                                            sizeof(const char *));
+  apr_hash_index_t *hi;
+  svn_stream_t *stream;
+  const svn_string_t *name, *cmd, *arg;
+
+  SVN_ERR(svn_stream_open_readonly(&stream, path, scratch_pool,
+                                   scratch_pool));
+  SVN_ERR(svn_hash_read2(entry, stream, SVN_HASH_TERMINATOR, scratch_pool));
+  SVN_ERR(svn_stream_close(stream));
+
+  name = svn_hash_gets(entry, NAME_KEY);
+  cmd = svn_hash_gets(entry, CMD_KEY);
+  if (!name || !cmd)
+    return svn_error_createf(SVN_ERR_MALFORMED_FILE, NULL,
+                             _("Malformed hook queue entry '%s'"),
+                             svn_dirent_local_style(path, scratch_pool));
+
+  while ((arg = svn_hash_gets(entry,
+                              apr_psprintf(scratch_pool, "%s%d",
+                                           ARG_KEY_PREFIX, args->nelts))))
+    APR_ARRAY_PUSH(args, const char *) = arg->data;
+  APR_ARRAY_PUSH(args, const char *) = NULL;
+
+  for (hi = apr_hash_first(scratch_pool, entry); hi; hi = apr_hash_next(hi))
+    {
+      const char *key = apr_hash_this_key(hi);
+      const svn_string_t *value = apr_hash_this_val(hi);
+
+      if (strncmp(key, ENV_KEY_PREFIX, sizeof(ENV_KEY_PREFIX) - 1) == 0)
+        {
+          if (!env)
+            env = apr_hash_make(scratch_pool);
+          svn_hash_sets(env, key + sizeof(ENV_KEY_PREFIX) - 1, value->data);
+        }
+    }
+
+  return svn_error_trace(svn_repos__hooks_run_queued(
+                           name->data, cmd->data,
+                           (const char **)args->elts, env,
+                           svn_hash_gets(entry, STDIN_KEY),
+                           scratch_pool));
+}
+
+
+/*** Dispatching ***/
+
+/* Release the spool lock of QUEUE and wake up anybody waiting for it to
+ * become idle.  The caller must hold the QUEUE's mutex. */
+static void
+release_lock(svn_repos__hook_queue_t *queue)
+{
+  svn_pool_destroy(queue->lock_pool);
+  queue->lock_pool = NULL;
+#if APR_HAS_THREADS
+  apr_thread_cond_broadcast(queue->idle);
+#endif
+}
+
+/* Set *JOBS to the queue entries (hook_job_t *) to start next in QUEUE.
+ * Take out the spool lock if necessary and release it when QUEUE becomes
+ * idle.  The caller must hold the QUEUE's mutex.  Use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_error_t *
+select_jobs(apr_array_header_t **jobs,
+            svn_repos__hook_queue_t *queue,
+            apr_pool_t *scratch_pool)
+{
+  *jobs = apr_array_make(scratch_pool, 4, sizeof(hook_job_t *));
+
+  while (TRUE)
+    {
+      apr_array_header_t *entries;
+      svn_error_t *err;
+      int i;
+
+      if (!queue->lock_pool)
+        {
+          apr_pool_t *lock_pool = svn_pool_create(NULL);
+          err = svn_io_file_lock2(queue->lock_path, TRUE, TRUE, lock_pool);
+          if (err)
+            {
+              svn_pool_destroy(lock_pool);
+
+              /* Another process is running the queue.  It will pick up
+                 our entries before releasing the lock. */
+              if (APR_STATUS_IS_EAGAIN(err->apr_err))
+                {
+                  svn_error_clear(err);
+                  return SVN_NO_ERROR;
+                }
+
+              return svn_error_trace(err);
+            }
+
+          queue->lock_pool = lock_pool;
+        }
+
+      err = list_entries(&entries, queue->spool_dir, scratch_pool,
+                         scratch_pool);
+      if (err)
+        {
+          /* Don't block other processes if we can't make progress. */
+          if (!apr_hash_count(queue->running))
+            release_lock(queue);
+
+          return svn_error_trace(err);
+        }
+
+      /* Start entries in queue order. */
+      for (i = 0;
+              i < entries->nelts
+           && apr_hash_count(queue->running)
+                < (unsigned int)queue->max_concurrency;
+           ++i)
+        {
+          const char *name = APR_ARRAY_IDX(entries, i, const char *);
+          apr_pool_t *job_pool;
+          hook_job_t *job;
+
+          if (svn_hash_gets(queue->running, name))
+            continue;
+
+          job_pool = svn_pool_create(NULL);
+          job = apr_pcalloc(job_pool, sizeof(*job));
+          job->queue = queue;
+          job->name = apr_pstrdup(job_pool, name);
+          job->pool = job_pool;
+
+          svn_hash_sets(queue->running, job->name, "");
+          APR_ARRAY_PUSH(*jobs, hook_job_t *) = job;
+        }
+
+      /* Keep the lock while we are running hooks. */
+      if (apr_hash_count(queue->running))
+        return SVN_NO_ERROR;
+
+      /* The queue is empty.  Another process may have added entries
+         after we listed the directory but failed to get the lock.  So,
+         check again after releasing it. */
+      release_lock(queue);
+
+      SVN_ERR(list_entries(&entries, queue->spool_dir, scratch_pool,
+                           scratch_pool));
+      if (entries->nelts == 0)
+        return SVN_NO_ERROR;
+    }
+}
+
+/* Run JOB and remove its queue entry.  If it fails, keep the entry with
+ * FAILED_EXT added to its name, so administrators may investigate. */
+static svn_error_t *
+run_job(hook_job_t *job)
+{
+  const char *path = svn_dirent_join(job->queue->spool_dir, job->name,
+                                     job->pool);
+  svn_error_t *err = run_entry(path, job->pool);
+
+  if (err)
+    {
+      svn_error_clear(err);
+      return svn_error_trace(svn_io_file_rename2(path,
+                                                 apr_pstrcat(job->pool, path,
+                                                             FAILED_EXT,
+                                                             SVN_VA_NULL),
+                                                 FALSE, job->pool));
+    }
+
+  return svn_error_trace(svn_io_remove_file2(path, TRUE, job->pool));
+}
+
+/* Remove the finished JOB from its queue's list of running entries and
+ * release its resources. */
+static svn_error_t *
+complete_job(hook_job_t *job)
+{
+  svn_repos__hook_queue_t *queue = job->queue;
+
+  SVN_ERR(svn_mutex__lock(queue->mutex));
+  svn_hash_sets(queue->running, job->name, NULL);
+  svn_pool_destroy(job->pool);
+  SVN_ERR(svn_mutex__unlock(queue->mutex, SVN_NO_ERROR));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+dispatch(svn_repos__hook_queue_t *queue,
+         apr_pool_t *scratch_pool);
+
+#if APR_HAS_THREADS
+
+/* Thread-pool task:  Run the hook_job_t given by DATA and start whatever
+ * entries have become eligible to run. */
+static void * APR_THREAD_FUNC
+job_task(apr_thread_t *tid,
+         void *data)
+{
+  hook_job_t *job = data;
+  svn_repos__hook_queue_t *queue = job->queue;
+  apr_pool_t *scratch_pool;
+
+  /* There is nobody to report errors to.  Failed hooks leave their queue
+     entries behind, though. */
+  svn_error_clear(run_job(job));
+  svn_error_clear(complete_job(job));
+
+  scratch_pool = svn_pool_create(NULL);
+  svn_error_clear(dispatch(queue, scratch_pool));
+  svn_pool_destroy(scratch_pool);
+
+  return NULL;
+}
+
+#endif
+
+/* Start as many entries of QUEUE as permitted.  Use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_error_t *
+dispatch(svn_repos__hook_queue_t *queue,
+         apr_pool_t *scratch_pool)
+{
+  svn_boolean_t ran_inline;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  do
+    {
+      apr_array_header_t *jobs;
+      int i;
+
+      svn_pool_clear(iterpool);
+      ran_inline = FALSE;
+
+      SVN_MUTEX__WITH_LOCK(queue->mutex,
+                           select_jobs(&jobs, queue, iterpool));
+
+      for (i = 0; i < jobs->nelts; ++i)
+        {
+          hook_job_t *job = APR_ARRAY_IDX(jobs, i, hook_job_t *);
+
+#if APR_HAS_THREADS
+          if (apr_thread_pool_push(thread_pool, job_task, job, 0, queue)
+              == APR_SUCCESS)
+            continue;
+#endif
+
+          /* Fall back to running the hook right here.  Afterwards, we
+             need to look for more entries ourselves. */
+          svn_error_clear(run_job(job));
+          SVN_ERR(complete_job(job));
+          ran_inline = TRUE;
+        }
+    }
+  while (ran_inline);
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the queue for the spool directory SPOOL_DIR in *QUEUE_P, creating
+ * it if this process did not use it before.  Set its concurrency limit to
+ * MAX_CONCURRENCY.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+get_queue(svn_repos__hook_queue_t **queue_p,
+          const char *spool_dir,
+          int max_concurrency,
+          apr_pool_t *scratch_pool)
+{
+  svn_repos__hook_queue_t *queue;
+  svn_boolean_t created = FALSE;
+
+  SVN_ERR(init_registry(scratch_pool));
+
+  SVN_ERR(svn_mutex__lock(registry_mutex));
+  queue = svn_hash_gets(registry, spool_dir);
+  if (!queue)
+    {
+      svn_error_t *err;
+
+      /* Queues get modified under their own mutex only.  Hence, they
+         must not share a pool with anything else. */
+      apr_pool_t *pool = svn_pool_create(NULL);
+
+      queue = apr_pcalloc(pool, sizeof(*queue));
+      queue->pool = pool;
+      queue->spool_dir = apr_pstrdup(pool, spool_dir);
+      queue->lock_path = svn_dirent_join(spool_dir, LOCK_FILE_NAME, pool);
+      queue->sequence_path = svn_dirent_join(spool_dir, SEQUENCE_FILE_NAME,
+                                             pool);
+      queue->running = apr_hash_make(pool);
+
+      err = svn_mutex__init(&queue->mutex, TRUE, pool);
+#if APR_HAS_THREADS
+      if (!err)
+        {
+          apr_status_t status = apr_thread_cond_create(&queue->idle, pool);
+          if (status)
+            err = svn_error_wrap_apr(status,
+                                     _("Can't create condition variable"));
+        }
+#endif
+
+      /* The lock file must exist before anybody can lock it. */
+      if (!err)
+        err = svn_io_make_dir_recursively(spool_dir, scratch_pool);
+      if (!err)
+        {
+          apr_file_t *file;
+          err = svn_io_file_open(&file, queue->lock_path,
+                                 APR_WRITE | APR_CREATE, APR_OS_DEFAULT,
+                                 scratch_pool);
+          if (!err)
+            err = svn_io_file_close(file, scratch_pool);
+        }
+
+      if (err)
+        {
+          svn_pool_destroy(pool);
+          return svn_error_trace(svn_mutex__unlock(registry_mutex, err));
+        }
+
+      svn_hash_sets(registry, queue->spool_dir, queue);
+      created = TRUE;
+    }
+
+  queue->max_concurrency = MAX(max_concurrency, 1);
+  SVN_ERR(svn_mutex__unlock(registry_mutex, SVN_NO_ERROR));
+
+  /* Pick up anything left over from previous server runs. */
+  if (created)
+    SVN_ERR(dispatch(queue, scratch_pool));
+
+  *queue_p = queue;
+  return SVN_NO_ERROR;
+}
+
+
+/*** Hook queue API ***/
+
+void
+svn_repos__hook_queue_allow_background(void)
+{
+#if APR_HAS_THREADS
+  svn_atomic_set(&background_allowed, TRUE);
+#endif
+}
+
+svn_error_t *
+svn_repos__hook_queue_get(svn_repos__hook_queue_t **queue_p,
+                          svn_repos_t *repos,
+                          apr_pool_t *scratch_pool)
+{
+  if (!repos->hook_queue_checked)
+    {
+      const char *conf_path = svn_dirent_join(repos->conf_path,
+                                              SVN_REPOS__CONF_HOOKS_QUEUE,
+                                              scratch_pool);
+      svn_node_kind_t kind;
+
+      SVN_ERR(svn_io_check_path(conf_path, &kind, scratch_pool));
+      if (kind == svn_node_file)
+        {
+          svn_config_t *cfg;
+          svn_boolean_t enabled;
+          apr_int64_t max_concurrency;
+
+          SVN_ERR(svn_config_read3(&cfg, conf_path, FALSE, TRUE, TRUE,
+                                   scratch_pool));
+          SVN_ERR(svn_config_get_bool(cfg, &enabled, CONFIG_SECTION_QUEUE,
+                                      CONFIG_OPTION_ENABLED, FALSE));
+          SVN_ERR(svn_config_get_int64(cfg, &max_concurrency,
+                                       CONFIG_SECTION_QUEUE,
+                                       CONFIG_OPTION_MAX_CONCURRENCY, 1));
+
+          /* Hooks running in the background would get killed together
+             with short-lived processes. */
+          if (enabled && svn_atomic_read(&background_allowed))
+            {
+              const char *spool_dir;
+              SVN_ERR(svn_dirent_get_absolute(&spool_dir,
+                                              svn_dirent_join(
+                                                repos->db_path,
+                                                SVN_REPOS__DB_HOOKS_QUEUE,
+                                                scratch_pool),
+                                              scratch_pool));
+              SVN_ERR(get_queue(&repos->hook_queue, spool_dir,
+                                (int)MIN(max_concurrency, MAX_THREADS),
+                                scratch_pool));
+            }
+        }
+
+      repos->hook_queue_checked = TRUE;
+    }
+
+  *queue_p = repos->hook_queue;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_repos__hook_queue_push(svn_repos__hook_queue_t *queue,
+                           const char *name,
+                           const char *cmd,
+                           const char **args,
+                           apr_hash_t *hooks_env,
+                           const svn_string_t *stdin_value,
+                           apr_pool_t *scratch_pool)
+{
+  apr_hash_t *entry = apr_hash_make(scratch_pool);
+  apr_hash_t *hook_env = NULL;
+  svn_stringbuf_t *data = svn_stringbuf_create_empty(scratch_pool);
+  svn_stream_t *stream = svn_stream_from_stringbuf(data, scratch_pool);
+  apr_uint64_t sequence;
+  const char *path;
+  int i;
+
+  svn_hash_sets(entry, NAME_KEY, svn_string_create(name, scratch_pool));
+  svn_hash_sets(entry, CMD_KEY, svn_string_create(cmd, scratch_pool));
+  for (i = 0; args[i]; ++i)
+    svn_hash_sets(entry,
+                  apr_psprintf(scratch_pool, "%s%d", ARG_KEY_PREFIX, i),
+                  svn_string_create(args[i], scratch_pool));
+
+  /* Resolve the environment now, just like run_hook_cmd() would. */
+  if (hooks_env)
+    {
+      hook_env = svn_hash_gets(hooks_env, name);
+      if (hook_env == NULL)
+        hook_env = svn_hash_gets(hooks_env,
+                                 SVN_REPOS__HOOKS_ENV_DEFAULT_SECTION);
+    }
+
+  if (hook_env)
+    {
+      apr_hash_index_t *hi;
+      for (hi = apr_hash_first(scratch_pool, hook_env);
+           hi;
+           hi = apr_hash_next(hi))
+        svn_hash_sets(entry,
+                      apr_pstrcat(scratch_pool, ENV_KEY_PREFIX,
+                                  apr_hash_this_key(hi), SVN_VA_NULL),
+                      svn_string_create(apr_hash_this_val(hi),
+                                        scratch_pool));
+    }
+
+  if (stdin_value)
+    svn_hash_sets(entry, STDIN_KEY, stdin_value);
+
+  SVN_ERR(svn_hash_write2(entry, stream, SVN_HASH_TERMINATOR, scratch_pool));
+
+  /* Write the entry under its final name only once it is complete. */
+  SVN_MUTEX__WITH_LOCK(queue->mutex,
+                       next_sequence(&sequence, queue, scratch_pool));
+  path = svn_dirent_join(queue->spool_dir,
+                         apr_psprintf(scratch_pool,
+                                      "%020" APR_UINT64_T_FMT, sequence),
+                         scratch_pool);
+  SVN_ERR(svn_io_write_atomic2(path, data->data, data->len, NULL, TRUE,
+                               scratch_pool));
+
+  return svn_error_trace(dispatch(queue, scratch_pool));
+}
+
+svn_error_t *
+svn_repos__hook_queue_wait(svn_repos_t *repos,
+                           apr_pool_t *scratch_pool)
+{
+  svn_repos__hook_queue_t *queue;
+  svn_boolean_t idle = FALSE;
+
+  SVN_ERR(svn_repos__hook_queue_get(&queue, repos, scratch_pool));
+  if (!queue)
+    return SVN_NO_ERROR;
+
+  /* This loop implicitly handles spurious wake-ups. */
+  do
+    {
+      apr_status_t status = APR_SUCCESS;
+
+      SVN_ERR(svn_mutex__lock(queue->mutex));
+
+#if APR_HAS_THREADS
+      if (!queue->lock_pool && !apr_hash_count(queue->running))
+        idle = TRUE;
+      else
+        status = apr_thread_cond_wait(queue->idle,
+                                      svn_mutex__get(queue->mutex));
+#else
+      /* Without threads, all hooks run synchronously. */
+      idle = TRUE;
+#endif
+
+      SVN_ERR(svn_mutex__unlock(queue->mutex, SVN_NO_ERROR));
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't wait for condition variable"));
+    }
+  while (!idle);
+
+  return SVN_NO_ERROR;
+}
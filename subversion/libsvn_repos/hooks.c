@@ -302,6 +302,60 @@ create_temp_file(apr_file_t **f, const svn_string_t *value, apr_pool_t *pool)
 }
 
 
+svn_error_t *
+svn_repos__hooks_run_queued(const char *name,
+                            const char *cmd,
+                            const char **args,
+                            apr_hash_t *hook_env,
+                            const svn_string_t *stdin_value,
+                            apr_pool_t *pool)
+{
+  apr_hash_t *hooks_env = NULL;
+  apr_file_t *stdin_handle;
+
+  if (hook_env)
+    {
+      hooks_env = apr_hash_make(pool);
+      svn_hash_sets(hooks_env, name, hook_env);
+    }
+
+  if (stdin_value)
+    SVN_ERR(create_temp_file(&stdin_handle, stdin_value, pool));
+  else
+    SVN_ERR(svn_io_file_open(&stdin_handle, SVN_NULL_DEVICE_NAME,
+                             APR_READ, APR_OS_DEFAULT, pool));
+
+  SVN_ERR(run_hook_cmd(NULL, name, cmd, args, hooks_env, stdin_handle, pool));
+
+  return svn_error_trace(svn_io_file_close(stdin_handle, pool));
+}
+
+/* If REPOS runs post-operation hooks in the background, add the hook
+   NAME to its queue and set *QUEUED.  Otherwise, set *QUEUED to FALSE.
+   CMD, ARGS, HOOKS_ENV and STDIN_VALUE are as for
+   svn_repos__hook_queue_push.  Use POOL for temporary allocations. */
+static svn_error_t *
+queue_hook(svn_boolean_t *queued,
+           svn_repos_t *repos,
+           const char *name,
+           const char *cmd,
+           const char **args,
+           apr_hash_t *hooks_env,
+           const svn_string_t *stdin_value,
+           apr_pool_t *pool)
+{
+  svn_repos__hook_queue_t *queue;
+
+  SVN_ERR(svn_repos__hook_queue_get(&queue, repos, pool));
+  if (queue)
+    SVN_ERR(svn_repos__hook_queue_push(queue, name, cmd, args, hooks_env,
+                                       stdin_value, pool));
+
+  *queued = (queue != NULL);
+  return SVN_NO_ERROR;
+}
+
+
 /* Check if the HOOK program exists and is a file or a symbolic link, using
    POOL for temporary allocations.
 
@@ -603,6 +657,7 @@ svn_repos__hooks_post_commit(svn_repos_t *repos,
   else if (hook)
     {
       const char *args[5];
+      svn_boolean_t queued;
 
       args[0] = hook;
       args[1] = svn_dirent_local_style(svn_repos_path(repos, pool), pool);
@@ -610,8 +665,11 @@ svn_repos__hooks_post_commit(svn_repos_t *repos,
       args[3] = txn_name;
       args[4] = NULL;
 
-      SVN_ERR(run_hook_cmd(NULL, SVN_REPOS__HOOK_POST_COMMIT, hook, args,
-                           hooks_env, NULL, pool));
+      SVN_ERR(queue_hook(&queued, repos, SVN_REPOS__HOOK_POST_COMMIT, hook,
+                         args, hooks_env, NULL, pool));
+      if (!queued)
+        SVN_ERR(run_hook_cmd(NULL, SVN_REPOS__HOOK_POST_COMMIT, hook, args,
+                             hooks_env, NULL, pool));
     }
 
   return SVN_NO_ERROR;
@@ -703,13 +761,7 @@ svn_repos__hooks_post_revprop_change(svn_repos_t *repos,
       const char *args[7];
       apr_file_t *stdin_handle = NULL;
       char action_string[2];
-
-      /* Pass the old value as stdin to hook */
-      if (old_value)
-        SVN_ERR(create_temp_file(&stdin_handle, old_value, pool));
-      else
-        SVN_ERR(svn_io_file_open(&stdin_handle, SVN_NULL_DEVICE_NAME,
-                                 APR_READ, APR_OS_DEFAULT, pool));
+      svn_boolean_t queued;
 
       action_string[0] = action;
       action_string[1] = '\0';
@@ -722,6 +774,18 @@ svn_repos__hooks_post_revprop_change(svn_repos_t *repos,
       args[5] = action_string;
       args[6] = NULL;
 
+      SVN_ERR(queue_hook(&queued, repos, SVN_REPOS__HOOK_POST_REVPROP_CHANGE,
+                         hook, args, hooks_env, old_value, pool));
+      if (queued)
+        return SVN_NO_ERROR;
+
+      /* Pass the old value as stdin to hook */
+      if (old_value)
+        SVN_ERR(create_temp_file(&stdin_handle, old_value, pool));
+      else
+        SVN_ERR(svn_io_file_open(&stdin_handle, SVN_NULL_DEVICE_NAME,
+                                 APR_READ, APR_OS_DEFAULT, pool));
+
       SVN_ERR(run_hook_cmd(NULL, SVN_REPOS__HOOK_POST_REVPROP_CHANGE, hook,
                            args, hooks_env, stdin_handle, pool));
 
@@ -799,8 +863,7 @@ svn_repos__hooks_post_lock(svn_repos_t *repos,
       svn_string_t *paths_str = svn_string_create(svn_cstring_join2
                                                   (paths, "\n", TRUE, pool),
                                                   pool);
-
-      SVN_ERR(create_temp_file(&stdin_handle, paths_str, pool));
+      svn_boolean_t queued;
 
       args[0] = hook;
       args[1] = svn_dirent_local_style(svn_repos_path(repos, pool), pool);
@@ -808,6 +871,12 @@ svn_repos__hooks_post_lock(svn_repos_t *repos,
       args[3] = NULL;
       args[4] = NULL;
 
+      SVN_ERR(queue_hook(&queued, repos, SVN_REPOS__HOOK_POST_LOCK, hook,
+                         args, hooks_env, paths_str, pool));
+      if (queued)
+        return SVN_NO_ERROR;
+
+      SVN_ERR(create_temp_file(&stdin_handle, paths_str, pool));
       SVN_ERR(run_hook_cmd(NULL, SVN_REPOS__HOOK_POST_LOCK, hook, args,
                            hooks_env, stdin_handle, pool));
 
@@ -875,8 +944,7 @@ svn_repos__hooks_post_unlock(svn_repos_t *repos,
       svn_string_t *paths_str = svn_string_create(svn_cstring_join2
                                                   (paths, "\n", TRUE, pool),
                                                   pool);
-
-      SVN_ERR(create_temp_file(&stdin_handle, paths_str, pool));
+      svn_boolean_t queued;
 
       args[0] = hook;
       args[1] = svn_dirent_local_style(svn_repos_path(repos, pool), pool);
@@ -884,6 +952,12 @@ svn_repos__hooks_post_unlock(svn_repos_t *repos,
       args[3] = NULL;
       args[4] = NULL;
 
+      SVN_ERR(queue_hook(&queued, repos, SVN_REPOS__HOOK_POST_UNLOCK, hook,
+                         args, hooks_env, paths_str, pool));
+      if (queued)
+        return SVN_NO_ERROR;
+
+      SVN_ERR(create_temp_file(&stdin_handle, paths_str, pool));
       SVN_ERR(run_hook_cmd(NULL, SVN_REPOS__HOOK_POST_UNLOCK, hook, args,
                            hooks_env, stdin_handle, pool));
 
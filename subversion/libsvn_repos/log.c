@@ -1095,16 +1095,18 @@ get_combined_mergeinfo_changes(svn_mergeinfo_t *added_mergeinfo,
 }
 
 
-/* Fill LOG_ENTRY with history information in FS at REV. */
+/* Fill LOG_ENTRY with history information in FS at REV.  If R_PROPS is
+   not NULL, it contains all revprops of REV; otherwise they will be read
+   from FS as needed. */
 static svn_error_t *
 fill_log_entry(svn_repos_log_entry_t *log_entry,
                svn_revnum_t rev,
                svn_fs_t *fs,
+               apr_hash_t *r_props,
                const apr_array_header_t *revprops,
                const log_callbacks_t *callbacks,
                apr_pool_t *pool)
 {
-  apr_hash_t *r_props;
   svn_boolean_t get_revprops = TRUE, censor_revprops = FALSE;
   svn_boolean_t want_revprops = !revprops || revprops->nelts;
 
@@ -1136,8 +1138,9 @@ fill_log_entry(svn_repos_log_entry_t *log_entry,
   if (get_revprops && want_revprops)
     {
       /* User is allowed to see at least some revprops. */
-      SVN_ERR(svn_fs_revision_proplist2(&r_props, fs, rev, FALSE, pool,
-                                        pool));
+      if (!r_props)
+        SVN_ERR(svn_fs_revision_proplist2(&r_props, fs, rev, FALSE, pool,
+                                          pool));
       if (revprops == NULL)
         {
           /* Requested all revprops... */
@@ -1289,7 +1292,9 @@ interesting_merge(void *baton,
 
    If REVPROPS is NULL, retrieve all revision properties; else, retrieve
    only the revision properties named by the (const char *) array elements
-   (i.e. retrieve none if the array is empty).
+   (i.e. retrieve none if the array is empty).  If R_PROPS is not NULL, it
+   contains all revision properties of REV and FS will not be asked for
+   them.
 
    LOG_TARGET_HISTORY_AS_MERGEINFO, HANDLING_MERGED_REVISION, and
    NESTED_MERGES are as per the arguments of the same name to DO_LOGS.
@@ -1309,6 +1314,7 @@ send_log(svn_revnum_t rev,
          svn_bit_array__t *nested_merges,
          svn_boolean_t subtractive_merge,
          svn_boolean_t handling_merged_revision,
+         apr_hash_t *r_props,
          const apr_array_header_t *revprops,
          svn_boolean_t has_children,
          const log_callbacks_t *callbacks,
@@ -1343,7 +1349,8 @@ send_log(svn_revnum_t rev,
       baton.found_rev_of_interest = TRUE;
     }
 
-  SVN_ERR(fill_log_entry(&log_entry, rev, fs, revprops, callbacks, pool));
+  SVN_ERR(fill_log_entry(&log_entry, rev, fs, r_props, revprops, callbacks,
+                         pool));
   log_entry.has_children = has_children;
   log_entry.subtractive_merge = subtractive_merge;
 
@@ -1381,6 +1388,30 @@ send_log(svn_revnum_t rev,
   return SVN_NO_ERROR;
 }
 
+/* Baton for send_log_receiver(). */
+typedef struct send_log_baton_t
+{
+  svn_fs_t *fs;
+  const apr_array_header_t *revprops;
+  const log_callbacks_t *callbacks;
+} send_log_baton_t;
+
+/* Implements svn_fs_revision_proplist_receiver_t.  Send the log message
+   for REVISION to BATON->CALLBACKS, using the revprops in PROPLIST.
+   There must be no merge tracking involved. */
+static svn_error_t *
+send_log_receiver(void *baton,
+                  svn_revnum_t revision,
+                  apr_hash_t *proplist,
+                  apr_pool_t *scratch_pool)
+{
+  send_log_baton_t *b = baton;
+
+  return svn_error_trace(send_log(revision, b->fs, NULL, NULL,
+                                  FALSE, FALSE, proplist, b->revprops, FALSE,
+                                  b->callbacks, scratch_pool));
+}
+
 /* This controls how many history objects we keep open.  For any targets
    over this number we have to open and close their histories as needed,
    which is CPU intensive, but keeps us from using an unbounded amount of
@@ -1427,6 +1458,7 @@ get_path_histories(apr_array_header_t **histories,
       const char *this_path = APR_ARRAY_IDX(paths, i, const char *);
       struct path_info *info = apr_palloc(pool,
                                           sizeof(struct path_info));
+      apr_array_header_t *revisions;
       svn_pool_clear(iterpool);
 
       if (authz_read_func)
@@ -1443,6 +1475,27 @@ get_path_histories(apr_array_header_t **histories,
       info->history_rev = hist_end;
       info->first_time = TRUE;
 
+      /* If the path index tells us that nothing touched an existing
+         THIS_PATH within the range, its history ends before HIST_START
+         and we don't need to walk it. */
+      SVN_ERR(svn_fs__get_path_revisions(&revisions, fs, this_path,
+                                         hist_start, hist_end,
+                                         iterpool, iterpool));
+      if (revisions && revisions->nelts == 0)
+        {
+          svn_node_kind_t kind;
+          SVN_ERR(svn_fs_check_path(&kind, root, this_path, iterpool));
+          if (kind != svn_node_none)
+            {
+              info->done = TRUE;
+              info->hist = NULL;
+              info->oldpool = NULL;
+              info->newpool = NULL;
+              APR_ARRAY_PUSH(*histories, struct path_info *) = info;
+              continue;
+            }
+        }
+
       if (i < MAX_OPEN_HISTORIES)
         {
           err = svn_fs_node_history2(&info->hist, root, this_path, pool,
@@ -2090,7 +2143,8 @@ do_logs(svn_fs_t *fs,
               SVN_ERR(send_log(current, fs,
                                log_target_history_as_mergeinfo, nested_merges,
                                subtractive_merge, handling_merged_revisions,
-                               revprops, has_children, callbacks, iterpool));
+                               NULL, revprops, has_children, callbacks,
+                               iterpool));
 
               if (has_children) /* Implies include_merged_revisions == TRUE */
                 {
@@ -2189,7 +2243,8 @@ do_logs(svn_fs_t *fs,
           SVN_ERR(send_log(current, fs,
                            log_target_history_as_mergeinfo, nested_merges,
                            subtractive_merge, handling_merged_revisions,
-                           revprops, has_children, callbacks, iterpool));
+                           NULL, revprops, has_children, callbacks,
+                           iterpool));
           if (has_children)
             {
               if (!nested_merges)
@@ -2424,6 +2479,29 @@ svn_repos_get_logs5(svn_repos_t *repos,
       send_count = end - start + 1;
       if (limit > 0 && send_count > limit)
         send_count = limit;
+
+      /* The revisions form a contiguous range, so fetch their revprops
+         in one go. */
+      if (!revprops || revprops->nelts)
+        {
+          send_log_baton_t baton;
+          svn_revnum_t last = descending_order
+                            ? end - (svn_revnum_t)send_count + 1
+                            : start + (svn_revnum_t)send_count - 1;
+
+          baton.fs = fs;
+          baton.revprops = revprops;
+          baton.callbacks = &callbacks;
+
+          SVN_ERR(svn_fs_revision_proplists(fs,
+                                            descending_order ? end : start,
+                                            last, FALSE, send_log_receiver,
+                                            &baton, iterpool));
+
+          svn_pool_destroy(iterpool);
+          return SVN_NO_ERROR;
+        }
+
       for (i = 0; i < send_count; ++i)
         {
           svn_revnum_t rev;
@@ -2435,7 +2513,7 @@ svn_repos_get_logs5(svn_repos_t *repos,
           else
             rev = start + i;
           SVN_ERR(send_log(rev, fs, NULL, NULL,
-                           FALSE, FALSE, revprops, FALSE,
+                           FALSE, FALSE, NULL, revprops, FALSE,
                            &callbacks, iterpool));
         }
       svn_pool_destroy(iterpool);
@@ -452,6 +452,11 @@ create_hooks(svn_repos_t *repos, apr_pool_t *pool)
 "# takes place, and STDERR is returned to the client.   The hook"            NL
 "# program can use the 'svnlook' utility to help it examine the txn."        NL
 "#"                                                                          NL
+"#   Hook programs that run 'svnlook' many times may start a single"         NL
+"#   'svnlook serve' process instead and send it all their queries."         NL
+"#   That process opens the repository only once.  See 'svnlook help"        NL
+"#   serve' for details."                                                    NL
+"#"                                                                          NL
 "#   ***  NOTE: THE HOOK PROGRAM MUST NOT MODIFY THE TXN, EXCEPT  ***"       NL
 "#   ***  FOR REVISION PROPERTIES (like svn:log or svn:author).   ***"       NL
 "#"                                                                          NL
@@ -989,6 +994,43 @@ create_conf(svn_repos_t *repos, apr_pool_t *pool)
               _("Creating hooks-env file"));
   }
 
+  {
+    static const char * const hooks_queue_contents =
+"### This file is an example configuration for running hook scripts in the"  NL
+"### background.  Rename it to 'hooks-queue' to make it take effect."        NL
+"### If enabled, the post-commit, post-revprop-change, post-lock and"        NL
+"### post-unlock hooks are added to a queue instead of being run before"     NL
+"### the client receives its response.  Queued hooks are spooled to the"     NL
+"### db/hooks-queue directory and run in the order they were queued."        NL
+"### Entries left over after a server restart are picked up the next time"   NL
+"### a hook gets queued.  Hooks that fail are kept in the queue directory"   NL
+"### with a '.failed' extension; their output is not sent to the client."    NL
+"###"                                                                        NL
+"### Only long-running, multi-threaded servers, i.e. svnserve running with"  NL
+"### --threads or --event, run hooks in the background.  Everywhere else,"   NL
+"### e.g. for file:// access, 'svnadmin' or forked svnserve processes, the"   NL
+"### hooks keep running synchronously."                                      NL
+"###"                                                                        NL
+"### Queued hooks are run at least once, not exactly once:  If the server"   NL
+"### stops while a hook is running, that hook will be run again from the"    NL
+"### start after the restart.  Hook scripts should therefore be idempotent," NL
+"### e.g. check whether a notification has already been sent."              NL
+"[queue]"                                                                    NL
+"### Set this to 'true' to run the hooks listed above in the background."    NL
+"# enabled = false"                                                          NL
+"### The maximum number of queued hooks to run at the same time in one"      NL
+"### repository.  Any value above 1 means that a hook may start before its"  NL
+"### predecessors have finished."                                            NL
+"# max-concurrency = 1"                                                      NL;
+
+    SVN_ERR_W(svn_io_file_create(svn_dirent_join(repos->conf_path,
+                                                 SVN_REPOS__CONF_HOOKS_QUEUE \
+                                                 SVN_REPOS__HOOK_DESC_EXT,
+                                                 pool),
+                                 hooks_queue_contents, pool),
+              _("Creating hooks-queue file"));
+  }
+
   return SVN_NO_ERROR;
 }
 
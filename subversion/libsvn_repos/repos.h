@@ -93,6 +93,14 @@ extern "C" {
 /* The name of the default section in the hooks-env config file. */
 #define SVN_REPOS__HOOKS_ENV_DEFAULT_SECTION "default"
 
+/* The file which configures running post-operation hooks in the
+ * background, in the repository conf directory. */
+#define SVN_REPOS__CONF_HOOKS_QUEUE "hooks-queue"
+
+/* Background hook invocations get spooled to this directory, in the
+ * repository db directory. */
+#define SVN_REPOS__DB_HOOKS_QUEUE "hooks-queue"
+
 /* The configuration file for svnserve, in the repository conf directory. */
 #define SVN_REPOS__CONF_SVNSERVE_CONF "svnserve.conf"
 
@@ -103,6 +111,9 @@ extern "C" {
 #define SVN_REPOS__CONF_AUTHZ "authz"
 #define SVN_REPOS__CONF_GROUPS "groups"
 
+/* Background queue for post-operation hooks, see hook_queue.c. */
+typedef struct svn_repos__hook_queue_t svn_repos__hook_queue_t;
+
 /* The Repository object, created by svn_repos_open2() and
    svn_repos_create(). */
 struct svn_repos_t
@@ -135,6 +146,13 @@ struct svn_repos_t
   /* The FS backend in use within this repository. */
   const char *fs_type;
 
+  /* The background queue for post-operation hooks.  NULL if queueing
+     has not been enabled or HOOK_QUEUE_CHECKED is not set yet. */
+  svn_repos__hook_queue_t *hook_queue;
+
+  /* Set once the hooks-queue configuration has been read. */
+  svn_boolean_t hook_queue_checked;
+
   /* If non-null, a list of all the capabilities the client (on the
      current connection) has self-reported.  Each element is a
      'const char *', one of SVN_RA_CAPABILITY_*.
@@ -363,6 +381,58 @@ svn_repos__hooks_post_unlock(svn_repos_t *repos,
                              apr_pool_t *pool);
 
 
+/* Run hook NAME, i.e. the program CMD with the NULL-terminated arguments
+   ARGS, the environment variables in HOOK_ENV (may be NULL) and
+   STDIN_VALUE as its standard input.  If STDIN_VALUE is NULL, pass the
+   null device as standard input.  This is used to run hooks taken from
+   the hook queue.  Use POOL for any temporary allocations.  If the hook
+   fails, return SVN_ERR_REPOS_HOOK_FAILURE. */
+svn_error_t *
+svn_repos__hooks_run_queued(const char *name,
+                            const char *cmd,
+                            const char **args,
+                            apr_hash_t *hook_env,
+                            const svn_string_t *stdin_value,
+                            apr_pool_t *pool);
+
+
+/*** Hook Queue Functions ***/
+
+/* Set *QUEUE_P to the background queue for post-operation hooks of
+   REPOS.  Set it to NULL if the hooks-queue configuration of REPOS does
+   not enable the queue or if this process did not call
+   svn_repos__hook_queue_allow_background().  The queue lives until the
+   process terminates.
+
+   The first time any svn_repos_t of this process uses the queue of a
+   repository, any hooks left over from previous runs will be started.
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_repos__hook_queue_get(svn_repos__hook_queue_t **queue_p,
+                          svn_repos_t *repos,
+                          apr_pool_t *scratch_pool);
+
+/* Add the invocation of hook NAME to QUEUE and return.  CMD, ARGS and
+   STDIN_VALUE are as for svn_repos__hooks_run_queued.  HOOKS_ENV is the
+   environment for all hooks as returned by svn_repos__parse_hooks_env()
+   and may be NULL.
+
+   The invocation gets spooled to disk before this function returns.  The
+   hooks in QUEUE run in the order they were queued, with no more than the
+   configured number of them running at the same time.  Hooks failing in
+   the background cannot be reported to anybody; their queue entries get
+   kept for inspection instead.  Use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *
+svn_repos__hook_queue_push(svn_repos__hook_queue_t *queue,
+                           const char *name,
+                           const char *cmd,
+                           const char **args,
+                           apr_hash_t *hooks_env,
+                           const svn_string_t *stdin_value,
+                           apr_pool_t *scratch_pool);
+
+
 /*** Utility Functions ***/
 
 /* Set *PREV_PATH and *PREV_REV to the path and revision which
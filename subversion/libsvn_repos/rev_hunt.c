@@ -75,6 +75,25 @@ get_time(apr_time_t *tm,
   return svn_time_from_cstring(tm, date_str->data, pool);
 }
 
+/* Like get_time() but take the time from the date INDEX of FS, if it
+   covers REV.  INDEX may be NULL. */
+static svn_error_t *
+get_indexed_time(apr_time_t *tm,
+                 svn_fs_t *fs,
+                 svn_fs__date_index_t *index,
+                 svn_revnum_t rev,
+                 apr_pool_t *pool)
+{
+  if (index)
+    {
+      SVN_ERR(svn_fs__get_revision_date(tm, index, rev, pool));
+      if (*tm != SVN_FS__NO_DATE)
+        return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(get_time(tm, fs, rev, pool));
+}
+
 
 svn_error_t *
 svn_repos_dated_revision(svn_revnum_t *revision,
@@ -85,17 +104,22 @@ svn_repos_dated_revision(svn_revnum_t *revision,
   svn_revnum_t rev_mid, rev_top, rev_bot, rev_latest;
   apr_time_t this_time;
   svn_fs_t *fs = repos->fs;
+  svn_fs__date_index_t *index;
 
   /* Initialize top and bottom values of binary search. */
   SVN_ERR(svn_fs_youngest_rev(&rev_latest, fs, pool));
   SVN_ERR(svn_fs_refresh_revision_props(fs, pool));
+
+  /* With a date index, the search will usually not need to read any
+     revprops. */
+  SVN_ERR(svn_fs__open_date_index(&index, fs, pool, pool));
   rev_bot = 0;
   rev_top = rev_latest;
 
   while (rev_bot <= rev_top)
     {
       rev_mid = (rev_top + rev_bot) / 2;
-      SVN_ERR(get_time(&this_time, fs, rev_mid, pool));
+      SVN_ERR(get_indexed_time(&this_time, fs, index, rev_mid, pool));
 
       if (this_time > tm)/* we've overshot */
         {
@@ -108,7 +132,8 @@ svn_repos_dated_revision(svn_revnum_t *revision,
             }
 
           /* see if time falls between rev_mid and rev_mid-1: */
-          SVN_ERR(get_time(&previous_time, fs, rev_mid - 1, pool));
+          SVN_ERR(get_indexed_time(&previous_time, fs, index, rev_mid - 1,
+                                   pool));
           if (previous_time <= tm)
             {
               *revision = rev_mid - 1;
@@ -129,7 +154,8 @@ svn_repos_dated_revision(svn_revnum_t *revision,
             }
 
           /* see if time falls between rev_mid and rev_mid+1: */
-          SVN_ERR(get_time(&next_time, fs, rev_mid + 1, pool));
+          SVN_ERR(get_indexed_time(&next_time, fs, index, rev_mid + 1,
+                                   pool));
           if (next_time > tm)
             {
               *revision = rev_mid;
@@ -304,6 +330,25 @@ svn_repos_history2(svn_fs_t *fs,
 }
 
 
+/* Return the revision at position IDX within the ascending sequence of
+   START, the elements of CANDIDATES and END.  CANDIDATES is given in
+   descending order.  If it is NULL, the sequence consists of all
+   revisions from START to END. */
+static svn_revnum_t
+nth_candidate(const apr_array_header_t *candidates,
+              svn_revnum_t start,
+              svn_revnum_t end,
+              svn_revnum_t idx)
+{
+  if (idx == 0 || candidates == NULL)
+    return start + idx;
+
+  if (idx > candidates->nelts)
+    return end;
+
+  return APR_ARRAY_IDX(candidates, candidates->nelts - idx, svn_revnum_t);
+}
+
 svn_error_t *
 svn_repos_deleted_rev(svn_fs_t *fs,
                       const char *path,
@@ -314,7 +359,8 @@ svn_repos_deleted_rev(svn_fs_t *fs,
 {
   apr_pool_t *iterpool;
   svn_fs_root_t *start_root, *root;
-  svn_revnum_t mid_rev;
+  apr_array_header_t *candidates = NULL;
+  svn_revnum_t lower, upper;
   svn_node_kind_t kind;
   svn_fs_node_relation_t node_relation;
 
@@ -434,11 +480,24 @@ svn_repos_deleted_rev(svn_fs_t *fs,
      --------------------------------------------------------------------
   */
 
-  mid_rev = (start + end) / 2;
+  /* The deletion must have happened in a revision that touched PATH or
+     one of its parents.  If there is a path index, bisect the list of
+     those revisions instead of the whole range.  Either way, the search
+     positions LOWER and UPPER refer to the sequence START, <candidates>,
+     END. */
+  if (end - start > 1)
+    SVN_ERR(svn_fs__get_path_revisions(&candidates, fs, path, start + 1,
+                                       end - 1, pool, pool));
+
+  lower = 0;
+  upper = candidates ? candidates->nelts + 1 : end - start;
   iterpool = svn_pool_create(pool);
 
-  while (1)
+  while (upper - lower > 1)
     {
+      svn_revnum_t mid = lower + (upper - lower) / 2;
+      svn_revnum_t mid_rev = nth_candidate(candidates, start, end, mid);
+
       svn_pool_clear(iterpool);
 
       /* Get revision root and node id for mid_rev at that revision. */
@@ -447,8 +506,7 @@ svn_repos_deleted_rev(svn_fs_t *fs,
       if (kind == svn_node_none)
         {
           /* Case D: Look lower in the range. */
-          end = mid_rev;
-          mid_rev = (start + mid_rev) / 2;
+          upper = mid;
         }
       else
         {
@@ -466,24 +524,19 @@ svn_repos_deleted_rev(svn_fs_t *fs,
                (svn_fs_revision_root_revision(copy_root) > start)))
             {
               /* Cases A, B, C: Look at lower revs. */
-              end = mid_rev;
-              mid_rev = (start + mid_rev) / 2;
-            }
-          else if (end - mid_rev == 1)
-            {
-              /* Found the node path was deleted. */
-              *deleted = end;
-              break;
+              upper = mid;
             }
           else
             {
               /* Cases E, F: Look at higher revs. */
-              start = mid_rev;
-              mid_rev = (start + end) / 2;
+              lower = mid;
             }
         }
     }
 
+  /* Found the revision in which path was deleted. */
+  *deleted = nth_candidate(candidates, start, end, upper);
+
   svn_pool_destroy(iterpool);
   return SVN_NO_ERROR;
 }
@@ -23,6 +23,12 @@
 
 #include "cache.h"
 
+#include "private/svn_trace.h"
+
+/* Trace probes for cache lookups. */
+SVN_TRACE__PROBE(cache_get_probe, "cache.get");
+SVN_TRACE__PROBE(cache_hit_probe, "cache.hit");
+
 svn_error_t *
 svn_cache__set_error_handler(svn_cache__t *cache,
                              svn_cache__error_handler_t handler,
@@ -71,6 +77,7 @@ svn_cache__get(void **value_p,
                apr_pool_t *result_pool)
 {
   svn_error_t *err;
+  apr_time_t trace_start;
 
   /* In case any errors happen and are quelched, make sure we start
      out with FOUND set to false. */
@@ -81,6 +88,7 @@ svn_cache__get(void **value_p,
 #endif
 
   cache->reads++;
+  trace_start = SVN_TRACE__SPAN_START();
   err = handle_error(cache,
                      (cache->vtable->get)(value_p,
                                           found,
@@ -88,9 +96,13 @@ svn_cache__get(void **value_p,
                                           key,
                                           result_pool),
                      result_pool);
+  SVN_TRACE__SPAN_END(cache_get_probe, trace_start);
 
   if (*found)
-    cache->hits++;
+    {
+      cache->hits++;
+      SVN_TRACE__COUNT(cache_hit_probe, 1);
+    }
 
   return err;
 }
@@ -35,6 +35,7 @@
 #include <crtdbg.h>
 #include <io.h>
 #include <conio.h>
+#include <process.h>            /* for _getpid() */
 #endif
 
 #include <apr.h>                /* for STDIN_FILENO */
@@ -66,6 +67,7 @@
 #include "private/svn_utf_private.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_string_private.h"
+#include "private/svn_trace.h"
 
 #include "svn_private_config.h"
 
@@ -91,6 +93,72 @@ static svn_boolean_t shortcut_stdout_to_console = FALSE;
 static svn_boolean_t shortcut_stderr_to_console = FALSE;
 #endif
 
+/* Trace output requested via the SVN_TRACE environment variable.
+   TRACE_PATH is NULL if no output has been requested. */
+static svn_trace__format_t trace_format = svn_trace__format_json;
+static const char *trace_path = NULL;
+
+/* atexit() handler writing the trace data to TRACE_PATH, with any "%p"
+   replaced by the current process ID.  Errors are being ignored. */
+static void
+write_trace_at_exit(void)
+{
+  apr_pool_t *pool = svn_pool_create(NULL);
+  svn_stringbuf_t *path = svn_stringbuf_create(trace_path, pool);
+  apr_file_t *file;
+  svn_error_t *err;
+
+#ifdef WIN32
+  svn_stringbuf_replace_all(path, "%p",
+                            apr_psprintf(pool, "%d", (int)_getpid()));
+#else
+  svn_stringbuf_replace_all(path, "%p",
+                            apr_psprintf(pool, "%d", (int)getpid()));
+#endif
+
+  err = svn_io_file_open(&file, path->data,
+                         APR_WRITE | APR_CREATE | APR_TRUNCATE | APR_BUFFERED,
+                         APR_OS_DEFAULT, pool);
+  if (!err)
+    {
+      svn_stream_t *stream = svn_stream_from_aprfile2(file, FALSE, pool);
+      err = svn_error_compose_create(svn_trace__write(stream, trace_format,
+                                                      pool),
+                                     svn_stream_close(stream));
+    }
+
+  svn_error_clear(err);
+  svn_pool_destroy(pool);
+}
+
+/* If the SVN_TRACE environment variable is set to "FORMAT:PATH", enable
+   tracing and arrange for the data to be written to PATH in FORMAT at
+   exit.  Allocate TRACE_PATH in the global POOL. */
+static svn_error_t *
+init_trace_from_env(apr_pool_t *pool)
+{
+  const char *value = getenv("SVN_TRACE");
+  const char *colon;
+
+  if (!value || !*value)
+    return SVN_NO_ERROR;
+
+  colon = strchr(value, ':');
+  if (!colon || !colon[1])
+    return svn_error_createf(SVN_ERR_INCORRECT_PARAMS, NULL,
+                             _("Invalid SVN_TRACE value '%s', "
+                               "expected FORMAT:PATH"), value);
+
+  SVN_ERR(svn_trace__parse_format(&trace_format,
+                                  apr_pstrndup(pool, value, colon - value)));
+  trace_path = apr_pstrdup(pool, colon + 1);
+
+  if (0 > atexit(write_trace_at_exit))
+    return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
+                            _("atexit registration failed"));
+
+  return svn_error_trace(svn_trace__enable(TRUE));
+}
 
 int
 svn_cmdline_init(const char *progname, FILE *error_stream)
@@ -266,6 +334,17 @@ svn_cmdline_init(const char *progname, FILE *error_stream)
       return EXIT_FAILURE;
     }
 
+  /* Must come after registering apr_terminate() such that the trace
+     gets written while APR is still available. */
+  if ((err = init_trace_from_env(pool)))
+    {
+      if (error_stream)
+        svn_handle_error2(err, error_stream, TRUE, prefix_buf);
+
+      svn_error_clear(err);
+      return EXIT_FAILURE;
+    }
+
 #ifdef USE_WIN32_CONSOLE_SHORTCUT
   if (_isatty(STDOUT_FILENO))
     {
@@ -63,6 +63,11 @@
 #include "svn_config.h"
 #include "svn_private_config.h"
 #include "svn_ctype.h"
+#include "svn_sorts.h"
+
+#ifdef SVN_HAVE_LIBURING
+#include <liburing.h>
+#endif
 
 #include "private/svn_atomic.h"
 #include "private/svn_io_private.h"
@@ -3912,6 +3917,263 @@ svn_io_file_aligned_seek(apr_file_t *file,
   return SVN_NO_ERROR;
 }
 
+/* Maximum number of reads that we keep in flight at any given time. */
+#define READ_BATCH_MAX_DEPTH 64
+
+#ifdef SVN_HAVE_LIBURING
+
+/* Status of the io_uring availability check.  Kernels may not support it
+ * or it may have been disabled, e.g. by seccomp. */
+static volatile svn_atomic_t uring_probe_state = 0;
+static svn_boolean_t uring_available = FALSE;
+
+/* Set URING_AVAILABLE if we can actually create rings.
+ * Passed to svn_atomic__init_once_no_error. */
+static const char *
+probe_uring(void *baton)
+{
+  struct io_uring ring;
+  if (io_uring_queue_init(1, &ring, 0) == 0)
+    {
+      io_uring_queue_exit(&ring);
+      uring_available = TRUE;
+    }
+
+  return NULL;
+}
+
+/* Submit up to READ_BATCH_MAX_DEPTH of the COUNT REQUESTS at a time to
+ * RING and read them from FD.  Short reads as well as requests that the
+ * kernel did not accept will be completed by the caller.  Return the
+ * respective errno in case of failure.
+ */
+static apr_status_t
+read_batch_uring(struct io_uring *ring,
+                 int fd,
+                 svn_io__read_request_t *requests,
+                 int count)
+{
+  int first;
+  for (first = 0; first < count; first += READ_BATCH_MAX_DEPTH)
+    {
+      int i, submitted, pending;
+      int in_flight = 0;
+      int last = MIN(count, first + READ_BATCH_MAX_DEPTH);
+      apr_status_t status = APR_SUCCESS;
+
+      for (i = first; i < last; ++i)
+        {
+          struct io_uring_sqe *sqe;
+          svn_io__read_request_t *request = &requests[i];
+
+          /* Zero-size requests are trivially satisfied. */
+          if (request->size == 0)
+            continue;
+
+          sqe = io_uring_get_sqe(ring);
+          io_uring_prep_read(sqe, fd, request->buffer,
+                             (unsigned)request->size, request->offset);
+          io_uring_sqe_set_data(sqe, request);
+          ++in_flight;
+        }
+
+      if (in_flight == 0)
+        continue;
+
+      /* The kernel may accept only part of the queue at a time.  If it
+       * stops accepting requests altogether, only wait for those that it
+       * did accept and leave the others to the caller. */
+      submitted = 0;
+      while (submitted < in_flight)
+        {
+          int result = io_uring_submit(ring);
+          if (result == -EINTR)
+            continue;
+          if (result <= 0)
+            break;
+
+          submitted += result;
+        }
+
+      /* Always reap all completions as the buffers must not be released
+       * before the kernel is done with them. */
+      for (pending = submitted; pending > 0; )
+        {
+          struct io_uring_cqe *cqe;
+          svn_io__read_request_t *request;
+          int result = io_uring_wait_cqe(ring, &cqe);
+          if (result < 0)
+            {
+              if (result == -EINTR)
+                continue;
+
+              return -result;
+            }
+
+          request = io_uring_cqe_get_data(cqe);
+          if (cqe->res < 0)
+            status = -cqe->res;
+          else
+            request->bytes_read = (apr_size_t)cqe->res;
+
+          io_uring_cqe_seen(ring, cqe);
+          --pending;
+        }
+
+      /* The RING still holds the rejected requests.  Don't add more. */
+      if (status || submitted < in_flight)
+        return status;
+    }
+
+  return APR_SUCCESS;
+}
+
+#endif /* SVN_HAVE_LIBURING */
+
+svn_boolean_t
+svn_io__async_read_available(void)
+{
+#ifdef SVN_HAVE_LIBURING
+  svn_atomic__init_once_no_error(&uring_probe_state, probe_uring, NULL);
+  return uring_available;
+#else
+  return FALSE;
+#endif
+}
+
+/* Read the remainder of REQUEST from FILE, i.e. everything after the
+ * first BYTES_READ bytes, synchronously.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+read_request_sync(apr_file_t *file,
+                  svn_io__read_request_t *request,
+                  apr_pool_t *scratch_pool)
+{
+#ifdef WIN32
+  /* No positioned reads available through APR.  The caller has saved
+   * and will restore the file pointer. */
+  apr_off_t offset = request->offset + request->bytes_read;
+  apr_size_t bytes_read = 0;
+  svn_boolean_t hit_eof;
+
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+  SVN_ERR(svn_io_file_read_full2(file,
+                                 request->buffer + request->bytes_read,
+                                 request->size - request->bytes_read,
+                                 &bytes_read, &hit_eof, scratch_pool));
+  request->bytes_read += bytes_read;
+#else
+  apr_os_file_t fd;
+  apr_status_t status = apr_os_file_get(&fd, file);
+  if (status)
+    return do_io_file_wrapper_cleanup(file, status,
+                                      N_("Can't read file '%s'"),
+                                      N_("Can't read stream"),
+                                      scratch_pool);
+
+  while (request->bytes_read < request->size)
+    {
+      ssize_t result = pread(fd, request->buffer + request->bytes_read,
+                             request->size - request->bytes_read,
+                             request->offset + request->bytes_read);
+      if (result < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          return do_io_file_wrapper_cleanup(file, apr_get_os_error(),
+                                            N_("Can't read file '%s'"),
+                                            N_("Can't read stream"),
+                                            scratch_pool);
+        }
+
+      /* EOF */
+      if (result == 0)
+        break;
+
+      request->bytes_read += (apr_size_t)result;
+    }
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_io__file_read_batch(apr_file_t *file,
+                        svn_io__read_request_t *requests,
+                        int count,
+                        apr_pool_t *scratch_pool)
+{
+  int i;
+#ifdef WIN32
+  apr_off_t saved_offset;
+#endif
+
+  for (i = 0; i < count; ++i)
+    requests[i].bytes_read = 0;
+
+#ifdef SVN_HAVE_LIBURING
+  /* A single read does not benefit from the ring setup overhead. */
+  if (count > 1 && svn_io__async_read_available())
+    {
+      struct io_uring ring;
+      apr_os_file_t fd;
+      apr_status_t status = apr_os_file_get(&fd, file);
+
+      if (!status
+          && io_uring_queue_init(MIN(count, READ_BATCH_MAX_DEPTH),
+                                 &ring, 0) == 0)
+        {
+          status = read_batch_uring(&ring, fd, requests, count);
+          io_uring_queue_exit(&ring);
+
+          if (status)
+            return do_io_file_wrapper_cleanup(file, status,
+                                              N_("Can't read file '%s'"),
+                                              N_("Can't read stream"),
+                                              scratch_pool);
+        }
+    }
+#endif
+
+#ifdef WIN32
+  SVN_ERR(svn_io_file_get_offset(&saved_offset, file, scratch_pool));
+#endif
+
+  /* Complete short reads and - if the asynchronous path was not taken -
+   * process all requests synchronously.  Requests that already hit EOF
+   * will simply read nothing here. */
+  for (i = 0; i < count; ++i)
+    if (requests[i].bytes_read < requests[i].size)
+      SVN_ERR(read_request_sync(file, &requests[i], scratch_pool));
+
+#ifdef WIN32
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &saved_offset, scratch_pool));
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+svn_boolean_t
+svn_io__file_prefetch(apr_file_t *file,
+                      apr_off_t offset,
+                      apr_off_t length)
+{
+#if defined(POSIX_FADV_WILLNEED) && !defined(WIN32)
+  apr_os_file_t fd;
+
+  /* The kernel queues the reads for the whole range and returns
+   * immediately.  We never wait for nor look at the data. */
+  if (   length > 0
+      && apr_os_file_get(&fd, file) == APR_SUCCESS
+      && posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED) == 0)
+    return TRUE;
+#endif
+
+  return FALSE;
+}
+
 
 svn_error_t *
 svn_io_file_write(apr_file_t *file, const void *buf,
@@ -3981,6 +4243,50 @@ svn_io_file_write_full(apr_file_t *file, const void *buf,
 }
 
 
+/* Gathering writes of up to this many bytes in total will be copied into
+   the file's APR buffer, if it has one.  For larger writes, a writev()
+   call saves both, the copy and a number of write() calls. */
+#define WRITEV_BUFFERED_THRESHOLD 0x1000
+
+svn_error_t *
+svn_io__file_writev_full(apr_file_t *file,
+                         const struct iovec *vec,
+                         int nvec,
+                         apr_pool_t *pool)
+{
+  apr_size_t total = 0;
+  int i;
+
+  for (i = 0; i < nvec; ++i)
+    total += vec[i].iov_len;
+
+#ifndef WIN32
+  /* APR flushes the file buffer before writev(), so only bypass it if
+     that does not add a syscall. */
+  if (   total > WRITEV_BUFFERED_THRESHOLD
+      || apr_file_buffer_size_get(file) == 0)
+    {
+      apr_size_t written;
+      apr_status_t rv = apr_file_writev_full(file, vec, nvec, &written);
+
+      return svn_error_trace(do_io_file_wrapper_cleanup(
+         file, rv,
+         N_("Can't write to file '%s'"),
+         N_("Can't write to stream"),
+         pool));
+    }
+#endif
+
+  /* APR on Windows emulates writev() anyway, so we may just as well use
+     our own work-around for issue #1789 for each buffer. */
+  for (i = 0; i < nvec; ++i)
+    if (vec[i].iov_len)
+      SVN_ERR(svn_io_file_write_full(file, vec[i].iov_base, vec[i].iov_len,
+                                     NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_io_write_unique(const char **tmp_path,
                     const char *dirpath,
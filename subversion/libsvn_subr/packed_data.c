@@ -20,6 +20,7 @@
  * ====================================================================
  */
 
+#include <string.h>
 #include <apr_tables.h>
 
 #include "svn_string.h"
@@ -31,6 +32,19 @@
 
 #include "svn_private_config.h"
 
+/* The word-wise decoder below needs to load 8 bytes at arbitrary offsets
+ * and assumes little-endian byte order.  Where SSE2 is available, it will
+ * additionally check 16 bytes at once for runs of single-byte numbers.
+ * Define SVN__PACKED_DATA_SCALAR to use the portable decoder instead. */
+#if !defined(SVN__PACKED_DATA_SCALAR) \
+    && SVN_UNALIGNED_ACCESS_IS_OK && !APR_IS_BIGENDIAN
+#  define SVN__PACKED_DATA_WORDWISE 1
+#  if defined(__SSE2__) || defined(_M_X64)
+#    include <emmintrin.h>
+#    define SVN__PACKED_DATA_SSE2 1
+#  endif
+#endif
+
 
 
 /* Private int stream data referenced by svn_packed__int_stream_t.
@@ -773,6 +787,182 @@ read_packed_uint(svn_stringbuf_t *packed)
   return result;
 }
 
+#ifdef SVN__PACKED_DATA_WORDWISE
+
+/* Masks selecting the MSB resp. the 7 payload bits of every byte. */
+#define MSB_MASK APR_UINT64_C(0x8080808080808080)
+#define PAYLOAD_MASK APR_UINT64_C(0x7f7f7f7f7f7f7f7f)
+
+/* Decode up to COUNT 7b/8b encoded numbers from *P into VALUES, in order,
+ * processing whole machine words at a time.  Stop as soon as fewer than
+ * 16 bytes remain before END, such that no read will cross END.  Update
+ * *P and return the number of values decoded.
+ *
+ * Numbers of up to 8 bytes get decoded branch-free from a single word:
+ * the lowest byte without MSB set terminates the number, all bytes up to
+ * and including it are masked out and their 7 bit groups get compacted.
+ * Runs of single-byte numbers, i.e. words without any MSB set, are
+ * copied as is.
+ */
+static apr_size_t
+decode_uints_wordwise(apr_uint64_t *values,
+                      apr_size_t count,
+                      const unsigned char **p,
+                      const unsigned char *end)
+{
+  const unsigned char *current = *p;
+  apr_size_t i = 0;
+
+  while (i < count && end - current >= 16)
+    {
+      apr_uint64_t word, terminators, lowest, mask, value;
+      apr_size_t len, k;
+
+#ifdef SVN__PACKED_DATA_SSE2
+      if (   count - i >= 16
+          && _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)current))
+             == 0)
+        {
+          for (k = 0; k < 16; ++k)
+            values[i + k] = current[k];
+
+          i += 16;
+          current += 16;
+          continue;
+        }
+#endif
+
+      memcpy(&word, current, sizeof(word));
+      terminators = ~word & MSB_MASK;
+
+      if (terminators == MSB_MASK && count - i >= 8)
+        {
+          for (k = 0; k < 8; ++k)
+            values[i + k] = current[k];
+
+          i += 8;
+          current += 8;
+          continue;
+        }
+
+      if (terminators == 0)
+        {
+          /* 9 or 10 byte number, or invalid data.  At least 11 bytes
+             can be read safely, which is all that the scalar code needs. */
+          current = read_packed_uint_body((unsigned char *)current,
+                                          &values[i++]);
+          continue;
+        }
+
+      /* Select all bytes up to and including the first terminator. */
+      lowest = terminators & (0 - terminators);
+      mask = lowest | (lowest - 1);
+      len = (apr_size_t)(((mask & APR_UINT64_C(0x0101010101010101))
+                          * APR_UINT64_C(0x0101010101010101)) >> 56);
+
+      /* Compact the 7 bit groups: 8 x 7 -> 4 x 14 -> 2 x 28 -> 56 bits. */
+      value = word & mask & PAYLOAD_MASK;
+      value = ((value & APR_UINT64_C(0x7f007f007f007f00)) >> 1)
+            | (value & APR_UINT64_C(0x007f007f007f007f));
+      value = ((value & APR_UINT64_C(0x3fff00003fff0000)) >> 2)
+            | (value & APR_UINT64_C(0x00003fff00003fff));
+      value = ((value & APR_UINT64_C(0x0fffffff00000000)) >> 4)
+            | (value & APR_UINT64_C(0x000000000fffffff));
+
+      values[i++] = value;
+      current += len;
+    }
+
+  *p = current;
+  return i;
+}
+
+#endif
+
+/* Decode the next COUNT numbers from the packed data of the integer
+ * stream with PRIVATE_DATA into VALUES, in stream order, and advance the
+ * packed data accordingly.  Undo the deltification and signed value
+ * mapping, if configured for that stream.  COUNT must not exceed the
+ * number of items left in the stream.
+ */
+static void
+decode_packed_uints(apr_uint64_t *values,
+                    apr_size_t count,
+                    packed_int_private_t *private_data)
+{
+  svn_stringbuf_t *packed = private_data->packed;
+  const unsigned char *start;
+  const unsigned char *end;
+  const unsigned char *p;
+  apr_size_t packed_read;
+  apr_size_t i = 0;
+
+  if (count == 0)
+    return;
+
+  /* Corrupted data may claim items without providing packed data. */
+  if (packed == NULL)
+    {
+      memset(values, 0, count * sizeof(*values));
+      return;
+    }
+
+  start = (const unsigned char *)packed->data;
+  end = start + packed->len;
+  p = start;
+
+#ifdef SVN__PACKED_DATA_WORDWISE
+  i = decode_uints_wordwise(values, count, &p, end);
+#else
+  /* read_packed_uint_body never reads more than 11 bytes, even for
+     invalid data, so it is safe to use as long as 16 bytes remain. */
+  while (i < count && end - p >= 16)
+    p = read_packed_uint_body((unsigned char *)p, &values[i++]);
+#endif
+
+  if (i < count)
+    {
+      /* Less than 16 bytes of packed data remain.  Decode them from a
+         zero-padded copy such that read_packed_uint_body doesn't need to
+         check for overflows.  Missing values will be 0. */
+      unsigned char local_buffer[32] = { 0 };
+      const unsigned char *local = local_buffer;
+      apr_size_t remaining = MIN(end - p, 16);
+
+      memcpy(local_buffer, p, remaining);
+      for (; i < count && local < local_buffer + remaining; ++i)
+        local = read_packed_uint_body((unsigned char *)local, &values[i]);
+      for (; i < count; ++i)
+        values[i] = 0;
+
+      p += MIN(local - local_buffer, remaining);
+    }
+
+  /* adjust remaining packed data buffer */
+  packed_read = p - start;
+  packed->data += packed_read;
+  packed->len -= packed_read;
+  packed->blocksize -= packed_read;
+
+  /* undeltify numbers, if configured */
+  if (private_data->diff)
+    {
+      apr_uint64_t last_value = private_data->last_value;
+      for (i = 0; i < count; ++i)
+        {
+          last_value += unmap_uint(values[i]);
+          values[i] = last_value;
+        }
+
+      private_data->last_value = last_value;
+    }
+
+  /* handle signed values, if configured and not handled already */
+  if (!private_data->diff && private_data->is_signed)
+    for (i = 0; i < count; ++i)
+      values[i] = unmap_uint(values[i]);
+}
+
 /* Ensure that STREAM contains at least one item in its buffer.
  */
 static void
@@ -800,55 +990,13 @@ svn_packed__data_fill_buffer(svn_packed__int_stream_t *stream)
       }
   else
     {
-      /* use this local buffer only if the packed data is shorter than this.
-         The goal is that read_packed_uint_body doesn't need check for
-         overflows. */
-      unsigned char local_buffer[10 * SVN__PACKED_DATA_BUFFER_SIZE];
-      unsigned char *p;
-      unsigned char *start;
-      apr_size_t packed_read;
-
-      if (private_data->packed->len < sizeof(local_buffer))
-        {
-          apr_size_t trail = sizeof(local_buffer) - private_data->packed->len;
-          memcpy(local_buffer,
-                 private_data->packed->data,
-                 private_data->packed->len);
-          memset(local_buffer + private_data->packed->len, 0, MIN(trail, end));
-
-          p = local_buffer;
-        }
-      else
-        p = (unsigned char *)private_data->packed->data;
-
-      /* unpack numbers */
-      start = p;
-      for (i = end; i > 0; --i)
-        p = read_packed_uint_body(p, &stream->buffer[i-1]);
-
-      /* adjust remaining packed data buffer */
-      packed_read = p - start;
-      private_data->packed->data += packed_read;
-      private_data->packed->len -= packed_read;
-      private_data->packed->blocksize -= packed_read;
-
-      /* undeltify numbers, if configured */
-      if (private_data->diff)
-        {
-          apr_uint64_t last_value = private_data->last_value;
-          for (i = end; i > 0; --i)
-            {
-              last_value += unmap_uint(stream->buffer[i-1]);
-              stream->buffer[i-1] = last_value;
-            }
-
-          private_data->last_value = last_value;
-        }
+      /* unpack numbers in stream order, then reverse them such that
+         the next value to return will be at the end of the buffer */
+      apr_uint64_t values[SVN__PACKED_DATA_BUFFER_SIZE];
+      decode_packed_uints(values, end, private_data);
 
-      /* handle signed values, if configured and not handled already */
-      if (!private_data->diff && private_data->is_signed)
-        for (i = 0; i < end; ++i)
-          stream->buffer[i] = unmap_uint(stream->buffer[i]);
+      for (i = 0; i < end; ++i)
+        stream->buffer[end - 1 - i] = values[i];
     }
 
   stream->buffer_used = end;
@@ -870,6 +1018,90 @@ svn_packed__get_int(svn_packed__int_stream_t *stream)
   return (apr_int64_t)svn_packed__get_uint(stream);
 }
 
+/* Number of values to read from each sub-stream at once when bulk-reading
+ * from a stream with sub-streams. */
+#define SUBSTREAM_CHUNK_SIZE 64
+
+apr_size_t
+svn_packed__get_uints(svn_packed__int_stream_t *stream,
+                      apr_uint64_t *values,
+                      apr_size_t count)
+{
+  packed_int_private_t *private_data = stream->private_data;
+  apr_size_t i = 0;
+
+  /* limit the request to what is actually available and, just like
+     svn_packed__get_uint, return 0 for values beyond the end of STREAM */
+  if (count > svn_packed__int_count(stream))
+    {
+      apr_size_t available = svn_packed__int_count(stream);
+      memset(values + available, 0,
+             (count - available) * sizeof(*values));
+      count = available;
+    }
+
+  /* return pre-fetched values first */
+  while (i < count && stream->buffer_used)
+    values[i++] = stream->buffer[--stream->buffer_used];
+
+  if (i == count)
+    return count;
+
+  if (private_data->current_substream)
+    {
+      /* Read whole "rows" column-wise, i.e. bulk-read every sub-stream
+         and interleave their values.  This is only possible while the
+         round-robin scheme is at the first sub-stream. */
+      apr_size_t substream_count = private_data->substream_count;
+      apr_size_t rows = (count - i) / substream_count;
+
+      if (   rows
+          && private_data->current_substream == private_data->first_substream)
+        {
+          svn_packed__int_stream_t *substream
+            = private_data->first_substream;
+          apr_size_t column;
+
+          for (column = 0; column < substream_count; ++column)
+            {
+              packed_int_private_t *sub_private = substream->private_data;
+              apr_uint64_t chunk[SUBSTREAM_CHUNK_SIZE];
+              apr_size_t row = 0;
+
+              while (row < rows)
+                {
+                  apr_size_t k;
+                  apr_size_t chunk_size = MIN(SUBSTREAM_CHUNK_SIZE,
+                                              rows - row);
+
+                  svn_packed__get_uints(substream, chunk, chunk_size);
+                  for (k = 0; k < chunk_size; ++k)
+                    values[i + (row + k) * substream_count + column]
+                      = chunk[k];
+
+                  row += chunk_size;
+                }
+
+              substream = sub_private->next;
+            }
+
+          i += rows * substream_count;
+          private_data->item_count -= rows * substream_count;
+        }
+
+      /* partial rows */
+      for (; i < count; ++i)
+        values[i] = svn_packed__get_uint(stream);
+    }
+  else
+    {
+      decode_packed_uints(values + i, count - i, private_data);
+      private_data->item_count -= count - i;
+    }
+
+  return count;
+}
+
 const char *
 svn_packed__get_bytes(svn_packed__byte_stream_t *stream,
                       apr_size_t *len)
@@ -22,12 +22,28 @@
  */
 
 #include <apr_file_io.h>
+#include <apr_mmap.h>
+#include <apr_portable.h>
+
+#ifdef HAVE_MEMFD_CREATE
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 #include "svn_io.h"
 #include "svn_pools.h"
 
 #include "private/svn_subr_private.h"
 
+#include "svn_private_config.h"
+
+
+/* Mapped spill files grow in extents of this size.  Each extent gets
+   mapped individually, so this must be a multiple of the mapping
+   granularity of all platforms (64k on Windows).  Extents are being
+   recycled once all data in them has been read. */
+#define SPILL_EXTENT_SIZE 0x100000
+
 
 struct memblock_t {
   apr_size_t size;
@@ -87,6 +103,35 @@ struct svn_spillbuf_t {
 
   /* The name of the temporary spill file. */
   const char *filename;
+
+  /* When true, spill into MAP_FILE instead of a classic spill file.
+     SPILL will then be set to MAP_FILE while we are spilling and be NULL
+     otherwise.  SPILL_START is the logical offset of the spilled content,
+     which gets translated through EXTENTS.  */
+  svn_boolean_t mapped;
+
+  /* The file backing the mapped spill storage.  It is being kept open
+     and re-used once all spilled data has been read.  */
+  apr_file_t *map_file;
+
+  /* The mapped extents of MAP_FILE, SPILL_EXTENT_SIZE bytes each,
+     as apr_mmap_t *, that hold the logical extents FIRST_EXTENT and up.
+     Their order is unrelated to their position within MAP_FILE.  */
+  apr_array_header_t *extents;
+  apr_int64_t first_extent;
+
+  /* Mapped extents of MAP_FILE whose contents have been read completely,
+     as apr_mmap_t *.  These get re-used before MAP_FILE is being grown,
+     limiting its size to the largest amount of unread data.  */
+  apr_array_header_t *spare_extents;
+
+  /* Number of extents that MAP_FILE has been grown to.  */
+  int file_extents;
+
+  /* Memblock describing the slice of the mapping handed out by the last
+     read.  Its data belongs to the mapping, so it must never be returned
+     to the list of available buffers.  */
+  struct memblock_t map_block;
 };
 
 
@@ -170,6 +215,19 @@ svn_spillbuf__create_extended(apr_size_t blocksize,
   return buf;
 }
 
+svn_spillbuf_t *
+svn_spillbuf__create_mapped(apr_size_t blocksize,
+                            apr_size_t maxsize,
+                            apr_pool_t *result_pool)
+{
+  svn_spillbuf_t *buf = apr_pcalloc(result_pool, sizeof(*buf));
+  init_spillbuf(buf, blocksize, maxsize, result_pool);
+#if APR_HAS_MMAP
+  buf->mapped = TRUE;
+#endif
+  return buf;
+}
+
 svn_filesize_t
 svn_spillbuf__get_size(const svn_spillbuf_t *buf)
 {
@@ -230,6 +288,230 @@ return_buffer(svn_spillbuf_t *buf,
 }
 
 
+/* Return MEM to BUF's list of available buffers unless it refers to
+   mapped spill data.  */
+static void
+release_buffer(svn_spillbuf_t *buf,
+               struct memblock_t *mem)
+{
+  if (mem != &buf->map_block)
+    return_buffer(buf, mem);
+}
+
+
+#if APR_HAS_MMAP
+
+#ifdef HAVE_MEMFD_CREATE
+/* Pool cleanup function closing the apr_file_t in DATA.  */
+static apr_status_t
+close_map_file(void *data)
+{
+  return apr_file_close(data);
+}
+#endif
+
+/* Create BUF->MAP_FILE.  Prefer an anonymous memory file, which does not
+   touch the temp directory.  Use SCRATCH_POOL for temporary allocations.  */
+static svn_error_t *
+open_map_file(svn_spillbuf_t *buf,
+              apr_pool_t *scratch_pool)
+{
+#ifdef HAVE_MEMFD_CREATE
+  apr_os_file_t fd = memfd_create("svn-spillbuf", MFD_CLOEXEC);
+  if (fd >= 0)
+    {
+      apr_status_t status = apr_os_file_put(&buf->map_file, &fd,
+                                            APR_READ | APR_WRITE,
+                                            buf->pool);
+      if (status)
+        {
+          close(fd);
+          return svn_error_wrap_apr(status, _("Can't create spill file"));
+        }
+
+      apr_pool_cleanup_register(buf->pool, buf->map_file, close_map_file,
+                                apr_pool_cleanup_null);
+      return SVN_NO_ERROR;
+    }
+
+  /* Kernel without memfd support.  Fall back to a temp file. */
+#endif
+
+  return svn_error_trace(svn_io_open_unique_file3(&buf->map_file,
+                                                  &buf->filename,
+                                                  buf->dirpath,
+                                                  svn_io_file_del_on_pool_cleanup,
+                                                  buf->pool, scratch_pool));
+}
+
+/* Move all extents of BUF's mapped spill storage before the logical
+   extent number END to the list of spare extents.  */
+static void
+release_extents(svn_spillbuf_t *buf,
+                apr_int64_t end)
+{
+  apr_int64_t count = end - buf->first_extent;
+  int i;
+
+  if (count > buf->extents->nelts)
+    count = buf->extents->nelts;
+  if (count <= 0)
+    return;
+
+  for (i = 0; i < count; ++i)
+    APR_ARRAY_PUSH(buf->spare_extents, apr_mmap_t *)
+      = APR_ARRAY_IDX(buf->extents, i, apr_mmap_t *);
+
+  memmove(buf->extents->elts,
+          buf->extents->elts + count * buf->extents->elt_size,
+          (buf->extents->nelts - count) * buf->extents->elt_size);
+  buf->extents->nelts -= count;
+  buf->first_extent += count;
+}
+
+/* Return the address of logical OFFSET within BUF's mapped spill storage,
+   growing it as necessary.  The address will be valid for up to the next
+   extent boundary.  Use SCRATCH_POOL for temporary allocations.  */
+static svn_error_t *
+map_address(char **address,
+            svn_spillbuf_t *buf,
+            apr_off_t offset,
+            apr_pool_t *scratch_pool)
+{
+  int extent = (int)(offset / SPILL_EXTENT_SIZE - buf->first_extent);
+  void *base;
+
+  while (buf->extents->nelts <= extent)
+    {
+      apr_mmap_t *mm;
+      apr_off_t extent_start;
+      apr_status_t status;
+
+      if (buf->spare_extents->nelts)
+        {
+          mm = *(apr_mmap_t **)apr_array_pop(buf->spare_extents);
+          APR_ARRAY_PUSH(buf->extents, apr_mmap_t *) = mm;
+          continue;
+        }
+
+      extent_start = (apr_off_t)buf->file_extents * SPILL_EXTENT_SIZE;
+      SVN_ERR(svn_io_file_trunc(buf->map_file,
+                                extent_start + SPILL_EXTENT_SIZE,
+                                scratch_pool));
+      status = apr_mmap_create(&mm, buf->map_file, extent_start,
+                               SPILL_EXTENT_SIZE,
+                               APR_MMAP_READ | APR_MMAP_WRITE, buf->pool);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't map spill file"));
+
+      ++buf->file_extents;
+      APR_ARRAY_PUSH(buf->extents, apr_mmap_t *) = mm;
+    }
+
+  base = APR_ARRAY_IDX(buf->extents, extent, apr_mmap_t *)->mm;
+  *address = (char *)base + offset % SPILL_EXTENT_SIZE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Copy LEN bytes from DATA to OFFSET in BUF's mapped spill storage.
+   Use SCRATCH_POOL for temporary allocations.  */
+static svn_error_t *
+write_mapped(svn_spillbuf_t *buf,
+             apr_off_t offset,
+             const char *data,
+             apr_size_t len,
+             apr_pool_t *scratch_pool)
+{
+  while (len > 0)
+    {
+      char *address;
+      apr_size_t amt = SPILL_EXTENT_SIZE - offset % SPILL_EXTENT_SIZE;
+      if (amt > len)
+        amt = len;
+
+      SVN_ERR(map_address(&address, buf, offset, scratch_pool));
+      memcpy(address, data, amt);
+
+      offset += amt;
+      data += amt;
+      len -= amt;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#endif /* APR_HAS_MMAP */
+
+
+/* Start spilling.  Use SCRATCH_POOL for temporary allocations.  */
+static svn_error_t *
+start_spilling(svn_spillbuf_t *buf,
+               apr_pool_t *scratch_pool)
+{
+  struct memblock_t *mem;
+
+#if APR_HAS_MMAP
+  if (buf->mapped)
+    {
+      if (buf->map_file == NULL)
+        {
+          SVN_ERR(open_map_file(buf, scratch_pool));
+          buf->extents = apr_array_make(buf->pool, 4, sizeof(apr_mmap_t *));
+          buf->spare_extents = apr_array_make(buf->pool, 4,
+                                              sizeof(apr_mmap_t *));
+        }
+
+      /* Any previously spilled data has been read, so start over. */
+      buf->spill = buf->map_file;
+      buf->spill_start = 0;
+
+      if (buf->spill_all_contents)
+        {
+          for (mem = buf->head; mem != NULL; mem = mem->next)
+            {
+              SVN_ERR(write_mapped(buf, buf->spill_start, mem->data,
+                                   mem->size, scratch_pool));
+              buf->spill_start += mem->size;
+            }
+        }
+
+      return SVN_NO_ERROR;
+    }
+#endif
+
+  SVN_ERR(svn_io_open_unique_file3(&buf->spill,
+                                   &buf->filename,
+                                   buf->dirpath,
+                                   (buf->delete_on_close
+                                    ? svn_io_file_del_on_close
+                                    : svn_io_file_del_none),
+                                   buf->pool, scratch_pool));
+
+  /* Optionally write the memory contents into the file. */
+  if (buf->spill_all_contents)
+    {
+      mem = buf->head;
+      while (mem != NULL)
+        {
+          SVN_ERR(svn_io_file_write_full(buf->spill, mem->data, mem->size,
+                                         NULL, scratch_pool));
+          mem = mem->next;
+        }
+
+      /* Adjust the start offset for reading from the spill file.
+
+         This way, the first `buf->memory_size` bytes of data will
+         be read from the existing in-memory buffers, which makes
+         more sense than discarding the buffers and re-reading
+         data from the file. */
+      buf->spill_start = buf->memory_size;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
 svn_error_t *
 svn_spillbuf__write(svn_spillbuf_t *buf,
                     const char *data,
@@ -243,35 +525,19 @@ svn_spillbuf__write(svn_spillbuf_t *buf,
      the temporary file.  */
   if (buf->spill == NULL
       && ((buf->maxsize - buf->memory_size) < len))
-    {
-      SVN_ERR(svn_io_open_unique_file3(&buf->spill,
-                                       &buf->filename,
-                                       buf->dirpath,
-                                       (buf->delete_on_close
-                                        ? svn_io_file_del_on_close
-                                        : svn_io_file_del_none),
-                                       buf->pool, scratch_pool));
-
-      /* Optionally write the memory contents into the file. */
-      if (buf->spill_all_contents)
-        {
-          mem = buf->head;
-          while (mem != NULL)
-            {
-              SVN_ERR(svn_io_file_write_full(buf->spill, mem->data, mem->size,
-                                             NULL, scratch_pool));
-              mem = mem->next;
-            }
+    SVN_ERR(start_spilling(buf, scratch_pool));
 
-          /* Adjust the start offset for reading from the spill file.
+#if APR_HAS_MMAP
+  /* Mapped spill storage is addressed directly; no seeking required. */
+  if (buf->spill != NULL && buf->mapped)
+    {
+      SVN_ERR(write_mapped(buf, buf->spill_start + buf->spill_size,
+                           data, len, scratch_pool));
+      buf->spill_size += len;
 
-             This way, the first `buf->memory_size` bytes of data will
-             be read from the existing in-memory buffers, which makes
-             more sense than discarding the buffers and re-reading
-             data from the file. */
-          buf->spill_start = buf->memory_size;
-        }
+      return SVN_NO_ERROR;
     }
+#endif
 
   /* Once a spill file has been constructed, then we need to put all
      arriving data into the file. We will no longer attempt to hold it
@@ -378,6 +644,43 @@ read_data(struct memblock_t **mem,
       return SVN_NO_ERROR;
     }
 
+#if APR_HAS_MMAP
+  /* Hand out a slice of the mapping instead of copying the data. */
+  if (buf->mapped)
+    {
+      char *address;
+      apr_size_t size = SPILL_EXTENT_SIZE
+                      - (apr_size_t)(buf->spill_start % SPILL_EXTENT_SIZE);
+      if (size > buf->blocksize)
+        size = buf->blocksize;
+      if ((apr_uint64_t)buf->spill_size < (apr_uint64_t)size)
+        size = (apr_size_t)buf->spill_size;
+
+      /* The slice handed out by the previous read is no longer in use,
+         so all extents before the current one may be recycled. */
+      release_extents(buf, buf->spill_start / SPILL_EXTENT_SIZE);
+      SVN_ERR(map_address(&address, buf, buf->spill_start, scratch_pool));
+
+      *mem = &buf->map_block;
+      (*mem)->data = address;
+      (*mem)->size = size;
+      (*mem)->next = NULL;
+
+      buf->spill_start += size;
+
+      /* Once drained, stop spilling but keep the storage for re-use. */
+      if ((buf->spill_size -= size) == 0)
+        {
+          release_extents(buf, buf->first_extent + buf->extents->nelts);
+          buf->spill = NULL;
+          buf->spill_start = 0;
+          buf->first_extent = 0;
+        }
+
+      return SVN_NO_ERROR;
+    }
+#endif
+
   /* Assume that the caller has seeked the spill file to the correct pos.  */
 
   /* Get a buffer that we can read content into.  */
@@ -423,7 +726,7 @@ maybe_seek(svn_boolean_t *seeked,
            const svn_spillbuf_t *buf,
            apr_pool_t *scratch_pool)
 {
-  if (buf->head == NULL && buf->spill != NULL)
+  if (buf->head == NULL && buf->spill != NULL && !buf->mapped)
     {
       apr_off_t output_unused;
 
@@ -470,8 +773,9 @@ svn_spillbuf__read(const char **data,
       if (buf->out_for_reading != NULL)
         return_buffer(buf, buf->out_for_reading);
 
-      /* Remember that we've passed this block out for reading.  */
-      buf->out_for_reading = mem;
+      /* Remember that we've passed this block out for reading.
+         Slices of the spill mapping are not ours to recycle.  */
+      buf->out_for_reading = (mem == &buf->map_block) ? NULL : mem;
     }
 
   return SVN_NO_ERROR;
@@ -513,7 +817,7 @@ svn_spillbuf__process(svn_boolean_t *exhausted,
 
       err = read_func(&stop, read_baton, mem->data, mem->size, iterpool);
 
-      return_buffer(buf, mem);
+      release_buffer(buf, mem);
 
       if (err)
         return svn_error_trace(err);
@@ -37,6 +37,7 @@
 #include "private/svn_atomic.h"
 #include "private/svn_skel.h"
 #include "private/svn_token.h"
+#include "private/svn_trace.h"
 #ifdef WIN32
 #include "private/svn_io_private.h"
 #include "private/svn_utf_private.h"
@@ -243,6 +244,10 @@ exec_sql2(svn_sqlite__db_t *db, const char *sql, int ignored_err)
 }
 
 
+/* Trace probes for statement preparation and execution. */
+SVN_TRACE__PROBE(prepare_probe, "sqlite.prepare");
+SVN_TRACE__PROBE(step_probe, "sqlite.step");
+
 static svn_error_t *
 prepare_statement(svn_sqlite__stmt_t **stmt, svn_sqlite__db_t *db,
                   const char *text, apr_pool_t *result_pool)
@@ -251,6 +256,7 @@ prepare_statement(svn_sqlite__stmt_t **stmt, svn_sqlite__db_t *db,
   (*stmt)->db = db;
   (*stmt)->needs_reset = FALSE;
 
+  SVN_TRACE__COUNT(prepare_probe, 1);
   SQLITE_ERR(sqlite3_prepare_v2(db->db3, text, -1, &(*stmt)->s3stmt, NULL), db);
 
   return SVN_NO_ERROR;
@@ -344,7 +350,9 @@ svn_sqlite__step_row(svn_sqlite__stmt_t *stmt)
 svn_error_t *
 svn_sqlite__step(svn_boolean_t *got_row, svn_sqlite__stmt_t *stmt)
 {
+  apr_time_t trace_start = SVN_TRACE__SPAN_START();
   int sqlite_result = sqlite3_step(stmt->s3stmt);
+  SVN_TRACE__SPAN_END(step_probe, trace_start);
 
   if (sqlite_result != SQLITE_DONE && sqlite_result != SQLITE_ROW)
     {
@@ -57,6 +57,7 @@ struct svn_stream_t {
   svn_read_fn_t read_full_fn;
   svn_stream_skip_fn_t skip_fn;
   svn_write_fn_t write_fn;
+  svn_stream_writev_fn_t writev_fn;
   svn_close_fn_t close_fn;
   svn_stream_mark_fn_t mark_fn;
   svn_stream_seek_fn_t seek_fn;
@@ -113,6 +114,12 @@ svn_stream_set_write(svn_stream_t *stream, svn_write_fn_t write_fn)
   stream->write_fn = write_fn;
 }
 
+void
+svn_stream_set_writev(svn_stream_t *stream, svn_stream_writev_fn_t writev_fn)
+{
+  stream->writev_fn = writev_fn;
+}
+
 void
 svn_stream_set_close(svn_stream_t *stream, svn_close_fn_t close_fn)
 {
@@ -221,6 +228,36 @@ svn_stream_write(svn_stream_t *stream, const char *data, apr_size_t *len)
   return svn_error_trace(stream->write_fn(stream->baton, data, len));
 }
 
+/* Standard implementation for svn_stream_writev() based on one
+   svn_stream_write() call per buffer. */
+static svn_error_t *
+writev_fallback(svn_stream_t *stream, const struct iovec *vec, int nvec)
+{
+  int i;
+  for (i = 0; i < nvec; ++i)
+    {
+      apr_size_t len = vec[i].iov_len;
+      if (len)
+        SVN_ERR(stream->write_fn(stream->baton, vec[i].iov_base, &len));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_stream_writev(svn_stream_t *stream, const struct iovec *vec, int nvec)
+{
+  if (stream->writev_fn == NULL)
+    {
+      if (stream->write_fn == NULL)
+        return svn_error_create(SVN_ERR_STREAM_NOT_SUPPORTED, NULL, NULL);
+
+      return svn_error_trace(writev_fallback(stream, vec, nvec));
+    }
+
+  return svn_error_trace(stream->writev_fn(stream->baton, vec, nvec));
+}
+
 
 svn_error_t *
 svn_stream_reset(svn_stream_t *stream)
@@ -560,6 +597,17 @@ write_handler_tee(void *baton, const char *data, apr_size_t *len)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+writev_handler_tee(void *baton, const struct iovec *vec, int nvec)
+{
+  struct baton_tee *bt = baton;
+
+  SVN_ERR(svn_stream_writev(bt->out1, vec, nvec));
+  SVN_ERR(svn_stream_writev(bt->out2, vec, nvec));
+
+  return SVN_NO_ERROR;
+}
+
 
 static svn_error_t *
 close_handler_tee(void *baton)
@@ -592,6 +640,7 @@ svn_stream_tee(svn_stream_t *out1,
   baton->out2 = out2;
   stream = svn_stream_create(baton, pool);
   svn_stream_set_write(stream, write_handler_tee);
+  svn_stream_set_writev(stream, writev_handler_tee);
   svn_stream_set_close(stream, close_handler_tee);
 
   return stream;
@@ -625,6 +674,12 @@ write_handler_disown(void *baton, const char *buffer, apr_size_t *len)
   return svn_error_trace(svn_stream_write(baton, buffer, len));
 }
 
+static svn_error_t *
+writev_handler_disown(void *baton, const struct iovec *vec, int nvec)
+{
+  return svn_error_trace(svn_stream_writev(baton, vec, nvec));
+}
+
 static svn_error_t *
 mark_handler_disown(void *baton, svn_stream_mark_t **mark, apr_pool_t *pool)
 {
@@ -662,6 +717,7 @@ svn_stream_disown(svn_stream_t *stream, apr_pool_t *pool)
   svn_stream_set_read2(s, read_handler_disown, read_full_handler_disown);
   svn_stream_set_skip(s, skip_handler_disown);
   svn_stream_set_write(s, write_handler_disown);
+  svn_stream_set_writev(s, writev_handler_disown);
   svn_stream_set_mark(s, mark_handler_disown);
   svn_stream_set_seek(s, seek_handler_disown);
   svn_stream_set_data_available(s, data_available_disown);
@@ -771,6 +827,15 @@ write_handler_apr(void *baton, const char *data, apr_size_t *len)
   return svn_error_trace(err);
 }
 
+static svn_error_t *
+writev_handler_apr(void *baton, const struct iovec *vec, int nvec)
+{
+  struct baton_apr *btn = baton;
+
+  return svn_error_trace(svn_io__file_writev_full(btn->file, vec, nvec,
+                                                  btn->pool));
+}
+
 static svn_error_t *
 close_handler_apr(void *baton)
 {
@@ -1084,6 +1149,7 @@ make_stream_from_apr_file(apr_file_t *file,
   stream = svn_stream_create(baton, pool);
   svn_stream_set_read2(stream, read_handler_apr, read_full_handler_apr);
   svn_stream_set_write(stream, write_handler_apr);
+  svn_stream_set_writev(stream, writev_handler_apr);
 
   if (supports_seek)
     {
@@ -1243,14 +1309,10 @@ read_handler_gz(void *baton, char *buffer, apr_size_t *len)
   return SVN_NO_ERROR;
 }
 
-/* Compress data and write it to the substream */
+/* Initialize the compressor in BTN, if that has not been done, yet. */
 static svn_error_t *
-write_handler_gz(void *baton, const char *buffer, apr_size_t *len)
+init_deflate_gz(struct zbaton *btn)
 {
-  struct zbaton *btn = baton;
-  apr_pool_t *subpool;
-  void *write_buf;
-  apr_size_t buf_size, write_len;
   int zerr;
 
   if (btn->out == NULL)
@@ -1264,32 +1326,79 @@ write_handler_gz(void *baton, const char *buffer, apr_size_t *len)
       SVN_ERR(svn_error__wrap_zlib(zerr, "deflateInit", btn->out->msg));
     }
 
+  return SVN_NO_ERROR;
+}
+
+/* Compress the NVEC buffers in VEC as one and write the result to the
+   substream.  Data gets collected in a single output buffer such that
+   the substream sees as few writes as possible. */
+static svn_error_t *
+writev_handler_gz(void *baton, const struct iovec *vec, int nvec)
+{
+  struct zbaton *btn = baton;
+  apr_pool_t *subpool;
+  void *write_buf;
+  apr_size_t buf_size, write_len;
+  apr_size_t total = 0;
+  int zerr, i;
+
+  SVN_ERR(init_deflate_gz(btn));
+
+  for (i = 0; i < nvec; ++i)
+    total += vec[i].iov_len;
+
   /* The largest buffer we should need is 0.1% larger than the
      compressed data, + 12 bytes. This info comes from zlib.h.  */
-  buf_size = *len + (*len / 1000) + 13;
+  buf_size = total + (total / 1000) + 13;
   subpool = svn_pool_create(btn->pool);
   write_buf = apr_palloc(subpool, buf_size);
 
-  btn->out->next_in = (Bytef *) buffer;  /* Casting away const! */
-  btn->out->avail_in = (uInt) *len;
+  btn->out->next_out = write_buf;
+  btn->out->avail_out = (uInt) buf_size;
 
-  while (btn->out->avail_in > 0)
+  for (i = 0; i < nvec; ++i)
     {
-      btn->out->next_out = write_buf;
-      btn->out->avail_out = (uInt) buf_size;
-
-      zerr = deflate(btn->out, Z_NO_FLUSH);
-      SVN_ERR(svn_error__wrap_zlib(zerr, "deflate", btn->out->msg));
-      write_len = buf_size - btn->out->avail_out;
-      if (write_len > 0)
-        SVN_ERR(svn_stream_write(btn->substream, write_buf, &write_len));
+      btn->out->next_in = (Bytef *) vec[i].iov_base;
+      btn->out->avail_in = (uInt) vec[i].iov_len;
+
+      while (btn->out->avail_in > 0)
+        {
+          zerr = deflate(btn->out, Z_NO_FLUSH);
+          SVN_ERR(svn_error__wrap_zlib(zerr, "deflate", btn->out->msg));
+
+          /* Only flush the output buffer when it is full. */
+          if (btn->out->avail_out == 0)
+            {
+              write_len = buf_size;
+              SVN_ERR(svn_stream_write(btn->substream, write_buf,
+                                       &write_len));
+              btn->out->next_out = write_buf;
+              btn->out->avail_out = (uInt) buf_size;
+            }
+        }
     }
 
+  write_len = buf_size - btn->out->avail_out;
+  if (write_len > 0)
+    SVN_ERR(svn_stream_write(btn->substream, write_buf, &write_len));
+
   svn_pool_destroy(subpool);
 
   return SVN_NO_ERROR;
 }
 
+/* Compress data and write it to the substream */
+static svn_error_t *
+write_handler_gz(void *baton, const char *buffer, apr_size_t *len)
+{
+  struct iovec vec;
+
+  vec.iov_base = (void *)buffer;  /* Casting away const! */
+  vec.iov_len = *len;
+
+  return svn_error_trace(writev_handler_gz(baton, &vec, 1));
+}
+
 /* Handle flushing and closing the stream */
 static svn_error_t *
 close_handler_gz(void *baton)
@@ -1353,6 +1462,7 @@ svn_stream_compressed(svn_stream_t *stream, apr_pool_t *pool)
   svn_stream_set_read2(zstream, NULL /* only full read support */,
                        read_handler_gz);
   svn_stream_set_write(zstream, write_handler_gz);
+  svn_stream_set_writev(zstream, writev_handler_gz);
   svn_stream_set_close(zstream, close_handler_gz);
 
   return zstream;
@@ -1417,6 +1527,21 @@ write_handler_checksum(void *baton, const char *buffer, apr_size_t *len)
   return svn_error_trace(svn_stream_write(btn->proxy, buffer, len));
 }
 
+static svn_error_t *
+writev_handler_checksum(void *baton, const struct iovec *vec, int nvec)
+{
+  struct checksum_stream_baton *btn = baton;
+  int i;
+
+  if (btn->write_checksum)
+    for (i = 0; i < nvec; ++i)
+      if (vec[i].iov_len > 0)
+        SVN_ERR(svn_checksum_update(btn->write_ctx, vec[i].iov_base,
+                                    vec[i].iov_len));
+
+  return svn_error_trace(svn_stream_writev(btn->proxy, vec, nvec));
+}
+
 static svn_error_t *
 data_available_handler_checksum(void *baton, svn_boolean_t *data_available)
 {
@@ -1514,6 +1639,7 @@ svn_stream_checksummed2(svn_stream_t *stream,
   s = svn_stream_create(baton, pool);
   svn_stream_set_read2(s, read_handler_checksum, read_full_handler_checksum);
   svn_stream_set_write(s, write_handler_checksum);
+  svn_stream_set_writev(s, writev_handler_checksum);
   svn_stream_set_data_available(s, data_available_handler_checksum);
   svn_stream_set_close(s, close_handler_checksum);
   if (svn_stream_supports_reset(stream))
@@ -2071,6 +2197,20 @@ write_handler_lazyopen(void *baton,
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_stream_writev_fn_t */
+static svn_error_t *
+writev_handler_lazyopen(void *baton,
+                        const struct iovec *vec,
+                        int nvec)
+{
+  lazyopen_baton_t *b = baton;
+
+  SVN_ERR(lazyopen_if_unopened(b));
+  SVN_ERR(svn_stream_writev(b->real_stream, vec, nvec));
+
+  return SVN_NO_ERROR;
+}
+
 /* Implements svn_close_fn_t */
 static svn_error_t *
 close_handler_lazyopen(void *baton)
@@ -2158,6 +2298,7 @@ svn_stream_lazyopen_create(svn_stream_lazyopen_func_t open_func,
                        read_full_handler_lazyopen);
   svn_stream_set_skip(stream, skip_handler_lazyopen);
   svn_stream_set_write(stream, write_handler_lazyopen);
+  svn_stream_set_writev(stream, writev_handler_lazyopen);
   svn_stream_set_close(stream, close_handler_lazyopen);
   svn_stream_set_mark(stream, mark_handler_lazyopen);
   svn_stream_set_seek(stream, seek_handler_lazyopen);
@@ -0,0 +1,570 @@
+/* trace.c : lightweight counters and timer spans
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include <apr_thread_proc.h>
+
+#include "svn_pools.h"
+#include "svn_io.h"
+
+#include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
+#include "private/svn_trace.h"
+
+#include "svn_private_config.h"
+
+#ifdef WIN32
+#include <process.h>    /* for _getpid() */
+#elif defined(HAVE_UNISTD_H)
+#include <unistd.h>     /* for getpid() */
+#endif
+
+/* Maximum number of distinct probes per process.  Probes beyond that
+ * limit will silently be ignored. */
+#define MAX_PROBES 128
+
+/* Probe ID assigned to probes that did not fit into MAX_PROBES. */
+#define NO_PROBE_ID (MAX_PROBES + 1)
+
+/* Number of spans to keep per thread.  Older spans get overwritten. */
+#define EVENT_CAPACITY 1024
+
+/* A recorded span. */
+typedef struct event_t
+{
+  /* When the span started. */
+  apr_time_t start;
+
+  /* Its duration in microseconds. */
+  apr_uint32_t duration;
+
+  /* The probe that recorded it. */
+  apr_uint32_t probe_id;
+} event_t;
+
+/* Data collected for a single thread.  Only ever modified by the owning
+ * thread, except for IN_USE.  Instances get recycled when their thread
+ * terminates. */
+typedef struct thread_data_t
+{
+  /* Counters and accumulated durations (in microseconds), indexed by
+   * probe ID - 1. */
+  apr_uint64_t counts[MAX_PROBES];
+  apr_uint64_t durations[MAX_PROBES];
+
+  /* Ring buffer of the latest spans.  EVENT_COUNT is the total number of
+   * spans ever recorded in it. */
+  event_t events[EVENT_CAPACITY];
+  apr_uint64_t event_count;
+
+  /* Value of RESET_GENERATION when the data above was last cleared.
+   * Data of older generations counts as zero. */
+  volatile svn_atomic_t generation;
+
+  /* Small integer identifying this instance in trace output. */
+  int thread_id;
+
+  /* TRUE while owned by a thread. */
+  volatile svn_boolean_t in_use;
+
+  /* Next instance in the global list. */
+  struct thread_data_t *next;
+} thread_data_t;
+
+/* Whether probes shall record any data. */
+static volatile svn_boolean_t trace_enabled = FALSE;
+
+/* Incremented by every reset.  Threads clear their own data when they
+ * notice a change, such that resets never race with updates. */
+static volatile svn_atomic_t reset_generation = 0;
+
+/* Initialization state of the following variables. */
+static volatile svn_atomic_t init_status = 0;
+
+/* Serializes access to the following variables. */
+static svn_mutex__t *mutex = NULL;
+
+/* Pool for all global data structures. */
+static apr_pool_t *global_pool = NULL;
+
+/* Names of the registered probes, indexed by probe ID - 1. */
+static const char *probe_names[MAX_PROBES];
+static apr_uint32_t probe_count = 0;
+
+/* List of all per-thread data instances. */
+static thread_data_t *threads = NULL;
+static int thread_count = 0;
+
+#if APR_HAS_THREADS
+/* Key to the current thread's thread_data_t. */
+static apr_threadkey_t *thread_key = NULL;
+#else
+/* The only thread's data. */
+static thread_data_t *single_thread = NULL;
+#endif
+
+#if APR_HAS_THREADS
+/* Thread key destructor returning the thread_data_t at DATA for reuse. */
+static void
+release_thread_data(void *data)
+{
+  thread_data_t *thread = data;
+  thread->in_use = FALSE;
+}
+#endif
+
+/* svn_atomic__str_init_func_t implementation setting up the global
+ * data structures.  BATON is not used. */
+static const char *
+init_trace(void *baton)
+{
+  svn_error_t *err;
+
+  global_pool = svn_pool_create(NULL);
+  err = svn_mutex__init(&mutex, TRUE, global_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      return "Couldn't create the trace mutex";
+    }
+
+#if APR_HAS_THREADS
+  if (apr_threadkey_private_create(&thread_key, release_thread_data,
+                                   global_pool))
+    return "Couldn't create the trace thread key";
+#endif
+
+  return NULL;
+}
+
+/* Return the thread_data_t for the current thread, creating it if
+ * necessary.  Return NULL if that fails. */
+static thread_data_t *
+get_thread_data(void)
+{
+  thread_data_t *thread = NULL;
+  svn_error_t *err;
+
+#if APR_HAS_THREADS
+  void *data;
+  if (apr_threadkey_private_get(&data, thread_key) == APR_SUCCESS && data)
+    return data;
+#else
+  if (single_thread)
+    return single_thread;
+#endif
+
+  err = svn_mutex__lock(mutex);
+  if (err)
+    {
+      svn_error_clear(err);
+      return NULL;
+    }
+
+  /* recycle the data of a terminated thread or create a new one */
+  for (thread = threads; thread; thread = thread->next)
+    if (!thread->in_use)
+      break;
+
+  if (!thread)
+    {
+      thread = apr_pcalloc(global_pool, sizeof(*thread));
+      thread->thread_id = ++thread_count;
+      thread->next = threads;
+      threads = thread;
+    }
+
+  thread->in_use = TRUE;
+  svn_error_clear(svn_mutex__unlock(mutex, SVN_NO_ERROR));
+
+#if APR_HAS_THREADS
+  apr_threadkey_private_set(thread, thread_key);
+#else
+  single_thread = thread;
+#endif
+
+  return thread;
+}
+
+/* Return the ID of PROBE, registering it if necessary.  Returns
+ * NO_PROBE_ID if PROBE cannot be registered. */
+static apr_uint32_t
+get_probe_id(svn_trace__probe_t *probe)
+{
+  svn_error_t *err;
+  apr_uint32_t id = probe->id;
+  if (id)
+    return id;
+
+  err = svn_mutex__lock(mutex);
+  if (err)
+    {
+      svn_error_clear(err);
+      return NO_PROBE_ID;
+    }
+
+  /* another thread might have registered it in the meantime */
+  if (!probe->id)
+    {
+      if (probe_count < MAX_PROBES)
+        {
+          probe_names[probe_count++] = probe->name;
+          probe->id = probe_count;
+        }
+      else
+        {
+          probe->id = NO_PROBE_ID;
+        }
+    }
+
+  id = probe->id;
+  svn_error_clear(svn_mutex__unlock(mutex, SVN_NO_ERROR));
+
+  return id;
+}
+
+svn_boolean_t
+svn_trace__enabled(void)
+{
+  return trace_enabled;
+}
+
+svn_error_t *
+svn_trace__enable(svn_boolean_t enable)
+{
+  const char *errstr
+    = svn_atomic__init_once_no_error(&init_status, init_trace, NULL);
+  if (errstr)
+    return svn_error_create(SVN_ERR_ATOMIC_INIT_FAILURE, NULL, errstr);
+
+  trace_enabled = enable;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return TRUE if the data of THREAD has not been invalidated by a reset,
+ * i.e. is not logically zero. */
+static svn_boolean_t
+is_current(const thread_data_t *thread)
+{
+  return thread->generation == svn_atomic_read(&reset_generation);
+}
+
+/* Clear the data of THREAD, if there has been a reset since we did that
+ * last.  To be called by the thread owning THREAD only. */
+static void
+sync_generation(thread_data_t *thread)
+{
+  svn_atomic_t generation = svn_atomic_read(&reset_generation);
+  if (thread->generation != generation)
+    {
+      memset(thread->counts, 0, sizeof(thread->counts));
+      memset(thread->durations, 0, sizeof(thread->durations));
+      thread->event_count = 0;
+      svn_atomic_set(&thread->generation, generation);
+    }
+}
+
+/* Invalidate all per-thread data.  To be called with MUTEX being held. */
+static svn_error_t *
+reset_locked(void)
+{
+  svn_atomic_inc(&reset_generation);
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_trace__reset(void)
+{
+  /* Nothing to reset if tracing has never been enabled. */
+  if (!mutex)
+    return SVN_NO_ERROR;
+
+  SVN_MUTEX__WITH_LOCK(mutex, reset_locked());
+
+  return SVN_NO_ERROR;
+}
+
+void
+svn_trace__count(svn_trace__probe_t *probe,
+                 apr_uint64_t amount)
+{
+  thread_data_t *thread;
+  apr_uint32_t id;
+
+  if (!trace_enabled)
+    return;
+
+  id = get_probe_id(probe);
+  thread = get_thread_data();
+  if (id == NO_PROBE_ID || !thread)
+    return;
+
+  sync_generation(thread);
+  thread->counts[id - 1] += amount;
+}
+
+void
+svn_trace__span(svn_trace__probe_t *probe,
+                apr_time_t start)
+{
+  thread_data_t *thread;
+  apr_uint32_t id;
+  apr_time_t duration;
+  event_t *event;
+
+  if (!trace_enabled)
+    return;
+
+  id = get_probe_id(probe);
+  thread = get_thread_data();
+  if (id == NO_PROBE_ID || !thread)
+    return;
+
+  /* Clocks may jump backwards. */
+  duration = apr_time_now() - start;
+  if (duration < 0)
+    duration = 0;
+
+  sync_generation(thread);
+  thread->counts[id - 1]++;
+  thread->durations[id - 1] += duration;
+
+  event = &thread->events[thread->event_count % EVENT_CAPACITY];
+  event->start = start;
+  event->duration = duration > APR_UINT32_MAX
+                  ? APR_UINT32_MAX
+                  : (apr_uint32_t)duration;
+  event->probe_id = id;
+  thread->event_count++;
+}
+
+svn_error_t *
+svn_trace__parse_format(svn_trace__format_t *format,
+                        const char *name)
+{
+  if (strcmp(name, "json") == 0)
+    *format = svn_trace__format_json;
+  else if (strcmp(name, "chrome") == 0)
+    *format = svn_trace__format_chrome;
+  else if (strcmp(name, "prometheus") == 0)
+    *format = svn_trace__format_prometheus;
+  else
+    return svn_error_createf(SVN_ERR_INCORRECT_PARAMS, NULL,
+                             _("Unknown trace format '%s'"), name);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the ID of the current process. */
+static int
+get_pid(void)
+{
+#ifdef WIN32
+  return _getpid();
+#elif defined(HAVE_UNISTD_H)
+  return (int)getpid();
+#else
+  return 0;
+#endif
+}
+
+/* Sum up the counters and durations of all threads in COUNTS and
+ * DURATIONS, respectively.  To be called with MUTEX being held. */
+static void
+get_totals(apr_uint64_t *counts,
+           apr_uint64_t *durations)
+{
+  thread_data_t *thread;
+  apr_uint32_t i;
+
+  memset(counts, 0, MAX_PROBES * sizeof(*counts));
+  memset(durations, 0, MAX_PROBES * sizeof(*durations));
+
+  for (thread = threads; thread; thread = thread->next)
+    for (i = 0; i < probe_count && is_current(thread); ++i)
+      {
+        counts[i] += thread->counts[i];
+        durations[i] += thread->durations[i];
+      }
+}
+
+/* Implement svn_trace__write for the JSON format.  To be called with
+ * MUTEX being held. */
+static svn_error_t *
+write_json(svn_stream_t *stream,
+           apr_pool_t *scratch_pool)
+{
+  apr_uint64_t counts[MAX_PROBES];
+  apr_uint64_t durations[MAX_PROBES];
+  apr_uint32_t i;
+
+  get_totals(counts, durations);
+
+  SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                            "{\"pid\":%d,\"threads\":%d,\"probes\":[",
+                            get_pid(), thread_count));
+
+  for (i = 0; i < probe_count; ++i)
+    SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                              "%s\n{\"name\":\"%s\",\"count\":%"
+                              APR_UINT64_T_FMT ",\"usec\":%"
+                              APR_UINT64_T_FMT "}",
+                              i ? "," : "", probe_names[i],
+                              counts[i], durations[i]));
+
+  return svn_error_trace(svn_stream_puts(stream, "\n]}\n"));
+}
+
+/* Implement svn_trace__write for the Chrome trace event format.  To be
+ * called with MUTEX being held. */
+static svn_error_t *
+write_chrome(svn_stream_t *stream,
+             apr_pool_t *scratch_pool)
+{
+  apr_uint64_t counts[MAX_PROBES];
+  apr_uint64_t durations[MAX_PROBES];
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_time_t now = apr_time_now();
+  int pid = get_pid();
+  const char *separator = "";
+  thread_data_t *thread;
+  apr_uint32_t i;
+
+  get_totals(counts, durations);
+
+  SVN_ERR(svn_stream_puts(stream, "{\"traceEvents\":["));
+
+  /* all spans still present in the ring buffers, oldest first */
+  for (thread = threads; thread; thread = thread->next)
+    {
+      apr_uint64_t event_count = is_current(thread) ? thread->event_count : 0;
+      apr_uint64_t k = event_count > EVENT_CAPACITY
+                     ? event_count - EVENT_CAPACITY
+                     : 0;
+
+      for (; k < event_count; ++k)
+        {
+          const event_t *event = &thread->events[k % EVENT_CAPACITY];
+
+          svn_pool_clear(iterpool);
+          SVN_ERR(svn_stream_printf(stream, iterpool,
+                                    "%s\n{\"name\":\"%s\",\"cat\":\"svn\","
+                                    "\"ph\":\"X\",\"ts\":%" APR_TIME_T_FMT
+                                    ",\"dur\":%u,\"pid\":%d,\"tid\":%d}",
+                                    separator,
+                                    probe_names[event->probe_id - 1],
+                                    event->start,
+                                    (unsigned)event->duration,
+                                    pid, thread->thread_id));
+          separator = ",";
+        }
+    }
+
+  /* counter totals */
+  for (i = 0; i < probe_count; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_stream_printf(stream, iterpool,
+                                "%s\n{\"name\":\"%s\",\"cat\":\"svn\","
+                                "\"ph\":\"C\",\"ts\":%" APR_TIME_T_FMT
+                                ",\"pid\":%d,\"args\":{\"count\":%"
+                                APR_UINT64_T_FMT ",\"usec\":%"
+                                APR_UINT64_T_FMT "}}",
+                                separator, probe_names[i], now, pid,
+                                counts[i], durations[i]));
+      separator = ",";
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_stream_puts(stream,
+                                         "\n],\"displayTimeUnit\":\"ms\"}\n"));
+}
+
+/* Implement svn_trace__write for the Prometheus text format.  To be
+ * called with MUTEX being held. */
+static svn_error_t *
+write_prometheus(svn_stream_t *stream,
+                 apr_pool_t *scratch_pool)
+{
+  apr_uint64_t counts[MAX_PROBES];
+  apr_uint64_t durations[MAX_PROBES];
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_uint32_t i;
+
+  get_totals(counts, durations);
+
+  SVN_ERR(svn_stream_puts(stream,
+                          "# HELP svn_trace_count_total Calls or units "
+                          "counted by each trace probe.\n"
+                          "# TYPE svn_trace_count_total counter\n"));
+  for (i = 0; i < probe_count; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_stream_printf(stream, iterpool,
+                                "svn_trace_count_total{probe=\"%s\"} %"
+                                APR_UINT64_T_FMT "\n",
+                                probe_names[i], counts[i]));
+    }
+
+  SVN_ERR(svn_stream_puts(stream,
+                          "# HELP svn_trace_seconds_total Time spent in the "
+                          "spans of each trace probe.\n"
+                          "# TYPE svn_trace_seconds_total counter\n"));
+  for (i = 0; i < probe_count; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_stream_printf(stream, iterpool,
+                                "svn_trace_seconds_total{probe=\"%s\"} "
+                                "%.6f\n",
+                                probe_names[i],
+                                (double)durations[i] / APR_USEC_PER_SEC));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_trace__write(svn_stream_t *stream,
+                 svn_trace__format_t format,
+                 apr_pool_t *scratch_pool)
+{
+  /* Make sure there is a mutex, even if tracing has never been enabled.
+   * The output will simply be empty in that case. */
+  const char *errstr
+    = svn_atomic__init_once_no_error(&init_status, init_trace, NULL);
+  if (errstr)
+    return svn_error_create(SVN_ERR_ATOMIC_INIT_FAILURE, NULL, errstr);
+
+  if (format == svn_trace__format_chrome)
+    SVN_MUTEX__WITH_LOCK(mutex, write_chrome(stream, scratch_pool));
+  else if (format == svn_trace__format_prometheus)
+    SVN_MUTEX__WITH_LOCK(mutex, write_prometheus(stream, scratch_pool));
+  else
+    SVN_MUTEX__WITH_LOCK(mutex, write_json(stream, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
@@ -44,6 +44,7 @@
 
 #include "private/svn_fspath.h"
 #include "private/svn_subr_private.h"
+#include "private/svn_trace.h"
 
 #include "dav_svn.h"
 #include "mod_authz_svn.h"
@@ -664,6 +665,19 @@ SVNUseUTF8_cmd(cmd_parms *cmd, void *config, int arg)
   return NULL;
 }
 
+static const char *
+SVNTrace_cmd(cmd_parms *cmd, void *config, int arg)
+{
+  svn_error_t *err = svn_trace__enable(arg);
+  if (err)
+    {
+      svn_error_clear(err);
+      return "Could not initialize SVN tracing.";
+    }
+
+  return NULL;
+}
+
 static const char *
 SVNHooksEnv_cmd(cmd_parms *cmd, void *config, const char *arg1)
 {
@@ -1401,6 +1415,13 @@ static const command_rec cmds[] =
                RSRC_CONF,
                "use UTF-8 as native character encoding (default is ASCII)."),
 
+  /* per server */
+  AP_INIT_FLAG("SVNTrace", SVNTrace_cmd, NULL,
+               RSRC_CONF,
+               "enables Subversion's internal counters and timers; query "
+               "them per process via the svn-status handler using "
+               "'?trace' or '?trace=chrome' (default is Off)."),
+
   /* per directory/location */
   AP_INIT_TAKE1("SVNHooksEnv", SVNHooksEnv_cmd, NULL,
                 ACCESS_CONF|RSRC_CONF,
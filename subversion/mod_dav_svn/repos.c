@@ -54,6 +54,7 @@
 #include "svn_ra.h"  /* for SVN_RA_CAPABILITY_* */
 #include "svn_dirent_uri.h"
 #include "private/svn_log.h"
+#include "private/svn_fs_private.h"
 #include "private/svn_fspath.h"
 #include "private/svn_repos_private.h"
 #include "private/svn_sorts_private.h"
@@ -3859,6 +3860,50 @@ deliver(const dav_resource *resource, ap_filter_t *unused)
     {
       svn_stream_t *stream;
       char *block;
+      apr_file_t *fulltext = NULL;
+
+      /* Large files may be available as plain files.  Unless we need
+         to translate them, let httpd send them directly, which allows
+         it to use sendfile() or mmap(). */
+      if (!resource->info->keyword_subst)
+        {
+          serr = svn_fs__open_fulltext_file(&fulltext,
+                                            resource->info->root.root,
+                                            resource->info->repos_path,
+                                            resource->pool);
+          if (serr != NULL)
+            return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                        "could not prepare to read the file",
+                                        resource->pool);
+        }
+
+      if (fulltext)
+        {
+          apr_off_t size;
+
+          serr = svn_io_file_size_get(&size, fulltext, resource->pool);
+          if (serr != NULL)
+            return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                        "could not read the file contents",
+                                        resource->pool);
+
+          bb = apr_brigade_create(resource->pool,
+                                  dav_svn__output_get_bucket_alloc(output));
+          apr_brigade_insert_file(bb, fulltext, 0, size, resource->pool);
+          bkt = apr_bucket_eos_create(
+                  dav_svn__output_get_bucket_alloc(output));
+          APR_BRIGADE_INSERT_TAIL(bb, bkt);
+
+          serr = dav_svn__output_pass_brigade(output, bb);
+          apr_brigade_destroy(bb);
+          if (serr != NULL)
+            /* ### that HTTP code... */
+            return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                        "Could not write data to filter.",
+                                        resource->pool);
+
+          return NULL;
+        }
 
       serr = svn_fs_file_contents(&stream,
                                   resource->info->root.root,
@@ -28,6 +28,7 @@
 #include "dav_svn.h"
 #include "private/svn_cache.h"
 #include "private/svn_fs_private.h"
+#include "private/svn_trace.h"
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>   /* For getpid() */
@@ -66,7 +67,45 @@
      </Location>
 
   and then point a browser at http://server/svn-status.
+
+  With "SVNTrace On", http://server/svn-status?trace returns the counters
+  and timers of the process handling the request as JSON, while
+  http://server/svn-status?trace=chrome returns them in Chrome's trace
+  event format.
 */
+
+/* Send the trace data of the current process for request R in the
+   format given by FORMAT_NAME. */
+static int
+send_trace(request_rec *r,
+           const char *format_name)
+{
+  svn_trace__format_t format;
+  svn_stringbuf_t *buffer = svn_stringbuf_create_empty(r->pool);
+  svn_error_t *err;
+
+  err = svn_trace__parse_format(&format, format_name);
+  if (!err)
+    err = svn_trace__write(svn_stream_from_stringbuf(buffer, r->pool),
+                           format, r->pool);
+  if (err)
+    {
+      ap_log_rerror(APLOG_MARK, APLOG_ERR, err->apr_err, r,
+                    "mod_dav_svn: %s",
+                    err->message ? err->message : "trace output failed");
+      svn_error_clear(err);
+      return HTTP_BAD_REQUEST;
+    }
+
+  if (format == svn_trace__format_prometheus)
+    ap_set_content_type(r, "text/plain; version=0.0.4");
+  else
+    ap_set_content_type(r, "application/json");
+  ap_rwrite(buffer->data, (int)buffer->len, r);
+
+  return 0;
+}
+
 int dav_svn__status(request_rec *r)
 {
   svn_cache__info_t *info;
@@ -77,6 +116,11 @@ int dav_svn__status(request_rec *r)
   if (r->method_number != M_GET || strcmp(r->handler, "svn-status"))
     return DECLINED;
 
+  if (r->args && strcmp(r->args, "trace") == 0)
+    return send_trace(r, "json");
+  if (r->args && strncmp(r->args, "trace=", 6) == 0)
+    return send_trace(r, r->args + 6);
+
   info = svn_cache__membuffer_get_global_info(r->pool);
   text_stats = svn_cache__format_info(info, FALSE, r->pool);
   lines = svn_cstring_split(text_stats->data, "\n", FALSE, r->pool);
@@ -95,6 +95,8 @@ check_lib_versions(void)
 /** Subcommands. **/
 
 static svn_opt_subcommand_t
+  subcommand_build_date_index,
+  subcommand_build_path_index,
   subcommand_crashtest,
   subcommand_create,
   subcommand_delrevprop,
@@ -303,6 +305,26 @@ static const apr_getopt_option_t options_table[] =
  */
 static const svn_opt_subcommand_desc3_t cmd_table[] =
 {
+  {"build-date-index", subcommand_build_date_index, {0}, {N_(
+    "usage: svnadmin build-date-index REPOS_PATH\n"
+    "\n"), N_(
+    "Build the index of revision dates that speeds up looking up revisions\n"
+    "by date, e.g. for 'svn log -r {DATE}'.  Replaces any existing index.\n"
+    "Commits and revision property changes are blocked while the index gets\n"
+    "built.  Only FSFS and FSX repositories support this.\n"
+   )},
+   {'q'} },
+
+  {"build-path-index", subcommand_build_path_index, {0}, {N_(
+    "usage: svnadmin build-path-index REPOS_PATH\n"
+    "\n"), N_(
+    "Build the index of changed paths that speeds up 'svn log' and similar\n"
+    "history queries on sub-paths.  Replaces any existing index.  Once the\n"
+    "index exists, commits will keep it up to date.  Only FSFS and FSX\n"
+    "repositories support this.\n"
+   )},
+   {'q'} },
+
   {"crashtest", subcommand_crashtest, {0}, {N_(
     "usage: svnadmin crashtest REPOS_PATH\n"
     "\n"), N_(
@@ -1058,6 +1080,13 @@ repos_notify_handler(void *baton,
                                         notify->revision));
       return;
 
+    case svn_repos_notify_path_index_rev:
+    case svn_repos_notify_date_index_rev:
+      svn_error_clear(svn_stream_printf(feedback_stream, scratch_pool,
+                                        _("* Indexed revision %ld.\n"),
+                                        notify->revision));
+      return;
+
     case svn_repos_notify_verify_rev_structure:
       if (notify->revision == SVN_INVALID_REVNUM)
         svn_error_clear(svn_stream_puts(feedback_stream,
@@ -2160,6 +2189,56 @@ subcommand_setlog(apr_getopt_t *os, void *baton, apr_pool_t *pool)
 }
 
 
+/* This implements `svn_opt_subcommand_t'. */
+static svn_error_t *
+subcommand_build_date_index(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  struct svnadmin_opt_state *opt_state = baton;
+  svn_repos_t *repos;
+  svn_stream_t *feedback_stream = NULL;
+
+  /* Expect no more arguments. */
+  SVN_ERR(parse_args(NULL, os, 0, 0, pool));
+
+  SVN_ERR(open_repos(&repos, opt_state->repository_path, opt_state, pool));
+
+  /* Progress feedback goes to STDOUT, unless they asked to suppress it. */
+  if (! opt_state->quiet)
+    feedback_stream = recode_stream_create(stdout, pool);
+
+  return svn_error_trace(
+    svn_repos_build_date_index(repos,
+                               !opt_state->quiet ? repos_notify_handler
+                                                 : NULL,
+                               feedback_stream, check_cancel, NULL, pool));
+}
+
+
+/* This implements `svn_opt_subcommand_t'. */
+static svn_error_t *
+subcommand_build_path_index(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  struct svnadmin_opt_state *opt_state = baton;
+  svn_repos_t *repos;
+  svn_stream_t *feedback_stream = NULL;
+
+  /* Expect no more arguments. */
+  SVN_ERR(parse_args(NULL, os, 0, 0, pool));
+
+  SVN_ERR(open_repos(&repos, opt_state->repository_path, opt_state, pool));
+
+  /* Progress feedback goes to STDOUT, unless they asked to suppress it. */
+  if (! opt_state->quiet)
+    feedback_stream = recode_stream_create(stdout, pool);
+
+  return svn_error_trace(
+    svn_repos_build_path_index(repos,
+                               !opt_state->quiet ? repos_notify_handler
+                                                 : NULL,
+                               feedback_stream, check_cancel, NULL, pool));
+}
+
+
 /* This implements 'svn_opt_subcommand_t'. */
 static svn_error_t *
 subcommand_pack(apr_getopt_t *os, void *baton, apr_pool_t *pool)
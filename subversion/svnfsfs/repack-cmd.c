@@ -0,0 +1,66 @@
+/* repack-cmd.c -- implements the repack sub-command.
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "svn_pools.h"
+#include "private/svn_fs_fs_private.h"
+
+#include "svn_private_config.h"
+
+#include "svnfsfs.h"
+
+/* Re-encode the pack file containing REVISION in the repository at PATH.
+ * If REVISION is SVN_INVALID_REVNUM, process all pack files.
+ * Use POOL for allocations.
+ */
+static svn_error_t *
+repack(const char *path,
+       svn_revnum_t revision,
+       apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+
+  /* Check repository type and open it. */
+  SVN_ERR(open_fs(&fs, path, pool));
+
+  /* Rewrite the pack file(s). */
+  SVN_ERR(svn_fs_fs__repack(fs, revision, check_cancel, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* This implements `svn_opt_subcommand_t'. */
+svn_error_t *
+subcommand__repack(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  svnfsfs__opt_state *opt_state = baton;
+  svn_revnum_t revision = SVN_INVALID_REVNUM;
+
+  if (opt_state->start_revision.kind == svn_opt_revision_number)
+    revision = opt_state->start_revision.value.number;
+  else if (opt_state->start_revision.kind != svn_opt_revision_unspecified)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                            _("Revision must be given as a number"));
+
+  SVN_ERR(repack(opt_state->repository_path, revision, pool));
+
+  return SVN_NO_ERROR;
+}
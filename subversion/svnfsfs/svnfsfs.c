@@ -162,6 +162,17 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
    )},
    {'M'} },
 
+  {"repack", subcommand__repack, {0}, {N_(
+    "usage: svnfsfs repack REPOS_PATH [-r REV]\n"
+    "\n"), N_(
+    "Re-encode the delta representations in the pack file containing revision REV\n"
+    "using the compression selected by the 'pack-compression' option in fsfs.conf.\n"
+    "Without -r, process all pack files.  This is only available for FSFS format 9\n"
+    "repositories using logical addressing.  The repository should not be served\n"
+    "while running this command.\n"
+   )},
+   {'r', 'M'} },
+
   {"stats", subcommand__stats, {0}, {N_(
     "usage: svnfsfs stats REPOS_PATH\n"
     "\n"), N_(
@@ -52,6 +52,7 @@ svn_opt_subcommand_t
   subcommand__help,
   subcommand__dump_index,
   subcommand__load_index,
+  subcommand__repack,
   subcommand__stats;
 
 
@@ -28,6 +28,7 @@
 #include <apr_pools.h>
 #include <apr_time.h>
 #include <apr_file_io.h>
+#include <apr_strings.h>
 
 #define APR_WANT_STDIO
 #define APR_WANT_STRFUNC
@@ -83,6 +84,7 @@ static svn_opt_subcommand_t
   subcommand_log,
   subcommand_pget,
   subcommand_plist,
+  subcommand_serve,
   subcommand_tree,
   subcommand_uuid,
   subcommand_youngest;
@@ -327,6 +329,22 @@ static const svn_opt_subcommand_desc3_t cmd_table[] =
    {'r', 't', 'v', svnlook__revprop_opt, svnlook__xml_opt,
     svnlook__show_inherited_props} },
 
+  {"serve", subcommand_serve, {0}, {N_(
+      "usage: svnlook serve REPOS_PATH\n"
+      "\n"), N_(
+      "Answer a series of svnlook requests read from standard input, keeping\n"
+      "the repository open and its caches warm in between.  Hook scripts\n"
+      "running svnlook many times may use this as a coprocess instead.\n"
+      "\n"
+      "Each request is a single line holding an svnlook command line without\n"
+      "the program name and REPOS_PATH, e.g. 'changed -t TXN'.  Arguments\n"
+      "may be quoted.  For every request, a line with the exit code and the\n"
+      "number of bytes of output follows, separated by a space, followed by\n"
+      "exactly that many bytes of output.  Error messages are part of the\n"
+      "output.  The service terminates at the end of its input.\n"
+   )},
+   {'M'} },
+
   {"tree", subcommand_tree, {0}, {N_(
       "usage: svnlook tree REPOS_PATH [PATH_IN_REPOS]\n"
       "\n"), N_(
@@ -412,6 +430,9 @@ typedef struct svnlook_ctxt_t
 
 static svn_cancel_func_t check_cancel = NULL;
 
+/* While running 'svnlook serve', the repository shared by all requests. */
+static svn_repos_t *serve_repos = NULL;
+
 /* Version compatibility check */
 static svn_error_t *
 check_lib_versions(void)
@@ -2099,8 +2120,16 @@ get_ctxt_baton(svnlook_ctxt_t **baton_p,
 {
   svnlook_ctxt_t *baton = apr_pcalloc(pool, sizeof(*baton));
 
-  SVN_ERR(svn_repos_open3(&(baton->repos), opt_state->repos_path, NULL,
-                          pool, pool));
+  if (serve_repos)
+    {
+      baton->repos = serve_repos;
+    }
+  else
+    {
+      SVN_ERR(svn_repos_open3(&(baton->repos), opt_state->repos_path, NULL,
+                              pool, pool));
+    }
+
   baton->fs = svn_repos_fs(baton->repos);
   svn_fs_set_warning_func(baton->fs, warning_func, NULL);
   baton->show_ids = opt_state->show_ids;
@@ -2134,6 +2163,9 @@ get_ctxt_baton(svnlook_ctxt_t **baton_p,
 
 /*** Subcommands. ***/
 
+static svn_error_t *
+sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool);
+
 /* This implements `svn_opt_subcommand_t'. */
 static svn_error_t *
 subcommand_author(apr_getopt_t *os, void *baton, apr_pool_t *pool)
@@ -2407,6 +2439,151 @@ subcommand_plist(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Run the 'svnlook serve' request given by the command line LINE against
+ * the repository at REPOS_PATH.  The subcommand's output goes to standard
+ * output, which is expected to be redirected to a capture file.  Set
+ * *EXIT_CODE like main() would.  Use POOL for temporary allocations. */
+static svn_error_t *
+serve_request(int *exit_code,
+              const char *line,
+              const char *repos_path,
+              apr_pool_t *pool)
+{
+  char **tokens;
+  apr_array_header_t *args = apr_array_make(pool, 8, sizeof(const char *));
+  const char *cmd;
+  int i;
+
+  if (apr_tokenize_to_argv(line, &tokens, pool) || tokens[0] == NULL)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                            _("Subcommand argument required"));
+
+  SVN_ERR(svn_utf_cstring_to_utf8(&cmd, tokens[0], pool));
+  if (strcmp(cmd, "serve") == 0)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                            _("Requests must not start another service"));
+
+  /* Build the command line as if the user had typed "svnlook CMD REPOS
+     ...", leaving out the repository path for 'help'. */
+  APR_ARRAY_PUSH(args, const char *) = "svnlook";
+  APR_ARRAY_PUSH(args, const char *) = tokens[0];
+  if (svn_opt_get_canonical_subcommand3(cmd_table, cmd)
+      != svn_opt_get_canonical_subcommand3(cmd_table, "help"))
+    APR_ARRAY_PUSH(args, const char *) = repos_path;
+  for (i = 1; tokens[i]; ++i)
+    APR_ARRAY_PUSH(args, const char *) = tokens[i];
+
+  return svn_error_trace(sub_main(exit_code, args->nelts,
+                                  (const char **)args->elts, pool));
+}
+
+/* This implements `svn_opt_subcommand_t'. */
+static svn_error_t *
+subcommand_serve(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  struct svnlook_opt_state *opt_state = baton;
+  const char *native_repos_path;
+  apr_file_t *stdout_file;
+  apr_file_t *response_file;
+  apr_file_t *capture_file;
+  const char *capture_path;
+  svn_stream_t *in;
+  svn_stream_t *out;
+  apr_pool_t *iterpool;
+  apr_status_t apr_err;
+
+  SVN_ERR(check_number_of_args(opt_state, 0));
+
+  /* Requests could only ever reach us through nested sub_main() calls. */
+  if (serve_repos)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                            _("Requests must not start another service"));
+
+  /* Open the repository once.  Its FS caches remain warm for all
+     requests. */
+  SVN_ERR(svn_repos_open3(&serve_repos, opt_state->repos_path, NULL,
+                          pool, pool));
+  SVN_ERR(svn_utf_cstring_from_utf8(&native_repos_path,
+                                    svn_dirent_local_style(
+                                      opt_state->repos_path, pool),
+                                    pool));
+
+  /* The subcommands print to the standard output.  Point it to a capture
+     file, such that we can send the output with its size, and keep a
+     duplicate of the original handle for the responses. */
+  SVN_ERR(svn_io_open_unique_file3(NULL, &capture_path, NULL,
+                                   svn_io_file_del_on_pool_cleanup,
+                                   pool, pool));
+  SVN_ERR(svn_io_file_open(&capture_file, capture_path,
+                           APR_READ | APR_WRITE | APR_BINARY,
+                           APR_OS_DEFAULT, pool));
+
+  SVN_ERR(svn_cmdline_fflush(stdout));
+  apr_err = apr_file_open_stdout(&stdout_file, pool);
+  if (!apr_err)
+    apr_err = apr_file_dup(&response_file, stdout_file, pool);
+  if (!apr_err)
+    apr_err = apr_file_dup2(stdout_file, capture_file, pool);
+  if (apr_err)
+    return svn_error_wrap_apr(apr_err, _("Can't redirect standard output"));
+
+  SVN_ERR(svn_stream_for_stdin2(&in, FALSE, pool));
+  out = svn_stream_from_aprfile2(response_file, TRUE, pool);
+
+  iterpool = svn_pool_create(pool);
+  while (TRUE)
+    {
+      svn_stringbuf_t *line;
+      svn_boolean_t eof;
+      svn_error_t *err;
+      svn_filesize_t size;
+      apr_off_t offset = 0;
+      int exit_code = EXIT_SUCCESS;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_stream_readline(in, &line, "\n", &eof, iterpool));
+      if (eof && line->len == 0)
+        break;
+
+      svn_stringbuf_strip_whitespace(line);
+      if (line->len == 0)
+        continue;
+
+      SVN_ERR(svn_io_file_trunc(capture_file, 0, iterpool));
+      SVN_ERR(svn_io_file_seek(capture_file, APR_SET, &offset, iterpool));
+
+      err = serve_request(&exit_code, line->data, native_repos_path,
+                          iterpool);
+      if (err)
+        {
+          if (svn_error_find_cause(err, SVN_ERR_CANCELLED))
+            return svn_error_trace(err);
+
+          svn_handle_error2(err, stdout, FALSE, "svnlook: ");
+          svn_error_clear(err);
+          exit_code = EXIT_FAILURE;
+        }
+
+      /* Send the response. */
+      SVN_ERR(svn_cmdline_fflush(stdout));
+      SVN_ERR(svn_io_file_size_get(&size, capture_file, iterpool));
+      SVN_ERR(svn_io_file_seek(capture_file, APR_SET, &offset, iterpool));
+
+      SVN_ERR(svn_stream_printf(out, iterpool,
+                                "%d %" SVN_FILESIZE_T_FMT "\n",
+                                exit_code, size));
+      SVN_ERR(svn_stream_copy3(svn_stream_from_aprfile2(capture_file, TRUE,
+                                                        iterpool),
+                               svn_stream_disown(out, iterpool),
+                               NULL, NULL, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* This implements `svn_opt_subcommand_t'. */
 static svn_error_t *
 subcommand_tree(apr_getopt_t *os, void *baton, apr_pool_t *pool)
@@ -0,0 +1,590 @@
+/*
+ * metrics.c : Prometheus metrics endpoint for svnserve
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+
+#define APR_WANT_STRFUNC
+#include <apr_want.h>
+#include <apr_network_io.h>
+#include <apr_strings.h>
+#include <apr_thread_proc.h>
+
+#include "svn_error.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
+
+#include "private/svn_atomic.h"
+#include "private/svn_cache.h"
+#include "private/svn_mutex.h"
+#include "private/svn_ra_svn_private.h"
+#include "private/svn_sorts_private.h"
+#include "private/svn_trace.h"
+
+#include "svn_private_config.h"
+#include "logger.h"
+#include "metrics.h"
+
+/* Upper bounds of the command latency histogram buckets in microseconds
+ * and the same as they appear in the output.  Longer commands only show
+ * up in the implicit "+Inf" bucket. */
+static const apr_interval_time_t bucket_bounds[] =
+  { 1000, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000 };
+static const char *bucket_labels[] =
+  { "0.001", "0.005", "0.01", "0.025", "0.05", "0.1", "0.25", "0.5",
+    "1", "2.5", "5", "10" };
+
+#define BUCKET_COUNT (sizeof(bucket_bounds) / sizeof(bucket_bounds[0]))
+
+/* Maximum size of the HTTP request header we care to read. */
+#define MAX_REQUEST_SIZE 4096
+
+/* Number of pending metrics requests the OS shall queue for us. */
+#define ACCEPT_BACKLOG 16
+
+/* Aggregated data for a single ra_svn command. */
+typedef struct command_stats_t
+{
+  /* Number of commands per latency bucket (not cumulative). */
+  apr_uint64_t buckets[BUCKET_COUNT];
+
+  /* Total number of commands, their accumulated duration and the number
+     of them that failed. */
+  apr_uint64_t count;
+  apr_interval_time_t duration;
+  apr_uint64_t failures;
+
+  /* Data received and sent by these commands. */
+  apr_uint64_t bytes_in;
+  apr_uint64_t bytes_out;
+} command_stats_t;
+
+struct metrics_t
+{
+  /* Maps command names to command_stats_t *. */
+  apr_hash_t *commands;
+
+  /* Number of sessions ever started. */
+  apr_uint64_t sessions;
+
+  /* Number of sessions currently open. */
+  volatile svn_atomic_t active_sessions;
+
+  /* mutex used to serialize access to this structure */
+  svn_mutex__t *mutex;
+
+  /* where to report errors in the listener; possibly NULL */
+  logger_t *logger;
+
+#if APR_HAS_THREADS
+  /* thread pool serving the connections; possibly NULL */
+  apr_thread_pool_t *threads;
+
+  /* socket accepting requests for the metrics */
+  apr_socket_t *sock;
+#endif
+
+  /* pool for all allocations above */
+  apr_pool_t *pool;
+};
+
+svn_error_t *
+metrics__create(metrics_t **metrics,
+                logger_t *logger,
+                apr_pool_t *pool)
+{
+  metrics_t *result = apr_pcalloc(pool, sizeof(*result));
+
+  result->commands = apr_hash_make(pool);
+  result->logger = logger;
+  result->pool = pool;
+  SVN_ERR(svn_mutex__init(&result->mutex, TRUE, pool));
+
+  *metrics = result;
+
+  return SVN_NO_ERROR;
+}
+
+/* Add a command CMDNAME with the given DURATION, I/O volume BYTES_IN and
+ * BYTES_OUT and FAILED status to METRICS.  To be called with METRICS->MUTEX
+ * being held. */
+static void
+add_command(metrics_t *metrics,
+            const char *cmdname,
+            apr_interval_time_t duration,
+            apr_uint64_t bytes_in,
+            apr_uint64_t bytes_out,
+            svn_boolean_t failed)
+{
+  apr_size_t i;
+  command_stats_t *stats = svn_hash_gets(metrics->commands, cmdname);
+
+  /* Only commands from the server's command table get reported, so the
+     number of entries remains small. */
+  if (stats == NULL)
+    {
+      stats = apr_pcalloc(metrics->pool, sizeof(*stats));
+      svn_hash_sets(metrics->commands, apr_pstrdup(metrics->pool, cmdname),
+                    stats);
+    }
+
+  for (i = 0; i < BUCKET_COUNT; ++i)
+    if (duration <= bucket_bounds[i])
+      {
+        stats->buckets[i]++;
+        break;
+      }
+
+  stats->count++;
+  stats->duration += duration;
+  stats->bytes_in += bytes_in;
+  stats->bytes_out += bytes_out;
+  if (failed)
+    stats->failures++;
+}
+
+/* Implements svn_ra_svn__command_observer_t for a metrics_t * BATON. */
+static void
+observe_command(void *baton,
+                const char *cmdname,
+                apr_interval_time_t duration,
+                apr_uint64_t bytes_in,
+                apr_uint64_t bytes_out,
+                svn_boolean_t failed)
+{
+  metrics_t *metrics = baton;
+
+  svn_error_clear(svn_mutex__lock(metrics->mutex));
+  add_command(metrics, cmdname, duration, bytes_in, bytes_out, failed);
+  svn_error_clear(svn_mutex__unlock(metrics->mutex, SVN_NO_ERROR));
+}
+
+/* Pool cleanup function ending the session counted in the metrics_t *
+ * DATA. */
+static apr_status_t
+end_session(void *data)
+{
+  metrics_t *metrics = data;
+  svn_atomic_dec(&metrics->active_sessions);
+
+  return APR_SUCCESS;
+}
+
+void
+metrics__observe_connection(metrics_t *metrics,
+                            svn_ra_svn_conn_t *conn,
+                            apr_pool_t *pool)
+{
+  svn_ra_svn__set_command_observer(conn, observe_command, metrics);
+
+  svn_error_clear(svn_mutex__lock(metrics->mutex));
+  metrics->sessions++;
+  svn_error_clear(svn_mutex__unlock(metrics->mutex, SVN_NO_ERROR));
+
+  svn_atomic_inc(&metrics->active_sessions);
+  apr_pool_cleanup_register(pool, metrics, end_session,
+                            apr_pool_cleanup_null);
+}
+
+/* Write the HELP and TYPE lines for metric NAME of TYPE with the HELP
+ * text to STREAM. */
+static svn_error_t *
+write_header(svn_stream_t *stream,
+             const char *name,
+             const char *type,
+             const char *help,
+             apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(svn_stream_printf(stream, scratch_pool,
+                                           "# HELP %s %s\n# TYPE %s %s\n",
+                                           name, help, name, type));
+}
+
+/* Write the per-command data of METRICS to STREAM.  To be called with
+ * METRICS->MUTEX being held. */
+static svn_error_t *
+write_commands(metrics_t *metrics,
+               svn_stream_t *stream,
+               apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *commands
+    = svn_sort__hash(metrics->commands, svn_sort_compare_items_lexically,
+                     scratch_pool);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  SVN_ERR(write_header(stream, "svnserve_command_duration_seconds",
+                       "histogram", "Time spent handling ra_svn commands.",
+                       scratch_pool));
+  for (i = 0; i < commands->nelts; ++i)
+    {
+      svn_sort__item_t *item = &APR_ARRAY_IDX(commands, i, svn_sort__item_t);
+      const command_stats_t *stats = item->value;
+      apr_uint64_t cumulative = 0;
+      apr_size_t k;
+
+      svn_pool_clear(iterpool);
+      for (k = 0; k < BUCKET_COUNT; ++k)
+        {
+          cumulative += stats->buckets[k];
+          SVN_ERR(svn_stream_printf(stream, iterpool,
+                                    "svnserve_command_duration_seconds_bucket"
+                                    "{command=\"%s\",le=\"%s\"} %"
+                                    APR_UINT64_T_FMT "\n",
+                                    (const char *)item->key,
+                                    bucket_labels[k], cumulative));
+        }
+
+      SVN_ERR(svn_stream_printf(stream, iterpool,
+                                "svnserve_command_duration_seconds_bucket"
+                                "{command=\"%s\",le=\"+Inf\"} %"
+                                APR_UINT64_T_FMT "\n"
+                                "svnserve_command_duration_seconds_sum"
+                                "{command=\"%s\"} %.6f\n"
+                                "svnserve_command_duration_seconds_count"
+                                "{command=\"%s\"} %" APR_UINT64_T_FMT "\n",
+                                (const char *)item->key, stats->count,
+                                (const char *)item->key,
+                                (double)stats->duration / APR_USEC_PER_SEC,
+                                (const char *)item->key, stats->count));
+    }
+
+  SVN_ERR(write_header(stream, "svnserve_command_failures_total", "counter",
+                       "Number of ra_svn commands that failed.",
+                       scratch_pool));
+  for (i = 0; i < commands->nelts; ++i)
+    {
+      svn_sort__item_t *item = &APR_ARRAY_IDX(commands, i, svn_sort__item_t);
+      const command_stats_t *stats = item->value;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_stream_printf(stream, iterpool,
+                                "svnserve_command_failures_total"
+                                "{command=\"%s\"} %" APR_UINT64_T_FMT "\n",
+                                (const char *)item->key, stats->failures));
+    }
+
+  SVN_ERR(write_header(stream, "svnserve_received_bytes_total", "counter",
+                       "Data received from clients per ra_svn command.",
+                       scratch_pool));
+  for (i = 0; i < commands->nelts; ++i)
+    {
+      svn_sort__item_t *item = &APR_ARRAY_IDX(commands, i, svn_sort__item_t);
+      const command_stats_t *stats = item->value;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_stream_printf(stream, iterpool,
+                                "svnserve_received_bytes_total"
+                                "{command=\"%s\"} %" APR_UINT64_T_FMT "\n",
+                                (const char *)item->key, stats->bytes_in));
+    }
+
+  SVN_ERR(write_header(stream, "svnserve_sent_bytes_total", "counter",
+                       "Data sent to clients per ra_svn command.",
+                       scratch_pool));
+  for (i = 0; i < commands->nelts; ++i)
+    {
+      svn_sort__item_t *item = &APR_ARRAY_IDX(commands, i, svn_sort__item_t);
+      const command_stats_t *stats = item->value;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_stream_printf(stream, iterpool,
+                                "svnserve_sent_bytes_total"
+                                "{command=\"%s\"} %" APR_UINT64_T_FMT "\n",
+                                (const char *)item->key, stats->bytes_out));
+    }
+
+  SVN_ERR(write_header(stream, "svnserve_sessions_total", "counter",
+                       "Number of client sessions started.", scratch_pool));
+  SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                            "svnserve_sessions_total %" APR_UINT64_T_FMT "\n",
+                            metrics->sessions));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the statistics of the global membuffer cache to STREAM. */
+static svn_error_t *
+write_cache_info(svn_stream_t *stream,
+                 apr_pool_t *scratch_pool)
+{
+  svn_cache__info_t *info;
+
+  /* The cache may have been disabled, i.e. set to 0 bytes. */
+  if (svn_cache__get_global_membuffer_cache() == NULL)
+    return SVN_NO_ERROR;
+
+  info = svn_cache__membuffer_get_global_info(scratch_pool);
+
+  SVN_ERR(write_header(stream, "svnserve_cache_gets_total", "counter",
+                       "Lookups in the global membuffer cache.",
+                       scratch_pool));
+  SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                            "svnserve_cache_gets_total %" APR_UINT64_T_FMT
+                            "\n", info->gets));
+  SVN_ERR(write_header(stream, "svnserve_cache_hits_total", "counter",
+                       "Successful lookups in the global membuffer cache.",
+                       scratch_pool));
+  SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                            "svnserve_cache_hits_total %" APR_UINT64_T_FMT
+                            "\n", info->hits));
+  SVN_ERR(write_header(stream, "svnserve_cache_sets_total", "counter",
+                       "Insertions into the global membuffer cache.",
+                       scratch_pool));
+  SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                            "svnserve_cache_sets_total %" APR_UINT64_T_FMT
+                            "\n", info->sets));
+  SVN_ERR(write_header(stream, "svnserve_cache_used_bytes", "gauge",
+                       "Data stored in the global membuffer cache.",
+                       scratch_pool));
+  SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                            "svnserve_cache_used_bytes %" APR_UINT64_T_FMT
+                            "\n", info->used_size));
+  SVN_ERR(write_header(stream, "svnserve_cache_size_bytes", "gauge",
+                       "Memory allocated to the global membuffer cache.",
+                       scratch_pool));
+  SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                            "svnserve_cache_size_bytes %" APR_UINT64_T_FMT
+                            "\n", info->total_size));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+metrics__write(metrics_t *metrics,
+               svn_stream_t *stream,
+               apr_pool_t *scratch_pool)
+{
+  SVN_MUTEX__WITH_LOCK(metrics->mutex,
+                       write_commands(metrics, stream, scratch_pool));
+
+  SVN_ERR(write_header(stream, "svnserve_sessions_active", "gauge",
+                       "Number of client sessions currently open.",
+                       scratch_pool));
+  SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                            "svnserve_sessions_active %d\n",
+                            (int)svn_atomic_read(&metrics->active_sessions)));
+
+#if APR_HAS_THREADS
+  if (metrics->threads)
+    {
+      SVN_ERR(write_header(stream, "svnserve_threads", "gauge",
+                           "Number of worker threads.", scratch_pool));
+      SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                                "svnserve_threads %" APR_SIZE_T_FMT "\n",
+                                apr_thread_pool_threads_count(
+                                  metrics->threads)));
+      SVN_ERR(write_header(stream, "svnserve_threads_busy", "gauge",
+                           "Number of worker threads serving a connection.",
+                           scratch_pool));
+      SVN_ERR(svn_stream_printf(stream, scratch_pool,
+                                "svnserve_threads_busy %" APR_SIZE_T_FMT "\n",
+                                apr_thread_pool_busy_count(
+                                  metrics->threads)));
+    }
+#endif
+
+  SVN_ERR(write_cache_info(stream, scratch_pool));
+
+  /* Probe totals, e.g. the time spent waiting for the FS write lock. */
+  if (svn_trace__enabled())
+    SVN_ERR(svn_trace__write(stream, svn_trace__format_prometheus,
+                             scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Send the LEN bytes at DATA to SOCK. */
+static svn_error_t *
+send_all(apr_socket_t *sock,
+         const char *data,
+         apr_size_t len)
+{
+  while (len > 0)
+    {
+      apr_size_t sent = len;
+      apr_status_t status = apr_socket_send(sock, data, &sent);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't write to metrics client"));
+
+      data += sent;
+      len -= sent;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the HTTP request from SOCK and answer it with the contents of
+ * METRICS.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+handle_request(metrics_t *metrics,
+               apr_socket_t *sock,
+               apr_pool_t *scratch_pool)
+{
+  char request[MAX_REQUEST_SIZE];
+  apr_size_t len = 0;
+  svn_stringbuf_t *body;
+  const char *header;
+
+  /* We only need the request line.  Anything beyond it gets ignored. */
+  while (len < sizeof(request) - 1 && !memchr(request, '\n', len))
+    {
+      apr_size_t count = sizeof(request) - 1 - len;
+      apr_status_t status = apr_socket_recv(sock, request + len, &count);
+      if (status && !APR_STATUS_IS_EOF(status))
+        return svn_error_wrap_apr(status,
+                                  _("Can't read from metrics client"));
+
+      len += count;
+      if (status || count == 0)
+        break;
+    }
+  request[len] = '\0';
+
+  if (   strncmp(request, "GET /metrics ", 13) != 0
+      && strncmp(request, "GET /metrics?", 13) != 0)
+    {
+      static const char not_found[]
+        = "HTTP/1.0 404 Not Found\r\n"
+          "Content-Type: text/plain\r\n"
+          "\r\n"
+          "Not found.  Try GET /metrics.\n";
+      return svn_error_trace(send_all(sock, not_found,
+                                      sizeof(not_found) - 1));
+    }
+
+  body = svn_stringbuf_create_empty(scratch_pool);
+  SVN_ERR(metrics__write(metrics,
+                         svn_stream_from_stringbuf(body, scratch_pool),
+                         scratch_pool));
+
+  header = apr_psprintf(scratch_pool,
+                        "HTTP/1.0 200 OK\r\n"
+                        "Content-Type: text/plain; version=0.0.4\r\n"
+                        "Content-Length: %" APR_SIZE_T_FMT "\r\n"
+                        "\r\n", body->len);
+  SVN_ERR(send_all(sock, header, strlen(header)));
+
+  return svn_error_trace(send_all(sock, body->data, body->len));
+}
+
+/* Thread function answering HTTP requests for the metrics_t * in DATA,
+ * one at a time. */
+static void * APR_THREAD_FUNC
+listener_thread(apr_thread_t *tid, void *data)
+{
+  metrics_t *metrics = data;
+  apr_pool_t *iterpool = svn_pool_create(NULL);
+
+  while (1)
+    {
+      apr_socket_t *client;
+      apr_status_t status;
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+      status = apr_socket_accept(&client, metrics->sock, iterpool);
+      if (   APR_STATUS_IS_EINTR(status)
+          || APR_STATUS_IS_ECONNABORTED(status)
+          || APR_STATUS_IS_ECONNRESET(status))
+        continue;
+
+      if (status)
+        {
+          err = svn_error_wrap_apr(status,
+                                   _("Can't accept metrics connection"));
+          logger__log_error(metrics->logger, err, NULL, NULL);
+          svn_error_clear(err);
+          break;
+        }
+
+      /* Don't let a stalled client block the endpoint forever. */
+      apr_socket_timeout_set(client, apr_time_from_sec(10));
+
+      err = handle_request(metrics, client, iterpool);
+      logger__log_error(metrics->logger, err, NULL, NULL);
+      svn_error_clear(err);
+
+      apr_socket_close(client);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return NULL;
+}
+
+svn_error_t *
+metrics__listen(metrics_t *metrics,
+                const char *host,
+                apr_uint16_t port,
+                apr_thread_pool_t *threads,
+                apr_pool_t *pool)
+{
+  apr_sockaddr_t *sa;
+  apr_threadattr_t *tattr;
+  apr_thread_t *tid;
+  apr_status_t status;
+
+  status = apr_sockaddr_info_get(&sa, host, APR_UNSPEC, port, 0, pool);
+  if (status)
+    return svn_error_wrap_apr(status,
+                              _("Can't get address info for metrics"));
+
+  status = apr_socket_create(&metrics->sock, sa->family, SOCK_STREAM,
+                             APR_PROTO_TCP, pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create metrics socket"));
+
+  status = apr_socket_opt_set(metrics->sock, APR_SO_REUSEADDR, 1);
+  if (status)
+    return svn_error_wrap_apr(status,
+                              _("Can't set options on metrics socket"));
+
+  status = apr_socket_bind(metrics->sock, sa);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't bind metrics socket"));
+
+  status = apr_socket_listen(metrics->sock, ACCEPT_BACKLOG);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't listen on metrics socket"));
+
+  metrics->threads = threads;
+
+  status = apr_threadattr_create(&tattr, pool);
+  if (!status)
+    status = apr_threadattr_detach_set(tattr, 1);
+  if (!status)
+    status = apr_thread_create(&tid, tattr, listener_thread, metrics, pool);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't create metrics thread"));
+
+  return SVN_NO_ERROR;
+}
+
+#endif
@@ -0,0 +1,95 @@
+/*
+ * metrics.h : Declarations for the svnserve metrics endpoint
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#if APR_HAS_THREADS
+#include <apr_thread_pool.h>
+#endif
+
+#include "svn_io.h"
+#include "svn_ra_svn.h"
+
+#include "server.h"
+
+
+
+/* Opaque svnserve metrics collector.  It aggregates per-command latency
+ * histograms and I/O volumes as well as session counts for the whole
+ * process.  Access is serialized among threads within the same process.
+ */
+typedef struct metrics_t metrics_t;
+
+/* In POOL, create an empty metrics collector and return it in *METRICS.
+ * Errors in the metrics endpoint will be reported to LOGGER, which may
+ * be NULL.
+ */
+svn_error_t *
+metrics__create(metrics_t **metrics,
+                struct logger_t *logger,
+                apr_pool_t *pool);
+
+/* Make CONN report all commands it handles to METRICS and count it as
+ * an active session until POOL gets cleared or destroyed.
+ */
+void
+metrics__observe_connection(metrics_t *metrics,
+                            svn_ra_svn_conn_t *conn,
+                            apr_pool_t *pool);
+
+/* Write the current contents of METRICS in Prometheus text format to
+ * STREAM.  This includes the global membuffer cache statistics and,
+ * if tracing is enabled, the svn_trace probe totals.  Use SCRATCH_POOL
+ * for temporary allocations.
+ */
+svn_error_t *
+metrics__write(metrics_t *metrics,
+               svn_stream_t *stream,
+               apr_pool_t *scratch_pool);
+
+#if APR_HAS_THREADS
+
+/* Start a background thread serving the contents of METRICS via HTTP at
+ * "/metrics" on HOST and PORT.  If THREADS is not NULL, include its
+ * worker thread counts in the output.  Allocate the listener in POOL,
+ * which must outlive the thread, i.e. the process.
+ */
+svn_error_t *
+metrics__listen(metrics_t *metrics,
+                const char *host,
+                apr_uint16_t port,
+                apr_thread_pool_t *threads,
+                apr_pool_t *pool);
+
+#endif
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* METRICS_H */
@@ -50,7 +50,9 @@
 #include "svn_props.h"
 #include "svn_mergeinfo.h"
 #include "svn_user.h"
+#include "svn_sorts.h"
 
+#include "private/svn_fs_private.h"
 #include "private/svn_log.h"
 #include "private/svn_mergeinfo_private.h"
 #include "private/svn_ra_svn_private.h"
@@ -62,6 +64,7 @@
 
 #include "server.h"
 #include "logger.h"
+#include "metrics.h"
 
 typedef struct commit_callback_baton_t {
   apr_pool_t *pool;
@@ -1551,6 +1554,60 @@ commit(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+/* Number of bytes of a fulltext file to send per protocol string. */
+#define FULLTEXT_CHUNK_SIZE 0x100000
+
+/* Verify that the FULLTEXT file of PATH in ROOT has the size that the
+ * filesystem records for PATH and return that in *SIZE.  This catches
+ * truncated or otherwise damaged fulltext files before we announce their
+ * contents to the client.  Use POOL for temporary allocations. */
+static svn_error_t *
+check_fulltext_size(apr_off_t *size,
+                    apr_file_t *fulltext,
+                    svn_fs_root_t *root,
+                    const char *path,
+                    apr_pool_t *pool)
+{
+  svn_filesize_t expected;
+
+  SVN_ERR(svn_fs_file_length(&expected, root, path, pool));
+  SVN_ERR(svn_io_file_size_get(size, fulltext, pool));
+  if (*size != expected)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Fulltext file of '%s' has %s bytes but "
+                               "should have %s"),
+                             path,
+                             apr_off_t_toa(pool, *size),
+                             apr_psprintf(pool, "%" SVN_FILESIZE_T_FMT,
+                                          expected));
+
+  return SVN_NO_ERROR;
+}
+
+/* Send the first SIZE bytes of FULLTEXT as a sequence of strings over
+ * CONN.  Use POOL for temporary allocations. */
+static svn_error_t *
+send_fulltext_file(svn_ra_svn_conn_t *conn,
+                   apr_file_t *fulltext,
+                   apr_off_t size,
+                   apr_pool_t *pool)
+{
+  apr_off_t offset;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  for (offset = 0; offset < size; offset += FULLTEXT_CHUNK_SIZE)
+    {
+      apr_size_t len = (apr_size_t)MIN(size - offset, FULLTEXT_CHUNK_SIZE);
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_ra_svn__write_file_string(conn, iterpool, fulltext,
+                                            offset, len));
+    }
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_io_file_close(fulltext, pool));
+}
+
 static svn_error_t *
 get_file(svn_ra_svn_conn_t *conn,
          apr_pool_t *pool,
@@ -1562,6 +1619,8 @@ get_file(svn_ra_svn_conn_t *conn,
   svn_revnum_t rev;
   svn_fs_root_t *root;
   svn_stream_t *contents;
+  apr_file_t *fulltext = NULL;
+  apr_off_t fulltext_size = 0;
   apr_hash_t *props = NULL;
   apr_array_header_t *inherited_props;
   svn_string_t write_str;
@@ -1614,7 +1673,17 @@ get_file(svn_ra_svn_conn_t *conn,
                           &ab, root, full_path,
                           pool));
   if (want_contents)
-    SVN_CMD_ERR(svn_fs_file_contents(&contents, root, full_path, pool));
+    {
+      /* Large files may be available as plain files that we can send
+         without reading them through the FS layer. */
+      SVN_CMD_ERR(svn_fs__open_fulltext_file(&fulltext, root, full_path,
+                                             pool));
+      if (fulltext)
+        SVN_CMD_ERR(check_fulltext_size(&fulltext_size, fulltext, root,
+                                        full_path, pool));
+      else
+        SVN_CMD_ERR(svn_fs_file_contents(&contents, root, full_path, pool));
+    }
 
   /* Send successful command response with revision and props. */
   SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "w((?c)r(!", "success",
@@ -1644,7 +1713,13 @@ get_file(svn_ra_svn_conn_t *conn,
   SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "!))"));
 
   /* Now send the file's contents. */
-  if (want_contents)
+  if (fulltext)
+    {
+      SVN_ERR(send_fulltext_file(conn, fulltext, fulltext_size, pool));
+      SVN_ERR(svn_ra_svn__write_cstring(conn, pool, ""));
+      SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, ""));
+    }
+  else if (want_contents)
     {
       err = SVN_NO_ERROR;
       while (1)
@@ -3439,17 +3514,55 @@ replay(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+/* Baton for replay_range_receiver(). */
+typedef struct replay_range_baton_t
+{
+  svn_ra_svn_conn_t *conn;
+  server_baton_t *server;
+  svn_revnum_t low_water_mark;
+  svn_boolean_t send_deltas;
+
+  /* Set while sending data for a revision.  Errors raised during that
+     time are not command errors. */
+  svn_boolean_t sending;
+} replay_range_baton_t;
+
+/* Implements svn_fs_revision_proplist_receiver_t.  Send the revprops
+   PROPS of REVISION followed by the replay of REVISION. */
+static svn_error_t *
+replay_range_receiver(void *baton,
+                      svn_revnum_t revision,
+                      apr_hash_t *props,
+                      apr_pool_t *scratch_pool)
+{
+  replay_range_baton_t *rb = baton;
+
+  rb->sending = TRUE;
+  SVN_ERR(svn_ra_svn__write_tuple(rb->conn, scratch_pool, "w(!",
+                                  "revprops"));
+  SVN_ERR(svn_ra_svn__write_proplist(rb->conn, scratch_pool, props));
+  SVN_ERR(svn_ra_svn__write_tuple(rb->conn, scratch_pool, "!)"));
+
+  SVN_ERR(replay_one_revision(rb->conn, rb->server, revision,
+                              rb->low_water_mark, rb->send_deltas,
+                              scratch_pool));
+  rb->sending = FALSE;
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 replay_range(svn_ra_svn_conn_t *conn,
              apr_pool_t *pool,
              svn_ra_svn__list_t *params,
              void *baton)
 {
-  svn_revnum_t start_rev, end_rev, rev, low_water_mark;
+  svn_revnum_t start_rev, end_rev, low_water_mark;
   svn_boolean_t send_deltas;
   server_baton_t *b = baton;
-  apr_pool_t *iterpool;
   authz_baton_t ab;
+  replay_range_baton_t rb;
+  svn_error_t *err;
 
   ab.server = b;
   ab.conn = conn;
@@ -3460,27 +3573,25 @@ replay_range(svn_ra_svn_conn_t *conn,
 
   SVN_ERR(trivial_auth_request(conn, pool, b));
 
-  iterpool = svn_pool_create(pool);
-  for (rev = start_rev; rev <= end_rev; rev++)
+  rb.conn = conn;
+  rb.server = b;
+  rb.low_water_mark = low_water_mark;
+  rb.send_deltas = send_deltas;
+  rb.sending = FALSE;
+
+  /* Fetch the revprops of the whole range in one go.  Only errors
+     retrieving them are command errors. */
+  if (start_rev <= end_rev)
     {
-      apr_hash_t *props;
-
-      svn_pool_clear(iterpool);
-
-      SVN_CMD_ERR(svn_repos_fs_revision_proplist(&props,
-                                                 b->repository->repos, rev,
-                                                 authz_check_access_cb_func(b),
-                                                 &ab,
-                                                 iterpool));
-      SVN_ERR(svn_ra_svn__write_tuple(conn, iterpool, "w(!", "revprops"));
-      SVN_ERR(svn_ra_svn__write_proplist(conn, iterpool, props));
-      SVN_ERR(svn_ra_svn__write_tuple(conn, iterpool, "!)"));
-
-      SVN_ERR(replay_one_revision(conn, b, rev, low_water_mark,
-                                  send_deltas, iterpool));
-
+      err = svn_repos_fs_revision_proplists(b->repository->repos,
+                                            start_rev, end_rev,
+                                            authz_check_access_cb_func(b),
+                                            &ab, replay_range_receiver, &rb,
+                                            pool);
+      if (!rb.sending)
+        SVN_CMD_ERR(err);
+      SVN_ERR(err);
     }
-  svn_pool_destroy(iterpool);
 
   SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, ""));
 
@@ -4355,6 +4466,14 @@ serve_interruptable(svn_boolean_t *terminate_p,
                                   connection->params->max_request_size,
                                   connection->params->max_response_size,
                                   connection->pool);
+      if (connection->read_timeout)
+        svn_ra_svn__set_read_timeout(connection->conn,
+                                     connection->read_timeout);
+
+      /* Report this session's commands to the metrics endpoint. */
+      if (connection->params->metrics)
+        metrics__observe_connection(connection->params->metrics,
+                                    connection->conn, connection->pool);
 
       /* Construct server baton and open the repository for the first time. */
       err = construct_server_baton(&connection->baton, connection->conn,
@@ -124,6 +124,9 @@ typedef struct serve_params_t {
   /* logging data structure; possibly NULL. */
   struct logger_t *logger;
 
+  /* per-command statistics for the metrics endpoint; possibly NULL. */
+  struct metrics_t *metrics;
+
   /* all configurations should be opened through this factory */
   svn_repos__config_pool_t *config_pool;
 
@@ -181,6 +184,10 @@ typedef struct connection_t
   /* memory pool for objects with connection lifetime */
   apr_pool_t *pool;
 
+  /* If not 0, drop the connection once the client stalls for longer than
+     this while we are waiting for the rest of a request. */
+  apr_interval_time_t read_timeout;
+
   /* Number of threads using the pool.
      The pool passed to apr_thread_create can only be released when both
 
@@ -56,10 +56,14 @@
 #include "private/svn_cmdline_private.h"
 #include "private/svn_atomic.h"
 #include "private/svn_mutex.h"
+#include "private/svn_ra_svn_private.h"
+#include "private/svn_repos_private.h"
 #include "private/svn_subr_private.h"
+#include "private/svn_trace.h"
 
 #if APR_HAS_THREADS
 #    include <apr_thread_pool.h>
+#    include <apr_poll.h>
 #endif
 
 #include "winservice.h"
@@ -70,12 +74,15 @@
 
 #include "server.h"
 #include "logger.h"
+#include "metrics.h"
 
 /* The strategy for handling incoming connections.  Some of these may be
    unavailable due to platform limitations. */
 enum connection_handling_mode {
   connection_mode_fork,   /* Create a process per connection */
   connection_mode_thread, /* Create a thread per connection */
+  connection_mode_event,  /* Let threads serve commands from idle
+                             connections watched by an event loop */
   connection_mode_single  /* One connection at a time in this process */
 };
 
@@ -155,6 +162,18 @@ enum run_mode {
  */
 #define ACCEPT_BACKLOG 128
 
+/* Maximum number of ready connections that the event loop picks up in a
+ * single wake-up.  This does not limit the number of idle connections.
+ */
+#define EVENT_POLLSET_SIZE 1024
+
+/* In event mode, idle connections don't occupy a thread but a client that
+ * stops in the middle of a request would block its thread indefinitely.
+ * Drop connections that stall for longer than this.  Clients don't pause
+ * within a request for anything but local disk I/O, so be generous.
+ */
+#define EVENT_READ_TIMEOUT apr_time_from_sec(120)
+
 /* Default limit to the client request size in MBytes.  This effectively
  * limits the size of a paths and individual property values to about
  * this value.
@@ -222,6 +241,9 @@ void winservice_notify_stop(void)
 #define SVNSERVE_OPT_MAX_REQUEST     274
 #define SVNSERVE_OPT_MAX_RESPONSE    275
 #define SVNSERVE_OPT_CACHE_NODEPROPS 276
+#define SVNSERVE_OPT_EVENT           277
+#define SVNSERVE_OPT_METRICS_PORT    278
+#define SVNSERVE_OPT_METRICS_HOST    279
 
 /* Text macro because we can't use #ifdef sections inside a N_("...")
    macro expansion. */
@@ -229,7 +251,7 @@ void winservice_notify_stop(void)
 #define ONLY_AVAILABLE_WITH_THEADS \
         "\n" \
         "                             "\
-        "[used only with --threads]"
+        "[used only with --threads or --event]"
 #else
 #define ONLY_AVAILABLE_WITH_THEADS ""
 #endif
@@ -348,6 +370,18 @@ static const apr_getopt_option_t svnserve__options[] =
                                     "[mode: daemon]")},
 #endif
 #if APR_HAS_THREADS
+    {"event",            SVNSERVE_OPT_EVENT, 0,
+     N_("use a small pool of threads to serve commands and\n"
+        "                             "
+        "an event loop to watch idle connections, instead\n"
+        "                             "
+        "of a thread per connection.  Useful for many\n"
+        "                             "
+        "mostly idle clients.  Not available on all\n"
+        "                             "
+        "platforms.\n"
+        "                             "
+        "[mode: daemon]")},
     {"min-threads",      SVNSERVE_OPT_MIN_THREADS, 1,
      N_("Minimum number of server threads, even if idle.\n"
         "                             "
@@ -386,6 +420,22 @@ static const apr_getopt_option_t svnserve__options[] =
         "checking out at the wrong path level.\n"
         "                             "
         "Default is 0 (disabled).")},
+#if APR_HAS_THREADS
+    {"metrics-port",     SVNSERVE_OPT_METRICS_PORT, 1,
+     N_("serve Prometheus metrics via HTTP at /metrics on\n"
+        "                             "
+        "port ARG, e.g. per-command latency histograms,\n"
+        "                             "
+        "cache hit rates and FS write lock wait times.\n"
+        "                             "
+        "Requires --threads or --event.\n"
+        "                             "
+        "[mode: daemon, listen-once]")},
+    {"metrics-host",     SVNSERVE_OPT_METRICS_HOST, 1,
+     N_("hostname or IP address for --metrics-port\n"
+        "                             "
+        "Default is localhost.")},
+#endif
     {"foreground",        SVNSERVE_OPT_FOREGROUND, 0,
      N_("run in foreground (useful for debugging)\n"
         "                             "
@@ -656,6 +706,192 @@ static void * APR_THREAD_FUNC serve_thread(apr_thread_t *tid, void *data)
   return NULL;
 }
 
+
+/* Watches the sockets of all idle connections in event mode. */
+static apr_pollset_t *pollset;
+
+/* Load determination callback for serve_interruptable in event mode:
+   Always serve at most one command such that idle connections return
+   to the event loop instead of blocking a thread. */
+static svn_boolean_t
+is_event_driven(connection_t *connection)
+{
+  return TRUE;
+}
+
+/* Hand the idle CONNECTION over to the event loop.  Once a command
+   arrives, the event loop will schedule event_thread() for it. */
+static svn_error_t *
+watch_connection(connection_t *connection)
+{
+  apr_pollfd_t pfd = { 0 };
+  apr_status_t status;
+
+  pfd.p = connection->pool;
+  pfd.desc_type = APR_POLL_SOCKET;
+  pfd.reqevents = APR_POLLIN;
+  pfd.desc.s = connection->usock;
+  pfd.client_data = connection;
+
+  status = apr_pollset_add(pollset, &pfd);
+  return status
+       ? svn_error_wrap_apr(status, _("Can't watch client connection"))
+       : SVN_NO_ERROR;
+}
+
+/* Serve the next command of the connection given by DATA, performing the
+   handshake first for new connections.  Afterwards, put the connection
+   back into THREAD's task pool if further commands have already been
+   received or hand it back to the event loop otherwise. */
+static void * APR_THREAD_FUNC event_thread(apr_thread_t *tid, void *data)
+{
+  svn_boolean_t done;
+  svn_boolean_t has_command = FALSE;
+  connection_t *connection = data;
+  svn_error_t *err;
+
+  apr_pool_t *pool = svn_root_pools__acquire_pool(connection_pools);
+
+  /* process the actual request and check for the next one */
+  err = serve_interruptable(&done, connection, is_event_driven, pool);
+  if (!err && !done)
+    err = svn_ra_svn__has_command(&has_command, &done, connection->conn,
+                                  pool);
+
+  /* Without further data, wait for it in the event loop. */
+  if (!err && !done && !has_command)
+    err = watch_connection(connection);
+
+  if (err)
+    {
+      logger__log_error(connection->params->logger, err, NULL,
+                        get_client_info(connection->conn, connection->params,
+                                        pool));
+      svn_error_clear(err);
+      done = TRUE;
+    }
+  svn_root_pools__release_pool(pool, connection_pools);
+
+  /* Close or re-schedule connection. */
+  if (done)
+    close_connection(connection);
+  else if (has_command)
+    apr_thread_pool_push(threads, event_thread, connection, 0, NULL);
+
+  return NULL;
+}
+
+/* Accept connections from SOCK and serve them with PARAMS in event mode
+   until an error occurs.  The calling thread runs the event loop that
+   watches SOCK and all idle connections, while THREADS process incoming
+   commands.  Use POOL for allocations. */
+static svn_error_t *
+serve_events(apr_socket_t *sock,
+             serve_params_t *params,
+             apr_pool_t *pool)
+{
+  apr_pollfd_t pfd = { 0 };
+  apr_status_t status;
+
+  /* Idle connections get added and removed by the worker threads while
+     we are waiting for events.  Only some of the implementations behind
+     APR_POLLSET_DEFAULT, e.g. epoll and kqueue, support that. */
+  status = apr_pollset_create(&pollset, EVENT_POLLSET_SIZE, pool,
+                              APR_POLLSET_THREADSAFE);
+  if (status)
+    return svn_error_wrap_apr(status,
+                              _("Can't create event loop for --event"));
+
+  /* Don't block the event loop if a client aborts its connection attempt
+     before we get to accept it. */
+  status = apr_socket_opt_set(sock, APR_SO_NONBLOCK, 1);
+  if (status)
+    return svn_error_wrap_apr(status,
+                              _("Can't set options on server socket"));
+
+  pfd.p = pool;
+  pfd.desc_type = APR_POLL_SOCKET;
+  pfd.reqevents = APR_POLLIN;
+  pfd.desc.s = sock;
+  pfd.client_data = NULL;
+
+  status = apr_pollset_add(pollset, &pfd);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't watch server socket"));
+
+  while (1)
+    {
+      apr_int32_t count;
+      const apr_pollfd_t *ready;
+      int i;
+
+#ifdef WIN32
+      if (winservice_is_stopping())
+        exit(0);
+#endif
+
+      status = apr_pollset_poll(pollset, -1, &count, &ready);
+      if (APR_STATUS_IS_EINTR(status))
+        continue;
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't wait for client data"));
+
+      for (i = 0; i < count; ++i)
+        {
+          connection_t *connection = ready[i].client_data;
+
+          if (connection)
+            {
+              /* Stop watching the connection while a thread serves it. */
+              status = apr_pollset_remove(pollset, &ready[i]);
+              if (status)
+                return svn_error_wrap_apr(status,
+                                          _("Can't unwatch client "
+                                            "connection"));
+            }
+          else
+            {
+              apr_pool_t *connection_pool = svn_pool_create(pool);
+
+              connection = apr_pcalloc(connection_pool, sizeof(*connection));
+              connection->pool = connection_pool;
+              connection->params = params;
+              connection->ref_count = 1;
+
+              status = apr_socket_accept(&connection->usock, sock,
+                                         connection_pool);
+              if (status)
+                {
+                  svn_pool_destroy(connection_pool);
+                  if (   APR_STATUS_IS_EAGAIN(status)
+                      || APR_STATUS_IS_EINTR(status)
+                      || APR_STATUS_IS_ECONNABORTED(status)
+                      || APR_STATUS_IS_ECONNRESET(status))
+                    continue;
+
+                  return svn_error_wrap_apr(status,
+                                            _("Can't accept client "
+                                              "connection"));
+                }
+
+              /* The connection threads expect blocking I/O.  Reads that
+                 stall for too long will fail, though, ending the
+                 connection and freeing its thread. */
+              apr_socket_opt_set(connection->usock, APR_SO_NONBLOCK, 0);
+              apr_socket_timeout_set(connection->usock, -1);
+              connection->read_timeout = EVENT_READ_TIMEOUT;
+            }
+
+          status = apr_thread_pool_push(threads, event_thread, connection,
+                                        0, NULL);
+          if (status)
+            return svn_error_wrap_apr(status, _("Can't push task"));
+        }
+    }
+
+  /* NOTREACHED */
+}
+
 #endif
 
 /* Write the PID of the current process as a decimal number, followed by a
@@ -742,6 +978,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   svn_node_kind_t kind;
   apr_size_t min_thread_count = THREADPOOL_MIN_SIZE;
   apr_size_t max_thread_count = THREADPOOL_MAX_SIZE;
+#if APR_HAS_THREADS
+  apr_uint16_t metrics_port = 0;
+  const char *metrics_host = "localhost";
+#endif
 #ifdef SVN_HAVE_SASL
   SVN_ERR(cyrus_init(pool));
 #endif
@@ -765,6 +1005,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   params.cfg = NULL;
   params.compression_level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
   params.logger = NULL;
+  params.metrics = NULL;
   params.config_pool = NULL;
   params.fs_config = NULL;
   params.vhost = FALSE;
@@ -892,6 +1133,29 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           handling_opt_count++;
           break;
 
+#if APR_HAS_THREADS
+        case SVNSERVE_OPT_EVENT:
+          handling_mode = connection_mode_event;
+          handling_opt_count++;
+          break;
+
+        case SVNSERVE_OPT_METRICS_PORT:
+          {
+            apr_uint64_t val;
+
+            err = svn_cstring_strtoui64(&val, arg, 1, APR_UINT16_MAX, 10);
+            if (err)
+              return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, err,
+                                       _("Invalid port '%s'"), arg);
+            metrics_port = (apr_uint16_t)val;
+          }
+          break;
+
+        case SVNSERVE_OPT_METRICS_HOST:
+          metrics_host = arg;
+          break;
+#endif
+
         case 'c':
           params.compression_level = atoi(arg);
           if (params.compression_level < SVN_DELTA_COMPRESSION_LEVEL_NONE)
@@ -1029,7 +1293,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   if (handling_opt_count > 1)
     {
       svn_error_clear(svn_cmdline_fputs(
-                      _("You may only specify one of -T or --single-thread\n"),
+                      _("You may only specify one of -T, --event or "
+                        "--single-thread\n"),
                       stderr, pool));
       usage(argv[0], pool);
       *exit_code = EXIT_FAILURE;
@@ -1037,7 +1302,8 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     }
 
   /* construct object pools */
-  is_multi_threaded = handling_mode == connection_mode_thread;
+  is_multi_threaded = handling_mode == connection_mode_thread
+                   || handling_mode == connection_mode_event;
   params.fs_config = apr_hash_make(pool);
   svn_hash_sets(params.fs_config, SVN_FS_CONFIG_FSFS_CACHE_DELTAS,
                 cache_txdeltas ? "1" :"0");
@@ -1079,6 +1345,33 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
                _("Option --tunnel-user is only valid in tunnel mode"));
     }
 
+#if APR_HAS_THREADS
+  if (metrics_port)
+    {
+      /* Forked children would collect their data where nobody can see
+         it, and there is no long-running process in inetd or tunnel
+         mode.  The metrics thread also reads the cache statistics
+         concurrently to the workers, so the caches must be thread-safe,
+         which they are only in multi-threaded modes. */
+      if (!is_multi_threaded
+          || run_mode == run_mode_inetd || run_mode == run_mode_tunnel)
+        return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                 _("Option --metrics-port requires a single server "
+                   "process, e.g. --threads or --event"));
+
+      SVN_ERR(metrics__create(&params.metrics, params.logger, pool));
+
+      /* The trace probes provide e.g. the FS write lock wait times. */
+      SVN_ERR(svn_trace__enable(TRUE));
+    }
+#endif
+
+  /* Hooks may only run in the background if they won't be killed when a
+     connection ends. */
+  if (is_multi_threaded
+      && (run_mode == run_mode_daemon || run_mode == run_mode_service))
+    svn_repos__hook_queue_allow_background();
+
   if (run_mode == run_mode_inetd || run_mode == run_mode_tunnel)
     {
       apr_pool_t *connection_pool;
@@ -1280,7 +1573,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       settings.cache_size = params.memory_cache_size;
 
     settings.single_threaded = TRUE;
-    if (handling_mode == connection_mode_thread)
+    if (is_multi_threaded)
       {
 #if APR_HAS_THREADS
         settings.single_threaded = FALSE;
@@ -1300,7 +1593,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
 #if APR_HAS_THREADS
   SVN_ERR(svn_root_pools__create(&connection_pools));
 
-  if (handling_mode == connection_mode_thread)
+  if (is_multi_threaded)
     {
       /* create the thread pool with a valid range of threads */
       if (max_thread_count < 1)
@@ -1330,6 +1623,16 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     }
 #endif
 
+#if APR_HAS_THREADS
+  if (params.metrics)
+    SVN_ERR(metrics__listen(params.metrics, metrics_host, metrics_port,
+                            threads, pool));
+
+  if (handling_mode == connection_mode_event
+      && run_mode != run_mode_listen_once)
+    return svn_error_trace(serve_events(sock, &params, pool));
+#endif
+
   while (1)
     {
       connection_t *connection = NULL;
@@ -1352,6 +1655,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
               /* the child would't listen to the main server's socket */
               apr_socket_close(sock);
 
+              /* any trace data written at exit shall cover this
+                 connection only */
+              svn_error_clear(svn_trace__reset());
+
               /* serve_socket() logs any error it returns, so ignore it. */
               svn_error_clear(serve_socket(connection, connection->pool));
               close_connection(connection);
@@ -1382,6 +1689,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
 #endif
           break;
 
+        case connection_mode_event:
+          /* Handled by serve_events(), except in listen-once mode. */
+          break;
+
         case connection_mode_single:
           /* Serve one connection at a time. */
           /* serve_socket() logs any error it returns, so ignore it. */
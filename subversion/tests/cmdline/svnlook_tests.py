@@ -719,6 +719,51 @@ def property_delete(sbox):
                                          'changed', repo_dir)
 
 
+def serve_requests(sbox):
+  "test 'svnlook serve'"
+
+  sbox.build(create_wc=False)
+  repo_dir = sbox.repo_dir
+
+  requests = [b'youngest\n',
+              b'cat "/iota"\n',
+              b'\n',
+              b'cat /no-such-file\n',
+              b'changed -r 1\n']
+  exit_code, output, errput = svntest.main.run_command_stdin(
+    svntest.main.svnlook_binary, None, 0, True, requests,
+    'serve', repo_dir)
+
+  # Split the output into (exit code, content) responses.
+  data = b''.join(output)
+  responses = []
+  while data:
+    header, data = data.split(b'\n', 1)
+    code, size = header.split(b' ')
+    responses.append((int(code), data[:int(size)]))
+    data = data[int(size):]
+
+  # Empty requests get no response.
+  if len(responses) != 4:
+    raise svntest.Failure("Expected 4 responses, got %d" % len(responses))
+
+  if responses[0] != (0, b'1\n'):
+    raise svntest.Failure("Unexpected 'youngest' response: %s"
+                          % str(responses[0]))
+  if responses[1] != (0, b"This is the file 'iota'.\n"):
+    raise svntest.Failure("Unexpected 'cat' response: %s"
+                          % str(responses[1]))
+  if responses[2][0] == 0 or b'E160013' not in responses[2][1]:
+    raise svntest.Failure("Expected an error, got: %s" % str(responses[2]))
+
+  # The service continues after errors.
+  changed = responses[3][1].splitlines()
+  if responses[3][0] != 0 or len(changed) != 20 \
+     or b'A   iota' not in changed:
+    raise svntest.Failure("Unexpected 'changed' response: %s"
+                          % str(responses[3]))
+
+
 ########################################################################
 # Run the tests
 
@@ -738,6 +783,7 @@ test_list = [ None,
               test_filesize,
               test_txn_flag,
               property_delete,
+              serve_requests,
              ]
 
 if __name__ == '__main__':
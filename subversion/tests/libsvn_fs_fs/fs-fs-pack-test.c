@@ -26,16 +26,26 @@
 
 #include "../svn_test.h"
 #include "../../libsvn_fs/fs-loader.h"
+#include "../../libsvn_fs_fs/access-stats.h"
+#include "../../libsvn_fs_fs/cached_data.h"
 #include "../../libsvn_fs_fs/fs.h"
 #include "../../libsvn_fs_fs/fs_fs.h"
+#include "../../libsvn_fs_fs/index.h"
 #include "../../libsvn_fs_fs/low_level.h"
 #include "../../libsvn_fs_fs/pack.h"
+#include "../../libsvn_fs_fs/rep-cache.h"
+#include "../../libsvn_fs_fs/rev_file.h"
+#include "../../libsvn_fs_fs/transaction.h"
 #include "../../libsvn_fs_fs/util.h"
+#include "../../libsvn_fs_fs/youngest-map.h"
 
+#include "svn_dirent_uri.h"
 #include "svn_hash.h"
 #include "svn_pools.h"
 #include "svn_props.h"
 #include "svn_fs.h"
+#include "private/svn_fs_fs_private.h"
+#include "private/svn_fs_private.h"
 #include "private/svn_string_private.h"
 
 #include "../svn_test_fs.h"
@@ -568,6 +578,102 @@ get_set_large_revprop_packed_fs(const svn_test_opts_t *opts,
 #undef MAX_REV
 #undef SHARD_SIZE
 
+/* ------------------------------------------------------------------------ */
+/* Baton for compare_revprops(). */
+typedef struct compare_revprops_baton_t
+{
+  svn_fs_t *fs;
+
+  /* Revision we expect next and the direction we are going. */
+  svn_revnum_t next;
+  svn_revnum_t step;
+} compare_revprops_baton_t;
+
+/* Implements svn_fs_revision_proplist_receiver_t.  Verify that REVISION
+ * is the one expected by BATON and that PROPLIST matches what
+ * svn_fs_revision_proplist2 returns for it. */
+static svn_error_t *
+compare_revprops(void *baton,
+                 svn_revnum_t revision,
+                 apr_hash_t *proplist,
+                 apr_pool_t *scratch_pool)
+{
+  compare_revprops_baton_t *b = baton;
+  apr_hash_t *expected;
+  svn_string_t *log;
+
+  SVN_TEST_ASSERT(revision == b->next);
+  b->next += b->step;
+
+  SVN_ERR(svn_fs_revision_proplist2(&expected, b->fs, revision, TRUE,
+                                    scratch_pool, scratch_pool));
+  SVN_TEST_ASSERT(apr_hash_count(proplist) == apr_hash_count(expected));
+
+  log = svn_hash_gets(proplist, SVN_PROP_REVISION_LOG);
+  SVN_TEST_ASSERT(log);
+  SVN_TEST_STRING_ASSERT(log->data,
+                         ((svn_string_t *)svn_hash_gets(
+                             expected, SVN_PROP_REVISION_LOG))->data);
+
+  return SVN_NO_ERROR;
+}
+
+#define REPO_NAME "test-repo-batch-revprops-packed-fs"
+#define SHARD_SIZE 4
+#define MAX_REV 11
+static svn_error_t *
+batch_revprops_packed_fs(const svn_test_opts_t *opts,
+                         apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_revnum_t rev;
+  compare_revprops_baton_t baton;
+
+  /* Create the packed FS and open it. */
+  SVN_ERR(prepare_revprop_repo(&fs, REPO_NAME, MAX_REV, SHARD_SIZE, opts,
+                               pool));
+
+  /* Use large values such that the revprop shards get split into
+   * multiple pack files. */
+  for (rev = 0; rev <= MAX_REV; ++rev)
+    SVN_ERR(svn_fs_change_rev_prop(fs, rev, SVN_PROP_REVISION_LOG,
+                                   large_log(rev, rev % 3 ? 1000 : 2400,
+                                             pool),
+                                   pool));
+
+  /* Read all revprops, including the non-packed HEAD, in either order. */
+  baton.fs = fs;
+  baton.next = 0;
+  baton.step = 1;
+  SVN_ERR(svn_fs_revision_proplists(fs, 0, MAX_REV + 1, FALSE,
+                                    compare_revprops, &baton, pool));
+  SVN_TEST_ASSERT(baton.next == MAX_REV + 2);
+
+  baton.next = MAX_REV + 1;
+  baton.step = -1;
+  SVN_ERR(svn_fs_revision_proplists(fs, MAX_REV + 1, 0, TRUE,
+                                    compare_revprops, &baton, pool));
+  SVN_TEST_ASSERT(baton.next == -1);
+
+  /* Sub-ranges within a single shard. */
+  baton.next = 5;
+  baton.step = 1;
+  SVN_ERR(svn_fs_revision_proplists(fs, 5, 6, FALSE,
+                                    compare_revprops, &baton, pool));
+  SVN_TEST_ASSERT(baton.next == 7);
+
+  /* Revisions beyond HEAD must be rejected. */
+  SVN_TEST_ASSERT_ERROR(svn_fs_revision_proplists(fs, 0, MAX_REV + 2, FALSE,
+                                                  compare_revprops, &baton,
+                                                  pool),
+                        SVN_ERR_FS_NO_SUCH_REVISION);
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef MAX_REV
+#undef SHARD_SIZE
+
 /* ------------------------------------------------------------------------ */
 #define REPO_NAME "test-repo-get-set-huge-revprop-packed-fs"
 #define SHARD_SIZE 4
@@ -1562,6 +1668,818 @@ rep_sharing_effectiveness(const svn_test_opts_t *opts,
 
 /* ------------------------------------------------------------------------ */
 
+#define REPO_NAME "test-repo-rep_sharing_index"
+
+/* Rep cache walker counting the entries in *(int *)BATON. */
+static svn_error_t *
+count_rep_cache_entries(representation_t *rep,
+                        void *baton,
+                        svn_fs_t *fs,
+                        apr_pool_t *scratch_pool)
+{
+  int *count = baton;
+  ++*count;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+rep_sharing_index(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_node_kind_t kind;
+  svn_stringbuf_t *str;
+  int count;
+  const char *hello_str = multiply_string("Hello, ", pool);
+  const char *world_str = multiply_string("World!", pool);
+  const char *goodbye_str = multiply_string("Goodbye!", pool);
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* Create a repo that uses the rep-cache.db at first. */
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_REP_SHARING_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  ffd->rep_sharing_allowed = TRUE;
+
+  /* Revision 1: create 2 files with different content. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "foo", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "foo", hello_str, pool));
+  SVN_ERR(svn_fs_make_file(root, "bar", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "bar", world_str, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Switch to the rep-index in a new FS instance.  The existing rep-cache.db
+     contents must be migrated. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  ffd = fs->fsap_data;
+  ffd->rep_sharing_allowed = TRUE;
+  ffd->rep_cache_index = TRUE;
+
+  /* Revision 2: share a rep from r1 and add a new one twice. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "baz", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "baz", hello_str, pool));
+  SVN_ERR(svn_fs_make_file(root, "qux", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "qux", goodbye_str, pool));
+  SVN_ERR(svn_fs_make_file(root, "quux", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "quux", goodbye_str, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  SVN_ERR(svn_io_check_path(svn_dirent_join(REPO_NAME, "rep-index", pool),
+                            &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_dir);
+
+  /* Only the root directory and the new file contents got stored. */
+  SVN_ERR(count_representations(&count, fs, rev, pool));
+  SVN_TEST_ASSERT(count == 2);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "baz", &str, pool));
+  SVN_TEST_STRING_ASSERT(str->data, hello_str);
+  SVN_ERR(svn_test__get_file_contents(root, "quux", &str, pool));
+  SVN_TEST_STRING_ASSERT(str->data, goodbye_str);
+
+  /* A fresh FS instance must see all entries. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  ffd = fs->fsap_data;
+  ffd->rep_sharing_allowed = TRUE;
+  ffd->rep_cache_index = TRUE;
+
+  count = 0;
+  SVN_ERR(svn_fs_fs__walk_rep_reference(fs, 0, rev, count_rep_cache_entries,
+                                        &count, NULL, NULL, pool));
+  SVN_TEST_ASSERT(count == 3);
+
+  /* Removing r2 from the index leaves only the r1 entries. */
+  SVN_ERR(svn_fs_fs__del_rep_reference(fs, 1, pool));
+
+  count = 0;
+  SVN_ERR(svn_fs_fs__walk_rep_reference(fs, 0, rev, count_rep_cache_entries,
+                                        &count, NULL, NULL, pool));
+  SVN_TEST_ASSERT(count == 2);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-sorted_directories"
+
+/* Set *SORTED to TRUE, iff the directory PATH in ROOT of FS is stored in
+   the sorted format.  Use POOL for allocations. */
+static svn_error_t *
+is_sorted_dir_rep(svn_boolean_t *sorted,
+                  svn_fs_t *fs,
+                  svn_fs_root_t *root,
+                  const char *path,
+                  apr_pool_t *pool)
+{
+  const svn_fs_id_t *id;
+  node_revision_t *noderev;
+  svn_stream_t *stream;
+  svn_stringbuf_t *text;
+
+  SVN_ERR(svn_fs_node_id(&id, root, path, pool));
+  SVN_ERR(svn_fs_fs__get_node_revision(&noderev, fs, id, pool, pool));
+  SVN_ERR(svn_fs_fs__get_contents(&stream, fs, noderev->data_rep, FALSE,
+                                  pool));
+  SVN_ERR(svn_stringbuf_from_stream(&text, stream, 0, pool));
+  *sorted = svn_fs_fs__is_sorted_dir(text->data, text->len);
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify that directory PATH in ROOT contains exactly COUNT files named
+   "f0" etc. and the sub-directory "sub".  Use POOL for allocations. */
+static svn_error_t *
+verify_dir_entries(svn_fs_root_t *root,
+                   const char *path,
+                   int count,
+                   apr_pool_t *pool)
+{
+  apr_hash_t *entries;
+  svn_node_kind_t kind;
+  int i;
+
+  SVN_ERR(svn_fs_dir_entries(&entries, root, path, pool));
+  SVN_TEST_ASSERT(apr_hash_count(entries) == count + 1);
+
+  for (i = 0; i < count; ++i)
+    {
+      const char *name = apr_psprintf(pool, "f%d", i);
+      svn_fs_dirent_t *dirent = svn_hash_gets(entries, name);
+
+      SVN_TEST_ASSERT(dirent && dirent->kind == svn_node_file);
+      SVN_ERR(svn_fs_check_path(&kind, root,
+                                svn_relpath_join(path, name, pool), pool));
+      SVN_TEST_ASSERT(kind == svn_node_file);
+    }
+
+  SVN_ERR(svn_fs_check_path(&kind, root,
+                            svn_relpath_join(path, "sub", pool), pool));
+  SVN_TEST_ASSERT(kind == svn_node_dir);
+  SVN_ERR(svn_fs_check_path(&kind, root,
+                            svn_relpath_join(path, "missing", pool), pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+  SVN_ERR(svn_fs_check_path(&kind, root,
+                            svn_relpath_join(path, "f", pool), pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+sorted_directories(const svn_test_opts_t *opts,
+                   apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_boolean_t sorted;
+  int format;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_SORTED_DIR_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* Revision 1: write "old" using the hash dump format. */
+  format = ffd->format;
+  ffd->format = SVN_FS_FS__MIN_SORTED_DIR_FORMAT - 1;
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_dir(root, "old", pool));
+  SVN_ERR(svn_fs_make_dir(root, "old/sub", pool));
+  for (i = 0; i < 50; ++i)
+    SVN_ERR(svn_fs_make_file(root, apr_psprintf(pool, "old/f%d", i), pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Revision 2: write "new" using the sorted format. */
+  ffd->format = format;
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_dir(root, "new", pool));
+  SVN_ERR(svn_fs_make_dir(root, "new/sub", pool));
+  for (i = 0; i < 200; ++i)
+    SVN_ERR(svn_fs_make_file(root, apr_psprintf(pool, "new/f%d", i), pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Both formats must be readable from the same repository. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+
+  SVN_ERR(is_sorted_dir_rep(&sorted, fs, root, "old", pool));
+  SVN_TEST_ASSERT(!sorted);
+  SVN_ERR(is_sorted_dir_rep(&sorted, fs, root, "new", pool));
+  SVN_TEST_ASSERT(sorted);
+
+  /* Single-entry lookups first, then through the caches. */
+  SVN_ERR(verify_dir_entries(root, "new", 200, pool));
+  SVN_ERR(verify_dir_entries(root, "old", 50, pool));
+  SVN_ERR(verify_dir_entries(root, "new", 200, pool));
+
+  /* Modify the sorted directory. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_delete(root, "new/f199", pool));
+  SVN_ERR(svn_fs_make_file(root, "old/f50", pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(verify_dir_entries(root, "new", 199, pool));
+  SVN_ERR(verify_dir_entries(root, "old", 51, pool));
+  SVN_ERR(is_sorted_dir_rep(&sorted, fs, root, "old", pool));
+  SVN_TEST_ASSERT(sorted);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-youngest_map"
+
+/* Add a file at PATH to the youngest revision of FS and commit it.
+   Return the new revision in *REV.  Use POOL for allocations. */
+static svn_error_t *
+commit_new_file(svn_revnum_t *rev,
+                svn_fs_t *fs,
+                const char *path,
+                apr_pool_t *pool)
+{
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t youngest;
+
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs, pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, path, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, rev, txn, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Open the FS at REPO_NAME with the youngest map enabled. */
+static svn_error_t *
+open_with_youngest_map(svn_fs_t **fs,
+                       apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd;
+
+  SVN_ERR(svn_fs_open2(fs, REPO_NAME, NULL, pool, pool));
+  ffd = (*fs)->fsap_data;
+  ffd->mmap_youngest = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+youngest_map(const svn_test_opts_t *opts,
+             apr_pool_t *pool)
+{
+  svn_fs_t *fs, *fs2, *fs3;
+  fs_fs_data_t *ffd;
+  svn_revnum_t rev, youngest;
+  svn_node_kind_t kind;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+#if !APR_HAS_MMAP
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+#endif
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_YOUNGEST_MAP_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* The first reader creates the file.  It does not contain a valid
+   * revision until a writer publishes one. */
+  ffd->mmap_youngest = TRUE;
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs, pool));
+  SVN_TEST_ASSERT(youngest == 0);
+  SVN_ERR(svn_io_check_path(svn_dirent_join(fs->path, PATH_YOUNGEST, pool),
+                            &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+  SVN_TEST_ASSERT(ffd->youngest_map != NULL);
+  SVN_TEST_ASSERT(!svn_fs_fs__youngest_map_get(&youngest, fs));
+
+  /* Commits through one FS object become visible to the others. */
+  SVN_ERR(open_with_youngest_map(&fs2, pool));
+  SVN_ERR(commit_new_file(&rev, fs, "/a", pool));
+  SVN_TEST_ASSERT(rev == 1);
+  SVN_TEST_ASSERT(svn_fs_fs__youngest_map_get(&youngest, fs));
+  SVN_TEST_ASSERT(youngest == 1);
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs2, pool));
+  SVN_TEST_ASSERT(youngest == 1);
+
+  /* Simulate a stale value left behind by a system crash.  Mapping the
+   * file again must detect and invalidate it. */
+  svn_fs_fs__youngest_map_publish(fs, 0);
+  SVN_ERR(open_with_youngest_map(&fs3, pool));
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs3, pool));
+  SVN_TEST_ASSERT(youngest == 1);
+  SVN_TEST_ASSERT(!svn_fs_fs__youngest_map_get(&youngest, fs2));
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs2, pool));
+  SVN_TEST_ASSERT(youngest == 1);
+
+  /* Waiting for a new revision times out ... */
+  SVN_ERR(svn_fs__wait_for_youngest(&youngest, fs2, 1,
+                                    apr_time_from_msec(10), NULL, NULL,
+                                    pool));
+  SVN_TEST_ASSERT(youngest == 1);
+
+  /* ... unless there is one.  The next writer repairs the map. */
+  SVN_ERR(commit_new_file(&rev, fs2, "/b", pool));
+  SVN_TEST_ASSERT(rev == 2);
+  SVN_ERR(svn_fs__wait_for_youngest(&youngest, fs3, 1, -1, NULL, NULL,
+                                    pool));
+  SVN_TEST_ASSERT(youngest == 2);
+  SVN_TEST_ASSERT(svn_fs_fs__youngest_map_get(&youngest, fs));
+  SVN_TEST_ASSERT(youngest == 2);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-txn_noderev_log"
+
+static svn_error_t *
+txn_noderev_log(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+  svn_fs_t *fs, *fs2;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn, *txn2;
+  svn_fs_root_t *root, *root2;
+  svn_revnum_t rev;
+  const char *txn_name;
+  apr_hash_t *dirents;
+  apr_hash_index_t *hi;
+  svn_stringbuf_t *contents;
+  svn_node_kind_t kind;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_NODEREV_LOG_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  ffd->txn_noderev_log = TRUE;
+
+  /* Add, modify and delete nodes. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(root, pool));
+  SVN_ERR(svn_fs_delete(root, "A/D/H", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "iota", "new iota\n", pool));
+
+  /* There must be no per-node node-revision files. */
+  SVN_ERR(svn_io_get_dirents3(&dirents,
+                              svn_fs_fs__path_txn_dir(
+                                  fs, svn_fs_fs__txn_get_id(txn), pool),
+                              TRUE, pool, pool));
+  SVN_TEST_ASSERT(svn_hash_gets(dirents, PATH_NODE_REVS));
+  for (hi = apr_hash_first(pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+      const char *ext = strrchr(name, '.');
+      if (strncmp(name, PATH_PREFIX_NODE, strlen(PATH_PREFIX_NODE)) == 0)
+        SVN_TEST_ASSERT(   strcmp(ext, PATH_EXT_CHILDREN) == 0
+                        || strcmp(ext, PATH_EXT_PROPS) == 0);
+    }
+
+  /* Another FS object sees the same transaction contents ... */
+  SVN_ERR(svn_fs_txn_name(&txn_name, txn, pool));
+  SVN_ERR(svn_fs_open2(&fs2, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(svn_fs_open_txn(&txn2, fs2, txn_name, pool));
+  SVN_ERR(svn_fs_txn_root(&root2, txn2, pool));
+  SVN_ERR(svn_fs_check_path(&kind, root2, "A/D/H", pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+  SVN_ERR(svn_test__get_file_contents(root2, "iota", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "new iota\n");
+
+  /* ... and may modify them as well. */
+  SVN_ERR(svn_test__set_file_contents(root2, "A/mu", "new mu\n", pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "A/mu", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "new mu\n");
+
+  /* Commit everything. */
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == 1);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_fs_check_path(&kind, root, "A/D/H", pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+  SVN_ERR(svn_test__get_file_contents(root, "iota", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "new iota\n");
+  SVN_ERR(svn_test__get_file_contents(root, "A/mu", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "new mu\n");
+  SVN_ERR(svn_test__get_file_contents(root, "A/D/gamma", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "This is the file 'gamma'.\n");
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-similarity_deltification"
+
+/* Return LEN bytes of pseudo-random text for SEED, allocated in POOL. */
+static svn_stringbuf_t *
+random_text(apr_size_t len,
+            apr_uint32_t seed,
+            apr_pool_t *pool)
+{
+  svn_stringbuf_t *text = svn_stringbuf_create_ensure(len, pool);
+  apr_size_t i;
+
+  for (i = 0; i < len; ++i)
+    {
+      seed = seed * 1103515245 + 12345;
+      svn_stringbuf_appendbyte(text, (i % 64 == 63)
+                                     ? '\n'
+                                     : (char)('a' + (seed >> 16) % 26));
+    }
+
+  return text;
+}
+
+/* Set *REP to the data representation of file PATH in ROOT of FS.
+   Use POOL for allocations. */
+static svn_error_t *
+get_data_rep(representation_t **rep,
+             svn_fs_t *fs,
+             svn_fs_root_t *root,
+             const char *path,
+             apr_pool_t *pool)
+{
+  const svn_fs_id_t *id;
+  node_revision_t *noderev;
+
+  SVN_ERR(svn_fs_node_id(&id, root, path, pool));
+  SVN_ERR(svn_fs_fs__get_node_revision(&noderev, fs, id, pool, pool));
+  *rep = noderev->data_rep;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+similarity_deltification(const svn_test_opts_t *opts,
+                         apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *base, *similar, *other, *contents;
+  representation_t *rep;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_DELTIFICATION_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  ffd->similarity_deltification = TRUE;
+
+  /* Two new files with mostly the same contents, but no shared history. */
+  base = random_text(20000, 1, pool);
+  similar = svn_stringbuf_dup(base, pool);
+  memcpy(similar->data + 10000, "similar", 7);
+  other = svn_stringbuf_dup(base, pool);
+  memcpy(other->data + 10000, "other", 5);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "a", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "a", base->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == 1);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_dir(root, "dir", pool));
+  SVN_ERR(svn_fs_make_file(root, "dir/b", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "dir/b", similar->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == 2);
+
+  /* The second file should have been stored as a small delta against
+     the first one. */
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(get_data_rep(&rep, fs, root, "dir/b", pool));
+  SVN_TEST_ASSERT(rep->size < rep->expanded_size / 4);
+  SVN_ERR(svn_test__get_file_contents(root, "dir/b", &contents, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(contents, similar));
+
+  /* Without the option, we get a self-delta instead. */
+  ffd->similarity_deltification = FALSE;
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "c", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "c", other->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == 3);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(get_data_rep(&rep, fs, root, "c", pool));
+  SVN_TEST_ASSERT(rep->size > rep->expanded_size / 2);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-access_stats_pack"
+#define SHARD_SIZE 4
+#define MAX_REV 5
+
+/* Set *OFFSET to the position of the noderev of PATH in REVISION of FS.
+   Use POOL for allocations. */
+static svn_error_t *
+get_noderev_offset(apr_off_t *offset,
+                   svn_fs_t *fs,
+                   svn_revnum_t revision,
+                   const char *path,
+                   apr_pool_t *pool)
+{
+  svn_fs_root_t *root;
+  const svn_fs_id_t *id;
+  svn_fs_fs__revision_file_t *rev_file;
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, revision, pool));
+  SVN_ERR(svn_fs_node_id(&id, root, path, pool));
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, revision,
+                                           pool, pool));
+  SVN_ERR(svn_fs_fs__item_offset(offset, fs, rev_file, revision, NULL,
+                                 svn_fs_fs__id_item(id), pool));
+
+  return svn_error_trace(svn_fs_fs__close_revision_file(rev_file));
+}
+
+static svn_error_t *
+access_stats_pack(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_root_t *root;
+  const svn_fs_id_t *id;
+  node_revision_t *noderev;
+  svn_node_kind_t kind;
+  apr_hash_t *counts;
+  apr_off_t hot_offset, cold_offset;
+  svn_stringbuf_t *contents;
+
+  SVN_ERR(create_non_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                       pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_LOG_ADDRESSING_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* Without statistics, A/B/lambda comes before A/mu in path order. */
+  ffd->access_sample_rate = 1;
+
+  /* Read A/mu of r1 repeatedly. */
+  SVN_ERR(svn_fs_revision_root(&root, fs, 1, pool));
+  SVN_ERR(svn_fs_node_id(&id, root, "A/mu", pool));
+  SVN_ERR(svn_fs_fs__get_node_revision(&noderev, fs, id, pool, pool));
+  SVN_ERR(svn_fs_fs__get_node_revision(&noderev, fs, id, pool, pool));
+  SVN_ERR(svn_fs_fs__access_stats_flush(fs, pool));
+
+  SVN_ERR(svn_io_check_path(svn_dirent_join(svn_fs_fs__path_rev_shard(fs, 1,
+                                                                      pool),
+                                            PATH_ACCESS_STATS, pool),
+                            &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+
+  SVN_ERR(svn_fs_fs__access_stats_read(&counts,
+                                       svn_fs_fs__path_rev_shard(fs, 1, pool),
+                                       pool, pool));
+  SVN_TEST_ASSERT(svn_fs_fs__access_stats_count(counts, 1,
+                                                svn_fs_fs__id_item(id))
+                  >= 2);
+
+  /* Pack and verify that the hot node got placed first. */
+  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+
+  SVN_ERR(get_noderev_offset(&hot_offset, fs, 1, "A/mu", pool));
+  SVN_ERR(get_noderev_offset(&cold_offset, fs, 1, "A/B/lambda", pool));
+  SVN_TEST_ASSERT(hot_offset < cold_offset);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, 1, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "A/mu", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "This is the file 'mu'.\n");
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-pack_recompression"
+#define SHARD_SIZE 4
+#define MAX_REV 5
+
+/* Set *DATA_SIZE and *VERSION to the data size recorded in the rep header
+   and the svndiff version of the data representation of PATH in REVISION
+   of FS.  Use POOL for allocations. */
+static svn_error_t *
+get_rep_encoding(svn_filesize_t *data_size,
+                 int *version,
+                 svn_fs_t *fs,
+                 svn_revnum_t revision,
+                 const char *path,
+                 apr_pool_t *pool)
+{
+  svn_fs_root_t *root;
+  representation_t *rep;
+  svn_fs_fs__revision_file_t *rev_file;
+  svn_fs_fs__rep_header_t *header;
+  apr_off_t offset;
+  char signature[4];
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, revision, pool));
+  SVN_ERR(get_data_rep(&rep, fs, root, path, pool));
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, revision,
+                                           pool, pool));
+  SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file, revision, NULL,
+                                 rep->item_index, pool));
+  SVN_ERR(svn_io_file_seek(rev_file->file, APR_SET, &offset, pool));
+  SVN_ERR(svn_fs_fs__read_rep_header(&header, rev_file->stream, pool, pool));
+
+  offset += header->header_size;
+  SVN_ERR(svn_io_file_seek(rev_file->file, APR_SET, &offset, pool));
+  SVN_ERR(svn_io_file_read_full2(rev_file->file, signature,
+                                 sizeof(signature), NULL, NULL, pool));
+
+  *data_size = header->data_size;
+  *version = signature[3];
+
+  return svn_error_trace(svn_fs_fs__close_revision_file(rev_file));
+}
+
+/* Open the repository at REPO_NAME in *FS with a fresh cache namespace
+   after setting its pack-compression option to COMPRESSION.  Use POOL for
+   allocations. */
+static svn_error_t *
+reopen_with_pack_compression(svn_fs_t **fs,
+                             const char *compression,
+                             apr_pool_t *pool)
+{
+  apr_hash_t *fs_config = apr_hash_make(pool);
+
+  SVN_ERR(svn_io_remove_file2(svn_dirent_join(REPO_NAME, "fsfs.conf", pool),
+                              FALSE, pool));
+  SVN_ERR(svn_io_file_create(svn_dirent_join(REPO_NAME, "fsfs.conf", pool),
+                             apr_psprintf(pool,
+                                          "[" CONFIG_SECTION_DELTIFICATION "]\n"
+                                          CONFIG_OPTION_PACK_COMPRESSION
+                                          " = %s\n", compression),
+                             pool));
+
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  return svn_error_trace(svn_fs_open2(fs, REPO_NAME, fs_config, pool, pool));
+}
+
+static svn_error_t *
+pack_recompression(const svn_test_opts_t *opts,
+                   apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *text, *previous = NULL, *contents;
+  svn_filesize_t data_size;
+  int version;
+  apr_hash_t *fs_config;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_SHARD_SIZE,
+                apr_itoa(pool, SHARD_SIZE));
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+  ffd = fs->fsap_data;
+  if (   ffd->format < SVN_FS_FS__MIN_PACK_COMPRESSION_FORMAT
+      || !svn_fs_fs__use_log_addressing(fs))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* Write all revisions using zlib. */
+  ffd->delta_compression_type = compression_type_zlib;
+  ffd->delta_compression_level = 9;
+
+  text = random_text(20000, 1, pool);
+  for (rev = 1; rev <= MAX_REV; ++rev)
+    {
+      previous = svn_stringbuf_dup(text, pool);
+      memcpy(text->data + rev * 1000, "changed", 7);
+
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev - 1, pool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+      if (rev == 1)
+        SVN_ERR(svn_fs_make_file(root, "f", pool));
+      SVN_ERR(svn_test__set_file_contents(root, "f", text->data, pool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+    }
+
+  SVN_ERR(get_rep_encoding(&data_size, &version, fs, 2, "f", pool));
+  SVN_TEST_ASSERT(data_size == 0);
+  SVN_TEST_ASSERT(version == 1);
+
+  /* Pack with lz4 re-encoding. */
+  SVN_ERR(reopen_with_pack_compression(&fs, "lz4", pool));
+  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(reopen_with_pack_compression(&fs, "lz4", pool));
+
+  SVN_ERR(get_rep_encoding(&data_size, &version, fs, 2, "f", pool));
+  SVN_TEST_ASSERT(data_size > 0);
+  SVN_TEST_ASSERT(version == 2);
+
+  /* The unpacked shard remains as is. */
+  SVN_ERR(get_rep_encoding(&data_size, &version, fs, 5, "f", pool));
+  SVN_TEST_ASSERT(data_size == 0);
+  SVN_TEST_ASSERT(version == 1);
+
+  /* Re-pack the packed shard using zlib again. */
+  SVN_ERR(reopen_with_pack_compression(&fs, "zlib", pool));
+  SVN_ERR(svn_fs_fs__repack(fs, 2, NULL, NULL, pool));
+  SVN_ERR(reopen_with_pack_compression(&fs, "zlib", pool));
+
+  SVN_ERR(get_rep_encoding(&data_size, &version, fs, 2, "f", pool));
+  SVN_TEST_ASSERT(data_size > 0);
+  SVN_TEST_ASSERT(version == 1);
+
+  /* All contents are still intact. */
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM, NULL, NULL,
+                        NULL, NULL, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, MAX_REV, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "f", &contents, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(contents, text));
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, MAX_REV - 1, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "f", &contents, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(contents, previous));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+
 #define REPO_NAME "test-repo-delta_chain_with_plain"
 
 static svn_error_t *
@@ -1887,6 +2805,168 @@ large_delta_against_plain(const svn_test_opts_t *opts,
 
 #undef REPO_NAME
 
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-lock_index"
+#define FILE_COUNT 300
+
+/* Implements svn_fs_get_locks_callback_t, counting the locks in the int *
+   BATON. */
+static svn_error_t *
+count_locks_callback(void *baton,
+                     svn_lock_t *lock,
+                     apr_pool_t *pool)
+{
+  int *count = baton;
+  ++*count;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *COUNT to the number of locks reported by svn_fs_get_locks2 for PATH
+   and DEPTH in FS.  Use POOL for temporary allocations. */
+static svn_error_t *
+count_locks(int *count,
+            svn_fs_t *fs,
+            const char *path,
+            svn_depth_t depth,
+            apr_pool_t *pool)
+{
+  *count = 0;
+  return svn_error_trace(svn_fs_get_locks2(fs, path, depth,
+                                           count_locks_callback, count,
+                                           pool));
+}
+
+static svn_error_t *
+lock_index(const svn_test_opts_t *opts,
+           apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_t *fs2;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_fs_access_t *access;
+  svn_lock_t *lock;
+  svn_node_kind_t kind;
+  apr_hash_t *targets;
+  apr_hash_t *fs_config;
+  svn_error_t *err;
+  int count;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* Revision 1: many files in /A, a single one in /B. */
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_dir(root, "A", pool));
+  SVN_ERR(svn_fs_make_dir(root, "B", pool));
+  SVN_ERR(svn_fs_make_file(root, "B/g", pool));
+  for (i = 0; i < FILE_COUNT; ++i)
+    SVN_ERR(svn_fs_make_file(root, apr_psprintf(pool, "A/f%d", i), pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Create one lock in the digest files. */
+  SVN_ERR(svn_fs_create_access(&access, "user", pool));
+  SVN_ERR(svn_fs_set_access(fs, access));
+  SVN_ERR(svn_fs_lock(&lock, fs, "/B/g", NULL, "comment", FALSE, 0, rev,
+                      FALSE, pool));
+
+  /* Switch to the lock index.  The existing lock must be migrated. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  ffd = fs->fsap_data;
+  ffd->lock_index_enabled = TRUE;
+  SVN_ERR(svn_fs_set_access(fs, access));
+
+  /* Lock all files in /A in one batch.  That is enough to trigger the
+     compaction of the index log. */
+  targets = apr_hash_make(pool);
+  for (i = 0; i < FILE_COUNT; ++i)
+    svn_hash_sets(targets, apr_psprintf(pool, "/A/f%d", i),
+                  svn_fs_lock_target_create(NULL, rev, pool));
+  SVN_ERR(svn_fs_lock_many(fs, targets, NULL, FALSE, 0, FALSE, NULL, NULL,
+                           pool, pool));
+
+  SVN_ERR(svn_io_check_path(svn_dirent_join_many(pool, REPO_NAME,
+                                                 PATH_LOCKS_DIR, "index",
+                                                 SVN_VA_NULL),
+                            &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+
+  SVN_ERR(svn_fs_get_lock(&lock, fs, "/B/g", pool));
+  SVN_TEST_ASSERT(lock != NULL);
+  SVN_TEST_STRING_ASSERT(lock->comment, "comment");
+  SVN_TEST_STRING_ASSERT(lock->owner, "user");
+
+  SVN_ERR(count_locks(&count, fs, "/", svn_depth_infinity, pool));
+  SVN_TEST_ASSERT(count == FILE_COUNT + 1);
+  SVN_ERR(count_locks(&count, fs, "/A", svn_depth_infinity, pool));
+  SVN_TEST_ASSERT(count == FILE_COUNT);
+  SVN_ERR(count_locks(&count, fs, "/", svn_depth_immediates, pool));
+  SVN_TEST_ASSERT(count == 0);
+  SVN_ERR(count_locks(&count, fs, "/B", svn_depth_files, pool));
+  SVN_TEST_ASSERT(count == 1);
+  SVN_ERR(count_locks(&count, fs, "/A/f1", svn_depth_empty, pool));
+  SVN_TEST_ASSERT(count == 1);
+
+  /* Remove half of the locks in /A. */
+  targets = apr_hash_make(pool);
+  for (i = 0; i < FILE_COUNT / 2; ++i)
+    svn_hash_sets(targets, apr_psprintf(pool, "/A/f%d", i), "");
+  SVN_ERR(svn_fs_unlock_many(fs, targets, TRUE, NULL, NULL, pool, pool));
+
+  SVN_ERR(svn_fs_get_lock(&lock, fs, "/A/f0", pool));
+  SVN_TEST_ASSERT(lock == NULL);
+  SVN_ERR(count_locks(&count, fs, "/A", svn_depth_infinity, pool));
+  SVN_TEST_ASSERT(count == FILE_COUNT / 2);
+
+  /* Expired locks are not reported and don't prevent new locks. */
+  SVN_ERR(svn_fs_lock(&lock, fs, "/A/f0", NULL, NULL, FALSE,
+                      apr_time_now() - apr_time_from_sec(1), rev, FALSE,
+                      pool));
+  SVN_ERR(svn_fs_get_lock(&lock, fs, "/A/f0", pool));
+  SVN_TEST_ASSERT(lock == NULL);
+  SVN_ERR(svn_fs_lock(&lock, fs, "/A/f0", NULL, NULL, FALSE, 0, rev, FALSE,
+                      pool));
+
+  /* Another FS instance must see the same locks. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs2, REPO_NAME, fs_config, pool, pool));
+  ffd = fs2->fsap_data;
+  ffd->lock_index_enabled = TRUE;
+  SVN_ERR(count_locks(&count, fs2, "/A", svn_depth_infinity, pool));
+  SVN_TEST_ASSERT(count == FILE_COUNT / 2 + 1);
+
+  /* Commits must respect the locks in the index. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs2, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_delete(root, "A", pool));
+  err = svn_fs_commit_txn(NULL, &rev, txn, pool);
+  SVN_TEST_ASSERT_ERROR(err, SVN_ERR_FS_NO_USER);
+  SVN_ERR(svn_fs_abort_txn(txn, pool));
+
+  /* Unlocked paths can still be changed. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs2, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_delete(root, "A/f1", pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == 2);
+
+  return SVN_NO_ERROR;
+}
+
+#undef FILE_COUNT
+#undef REPO_NAME
+
 
 
 /* The test table.  */
@@ -1908,6 +2988,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "get/set revprop while packing FSFS filesystem"),
     SVN_TEST_OPTS_PASS(get_set_large_revprop_packed_fs,
                        "get/set large packed revprops in FSFS"),
+    SVN_TEST_OPTS_PASS(batch_revprops_packed_fs,
+                       "read revprop ranges from packed FSFS"),
     SVN_TEST_OPTS_PASS(get_set_huge_revprop_packed_fs,
                        "get/set huge packed revprops in FSFS"),
     SVN_TEST_OPTS_PASS(recover_fully_packed,
@@ -1934,6 +3016,20 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "file with 0 expanded-length, issue #4554"),
     SVN_TEST_OPTS_PASS(rep_sharing_effectiveness,
                        "rep-sharing effectiveness"),
+    SVN_TEST_OPTS_PASS(rep_sharing_index,
+                       "rep-sharing with the rep-index"),
+    SVN_TEST_OPTS_PASS(sorted_directories,
+                       "sorted directory representations"),
+    SVN_TEST_OPTS_PASS(youngest_map,
+                       "memory-mapped youngest revision"),
+    SVN_TEST_OPTS_PASS(txn_noderev_log,
+                       "node-revision log in FSFS transactions"),
+    SVN_TEST_OPTS_PASS(similarity_deltification,
+                       "similarity-based delta base selection"),
+    SVN_TEST_OPTS_PASS(access_stats_pack,
+                       "pack using recorded access statistics"),
+    SVN_TEST_OPTS_PASS(pack_recompression,
+                       "re-encode deltas during pack and repack"),
     SVN_TEST_OPTS_PASS(delta_chain_with_plain,
                        "delta chains starting with PLAIN, issue #4577"),
     SVN_TEST_OPTS_PASS(compare_0_length_rep,
@@ -1942,6 +3038,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pack with limited memory for metadata"),
     SVN_TEST_OPTS_PASS(large_delta_against_plain,
                        "large deltas against PLAIN, issue #4658"),
+    SVN_TEST_OPTS_PASS(lock_index,
+                       "path-sorted lock index"),
     SVN_TEST_NULL
   };
 
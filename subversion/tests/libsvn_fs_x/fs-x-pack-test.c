@@ -28,10 +28,14 @@
 #include "../../libsvn_fs_x/batch_fsync.h"
 #include "../../libsvn_fs_x/fs.h"
 #include "../../libsvn_fs_x/reps.h"
+#include "../../libsvn_fs/fs-loader.h"
 
+#include "svn_hash.h"
 #include "svn_pools.h"
 #include "svn_props.h"
 #include "svn_fs.h"
+#include "private/svn_fs_private.h"
+#include "private/svn_fspath.h"
 #include "private/svn_string_private.h"
 
 #include "../svn_test_fs.h"
@@ -930,6 +934,436 @@ test_batch_fsync(const svn_test_opts_t *opts,
 #undef REPO_NAME
 /* ------------------------------------------------------------------------ */
 
+#define REPO_NAME "test-repo-fsx-large-files"
+#define SHARD_SIZE 2
+#define MAX_REV 3
+
+/* Set *COUNT to the number of files stored in the large file directory
+   of the repository at REPO_PATH.  Use POOL for allocations. */
+static svn_error_t *
+count_large_files(int *count,
+                  const char *repo_path,
+                  apr_pool_t *pool)
+{
+  apr_hash_t *dirs;
+  apr_hash_index_t *hi;
+  const char *large_dir = svn_dirent_join(repo_path, PATH_LARGE_FILES, pool);
+
+  *count = 0;
+  SVN_ERR(svn_io_get_dirents3(&dirs, large_dir, TRUE, pool, pool));
+  for (hi = apr_hash_first(pool, dirs); hi; hi = apr_hash_next(hi))
+    {
+      apr_hash_t *files;
+      const char *name = apr_hash_this_key(hi);
+
+      SVN_ERR(svn_io_get_dirents3(&files,
+                                  svn_dirent_join(large_dir, name, pool),
+                                  TRUE, pool, pool));
+      *count += apr_hash_count(files);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify that the files in ROOT have the contents given in TEXT and SMALL
+   and that only the former is available as a plain file.  Use POOL for
+   allocations. */
+static svn_error_t *
+check_large_file_contents(svn_fs_root_t *root,
+                          const char *text,
+                          const char *small,
+                          apr_pool_t *pool)
+{
+  svn_stringbuf_t *contents;
+  apr_file_t *fulltext;
+
+  SVN_ERR(svn_test__get_file_contents(root, "big", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, text);
+  SVN_ERR(svn_test__get_file_contents(root, "copy", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, text);
+  SVN_ERR(svn_test__get_file_contents(root, "small", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, small);
+
+  SVN_ERR(svn_fs__open_fulltext_file(&fulltext, root, "big", pool));
+  SVN_TEST_ASSERT(fulltext != NULL);
+  SVN_ERR(svn_stringbuf_from_aprfile(&contents, fulltext, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, text);
+  SVN_ERR(svn_io_file_close(fulltext, pool));
+
+  SVN_ERR(svn_fs__open_fulltext_file(&fulltext, root, "small", pool));
+  SVN_TEST_ASSERT(fulltext == NULL);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+large_files(const svn_test_opts_t *opts,
+            apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_x__data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *text;
+  const char *small = "small file\n";
+  const char *copy_name = REPO_NAME "-copy";
+  apr_hash_t *fs_config;
+  int count, i;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsx") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSX repositories only");
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_SHARD_SIZE,
+                apr_itoa(pool, SHARD_SIZE));
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+
+  /* Store everything larger than 1kB out-of-line. */
+  ffd = fs->fsap_data;
+  ffd->large_file_threshold = 0x400;
+
+  text = svn_stringbuf_create_empty(pool);
+  for (i = 0; text->len < 10000; ++i)
+    svn_stringbuf_appendcstr(text, apr_psprintf(pool, "line %d\n", i));
+
+  /* r1: One large and one small file. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "big", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "big", text->data, pool));
+  SVN_ERR(svn_fs_make_file(root, "small", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "small", small, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  SVN_ERR(count_large_files(&count, REPO_NAME, pool));
+  SVN_TEST_ASSERT(count == 1);
+
+  /* r2: Same contents under a different name share the large file. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "copy", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "copy", text->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  SVN_ERR(count_large_files(&count, REPO_NAME, pool));
+  SVN_TEST_ASSERT(count == 1);
+
+  /* r3: Modify the large file. */
+  memcpy(text->data + 5000, "changed", 7);
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "big", text->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  SVN_ERR(count_large_files(&count, REPO_NAME, pool));
+  SVN_TEST_ASSERT(count == 2);
+
+  /* Large files must survive packing. */
+  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, MAX_REV, pool));
+  SVN_ERR(check_large_file_contents(root, text->data, small, pool));
+
+  /* ... and hotcopies. */
+  SVN_ERR(svn_io_remove_dir2(copy_name, TRUE, NULL, NULL, pool));
+  SVN_ERR(svn_fs_hotcopy3(REPO_NAME, copy_name, FALSE, FALSE, NULL, NULL,
+                          NULL, NULL, pool));
+  svn_test_add_dir_cleanup(copy_name);
+  SVN_ERR(count_large_files(&count, copy_name, pool));
+  SVN_TEST_ASSERT(count == 2);
+  SVN_ERR(svn_fs_verify(copy_name, NULL, 0, SVN_INVALID_REVNUM, NULL, NULL,
+                        NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-fsx-pack-threads"
+#define SHARD_SIZE 8
+static svn_error_t *
+pack_threads(const svn_test_opts_t *opts,
+             apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_boolean_t same;
+  const char *copy_name = REPO_NAME "-serial";
+  const char *cwd, *pack_file, *copy_pack_file;
+  apr_hash_t *fs_config;
+  apr_pool_t *subpool = svn_pool_create(pool);
+  int i;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsx") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSX repositories only");
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_SHARD_SIZE,
+                apr_itoa(pool, SHARD_SIZE));
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, subpool));
+
+  /* Fill a shard with change lists, node and revision properties. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, subpool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, subpool));
+  SVN_ERR(svn_test__create_greek_tree(root, subpool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, subpool));
+
+  for (i = 2; i < SHARD_SIZE; ++i)
+    {
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, subpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, subpool));
+      SVN_ERR(svn_test__set_file_contents(root, "iota",
+                                          get_rev_contents(i, subpool),
+                                          subpool));
+      SVN_ERR(svn_fs_change_node_prop(root, "A/mu", "prop",
+                                      svn_string_createf(subpool, "%d", i),
+                                      subpool));
+      SVN_ERR(svn_fs_change_node_prop(root, "A/B", "prop",
+                                      svn_string_createf(subpool, "%d", i),
+                                      subpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, subpool));
+    }
+  svn_pool_destroy(subpool);
+
+  /* Pack a copy of the repository without concurrency. */
+  SVN_ERR(svn_dirent_get_absolute(&cwd, "", pool));
+  SVN_ERR(svn_io_remove_dir2(copy_name, TRUE, NULL, NULL, pool));
+  SVN_ERR(svn_io_copy_dir_recursively(REPO_NAME, cwd, copy_name, TRUE,
+                                      NULL, NULL, pool));
+  svn_test_add_dir_cleanup(copy_name);
+  SVN_ERR(svn_io_remove_file2(svn_dirent_join(copy_name, PATH_CONFIG, pool),
+                              FALSE, pool));
+  SVN_ERR(svn_io_file_create(svn_dirent_join(copy_name, PATH_CONFIG, pool),
+                             "[" CONFIG_SECTION_PACK "]\n"
+                             CONFIG_OPTION_PACK_THREADS " = 1\n",
+                             pool));
+
+  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack(copy_name, NULL, NULL, NULL, NULL, pool));
+
+  /* Concurrency must not change the result. */
+  pack_file = svn_dirent_join_many(pool, REPO_NAME, PATH_REVS_DIR,
+                                   "0" PATH_EXT_PACKED_SHARD, PATH_PACKED,
+                                   SVN_VA_NULL);
+  copy_pack_file = svn_dirent_join_many(pool, copy_name, PATH_REVS_DIR,
+                                        "0" PATH_EXT_PACKED_SHARD,
+                                        PATH_PACKED, SVN_VA_NULL);
+  SVN_ERR(svn_io_files_contents_same_p(&same, pack_file, copy_pack_file,
+                                       pool));
+  SVN_TEST_ASSERT(same);
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM, NULL, NULL,
+                        NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-fsx-shared-dag-cache"
+static svn_error_t *
+shared_dag_cache(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  svn_fs_t *fs, *fs2;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root, *root2;
+  svn_revnum_t rev;
+  svn_node_kind_t kind;
+  svn_stringbuf_t *contents;
+  const char *paths[] = { "", "iota", "A/D/G", "A/D/G/pi", "A/D/G/new",
+                          "/A/B/E/beta", "A/C/" };
+  apr_size_t i;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsx") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSX repositories only");
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(root, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "A/D/G/pi", "new pi", pool));
+  SVN_ERR(svn_fs_make_file(root, "A/D/G/new", pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* A second session on the same repository.  It will see the node
+     lookups of the first session. */
+  SVN_ERR(svn_fs_open2(&fs2, REPO_NAME, NULL, pool, pool));
+
+  for (rev = 1; rev <= 2; ++rev)
+    {
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+      SVN_ERR(svn_fs_revision_root(&root2, fs2, rev, pool));
+
+      for (i = 0; i < sizeof(paths) / sizeof(paths[0]); ++i)
+        {
+          const svn_fs_id_t *id, *id2;
+
+          SVN_ERR(svn_fs_check_path(&kind, root, paths[i], pool));
+          if (kind == svn_node_none)
+            {
+              SVN_ERR(svn_fs_check_path(&kind, root2, paths[i], pool));
+              SVN_TEST_ASSERT(kind == svn_node_none);
+              continue;
+            }
+
+          SVN_ERR(svn_fs_node_id(&id, root, paths[i], pool));
+          SVN_ERR(svn_fs_node_id(&id2, root2, paths[i], pool));
+          SVN_TEST_STRING_ASSERT(svn_fs_unparse_id(id2, pool)->data,
+                                 svn_fs_unparse_id(id, pool)->data);
+        }
+    }
+
+  /* The lookups in a later revision must not be confused with those in
+     an earlier one. */
+  SVN_ERR(svn_fs_revision_root(&root2, fs2, 1, pool));
+  SVN_ERR(svn_fs_check_path(&kind, root2, "A/D/G/new", pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+  SVN_ERR(svn_test__get_file_contents(root2, "A/D/G/pi", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "This is the file 'pi'.\n");
+
+  SVN_ERR(svn_fs_revision_root(&root2, fs2, 2, pool));
+  SVN_ERR(svn_test__get_file_contents(root2, "A/D/G/pi", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "new pi");
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+/* ------------------------------------------------------------------------ */
+
+/* Verify that svn_fs__paths_changed_under reports exactly those changes
+   in ROOT that svn_fs_paths_changed3 reports at or below PREFIX.  If
+   SORTED is set, also verify that they are ordered by path. */
+static svn_error_t *
+verify_changes_under(svn_fs_root_t *root,
+                     const char *prefix,
+                     svn_boolean_t sorted,
+                     apr_pool_t *pool)
+{
+  svn_fs_path_change_iterator_t *iterator;
+  svn_fs_path_change3_t *change;
+  apr_hash_t *expected = apr_hash_make(pool);
+  const char *canonical = svn_fspath__canonicalize(prefix, pool);
+  const char *last = NULL;
+
+  SVN_ERR(svn_fs_paths_changed3(&iterator, root, pool, pool));
+  SVN_ERR(svn_fs_path_change_get(&change, iterator));
+  while (change)
+    {
+      if (svn_fspath__skip_ancestor(canonical, change->path.data))
+        svn_hash_sets(expected, apr_pstrdup(pool, change->path.data), "");
+
+      SVN_ERR(svn_fs_path_change_get(&change, iterator));
+    }
+
+  SVN_ERR(svn_fs__paths_changed_under(&iterator, root, prefix, pool, pool));
+  SVN_ERR(svn_fs_path_change_get(&change, iterator));
+  while (change)
+    {
+      const char *path = change->path.data;
+
+      SVN_TEST_ASSERT(svn_hash_gets(expected, path));
+      svn_hash_sets(expected, path, NULL);
+
+      if (sorted && last)
+        SVN_TEST_ASSERT(svn_path_compare_paths(last, path) < 0);
+      last = apr_pstrdup(pool, path);
+
+      SVN_ERR(svn_fs_path_change_get(&change, iterator));
+    }
+
+  SVN_TEST_ASSERT(apr_hash_count(expected) == 0);
+
+  return SVN_NO_ERROR;
+}
+
+#define REPO_NAME "test-repo-fsx-changes-under"
+#define SHARD_SIZE 4
+#define MAX_REV 5
+static svn_error_t *
+changes_under(const svn_test_opts_t *opts,
+              apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  int i;
+  apr_size_t k;
+  const char *prefixes[] = { "/", "", "A", "/A/D", "A/D/G/", "/A/D/G/pi",
+                             "/A/C", "/A/C/file-42", "/A/Cx", "/nonexistent" };
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  /* r1 to r3 will be packed, i.e. stored in changes containers. */
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+
+  /* A non-packed revision with more changes than fit into a single block
+     and a directory name that shares a prefix with another one. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, MAX_REV, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  for (i = 0; i < 250; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_make_file(root,
+                               apr_psprintf(iterpool, "A/C/file-%d", i),
+                               iterpool));
+    }
+  SVN_ERR(svn_fs_make_dir(root, "A/Cx", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "A/D/G/pi", "new pi", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "iota", "new iota", pool));
+
+  /* Transaction roots are supported as well. */
+  for (k = 0; k < sizeof(prefixes) / sizeof(prefixes[0]); ++k)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(verify_changes_under(root, prefixes[k], FALSE, iterpool));
+    }
+
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Packed and non-packed revisions. */
+  for (rev = 1; rev <= MAX_REV + 1; ++rev)
+    {
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+      for (k = 0; k < sizeof(prefixes) / sizeof(prefixes[0]); ++k)
+        {
+          svn_pool_clear(iterpool);
+          SVN_ERR(verify_changes_under(root, prefixes[k], rev < SHARD_SIZE,
+                                       iterpool));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef MAX_REV
+#undef SHARD_SIZE
+/* ------------------------------------------------------------------------ */
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -963,6 +1397,14 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test packing with shard size = 1"),
     SVN_TEST_OPTS_PASS(test_batch_fsync,
                        "test batch fsync"),
+    SVN_TEST_OPTS_PASS(large_files,
+                       "store large files out-of-line"),
+    SVN_TEST_OPTS_PASS(pack_threads,
+                       "pack with and without concurrency"),
+    SVN_TEST_OPTS_PASS(shared_dag_cache,
+                       "share DAG path lookups between sessions"),
+    SVN_TEST_OPTS_PASS(changes_under,
+                       "fetch changes below a given path"),
     SVN_TEST_NULL
   };
 
@@ -286,6 +286,148 @@ store_load_many_strings_table(apr_pool_t *pool)
   return svn_error_trace(many_strings_table_body(TRUE, pool));
 }
 
+/* Name components used to generate a path corpus resembling a source
+ * tree.  The corpus must not depend on the environment, so we don't read
+ * an actual directory tree.
+ */
+static const char *corpus_dirs[] =
+  {
+    "bindings", "include", "libsvn_client", "libsvn_delta", "libsvn_fs_fs",
+    "libsvn_fs_x", "libsvn_ra_svn", "libsvn_repos", "libsvn_subr",
+    "libsvn_wc", "svnadmin", "svnserve", "tests", NULL
+  };
+static const char *corpus_subdirs[] =
+  {
+    "", ".libs/", "private/", "cmdline/", "libsvn_fs_x/", "libsvn_subr/",
+    "cmdline/svntest/", NULL
+  };
+static const char *corpus_files[] =
+  {
+    "cached_data", "changes", "dag", "fs", "hotcopy", "index", "lock",
+    "low_level", "noderevs", "pack", "recovery", "rep-cache", "reps",
+    "revprops", "string_table", "temp_serializer", "transaction", "tree",
+    "util", "verify", NULL
+  };
+static const char *corpus_extensions[] =
+  {
+    ".c", ".h", ".o", ".lo", "-test.c", NULL
+  };
+
+/* Return an array of generated relative paths (const char *), like the
+ * files and directories of a source tree.  Allocate it in POOL.
+ */
+static apr_array_header_t *
+generate_path_corpus(apr_pool_t *pool)
+{
+  apr_array_header_t *paths = apr_array_make(pool, 4096, sizeof(const char *));
+  int d, s, f, e;
+
+  for (d = 0; corpus_dirs[d]; ++d)
+    for (s = 0; corpus_subdirs[s]; ++s)
+      {
+        /* Leave some combinations out to make the tree less regular. */
+        if ((d + s) % 3 == 1)
+          continue;
+
+        APR_ARRAY_PUSH(paths, const char *)
+          = apr_pstrcat(pool, corpus_dirs[d], "/", corpus_subdirs[s],
+                        SVN_VA_NULL);
+
+        for (f = 0; corpus_files[f]; ++f)
+          for (e = 0; corpus_extensions[e]; ++e)
+            if ((d + s + f + e) % 4 != 0)
+              APR_ARRAY_PUSH(paths, const char *)
+                = apr_pstrcat(pool, corpus_dirs[d], "/", corpus_subdirs[s],
+                              corpus_files[f], corpus_extensions[e],
+                              SVN_VA_NULL);
+      }
+
+  return paths;
+}
+
+/* Add all strings in STRINGS to a new string table builder with the given
+ * MEMORY_LIMIT, create the table and verify its contents.  If VERBOSE is
+ * set, show how long building the table took.  Use POOL for allocations.
+ */
+static svn_error_t *
+verify_corpus_table(apr_array_header_t *strings,
+                    apr_size_t memory_limit,
+                    svn_boolean_t verbose,
+                    apr_pool_t *pool)
+{
+  apr_size_t *indexes = apr_palloc(pool, strings->nelts * sizeof(*indexes));
+  apr_time_t start = apr_time_now();
+  string_table_builder_t *builder;
+  string_table_t *table;
+  int i;
+
+  builder = svn_fs_x__string_table_builder_create2(memory_limit, pool);
+  for (i = 0; i < strings->nelts; ++i)
+    indexes[i] = svn_fs_x__string_table_builder_add(builder,
+                   APR_ARRAY_IDX(strings, i, const char *), 0);
+
+  table = svn_fs_x__string_table_create(builder, pool);
+
+  if (verbose)
+    printf("%d strings, memory limit %" APR_SIZE_T_FMT ": %" APR_TIME_T_FMT
+           " usec, size estimate %" APR_SIZE_T_FMT "\n",
+           strings->nelts, memory_limit, apr_time_now() - start,
+           svn_fs_x__string_table_builder_estimate_size(builder));
+
+  SVN_ERR(store_and_load_table(&table, pool));
+
+  for (i = 0; i < strings->nelts; ++i)
+    {
+      apr_size_t len;
+      const char *expected = APR_ARRAY_IDX(strings, i, const char *);
+      const char *string
+        = svn_fs_x__string_table_get(table, indexes[i], &len, pool);
+
+      SVN_TEST_STRING_ASSERT(string, expected);
+      SVN_TEST_ASSERT(len == strlen(expected));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Build string tables from a realistic set of repository paths.  We take
+ * a generated source tree and put it on trunk as well as on a number of
+ * branches, just like the changed paths in a shard would look like.  Run
+ * with --verbose to see the timing.
+ */
+static svn_error_t *
+path_corpus_table(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  enum { BRANCH_COUNT = 40 };
+
+  apr_array_header_t *paths = generate_path_corpus(pool);
+  apr_array_header_t *strings;
+  int i, k;
+
+  SVN_TEST_ASSERT(paths->nelts > 0);
+
+  strings = apr_array_make(pool, paths->nelts * (BRANCH_COUNT + 1),
+                           sizeof(const char *));
+  for (k = 0; k <= BRANCH_COUNT; ++k)
+    {
+      const char *prefix
+        = k ? apr_psprintf(pool, "/branches/1.%d.x/subversion/", k - 1)
+            : "/trunk/subversion/";
+
+      for (i = 0; i < paths->nelts; ++i)
+        APR_ARRAY_PUSH(strings, const char *)
+          = apr_pstrcat(pool, prefix,
+                        APR_ARRAY_IDX(paths, i, const char *),
+                        SVN_VA_NULL);
+    }
+
+  SVN_ERR(verify_corpus_table(strings, 0, opts->verbose, pool));
+  SVN_ERR(verify_corpus_table(strings, 0x10000, opts->verbose, pool));
+
+  return SVN_NO_ERROR;
+}
+
 
 /* ------------------------------------------------------------------------ */
 
@@ -312,6 +454,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "store and load table with large strings only"),
     SVN_TEST_PASS2(store_load_many_strings_table,
                    "store and load string table with many strings"),
+    SVN_TEST_OPTS_PASS(path_corpus_table,
+                       "string table with a generated path corpus"),
     SVN_TEST_NULL
   };
 
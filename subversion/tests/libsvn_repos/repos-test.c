@@ -38,7 +38,9 @@
 #include "svn_config.h"
 #include "svn_props.h"
 #include "svn_sorts.h"
+#include "svn_time.h"
 #include "svn_version.h"
+#include "private/svn_fs_private.h"
 #include "private/svn_repos_private.h"
 #include "private/svn_dep_compat.h"
 
@@ -4418,6 +4420,300 @@ commit_aborted_txn(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Commit a txn based on HEAD of REPOS that sets the contents of FILE
+   to CONTENTS, or deletes FILE if CONTENTS is NULL. */
+static svn_error_t *
+commit_file_change(svn_repos_t *repos,
+                   const char *file,
+                   const char *contents,
+                   apr_pool_t *pool)
+{
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev;
+
+  SVN_ERR(svn_fs_youngest_rev(&youngest_rev, svn_repos_fs(repos), pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, svn_repos_fs(repos), youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  if (contents)
+    SVN_ERR(svn_test__set_file_contents(txn_root, file, contents, pool));
+  else
+    SVN_ERR(svn_fs_delete(txn_root, file, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+  SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(youngest_rev));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+path_index(const svn_test_opts_t *opts,
+           apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev, deleted;
+  apr_array_header_t *revisions;
+  svn_repos_t *copy;
+  const char *copy_path = "test-repo-path-index-copy";
+
+  if (strcmp(opts->fs_type, SVN_FS_TYPE_BDB) == 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "BDB does not support the path index");
+
+  /* Create a filesystem and repository. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-path-index",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* Without an index, there is no information. */
+  SVN_ERR(svn_fs__get_path_revisions(&revisions, fs, "/A", 0, 0,
+                                     pool, pool));
+  SVN_TEST_ASSERT(revisions == NULL);
+
+  /* r1: the greek tree, r2: change A/mu, r3: change iota. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+  SVN_ERR(commit_file_change(repos, "A/mu", "new mu", pool));
+  SVN_ERR(commit_file_change(repos, "iota", "new iota", pool));
+
+  SVN_ERR(svn_repos_build_path_index(repos, NULL, NULL, NULL, NULL, pool));
+
+  /* r4: delete A/D/G/rho, r5: change A/B/lambda.  These get added to
+     the index upon commit. */
+  SVN_ERR(commit_file_change(repos, "A/D/G/rho", NULL, pool));
+  SVN_ERR(commit_file_change(repos, "A/B/lambda", "new lambda", pool));
+
+  SVN_ERR(svn_fs__get_path_revisions(&revisions, fs, "/A/B", 0, 5,
+                                     pool, pool));
+  SVN_TEST_ASSERT(revisions && revisions->nelts == 2);
+  SVN_TEST_ASSERT(APR_ARRAY_IDX(revisions, 0, svn_revnum_t) == 5);
+  SVN_TEST_ASSERT(APR_ARRAY_IDX(revisions, 1, svn_revnum_t) == 1);
+
+  SVN_ERR(svn_fs__get_path_revisions(&revisions, fs, "/A/D/G/rho", 2, 5,
+                                     pool, pool));
+  SVN_TEST_ASSERT(revisions && revisions->nelts == 1);
+  SVN_TEST_ASSERT(APR_ARRAY_IDX(revisions, 0, svn_revnum_t) == 4);
+
+  SVN_ERR(svn_fs__get_path_revisions(&revisions, fs, "A/C", 2, 5,
+                                     pool, pool));
+  SVN_TEST_ASSERT(revisions && revisions->nelts == 0);
+
+  /* Users of the index. */
+  SVN_ERR(svn_repos_deleted_rev(fs, "/A/D/G/rho", 1, 5, &deleted, pool));
+  SVN_TEST_ASSERT(deleted == 4);
+  SVN_ERR(svn_repos_deleted_rev(fs, "/A/mu", 1, 5, &deleted, pool));
+  SVN_TEST_ASSERT(deleted == SVN_INVALID_REVNUM);
+
+  /* Rebuild the index in place and copy it to a hotcopy. */
+  SVN_ERR(svn_repos_build_path_index(repos, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_io_remove_dir2(copy_path, TRUE, NULL, NULL, pool));
+  SVN_ERR(svn_repos_hotcopy3(svn_repos_path(repos, pool), copy_path,
+                             FALSE, FALSE, NULL, NULL, NULL, NULL, pool));
+  svn_test_add_dir_cleanup(copy_path);
+
+  SVN_ERR(svn_repos_open3(&copy, copy_path, NULL, pool, pool));
+  SVN_ERR(svn_fs__get_path_revisions(&revisions, svn_repos_fs(copy), "/A/B",
+                                     0, 5, pool, pool));
+  SVN_TEST_ASSERT(revisions && revisions->nelts == 2);
+  SVN_TEST_ASSERT(APR_ARRAY_IDX(revisions, 0, svn_revnum_t) == 5);
+  SVN_TEST_ASSERT(APR_ARRAY_IDX(revisions, 1, svn_revnum_t) == 1);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set the svn:date of REVISION in FS to DATE. */
+static svn_error_t *
+set_revision_date(svn_fs_t *fs,
+                  svn_revnum_t revision,
+                  apr_time_t date,
+                  apr_pool_t *pool)
+{
+  svn_string_t *value = svn_string_create(svn_time_to_cstring(date, pool),
+                                          pool);
+
+  return svn_error_trace(svn_fs_change_rev_prop2(fs, revision,
+                                                 SVN_PROP_REVISION_DATE,
+                                                 NULL, value, pool));
+}
+
+/* Verify that svn_repos_dated_revision() maps a time just after each
+   second-granular commit date to the respective revision. */
+static svn_error_t *
+check_dated_revisions(svn_repos_t *repos,
+                      apr_time_t base,
+                      svn_revnum_t youngest,
+                      apr_pool_t *pool)
+{
+  svn_revnum_t rev, found;
+
+  for (rev = 1; rev <= youngest; ++rev)
+    {
+      apr_time_t tm = base + apr_time_from_sec(rev * 10 + 5);
+
+      SVN_ERR(svn_repos_dated_revision(&found, repos, tm, pool));
+      SVN_TEST_ASSERT(found == rev);
+    }
+
+  SVN_ERR(svn_repos_dated_revision(&found, repos, base, pool));
+  SVN_TEST_ASSERT(found == 0);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+date_index(const svn_test_opts_t *opts,
+           apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev, rev;
+  svn_fs__date_index_t *index;
+  apr_time_t date;
+  apr_time_t base = apr_time_from_sec(1000000000);
+
+  if (strcmp(opts->fs_type, SVN_FS_TYPE_BDB) == 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "BDB does not support the date index");
+
+  /* Create a filesystem and repository. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-date-index",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* New repositories start with an index covering r0. */
+  SVN_ERR(svn_fs__open_date_index(&index, fs, pool, pool));
+  SVN_TEST_ASSERT(index);
+  SVN_ERR(svn_fs__get_revision_date(&date, index, 0, pool));
+  SVN_TEST_ASSERT(date != SVN_FS__NO_DATE);
+  SVN_ERR(svn_fs__get_revision_date(&date, index, 1, pool));
+  SVN_TEST_ASSERT(date == SVN_FS__NO_DATE);
+
+  /* r1: the greek tree, r2: change A/mu, r3: change iota. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+  SVN_ERR(commit_file_change(repos, "A/mu", "new mu", pool));
+  SVN_ERR(commit_file_change(repos, "iota", "new iota", pool));
+
+  SVN_ERR(svn_fs__open_date_index(&index, fs, pool, pool));
+  SVN_ERR(svn_fs__get_revision_date(&date, index, 3, pool));
+  SVN_TEST_ASSERT(date != SVN_FS__NO_DATE);
+  SVN_ERR(svn_fs__get_revision_date(&date, index, 4, pool));
+  SVN_TEST_ASSERT(date == SVN_FS__NO_DATE);
+
+  /* Changing svn:date updates the index in place. */
+  SVN_ERR(svn_fs_youngest_rev(&youngest_rev, fs, pool));
+  for (rev = 0; rev <= youngest_rev; ++rev)
+    SVN_ERR(set_revision_date(fs, rev, base + apr_time_from_sec(rev * 10),
+                              pool));
+
+  SVN_ERR(svn_fs__open_date_index(&index, fs, pool, pool));
+  SVN_ERR(svn_fs__get_revision_date(&date, index, 2, pool));
+  SVN_TEST_ASSERT(date == base + apr_time_from_sec(20));
+  SVN_ERR(check_dated_revisions(repos, base, youngest_rev, pool));
+
+  /* A revision without svn:date gets marked as such. */
+  SVN_ERR(svn_fs_change_rev_prop2(fs, 3, SVN_PROP_REVISION_DATE, NULL, NULL,
+                                  pool));
+  SVN_ERR(svn_fs__open_date_index(&index, fs, pool, pool));
+  SVN_ERR(svn_fs__get_revision_date(&date, index, 3, pool));
+  SVN_TEST_ASSERT(date == SVN_FS__NO_DATE);
+  SVN_ERR(set_revision_date(fs, 3, base + apr_time_from_sec(30), pool));
+
+  /* Rebuilding yields the same contents. */
+  SVN_ERR(svn_repos_build_date_index(repos, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs__open_date_index(&index, fs, pool, pool));
+  for (rev = 0; rev <= youngest_rev; ++rev)
+    {
+      SVN_ERR(svn_fs__get_revision_date(&date, index, rev, pool));
+      SVN_TEST_ASSERT(date == base + apr_time_from_sec(rev * 10));
+    }
+  SVN_ERR(svn_fs__get_revision_date(&date, index, rev, pool));
+  SVN_TEST_ASSERT(date == SVN_FS__NO_DATE);
+  SVN_ERR(check_dated_revisions(repos, base, youngest_rev, pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+hook_queue(const svn_test_opts_t *opts,
+           apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  const char *hook;
+  const char *log_path;
+  const char *spool_path;
+  svn_stringbuf_t *log;
+  apr_hash_t *dirents;
+  int i;
+
+#ifdef WIN32
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "test uses a shell script as hook");
+#endif
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-hook-queue", opts,
+                                 pool));
+
+  /* Pretend to be a multi-threaded server. */
+  svn_repos__hook_queue_allow_background();
+
+  /* Let the post-commit hook record the revision numbers in LOG_PATH. */
+  SVN_ERR(svn_dirent_get_absolute(&log_path,
+                                  svn_dirent_join(svn_repos_path(repos, pool),
+                                                  "hook-log", pool),
+                                  pool));
+  hook = svn_repos_post_commit_hook(repos, pool);
+  SVN_ERR(svn_io_file_create(hook,
+                             apr_psprintf(pool,
+                                          "#!/bin/sh" APR_EOL_STR
+                                          "echo $2 >> '%s'" APR_EOL_STR,
+                                          log_path),
+                             pool));
+  SVN_ERR(svn_io_set_file_executable(hook, TRUE, FALSE, pool));
+
+  SVN_ERR(svn_io_file_create(svn_dirent_join(svn_repos_conf_dir(repos, pool),
+                                             "hooks-queue", pool),
+                             "[queue]" APR_EOL_STR
+                             "enabled = true" APR_EOL_STR,
+                             pool));
+
+  for (i = 1; i <= 5; ++i)
+    {
+      SVN_ERR(svn_repos_fs_begin_txn_for_commit2(&txn, repos, i - 1,
+                                                 apr_hash_make(pool), pool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+      SVN_ERR(svn_fs_make_dir(root, apr_psprintf(pool, "/dir%d", i), pool));
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &rev, txn, pool));
+      SVN_TEST_ASSERT(rev == i);
+    }
+
+  /* All hooks must have run, in commit order, and left no trace in the
+     spool directory. */
+  SVN_ERR(svn_repos__hook_queue_wait(repos, pool));
+  SVN_ERR(svn_stringbuf_from_file2(&log, log_path, pool));
+  SVN_TEST_STRING_ASSERT(log->data, "1\n2\n3\n4\n5\n");
+
+  spool_path = svn_dirent_join(svn_repos_db_env(repos, pool), "hooks-queue",
+                               pool);
+  SVN_ERR(svn_io_get_dirents3(&dirents, spool_path, TRUE, pool, pool));
+  SVN_TEST_ASSERT(apr_hash_count(dirents) == 2);
+  SVN_TEST_ASSERT(svn_hash_gets(dirents, "lock"));
+  SVN_TEST_ASSERT(svn_hash_gets(dirents, "sequence"));
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 list_callback(const char *path,
               svn_dirent_t *dirent,
@@ -4537,6 +4833,12 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "optional authz wildcard performance test"),
     SVN_TEST_OPTS_PASS(test_list,
                        "test svn_repos_list"),
+    SVN_TEST_OPTS_PASS(path_index,
+                       "test the path index"),
+    SVN_TEST_OPTS_PASS(date_index,
+                       "test the date index"),
+    SVN_TEST_OPTS_PASS(hook_queue,
+                       "test the background hook queue"),
     SVN_TEST_NULL
   };
 
@@ -31,6 +31,7 @@
 #include "svn_pools.h"
 #include "svn_string.h"
 #include "svn_io.h"
+#include "svn_sorts.h"
 #include "private/svn_skel.h"
 #include "private/svn_dep_compat.h"
 #include "private/svn_io_private.h"
@@ -878,6 +879,92 @@ aligned_seek_test(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_file_read_batch(apr_pool_t *pool)
+{
+  apr_size_t i;
+  const char *tmp_dir;
+  const char *tmp_file;
+  apr_file_t *f;
+  svn_stringbuf_t *contents;
+  apr_off_t offset;
+  char c;
+  svn_io__read_request_t requests[40];
+  const apr_size_t file_size = 100000;
+  const apr_size_t prime = 78427;
+  const int count = sizeof(requests) / sizeof(requests[0]);
+
+  /* create a temp folder & schedule it for automatic cleanup */
+  SVN_ERR(svn_test_make_sandbox_dir(&tmp_dir, "read_batch_tmp", pool));
+
+  contents = svn_stringbuf_create_ensure(file_size, pool);
+  for (i = 0; i < file_size; ++i)
+    svn_stringbuf_appendbyte(contents, (char)rand());
+
+  SVN_ERR(svn_io_write_unique(&tmp_file, tmp_dir, contents->data,
+                              contents->len,
+                              svn_io_file_del_on_pool_cleanup, pool));
+
+  /* Bring the file into some buffered state, which must not be disturbed
+   * by the batch reads. */
+  SVN_ERR(svn_io_file_open(&f, tmp_file, APR_READ | APR_BUFFERED,
+                           APR_OS_DEFAULT, pool));
+  SVN_ERR(aligned_read_at(f, contents, 0x1000, 12345, TRUE, pool));
+
+  /* "random" requests of varying sizes, some of them overlapping */
+  for (i = 0; i < count - 3; ++i)
+    {
+      requests[i].offset = (i * prime) % file_size;
+      requests[i].size = (i * 997) % 20000;
+      requests[i].buffer = apr_palloc(pool, requests[i].size + 1);
+    }
+
+  /* special cases: crossing EOF, beyond EOF and empty */
+  requests[count - 3].offset = file_size - 10;
+  requests[count - 3].size = 100;
+  requests[count - 3].buffer = apr_palloc(pool, 100);
+  requests[count - 2].offset = file_size + 10;
+  requests[count - 2].size = 100;
+  requests[count - 2].buffer = apr_palloc(pool, 100);
+  requests[count - 1].offset = 42;
+  requests[count - 1].size = 0;
+  requests[count - 1].buffer = NULL;
+
+  SVN_ERR(svn_io__file_read_batch(f, requests, count, pool));
+
+  for (i = 0; i < count - 3; ++i)
+    {
+      SVN_TEST_ASSERT(requests[i].bytes_read
+                      == MIN(requests[i].size,
+                             file_size - (apr_size_t)requests[i].offset));
+      SVN_TEST_ASSERT(memcmp(requests[i].buffer,
+                             contents->data + requests[i].offset,
+                             requests[i].bytes_read) == 0);
+    }
+
+  SVN_TEST_INT_ASSERT(requests[count - 3].bytes_read, 10);
+  SVN_TEST_ASSERT(memcmp(requests[count - 3].buffer,
+                         contents->data + file_size - 10, 10) == 0);
+  SVN_TEST_INT_ASSERT(requests[count - 2].bytes_read, 0);
+  SVN_TEST_INT_ASSERT(requests[count - 1].bytes_read, 0);
+
+  /* File pointer and buffered data must be unchanged. */
+  SVN_ERR(svn_io_file_get_offset(&offset, f, pool));
+  SVN_TEST_INT_ASSERT(offset, 12346);
+  SVN_ERR(svn_io_file_getc(&c, f, pool));
+  SVN_TEST_ASSERT(c == contents->data[12346]);
+
+  /* Prefetching is only a hint but must not fail or move the pointer,
+   * not even for ranges beyond EOF. */
+  svn_io__file_prefetch(f, 0, file_size + 0x10000);
+  SVN_ERR(svn_io_file_get_offset(&offset, f, pool));
+  SVN_TEST_INT_ASSERT(offset, 12347);
+
+  SVN_ERR(svn_io_file_close(f, pool));
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 ignore_enoent(apr_pool_t *pool)
 {
@@ -1184,6 +1271,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test svn_io_open_uniquely_named()"),
     SVN_TEST_PASS2(test_apr_trunc_workaround,
                    "test workaround for APR in svn_io_file_trunc"),
+    SVN_TEST_PASS2(test_file_read_batch,
+                   "test svn_io__file_read_batch()"),
     SVN_TEST_NULL
   };
 
@@ -0,0 +1,107 @@
+/*
+ * packed-data-scalar-test.c:  tests for the portable svn_packed__* decoder
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* Platforms without fast unaligned little-endian loads don't get the
+ * word-wise decoder.  Compile the packed data code with just the
+ * portable decoder, such that it gets tested everywhere. */
+#define SVN__PACKED_DATA_SCALAR
+#include "../../libsvn_subr/packed_data.c"
+
+#include "../svn_test.h"
+
+#ifdef SVN__PACKED_DATA_WORDWISE
+#error "SVN__PACKED_DATA_SCALAR must disable the word-wise decoder"
+#endif
+
+/* Return a pseudo-random number based on *SEED, covering all 7b/8b
+ * encoding lengths, and update *SEED.
+ */
+static apr_uint64_t
+test_value(apr_uint64_t *seed)
+{
+  apr_uint64_t value;
+  int bits;
+
+  *seed = *seed * APR_UINT64_C(6364136223846793005)
+        + APR_UINT64_C(1442695040888963407);
+  value = *seed ^ (*seed >> 29);
+
+  bits = (int)((*seed >> 58) + 1);
+  return bits >= 64 ? value : value & ((APR_UINT64_C(1) << bits) - 1);
+}
+
+static svn_error_t *
+test_scalar_decoder(apr_pool_t *pool)
+{
+  enum { COUNT = 1000 };
+  apr_uint64_t values[COUNT];
+  apr_uint64_t read[COUNT];
+  apr_uint64_t seed = 0;
+  svn_stringbuf_t *buffer = svn_stringbuf_create_empty(pool);
+  svn_stream_t *stream;
+  svn_packed__data_root_t *root = svn_packed__data_create_root(pool);
+  svn_packed__int_stream_t *plain
+    = svn_packed__create_int_stream(root, FALSE, FALSE);
+  svn_packed__int_stream_t *deltified
+    = svn_packed__create_int_stream(root, TRUE, TRUE);
+  apr_size_t i;
+
+  for (i = 0; i < COUNT; ++i)
+    {
+      values[i] = test_value(&seed);
+      svn_packed__add_uint(plain, values[i]);
+      svn_packed__add_uint(deltified, values[i]);
+    }
+
+  stream = svn_stream_from_stringbuf(buffer, pool);
+  SVN_ERR(svn_packed__data_write(stream, root, pool));
+  stream = svn_stream_from_stringbuf(buffer, pool);
+  SVN_ERR(svn_packed__data_read(&root, stream, pool, pool));
+
+  /* Far more than 16 bytes of packed data must be decoded in one go. */
+  plain = svn_packed__first_int_stream(root);
+  SVN_TEST_ASSERT(svn_packed__get_uints(plain, read, COUNT) == COUNT);
+  for (i = 0; i < COUNT; ++i)
+    SVN_TEST_ASSERT(read[i] == values[i]);
+
+  /* The same through the buffer refill. */
+  deltified = svn_packed__next_int_stream(plain);
+  for (i = 0; i < COUNT; ++i)
+    SVN_TEST_ASSERT(svn_packed__get_uint(deltified) == values[i]);
+
+  return SVN_NO_ERROR;
+}
+
+/* An array of all test functions */
+
+static int max_threads = 1;
+
+static struct svn_test_descriptor_t test_funcs[] =
+  {
+    SVN_TEST_NULL,
+    SVN_TEST_PASS2(test_scalar_decoder,
+                   "test the portable integer stream decoder"),
+    SVN_TEST_NULL
+  };
+
+SVN_TEST_MAIN
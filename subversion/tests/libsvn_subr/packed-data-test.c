@@ -36,6 +36,7 @@
 
 #include "svn_error.h"
 #include "svn_string.h"   /* This includes <apr_*.h> */
+#include "svn_sorts.h"
 #include "private/svn_packed_data.h"
 
 /* Take the WRITE_ROOT, serialize its contents, parse it again into a new
@@ -191,6 +192,113 @@ test_int_stream(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Return a pseudo-random number based on *SEED, covering all 7b/8b
+ * encoding lengths with a bias towards short ones, and update *SEED.
+ */
+static apr_uint64_t
+bulk_test_value(apr_uint64_t *seed)
+{
+  apr_uint64_t value;
+  int bits;
+
+  *seed = *seed * APR_UINT64_C(6364136223846793005)
+        + APR_UINT64_C(1442695040888963407);
+  value = *seed ^ (*seed >> 29);
+
+  /* 50% single byte values, the rest evenly spread over all lengths */
+  bits = (value & 1) ? 7 : (int)((*seed >> 58) + 1);
+  return bits >= 64 ? value : value & ((APR_UINT64_C(1) << bits) - 1);
+}
+
+/* Check that svn_packed__get_uints returns the same COUNT VALUES in
+ * STREAM as svn_packed__get_uint would, when reading them in chunks of
+ * varying sizes.  Reading beyond the end of the stream must return 0s.
+ */
+static svn_error_t *
+verify_bulk_read(svn_packed__int_stream_t *stream,
+                 const apr_uint64_t *values,
+                 apr_size_t count,
+                 apr_pool_t *pool)
+{
+  apr_uint64_t *read = apr_pcalloc(pool, (count + 3) * sizeof(*read));
+  apr_size_t i = 0;
+  apr_size_t chunk = 0;
+
+  SVN_TEST_ASSERT(svn_packed__int_count(stream) == count);
+
+  /* start with a single value to have pre-fetched values in the buffer */
+  if (count)
+    read[i++] = svn_packed__get_uint(stream);
+
+  while (i < count)
+    {
+      apr_size_t to_read = MIN(count - i, chunk % 97 + 1);
+      SVN_TEST_ASSERT(svn_packed__get_uints(stream, read + i, to_read)
+                      == to_read);
+
+      i += to_read;
+      chunk = chunk * 7 + 13;
+    }
+
+  for (i = 0; i < count; ++i)
+    SVN_TEST_ASSERT(read[i] == values[i]);
+
+  /* reading beyond eos should return 0 values */
+  read[0] = read[1] = read[2] = 1;
+  SVN_TEST_ASSERT(svn_packed__get_uints(stream, read, 3) == 0);
+  SVN_TEST_ASSERT(read[0] == 0 && read[1] == 0 && read[2] == 0);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_bulk_read(apr_pool_t *pool)
+{
+  enum { COUNT = 5000, SUBSTREAMS = 3 };
+  apr_uint64_t *values = apr_palloc(pool, COUNT * sizeof(*values));
+  apr_uint64_t seed = 0;
+  int diff, is_signed;
+  apr_size_t i;
+
+  svn_packed__data_root_t *root = svn_packed__data_create_root(pool);
+  svn_packed__int_stream_t *parent;
+
+  for (i = 0; i < COUNT; ++i)
+    values[i] = bulk_test_value(&seed);
+
+  /* plain, deltified, signed and signed deltified top-level streams */
+  for (diff = 0; diff < 2; ++diff)
+    for (is_signed = 0; is_signed < 2; ++is_signed)
+      {
+        svn_packed__int_stream_t *stream
+          = svn_packed__create_int_stream(root, diff, is_signed);
+        for (i = 0; i < COUNT; ++i)
+          svn_packed__add_uint(stream, values[i]);
+      }
+
+  /* rows of values spread over sub-streams of different types */
+  parent = svn_packed__create_int_stream(root, FALSE, FALSE);
+  svn_packed__create_int_substream(parent, FALSE, FALSE);
+  svn_packed__create_int_substream(parent, TRUE, FALSE);
+  svn_packed__create_int_substream(parent, TRUE, TRUE);
+  for (i = 0; i < COUNT - COUNT % SUBSTREAMS; ++i)
+    svn_packed__add_uint(parent, values[i]);
+
+  SVN_ERR(get_read_root(&root, root, pool));
+
+  parent = svn_packed__first_int_stream(root);
+  for (i = 0; i < 4; ++i)
+    {
+      SVN_ERR(verify_bulk_read(parent, values, COUNT, pool));
+      parent = svn_packed__next_int_stream(parent);
+    }
+
+  SVN_ERR(verify_bulk_read(parent, values, COUNT - COUNT % SUBSTREAMS,
+                           pool));
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 test_byte_stream(apr_pool_t *pool)
 {
@@ -566,6 +674,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test a single uint stream"),
     SVN_TEST_PASS2(test_int_stream,
                    "test a single int stream"),
+    SVN_TEST_PASS2(test_bulk_read,
+                   "test bulk reading integer streams"),
     SVN_TEST_PASS2(test_byte_stream,
                    "test a single bytes stream"),
     SVN_TEST_PASS2(test_empty_structure,
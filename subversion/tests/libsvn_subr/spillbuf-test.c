@@ -22,6 +22,7 @@
  */
 
 #include "svn_types.h"
+#include "svn_io.h"
 
 #include "private/svn_subr_private.h"
 
@@ -102,6 +103,14 @@ test_spillbuf_basic_spill_all(apr_pool_t *pool)
   return test_spillbuf__basic(pool, len, buf);
 }
 
+static svn_error_t *
+test_spillbuf_basic_mapped(apr_pool_t *pool)
+{
+  apr_size_t len = strlen(basic_data);  /* Don't include basic_data's NUL  */
+  svn_spillbuf_t *buf = svn_spillbuf__create_mapped(len, 10 * len, pool);
+  return test_spillbuf__basic(pool, len, buf);
+}
+
 static svn_error_t *
 read_callback(svn_boolean_t *stop,
               void *baton,
@@ -165,6 +174,16 @@ test_spillbuf_callback_spill_all(apr_pool_t *pool)
   return test_spillbuf__callback(pool, buf);
 }
 
+static svn_error_t *
+test_spillbuf_callback_mapped(apr_pool_t *pool)
+{
+  svn_spillbuf_t *buf = svn_spillbuf__create_mapped(
+                          sizeof(basic_data) /* blocksize */,
+                          10 * sizeof(basic_data) /* maxsize */,
+                          pool);
+  return test_spillbuf__callback(pool, buf);
+}
+
 static svn_error_t *
 test_spillbuf__file(apr_pool_t *pool, apr_size_t altsize, svn_spillbuf_t *buf)
 {
@@ -253,6 +272,17 @@ test_spillbuf_file_spill_all(apr_pool_t *pool)
   return test_spillbuf__file(pool, altsize, buf);
 }
 
+static svn_error_t *
+test_spillbuf_file_mapped(apr_pool_t *pool)
+{
+  apr_size_t altsize = sizeof(basic_data) + 2;
+  svn_spillbuf_t *buf = svn_spillbuf__create_mapped(
+                          altsize /* blocksize */,
+                          2 * sizeof(basic_data) /* maxsize */,
+                          pool);
+  return test_spillbuf__file(pool, altsize, buf);
+}
+
 static svn_error_t *
 test_spillbuf__interleaving(apr_pool_t *pool, svn_spillbuf_t* buf)
 {
@@ -292,6 +322,113 @@ test_spillbuf_interleaving(apr_pool_t *pool)
   return test_spillbuf__interleaving(pool, buf);
 }
 
+static svn_error_t *
+test_spillbuf_interleaving_mapped(apr_pool_t *pool)
+{
+  svn_spillbuf_t *buf = svn_spillbuf__create_mapped(8 /* blocksize */,
+                                                    15 /* maxsize */,
+                                                    pool);
+  return test_spillbuf__interleaving(pool, buf);
+}
+
+static svn_error_t *
+test_spillbuf_mapped_extents(apr_pool_t *pool)
+{
+  /* Spill a few MB, i.e. multiple mapping extents, twice in a row to
+     check the extent boundaries as well as the re-use of the storage. */
+  enum { BLOCKSIZE = 0x10000, CHUNK = 1000, TOTAL = 3000 * CHUNK };
+  svn_spillbuf_t *buf = svn_spillbuf__create_mapped(BLOCKSIZE, BLOCKSIZE,
+                                                    pool);
+  char *chunk = apr_palloc(pool, CHUNK);
+  int round, i;
+
+  for (round = 0; round < 2; ++round)
+    {
+      apr_size_t total = 0;
+
+      for (i = 0; i < TOTAL / CHUNK; ++i)
+        {
+          memset(chunk, 'a' + (i + round) % 26, CHUNK);
+          SVN_ERR(svn_spillbuf__write(buf, chunk, CHUNK, pool));
+        }
+
+      SVN_TEST_ASSERT(svn_spillbuf__get_size(buf) == TOTAL);
+
+      while (TRUE)
+        {
+          const char *readptr;
+          apr_size_t readlen, k;
+
+          SVN_ERR(svn_spillbuf__read(&readptr, &readlen, buf, pool));
+          if (readptr == NULL)
+            break;
+
+          SVN_TEST_ASSERT(readlen > 0 && readlen <= BLOCKSIZE);
+          for (k = 0; k < readlen; ++k, ++total)
+            SVN_TEST_ASSERT(readptr[k]
+                            == 'a' + (int)(total / CHUNK + round) % 26);
+        }
+
+      SVN_TEST_ASSERT(total == TOTAL);
+      SVN_TEST_ASSERT(svn_spillbuf__get_size(buf) == 0);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_spillbuf_mapped_streaming(apr_pool_t *pool)
+{
+  /* Keep a backlog of about 2 MB that never drains while passing 32 MB
+     through the buffer.  The storage must not grow with the total. */
+  enum { BLOCKSIZE = 0x10000, BACKLOG = 0x200000, TOTAL = 0x2000000 };
+  svn_spillbuf_t *buf = svn_spillbuf__create_mapped(BLOCKSIZE, BLOCKSIZE,
+                                                    pool);
+  char *chunk = apr_palloc(pool, BLOCKSIZE);
+  apr_size_t written = 0, total = 0;
+  apr_off_t max_file_size = 0;
+
+#if !APR_HAS_MMAP
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "mapped spill storage not supported");
+#endif
+
+  while (total < TOTAL)
+    {
+      const char *readptr;
+      apr_size_t readlen, k;
+      apr_file_t *file;
+
+      while (written < total + BACKLOG)
+        {
+          for (k = 0; k < BLOCKSIZE; ++k)
+            chunk[k] = (char)((written + k) % 251);
+
+          SVN_ERR(svn_spillbuf__write(buf, chunk, BLOCKSIZE, pool));
+          written += BLOCKSIZE;
+        }
+
+      file = svn_spillbuf__get_file(buf);
+      if (file)
+        {
+          apr_finfo_t finfo;
+          SVN_ERR(svn_io_file_info_get(&finfo, APR_FINFO_SIZE, file, pool));
+          if (finfo.size > max_file_size)
+            max_file_size = finfo.size;
+        }
+
+      SVN_ERR(svn_spillbuf__read(&readptr, &readlen, buf, pool));
+      SVN_TEST_ASSERT(readptr != NULL);
+      for (k = 0; k < readlen; ++k, ++total)
+        SVN_TEST_ASSERT(readptr[k] == (char)(total % 251));
+    }
+
+  SVN_TEST_ASSERT(svn_spillbuf__get_size(buf) > 0);
+  SVN_TEST_ASSERT(max_file_size <= 2 * BACKLOG);
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 test_spillbuf_interleaving_spill_all(apr_pool_t *pool)
 {
@@ -589,6 +726,18 @@ static struct svn_test_descriptor_t test_funcs[] =
     SVN_TEST_PASS2(test_spillbuf_file_attrs, "check spill file properties"),
     SVN_TEST_PASS2(test_spillbuf_file_attrs_spill_all,
                    "check spill file properties (spill-all-data)"),
+    SVN_TEST_PASS2(test_spillbuf_basic_mapped,
+                   "basic spill buffer test (mapped)"),
+    SVN_TEST_PASS2(test_spillbuf_callback_mapped,
+                   "spill buffer read callback (mapped)"),
+    SVN_TEST_PASS2(test_spillbuf_file_mapped,
+                   "spill buffer file test (mapped)"),
+    SVN_TEST_PASS2(test_spillbuf_interleaving_mapped,
+                   "interleaving reads and writes (mapped)"),
+    SVN_TEST_PASS2(test_spillbuf_mapped_extents,
+                   "spill across mapping extents (mapped)"),
+    SVN_TEST_PASS2(test_spillbuf_mapped_streaming,
+                   "storage re-use while streaming (mapped)"),
     SVN_TEST_NULL
   };
 
@@ -1000,6 +1000,94 @@ test_stream_readline_file_crlf(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Write the test data in VEC / NVEC to STREAM in two gathering writes
+ * and close it. */
+static svn_error_t *
+writev_twice(svn_stream_t *stream,
+             const struct iovec *vec,
+             int nvec)
+{
+  SVN_ERR(svn_stream_writev(stream, vec, nvec));
+  SVN_ERR(svn_stream_writev(stream, vec, nvec));
+  return svn_error_trace(svn_stream_close(stream));
+}
+
+static svn_error_t *
+test_stream_writev(apr_pool_t *pool)
+{
+  struct iovec vec[4];
+  svn_stringbuf_t *large = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *expected = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *actual;
+  svn_checksum_t *checksum, *expected_checksum;
+  svn_stream_t *stream;
+  const char *path;
+  int sizes[2] = { 10, 20000 };
+  int i, k;
+
+  for (k = 0; k < 2; ++k)
+    {
+      /* Small or large payload, with an empty buffer in between. */
+      svn_stringbuf_setempty(large);
+      for (i = 0; i < sizes[k]; ++i)
+        svn_stringbuf_appendbyte(large, (char)('a' + i % 26));
+
+      vec[0].iov_base = (void *)"header: ";
+      vec[0].iov_len = 8;
+      vec[1].iov_base = (void *)"";
+      vec[1].iov_len = 0;
+      vec[2].iov_base = large->data;
+      vec[2].iov_len = large->len;
+      vec[3].iov_base = (void *)"\n";
+      vec[3].iov_len = 1;
+
+      svn_stringbuf_setempty(expected);
+      for (i = 0; i < 2; ++i)
+        {
+          svn_stringbuf_appendcstr(expected, "header: ");
+          svn_stringbuf_appendstr(expected, large);
+          svn_stringbuf_appendbyte(expected, '\n');
+        }
+
+      /* Fallback to the write handler. */
+      actual = svn_stringbuf_create_empty(pool);
+      SVN_ERR(writev_twice(svn_stream_from_stringbuf(actual, pool), vec, 4));
+      SVN_TEST_STRING_ASSERT(actual->data, expected->data);
+
+      /* File stream. */
+      SVN_ERR(svn_stream_open_unique(&stream, &path, NULL,
+                                     svn_io_file_del_on_pool_cleanup,
+                                     pool, pool));
+      SVN_ERR(writev_twice(stream, vec, 4));
+      SVN_ERR(svn_stringbuf_from_file2(&actual, path, pool));
+      SVN_TEST_STRING_ASSERT(actual->data, expected->data);
+
+      /* Checksumming stream on top of a disowned stream. */
+      actual = svn_stringbuf_create_empty(pool);
+      stream = svn_stream_from_stringbuf(actual, pool);
+      stream = svn_stream_checksummed2(svn_stream_disown(stream, pool),
+                                       NULL, &checksum, svn_checksum_md5,
+                                       FALSE, pool);
+      SVN_ERR(writev_twice(stream, vec, 4));
+      SVN_ERR(svn_checksum(&expected_checksum, svn_checksum_md5,
+                           expected->data, expected->len, pool));
+      SVN_TEST_STRING_ASSERT(actual->data, expected->data);
+      SVN_TEST_ASSERT(svn_checksum_match(checksum, expected_checksum));
+
+      /* Compressed stream round-trip. */
+      actual = svn_stringbuf_create_empty(pool);
+      SVN_ERR(writev_twice(svn_stream_compressed(
+                             svn_stream_from_stringbuf(actual, pool), pool),
+                           vec, 4));
+      stream = svn_stream_compressed(svn_stream_from_stringbuf(actual, pool),
+                                     pool);
+      SVN_ERR(svn_stringbuf_from_stream(&actual, stream, 0, pool));
+      SVN_TEST_STRING_ASSERT(actual->data, expected->data);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 1;
@@ -1037,6 +1125,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test reading LF-terminated lines from file"),
     SVN_TEST_PASS2(test_stream_readline_file_crlf,
                    "test reading CRLF-terminated lines from file"),
+    SVN_TEST_PASS2(test_stream_writev,
+                   "test svn_stream_writev"),
     SVN_TEST_NULL
   };
 
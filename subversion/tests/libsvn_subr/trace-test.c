@@ -0,0 +1,217 @@
+/*
+ * trace-test.c:  tests for the tracing and counters subsystem
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include <apr_thread_proc.h>
+
+#include "svn_io.h"
+#include "svn_string.h"
+
+#include "private/svn_trace.h"
+
+#include "../svn_test.h"
+
+SVN_TRACE__PROBE(counter_probe, "test.counter");
+SVN_TRACE__PROBE(span_probe, "test.span");
+SVN_TRACE__PROBE(thread_probe, "test.thread");
+
+/* Return the trace data in FORMAT as a string allocated in POOL. */
+static svn_error_t *
+get_trace(const char **result,
+          svn_trace__format_t format,
+          apr_pool_t *pool)
+{
+  svn_stringbuf_t *buffer = svn_stringbuf_create_empty(pool);
+  SVN_ERR(svn_trace__write(svn_stream_from_stringbuf(buffer, pool), format,
+                           pool));
+  *result = buffer->data;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_counters(apr_pool_t *pool)
+{
+  const char *trace;
+
+  SVN_ERR(svn_trace__enable(TRUE));
+  SVN_ERR(svn_trace__reset());
+
+  SVN_TRACE__COUNT(counter_probe, 2);
+  SVN_TRACE__COUNT(counter_probe, 3);
+
+  /* disabled probes don't count */
+  SVN_ERR(svn_trace__enable(FALSE));
+  SVN_TEST_ASSERT(!svn_trace__enabled());
+  SVN_TRACE__COUNT(counter_probe, 100);
+
+  SVN_ERR(get_trace(&trace, svn_trace__format_json, pool));
+  SVN_TEST_ASSERT(strstr(trace,
+                         "{\"name\":\"test.counter\",\"count\":5,\"usec\":0}"));
+
+  /* reset clears all counters */
+  SVN_ERR(svn_trace__reset());
+  SVN_ERR(get_trace(&trace, svn_trace__format_json, pool));
+  SVN_TEST_ASSERT(strstr(trace,
+                         "{\"name\":\"test.counter\",\"count\":0,\"usec\":0}"));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_spans(apr_pool_t *pool)
+{
+  const char *trace;
+  apr_time_t start;
+
+  SVN_ERR(svn_trace__enable(TRUE));
+  SVN_ERR(svn_trace__reset());
+
+  start = SVN_TRACE__SPAN_START();
+  SVN_TEST_ASSERT(start != 0);
+  SVN_TRACE__SPAN_END(span_probe, start);
+  SVN_TRACE__SPAN_END(span_probe, start);
+
+  /* spans starting while tracing was disabled get ignored */
+  SVN_ERR(svn_trace__enable(FALSE));
+  start = SVN_TRACE__SPAN_START();
+  SVN_TEST_ASSERT(start == 0);
+  SVN_TRACE__SPAN_END(span_probe, start);
+
+  SVN_ERR(get_trace(&trace, svn_trace__format_json, pool));
+  SVN_TEST_ASSERT(strstr(trace, "{\"name\":\"test.span\",\"count\":2,"));
+
+  SVN_ERR(get_trace(&trace, svn_trace__format_chrome, pool));
+  SVN_TEST_ASSERT(strstr(trace, "{\"traceEvents\":[") == trace);
+  SVN_TEST_ASSERT(strstr(trace, "{\"name\":\"test.span\",\"cat\":\"svn\","
+                                "\"ph\":\"X\""));
+  SVN_TEST_ASSERT(strstr(trace, "{\"name\":\"test.span\",\"cat\":\"svn\","
+                                "\"ph\":\"C\""));
+
+  SVN_ERR(get_trace(&trace, svn_trace__format_prometheus, pool));
+  SVN_TEST_ASSERT(strstr(trace, "# TYPE svn_trace_count_total counter\n"));
+  SVN_TEST_ASSERT(strstr(trace,
+                         "\nsvn_trace_count_total{probe=\"test.span\"} 2\n"));
+  SVN_TEST_ASSERT(strstr(trace,
+                         "\nsvn_trace_seconds_total{probe=\"test.span\"} "));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_parse_format(apr_pool_t *pool)
+{
+  svn_trace__format_t format;
+
+  SVN_ERR(svn_trace__parse_format(&format, "json"));
+  SVN_TEST_ASSERT(format == svn_trace__format_json);
+  SVN_ERR(svn_trace__parse_format(&format, "chrome"));
+  SVN_TEST_ASSERT(format == svn_trace__format_chrome);
+  SVN_ERR(svn_trace__parse_format(&format, "prometheus"));
+  SVN_TEST_ASSERT(format == svn_trace__format_prometheus);
+  SVN_TEST_ASSERT_ERROR(svn_trace__parse_format(&format, "xml"),
+                        SVN_ERR_INCORRECT_PARAMS);
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+enum { THREAD_COUNT = 8, COUNTS_PER_THREAD = 10000 };
+
+static void *
+APR_THREAD_FUNC thread_func(apr_thread_t *tid, void *data)
+{
+  int i;
+  for (i = 0; i < COUNTS_PER_THREAD; ++i)
+    SVN_TRACE__COUNT(thread_probe, 1);
+
+  apr_thread_exit(tid, APR_SUCCESS);
+  return NULL;
+}
+
+#define APR_ERR(expr)                           \
+  do {                                          \
+    apr_status_t status = (expr);               \
+    if (status)                                 \
+      return svn_error_wrap_apr(status, NULL);  \
+  } while (0)
+
+#endif
+
+static svn_error_t *
+test_threads(apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  /* Counters are per thread and must add up without any losses. */
+  apr_thread_t *threads[THREAD_COUNT];
+  const char *trace;
+  int i;
+
+  SVN_ERR(svn_trace__enable(TRUE));
+  SVN_ERR(svn_trace__reset());
+
+  for (i = 0; i < THREAD_COUNT; ++i)
+    APR_ERR(apr_thread_create(&threads[i], NULL, thread_func, NULL, pool));
+
+  for (i = 0; i < THREAD_COUNT; ++i)
+    {
+      apr_status_t retval;
+      APR_ERR(apr_thread_join(&retval, threads[i]));
+      APR_ERR(retval);
+    }
+
+  SVN_ERR(svn_trace__enable(FALSE));
+  SVN_ERR(get_trace(&trace, svn_trace__format_json, pool));
+  SVN_TEST_ASSERT(strstr(trace, apr_psprintf(pool,
+                                             "{\"name\":\"test.thread\","
+                                             "\"count\":%d,",
+                                             THREAD_COUNT
+                                             * COUNTS_PER_THREAD)));
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+
+/* The test table.  */
+
+static int max_threads = 1;
+
+static struct svn_test_descriptor_t test_funcs[] =
+  {
+    SVN_TEST_NULL,
+    SVN_TEST_PASS2(test_counters,
+                   "test trace counters"),
+    SVN_TEST_PASS2(test_spans,
+                   "test trace spans"),
+    SVN_TEST_PASS2(test_parse_format,
+                   "test parsing trace formats"),
+    SVN_TEST_SKIP2(test_threads,
+                   ! APR_HAS_THREADS,
+                   "test trace counters in multiple threads"),
+    SVN_TEST_NULL
+  };
+
+SVN_TEST_MAIN
@@ -0,0 +1,254 @@
+/*
+ * metrics-test.c:  tests for the svnserve metrics collector
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include <apr_strings.h>
+
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_ra_svn.h"
+#include "svn_string.h"
+
+#include "private/svn_ra_svn_private.h"
+
+#include "../svn_test.h"
+#include "../../svnserve/metrics.h"
+
+/* The commands sent to the test connection.  "outer" handles "inner"
+ * as a nested command, which resets the per-command I/O limits just like
+ * an editor drive does. */
+static const char commands[]
+  = "( outer ( ) ) ( inner ( ) ) ( fail ( ) ) ";
+
+/* Return the contents of METRICS as a string allocated in POOL. */
+static svn_error_t *
+get_metrics(const char **result,
+            metrics_t *metrics,
+            apr_pool_t *pool)
+{
+  svn_stringbuf_t *buffer = svn_stringbuf_create_empty(pool);
+  SVN_ERR(metrics__write(metrics, svn_stream_from_stringbuf(buffer, pool),
+                         pool));
+  *result = buffer->data;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *VALUE to the value of the sample NAME in the metrics OUTPUT.
+ * Use POOL for temporary allocations. */
+static svn_error_t *
+get_sample(apr_uint64_t *value,
+           const char *output,
+           const char *name,
+           apr_pool_t *pool)
+{
+  const char *line = strstr(output, apr_pstrcat(pool, "\n", name, " ",
+                                                SVN_VA_NULL));
+  if (line == NULL)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "Sample '%s' not found", name);
+
+  *value = (apr_uint64_t)apr_strtoi64(line + strlen(name) + 2, NULL, 10);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_ra_svn__command_handler.  Send an empty response. */
+static svn_error_t *
+inner_cmd(svn_ra_svn_conn_t *conn,
+          apr_pool_t *pool,
+          svn_ra_svn__list_t *params,
+          void *baton)
+{
+  SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, ""));
+  return svn_error_trace(svn_ra_svn__flush(conn, pool));
+}
+
+/* Implements svn_ra_svn__command_handler.  Handle the next command using
+ * the command table BATON, then send an empty response. */
+static svn_error_t *
+outer_cmd(svn_ra_svn_conn_t *conn,
+          apr_pool_t *pool,
+          svn_ra_svn__list_t *params,
+          void *baton)
+{
+  svn_boolean_t terminate;
+
+  SVN_ERR(svn_ra_svn__handle_command(&terminate, baton, NULL, conn, TRUE,
+                                     pool));
+  return svn_error_trace(inner_cmd(conn, pool, params, NULL));
+}
+
+/* Implements svn_ra_svn__command_handler.  Fail. */
+static svn_error_t *
+fail_cmd(svn_ra_svn_conn_t *conn,
+         apr_pool_t *pool,
+         svn_ra_svn__list_t *params,
+         void *baton)
+{
+  return svn_error_create(SVN_ERR_RA_SVN_CMD_ERR,
+                          svn_error_create(SVN_ERR_BASE, NULL, "failed"),
+                          NULL);
+}
+
+static svn_error_t *
+test_empty(apr_pool_t *pool)
+{
+  metrics_t *metrics;
+  const char *output;
+  apr_uint64_t value;
+
+  SVN_ERR(metrics__create(&metrics, NULL, pool));
+  SVN_ERR(get_metrics(&output, metrics, pool));
+
+  SVN_TEST_ASSERT(strstr(output,
+                         "# TYPE svnserve_command_duration_seconds "
+                         "histogram\n"));
+  SVN_TEST_ASSERT(strstr(output,
+                         "# TYPE svnserve_sent_bytes_total counter\n"));
+  SVN_TEST_ASSERT(strstr(output,
+                         "# TYPE svnserve_sessions_active gauge\n"));
+  SVN_TEST_ASSERT(!strstr(output, "{command="));
+
+  SVN_ERR(get_sample(&value, output, "svnserve_sessions_total", pool));
+  SVN_TEST_INT_ASSERT(value, 0);
+  SVN_ERR(get_sample(&value, output, "svnserve_sessions_active", pool));
+  SVN_TEST_INT_ASSERT(value, 0);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_commands(apr_pool_t *pool)
+{
+  static const svn_ra_svn__cmd_entry_t cmd_table[] =
+    {
+      { "outer", outer_cmd },
+      { "inner", inner_cmd },
+      { "fail",  fail_cmd },
+      { NULL }
+    };
+
+  apr_pool_t *session_pool = svn_pool_create(pool);
+  apr_hash_t *cmd_hash = apr_hash_make(pool);
+  svn_stringbuf_t *in = svn_stringbuf_create(commands, pool);
+  svn_stringbuf_t *out = svn_stringbuf_create_empty(pool);
+  const svn_ra_svn__cmd_entry_t *command;
+  svn_ra_svn_conn_t *conn;
+  metrics_t *metrics;
+  const char *output;
+  svn_boolean_t terminate;
+  apr_uint64_t value, inner_out, outer_in, fail_in;
+
+  for (command = cmd_table; command->cmdname; command++)
+    svn_hash_sets(cmd_hash, command->cmdname, (void *)command);
+
+  SVN_ERR(metrics__create(&metrics, NULL, pool));
+  conn = svn_ra_svn_create_conn5(NULL,
+                                 svn_stream_from_stringbuf(in, pool),
+                                 svn_stream_from_stringbuf(out, pool),
+                                 0, 0, 0, 0, 0, session_pool);
+  metrics__observe_connection(metrics, conn, session_pool);
+
+  SVN_ERR(svn_ra_svn__handle_command(&terminate, cmd_hash, cmd_hash, conn,
+                                     TRUE, pool));
+  SVN_ERR(svn_ra_svn__handle_command(&terminate, cmd_hash, cmd_hash, conn,
+                                     TRUE, pool));
+
+  SVN_ERR(get_metrics(&output, metrics, pool));
+
+  /* Every command got counted once, including the nested one. */
+  SVN_ERR(get_sample(&value, output,
+                     "svnserve_command_duration_seconds_count"
+                     "{command=\"outer\"}", pool));
+  SVN_TEST_INT_ASSERT(value, 1);
+  SVN_ERR(get_sample(&value, output,
+                     "svnserve_command_duration_seconds_count"
+                     "{command=\"inner\"}", pool));
+  SVN_TEST_INT_ASSERT(value, 1);
+  SVN_ERR(get_sample(&value, output,
+                     "svnserve_command_duration_seconds_bucket"
+                     "{command=\"fail\",le=\"+Inf\"}", pool));
+  SVN_TEST_INT_ASSERT(value, 1);
+
+  SVN_ERR(get_sample(&value, output,
+                     "svnserve_command_failures_total{command=\"outer\"}",
+                     pool));
+  SVN_TEST_INT_ASSERT(value, 0);
+  SVN_ERR(get_sample(&value, output,
+                     "svnserve_command_failures_total{command=\"fail\"}",
+                     pool));
+  SVN_TEST_INT_ASSERT(value, 1);
+
+  /* The nested command must not hide the I/O of the outer one. */
+  SVN_ERR(get_sample(&inner_out, output,
+                     "svnserve_sent_bytes_total{command=\"inner\"}", pool));
+  SVN_TEST_ASSERT(inner_out > 0);
+  SVN_ERR(get_sample(&value, output,
+                     "svnserve_sent_bytes_total{command=\"outer\"}", pool));
+  SVN_TEST_INT_ASSERT(value, 2 * inner_out);
+  SVN_TEST_INT_ASSERT(out->len, 2 * inner_out);
+
+  SVN_ERR(get_sample(&outer_in, output,
+                     "svnserve_received_bytes_total{command=\"outer\"}",
+                     pool));
+  SVN_ERR(get_sample(&fail_in, output,
+                     "svnserve_received_bytes_total{command=\"fail\"}",
+                     pool));
+  SVN_TEST_ASSERT(outer_in >= strlen("( outer ( ) ) ( inner ( ) ) "));
+  SVN_TEST_INT_ASSERT(outer_in + fail_in, strlen(commands));
+
+  /* Sessions end with their pool. */
+  SVN_ERR(get_sample(&value, output, "svnserve_sessions_total", pool));
+  SVN_TEST_INT_ASSERT(value, 1);
+  SVN_ERR(get_sample(&value, output, "svnserve_sessions_active", pool));
+  SVN_TEST_INT_ASSERT(value, 1);
+
+  svn_pool_destroy(session_pool);
+  SVN_ERR(get_metrics(&output, metrics, pool));
+  SVN_ERR(get_sample(&value, output, "svnserve_sessions_total", pool));
+  SVN_TEST_INT_ASSERT(value, 1);
+  SVN_ERR(get_sample(&value, output, "svnserve_sessions_active", pool));
+  SVN_TEST_INT_ASSERT(value, 0);
+
+  return SVN_NO_ERROR;
+}
+
+
+/* The test table.  */
+
+static int max_threads = 1;
+
+static struct svn_test_descriptor_t test_funcs[] =
+  {
+    SVN_TEST_NULL,
+    SVN_TEST_PASS2(test_empty,
+                   "test metrics without any sessions"),
+    SVN_TEST_PASS2(test_commands,
+                   "test per-command metrics"),
+    SVN_TEST_NULL
+  };
+
+SVN_TEST_MAIN
@@ -0,0 +1,210 @@
+/* read-batch-bench.c -- measure cold-cache block read latency with and
+ *                       without batched (asynchronous) reads
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* Reads a given file (e.g. an FSFS pack file) in blocks of a given size,
+ * once one block at a time and once in batches of a given depth.  Before
+ * each run, the file gets evicted from the OS file cache, where supported,
+ * such that the numbers reflect cold-cache latency.  Blocks are being
+ * visited in a scattered order to defeat the kernel's own read-ahead,
+ * similar to what FSFS sees for a cold checkout of a packed shard.
+ */
+
+#include <stdlib.h>
+
+#include <apr_file_io.h>
+#include <apr_portable.h>
+#include <apr_time.h>
+
+#if APR_HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#include "svn_pools.h"
+#include "svn_cmdline.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_sorts.h"
+#include "private/svn_io_private.h"
+
+#include "svn_private_config.h"
+
+/* Ask the OS to drop all cached pages of FILE. */
+static void
+evict_from_cache(apr_file_t *file)
+{
+#if defined(POSIX_FADV_DONTNEED) && !defined(WIN32)
+  apr_os_file_t fd;
+  if (apr_os_file_get(&fd, file) == APR_SUCCESS)
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+}
+
+/* Read all BLOCK_COUNT blocks of BLOCK_SIZE bytes from FILE in scattered
+ * order, DEPTH blocks per batch.  Return the elapsed time in *DURATION.
+ * Use POOL for allocations.
+ */
+static svn_error_t *
+run(apr_interval_time_t *duration,
+    apr_file_t *file,
+    apr_size_t block_size,
+    int block_count,
+    int depth,
+    apr_pool_t *pool)
+{
+  svn_io__read_request_t *requests
+    = apr_pcalloc(pool, depth * sizeof(*requests));
+  char *buffer = apr_palloc(pool, depth * block_size);
+  apr_time_t start;
+  int i, k;
+
+  /* A large prime stride visits every block exactly once for any
+   * BLOCK_COUNT that it does not divide. */
+  const int stride = block_count % 7919 ? 7919 : 7907;
+
+  for (k = 0; k < depth; ++k)
+    {
+      requests[k].size = block_size;
+      requests[k].buffer = buffer + k * block_size;
+    }
+
+  evict_from_cache(file);
+  start = apr_time_now();
+
+  for (i = 0; i < block_count; i += depth)
+    {
+      int count = MIN(depth, block_count - i);
+      for (k = 0; k < count; ++k)
+        requests[k].offset
+          = (apr_off_t)(((apr_int64_t)(i + k) * stride) % block_count)
+          * block_size;
+
+      SVN_ERR(svn_io__file_read_batch(file, requests, count, pool));
+    }
+
+  *duration = apr_time_now() - start;
+
+  return SVN_NO_ERROR;
+}
+
+/* Print the results for a run over BLOCK_COUNT blocks of BLOCK_SIZE bytes
+ * each that took DURATION with queue DEPTH.  Use POOL for allocations. */
+static svn_error_t *
+print_result(int depth,
+             apr_interval_time_t duration,
+             apr_size_t block_size,
+             int block_count,
+             apr_pool_t *pool)
+{
+  double seconds = (double)duration / APR_USEC_PER_SEC;
+  double mbytes = (double)block_size * block_count / 0x100000;
+
+  return svn_cmdline_printf(pool,
+                            "depth %3d: %8.3f s, %8.1f MB/s, "
+                            "%8.1f us per block\n",
+                            depth, seconds,
+                            seconds > 0 ? mbytes / seconds : 0.0,
+                            (double)duration / block_count);
+}
+
+/* Benchmark reading the file at PATH in blocks of BLOCK_SIZE bytes
+ * with queue depths 1 and DEPTH.  Use POOL for allocations. */
+static svn_error_t *
+bench(const char *path,
+      apr_size_t block_size,
+      int depth,
+      apr_pool_t *pool)
+{
+  apr_file_t *file;
+  apr_off_t file_size;
+  apr_interval_time_t duration;
+  int block_count;
+
+  SVN_ERR(svn_io_file_open(&file, path, APR_READ | APR_BUFFERED,
+                           APR_OS_DEFAULT, pool));
+  SVN_ERR(svn_io_file_size_get(&file_size, file, pool));
+  block_count = (int)(file_size / block_size);
+  if (block_count == 0)
+    return svn_error_createf(SVN_ERR_INCORRECT_PARAMS, NULL,
+                             _("File '%s' is smaller than one block"),
+                             svn_dirent_local_style(path, pool));
+
+  SVN_ERR(svn_cmdline_printf(pool,
+                             "%d blocks of %s bytes, asynchronous reads %s\n",
+                             block_count,
+                             apr_psprintf(pool, "%" APR_SIZE_T_FMT,
+                                          block_size),
+                             svn_io__async_read_available()
+                               ? "available" : "not available"));
+
+  SVN_ERR(run(&duration, file, block_size, block_count, 1, pool));
+  SVN_ERR(print_result(1, duration, block_size, block_count, pool));
+
+  SVN_ERR(run(&duration, file, block_size, block_count, depth, pool));
+  SVN_ERR(print_result(depth, duration, block_size, block_count, pool));
+
+  return svn_error_trace(svn_io_file_close(file, pool));
+}
+
+int
+main(int argc, const char *argv[])
+{
+  apr_pool_t *pool;
+  svn_error_t *err;
+  apr_size_t block_size = 0x10000;
+  int depth = 32;
+
+  if (svn_cmdline_init("read-batch-bench", stderr) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  pool = svn_pool_create(NULL);
+
+  if (argc < 2 || argc > 4)
+    {
+      svn_error_clear(svn_cmdline_fprintf(stderr, pool,
+                        "Usage: %s FILE [BLOCK_SIZE [DEPTH]]\n\n"
+                        "Read FILE with a cold OS file cache in blocks of "
+                        "BLOCK_SIZE bytes (default: 65536),\n"
+                        "first one at a time and then in batches of "
+                        "DEPTH blocks (default: 32).\n",
+                        argv[0]));
+      return EXIT_FAILURE;
+    }
+
+  if (argc > 2)
+    block_size = (apr_size_t)atoi(argv[2]);
+  if (argc > 3)
+    depth = atoi(argv[3]);
+
+  if (block_size == 0 || depth <= 0)
+    err = svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                           _("BLOCK_SIZE and DEPTH must be positive"));
+  else
+    err = bench(svn_dirent_internal_style(argv[1], pool), block_size, depth,
+                pool);
+
+  if (err)
+    return svn_cmdline_handle_exit_error(err, pool, "read-batch-bench: ");
+
+  svn_pool_destroy(pool);
+  return EXIT_SUCCESS;
+}